@@ -122,6 +122,10 @@ uint32_t order)
 	 */
 	arcp->arc_parentlist = childp->parents;
 	childp->parents = arcp;
+	/*
+	 * Enter it in the table arclookup() searches.
+	 */
+	arcinsert(arcp);
 }
 
 /*
@@ -58,6 +58,8 @@
 #include <libc.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
+#include <pthread.h>
 #include "stuff/errors.h"
 #include "gprof.h"
 
@@ -177,47 +179,93 @@ static char *defaultEs[] = {
 /*
  * Static function declarations.
  */
+/*
+ * The gmon.out files are read into memory by a pool of threads while the main
+ * thread sums them up in the order they were given on the command line, so
+ * the result is the same as reading them one after the other.  To bound the
+ * memory used, readers stay at most GMON_READ_AHEAD files per thread ahead of
+ * the file being summed.
+ */
+#define GMON_READ_AHEAD 4
+
+struct gmon_file {
+    char *name;			/* name of the gmon.out file */
+    char *contents;		/* the contents read into memory */
+    uint32_t size;		/* size of the contents */
+    uint32_t offset;		/* offset of the next gmon_read() */
+    int error;			/* errno if it couldn't be read */
+    char *error_format;		/* message for system_fatal() if so */
+    enum bool done;		/* TRUE when it has been read */
+};
+
+static struct gmon_file *gmon_files = NULL;
+static uint32_t ngmon_files = 0;
+static uint32_t next_gmon_file = 0;	/* next one to be read by a thread */
+static uint32_t gmon_files_summed = 0;	/* number summed by the main thread */
+static uint32_t gmon_read_ahead = 0;
+static pthread_mutex_t gmon_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gmon_cond = PTHREAD_COND_INITIALIZER;
+
+static void getpfiles(
+    void);
+
+static void read_gmon_file(
+    struct gmon_file *gf);
+
+static void *gmon_reader(
+    void *arg);
+
+static uint32_t gmon_read(
+    struct gmon_file *gf,
+    void *buf,
+    uint64_t size);
+
+static void gmon_skip(
+    struct gmon_file *gf,
+    char *filename,
+    uint32_t size);
+
 static void getpfile(
-    char *filename);
+    struct gmon_file *gf);
 
 #ifdef __OPENSTEP__
 static void read_rld_state(
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes);
 #endif
 
 static void read_dyld_state(
     uint32_t type,
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes,
     uint32_t magic);
 
 static uint32_t new_sample_set(
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes,
     enum bool old_style,
     uint32_t magic);
 
 static void readarcs(
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes);
 
 static void readarcs_64(
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes);
 
 static void readarcs_orders(
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes);
 
 static void readarcs_orders_64(
-    int fd,
+    struct gmon_file *gf,
     char *filename,
     uint32_t nbytes);
 
@@ -362,12 +410,21 @@ char **envp)
 	 * Get information about mon.out file(s).
 	 */
 	hz = 0;
-	do{
-	    getpfile(gmonname);
-	    if(*argv != 0){
-		gmonname = *argv;
-	    }
-	}while(*argv++ != 0);
+	gmon_files = calloc(1, sizeof(struct gmon_file));
+	if(gmon_files == NULL)
+	    fatal("no room for gmon.out file names (calloc failed)");
+	gmon_files[0].name = gmonname;
+	for(ngmon_files = 1; *argv != 0; ngmon_files++, argv++){
+	    gmon_files = realloc(gmon_files, (ngmon_files + 1) *
+				 sizeof(struct gmon_file));
+	    if(gmon_files == NULL)
+		fatal("no room for gmon.out file names (realloc failed)");
+	    memset(gmon_files + ngmon_files, '\0', sizeof(struct gmon_file));
+	    gmon_files[ngmon_files].name = *argv;
+	}
+	getpfiles();
+	if(nsample_sets == 0)
+	    fatal("no histogram in the gmon.out file(s)");
 
 	/*
 	 * How many ticks per second?  If we can't tell, report time in ticks.
@@ -426,25 +483,196 @@ char **envp)
 	return(0);
 }
 
+/*
+ * Read and sum up all the gmon.out files.
+ */
 static
 void
-getpfile(
-char *filename)
+getpfiles(
+void)
+{
+    uint32_t i, nthreads, nstarted;
+    long ncpus;
+    pthread_t *threads;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = ncpus > 0 ? (uint32_t)ncpus : 1;
+	if(nthreads > ngmon_files)
+	    nthreads = ngmon_files;
+	nstarted = 0;
+	threads = NULL;
+	if(nthreads > 1){
+	    gmon_read_ahead = nthreads * GMON_READ_AHEAD;
+	    threads = malloc(nthreads * sizeof(pthread_t));
+	    if(threads == NULL)
+		fatal("no room for threads (malloc failed)");
+	    for(i = 0; i < nthreads; i++){
+		if(pthread_create(threads + nstarted, NULL, gmon_reader,
+				  NULL) != 0)
+		    break;
+		nstarted++;
+	    }
+	}
+
+	for(i = 0; i < ngmon_files; i++){
+	    if(nstarted == 0){
+		read_gmon_file(gmon_files + i);
+	    }
+	    else{
+		pthread_mutex_lock(&gmon_lock);
+		while(gmon_files[i].done == FALSE)
+		    pthread_cond_wait(&gmon_cond, &gmon_lock);
+		pthread_mutex_unlock(&gmon_lock);
+	    }
+	    getpfile(gmon_files + i);
+	    free(gmon_files[i].contents);
+	    gmon_files[i].contents = NULL;
+	    pthread_mutex_lock(&gmon_lock);
+	    gmon_files_summed++;
+	    pthread_cond_broadcast(&gmon_cond);
+	    pthread_mutex_unlock(&gmon_lock);
+	}
+
+	for(i = 0; i < nstarted; i++)
+	    pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+/*
+ * The start routine of the threads reading gmon.out files.
+ */
+static
+void *
+gmon_reader(
+void *arg)
+{
+    struct gmon_file *gf;
+
+	for(;;){
+	    pthread_mutex_lock(&gmon_lock);
+	    while(next_gmon_file < ngmon_files &&
+		  next_gmon_file >= gmon_files_summed + gmon_read_ahead)
+		pthread_cond_wait(&gmon_cond, &gmon_lock);
+	    if(next_gmon_file == ngmon_files){
+		pthread_mutex_unlock(&gmon_lock);
+		return(NULL);
+	    }
+	    gf = gmon_files + next_gmon_file++;
+	    pthread_mutex_unlock(&gmon_lock);
+
+	    read_gmon_file(gf);
+
+	    pthread_mutex_lock(&gmon_lock);
+	    gf->done = TRUE;
+	    pthread_cond_broadcast(&gmon_cond);
+	    pthread_mutex_unlock(&gmon_lock);
+	}
+}
+
+/*
+ * Read the contents of a gmon.out file into memory.  Errors are recorded in
+ * the gmon_file struct and reported when it is summed so they come out in
+ * order.
+ */
+static
+void
+read_gmon_file(
+struct gmon_file *gf)
 {
-    uint32_t magic, left;
-    gmon_data_t data;
     int fd;
+    ssize_t n;
     struct stat stat;
 
-	if((fd = open(filename, O_RDONLY)) == -1)
-	    system_fatal("can't open: %s", filename);
-	if(fstat(fd, &stat) == -1)
-	    system_fatal("can't stat: %s", filename);
+	if((fd = open(gf->name, O_RDONLY)) == -1){
+	    gf->error = errno;
+	    gf->error_format = "can't open: %s";
+	    return;
+	}
+	if(fstat(fd, &stat) == -1){
+	    gf->error = errno;
+	    gf->error_format = "can't stat: %s";
+	    close(fd);
+	    return;
+	}
+	gf->contents = malloc(stat.st_size == 0 ? 1 : stat.st_size);
+	if(gf->contents == NULL){
+	    gf->error = errno;
+	    gf->error_format = "can't allocate memory to read: %s";
+	    close(fd);
+	    return;
+	}
+	gf->size = 0;
+	while(gf->size < stat.st_size){
+	    n = read(fd, gf->contents + gf->size, stat.st_size - gf->size);
+	    if(n == -1){
+		gf->error = errno;
+		gf->error_format = "can't read: %s";
+		break;
+	    }
+	    if(n == 0)
+		break;
+	    gf->size += n;
+	}
+	close(fd);
+}
+
+/*
+ * Copy the next size bytes of the gmon.out file's contents into buf.  Like
+ * read(2) the number of bytes copied is returned, which is less than size at
+ * the end of the contents.
+ */
+static
+uint32_t
+gmon_read(
+struct gmon_file *gf,
+void *buf,
+uint64_t size)
+{
+	if(gf->offset >= gf->size)
+	    return(0);
+	if(size > gf->size - gf->offset)
+	    size = gf->size - gf->offset;
+	memcpy(buf, gf->contents + gf->offset, size);
+	gf->offset += size;
+	return(size);
+}
+
+/*
+ * Move past the next size bytes of the gmon.out file's contents, which must
+ * all be there.
+ */
+static
+void
+gmon_skip(
+struct gmon_file *gf,
+char *filename,
+uint32_t size)
+{
+	if(gf->offset > gf->size || size > gf->size - gf->offset)
+	    system_fatal("truncated or malformed gmon.out file: %s (can't "
+			 "skip %u bytes)", filename, size);
+	gf->offset += size;
+}
+
+static
+void
+getpfile(
+struct gmon_file *gf)
+{
+    uint32_t magic, left, end;
+    gmon_data_t data;
+    char *filename;
+
+	filename = gf->name;
+	if(gf->error != 0){
+	    errno = gf->error;
+	    system_fatal(gf->error_format, filename);
+	}
 	/*
 	 * See if this gmon.out file is an old format or new format by looking
 	 * for the magic number of the new format.
 	 */
-	if(read(fd, &magic, sizeof(uint32_t)) != sizeof(uint32_t))
+	if(gmon_read(gf, &magic, sizeof(uint32_t)) != sizeof(uint32_t))
 	    system_fatal("malformed gmon.out file: %s (can't read magic "
 			 "number)", filename);
 	if(magic == GMON_MAGIC || magic == GMON_MAGIC_64){
@@ -458,17 +686,21 @@ char *filename)
 	     * This is a new format gmon.out file.  After the magic number comes
 	     * any number of pairs of gmon_data structs and some typed data.
 	     */
-	    left = stat.st_size - sizeof(uint32_t);
-	    while(left >= sizeof(struct gmon_data)){
-		if(read(fd, &data, sizeof(struct gmon_data)) !=
+	    while(gf->size - gf->offset >= sizeof(struct gmon_data)){
+		if(gmon_read(gf, &data, sizeof(struct gmon_data)) !=
 			sizeof(struct gmon_data))
 		    system_fatal("malformed gmon.out file: %s (can't read "
 				 "gmon_data struct)", filename);
-		left -= sizeof(struct gmon_data);
-		if(left < data.size)
-		    fatal("truncated or malformed gmon.out file: %s (value in "
-			  "size field in gmon_data struct more than left in "
-			  "file)", filename);
+		/*
+		 * The readers below check the data they read against data.size
+		 * but may not use all of it, so the next gmon_data struct is
+		 * found from data.size rather than from where they stop.
+		 */
+		if(data.size > gf->size - gf->offset)
+		    system_fatal("truncated or malformed gmon.out file: %s "
+			  "(value in size field in gmon_data struct more than "
+			  "left in file)", filename);
+		end = gf->offset + data.size;
 #ifdef DEBUG_GMON_OUT
 		printf("gmon_data struct: type = %u size = %u\n", data.type,
 		       data.size);
@@ -478,25 +710,25 @@ char *filename)
 #ifdef DEBUG_GMON_OUT
 		    printf("GMONTYPE_SAMPLES\n");
 #endif
-		    new_sample_set(fd, filename, data.size, FALSE, magic);
+		    new_sample_set(gf, filename, data.size, FALSE, magic);
 		    break;
 		case GMONTYPE_RAWARCS:
 #ifdef DEBUG_GMON_OUT
 		    printf("GMONTYPE_RAWARCS\n");
 #endif
 		    if(magic == GMON_MAGIC)
-			readarcs(fd, filename, data.size);
+			readarcs(gf, filename, data.size);
 		    else
-			readarcs_64(fd, filename, data.size);
+			readarcs_64(gf, filename, data.size);
 		    break;
 		case GMONTYPE_ARCS_ORDERS:
 #ifdef DEBUG_GMON_OUT
 		    printf("GMONTYPE_ARCS_ORDERS\n");
 #endif
 		    if(magic == GMON_MAGIC)
-			readarcs_orders(fd, filename, data.size);
+			readarcs_orders(gf, filename, data.size);
 		    else
-			readarcs_orders_64(fd, filename, data.size);
+			readarcs_orders_64(gf, filename, data.size);
 		    break;
 #ifdef __OPENSTEP__
 		case GMONTYPE_RLD_STATE:
@@ -504,13 +736,13 @@ char *filename)
 		    printf("GMONTYPE_RLD_STATE\n");
 #endif
 		    if(grld_nloaded_states == 0){
-			read_rld_state(fd, filename, data.size);
+			read_rld_state(gf, filename, data.size);
 			get_rld_state_symbols();
 		    }
 		    else{
 			warning("can't process more than one rld loaded state "
 			        "(ignoring rld state from: %s)", filename);
-			lseek(fd, data.size, L_INCR);
+			gmon_skip(gf, filename, data.size);
 		    }
 		    break;
 #endif
@@ -525,14 +757,14 @@ char *filename)
 #endif
 setup_dyld_state:
 		    if(image_count == 0){
-			read_dyld_state(data.type, fd, filename, data.size,
+			read_dyld_state(data.type, gf, filename, data.size,
 					magic);
 			get_dyld_state_symbols();
 		    }
 		    else{
 			warning("can't process more than one dyld state "
 			        "(ignoring dyld state from: %s)", filename);
-			lseek(fd, data.size, L_INCR);
+			gmon_skip(gf, filename, data.size);
 		    }
 		    break;
 		default:
@@ -542,8 +774,13 @@ setup_dyld_state:
 		    fatal("truncated or malformed gmon.out file: %s (value in "
 			  "type field in gmon_data struct unknown)", filename);
 		}
-		left -= data.size;
+		if(gf->offset > end)
+		    fatal("truncated or malformed gmon.out file: %s (data "
+			  "extends past the size field in its gmon_data "
+			  "struct)", filename);
+		gf->offset = end;
 	    }
+	    left = gf->size - gf->offset;
 	    if(left != 0)
 		fatal("truncated or malformed gmon.out file: %s (file end in "
 		      "the middle of a gmon_data struct %u)", filename, left);
@@ -553,19 +790,18 @@ setup_dyld_state:
 	     * This is an old format gmon.out file.  It has a profile header
 	     * then * an array of sampling hits within pc ranges, and then arcs.
 	     */
-	    lseek(fd, 0, L_SET);
-	    left = stat.st_size;
-	    left -= new_sample_set(fd, filename, left, TRUE, GMON_MAGIC);
-	    readarcs(fd, filename, left);
+	    gf->offset = 0;
+	    left = gf->size;
+	    left -= new_sample_set(gf, filename, left, TRUE, GMON_MAGIC);
+	    readarcs(gf, filename, left);
 	}
-	close(fd);
 }
 
 #ifdef __OPENSTEP__
 static
 void
 read_rld_state(
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes)
 {
@@ -574,7 +810,7 @@ uint32_t nbytes)
 
 	size_read = 0;
 	size = sizeof(uint32_t);
-	if(read(fd, &grld_nloaded_states, size) != size)
+	if(gmon_read(gf, &grld_nloaded_states, size) != size)
 	    system_fatal("malformed gmon.out file: %s (can't read number of "
 			 "rld states)", filename);
 	size_read += size;
@@ -586,13 +822,14 @@ uint32_t nbytes)
 
 	for(i = 0; i < grld_nloaded_states; i++){
 	    size = sizeof(uint32_t);
-	    if(read(fd, &(grld_loaded_state[i].header_addr), size) != size)
+	    if(gmon_read(gf, &(grld_loaded_state[i].header_addr), size) != size)
 		system_fatal("malformed gmon.out file: %s (can't read header "
 		    "address of rld state %lu)", filename, i);
 	    size_read += size;
 
 	    size = sizeof(uint32_t);
-	    if(read(fd, &(grld_loaded_state[i].nobject_filenames), size) != size)
+	    if(gmon_read(gf, &(grld_loaded_state[i].nobject_filenames),
+			 size) != size)
 		system_fatal("malformed gmon.out file: %s (can't read number "
 		    "of object file names of rld state %lu)", filename, i);
 	    size_read += size;
@@ -605,13 +842,13 @@ uint32_t nbytes)
 		      "failed)", i);
 
 	    size = grld_loaded_state[i].nobject_filenames * sizeof(char *);
-	    if(read(fd, grld_loaded_state[i].object_filenames, size) != size)
+	    if(gmon_read(gf, grld_loaded_state[i].object_filenames, size) != size)
 		system_fatal("malformed gmon.out file: %s (can't read offsets "
 		    "to file names of rld state %lu)", filename, i);
 	    size_read += size;
 
 	    size = sizeof(uint32_t);
-	    if(read(fd, &str_size, size) != size)
+	    if(gmon_read(gf, &str_size, size) != size)
 		system_fatal("malformed gmon.out file: %s (can't read string "
 		    "size of rld state %lu)", filename, i);
 	    size_read += size;
@@ -622,7 +859,7 @@ uint32_t nbytes)
 		      "failed)", i);
 
 	    size = str_size;
-	    if(read(fd, strings, size) != size)
+	    if(gmon_read(gf, strings, size) != size)
 		system_fatal("malformed gmon.out file: %s (can't read strings "
 		    "of file names of rld state %lu)", filename, i);
 	    size_read += size;
@@ -660,7 +897,7 @@ static
 void
 read_dyld_state(
 uint32_t type,
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes,
 uint32_t magic)
@@ -673,7 +910,7 @@ uint32_t magic)
 	if(buf == NULL)
 	    fatal("no room for dyld state (malloc failed)");
 
-	if(read(fd, buf, nbytes) != (int)nbytes)
+	if(gmon_read(gf, buf, nbytes) != nbytes)
 	    system_fatal("malformed gmon.out file: %s (can't read dyld state)",
 			 filename);
 
@@ -718,14 +955,13 @@ uint32_t magic)
 	    }
 
 	    dyld_images[i].name = buf + offset;
-	    while(buf[offset] != '\0' && offset < nbytes)
-		offset++;
-	    if(buf[offset] == '\0' && offset < nbytes)
+	    while(offset < nbytes && buf[offset] != '\0')
 		offset++;
-	    if(offset > nbytes)
+	    if(offset >= nbytes)
 		fatal("truncated or malformed gmon.out file: %s (name "
 		      "for image %u extends past the end of the dyld state)",
 		      filename, i);
+	    offset++;
 	}
 #ifdef DEBUG
 	if(debug & DYLDDEBUG){
@@ -744,7 +980,7 @@ uint32_t magic)
 static
 uint32_t
 new_sample_set(
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes,
 enum bool old_style,
@@ -772,9 +1008,9 @@ uint32_t magic)
 	 * Read the profile header and check to see if it is valid.
 	 */
 	if(magic == GMON_MAGIC)
-	    size = read(fd, &header32, sizeof_header);
+	    size = gmon_read(gf, &header32, sizeof_header);
 	else
-	    size = read(fd, &header, sizeof_header);
+	    size = gmon_read(gf, &header, sizeof_header);
 
 	if(size != sizeof_header)
 	    system_fatal("malformed gmon.out file: %s (can't read header)",
@@ -906,7 +1142,7 @@ uint32_t magic)
 	if(samples == NULL)
 	    system_fatal("can't allocate buffer of size: %llu for samples from "
 			 "gmon.out file: %s", size, filename);
-	if(read(fd, samples, size) != size)
+	if(gmon_read(gf, samples, size) != size)
 	    system_fatal("can't read samples from gmon.out file: %s", filename);
 	for(j = 0; j < sample_sets[i].nsamples; j++){
 	    sample = samples[j];
@@ -925,7 +1161,7 @@ uint32_t magic)
 static
 void
 readarcs(
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes)
 {
@@ -936,7 +1172,7 @@ uint32_t nbytes)
 	 * Arcs consists of a bunch of <from,self,count> tuples.
 	 */
 	for(i = 0; i < nbytes; i += sizeof(struct rawarc)){
-	    if(read(fd, &arc, sizeof(struct rawarc)) != sizeof(struct rawarc))
+	    if(gmon_read(gf, &arc, sizeof(struct rawarc)) != sizeof(struct rawarc))
 		system_fatal("malformed gmon.out file: %s (can't read arcs)",
 			     filename);
 #ifdef DEBUG
@@ -955,7 +1191,7 @@ uint32_t nbytes)
 static
 void
 readarcs_64(
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes)
 {
@@ -966,7 +1202,7 @@ uint32_t nbytes)
 	 * Arcs consists of a bunch of <from,self,count> tuples.
 	 */
 	for(i = 0; i < nbytes; i += sizeof(struct rawarc_64)){
-	    if(read(fd, &arc, sizeof(struct rawarc_64)) !=
+	    if(gmon_read(gf, &arc, sizeof(struct rawarc_64)) !=
 	       sizeof(struct rawarc_64))
 		system_fatal("malformed gmon.out file: %s (can't read arcs)",
 			     filename);
@@ -986,7 +1222,7 @@ uint32_t nbytes)
 static
 void
 readarcs_orders(
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes)
 {
@@ -997,7 +1233,7 @@ uint32_t nbytes)
 	 * Arcs consists of a bunch of <from,self,count> tuples.
 	 */
 	for(i = 0; i < nbytes; i += sizeof(struct rawarc_order)){
-	    if(read(fd, &arc_order, sizeof(struct rawarc_order)) !=
+	    if(gmon_read(gf, &arc_order, sizeof(struct rawarc_order)) !=
 					sizeof(struct rawarc_order))
 		system_fatal("malformed gmon.out file: %s (can't read arcs)",
 			     filename);
@@ -1020,7 +1256,7 @@ uint32_t nbytes)
 static
 void
 readarcs_orders_64(
-int fd,
+struct gmon_file *gf,
 char *filename,
 uint32_t nbytes)
 {
@@ -1031,7 +1267,7 @@ uint32_t nbytes)
 	 * Arcs consists of a bunch of <from,self,count> tuples.
 	 */
 	for(i = 0; i < nbytes; i += sizeof(struct rawarc_order_64)){
-	    if(read(fd, &arc_order, sizeof(struct rawarc_order_64)) !=
+	    if(gmon_read(gf, &arc_order, sizeof(struct rawarc_order_64)) !=
 					sizeof(struct rawarc_order_64))
 		system_fatal("malformed gmon.out file: %s (can't read arcs)",
 			     filename);
@@ -1311,13 +1547,25 @@ void
 asgnsamples(
 struct sample_set *s)
 {
-    uint32_t i, j;
+    uint64_t i, j, k, low, middle, high;
     unsigned UNIT ccnt;
     double time;
-    uint32_t pcl, pch, overlap, svalue0, svalue1;
+    uint64_t pcl, pch, overlap, svalue0, svalue1;
 
-	/* read samples and assign to namelist symbols */
-	for(i = 0, j = 1; i < s->nsamples; i++){
+	/*
+	 * Both the samples and the namelist are sorted by address so they are
+	 * swept together once, starting with the routine the sample set starts
+	 * in which is found with a binary search.
+	 */
+	for(low = 0, high = nname; low < high; ){
+	    middle = (low + high) >> 1;
+	    if(nl[middle + 1].svalue <= s->lowpc)
+		low = middle + 1;
+	    else
+		high = middle;
+	}
+	j = low;
+	for(i = 0; i < s->nsamples; i++){
 	    ccnt = s->samples[i];
 	    if (ccnt == 0)
 		continue;
@@ -1326,38 +1574,38 @@ struct sample_set *s)
 	    time = ccnt;
 #ifdef DEBUG
 	    if(debug & SAMPLEDEBUG){
-		printf("[asgnsamples] pcl 0x%x pch 0x%x ccnt %d\n",
-		       (unsigned int)pcl, (unsigned int)pch, ccnt);
+		printf("[asgnsamples] pcl 0x%llx pch 0x%llx ccnt %d\n",
+		       pcl, pch, ccnt);
 	    }
 #endif
 	    totime += time;
-	    for(j = j - 1; j < nname; j++){
-		svalue0 = nl[j].svalue;
-		svalue1 = nl[j+1].svalue;
+	    /*
+	     * Skip the routines that end before this tick, since pcl only
+	     * increases they get no more ticks.
+	     */
+	    while(j < nname && nl[j+1].svalue <= pcl)
+		j++;
+	    for(k = j; k < nname; k++){
+		svalue0 = nl[k].svalue;
+		svalue1 = nl[k+1].svalue;
 		/*
 		 * if high end of tick is below entry address, 
 		 * go for next tick.
 		 */
 		if(pch < svalue0)
 		    break;
-		/*
-		 * if low end of tick into next routine,
-		 * go for next routine.
-		 */
-		if(pcl >= svalue1)
-		    continue;
 		overlap = min(pch, svalue1) - max(pcl, svalue0);
 		if(overlap > 0){
 #ifdef DEBUG
 		    if (debug & SAMPLEDEBUG) {
-			printf("[asgnsamples] (0x%x->0x%x-0x%x) %s gets %f "
-			       "ticks %u overlap\n",
-			       (unsigned int)(nl[j].value/sizeof(UNIT)),
-			       (unsigned int)svalue0, (unsigned int)svalue1,
-			       nl[j].name, overlap * time / s->scale, overlap);
+			printf("[asgnsamples] (0x%llx->0x%llx-0x%llx) %s gets "
+			       "%f ticks %llu overlap\n",
+			       nl[k].value/sizeof(UNIT), svalue0, svalue1,
+			       nl[k].name, overlap * time / s->scale,
+			       overlap);
 		    }
 #endif
-		    nl[j].time += overlap * time / s->scale;
+		    nl[k].time += overlap * time / s->scale;
 		}
 	    }
 	}
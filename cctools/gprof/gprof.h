@@ -126,6 +126,7 @@ struct arcstruct {
     double		arc_childtime;	/* childtime inherited along arc */
     struct arcstruct	*arc_parentlist; /* parents-of-this-child list */
     struct arcstruct	*arc_childlist;	/* children-of-this-parent list */
+    struct arcstruct	*arc_hashlink;	/* next arc in arclookup()'s bucket */
 };
 typedef struct arcstruct	arctype;
 
@@ -337,6 +338,9 @@ extern uint32_t nshlib_text_ranges;
 	nltype *parentp,
 	nltype *childp);
 
+    extern void arcinsert(
+	arctype *arcp);
+
 /* printgprof.c */
     extern void printgprof(
 	nltype **timesortnlp);
@@ -55,8 +55,25 @@
  * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdlib.h>
+#include <stdint.h>
+#include "stuff/errors.h"
 #include "gprof.h"
 
+/*
+ * The arcs are also kept in a hash table keyed by their parent and child so
+ * arclookup() doesn't have to walk the parent's list of children, which gets
+ * long for routines that call thousands of others.
+ */
+#define INITIAL_ARC_HASH_SIZE 1024
+static arctype **arc_hash = NULL;
+static uint32_t arc_hash_size = 0;	/* always a power of 2 */
+static uint32_t narcs = 0;		/* number of arcs in arc_hash */
+
+static uint32_t arc_hash_value(
+    nltype *parentp,
+    nltype *childp);
+
 /*
  * look up an address in a sorted-by-address namelist
  *    this deals with misses by mapping them to the next lower 
@@ -100,6 +117,57 @@ uint64_t address)
 	return(NULL);
 }
 
+static
+uint32_t
+arc_hash_value(
+nltype *parentp,
+nltype *childp)
+{
+    uint64_t h;
+
+	h = (uint64_t)(uintptr_t)parentp * 0x9e3779b97f4a7c15ULL;
+	h ^= (uint64_t)(uintptr_t)childp;
+	h *= 0xff51afd7ed558ccdULL;
+	return((uint32_t)(h >> 32));
+}
+
+/*
+ * Enter a new arc into the hash table used by arclookup(), growing the table
+ * when it becomes more than half full.
+ */
+void
+arcinsert(
+arctype *arcp)
+{
+    uint32_t i, new_size, h;
+    arctype **new_hash, *next;
+
+	if(narcs >= arc_hash_size / 2){
+	    new_size = arc_hash_size == 0 ?
+		INITIAL_ARC_HASH_SIZE : arc_hash_size * 2;
+	    new_hash = (arctype **)calloc(new_size, sizeof(arctype *));
+	    if(new_hash == NULL)
+		fatal("no room for arc hash table (calloc failed)");
+	    for(i = 0; i < arc_hash_size; i++){
+		for( ; arc_hash[i] != NULL; arc_hash[i] = next){
+		    next = arc_hash[i]->arc_hashlink;
+		    h = arc_hash_value(arc_hash[i]->arc_parentp,
+				       arc_hash[i]->arc_childp) & (new_size-1);
+		    arc_hash[i]->arc_hashlink = new_hash[h];
+		    new_hash[h] = arc_hash[i];
+		}
+	    }
+	    free(arc_hash);
+	    arc_hash = new_hash;
+	    arc_hash_size = new_size;
+	}
+	h = arc_hash_value(arcp->arc_parentp, arcp->arc_childp) &
+	    (arc_hash_size - 1);
+	arcp->arc_hashlink = arc_hash[h];
+	arc_hash[h] = arcp;
+	narcs++;
+}
+
 arctype *
 arclookup(
 nltype *parentp,
@@ -117,7 +185,12 @@ nltype *childp)
 		   parentp->name, childp->name);
 	}
 #endif
-	for(arcp = parentp->children; arcp ; arcp = arcp->arc_childlist){
+	if(arc_hash_size == 0)
+	    return(NULL);
+	for(arcp = arc_hash[arc_hash_value(parentp, childp) &
+			    (arc_hash_size - 1)];
+	    arcp ;
+	    arcp = arcp->arc_hashlink){
 #ifdef DEBUG
 	    if(debug & LOOKUPDEBUG){
 		printf("[arclookup]\t arc_parent %s arc_child %s\n",
@@ -125,7 +198,7 @@ nltype *childp)
 		       arcp->arc_childp->name);
 	    }
 #endif
-	    if(arcp->arc_childp == childp){
+	    if(arcp->arc_parentp == parentp && arcp->arc_childp == childp){
 		return(arcp);
 	    }
 	}
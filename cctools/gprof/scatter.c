@@ -60,6 +60,7 @@ static FILE *gmon = NULL;
 static FILE *callf = NULL;
 static FILE *callo = NULL;
 static FILE *callt = NULL;
+static FILE *clusterf = NULL;
 #ifdef notdef
 static FILE *treefile = NULL;
 #endif
@@ -72,6 +73,25 @@ static char *whatsloaded = NULL;
 static Edge *free_edges = NULL;
 static Edge pqzero = { NULL, NULL, NULL, NULL, NULL, 0, 0, INT_MAX };
 
+/*
+ * cluster.order is produced with call-chain clustering: the profiled routines
+ * are visited from the hottest down and each one's cluster is appended to the
+ * cluster of its most frequent caller, unless the two together would be
+ * bigger than CLUSTER_MAX_SIZE.  The clusters are then laid out from the
+ * densest (most time per byte) down, so the routines of hot call chains end
+ * up next to each other sharing pages and cache lines.
+ */
+#define CLUSTER_MAX_SIZE 4096
+#define CLUSTER_PAGE_SIZE 4096
+
+struct cluster {
+    int head;		/* first routine in the cluster (index into nl) */
+    int tail;		/* last routine in the cluster */
+    uint64_t size;	/* total size of the routines in bytes */
+    double time;	/* total time of the routines */
+    int64_t ncall;	/* total number of calls to the routines */
+};
+
 static void pqinsert(
     Edge *edge);
 static Edge *pqremove(
@@ -549,6 +569,219 @@ arctype *backarc)
 				       (arc->arc_count)));
 }
 
+static
+uint64_t
+routine_size(
+nltype *nlp)
+{
+	return((nlp + 1)->value - nlp->value);
+}
+
+static
+enum bool
+cluster_routine(
+nltype *nlp)
+{
+	if(nlp->ncall == 0 && nlp->time == 0)
+	    return(FALSE);
+	if(nlp->value < text_min || nlp->value >= text_max)
+	    return(FALSE);
+	return(TRUE);
+}
+
+static
+int
+compare_hotness(
+nltype **x,
+nltype **y)
+{
+	if((*x)->time > (*y)->time)
+	    return(-1);
+	if((*x)->time < (*y)->time)
+	    return(1);
+	if((*x)->ncall > (*y)->ncall)
+	    return(-1);
+	if((*x)->ncall < (*y)->ncall)
+	    return(1);
+	return((*x < *y) ? -1 : (*x > *y));
+}
+
+static
+int
+compare_density(
+struct cluster **x,
+struct cluster **y)
+{
+    double dx, dy;
+
+	dx = (*x)->time / ((*x)->size ? (*x)->size : 1);
+	dy = (*y)->time / ((*y)->size ? (*y)->size : 1);
+	if(dx > dy)
+	    return(-1);
+	if(dx < dy)
+	    return(1);
+	if((*x)->ncall > (*y)->ncall)
+	    return(-1);
+	if((*x)->ncall < (*y)->ncall)
+	    return(1);
+	return((*x)->head - (*y)->head);
+}
+
+/*
+ * Return the number of pages touched by routines of the given sizes laid out
+ * one after the other starting at addr.  If addrs is not NULL each routine
+ * is at the address in it instead.  The addresses must be increasing.
+ */
+static
+uint64_t
+pages_touched(
+uint64_t addr,
+uint64_t *addrs,
+uint64_t *sizes,
+int n)
+{
+    int i;
+    uint64_t pages, first, last, last_counted;
+
+	pages = 0;
+	last_counted = 0;
+	for(i = 0; i < n; i++){
+	    if(addrs != NULL)
+		addr = addrs[i];
+	    if(sizes[i] != 0){
+		first = addr / CLUSTER_PAGE_SIZE;
+		last = (addr + sizes[i] - 1) / CLUSTER_PAGE_SIZE;
+		if(pages != 0 && first <= last_counted)
+		    first = last_counted + 1;
+		if(first <= last){
+		    pages += last - first + 1;
+		    last_counted = last;
+		}
+	    }
+	    addr += sizes[i];
+	}
+	return(pages);
+}
+
+/*
+ * Write cluster.order using call-chain clustering and report how many pages
+ * the profiled routines touch in that order compared to how they are linked.
+ */
+static
+void
+cluster(
+void)
+{
+    int i, n, nclusters, from, to;
+    nltype *nlp, *callerp, **hot;
+    arctype *arcp, *best;
+    struct cluster *clusters, **sorted;
+    int *cluster_of, *next;
+    uint64_t *addrs, *sizes, before, after;
+    char *file;
+
+	n = npe - nl;
+	hot = (nltype **)malloc(n * sizeof(nltype *));
+	clusters = (struct cluster *)malloc(n * sizeof(struct cluster));
+	cluster_of = (int *)malloc(n * sizeof(int));
+	next = (int *)malloc(n * sizeof(int));
+	addrs = (uint64_t *)malloc(n * sizeof(uint64_t));
+	sizes = (uint64_t *)malloc(n * sizeof(uint64_t));
+	if(hot == NULL || clusters == NULL || cluster_of == NULL ||
+	   next == NULL || addrs == NULL || sizes == NULL)
+	    fatal("no room for clustering routines (malloc failed)");
+
+	/*
+	 * Start with each profiled routine in a cluster of its own, and note
+	 * the pages they touch as linked.
+	 */
+	nclusters = 0;
+	for(i = 0; i < n; i++){
+	    nlp = nl + i;
+	    cluster_of[i] = NONE;
+	    next[i] = NONE;
+	    if(cluster_routine(nlp) == FALSE)
+		continue;
+	    clusters[nclusters].head = i;
+	    clusters[nclusters].tail = i;
+	    clusters[nclusters].size = routine_size(nlp);
+	    clusters[nclusters].time = nlp->time;
+	    clusters[nclusters].ncall = nlp->ncall;
+	    addrs[nclusters] = nlp->value;
+	    sizes[nclusters] = routine_size(nlp);
+	    hot[nclusters] = nlp;
+	    cluster_of[i] = nclusters++;
+	}
+	before = pages_touched(0, addrs, sizes, nclusters);
+
+	/*
+	 * Visit the routines from the hottest down merging each one's cluster
+	 * after the cluster of its most frequent caller.
+	 */
+	qsort(hot, nclusters, sizeof(nltype *),
+	      (int (*)(const void *, const void *))compare_hotness);
+	for(i = 0; i < nclusters; i++){
+	    nlp = hot[i];
+	    best = NULL;
+	    for(arcp = nlp->parents; arcp; arcp = arcp->arc_parentlist){
+		callerp = arcp->arc_parentp;
+		if(callerp < nl || callerp >= npe || callerp == nlp ||
+		   cluster_of[callerp - nl] == NONE)
+		    continue;
+		if(best == NULL || arcp->arc_count > best->arc_count)
+		    best = arcp;
+	    }
+	    if(best == NULL)
+		continue;
+	    from = cluster_of[nlp - nl];
+	    to = cluster_of[best->arc_parentp - nl];
+	    if(from == to ||
+	       clusters[from].size + clusters[to].size > CLUSTER_MAX_SIZE)
+		continue;
+	    next[clusters[to].tail] = clusters[from].head;
+	    clusters[to].tail = clusters[from].tail;
+	    clusters[to].size += clusters[from].size;
+	    clusters[to].time += clusters[from].time;
+	    clusters[to].ncall += clusters[from].ncall;
+	    for(from = clusters[from].head; from != NONE; from = next[from])
+		cluster_of[from] = to;
+	}
+
+	/*
+	 * Lay out the clusters that are left from the densest down.
+	 */
+	sorted = (struct cluster **)malloc(nclusters * sizeof(struct cluster *));
+	if(sorted == NULL)
+	    fatal("no room for clustering routines (malloc failed)");
+	for(n = 0, i = 0; i < nclusters; i++){
+	    if(cluster_of[clusters[i].head] == i)
+		sorted[n++] = clusters + i;
+	}
+	qsort(sorted, n, sizeof(struct cluster *),
+	      (int (*)(const void *, const void *))compare_density);
+	nclusters = 0;
+	for(i = 0; i < n; i++){
+	    for(to = sorted[i]->head; to != NONE; to = next[to]){
+		nlp = nl + to;
+		file = find_file(nlp->value);
+		fprintf(clusterf, "%s:%s\n", file ? file : "", nlp->name);
+		sizes[nclusters++] = routine_size(nlp);
+	    }
+	}
+	after = pages_touched(0, NULL, sizes, nclusters);
+	fprintf(stderr, "cluster.order: %d profiled routines touch %llu pages "
+		"as linked, %llu pages in cluster.order\n", nclusters,
+		before, after);
+
+	free(hot);
+	free(clusters);
+	free(sorted);
+	free(cluster_of);
+	free(next);
+	free(addrs);
+	free(sizes);
+}
+
 static
 void
 scatter(
@@ -576,6 +809,9 @@ void)
 	    print_tree();
 	}
 
+	/* call-chain clustering order file, needs nl in address order */
+	cluster();
+
 	/* call frequency order file */
 	qsort(nl, npe - nl, sizeof(nltype),  
 	      (int(*)(const void *, const void *))compare_nl);
@@ -608,6 +844,8 @@ void)
 	    system_fatal("can't create file: callo.order");
 	if((callt = fopen("time.order", "w")) == NULL)
 	    system_fatal("can't create file: time.order");
+	if((clusterf = fopen("cluster.order", "w")) == NULL)
+	    system_fatal("can't create file: cluster.order");
 	/*
 	if((treefile = fopen("gmon.tree", "w")) == NULL)
 	    system_fatal("can't create file: gmon.tree");
@@ -628,6 +866,7 @@ void)
 	fclose(callf);
 	fclose(callo);
 	fclose(callt);
+	fclose(clusterf);
 	if(what_fd >= 0)
 	    close(what_fd);
 }
@@ -26,6 +26,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #import "mach/mach.h"
+#include <stdio.h>
 
 /* user defined (imported) */
 extern char *progname __attribute__((visibility("hidden")));
@@ -34,6 +35,27 @@ extern char *progname __attribute__((visibility("hidden")));
 /* number of detected calls to error() */
 extern uint32_t errors __attribute__((visibility("hidden")));
 
+/*
+ * Where the messages from errors.c, ofile_error.c and vprint() go for the
+ * calling thread.  When diagnostics is NULL, as it is for single threaded
+ * users, they go to stderr and are counted in errors.  Otherwise they go to
+ * diagnostics->stream and are counted in diagnostics->errors, this is used by
+ * ofile_process_parallel() to print them in order with the output.
+ */
+struct diagnostics {
+    FILE *stream;
+    uint32_t errors;
+};
+extern __thread struct diagnostics *diagnostics
+    __attribute__((visibility("hidden")));
+
+extern FILE *diagnostics_stream(
+    void)
+    __attribute__((visibility("hidden")));
+extern void count_error(
+    void)
+    __attribute__((visibility("hidden")));
+
 extern void warning(
     const char *format, ...)
 #ifdef __GNUC__
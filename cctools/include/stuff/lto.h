@@ -5,12 +5,27 @@
 
 #ifdef LTO_SUPPORT
 
+/*
+ * If lto_defer_modules is set is_llvm_bitcode_from_memory() does not create
+ * the lto module for a bit code file but only reads its target triple to set
+ * the arch_flag, and stores LTO_DEFERRED_MODULE through its mod parameter.
+ * The caller creates the module later with lto_create_module(), which can be
+ * called from several threads at once.  lto_free() ignores
+ * LTO_DEFERRED_MODULE.
+ */
+extern int lto_defer_modules __attribute__((visibility("hidden")));
+#define LTO_DEFERRED_MODULE ((void *)-1)
+
 __private_extern__ int is_llvm_bitcode_from_memory(
     char *addr,
     uint32_t size,
     struct arch_flag *arch_flag,
     void **mod); /* maybe NULL */
 
+__private_extern__ void *lto_create_module(
+    char *addr,
+    uint32_t size);
+
 __private_extern__ uint32_t lto_get_nsyms(
     void *mod);
 
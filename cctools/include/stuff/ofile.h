@@ -28,6 +28,7 @@
 #define __private_extern__ __declspec(private_extern)
 #endif
 
+#import <stdio.h>
 #import <ar.h>
 #ifndef AR_EFMT1
 #define	AR_EFMT1	"#1/"		/* extended format #1 */
@@ -157,6 +158,40 @@ __private_extern__ void ofile_process(
     enum bool use_member_syntax,
     void (*processor)(struct ofile *ofile, char *arch_name, void *cookie),
     void *cookie);
+/*
+ * ofile_thread_count() returns the number of threads to use for work done in
+ * parallel, the value of the CCTOOLS_THREADS environment variable or else the
+ * number of online cpus.
+ */
+__private_extern__ uint32_t ofile_thread_count(
+    void);
+/*
+ * ofile_process_parallel() is like calling ofile_process() on each of the
+ * names but the processor is run on nthreads threads (0 meaning the value of
+ * the CCTOOLS_THREADS environment variable or else the number of online cpus).
+ * Each call writes to its own output stream and the output and any warnings
+ * and errors are copied to stdout and stderr in the order the serial
+ * ofile_process() would produce them.
+ */
+__private_extern__ void ofile_process_parallel(
+    char **names,
+    uint32_t nnames,
+    struct arch_flag *arch_flags,
+    uint32_t narch_flags,
+    enum bool all_archs,
+    enum bool process_non_objects,
+    enum bool dylib_flat,
+    enum bool use_member_syntax,
+    void (*processor)(struct ofile *ofile, char *arch_name, void *cookie,
+		      FILE *output),
+    void *cookie,
+    uint32_t nthreads);
+/*
+ * If set ofile_process() calls this instead of ofile_unmap() when it is done
+ * with a file, used by ofile_process_parallel() to keep files mapped.
+ */
+extern void (*ofile_process_unmap_hook)(
+    struct ofile *ofile) __attribute__((visibility("hidden")));
 #ifdef OFI
 __private_extern__ NSObjectFileImageReturnCode ofile_map(
 #else
@@ -241,6 +241,55 @@
 	#define N_ALT_ENTRY 0x0200
 #endif
 
+#ifndef BIND_SPECIAL_DYLIB_WEAK_LOOKUP
+	#define BIND_SPECIAL_DYLIB_WEAK_LOOKUP		-3
+#endif
+
+#ifndef LC_DYLD_CHAINED_FIXUPS
+	#define LC_DYLD_EXPORTS_TRIE	(0x33|LC_REQ_DYLD)	/* used with linkedit_data_command, payload is trie */
+	#define LC_DYLD_CHAINED_FIXUPS	(0x34|LC_REQ_DYLD)	/* used with linkedit_data_command */
+
+	// LC_DYLD_CHAINED_FIXUPS payload starts with a dyld_chained_fixups_header:
+	//		uint32_t fixups_version, starts_offset, imports_offset, symbols_offset, imports_count, imports_format, symbols_format
+	// starts_offset locates a dyld_chained_starts_in_image:
+	//		uint32_t seg_count, seg_info_offset[seg_count]
+	// each non-zero seg_info_offset locates a dyld_chained_starts_in_segment:
+	//		uint32_t size; uint16_t page_size, pointer_format; uint64_t segment_offset;
+	//		uint32_t max_valid_pointer; uint16_t page_count, page_start[page_count]
+	#define DYLD_CHAINED_PTR_START_NONE			0xFFFF
+	#define DYLD_CHAINED_PTR_START_MULTI		0x8000
+	#define DYLD_CHAINED_PTR_START_LAST			0x8000
+
+	#define DYLD_CHAINED_PTR_64					2	// target is vmaddr
+	#define DYLD_CHAINED_PTR_64_OFFSET			6	// target is vm offset from mach_header
+
+	#define DYLD_CHAINED_IMPORT					1	// uint32_t lib_ordinal:8, weak_import:1, name_offset:23
+	#define DYLD_CHAINED_IMPORT_ADDEND			2	// as above, plus int32_t addend
+	#define DYLD_CHAINED_IMPORT_ADDEND64		3	// uint64_t lib_ordinal:16, weak_import:1, reserved:15, name_offset:32, plus uint64_t addend
+
+	#define DYLD_CHAINED_SYMBOL_UNCOMPRESSED	0
+#endif
+
+//
+// Pointers in DYLD_CHAINED_PTR_64 and DYLD_CHAINED_PTR_64_OFFSET chains:
+//		rebase:	uint64_t target:36, high8:8, reserved:7, next:12, bind:0
+//		bind:	uint64_t ordinal:24, addend:8, reserved:19, next:12, bind:1
+// next is the distance to the next pointer in the page in 4-byte strides, 0 for the last one.
+//
+class dyld_chained_ptr_64
+{
+public:
+	static uint64_t		rebase(uint64_t target, uint8_t high8, uint32_t next)	{ return ((uint64_t)(next & 0xFFF) << 51) | ((uint64_t)high8 << 36) | (target & 0xFFFFFFFFFULL); }
+	static uint64_t		bind(uint32_t ordinal, uint8_t addend, uint32_t next)	{ return (1ULL << 63) | ((uint64_t)(next & 0xFFF) << 51) | ((uint64_t)addend << 24) | (ordinal & 0xFFFFFF); }
+
+	static bool			isBind(uint64_t value)			{ return ( (value >> 63) != 0 ); }
+	static uint32_t		next(uint64_t value)			{ return (value >> 51) & 0xFFF; }
+	static uint64_t		rebaseTarget(uint64_t value)	{ return value & 0xFFFFFFFFFULL; }
+	static uint8_t		rebaseHigh8(uint64_t value)		{ return (value >> 36) & 0xFF; }
+	static uint32_t		bindOrdinal(uint64_t value)		{ return value & 0xFFFFFF; }
+	static uint8_t		bindAddend(uint64_t value)		{ return (value >> 24) & 0xFF; }
+};
+
 #ifndef CPU_SUBTYPE_ARM_V7F
   #define CPU_SUBTYPE_ARM_V7F    ((cpu_subtype_t) 10)
 #endif
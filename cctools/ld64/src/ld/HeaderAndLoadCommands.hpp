@@ -110,6 +110,7 @@ private:
 	uint8_t*					copySingleSegmentLoadCommand(uint8_t* p) const;
 	uint8_t*					copySegmentLoadCommands(uint8_t* p, uint8_t* base) const;
 	uint8_t*					copyDyldInfoLoadCommand(uint8_t* p) const;
+	uint8_t*					copyChainedFixupsLoadCommands(uint8_t* p) const;
 	uint8_t*					copySymbolTableLoadCommand(uint8_t* p, uint8_t* base) const;
 	uint8_t*					copyDynamicSymbolTableLoadCommand(uint8_t* p) const;
 	uint8_t*					copyDyldLoadCommand(uint8_t* p) const;
@@ -143,6 +144,7 @@ private:
 	OutputFile&					_writer;
 	pint_t						_address;
 	bool						_hasDyldInfoLoadCommand;
+	bool						_hasChainedFixupsLoadCommands;
 	bool						_hasDyldLoadCommand;
 	bool						_hasDylibIDLoadCommand;
 	bool						_hasThreadLoadCommand;
@@ -191,7 +193,8 @@ HeaderAndLoadCommandsAtom<A>::HeaderAndLoadCommandsAtom(const Options& opts, ld:
 		_options(opts), _state(state), _writer(writer), _address(0), _uuidCmdInOutputBuffer(NULL), _linkeditCmdOffset(0), _symboltableCmdOffset(0)
 {
 	bzero(_uuid, 16);
-	_hasDyldInfoLoadCommand = opts.makeCompressedDyldInfo();
+	_hasDyldInfoLoadCommand = opts.makeCompressedDyldInfo() && !opts.makeChainedFixups();
+	_hasChainedFixupsLoadCommands = opts.makeChainedFixups();
 	_hasDyldLoadCommand = ((opts.outputKind() == Options::kDynamicExecutable) || (_options.outputKind() == Options::kDyld));
 	_hasDylibIDLoadCommand = (opts.outputKind() == Options::kDynamicLibrary);
 	_hasThreadLoadCommand = _options.needsThreadLoadCommand();
@@ -403,6 +406,9 @@ uint64_t HeaderAndLoadCommandsAtom<A>::size() const
 	if ( _hasDyldInfoLoadCommand )
 		sz += sizeof(macho_dyld_info_command<P>);
 	
+	if ( _hasChainedFixupsLoadCommands )
+		sz += 2 * sizeof(macho_linkedit_data_command<P>);
+	
 	if ( _hasSymbolTableLoadCommand )
 		sz += sizeof(macho_symtab_command<P>);
 		
@@ -506,6 +512,9 @@ uint32_t HeaderAndLoadCommandsAtom<A>::commandsCount() const
 	if ( _hasDyldInfoLoadCommand )
 		++count;
 	
+	if ( _hasChainedFixupsLoadCommands )
+		count += 2;
+	
 	if ( _hasSymbolTableLoadCommand )
 		++count;
 		
@@ -1452,6 +1461,25 @@ uint8_t* HeaderAndLoadCommandsAtom<A>::copySubLibraryLoadCommand(uint8_t* p, con
 	return p + sz;
 }
 
+template <typename A>
+uint8_t* HeaderAndLoadCommandsAtom<A>::copyChainedFixupsLoadCommands(uint8_t* p) const
+{
+	macho_linkedit_data_command<P>* cmd = (macho_linkedit_data_command<P>*)p;
+	cmd->set_cmd(LC_DYLD_CHAINED_FIXUPS);
+	cmd->set_cmdsize(sizeof(macho_linkedit_data_command<P>));
+	cmd->set_dataoff(_writer.chainedFixupsSection->fileOffset);
+	cmd->set_datasize(_writer.chainedFixupsSection->size);
+	p += sizeof(macho_linkedit_data_command<P>);
+	
+	cmd = (macho_linkedit_data_command<P>*)p;
+	cmd->set_cmd(LC_DYLD_EXPORTS_TRIE);
+	cmd->set_cmdsize(sizeof(macho_linkedit_data_command<P>));
+	cmd->set_dataoff(_writer.exportSection->fileOffset);
+	cmd->set_datasize(_writer.exportSection->size);
+	return p + sizeof(macho_linkedit_data_command<P>);
+}
+
+
 template <typename A>
 uint8_t* HeaderAndLoadCommandsAtom<A>::copyFunctionStartsLoadCommand(uint8_t* p) const
 {
@@ -1538,6 +1566,9 @@ void HeaderAndLoadCommandsAtom<A>::copyRawContent(uint8_t buffer[]) const
 		
 	if ( _hasDyldInfoLoadCommand )
 		p = this->copyDyldInfoLoadCommand(p);
+
+	if ( _hasChainedFixupsLoadCommands )
+		p = this->copyChainedFixupsLoadCommands(p);
 		
 	if ( _hasSymbolTableLoadCommand )
 		p = this->copySymbolTableLoadCommand(p, buffer);
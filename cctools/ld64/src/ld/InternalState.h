@@ -0,0 +1,106 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-*
+ *
+ * Copyright (c) 2005-2011 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __INTERNAL_STATE_H__
+#define __INTERNAL_STATE_H__
+
+#include <stdint.h>
+
+#include <vector>
+#include <unordered_map>
+
+#include "Options.h"
+#include "ld.hpp"
+
+
+//
+// The linker's ld::Internal: maps input sections to output sections and lays
+// out the sections of the output file.
+//
+class InternalState : public ld::Internal
+{
+public:
+											InternalState(const Options& opts) : _options(opts), _atomsOrderedInSections(false) { }
+	virtual	ld::Internal::FinalSection*		addAtom(const ld::Atom& atom);
+	virtual ld::Internal::FinalSection*		getFinalSection(const ld::Section&);
+			ld::Internal::FinalSection*     getFinalSection(const char* seg, const char* sect, ld::Section::Type type);
+	
+	uint64_t								assignFileOffsets();
+	void									setSectionSizesAndAlignments();
+	void									sortSections();
+	void									markAtomsOrdered() { _atomsOrderedInSections = true; }
+	bool									hasReferenceToWeakExternal(const ld::Atom& atom);
+
+	virtual									~InternalState() {}
+private:
+	bool									inMoveRWChain(const ld::Atom& atom, const char* filePath, const char*& dstSeg, bool& wildCardMatch);
+	bool									inMoveROChain(const ld::Atom& atom, const char* filePath, const char*& dstSeg, bool& wildCardMatch);
+
+	class FinalSection : public ld::Internal::FinalSection 
+	{
+	public:
+									FinalSection(const ld::Section& sect, uint32_t sectionsSeen, const Options&);
+		static int					sectionComparer(const void* l, const void* r);
+		static const ld::Section&	outputSection(const ld::Section& sect, bool mergeZeroFill);
+		static const ld::Section&	objectOutputSection(const ld::Section& sect, const Options&);
+	private:
+		friend class InternalState;
+		static uint32_t		sectionOrder(const ld::Section& sect, uint32_t sectionsSeen, const Options& options);
+		static uint32_t		segmentOrder(const ld::Section& sect, const Options& options);
+		uint32_t			_segmentOrder;
+		uint32_t			_sectionOrder;
+
+		static std::vector<const char*> _s_segmentsSeen;
+		static ld::Section		_s_DATA_data;
+		static ld::Section		_s_DATA_const;
+		static ld::Section		_s_TEXT_text;
+		static ld::Section		_s_TEXT_const;
+		static ld::Section		_s_DATA_nl_symbol_ptr;
+		static ld::Section		_s_DATA_common;
+		static ld::Section		_s_DATA_zerofill;
+		static ld::Section		_s_DATA_DIRTY_data;
+		static ld::Section		_s_DATA_CONST_const;
+	};
+	
+	bool hasZeroForFileOffset(const ld::Section* sect);
+	uint64_t pageAlign(uint64_t addr);
+	uint64_t pageAlign(uint64_t addr, uint64_t pageSize);
+	
+	struct SectionHash {
+		size_t operator()(const ld::Section*) const;
+	};
+	struct SectionEquals {
+		bool operator()(const ld::Section* left, const ld::Section* right) const;
+	};
+	typedef std::unordered_map<const ld::Section*, FinalSection*, SectionHash, SectionEquals> SectionInToOut;
+	
+
+	SectionInToOut			_sectionInToFinalMap;
+	const Options&			_options;
+	bool					_atomsOrderedInSections;
+	std::unordered_map<const ld::Atom*, const char*> _pendingSegMove;
+};
+
+
+#endif // __INTERNAL_STATE_H__
@@ -1076,6 +1076,174 @@ void ExportInfoAtom<A>::encode() const
 }
 
 
+template <typename A>
+class ChainedFixupsAtom : public LinkEditAtom
+{
+public:
+												ChainedFixupsAtom(const Options& opts, ld::Internal& state, OutputFile& writer)
+													: LinkEditAtom(opts, state, writer, _s_section, sizeof(pint_t)) { _encoded = true; }
+
+	// overrides of ld::Atom
+	virtual const char*							name() const		{ return "chained fixups"; }
+	// overrides of LinkEditAtom
+	virtual void								encode() const;
+
+private:
+	typedef typename A::P						P;
+	typedef typename A::P::E					E;
+	typedef typename A::P::uint_t				pint_t;
+
+	void										append16(uint16_t value) const;
+	void										append32(uint32_t value) const;
+	void										append64(uint64_t value) const;
+	void										set32(uint32_t offset, uint32_t value) const;
+
+	static ld::Section			_s_section;
+};
+
+template <typename A>
+ld::Section ChainedFixupsAtom<A>::_s_section("__LINKEDIT", "__chainfixups", ld::Section::typeLinkEdit, true);
+
+template <typename A>
+void ChainedFixupsAtom<A>::append16(uint16_t value) const
+{
+	uint16_t buf;
+	E::set16(buf, value);
+	for (unsigned int i=0; i < sizeof(buf); ++i)
+		this->_encodedData.append_byte(((uint8_t*)&buf)[i]);
+}
+
+template <typename A>
+void ChainedFixupsAtom<A>::append32(uint32_t value) const
+{
+	uint32_t buf;
+	E::set32(buf, value);
+	for (unsigned int i=0; i < sizeof(buf); ++i)
+		this->_encodedData.append_byte(((uint8_t*)&buf)[i]);
+}
+
+template <typename A>
+void ChainedFixupsAtom<A>::append64(uint64_t value) const
+{
+	uint64_t buf;
+	E::set64(buf, value);
+	for (unsigned int i=0; i < sizeof(buf); ++i)
+		this->_encodedData.append_byte(((uint8_t*)&buf)[i]);
+}
+
+template <typename A>
+void ChainedFixupsAtom<A>::set32(uint32_t offset, uint32_t value) const
+{
+	uint32_t buf;
+	E::set32(buf, value);
+	memcpy(&this->_encodedData.bytes()[offset], &buf, sizeof(buf));
+}
+
+template <typename A>
+void ChainedFixupsAtom<A>::encode() const
+{
+	const std::vector<OutputFile::ChainedFixup>& fixups = this->_writer._chainedFixups;
+	const std::vector<OutputFile::ChainedImport>& imports = this->_writer._chainedImports;
+	const std::vector<OutputFile::ChainedSegment>& segments = this->_writer._chainedSegments;
+	const uint32_t pageSize = this->_writer._chainedPageSize;
+	const uint32_t importsFormat = this->_writer._chainedImportsFormat;
+
+	uint64_t mhAddress = 0;
+	for (std::vector<ld::Internal::FinalSection*>::iterator sit = _state.sections.begin(); sit != _state.sections.end(); ++sit) {
+		if ( (*sit)->type() == ld::Section::typeMachHeader ) {
+			mhAddress = (*sit)->address;
+			break;
+		}
+	}
+
+	// dyld_chained_fixups_header, offsets filled in below
+	for (unsigned int i=0; i < 7; ++i)
+		append32(0);
+	this->_encodedData.pad_to_size(8);
+	const uint32_t startsOffset = this->_encodedData.size();
+
+	// dyld_chained_starts_in_image
+	append32(segments.size());
+	for (unsigned int i=0; i < segments.size(); ++i)
+		append32(0);
+
+	// dyld_chained_starts_in_segment for each segment with fixups
+	std::vector<OutputFile::ChainedFixup>::const_iterator fit = fixups.begin();
+	for (uint32_t segIndex=0; segIndex < segments.size(); ++segIndex) {
+		if ( (fit == fixups.end()) || (fit->_segIndex != segIndex) )
+			continue;
+		const uint64_t segStart = segments[segIndex]._start;
+		const uint32_t pageCount = (segments[segIndex]._end - segStart + pageSize - 1) / pageSize;
+		std::vector<uint16_t> pageStarts(pageCount, DYLD_CHAINED_PTR_START_NONE);
+		for ( ; (fit != fixups.end()) && (fit->_segIndex == segIndex); ++fit) {
+			uint32_t pageIndex = (fit->_address - segStart) / pageSize;
+			if ( pageStarts[pageIndex] == DYLD_CHAINED_PTR_START_NONE )
+				pageStarts[pageIndex] = (fit->_address - segStart) % pageSize;
+		}
+		this->_encodedData.pad_to_size(8);
+		set32(startsOffset + 4 + 4*segIndex, this->_encodedData.size() - startsOffset);
+		append32(22 + 2*pageCount);
+		append16(pageSize);
+		append16(DYLD_CHAINED_PTR_64_OFFSET);
+		append64(segStart - mhAddress);
+		append32(0);
+		append16(pageCount);
+		for (std::vector<uint16_t>::iterator pit = pageStarts.begin(); pit != pageStarts.end(); ++pit)
+			append16(*pit);
+	}
+	
+	// symbol names are uniqued, the pool starts with an empty string
+	std::vector<uint32_t> nameOffsets;
+	ByteStream names;
+	names.append_byte('\0');
+	std::unordered_map<const char*, uint32_t, CStringHash, CStringEquals> nameToOffset;
+	for (std::vector<OutputFile::ChainedImport>::const_iterator it = imports.begin(); it != imports.end(); ++it) {
+		std::unordered_map<const char*, uint32_t, CStringHash, CStringEquals>::iterator pos = nameToOffset.find(it->_symbolName);
+		if ( pos == nameToOffset.end() ) {
+			nameToOffset[it->_symbolName] = names.size();
+			nameOffsets.push_back(names.size());
+			names.append_string(it->_symbolName);
+		}
+		else {
+			nameOffsets.push_back(pos->second);
+		}
+	}
+
+	// imports table
+	this->_encodedData.pad_to_size((importsFormat == DYLD_CHAINED_IMPORT_ADDEND64) ? 8 : 4);
+	const uint32_t importsOffset = this->_encodedData.size();
+	for (unsigned int i=0; i < imports.size(); ++i) {
+		const OutputFile::ChainedImport& import = imports[i];
+		uint32_t weakBit = import._weakImport ? 1 : 0;
+		if ( importsFormat == DYLD_CHAINED_IMPORT_ADDEND64 ) {
+			append64(((uint64_t)nameOffsets[i] << 32) | (weakBit << 16) | (uint16_t)import._libraryOrdinal);
+			append64(import._addend);
+		}
+		else {
+			append32((nameOffsets[i] << 9) | (weakBit << 8) | (uint8_t)import._libraryOrdinal);
+		}
+	}
+	
+	// symbol names
+	const uint32_t symbolsOffset = this->_encodedData.size();
+	for (unsigned int i=0; i < names.size(); ++i)
+		this->_encodedData.append_byte(names.start()[i]);
+
+	set32(0, 0);
+	set32(4, startsOffset);
+	set32(8, importsOffset);
+	set32(12, symbolsOffset);
+	set32(16, imports.size());
+	set32(20, importsFormat);
+	set32(24, DYLD_CHAINED_SYMBOL_UNCOMPRESSED);
+
+	// align to pointer size
+	this->_encodedData.pad_to_size(sizeof(pint_t));
+	
+	this->_encoded = true;
+}
+
+
 template <typename A>
 class SplitSegInfoV1Atom : public LinkEditAtom
 {
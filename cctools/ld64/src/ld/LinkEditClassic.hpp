@@ -33,6 +33,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <algorithm>
 
 #include "Options.h"
 #include "ld.hpp"
@@ -86,19 +87,27 @@ public:
 
 	int32_t										add(const char* name);
 	int32_t										addUnique(const char* name);
-	int32_t										emptyString()			{ return 1; }
+	int32_t										emptyString() const		{ return 1; }
 	const char*									stringForIndex(int32_t) const;
 	uint32_t									currentOffset();
+	void										tailMerge(uint32_t& unmergedStart, uint32_t& unmergedEnd);
+	uint32_t									mergedOffset(uint32_t offset) const;
 
 private:
 	enum { kBufferSize = 0x01000000 };
 	typedef std::unordered_map<const char*, int32_t, CStringHash, CStringEquals> StringToOffset;
 
+	void										append(const char* name);
+
 	const uint32_t							_pointerSize;
 	std::vector<char*>						_fullBuffers;
 	char*									_currentBuffer;
 	uint32_t								_currentBufferUsed;
 	StringToOffset							_uniqueStrings;
+	std::vector<uint32_t>					_stringOffsets;		// offset add() returned for each string, ascending
+	std::vector<uint32_t>					_mergedOffsets;		// offset of each string after tailMerge()
+	std::vector<char>						_merged;
+	bool									_isMerged;
 
 	static ld::Section			_s_section;
 };
@@ -108,7 +117,7 @@ ld::Section StringPoolAtom::_s_section("__LINKEDIT", "__string_pool", ld::Sectio
 
 StringPoolAtom::StringPoolAtom(const Options& opts, ld::Internal& state, OutputFile& writer, int pointerSize)
 	: ClassicLinkEditAtom(opts, state, writer, _s_section, pointerSize), 
-	 _pointerSize(pointerSize), _currentBuffer(NULL), _currentBufferUsed(0)
+	 _pointerSize(pointerSize), _currentBuffer(NULL), _currentBufferUsed(0), _isMerged(false)
 {
 	_currentBuffer = new char[kBufferSize];
 	// burn first byte of string pool (so zero is never a valid string offset)
@@ -120,12 +129,21 @@ StringPoolAtom::StringPoolAtom(const Options& opts, ld::Internal& state, OutputF
 uint64_t StringPoolAtom::size() const
 {
 	// pointer size align size
+	if ( _isMerged )
+		return (_merged.size() + _pointerSize-1) & (-_pointerSize);
 	return (kBufferSize * _fullBuffers.size() + _currentBufferUsed + _pointerSize-1) & (-_pointerSize);
 }
 
 void StringPoolAtom::copyRawContent(uint8_t buffer[]) const
 {
 	uint64_t offset = 0;
+	if ( _isMerged ) {
+		memcpy(buffer, &_merged[0], _merged.size());
+		offset = _merged.size();
+		while ( (offset % _pointerSize) != 0 )
+			buffer[offset++] = 0;
+		return;
+	}
 	for (unsigned int i=0; i < _fullBuffers.size(); ++i) {
 		memcpy(&buffer[offset], _fullBuffers[i], kBufferSize);
 		offset += kBufferSize;
@@ -139,7 +157,15 @@ void StringPoolAtom::copyRawContent(uint8_t buffer[]) const
 
 int32_t StringPoolAtom::add(const char* str)
 {
+	assert(!_isMerged);
 	int32_t offset = kBufferSize * _fullBuffers.size() + _currentBufferUsed;
+	_stringOffsets.push_back(offset);
+	this->append(str);
+	return offset;
+}
+
+void StringPoolAtom::append(const char* str)
+{
 	int lenNeeded = strlcpy(&_currentBuffer[_currentBufferUsed], str, kBufferSize-_currentBufferUsed)+1;
 	if ( (_currentBufferUsed+lenNeeded) < kBufferSize ) {
 		_currentBufferUsed += lenNeeded;
@@ -153,9 +179,8 @@ int32_t StringPoolAtom::add(const char* str)
 		_currentBuffer = new char[kBufferSize];
 		_currentBufferUsed = 0;
 		// append rest of string
-		this->add(&str[copied+1]);
+		this->append(&str[copied+1]);
 	}
-	return offset;
 }
 
 uint32_t StringPoolAtom::currentOffset()
@@ -180,6 +205,8 @@ int32_t StringPoolAtom::addUnique(const char* str)
 
 const char* StringPoolAtom::stringForIndex(int32_t index) const
 {
+	if ( _isMerged )
+		return ( (uint32_t)index < _merged.size() ) ? &_merged[index] : "";
 	int32_t currentBufferStartIndex = kBufferSize * _fullBuffers.size();
 	int32_t maxIndex = currentBufferStartIndex + _currentBufferUsed;
 	// check for out of bounds
@@ -194,6 +221,104 @@ const char* StringPoolAtom::stringForIndex(int32_t index) const
 }
 
 
+//
+// Rebuild the pool so that a string which is the tail of another string
+// (e.g. "_foo" and "__ZN3bar3fooE_foo", or the many ObjC and C++ names that share
+// endings) is not stored twice.  Sorting the strings by their reversed text,
+// with longer strings first on ties, puts each string right after a string it
+// may be a tail of.  The strings in [unmergedStart, unmergedEnd), the stabs,
+// are copied unchanged to the end of the pool so they stay out of the UUID, and
+// the range is updated to where they went.  After this, mergedOffset() maps
+// the offsets add() returned to offsets in the merged pool.
+//
+void StringPoolAtom::tailMerge(uint32_t& unmergedStart, uint32_t& unmergedEnd)
+{
+	assert(!_isMerged);
+	// make every string contiguous
+	std::vector<char> pool(currentOffset());
+	uint64_t offset = 0;
+	for (char* buffer : _fullBuffers) {
+		memcpy(&pool[offset], buffer, kBufferSize);
+		offset += kBufferSize;
+		delete [] buffer;
+	}
+	memcpy(&pool[offset], _currentBuffer, _currentBufferUsed);
+	delete [] _currentBuffer;
+	_fullBuffers.clear();
+	_currentBuffer = NULL;
+	_currentBufferUsed = 0;
+
+	const uint32_t count = _stringOffsets.size();
+	std::vector<uint32_t> lengths(count);
+	std::vector<uint32_t> sorted;
+	sorted.reserve(count);
+	for (uint32_t i=0; i < count; ++i) {
+		lengths[i] = strlen(&pool[_stringOffsets[i]]);
+		if ( (_stringOffsets[i] < unmergedStart) || (_stringOffsets[i] >= unmergedEnd) )
+			sorted.push_back(i);
+	}
+	std::sort(sorted.begin(), sorted.end(), [&](uint32_t left, uint32_t right) -> bool {
+		const char* leftStr = &pool[_stringOffsets[left]];
+		const char* rightStr = &pool[_stringOffsets[right]];
+		const uint32_t leftLen = lengths[left];
+		const uint32_t rightLen = lengths[right];
+		for (uint32_t i=1; (i <= leftLen) && (i <= rightLen); ++i) {
+			uint8_t leftChar = leftStr[leftLen-i];
+			uint8_t rightChar = rightStr[rightLen-i];
+			if ( leftChar != rightChar )
+				return (leftChar > rightChar);
+		}
+		return (leftLen > rightLen);
+	});
+
+	_merged.reserve(pool.size());
+	// keep burnt first byte and empty string at offset 1
+	_merged.push_back(' ');
+	_merged.push_back('\0');
+	_mergedOffsets.resize(count);
+	const char* previous = NULL;
+	uint32_t previousLen = 0;
+	uint32_t previousOffset = 0;
+	for (uint32_t index : sorted) {
+		const char* str = &pool[_stringOffsets[index]];
+		const uint32_t len = lengths[index];
+		if ( len == 0 ) {
+			_mergedOffsets[index] = emptyString();
+		}
+		else if ( (previous != NULL) && (previousLen >= len) && (memcmp(&previous[previousLen-len], str, len) == 0) ) {
+			_mergedOffsets[index] = previousOffset + previousLen - len;
+		}
+		else {
+			previous = str;
+			previousLen = len;
+			previousOffset = _merged.size();
+			_merged.insert(_merged.end(), str, str+len+1);
+			_mergedOffsets[index] = previousOffset;
+		}
+	}
+
+	const uint32_t newUnmergedStart = _merged.size();
+	_merged.insert(_merged.end(), pool.begin()+unmergedStart, pool.begin()+unmergedEnd);
+	for (uint32_t i=0; i < count; ++i) {
+		if ( (_stringOffsets[i] >= unmergedStart) && (_stringOffsets[i] < unmergedEnd) )
+			_mergedOffsets[i] = newUnmergedStart + (_stringOffsets[i] - unmergedStart);
+	}
+	unmergedEnd = newUnmergedStart + (unmergedEnd - unmergedStart);
+	unmergedStart = newUnmergedStart;
+	_isMerged = true;
+}
+
+uint32_t StringPoolAtom::mergedOffset(uint32_t offset) const
+{
+	// zero and the empty string do not move
+	if ( !_isMerged || (offset <= (uint32_t)emptyString()) )
+		return offset;
+	std::vector<uint32_t>::const_iterator pos = std::lower_bound(_stringOffsets.begin(), _stringOffsets.end(), offset);
+	assert((pos != _stringOffsets.end()) && (*pos == offset));
+	return _mergedOffsets[pos - _stringOffsets.begin()];
+}
+
+
 
 template <typename A>
 class SymbolTableAtom : public ClassicLinkEditAtom
@@ -722,6 +847,18 @@ void SymbolTableAtom<A>::encode()
 			this->_writer._atomToSymbolIndex[atom] = symbolIndex++;
 	}
 	this->_writer._localSymbolsCount = symbolIndex;
+
+	// all names are in the pool now, share common tails and point the nlists at the merged strings
+	StringPoolAtom* pool = this->_writer._stringPoolAtom;
+	pool->tailMerge(_stabsStringsOffsetStart, _stabsStringsOffsetEnd);
+	for (std::vector<macho_nlist<P> >* symbols : { &_locals, &_globals, &_imports }) {
+		for (macho_nlist<P>& entry : *symbols) {
+			entry.set_n_strx(pool->mergedOffset(entry.n_strx()));
+			// indirect symbols have the string offset of the symbol they alias as value
+			if ( ((entry.n_type() & N_STAB) == 0) && ((entry.n_type() & N_TYPE) == N_INDR) )
+				entry.set_n_value(pool->mergedOffset(entry.n_value()));
+		}
+	}
 }
 
 template <typename A>
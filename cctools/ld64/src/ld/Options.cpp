@@ -32,6 +32,16 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+// ld64-port
+#ifdef __linux__
+#ifndef __USE_GNU
+#define __USE_GNU
+#endif
+#include <sched.h>
+#endif
+// ld64-port end
 #include <spawn.h>
 #include <cxxabi.h>
 #include <Availability.h>
@@ -119,12 +129,47 @@ void throwf(const char* format, ...)
 	throw t;
 }
 
+// number of CPUs this process may run on, used to size worker thread pools
+unsigned int availableCPUs()
+{
+	unsigned int ncpus;
+#ifdef __linux__ // ld64-port
+	cpu_set_t cs;
+	CPU_ZERO(&cs);
+
+	if (!sched_getaffinity(0, sizeof(cs), &cs)) {
+		ncpus = 0;
+
+		for (int i = 0; i < CPU_SETSIZE; i++)
+			if (CPU_ISSET(i, &cs))
+				ncpus++;
+	} else {
+		ncpus = 1;
+	}
+#else
+	int mib[2];
+	size_t len = sizeof(ncpus);
+	mib[0] = CTL_HW;
+	mib[1] = HW_NCPU;
+	if (sysctl(mib, 2, &ncpus, &len, NULL, 0) != 0) {
+		ncpus = 1;
+	}
+#endif
+	return (ncpus != 0) ? ncpus : 1;
+}
+
 
 bool Options::FileInfo::checkFileExists(const Options& options, const char *p)
 {
 	struct stat statBuffer;
 	if (p == NULL) 
 	  p = path;
+	if ( !options.fileMayExist(p) ) {
+		if ( options.dumpDependencyInfo() )
+			options.dumpDependency(Options::depNotFound, p);
+		return false;
+	}
+	options.noteFileSystemProbe();
 	if ( stat(p, &statBuffer) == 0 ) {
 		if (p != path) path = strdup(p);
 		fileLen = statBuffer.st_size;
@@ -137,6 +182,83 @@ bool Options::FileInfo::checkFileExists(const Options& options, const char *p)
     return false;
 }
 
+static pthread_mutex_t sDirectoryListingLock = PTHREAD_MUTEX_INITIALIZER;
+
+void Options::noteFileSystemProbe() const
+{
+	pthread_mutex_lock(&sDirectoryListingLock);
+	++fFileSystemProbes;
+	pthread_mutex_unlock(&sDirectoryListingLock);
+}
+
+// Only directories the linker searches itself are indexed; anything else
+// (explicit paths, install names, @rpath expansions) is just stat()ed.
+bool Options::inSearchDirectory(const std::string& dir) const
+{
+	const std::vector<const char*>* lists[] = { &fLibrarySearchPaths, &fFrameworkSearchPaths, &fSDKPaths };
+	for (const std::vector<const char*>* list : lists) {
+		for (const char* searchDir : *list) {
+			size_t len = strlen(searchDir);
+			while ( (len > 1) && (searchDir[len-1] == '/') )
+				--len;
+			if ( dir.compare(0, len, searchDir, len) != 0 )
+				continue;
+			if ( (dir.size() == len) || (dir[len] == '/') )
+				return true;
+		}
+	}
+	return false;
+}
+
+// Returns false only when the directory index proves path cannot exist.
+// Names are compared case insensitively so a case-insensitive file system
+// never turns a hit into a miss; a false positive just costs the stat().
+bool Options::fileMayExist(const char* path) const
+{
+	const char* lastSlash = strrchr(path, '/');
+	if ( (lastSlash == NULL) || (lastSlash[1] == '\0') )
+		return true;
+	std::string leaf;
+	for (const char* s = &lastSlash[1]; *s != '\0'; ++s) {
+		if ( (*s & 0x80) != 0 )
+			return true;
+		leaf.push_back(tolower(*s));
+	}
+	std::string dir(path, (lastSlash == path) ? 1 : lastSlash - path);
+	if ( !inSearchDirectory(dir) )
+		return true;
+
+	pthread_mutex_lock(&sDirectoryListingLock);
+	DirectoryListing& listing = fDirectoryListings[dir];
+	if ( !listing.indexed && !listing.missing ) {
+		++fFileSystemProbes;
+		DIR* d = ::opendir(dir.c_str());
+		if ( d != NULL ) {
+			while ( struct dirent* entry = ::readdir(d) ) {
+				std::string name;
+				for (const char* s = entry->d_name; *s != '\0'; ++s)
+					name.push_back(tolower((unsigned char)*s));
+				listing.names.insert(name);
+			}
+			::closedir(d);
+			listing.indexed = true;
+			++fDirectoriesIndexed;
+		}
+		else if ( (errno == ENOENT) || (errno == ENOTDIR) ) {
+			listing.missing = true;
+		}
+	}
+	bool result;
+	if ( listing.missing )
+		result = false;
+	else if ( listing.indexed )
+		result = (listing.names.count(leaf) != 0);
+	else
+		result = true;	// could not read directory, let stat() decide
+	pthread_mutex_unlock(&sDirectoryListingLock);
+	return result;
+}
+
 std::vector<std::string> Options::FileInfo::lib_cli_argument() const
 {
 	// fIndirectDylib unused
@@ -202,7 +324,8 @@ Options::Options(int argc, const char* argv[])
 	  fDeadStripDylibs(false),  fAllowTextRelocs(false), fWarnTextRelocs(false), fKextsUseStubs(false),
 	  fUsingLazyDylibLinking(false), fEncryptable(true), fEncryptableForceOn(false), fEncryptableForceOff(false),
 	  fOrderData(true), fMarkDeadStrippableDylib(false),
-	  fMakeCompressedDyldInfo(true), fMakeCompressedDyldInfoForceOff(false), fNoEHLabels(false),
+	  fMakeCompressedDyldInfo(true), fMakeCompressedDyldInfoForceOff(false),
+	  fMakeChainedFixups(false), fMakeChainedFixupsForceOn(false), fMakeChainedFixupsForceOff(false), fNoEHLabels(false),
 	  fAllowCpuSubtypeMismatches(false), fEnforceDylibSubtypesMatch(false), fUseSimplifiedDylibReExports(false),
 	  fObjCABIVersion2Override(false), fObjCABIVersion1Override(false), fCanUseUpwardDylib(false),
 	  fFullyLoadArchives(false), fLoadAllObjcObjectsFromArchives(false), fFlatNamespace(false),
@@ -233,14 +356,14 @@ Options::Options(int argc, const char* argv[])
 	  fSharedRegionEncodingV2(false), fUseDataConstSegment(false),
 	  fUseDataConstSegmentForceOn(false), fUseDataConstSegmentForceOff(false), fUseTextExecSegment(false),
 	  fBundleBitcode(false), fHideSymbols(false), fVerifyBitcode(false),
-	  fReverseMapUUIDRename(false), fDeDupe(true), fVerboseDeDupe(false),
+	  fReverseMapUUIDRename(false), fDeDupe(true), fVerboseDeDupe(false), fDeDupeData(false),
 	  fReverseMapPath(NULL), fLTOCodegenOnly(false),
 	  fIgnoreAutoLink(false), fAllowDeadDups(false), fAllowWeakImports(true), fBitcodeKind(kBitcodeProcess),
 	  fPlatform(kPlatformUnknown), fDebugInfoStripping(kDebugInfoMinimal), fTraceOutputFile(NULL),
 	  fMacVersionMin(ld::macVersionUnset), fIOSVersionMin(ld::iOSVersionUnset), fWatchOSVersionMin(ld::wOSVersionUnset),
 	  fSaveTempFiles(false), fSnapshotRequested(false), fPipelineFifo(NULL),
 	  fDependencyInfoPath(NULL), fDependencyFileDescriptor(-1), fMaxDefaultCommonAlign(0),
-	  fDumpNormalizedLibArgs(false)
+	  fDumpNormalizedLibArgs(false), fFileSystemProbes(0), fDirectoriesIndexed(0)
 {
 	this->checkForClassic(argc, argv);
 	this->parsePreCommandLineEnvironmentSettings();
@@ -248,6 +371,7 @@ Options::Options(int argc, const char* argv[])
 	this->parsePostCommandLineEnvironmentSettings();
 	this->reconfigureDefaults();
 	this->checkIllegalOptionCombinations();
+	this->compileSymbolLists();
 	
 	if ( this->dumpDependencyInfo() ) {
 		this->dumpDependency(depOutputFile, fOutputFile);
@@ -1181,148 +1305,28 @@ void Options::loadFileList(const char* fileOfPaths, ld::File::Ordinal baseOrdina
 }
 
 
-void Options::SetWithWildcards::remove(const NameSet& toBeRemoved)
-{
-	for(NameSet::const_iterator it=toBeRemoved.begin(); it != toBeRemoved.end(); ++it) {
-		const char* symbolName = *it;
-		NameSet::iterator pos = fRegular.find(symbolName);
-		if ( pos != fRegular.end() )
-			fRegular.erase(pos);
-	}
-}
-
-bool Options::SetWithWildcards::hasWildCards(const char* symbol) 
-{
-	// an exported symbol name containing *, ?, or [ requires wildcard matching
-	return ( strpbrk(symbol, "*?[") != NULL );
-}
-
-void Options::SetWithWildcards::insert(const char* symbol)
-{
-	if ( hasWildCards(symbol) )
-		fWildCard.push_back(symbol);
-	else
-		fRegular.insert(symbol);
-}
-
-bool Options::SetWithWildcards::contains(const char* symbol, bool* matchBecauseOfWildcard) const
-{
-	if ( matchBecauseOfWildcard != NULL )
-		*matchBecauseOfWildcard = false;
-	// first look at hash table on non-wildcard symbols
-	if ( fRegular.find(symbol) != fRegular.end() )
-		return true;
-	// next walk list of wild card symbols looking for a match
-	for(std::vector<const char*>::const_iterator it = fWildCard.begin(); it != fWildCard.end(); ++it) {
-		if ( wildCardMatch(*it, symbol) ) {
-			if ( matchBecauseOfWildcard != NULL )
-				*matchBecauseOfWildcard = true;
-			return true;
-		}
-	}
-	return false;
-}
-
-// Support "foo.o:_bar" to mean symbol _bar in file foo.o
-bool Options::SetWithWildcards::containsWithPrefix(const char* symbol, const char* file, bool& wildCardMatch) const
-{
-	wildCardMatch = false;
-	if ( contains(symbol, &wildCardMatch) )
-		return true;
-	if ( file == NULL )
-		return false;
-	const char* s = strrchr(file, '/');
-	if ( s != NULL )
-		file = s+1;
-	char buff[strlen(file)+strlen(symbol)+2];
-	sprintf(buff, "%s:%s", file, symbol);
-	return contains(buff, &wildCardMatch);
-}
-
-bool Options::SetWithWildcards::containsNonWildcard(const char* symbol) const
-{
-	// look at hash table on non-wildcard symbols
-	return ( fRegular.find(symbol) != fRegular.end() );
-}
-
-
 std::vector<const char*> Options::exportsData() const
 {
 	return fExportSymbols.data();
 }
 
 
-std::vector<const char*> Options::SetWithWildcards::data() const
+void Options::compileSymbolLists()
 {
-	std::vector<const char*> data;
-	for (NameSet::const_iterator it=regularBegin(); it != regularEnd(); ++it) { // ld64-port: NameSet::iterator -> NameSet::const_iterator
-		data.push_back(*it);
-	}
-	for (std::vector<const char*>::const_iterator it=fWildCard.begin(); it != fWildCard.end(); ++it) {
-		data.push_back(*it);
-	}
-	return data;
-}
-
-bool Options::SetWithWildcards::inCharRange(const char*& p, unsigned char c) const
-{
-	++p; // find end
-	const char* b = p;
-	while ( *p != '\0' ) {
-		if ( *p == ']') {
-			const char* e = p;
-			// found beginining [ and ending ]
-			unsigned char last = '\0';
-			for ( const char* s = b; s < e; ++s ) {
-				if ( *s == '-' ) {
-					unsigned char next = *(++s);
-					if ( (last <= c) && (c <= next) )
-						return true;
-					++s;
-				}
-				else {
-					if ( *s == c )
-						return true;
-					last = *s;
-				}
-			}
-			return false;
-		}
-		++p;
-	}
-	return false;
-}
-
-bool Options::SetWithWildcards::wildCardMatch(const char* pattern, const char* symbol) const
-{
-	const char* s = symbol;
-	for (const char* p = pattern; *p != '\0'; ++p) {
-		switch ( *p ) {
-			case '*':
-				if ( p[1] == '\0' )
-					return true;
-				for (const char* t = s; *t != '\0'; ++t) {
-					if ( wildCardMatch(&p[1], t) )
-						return true;
-				}
-				return false;
-			case '?':
-				if ( *s == '\0' )
-					return false;
-				++s;
-				break;
-			case '[':
-				if ( ! inCharRange(p, *s) )
-					return false;
-				++s;
-				break;
-			default:
-				if ( *s != *p )
-					return false;
-				++s;
-		}
-	}
-	return (*s == '\0');
+	fExportSymbols.compile();
+	fDontExportSymbols.compile();
+	fInterposeList.compile();
+	fForceWeakSymbols.compile();
+	fForceNotWeakSymbols.compile();
+	fReExportSymbols.compile();
+	fForceCoalesceSymbols.compile();
+	fLocalSymbolsIncluded.compile();
+	fLocalSymbolsExcluded.compile();
+	fWhyLive.compile();
+	for (std::vector<SymbolsMove>::iterator it=fSymbolsMovesData.begin(); it != fSymbolsMovesData.end(); ++it)
+		it->symbols.compile();
+	for (std::vector<SymbolsMove>::iterator it=fSymbolsMovesCode.begin(); it != fSymbolsMovesCode.end(); ++it)
+		it->symbols.compile();
 }
 
 
@@ -1948,6 +1952,65 @@ void Options::parseOrderFile(const char* path, bool cstring)
 	// Note: we do not free() the malloc buffer, because the strings are used by the fOrderedSymbols
 }
 
+//
+// A call graph profile is a text file with one "caller callee count" line per
+// call graph edge.  Lines starting with a # are comments.
+//
+void Options::parseCallGraphProfile(const char* path)
+{
+	// read in whole file
+	int fd = ::open(path, O_RDONLY, 0);
+	if ( fd == -1 )
+		throwf("can't open call graph profile: %s", path);
+	struct stat stat_buf;
+	::fstat(fd, &stat_buf);
+	char* p = (char*)malloc(stat_buf.st_size+1);
+	if ( p == NULL )
+		throwf("can't process call graph profile: %s", path);
+	if ( read(fd, p, stat_buf.st_size) != stat_buf.st_size )
+		throwf("can't read call graph profile: %s", path);
+	::close(fd);
+	p[stat_buf.st_size] = '\0';
+	if ( this->dumpDependencyInfo() )
+		this->dumpDependency(Options::depMisc, path);
+
+	unsigned int lineNumber = 0;
+	for (char* line = p; line != NULL; ) {
+		char* nextLine = strchr(line, '\n');
+		if ( nextLine != NULL )
+			*nextLine++ = '\0';
+		++lineNumber;
+		char* comment = strchr(line, '#');
+		if ( comment != NULL )
+			*comment = '\0';
+		char* fields[3];
+		int fieldCount = 0;
+		for (char* s = line; *s != '\0'; ) {
+			while ( isspace(*s) )
+				*s++ = '\0';
+			if ( *s == '\0' )
+				break;
+			if ( fieldCount == 3 )
+				throwf("malformed call graph profile %s line %u: expected 'caller callee count'", path, lineNumber);
+			fields[fieldCount++] = s;
+			while ( (*s != '\0') && !isspace(*s) )
+				++s;
+		}
+		if ( fieldCount != 0 ) {
+			char* countEnd;
+			Options::CallGraphEdge edge;
+			edge.caller = fields[0];
+			edge.callee = (fieldCount > 1) ? fields[1] : NULL;
+			edge.count = (fieldCount > 2) ? strtoull(fields[2], &countEnd, 10) : 0;
+			if ( (fieldCount != 3) || (*countEnd != '\0') )
+				throwf("malformed call graph profile %s line %u: expected 'caller callee count'", path, lineNumber);
+			fCallGraphProfile.push_back(edge);
+		}
+		line = nextLine;
+	}
+	// Note: we do not free() the malloc buffer, because the strings are used by fCallGraphProfile
+}
+
 void Options::parseSectionOrderFile(const char* segment, const char* section, const char* path)
 {
 	if ( (strcmp(section, "__cstring") == 0) && (strcmp(segment, "__TEXT") == 0) ) {
@@ -2593,6 +2656,14 @@ void Options::parse(int argc, const char* argv[])
                 snapshotFileArgIndex = 1;
 				parseOrderFile(argv[++i], false);
 			}
+			else if ( strcmp(arg, "-call_graph_profile") == 0 ) {
+				snapshotFileArgIndex = 1;
+				const char* path = argv[++i];
+				if ( path == NULL )
+					throw "missing argument to -call_graph_profile";
+				parseCallGraphProfile(path);
+				cannotBeUsedWithBitcode(arg);
+			}
 			else if ( strcmp(arg, "-order_file_statistics") == 0 ) {
 				fPrintOrderFileStatistics = true;
 				cannotBeUsedWithBitcode(arg);
@@ -3580,6 +3651,14 @@ void Options::parse(int argc, const char* argv[])
 				fFunctionStartsForcedOn = true;
 				fFunctionStartsForcedOff = false;
 			}
+			else if ( strcmp(arg, "-fixup_chains") == 0 ) {
+				fMakeChainedFixupsForceOn = true;
+				fMakeChainedFixupsForceOff = false;
+			}
+			else if ( strcmp(arg, "-no_fixup_chains") == 0 ) {
+				fMakeChainedFixupsForceOff = true;
+				fMakeChainedFixupsForceOn = false;
+			}
 			else if ( strcmp(arg, "-no_function_starts") == 0 ) {
 				fFunctionStartsForcedOff = true;
 				fFunctionStartsForcedOn = false;
@@ -3891,6 +3970,9 @@ void Options::parse(int argc, const char* argv[])
 			else if ( strcmp(arg, "-verbose_deduplicate") == 0 ) {
 				fVerboseDeDupe = true;
 			}
+			else if ( strcmp(arg, "-deduplicate_data") == 0 ) {
+				fDeDupeData = true;
+			}
 			else if ( strcmp(arg, "-max_default_common_align") == 0 ) {
 				const char* alignStr = argv[++i];
 				if ( alignStr == NULL )
@@ -4848,6 +4930,36 @@ void Options::reconfigureDefaults()
 			fMakeCompressedDyldInfo = false;
 	}
 
+	// use chained fixups instead of rebase/bind opcodes only when -fixup_chains is used.
+	// They are not the default for any OS version because resolver functions, text relocations,
+	// unaligned pointers and overrides of weak definitions in dylibs can't be represented.
+	// Only the 64-bit pointer formats are supported.
+	if ( fMakeCompressedDyldInfo && !fMakeChainedFixupsForceOff )
+		fMakeChainedFixups = fMakeChainedFixupsForceOn;
+	if ( fMakeChainedFixups ) {
+		const char* reason = NULL;
+		switch ( fArchitecture ) {
+			case CPU_TYPE_X86_64:
+			case CPU_TYPE_ARM64:
+				break;
+			default:
+				reason = "only supported for x86_64 and arm64";
+				break;
+		}
+		if ( fUsingLazyDylibLinking )
+			reason = "not supported with -lazy_library";
+		if ( fPrebind )
+			reason = "not supported with -prebind";
+		if ( reason != NULL ) {
+			if ( fMakeChainedFixupsForceOn )
+				warning("-fixup_chains ignored, chained fixups are %s", reason);
+			fMakeChainedFixups = false;
+		}
+	}
+	else if ( fMakeChainedFixupsForceOn ) {
+		warning("-fixup_chains ignored, chained fixups can only be used in final linked images that use compressed dyld info");
+	}
+
 	// only ARM and x86_64 enforces that cpu-sub-types must match
 	switch ( fArchitecture ) {
 		case CPU_TYPE_ARM:
@@ -30,6 +30,8 @@
 #include <mach/machine.h>
 
 #include <vector>
+#include <map>
+#include <bitset>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -39,6 +41,7 @@
 
 extern void throwf (const char* format, ...) __attribute__ ((noreturn,format(printf, 1, 2)));
 extern void warning(const char* format, ...) __attribute__((format(printf, 1, 2)));
+extern unsigned int availableCPUs();
 
 class Snapshot;
 
@@ -209,6 +212,12 @@ public:
 	};
 	typedef const OrderedSymbol*	OrderedSymbolsIterator;
 
+	struct CallGraphEdge {
+		const char*				caller;
+		const char*				callee;
+		uint64_t				count;
+	};
+
 	struct SegmentStart {
 		const char*				name;
 		uint64_t				address;
@@ -336,6 +345,10 @@ public:
 	bool						warnStabs();
 	bool						pauseAtEnd() { return fPause; }
 	bool						printStatistics() const { return fStatistics; }
+	bool						fileMayExist(const char* path) const;
+	void						noteFileSystemProbe() const;
+	uint64_t					fileSystemProbes() const { return fFileSystemProbes; }
+	uint32_t					directoriesIndexed() const { return fDirectoriesIndexed; }
 	bool						printArchPrefix() const { return fMessagesPrefixedWithArchitecture; }
 	void						gotoClassicLinker(int argc, const char* argv[]);
 	bool						sharedRegionEligible() const { return fSharedRegionEligible; }
@@ -345,6 +358,7 @@ public:
 	unsigned long				orderedSymbolsCount() const { return fOrderedSymbols.size(); }
 	OrderedSymbolsIterator		orderedSymbolsBegin() const { return &fOrderedSymbols[0]; }
 	OrderedSymbolsIterator		orderedSymbolsEnd() const { return &fOrderedSymbols[fOrderedSymbols.size()]; }
+	const std::vector<CallGraphEdge>&	callGraphProfile() const { return fCallGraphProfile; }
 	bool						splitSeg() const { return fSplitSegs; }
 	uint64_t					baseWritableAddress() { return fBaseWritableAddress; }
 	uint64_t					segmentAlignment() const { return fSegmentAlignment; }
@@ -381,6 +395,7 @@ public:
 	const std::vector<const char*>&	dyldEnvironExtras() const{ return fDyldEnvironExtras; }
 	const std::vector<const char*>&	astFilePaths() const{ return fASTFilePaths; }
 	bool						makeCompressedDyldInfo() const { return fMakeCompressedDyldInfo; }
+	bool						makeChainedFixups() const { return fMakeChainedFixups; }
 	bool						hasExportedSymbolOrder();
 	bool						exportedSymbolOrder(const char* sym, unsigned int* order) const;
 	bool						orderData() { return fOrderData; }
@@ -440,6 +455,7 @@ public:
 	bool						renameReverseSymbolMap() const { return fReverseMapUUIDRename; }
 	bool						deduplicateFunctions() const { return fDeDupe; }
 	bool						verboseDeduplicate() const { return fVerboseDeDupe; }
+	bool						deduplicateData() const { return fDeDupeData; }
 	const char*					reverseSymbolMapPath() const { return fReverseMapPath; }
 	std::string					reverseMapTempPath() const { return fReverseMapTempPath; }
 	bool						ltoCodegenOnly() const { return fLTOCodegenOnly; }
@@ -499,8 +515,11 @@ private:
 	enum LibrarySearchMode { kSearchDylibAndArchiveInEachDir, kSearchAllDirsForDylibsThenAllDirsForArchives };
 	enum InterposeMode { kInterposeNone, kInterposeAllExternal, kInterposeSome };
 
+public:
+	// symbol lists from -exported_symbol and friends, public so src/other/wildcardtest can use it
 	class SetWithWildcards {
 	public:
+								SetWithWildcards() : fCompiled(false), fDFAComplete(false) {}
 		void					insert(const char*);
 		bool					contains(const char*, bool* wildCardMatch=NULL) const;
 		bool					containsWithPrefix(const char* symbol, const char* file, bool& wildCardMatch) const;
@@ -511,20 +530,71 @@ private:
 		NameSet::const_iterator		regularEnd() const		{ return fRegular.end(); }      // ld64-port: NameSet::iterator -> NameSet::const_iterator
 		void					remove(const NameSet&); 
 		std::vector<const char*>		data() const;
+		void					compile();
 	private:
+		// wildcard patterns are compiled into a trie of the "prefix*" patterns
+		// and a DFA over the positions of all other patterns, built in full by
+		// compile() when small enough, otherwise lazily under a lock
+		enum ElementKind { kLiteral, kAnyChar, kCharClass, kStar, kEnd };
+		struct Element {
+								Element(ElementKind k, unsigned char ch=0, uint32_t ci=0) : kind(k), c(ch), classIndex(ci) {}
+			ElementKind			kind;
+			unsigned char		c;
+			uint32_t			classIndex;
+		};
+		struct PrefixNode {
+								PrefixNode(unsigned char ch) : firstChild(0), nextSibling(0), c(ch), terminal(false) {}
+			uint32_t			firstChild;
+			uint32_t			nextSibling;
+			unsigned char		c;
+			bool				terminal;
+		};
+		typedef std::vector<uint32_t> Positions;
+
 		static bool				hasWildCards(const char*);
 		bool					wildCardMatch(const char* pattern, const char* candidate) const;
 		bool					inCharRange(const char*& range, unsigned char c) const;
+		void					addPrefix(const char* prefix, size_t length);
+		void					addPattern(const char* pattern);
+		bool					prefixMatch(const char* symbol) const;
+		bool					automatonMatch(const char* symbol) const;
+		void					addPosition(uint32_t position, Positions& positions) const;
+		void					step(const Positions& from, unsigned char c, Positions& to) const;
+		bool					accepts(const Positions& positions) const;
+		uint32_t				dfaState(const Positions& positions) const;
+		uint32_t				dfaTransition(uint32_t state, unsigned char c) const;
+		bool					buildDFA();
+		void					resetDFA() const;
 
 		NameSet							fRegular;
 		std::vector<const char*>		fWildCard;
+		bool							fCompiled;
+		std::vector<PrefixNode>			fPrefixTrie;
+		std::vector<Element>			fElements;
+		std::vector<std::bitset<256> >	fCharClasses;
+		Positions						fStartPositions;
+		bool							fDFAComplete;
+		mutable std::vector<Positions>			fDFAStates;
+		mutable std::vector<bool>				fDFAAccepts;
+		mutable std::vector<uint32_t>			fDFATransitions;
+		mutable std::map<Positions, uint32_t>	fDFAStateIndex;
 	};
 
+private:
 	struct SymbolsMove {
 		const char*			toSegment;
 		SetWithWildcards	symbols;
 	};
 
+	// Names found in one -L/-F/-syslibroot directory, read once so that the
+	// many candidate paths tried while searching do not each cost a stat().
+	struct DirectoryListing {
+						DirectoryListing() : indexed(false), missing(false) {}
+		bool							indexed;
+		bool							missing;
+		std::unordered_set<std::string>	names;		// lowercased
+	};
+
 	void						parse(int argc, const char* argv[]);
 	void						checkIllegalOptionCombinations();
 	void						buildSearchPaths(int argc, const char* argv[]);
@@ -532,17 +602,20 @@ private:
 	FileInfo					findFramework(const char* rootName, const char* suffix) const;
 	bool						checkForFile(const char* format, const char* dir, const char* rootName,
 											 FileInfo& result) const;
+	bool						inSearchDirectory(const std::string& dir) const;
 	uint64_t					parseVersionNumber64(const char*);
 	std::string					getVersionString32(uint32_t ver) const;
 	std::string					getVersionString64(uint64_t ver) const;
 	bool						parsePackedVersion32(const std::string& versionStr, uint32_t &result);
 	void						parseSectionOrderFile(const char* segment, const char* section, const char* path);
 	void						parseOrderFile(const char* path, bool cstring);
+	void						parseCallGraphProfile(const char* path);
 	void						addSection(const char* segment, const char* section, const char* path);
 	void						addSubLibrary(const char* name);
 	void						loadFileList(const char* fileOfPaths, ld::File::Ordinal baseOrdinal);
 	uint64_t					parseAddress(const char* addr);
 	void						loadExportFile(const char* fileOfExports, const char* option, SetWithWildcards& set);
+	void						compileSymbolLists();
 	void						parseAliasFile(const char* fileOfAliases);
 	void						parsePreCommandLineEnvironmentSettings();
 	void						parsePostCommandLineEnvironmentSettings();
@@ -674,6 +747,9 @@ private:
 	bool								fMarkDeadStrippableDylib;
 	bool								fMakeCompressedDyldInfo;
 	bool								fMakeCompressedDyldInfoForceOff;
+	bool								fMakeChainedFixups;
+	bool								fMakeChainedFixupsForceOn;
+	bool								fMakeChainedFixupsForceOff;
 	bool								fNoEHLabels;
 	bool								fAllowCpuSubtypeMismatches;
 	bool								fEnforceDylibSubtypesMatch;
@@ -757,6 +833,7 @@ private:
 	bool								fReverseMapUUIDRename;
 	bool								fDeDupe;
 	bool								fVerboseDeDupe;
+	bool								fDeDupeData;
 	const char*							fReverseMapPath;
 	std::string							fReverseMapTempPath;
 	bool								fLTOCodegenOnly;
@@ -777,6 +854,7 @@ private:
 	std::vector<ExtraSection>			fExtraSections;
 	std::vector<SectionAlignment>		fSectionAlignments;
 	std::vector<OrderedSymbol>			fOrderedSymbols;
+	std::vector<CallGraphEdge>			fCallGraphProfile;
 	std::vector<SegmentStart>			fCustomSegmentAddresses;
 	std::vector<SegmentSize>			fCustomSegmentSizes;
 	std::vector<SegmentProtect>			fCustomSegmentProtections;
@@ -802,6 +880,9 @@ private:
 	mutable int							fDependencyFileDescriptor;
 	uint8_t								fMaxDefaultCommonAlign;
 	bool								fDumpNormalizedLibArgs;
+	mutable std::unordered_map<std::string, DirectoryListing>	fDirectoryListings;
+	mutable uint64_t					fFileSystemProbes;
+	mutable uint32_t					fDirectoriesIndexed;
 };
 
 
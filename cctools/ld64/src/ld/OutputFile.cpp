@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <mach/mach_time.h>
 #include <mach/vm_statistics.h>
 #include <mach/mach_init.h>
@@ -85,7 +86,7 @@ OutputFile::OutputFile(const Options& opts)
 		_noReExportedDylibs(false), pieDisabled(false), hasDataInCode(false), 
 		headerAndLoadCommandsSection(NULL),
 		rebaseSection(NULL), bindingSection(NULL), weakBindingSection(NULL), 
-		lazyBindingSection(NULL), exportSection(NULL), 
+		lazyBindingSection(NULL), exportSection(NULL), chainedFixupsSection(NULL),
 		splitSegInfoSection(NULL), functionStartsSection(NULL), 
 		dataInCodeSection(NULL), optimizationHintsSection(NULL),
 		symbolTableSection(NULL), stringPoolSection(NULL), 
@@ -105,12 +106,16 @@ OutputFile::OutputFile(const Options& opts)
 		_hasOptimizationHints(opts.outputKind() == Options::kObjectFile),
 		_encryptedTEXTstartOffset(0),
 		_encryptedTEXTendOffset(0),
+		_debugNotesState(NULL),
+		_debugNotesPending(false),
 		_localSymbolsStartIndex(0),
 		_localSymbolsCount(0),
 		_globalSymbolsStartIndex(0),
 		_globalSymbolsCount(0),
 		_importSymbolsStartIndex(0),
 		_importSymbolsCount(0),
+		_chainedImportsFormat(0),
+		_chainedPageSize(0),
 		_sectionsRelocationsAtom(NULL),
 		_localRelocsAtom(NULL),
 		_externalRelocsAtom(NULL),
@@ -121,6 +126,7 @@ OutputFile::OutputFile(const Options& opts)
 		_lazyBindingInfoAtom(NULL),
 		_weakBindingInfoAtom(NULL),
 		_exportInfoAtom(NULL),
+		_chainedFixupsAtom(NULL),
 		_splitSegInfoAtom(NULL),
 		_functionStartsAtom(NULL),
 		_dataInCodeAtom(NULL),
@@ -159,6 +165,8 @@ void OutputFile::write(ld::Internal& state)
 	this->synthesizeDebugNotes(state);
 	this->buildSymbolTable(state);
 	this->generateLinkEditInfo(state);
+	if ( _options.makeChainedFixups() )
+		this->makeChainedFixups(state);
 	if ( _options.sharedRegionEncodingV2() )
 		this->makeSplitSegInfoV2(state);
 	else
@@ -196,6 +204,139 @@ bool OutputFile::findSegment(ld::Internal& state, uint64_t addr, uint64_t* start
 }
 
 
+struct ChainedImportOrder
+{
+	bool operator()(const OutputFile::ChainedImport& left, const OutputFile::ChainedImport& right) const
+	{
+		if ( left._libraryOrdinal != right._libraryOrdinal )
+			return ( left._libraryOrdinal < right._libraryOrdinal );
+		if ( left._symbolName != right._symbolName ) {
+			int cmp = strcmp(left._symbolName, right._symbolName);
+			if ( cmp != 0 )
+				return ( cmp < 0 );
+		}
+		if ( left._weakImport != right._weakImport )
+			return right._weakImport;
+		return ( left._addend < right._addend );
+	}
+};
+
+void OutputFile::makeChainedFixups(ld::Internal& state)
+{
+	// one entry per segment, in load command order
+	const char* lastSegName = "";
+	for (std::vector<ld::Internal::FinalSection*>::iterator it = state.sections.begin(); it != state.sections.end(); ++it) {
+		ld::Internal::FinalSection* sect = *it;
+		if ( strcmp(lastSegName, sect->segmentName()) != 0 ) {
+			lastSegName = sect->segmentName();
+			_chainedSegments.push_back(ChainedSegment(sect->address, sect->address+sect->size));
+		}
+		else {
+			_chainedSegments.back()._end = sect->address+sect->size;
+		}
+	}
+	_chainedPageSize = (_options.architecture() == CPU_TYPE_ARM64) ? 0x4000 : 0x1000;
+
+	// the small import format has 8-bit ordinals, 23-bit name offsets and
+	// puts 8-bit addends in the pointer, anything else needs 64-bit addends in the import
+	bool needAddends = false;
+	uint64_t namesSize = 1;
+	for (std::vector<BindingInfo>::iterator it = _bindingInfo.begin(); it != _bindingInfo.end(); ++it) {
+		if ( it->_type != BIND_TYPE_POINTER )
+			throwf("unsupported bind type %d to %s with chained fixups", it->_type, it->_symbolName);
+		if ( (it->_addend < 0) || (it->_addend > 255) || (it->_libraryOrdinal > 240) )
+			needAddends = true;
+		namesSize += strlen(it->_symbolName) + 1;
+	}
+	if ( namesSize > 0x7FFFFF )
+		needAddends = true;
+	_chainedImportsFormat = needAddends ? DYLD_CHAINED_IMPORT_ADDEND64 : DYLD_CHAINED_IMPORT;
+
+	uint64_t segStart;
+	uint64_t segEnd;
+	uint32_t segIndex;
+	std::map<ChainedImport, uint32_t, ChainedImportOrder> importToIndex;
+	std::sort(_bindingInfo.begin(), _bindingInfo.end());
+	for (std::vector<BindingInfo>::iterator it = _bindingInfo.begin(); it != _bindingInfo.end(); ++it) {
+		ChainedImport import(it->_libraryOrdinal, it->_symbolName, ((it->_flags & BIND_SYMBOL_FLAGS_WEAK_IMPORT) != 0), 
+							needAddends ? it->_addend : 0);
+		std::map<ChainedImport, uint32_t, ChainedImportOrder>::iterator pos = importToIndex.find(import);
+		uint32_t importIndex;
+		if ( pos == importToIndex.end() ) {
+			importIndex = _chainedImports.size();
+			importToIndex[import] = importIndex;
+			_chainedImports.push_back(import);
+		}
+		else {
+			importIndex = pos->second;
+		}
+		if ( !this->findSegment(state, it->_address, &segStart, &segEnd, &segIndex) )
+			throwf("binding address 0x%08llX to %s outside any segment", it->_address, it->_symbolName);
+		_chainedFixups.push_back(ChainedFixup(it->_address, segIndex, true, importIndex, needAddends ? 0 : it->_addend));
+	}
+	if ( _chainedImports.size() > 0xFFFFFF )
+		throwf("too many imports (%lu) for chained fixups", _chainedImports.size());
+
+	for (std::vector<RebaseInfo>::iterator it = _rebaseInfo.begin(); it != _rebaseInfo.end(); ++it) {
+		if ( it->_type != REBASE_TYPE_POINTER )
+			throwf("unsupported rebase type %d at 0x%08llX with chained fixups", it->_type, it->_address);
+		if ( !this->findSegment(state, it->_address, &segStart, &segEnd, &segIndex) )
+			throwf("rebase address 0x%08llX outside any segment", it->_address);
+		_chainedFixups.push_back(ChainedFixup(it->_address, segIndex, false, 0, 0));
+	}
+
+	// chains link pointers 4-byte strides apart
+	std::sort(_chainedFixups.begin(), _chainedFixups.end());
+	for (std::vector<ChainedFixup>::iterator it = _chainedFixups.begin(); it != _chainedFixups.end(); ++it) {
+		if ( (it->_address & 3) != 0 )
+			throwf("pointer at 0x%08llX is not 4-byte aligned and can't be used with chained fixups, link without -fixup_chains", it->_address);
+	}
+}
+
+void OutputFile::writeChainedFixups(ld::Internal& state, uint64_t mhAddress, uint8_t* wholeBuffer)
+{
+	ld::Internal::FinalSection* sect = NULL;
+	for (std::vector<ChainedFixup>::iterator it = _chainedFixups.begin(); it != _chainedFixups.end(); ++it) {
+		if ( (sect == NULL) || (it->_address < sect->address) || (it->_address >= sect->address+sect->size) ) {
+			sect = NULL;
+			for (std::vector<ld::Internal::FinalSection*>::iterator sit = state.sections.begin(); sit != state.sections.end(); ++sit) {
+				ld::Internal::FinalSection* s = *sit;
+				if ( (s->address <= it->_address) && (it->_address < s->address+s->size) && !takesNoDiskSpace(s) ) {
+					sect = s;
+					break;
+				}
+			}
+			if ( sect == NULL )
+				throwf("chained fixup at 0x%08llX is not in a section with content", it->_address);
+		}
+		uint8_t* fixUpLocation = &wholeBuffer[it->_address - sect->address + sect->fileOffset];
+		
+		// next pointer in the same page, in 4-byte strides
+		uint64_t next = 0;
+		std::vector<ChainedFixup>::iterator nextIt = it + 1;
+		if ( (nextIt != _chainedFixups.end()) && (nextIt->_segIndex == it->_segIndex) ) {
+			uint64_t segStart = _chainedSegments[it->_segIndex]._start;
+			if ( ((nextIt->_address - segStart) / _chainedPageSize) == ((it->_address - segStart) / _chainedPageSize) )
+				next = (nextIt->_address - it->_address) / 4;
+		}
+		
+		uint64_t value;
+		if ( it->_bind ) {
+			value = dyld_chained_ptr_64::bind(it->_importIndex, it->_addend, next);
+		}
+		else {
+			// applyFixUps() stored the unslid target address, the top byte is kept separately
+			uint64_t target = get64LE(fixUpLocation);
+			uint64_t offset = (target & 0x00FFFFFFFFFFFFFFULL) - mhAddress;
+			if ( offset >= (1ULL << 36) )
+				throwf("rebase at 0x%08llX to 0x%08llX is out of range for chained fixups", it->_address, target);
+			value = dyld_chained_ptr_64::rebase(offset, target >> 56, next);
+		}
+		set64LE(fixUpLocation, value);
+	}
+}
+
+
 void OutputFile::assignAtomAddresses(ld::Internal& state)
 {
 	const bool log = false;
@@ -226,59 +367,109 @@ void OutputFile::assignAtomAddresses(ld::Internal& state)
 	}
 }
 
+void* OutputFile::encodeSymbolTable(void* outputFile)
+{
+	// runs alongside the dyld info encoders, see updateLINKEDITAddresses()
+	OutputFile* writer = (OutputFile*)outputFile;
+	// the symbol table starts with the debug notes
+	writer->waitForDebugNotes();
+	try {
+		// build classic symbol table and string pool
+		assert(writer->_symbolTableAtom != NULL);
+		writer->_symbolTableAtom->encode();
+		assert(writer->_indirectSymbolTableAtom != NULL);
+		writer->_indirectSymbolTableAtom->encode();
+	}
+	catch (const char* msg) {
+		return (void*)msg;
+	}
+	return NULL;
+}
+
 void OutputFile::updateLINKEDITAddresses(ld::Internal& state)
 {
-	if ( _options.makeCompressedDyldInfo() ) {
-		// build dylb rebasing info  
-		assert(_rebasingInfoAtom != NULL);
-		_rebasingInfoAtom->encode();
+	// the classic symbol table and string pool (which is tail merged once all
+	// names are known) do not depend on the dyld info, so build them on another thread
+	pthread_t symbolTableThread;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	// set a nice big stack (same as main thread) because some code uses potentially large stack buffers
+	pthread_attr_setstacksize(&attr, 8 * 1024 * 1024);
+	const bool threaded = ( pthread_create(&symbolTableThread, &attr, &encodeSymbolTable, this) == 0 );
+	pthread_attr_destroy(&attr);
+	if ( !threaded ) {
+		if ( const char* msg = (const char*)encodeSymbolTable(this) )
+			throw msg;
+	}
+
+	try {
+		if ( _options.makeChainedFixups() ) {
+			// build chained fixups info
+			assert(_chainedFixupsAtom != NULL);
+			_chainedFixupsAtom->encode();
 		
-		// build dyld binding info  
-		assert(_bindingInfoAtom != NULL);
-		_bindingInfoAtom->encode();
+			// build dyld export info  
+			assert(_exportInfoAtom != NULL);
+			_exportInfoAtom->encode();
+		}
+		else if ( _options.makeCompressedDyldInfo() ) {
+			// build dylb rebasing info  
+			assert(_rebasingInfoAtom != NULL);
+			_rebasingInfoAtom->encode();
 		
-		// build dyld lazy binding info  
-		assert(_lazyBindingInfoAtom != NULL);
-		_lazyBindingInfoAtom->encode();
+			// build dyld binding info  
+			assert(_bindingInfoAtom != NULL);
+			_bindingInfoAtom->encode();
 		
-		// build dyld weak binding info  
-		assert(_weakBindingInfoAtom != NULL);
-		_weakBindingInfoAtom->encode();
+			// build dyld lazy binding info  
+			assert(_lazyBindingInfoAtom != NULL);
+			_lazyBindingInfoAtom->encode();
 		
-		// build dyld export info  
-		assert(_exportInfoAtom != NULL);
-		_exportInfoAtom->encode();
-	}
+			// build dyld weak binding info  
+			assert(_weakBindingInfoAtom != NULL);
+			_weakBindingInfoAtom->encode();
+		
+			// build dyld export info  
+			assert(_exportInfoAtom != NULL);
+			_exportInfoAtom->encode();
+		}
 	
-	if ( _options.sharedRegionEligible() ) {
-		// build split seg info  
-		assert(_splitSegInfoAtom != NULL);
-		_splitSegInfoAtom->encode();
-	}
+		if ( _options.sharedRegionEligible() ) {
+			// build split seg info  
+			assert(_splitSegInfoAtom != NULL);
+			_splitSegInfoAtom->encode();
+		}
 
-	if ( _options.addFunctionStarts() ) {
-		// build function starts info  
-		assert(_functionStartsAtom != NULL);
-		_functionStartsAtom->encode();
-	}
+		if ( _options.addFunctionStarts() ) {
+			// build function starts info  
+			assert(_functionStartsAtom != NULL);
+			_functionStartsAtom->encode();
+		}
 
-	if ( _options.addDataInCodeInfo() ) {
-		// build data-in-code info  
-		assert(_dataInCodeAtom != NULL);
-		_dataInCodeAtom->encode();
-	}
+		if ( _options.addDataInCodeInfo() ) {
+			// build data-in-code info  
+			assert(_dataInCodeAtom != NULL);
+			_dataInCodeAtom->encode();
+		}
 	
-	if ( _hasOptimizationHints ) {
-		// build linker-optimization-hint info  
-		assert(_optimizationHintsAtom != NULL);
-		_optimizationHintsAtom->encode();
+		if ( _hasOptimizationHints ) {
+			// build linker-optimization-hint info  
+			assert(_optimizationHintsAtom != NULL);
+			_optimizationHintsAtom->encode();
+		}
+	}
+	catch (const char* msg) {
+		if ( threaded )
+			pthread_join(symbolTableThread, NULL);
+		throw;
+	}
+
+	if ( threaded ) {
+		void* msg = NULL;
+		pthread_join(symbolTableThread, &msg);
+		if ( msg != NULL )
+			throw (const char*)msg;
 	}
-	
-	// build classic symbol table
-	assert(_symbolTableAtom != NULL);
-	_symbolTableAtom->encode();
-	assert(_indirectSymbolTableAtom != NULL);
-	_indirectSymbolTableAtom->encode();
 
 	// add relocations to .o files
 	if ( _options.outputKind() == Options::kObjectFile ) {
@@ -2637,6 +2828,10 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 		}
 	}
 	
+	// rewrite pointers as chains now that their targets are in place
+	if ( _options.makeChainedFixups() )
+		this->writeChainedFixups(state, mhAddress, wholeBuffer);
+	
 	if ( _options.verboseOptimizationHints() ) {
 		//fprintf(stderr, "ADRP optimized away:   %d\n", sAdrpNA);
 		//fprintf(stderr, "ADRPs changed to NOPs: %d\n", sAdrpNoped);
@@ -3350,7 +3545,14 @@ void OutputFile::addLinkEdit(ld::Internal& state)
 				_sectionsRelocationsAtom = new SectionRelocationsAtom<x86_64>(_options, state, *this);
 				sectionRelocationsSection = state.addAtom(*_sectionsRelocationsAtom);
 			}
-			if ( _hasDyldInfo ) {
+			if ( _hasDyldInfo && _options.makeChainedFixups() ) {
+				_chainedFixupsAtom = new ChainedFixupsAtom<x86_64>(_options, state, *this);
+				chainedFixupsSection = state.addAtom(*_chainedFixupsAtom);
+				
+				_exportInfoAtom = new ExportInfoAtom<x86_64>(_options, state, *this);
+				exportSection = state.addAtom(*_exportInfoAtom);
+			}
+			else if ( _hasDyldInfo ) {
 				_rebasingInfoAtom = new RebaseInfoAtom<x86_64>(_options, state, *this);
 				rebaseSection = state.addAtom(*_rebasingInfoAtom);
 				
@@ -3472,7 +3674,14 @@ void OutputFile::addLinkEdit(ld::Internal& state)
 				_sectionsRelocationsAtom = new SectionRelocationsAtom<arm64>(_options, state, *this);
 				sectionRelocationsSection = state.addAtom(*_sectionsRelocationsAtom);
 			}
-			if ( _hasDyldInfo ) {
+			if ( _hasDyldInfo && _options.makeChainedFixups() ) {
+				_chainedFixupsAtom = new ChainedFixupsAtom<arm64>(_options, state, *this);
+				chainedFixupsSection = state.addAtom(*_chainedFixupsAtom);
+				
+				_exportInfoAtom = new ExportInfoAtom<arm64>(_options, state, *this);
+				exportSection = state.addAtom(*_exportInfoAtom);
+			}
+			else if ( _hasDyldInfo ) {
 				_rebasingInfoAtom = new RebaseInfoAtom<arm64>(_options, state, *this);
 				rebaseSection = state.addAtom(*_rebasingInfoAtom);
 				
@@ -3588,9 +3797,14 @@ bool OutputFile::hasOrdinalForInstallPath(const char* path, int* ordinal)
 	return false;
 }
 
-uint32_t OutputFile::dylibToOrdinal(const ld::dylib::File* dylib)
+uint32_t OutputFile::dylibToOrdinal(const ld::dylib::File* dylib) const
 {
-	return _dylibToOrdinal[dylib];
+	// also called from the symbol table thread (see updateLINKEDITAddresses()), so it must not insert
+	std::map<const ld::dylib::File*, int>::const_iterator pos = _dylibToOrdinal.find(dylib);
+	if ( pos != _dylibToOrdinal.end() )
+		return pos->second;
+	assert(0 && "dylib not assigned ordinal");
+	return 0;
 }
 
 
@@ -3916,6 +4130,9 @@ void OutputFile::generateLinkEditInfo(ld::Internal& state)
 			
 			// Record regular atoms that override a dylib's weak definitions 
 			if ( (atom->scope() == ld::Atom::scopeGlobal) && atom->overridesDylibsWeakDef() ) {
+				// chained fixups have no weak binding info to tell dyld about the override
+				if ( _options.makeChainedFixups() && (atom->combine() == ld::Atom::combineNever) )
+					throwf("%s overrides a weak definition in a dylib, which can't be represented with chained fixups, link without -fixup_chains", atom->name());
 				if ( _options.makeCompressedDyldInfo() ) {
 					uint8_t wtype = BIND_TYPE_OVERRIDE_OF_WEAKDEF_IN_DYLIB;
 					bool nonWeakDef = (atom->combine() == ld::Atom::combineNever);
@@ -4262,6 +4479,23 @@ void OutputFile::addDyldInfo(ld::Internal& state,  ld::Internal::FinalSection* s
 		}
 	} 
 
+	// chained fixups have no lazy or weak binding info
+	if ( _options.makeChainedFixups() ) {
+		if ( inReadOnlySeg && (needsRebase || needsBinding || needsLazyBinding || needsWeakBinding) )
+			throwf("text relocations (reference in %s to %s) can't be used with chained fixups, link without -fixup_chains", 
+					atom->name(), target->name());
+		// pointers that may be coalesced bind with a weak lookup, dyld picks the first weak definition in load order
+		if ( needsWeakBinding ) {
+			_bindingInfo.push_back(BindingInfo(type, BIND_SPECIAL_DYLIB_WEAK_LOOKUP, target->name(), weak_import, address, addend));
+			return;
+		}
+		// lazy pointers are bound at launch
+		if ( needsLazyBinding ) {
+			needsLazyBinding = false;
+			needsBinding = true;
+		}
+	}
+
 	// record dyld info for this cluster
 	if ( needsRebase ) {
 		if ( inReadOnlySeg ) {
@@ -5173,26 +5407,6 @@ void OutputFile::writeJSONEntry(ld::Internal& state)
 	}
 }
 	
-// used to sort atoms with debug notes
-class DebugNoteSorter
-{
-public:
-	bool operator()(const ld::Atom* left, const ld::Atom* right) const
-	{
-		// first sort by reader
-		ld::File::Ordinal leftFileOrdinal  = left->file()->ordinal();
-		ld::File::Ordinal rightFileOrdinal = right->file()->ordinal();
-		if ( leftFileOrdinal!= rightFileOrdinal)
-			return (leftFileOrdinal < rightFileOrdinal);
-
-		// then sort by atom objectAddress
-		uint64_t leftAddr  = left->finalAddress();
-		uint64_t rightAddr = right->finalAddress();
-		return leftAddr < rightAddr;
-	}
-};
-
-
 const char* OutputFile::assureFullPath(const char* path)
 {
 	if ( path[0] == '/' )
@@ -5221,13 +5435,10 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 	// -S means don't synthesize debug map
 	if ( _options.debugInfoStripping() == Options::kDebugInfoNone )
 		return;
-	// make a vector of atoms that come from files compiled with dwarf debug info
-	std::vector<const ld::Atom*> atomsNeedingDebugNotes;
-	std::set<const ld::Atom*> atomsWithStabs;
-	atomsNeedingDebugNotes.reserve(1024);
-	const ld::relocatable::File* objFile = NULL;
-	bool objFileHasDwarf = false;
-	bool objFileHasStabs = false;
+	// group the atoms that come from files compiled with debug info by file
+	std::unordered_map<const ld::File*, uint32_t> fileIndexes;
+	const ld::File* lastFile = NULL;
+	uint32_t lastFileIndex = UINT32_MAX;
 	for (std::vector<ld::Internal::FinalSection*>::iterator sit = state.sections.begin(); sit != state.sections.end(); ++sit) {
 		ld::Internal::FinalSection* sect = *sit;
 		for (std::vector<const ld::Atom*>::iterator ait = sect->atoms.begin(); ait != sect->atoms.end(); ++ait) {
@@ -5252,35 +5463,44 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 			if ( (_options.outputKind() == Options::kStaticExecutable) && (strncmp(atom->name(), "__dtrace_probe$", 15) == 0) )
 				continue;
 			const ld::File* file = atom->file();
-			if ( file != NULL ) {
-				if ( file != objFile ) {
-					objFileHasDwarf = false;
-					objFileHasStabs = false;
-					objFile = dynamic_cast<const ld::relocatable::File*>(file);
+			if ( file == NULL )
+				continue;
+			if ( file != lastFile ) {
+				lastFile = file;
+				std::unordered_map<const ld::File*, uint32_t>::iterator pos = fileIndexes.find(file);
+				if ( pos != fileIndexes.end() ) {
+					lastFileIndex = pos->second;
+				}
+				else {
+					lastFileIndex = UINT32_MAX;
+					const ld::relocatable::File* objFile = dynamic_cast<const ld::relocatable::File*>(file);
 					if ( objFile != NULL ) {
 						switch ( objFile->debugInfo() ) {
 							case ld::relocatable::File::kDebugInfoNone:
 								break;
 							case ld::relocatable::File::kDebugInfoDwarf:
-								objFileHasDwarf = true;
-								break;
 							case ld::relocatable::File::kDebugInfoStabs:
 							case ld::relocatable::File::kDebugInfoStabsUUID:
-								objFileHasStabs = true;
+								lastFileIndex = _debugNotesFiles.size();
+								_debugNotesFiles.push_back(DebugNotesFile());
+								_debugNotesFiles.back().file = objFile;
+								_debugNotesFiles.back().hasDwarf = (objFile->debugInfo() == ld::relocatable::File::kDebugInfoDwarf);
 								break;
 						}
 					}
+					fileIndexes[file] = lastFileIndex;
 				}
-				if ( objFileHasDwarf )
-					atomsNeedingDebugNotes.push_back(atom);
-				if ( objFileHasStabs )
-					atomsWithStabs.insert(atom);
 			}
+			// scope and address are read now, before buildSymbolTable() can change them
+			if ( lastFileIndex != UINT32_MAX )
+				_debugNotesFiles[lastFileIndex].atoms.push_back({ atom, atom->finalAddress(), (atom->scope() == ld::Atom::scopeTranslationUnit) });
 		}
 	}
-	
-	// sort by file ordinal then atom ordinal
-	std::sort(atomsNeedingDebugNotes.begin(), atomsNeedingDebugNotes.end(), DebugNoteSorter());
+
+	// debug notes are in file order
+	std::sort(_debugNotesFiles.begin(), _debugNotesFiles.end(), [](const DebugNotesFile& left, const DebugNotesFile& right) {
+		return (left.file->ordinal() < right.file->ordinal());
+	});
 
 	// <rdar://problem/17689030> Add -add_ast_path option to linker which add N_AST stab entry to output
 	const std::vector<const char*>&	astPaths = _options.astFilePaths();
@@ -5296,30 +5516,114 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 		astStab.string	= path;
 		state.stabs.push_back(astStab);
 	}
-	
-	// synthesize "debug notes" and add them to master stabs vector
+
+	if ( _debugNotesFiles.empty() )
+		return;
+
+	// the stabs are not needed until the symbol table is encoded, so make them
+	// while the rest of the LINKEDIT info is built, see waitForDebugNotes()
+	_debugNotesState = &state;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	// set a nice big stack (same as main thread) because some code uses potentially large stack buffers
+	pthread_attr_setstacksize(&attr, 8 * 1024 * 1024);
+	if ( pthread_create(&_debugNotesThread, &attr, &buildDebugNotes, this) == 0 )
+		_debugNotesPending = true;
+	else
+		buildDebugNotes(this);
+	pthread_attr_destroy(&attr);
+}
+
+
+void OutputFile::waitForDebugNotes()
+{
+	if ( _debugNotesPending ) {
+		pthread_join(_debugNotesThread, NULL);
+		_debugNotesPending = false;
+	}
+}
+
+
+struct DebugNotesWorker
+{
+	OutputFile*		writer;
+	unsigned int	first;
+	unsigned int	stride;
+};
+
+void* OutputFile::debugNotesWorker(void* worker)
+{
+	// each worker does every stride'th file
+	const DebugNotesWorker* info = (DebugNotesWorker*)worker;
+	std::vector<DebugNotesFile>& files = info->writer->_debugNotesFiles;
+	for (size_t i=info->first; i < files.size(); i += info->stride) {
+		if ( files[i].hasDwarf )
+			info->writer->makeDebugNotesForFile(files[i]);
+		else
+			info->writer->copyStabsForFile(files[i]);
+	}
+	return NULL;
+}
+
+
+void* OutputFile::buildDebugNotes(void* outputFile)
+{
+	OutputFile* writer = (OutputFile*)outputFile;
+	const unsigned int workerCount = std::min(availableCPUs(), (unsigned int)writer->_debugNotesFiles.size());
+	std::vector<DebugNotesWorker> workers(workerCount);
+	std::vector<pthread_t> threads(workerCount);
+	std::vector<bool> started(workerCount, false);
+	for (unsigned int i=0; i < workerCount; ++i) {
+		workers[i].writer = writer;
+		workers[i].first = i;
+		workers[i].stride = workerCount;
+		if ( i != 0 )
+			started[i] = ( pthread_create(&threads[i], NULL, &debugNotesWorker, &workers[i]) == 0 );
+	}
+	for (unsigned int i=0; i < workerCount; ++i) {
+		if ( started[i] )
+			pthread_join(threads[i], NULL);
+		else
+			debugNotesWorker(&workers[i]);
+	}
+	writer->appendDebugNotes(*writer->_debugNotesState);
+	return NULL;
+}
+
+
+void OutputFile::makeDebugNotesForFile(DebugNotesFile& file)
+{
+	// sort by atom address
+	std::stable_sort(file.atoms.begin(), file.atoms.end(), [](const DebugNoteAtom& left, const DebugNoteAtom& right) {
+		return (left.address < right.address);
+	});
+
+	// synthesize "debug notes" for this file, appendDebugNotes() joins them up with the notes of the other files
+	const ld::relocatable::File* atomObjFile = file.file;
 	const char* dirPath = NULL;
 	const char* filename = NULL;
-	bool wroteStartSO = false;
-	state.stabs.reserve(atomsNeedingDebugNotes.size()*4);
+	const char* lastPath = NULL;
+	const char* newDirPath = NULL;
+	const char* newFilename = NULL;
+	file.stabs.reserve(file.atoms.size()*4);
 	std::unordered_set<const char*, CStringHash, CStringEquals>  seenFiles;
-	for (std::vector<const ld::Atom*>::iterator it=atomsNeedingDebugNotes.begin(); it != atomsNeedingDebugNotes.end(); it++) {
-		const ld::Atom* atom = *it;
-		const ld::File* atomFile = atom->file();
-		const ld::relocatable::File* atomObjFile = dynamic_cast<const ld::relocatable::File*>(atomFile);
+	for (const DebugNoteAtom& noteAtom : file.atoms) {
+		const ld::Atom* atom = noteAtom.atom;
 		//fprintf(stderr, "debug note for %s\n", atom->name());
 		const char* newPath = atom->translationUnitSource();
 		if ( newPath != NULL ) {
-			const char* newDirPath;
-			const char* newFilename;
-			const char* lastSlash = strrchr(newPath, '/');
-			if ( lastSlash == NULL ) 
-				continue;
-			newFilename = lastSlash+1;
-			char* temp = strdup(newPath);
-			newDirPath = temp;
-			// gdb like directory SO's to end in '/', but dwarf DW_AT_comp_dir usually does not have trailing '/'
-			temp[lastSlash-newPath+1] = '\0';
+			// atoms of a file almost always have the same translation unit, only split its path when it changes
+			if ( newPath != lastPath ) {
+				const char* lastSlash = strrchr(newPath, '/');
+				if ( lastSlash == NULL ) 
+					continue;
+				newFilename = lastSlash+1;
+				char* temp = strdup(newPath);
+				newDirPath = temp;
+				// gdb like directory SO's to end in '/', but dwarf DW_AT_comp_dir usually does not have trailing '/'
+				temp[lastSlash-newPath+1] = '\0';
+				lastPath = newPath;
+			}
 			// need SO's whenever the translation unit source file changes
 			if ( (filename == NULL) || (strcmp(newFilename,filename) != 0) || (strcmp(newDirPath,dirPath) != 0)) {
 				if ( filename != NULL ) {
@@ -5331,7 +5635,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 					endFileStab.desc		= 0;
 					endFileStab.value		= 0;
 					endFileStab.string		= "";
-					state.stabs.push_back(endFileStab);
+					file.stabs.push_back(endFileStab);
 				}
 				// new translation unit, emit start SO's
 				ld::relocatable::File::Stab dirPathStab;
@@ -5341,7 +5645,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				dirPathStab.desc		= 0;
 				dirPathStab.value		= 0;
 				dirPathStab.string		= newDirPath;
-				state.stabs.push_back(dirPathStab);
+				file.stabs.push_back(dirPathStab);
 				ld::relocatable::File::Stab fileStab;
 				fileStab.atom		= NULL;
 				fileStab.type		= N_SO;
@@ -5349,24 +5653,17 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				fileStab.desc		= 0;
 				fileStab.value		= 0;
 				fileStab.string		= newFilename;
-				state.stabs.push_back(fileStab);
+				file.stabs.push_back(fileStab);
 				// Synthesize OSO for start of file
 				ld::relocatable::File::Stab objStab;
 				objStab.atom		= NULL;
 				objStab.type		= N_OSO;
 				// <rdar://problem/6337329> linker should put cpusubtype in n_sect field of nlist entry for N_OSO debug note entries
-				objStab.other		= atomFile->cpuSubType(); 
+				objStab.other		= atomObjFile->cpuSubType(); 
 				objStab.desc		= 1;
-				if ( atomObjFile != NULL ) {
-					objStab.string	= assureFullPath(atomObjFile->debugInfoPath());
-					objStab.value	= atomObjFile->debugInfoModificationTime();
-				}
-				else {
-					objStab.string	= assureFullPath(atomFile->path());
-					objStab.value	= atomFile->modificationTime();
-				}
-				state.stabs.push_back(objStab);
-				wroteStartSO = true;
+				objStab.string		= assureFullPath(atomObjFile->debugInfoPath());
+				objStab.value		= atomObjFile->debugInfoModificationTime();
+				file.stabs.push_back(objStab);
 				// add the source file path to seenFiles so it does not show up in SOLs
 				seenFiles.insert(newFilename);
 				char* fullFilePath;
@@ -5385,7 +5682,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				beginSym.desc		= 0;
 				beginSym.value		= 0;
 				beginSym.string		= "";
-				state.stabs.push_back(beginSym);
+				file.stabs.push_back(beginSym);
 				ld::relocatable::File::Stab startFun;
 				startFun.atom		= atom;
 				startFun.type		= N_FUN;
@@ -5393,7 +5690,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				startFun.desc		= 0;
 				startFun.value		= 0;
 				startFun.string		= atom->name();
-				state.stabs.push_back(startFun);
+				file.stabs.push_back(startFun);
 				// Synthesize any SOL stabs needed
 				const char* curFile = NULL;
 				for (ld::Atom::LineInfo::iterator lit = atom->beginLineInfo(); lit != atom->endLineInfo(); ++lit) {
@@ -5407,7 +5704,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 							sol.desc		= 0;
 							sol.value		= 0;
 							sol.string		= lit->fileName;
-							state.stabs.push_back(sol);
+							file.stabs.push_back(sol);
 						}
 						curFile = lit->fileName;
 					}
@@ -5420,7 +5717,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				endFun.desc			= 0;
 				endFun.value		= 0;
 				endFun.string		= "";
-				state.stabs.push_back(endFun);
+				file.stabs.push_back(endFun);
 				ld::relocatable::File::Stab endSym;
 				endSym.atom			= atom;
 				endSym.type			= N_ENSYM;
@@ -5428,12 +5725,12 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				endSym.desc			= 0;
 				endSym.value		= 0;
 				endSym.string		= "";
-				state.stabs.push_back(endSym);
+				file.stabs.push_back(endSym);
 			}
 			else {
 				ld::relocatable::File::Stab globalsStab;
 				const char* name = atom->name();
-				if ( atom->scope() == ld::Atom::scopeTranslationUnit ) {
+				if ( noteAtom.isStatic ) {
 					// Synthesize STSYM stab for statics
 					globalsStab.atom		= atom;
 					globalsStab.type		= N_STSYM;
@@ -5441,7 +5738,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 					globalsStab.desc		= 0;
 					globalsStab.value		= 0;
 					globalsStab.string		= name;
-					state.stabs.push_back(globalsStab);
+					file.stabs.push_back(globalsStab);
 				}
 				else {
 					// Synthesize GSYM stab for other globals
@@ -5451,50 +5748,109 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 					globalsStab.desc		= 0;
 					globalsStab.value		= 0;
 					globalsStab.string		= name;
-					state.stabs.push_back(globalsStab);
+					file.stabs.push_back(globalsStab);
 				}
 			}
 		}
 	}
+}
 
-	if ( wroteStartSO ) {
-		//  emit ending SO
-		ld::relocatable::File::Stab endFileStab;
-		endFileStab.atom		= NULL;
-		endFileStab.type		= N_SO;
-		endFileStab.other		= 1;
-		endFileStab.desc		= 0;
-		endFileStab.value		= 0;
-		endFileStab.string		= "";
-		state.stabs.push_back(endFileStab);
+
+void OutputFile::copyStabsForFile(DebugNotesFile& file)
+{
+	const std::vector<ld::relocatable::File::Stab>* stabs = file.file->stabs();
+	if ( (stabs == NULL) || file.atoms.empty() )
+		return;
+	// <rdar://problem/8284718> Value of N_SO stabs should be address of first atom from translation unit
+	const ld::Atom* firstAtom = std::min_element(file.atoms.begin(), file.atoms.end(), [](const DebugNoteAtom& left, const DebugNoteAtom& right) {
+		return (left.address < right.address);
+	})->atom;
+	std::vector<const ld::Atom*> liveAtoms;
+	liveAtoms.reserve(file.atoms.size());
+	for (const DebugNoteAtom& noteAtom : file.atoms)
+		liveAtoms.push_back(noteAtom.atom);
+	std::sort(liveAtoms.begin(), liveAtoms.end());
+	for(std::vector<ld::relocatable::File::Stab>::const_iterator sit = stabs->begin(); sit != stabs->end(); ++sit) {
+		ld::relocatable::File::Stab stab = *sit;
+		// ignore stabs associated with atoms that were dead stripped or coalesced away
+		if ( (sit->atom != NULL) && !std::binary_search(liveAtoms.begin(), liveAtoms.end(), sit->atom) )
+			continue;
+		if ( (stab.type == N_SO) && (stab.string != NULL) && (stab.string[0] != '\0') ) {
+			stab.atom = firstAtom;
+		}
+		file.stabs.push_back(stab);
 	}
-	
-	// copy any stabs from .o file 
-	std::set<const ld::File*> filesSeenWithStabs;
-	for (std::set<const ld::Atom*>::iterator it=atomsWithStabs.begin(); it != atomsWithStabs.end(); it++) {
-		const ld::Atom* atom = *it;
-		objFile = dynamic_cast<const ld::relocatable::File*>(atom->file());
-		if ( objFile != NULL ) {
-			if ( filesSeenWithStabs.count(objFile) == 0 ) {
-				filesSeenWithStabs.insert(objFile);
-				const std::vector<ld::relocatable::File::Stab>* stabs = objFile->stabs();
-				if ( stabs != NULL ) {
-					for(std::vector<ld::relocatable::File::Stab>::const_iterator sit = stabs->begin(); sit != stabs->end(); ++sit) {
-						ld::relocatable::File::Stab stab = *sit;
-						// ignore stabs associated with atoms that were dead stripped or coalesced away
-						if ( (sit->atom != NULL) && (atomsWithStabs.count(sit->atom) == 0) )
-							continue;
-						// <rdar://problem/8284718> Value of N_SO stabs should be address of first atom from translation unit
-						if ( (stab.type == N_SO) && (stab.string != NULL) && (stab.string[0] != '\0') ) {
-							stab.atom = atom;
-						}
-						state.stabs.push_back(stab);
-					}
+}
+
+
+void OutputFile::appendDebugNotes(ld::Internal& state)
+{
+	// Join the per file notes up as if they had been made in one pass over all
+	// files: a file that continues the translation unit of the previous file does
+	// not start it again, and N_SOLs are only kept the first time a path is seen.
+	size_t count = 1;
+	for (const DebugNotesFile& file : _debugNotesFiles)
+		count += file.stabs.size();
+	state.stabs.reserve(state.stabs.size() + count);
+
+	const char* dirPath = NULL;
+	const char* filename = NULL;
+	bool wroteStartSO = false;
+	std::unordered_set<const char*, CStringHash, CStringEquals>  seenFiles;
+	ld::relocatable::File::Stab endFileStab;
+	endFileStab.atom		= NULL;
+	endFileStab.type		= N_SO;
+	endFileStab.other		= 1;
+	endFileStab.desc		= 0;
+	endFileStab.value		= 0;
+	endFileStab.string		= "";
+	for (const DebugNotesFile& file : _debugNotesFiles) {
+		if ( !file.hasDwarf || file.stabs.empty() )
+			continue;
+		// the notes of each file start with the dir SO, file SO and OSO of its first translation unit
+		std::vector<ld::relocatable::File::Stab>::const_iterator sit = file.stabs.begin();
+		if ( filename != NULL ) {
+			if ( (strcmp(sit[1].string, filename) == 0) && (strcmp(sit[0].string, dirPath) == 0) )
+				sit += 3;
+			else
+				state.stabs.push_back(endFileStab);
+		}
+		bool nextIsDirPath = true;
+		for (; sit != file.stabs.end(); ++sit) {
+			if ( sit->type == N_SOL ) {
+				if ( seenFiles.count(sit->string) != 0 )
+					continue;
+				seenFiles.insert(sit->string);
+			}
+			else if ( (sit->type == N_SO) && (sit->other == 0) ) {
+				// start SO's come in dir path, file name pairs
+				if ( nextIsDirPath ) {
+					dirPath = sit->string;
+				}
+				else {
+					filename = sit->string;
+					seenFiles.insert(filename);
+					char* fullFilePath;
+					asprintf(&fullFilePath, "%s%s", dirPath, filename);
+					seenFiles.insert(fullFilePath);
 				}
+				nextIsDirPath = !nextIsDirPath;
+				wroteStartSO = true;
 			}
+			state.stabs.push_back(*sit);
 		}
 	}
+	if ( wroteStartSO ) {
+		//  emit ending SO
+		state.stabs.push_back(endFileStab);
+	}
 
+	// copy any stabs from .o file 
+	for (const DebugNotesFile& file : _debugNotesFiles) {
+		if ( !file.hasDwarf )
+			state.stabs.insert(state.stabs.end(), file.stabs.begin(), file.stabs.end());
+	}
+	std::vector<DebugNotesFile>().swap(_debugNotesFiles);
 }
 
 
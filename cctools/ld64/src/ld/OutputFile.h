@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <mach/mach_time.h>
 #include <mach/vm_statistics.h>
 #include <mach/mach_init.h>
@@ -61,7 +62,7 @@ public:
 	void						setLazyBindingInfoOffset(uint64_t lpAddress, uint32_t lpInfoOffset);
 	uint32_t					dylibCount();
 	const ld::dylib::File*		dylibByOrdinal(unsigned int ordinal);
-	uint32_t					dylibToOrdinal(const ld::dylib::File*);
+	uint32_t					dylibToOrdinal(const ld::dylib::File*) const;
 	uint32_t					encryptedTextStartOffset()	{ return _encryptedTEXTstartOffset; }
 	uint32_t					encryptedTextEndOffset()	{ return _encryptedTEXTendOffset; }
 	int							compressedOrdinalForAtom(const ld::Atom* target);
@@ -79,6 +80,7 @@ public:
 	ld::Internal::FinalSection*	weakBindingSection;
 	ld::Internal::FinalSection*	lazyBindingSection;
 	ld::Internal::FinalSection*	exportSection;
+	ld::Internal::FinalSection*	chainedFixupsSection;
 	ld::Internal::FinalSection*	splitSegInfoSection;
 	ld::Internal::FinalSection*	functionStartsSection;
 	ld::Internal::FinalSection*	dataInCodeSection;
@@ -130,6 +132,39 @@ public:
 		}
 	};
 	
+	struct ChainedImport {
+						ChainedImport(int ord, const char* sym, bool weak_import, int64_t add)
+							: _libraryOrdinal(ord), _symbolName(sym), _weakImport(weak_import), _addend(add) {}
+		int				_libraryOrdinal;
+		const char*		_symbolName;
+		bool			_weakImport;
+		int64_t			_addend;
+	};
+
+	struct ChainedFixup {
+						ChainedFixup(uint64_t addr, uint32_t seg, bool bind, uint32_t imp, int64_t add)
+							: _address(addr), _segIndex(seg), _bind(bind), _importIndex(imp), _addend(add) {}
+		uint64_t		_address;
+		uint32_t		_segIndex;
+		bool			_bind;
+		uint32_t		_importIndex;
+		int64_t			_addend;		// inline addend of a bind
+		
+		// for sorting
+		int operator<(const ChainedFixup& rhs) const {
+			// sort by segment, then address
+			if ( this->_segIndex != rhs._segIndex )
+				return  (this->_segIndex < rhs._segIndex );
+			return  (this->_address < rhs._address );
+		}
+	};
+	
+	struct ChainedSegment {
+						ChainedSegment(uint64_t start, uint64_t end) : _start(start), _end(end) {}
+		uint64_t		_start;
+		uint64_t		_end;
+	};
+	
 	struct SplitSegInfoEntry {
 						SplitSegInfoEntry(uint64_t a, ld::Fixup::Kind k, uint32_t e=0)
 							: fixupAddress(a), kind(k), extra(e) {}
@@ -186,7 +221,10 @@ private:
 	void						addRebaseInfo(const ld::Atom* atom, const ld::Fixup* fixup, const ld::Atom* target);
 	void						makeRebasingInfo(ld::Internal& state);
 	void						makeBindingInfo(ld::Internal& state);
+	void						makeChainedFixups(ld::Internal& state);
+	void						writeChainedFixups(ld::Internal& state, uint64_t mhAddress, uint8_t* wholeBuffer);
 	void						updateLINKEDITAddresses(ld::Internal& state);
+	static void*				encodeSymbolTable(void* outputFile);
 	void						applyFixUps(ld::Internal& state, uint64_t mhAddress, const ld::Atom*  atom, uint8_t* buffer);
 	uint64_t					addressOf(const ld::Internal& state, const ld::Fixup* fixup, const ld::Atom** target);
 	uint64_t					addressAndTarget(const ld::Internal& state, const ld::Fixup* fixup, const ld::Atom** target);
@@ -240,7 +278,27 @@ private:
 																							
 	uint64_t					sectionOffsetOf(const ld::Internal& state, const ld::Fixup* fixup);
 	uint64_t					tlvTemplateOffsetOf(const ld::Internal& state, const ld::Fixup* fixup);
+
+	struct DebugNoteAtom {
+		const ld::Atom*		atom;
+		uint64_t			address;
+		bool				isStatic;
+	};
+
+	struct DebugNotesFile {
+		const ld::relocatable::File*				file;
+		bool										hasDwarf;
+		std::vector<DebugNoteAtom>					atoms;
+		std::vector<ld::relocatable::File::Stab>	stabs;
+	};
+
 	void						synthesizeDebugNotes(ld::Internal& state);
+	void						waitForDebugNotes();
+	static void*				buildDebugNotes(void* outputFile);
+	static void*				debugNotesWorker(void* worker);
+	void						makeDebugNotesForFile(DebugNotesFile& file);
+	void						copyStabsForFile(DebugNotesFile& file);
+	void						appendDebugNotes(ld::Internal& state);
 	const char*					assureFullPath(const char* path);
 	void						noteTextReloc(const ld::Atom* atom, const ld::Atom* target);
 
@@ -292,6 +350,10 @@ private:
 	std::map<uint64_t, uint32_t>			_lazyPointerAddressToInfoOffset;
 	uint32_t								_encryptedTEXTstartOffset;
 	uint32_t								_encryptedTEXTendOffset;
+	ld::Internal*							_debugNotesState;
+	std::vector<DebugNotesFile>				_debugNotesFiles;
+	pthread_t								_debugNotesThread;
+	bool									_debugNotesPending;
 public:
 	std::vector<const ld::Atom*>			_localAtoms;
 	std::vector<const ld::Atom*>			_exportedAtoms;
@@ -307,6 +369,11 @@ public:
 	std::vector<BindingInfo>				_bindingInfo;
 	std::vector<BindingInfo>				_lazyBindingInfo;
 	std::vector<BindingInfo>				_weakBindingInfo;
+	std::vector<ChainedImport>				_chainedImports;
+	std::vector<ChainedFixup>				_chainedFixups;
+	std::vector<ChainedSegment>				_chainedSegments;
+	uint32_t								_chainedImportsFormat;
+	uint32_t								_chainedPageSize;
 	std::vector<SplitSegInfoEntry>			_splitSegInfos;
 	std::vector<SplitSegInfoV2Entry>		_splitSegV2Infos;
 	class HeaderAndLoadCommandsAbtract*		_headersAndLoadCommandAtom;
@@ -321,6 +388,7 @@ public:
 	class LinkEditAtom*						_lazyBindingInfoAtom;
 	class LinkEditAtom*						_weakBindingInfoAtom;
 	class LinkEditAtom*						_exportInfoAtom;
+	class LinkEditAtom*						_chainedFixupsAtom;
 	class LinkEditAtom*						_splitSegInfoAtom;
 	class LinkEditAtom*						_functionStartsAtom;
 	class LinkEditAtom*						_dataInCodeAtom;
@@ -1635,7 +1635,7 @@ void Resolver::fillInHelpersInInternalState()
 	}
 	
 	_internal.compressedFastBinderProxy = NULL;
-	if ( needsStubHelper && _options.makeCompressedDyldInfo() ) { 
+	if ( needsStubHelper && _options.makeCompressedDyldInfo() && !_options.makeChainedFixups() ) { 
 		// "dyld_stub_binder" comes from libSystem.dylib so will need to manually resolve
 		if ( !_symbolTable.hasName("dyld_stub_binder") ) {
 			_inputFiles.searchLibraries("dyld_stub_binder", true, false, false, *this);
@@ -0,0 +1,445 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2005-2011 Apple Inc. All rights reserved.
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//
+// Options::SetWithWildcards, split out of Options.cpp so the symbol list
+// matcher can be linked into src/other/wildcardtest without the rest of ld.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <vector>
+#include <map>
+#include <bitset>
+#include <algorithm>
+
+#include "Options.h"
+
+
+void Options::SetWithWildcards::remove(const NameSet& toBeRemoved)
+{
+	for(NameSet::const_iterator it=toBeRemoved.begin(); it != toBeRemoved.end(); ++it) {
+		const char* symbolName = *it;
+		NameSet::iterator pos = fRegular.find(symbolName);
+		if ( pos != fRegular.end() )
+			fRegular.erase(pos);
+	}
+}
+
+bool Options::SetWithWildcards::hasWildCards(const char* symbol) 
+{
+	// an exported symbol name containing *, ?, or [ requires wildcard matching
+	return ( strpbrk(symbol, "*?[") != NULL );
+}
+
+void Options::SetWithWildcards::insert(const char* symbol)
+{
+	if ( hasWildCards(symbol) ) {
+		fWildCard.push_back(symbol);
+		fCompiled = false;
+	}
+	else {
+		fRegular.insert(symbol);
+	}
+}
+
+bool Options::SetWithWildcards::contains(const char* symbol, bool* matchBecauseOfWildcard) const
+{
+	if ( matchBecauseOfWildcard != NULL )
+		*matchBecauseOfWildcard = false;
+	// first look at hash table on non-wildcard symbols
+	if ( fRegular.find(symbol) != fRegular.end() )
+		return true;
+	bool match = false;
+	if ( fCompiled ) {
+		// then the compiled "prefix*" trie and automaton for all other wild card symbols
+		match = ( prefixMatch(symbol) || automatonMatch(symbol) );
+	}
+	else {
+		// next walk list of wild card symbols looking for a match
+		for(std::vector<const char*>::const_iterator it = fWildCard.begin(); it != fWildCard.end(); ++it) {
+			if ( wildCardMatch(*it, symbol) ) {
+				match = true;
+				break;
+			}
+		}
+	}
+	if ( match && (matchBecauseOfWildcard != NULL) )
+		*matchBecauseOfWildcard = true;
+	return match;
+}
+
+// Support "foo.o:_bar" to mean symbol _bar in file foo.o
+bool Options::SetWithWildcards::containsWithPrefix(const char* symbol, const char* file, bool& wildCardMatch) const
+{
+	wildCardMatch = false;
+	if ( contains(symbol, &wildCardMatch) )
+		return true;
+	if ( file == NULL )
+		return false;
+	const char* s = strrchr(file, '/');
+	if ( s != NULL )
+		file = s+1;
+	char buff[strlen(file)+strlen(symbol)+2];
+	sprintf(buff, "%s:%s", file, symbol);
+	return contains(buff, &wildCardMatch);
+}
+
+bool Options::SetWithWildcards::containsNonWildcard(const char* symbol) const
+{
+	// look at hash table on non-wildcard symbols
+	return ( fRegular.find(symbol) != fRegular.end() );
+}
+
+
+std::vector<const char*> Options::SetWithWildcards::data() const
+{
+	std::vector<const char*> data;
+	for (NameSet::const_iterator it=regularBegin(); it != regularEnd(); ++it) { // ld64-port: NameSet::iterator -> NameSet::const_iterator
+		data.push_back(*it);
+	}
+	for (std::vector<const char*>::const_iterator it=fWildCard.begin(); it != fWildCard.end(); ++it) {
+		data.push_back(*it);
+	}
+	return data;
+}
+
+bool Options::SetWithWildcards::inCharRange(const char*& p, unsigned char c) const
+{
+	++p; // find end
+	const char* b = p;
+	while ( *p != '\0' ) {
+		if ( *p == ']') {
+			const char* e = p;
+			// found beginining [ and ending ]
+			unsigned char last = '\0';
+			for ( const char* s = b; s < e; ++s ) {
+				if ( *s == '-' ) {
+					unsigned char next = *(++s);
+					if ( (last <= c) && (c <= next) )
+						return true;
+					++s;
+				}
+				else {
+					if ( *s == c )
+						return true;
+					last = *s;
+				}
+			}
+			return false;
+		}
+		++p;
+	}
+	return false;
+}
+
+bool Options::SetWithWildcards::wildCardMatch(const char* pattern, const char* symbol) const
+{
+	const char* s = symbol;
+	for (const char* p = pattern; *p != '\0'; ++p) {
+		switch ( *p ) {
+			case '*':
+				if ( p[1] == '\0' )
+					return true;
+				for (const char* t = s; *t != '\0'; ++t) {
+					if ( wildCardMatch(&p[1], t) )
+						return true;
+				}
+				return false;
+			case '?':
+				if ( *s == '\0' )
+					return false;
+				++s;
+				break;
+			case '[':
+				if ( ! inCharRange(p, *s) )
+					return false;
+				++s;
+				break;
+			default:
+				if ( *s != *p )
+					return false;
+				++s;
+		}
+	}
+	return (*s == '\0');
+}
+
+//
+// Wild card patterns are compiled once all options are parsed.  Patterns that are a literal
+// prefix followed by a single trailing '*' go into a trie, all others are broken into
+// elements and matched by a DFA whose states are sets of element positions.  compile()
+// builds the whole DFA up front unless it needs more than kDFAStateMax states, so that
+// contains() can be called from several threads without taking a lock.  Larger automata
+// are built lazily as symbols are looked up, serialized by sDFALock.  Either way symbols
+// match the way wildCardMatch() would match them:
+//  - '*' matches any run of characters, but a run of stars that ends the pattern must
+//    match at least one character.
+//  - '[...]' matches the characters inCharRange() accepts, and never matches if unterminated.
+//
+static const uint32_t kDFAStateUnbuilt = 0xFFFFFFFF;
+static const uint32_t kDFAStateMax = 4096;
+static pthread_mutex_t sDFALock = PTHREAD_MUTEX_INITIALIZER;
+
+void Options::SetWithWildcards::compile()
+{
+	fPrefixTrie.clear();
+	fElements.clear();
+	fCharClasses.clear();
+	fStartPositions.clear();
+	fPrefixTrie.push_back(PrefixNode('\0'));
+	for(std::vector<const char*>::const_iterator it = fWildCard.begin(); it != fWildCard.end(); ++it) {
+		const char* pattern = *it;
+		size_t length = strlen(pattern);
+		if ( (length != 0) && (pattern[length-1] == '*') && (strcspn(pattern, "*?[") == length-1) )
+			addPrefix(pattern, length-1);
+		else
+			addPattern(pattern);
+	}
+	std::sort(fStartPositions.begin(), fStartPositions.end());
+	fStartPositions.erase(std::unique(fStartPositions.begin(), fStartPositions.end()), fStartPositions.end());
+	resetDFA();
+	fDFAComplete = buildDFA();
+	if ( !fDFAComplete )
+		resetDFA();
+	fCompiled = true;
+}
+
+void Options::SetWithWildcards::addPrefix(const char* prefix, size_t length)
+{
+	uint32_t node = 0;
+	for (size_t i=0; i < length; ++i) {
+		unsigned char c = prefix[i];
+		uint32_t child = fPrefixTrie[node].firstChild;
+		while ( (child != 0) && (fPrefixTrie[child].c != c) )
+			child = fPrefixTrie[child].nextSibling;
+		if ( child == 0 ) {
+			child = fPrefixTrie.size();
+			fPrefixTrie.push_back(PrefixNode(c));
+			fPrefixTrie[child].nextSibling = fPrefixTrie[node].firstChild;
+			fPrefixTrie[node].firstChild = child;
+		}
+		node = child;
+	}
+	fPrefixTrie[node].terminal = true;
+}
+
+void Options::SetWithWildcards::addPattern(const char* pattern)
+{
+	uint32_t start = fElements.size();
+	for (const char* p = pattern; *p != '\0'; ++p) {
+		switch ( *p ) {
+			case '*':
+				{
+					const char* lastStar = p;
+					while ( lastStar[1] == '*' )
+						++lastStar;
+					if ( (lastStar[1] == '\0') && (lastStar != p) )
+						fElements.push_back(Element(kAnyChar));
+					fElements.push_back(Element(kStar));
+					p = lastStar;
+				}
+				break;
+			case '?':
+				fElements.push_back(Element(kAnyChar));
+				break;
+			case '[':
+				{
+					std::bitset<256> chars;
+					const char* close = strchr(p+1, ']');
+					if ( close != NULL ) {
+						for (unsigned int c=1; c < 256; ++c) {
+							const char* range = p;
+							if ( inCharRange(range, c) )
+								chars.set(c);
+						}
+					}
+					fElements.push_back(Element(kCharClass, 0, fCharClasses.size()));
+					fCharClasses.push_back(chars);
+					// nothing after an unterminated range can match
+					p = (close != NULL) ? close : &p[strlen(p)-1];
+				}
+				break;
+			default:
+				fElements.push_back(Element(kLiteral, *p));
+				break;
+		}
+	}
+	fElements.push_back(Element(kEnd));
+	addPosition(start, fStartPositions);
+}
+
+bool Options::SetWithWildcards::prefixMatch(const char* symbol) const
+{
+	uint32_t node = 0;
+	for (const char* s = symbol; ; ++s) {
+		if ( fPrefixTrie[node].terminal )
+			return true;
+		if ( *s == '\0' )
+			return false;
+		unsigned char c = *s;
+		node = fPrefixTrie[node].firstChild;
+		while ( (node != 0) && (fPrefixTrie[node].c != c) )
+			node = fPrefixTrie[node].nextSibling;
+		if ( node == 0 )
+			return false;
+	}
+}
+
+void Options::SetWithWildcards::addPosition(uint32_t position, Positions& positions) const
+{
+	positions.push_back(position);
+	if ( fElements[position].kind == kStar )
+		addPosition(position+1, positions);
+}
+
+void Options::SetWithWildcards::step(const Positions& from, unsigned char c, Positions& to) const
+{
+	for (Positions::const_iterator it=from.begin(); it != from.end(); ++it) {
+		const Element& element = fElements[*it];
+		switch ( element.kind ) {
+			case kLiteral:
+				if ( element.c == c )
+					addPosition(*it+1, to);
+				break;
+			case kAnyChar:
+				addPosition(*it+1, to);
+				break;
+			case kCharClass:
+				if ( fCharClasses[element.classIndex].test(c) )
+					addPosition(*it+1, to);
+				break;
+			case kStar:
+				addPosition(*it, to);
+				break;
+			case kEnd:
+				break;
+		}
+	}
+	std::sort(to.begin(), to.end());
+	to.erase(std::unique(to.begin(), to.end()), to.end());
+}
+
+bool Options::SetWithWildcards::accepts(const Positions& positions) const
+{
+	for (Positions::const_iterator it=positions.begin(); it != positions.end(); ++it) {
+		if ( fElements[*it].kind == kEnd )
+			return true;
+	}
+	return false;
+}
+
+void Options::SetWithWildcards::resetDFA() const
+{
+	// state 0 is the dead state, state 1 the start state
+	fDFAStates.clear();
+	fDFAAccepts.clear();
+	fDFAStateIndex.clear();
+	fDFAStates.push_back(Positions());
+	fDFAAccepts.push_back(false);
+	fDFAStates.push_back(fStartPositions);
+	fDFAAccepts.push_back(accepts(fStartPositions));
+	fDFAStateIndex[fStartPositions] = 1;
+	fDFATransitions.assign(2*256, kDFAStateUnbuilt);
+	for (unsigned int c=0; c < 256; ++c)
+		fDFATransitions[c] = 0;
+	fDFATransitions[256] = 0;
+}
+
+uint32_t Options::SetWithWildcards::dfaState(const Positions& positions) const
+{
+	if ( positions.empty() )
+		return 0;
+	std::map<Positions, uint32_t>::const_iterator pos = fDFAStateIndex.find(positions);
+	if ( pos != fDFAStateIndex.end() )
+		return pos->second;
+	uint32_t state = fDFAStates.size();
+	fDFAStates.push_back(positions);
+	fDFAAccepts.push_back(accepts(positions));
+	fDFAStateIndex[positions] = state;
+	fDFATransitions.resize(fDFATransitions.size()+256, kDFAStateUnbuilt);
+	return state;
+}
+
+// fills in every transition reachable from the start state, returns false if that takes too many states
+bool Options::SetWithWildcards::buildDFA()
+{
+	for (uint32_t state=1; state < fDFAStates.size(); ++state) {
+		// symbols are C strings, so there is never a transition on '\0'
+		for (unsigned int c=1; c < 256; ++c) {
+			Positions to;
+			step(fDFAStates[state], c, to);
+			if ( !to.empty() && (fDFAStates.size() >= kDFAStateMax) && (fDFAStateIndex.find(to) == fDFAStateIndex.end()) )
+				return false;
+			uint32_t next = dfaState(to);
+			fDFATransitions[state*256+c] = next;
+		}
+	}
+	return true;
+}
+
+// only called with sDFALock held, when compile() could not build the whole DFA
+uint32_t Options::SetWithWildcards::dfaTransition(uint32_t state, unsigned char c) const
+{
+	uint32_t next = fDFATransitions[state*256+c];
+	if ( next != kDFAStateUnbuilt )
+		return next;
+	Positions to;
+	step(fDFAStates[state], c, to);
+	if ( !to.empty() && (fDFAStates.size() >= kDFAStateMax) && (fDFAStateIndex.find(to) == fDFAStateIndex.end()) ) {
+		// too many states for these patterns, start over and only cache what is used from now on
+		resetDFA();
+		return dfaState(to);
+	}
+	next = dfaState(to);
+	fDFATransitions[state*256+c] = next;
+	return next;
+}
+
+bool Options::SetWithWildcards::automatonMatch(const char* symbol) const
+{
+	if ( fStartPositions.empty() )
+		return false;
+	uint32_t state = 1;
+	if ( fDFAComplete ) {
+		for (const char* s = symbol; *s != '\0'; ++s) {
+			state = fDFATransitions[state*256+(unsigned char)*s];
+			if ( state == 0 )
+				return false;
+		}
+		return fDFAAccepts[state];
+	}
+	pthread_mutex_lock(&sDFALock);
+	for (const char* s = symbol; *s != '\0'; ++s) {
+		state = dfaTransition(state, *s);
+		if ( state == 0 )
+			break;
+	}
+	bool result = fDFAAccepts[state];
+	pthread_mutex_unlock(&sDFALock);
+	return result;
+}
@@ -51,6 +51,8 @@ Snapshot::Snapshot() : fRecordArgs(false), fRecordObjects(false), fRecordDylibSy
 Snapshot::~Snapshot() 
 {
     // Lots of things leak under the assumption the linker is about to exit.
+    if (globalSnapshot == this)
+        globalSnapshot = NULL;
 }
 
 #if __has_extension(blocks) // ld64-port
@@ -30,7 +30,8 @@
 #include <libkern/OSByteOrder.h>
 
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <unordered_map>
 
 #include "MachOFileAbstraction.hpp"
 #include "ld.hpp"
@@ -41,21 +42,52 @@ namespace passes {
 namespace branch_island {
 
 
-static std::map<const Atom*, uint64_t> sAtomToAddress;
+static std::unordered_map<const Atom*, uint64_t> sAtomToAddress;
 
 
 struct TargetAndOffset { const ld::Atom* atom; uint32_t offset; };
-class TargetAndOffsetComparor
+class TargetAndOffsetHash
+{
+public:
+	size_t operator()(const TargetAndOffset& value) const
+	{
+		return std::hash<const ld::Atom*>()(value.atom) ^ ((size_t)value.offset * 0x9E3779B1);
+	}
+};
+class TargetAndOffsetEquals
 {
 public:
 	bool operator()(const TargetAndOffset& left, const TargetAndOffset& right) const
 	{
-		if ( left.atom != right.atom )
-			return ( left.atom < right.atom );
-		return ( left.offset < right.offset );
+		return ( (left.atom == right.atom) && (left.offset == right.offset) );
 	}
 };
 
+//
+// The islands made for one final target.  Every branch to the target
+// ends its island chain in the region next to the target, so the
+// islands before the target and the islands after it are each a run
+// of adjacent regions that only grows away from the target.
+//
+struct TargetIslands {
+	int								targetRegion;	// first region after the target
+	std::vector<const ld::Atom*>	forward;		// forward[i] is in region targetRegion-1-i
+	std::vector<const ld::Atom*>	backward;		// backward[i] is in region targetRegion+i
+	const ld::Atom*					crossSection;	// absolute island in region 0
+};
+typedef std::unordered_map<TargetAndOffset, TargetIslands, TargetAndOffsetHash, TargetAndOffsetEquals> TargetToIslands;
+
+static const ld::Atom* regionZeroIsland(const TargetIslands& islands)
+{
+	if ( islands.crossSection != NULL )
+		return islands.crossSection;
+	if ( (islands.targetRegion > 0) && ((int)islands.forward.size() == islands.targetRegion) )
+		return islands.forward.back();
+	if ( (islands.targetRegion == 0) && !islands.backward.empty() )
+		return islands.backward.front();
+	return NULL;
+}
+
 
 static bool _s_log = false;
 static ld::Section _s_text_section("__TEXT", "__text", ld::Section::typeCode);
@@ -387,6 +419,13 @@ static uint64_t maxDistanceBetweenIslands(const Options& opts, bool seenThumbBra
 // 14MB which means the region would have to be 2MB (512,000 islands)
 // before any branches could be pushed out of range.
 //
+// Region addresses increase through the section, so the regions a
+// branch crosses are found with a binary search instead of checking
+// every region.  The islands for a target are kept together (see
+// TargetIslands) so a branch finds the island it can reuse with one
+// lookup, and planning is linear in the number of branches plus the
+// number of islands made.
+//
 
 
 static void makeIslandsForSection(const Options& opts, ld::Internal& state, ld::Internal::FinalSection* textSection, unsigned stubCount)
@@ -485,16 +524,13 @@ static void makeIslandsForSection(const Options& opts, ld::Internal& state, ld::
 	const int kIslandRegionsCount = branchIslandInsertionPoints.size();
 
 	if (_s_log) fprintf(stderr, "ld: will use %u branch island regions\n", kIslandRegionsCount);
-	typedef std::map<TargetAndOffset,const ld::Atom*, TargetAndOffsetComparor> AtomToIsland;
-    AtomToIsland* regionsMap[kIslandRegionsCount];
-	uint64_t regionAddresses[kIslandRegionsCount];
-	std::vector<const ld::Atom*>* regionsIslands[kIslandRegionsCount];
+	std::vector<int64_t> regionAddresses(kIslandRegionsCount);
+	std::vector< std::vector<const ld::Atom*> > regionsIslands(kIslandRegionsCount);
 	for(int i=0; i < kIslandRegionsCount; ++i) {
-		regionsMap[i] = new AtomToIsland();
-		regionsIslands[i] = new std::vector<const ld::Atom*>();
 		regionAddresses[i] = branchIslandInsertionPoints[i]->sectionOffset() + branchIslandInsertionPoints[i]->size();
 		if (_s_log) fprintf(stderr, "ld: branch islands will be inserted at 0x%08llX after %s\n", regionAddresses[i], branchIslandInsertionPoints[i]->name());
 	}
+	TargetToIslands targetsIslands;
 	unsigned int islandCount = 0;
 	
 	// create islands for branches in __text that are out of range
@@ -554,77 +590,72 @@ static void makeIslandsForSection(const Options& opts, ld::Internal& state, ld::
 				int64_t displacement = dstAddr - srcAddr;
 				TargetAndOffset finalTargetAndOffset = { target, (uint32_t)addend };
 				const int64_t kBranchLimit = kBetweenRegions;
-				if ( crossSectionBranch && ((displacement > kBranchLimit) || (displacement < (-kBranchLimit))) ) {
-					const ld::Atom* island;
-					AtomToIsland* region = regionsMap[0];
-					AtomToIsland::iterator pos = region->find(finalTargetAndOffset);
-					if ( pos == region->end() ) {
+				if ( (displacement <= kBranchLimit) && (displacement >= (-kBranchLimit)) )
+					continue;
+				std::pair<TargetToIslands::iterator, bool> inserted = targetsIslands.insert(std::make_pair(finalTargetAndOffset, TargetIslands()));
+				TargetIslands& islands = inserted.first->second;
+				if ( inserted.second ) {
+					islands.targetRegion = std::upper_bound(regionAddresses.begin(), regionAddresses.end(), dstAddr) - regionAddresses.begin();
+					islands.crossSection = NULL;
+				}
+				if ( crossSectionBranch ) {
+					const ld::Atom* island = regionZeroIsland(islands);
+					if ( island == NULL ) {
 						island = makeBranchIsland(opts, fit->kind, 0, target, finalTargetAndOffset, atom->section(), true);
-						(*region)[finalTargetAndOffset] = island;
+						islands.crossSection = island;
 						if (_s_log) fprintf(stderr, "added absolute branching island %p %s, displacement=%lld\n", 
 												island, island->name(), displacement);
 						++islandCount;
-						regionsIslands[0]->push_back(island);
+						regionsIslands[0].push_back(island);
 						state.atomToSection[island] = textSection;
 					}
-					else {
-						island = pos->second;
-					}
 					if (_s_log) fprintf(stderr, "using island %p %s for branch to %s from %s\n", island, island->name(), target->name(), atom->name());
 					fixupWithTarget->u.target = island;
 					fixupWithTarget->binding = ld::Fixup::bindingDirectlyBound;
 				}
 				else if ( displacement > kBranchLimit ) {
-					// create forward branch chain
-					const ld::Atom* nextTarget = target;
+					// create forward branch chain through the regions with srcAddr < address <= dstAddr
 					if (_s_log) fprintf(stderr, "need forward branching island srcAdr=0x%08llX, dstAdr=0x%08llX, target=%s\n",
 														srcAddr, dstAddr, target->name());
-					for (int i=kIslandRegionsCount-1; i >=0 ; --i) {
-						AtomToIsland* region = regionsMap[i];
-						int64_t islandRegionAddr = regionAddresses[i];
-						if ( (srcAddr < islandRegionAddr) && ((islandRegionAddr <= dstAddr)) ) { 
-							AtomToIsland::iterator pos = region->find(finalTargetAndOffset);
-							if ( pos == region->end() ) {
-								ld::Atom* island = makeBranchIsland(opts, fit->kind, i, nextTarget, finalTargetAndOffset, atom->section(), false);
-								(*region)[finalTargetAndOffset] = island;
-								if (_s_log) fprintf(stderr, "added forward branching island %p %s to region %d for %s\n", island, island->name(), i, atom->name());
-								regionsIslands[i]->push_back(island);
-								state.atomToSection[island] = textSection;
-								++islandCount;
-								nextTarget = island;
-							}
-							else {
-								nextTarget = pos->second;
-							}
+					const int firstRegion = std::upper_bound(regionAddresses.begin(), regionAddresses.end(), srcAddr) - regionAddresses.begin();
+					const int chainLength = islands.targetRegion - firstRegion;
+					while ( (int)islands.forward.size() < chainLength ) {
+						const int i = islands.targetRegion - 1 - islands.forward.size();
+						const ld::Atom* island = (i == 0) ? regionZeroIsland(islands) : NULL;
+						if ( island == NULL ) {
+							const ld::Atom* nextTarget = islands.forward.empty() ? target : islands.forward.back();
+							island = makeBranchIsland(opts, fit->kind, i, nextTarget, finalTargetAndOffset, atom->section(), false);
+							if (_s_log) fprintf(stderr, "added forward branching island %p %s to region %d for %s\n", island, island->name(), i, atom->name());
+							regionsIslands[i].push_back(island);
+							state.atomToSection[island] = textSection;
+							++islandCount;
 						}
+						islands.forward.push_back(island);
 					}
+					const ld::Atom* nextTarget = (chainLength > 0) ? islands.forward[chainLength-1] : target;
 					if (_s_log) fprintf(stderr, "using island %p %s for branch to %s from %s\n", nextTarget, nextTarget->name(), target->name(), atom->name());
 					fixupWithTarget->u.target = nextTarget;
 					fixupWithTarget->binding = ld::Fixup::bindingDirectlyBound;
 				}
-				else if ( displacement < (-kBranchLimit) ) {
-					// create back branching chain
-					const ld::Atom* prevTarget = target;
-					for (int i=0; i < kIslandRegionsCount ; ++i) {
-						AtomToIsland* region = regionsMap[i];
-						int64_t islandRegionAddr = regionAddresses[i];
-						if ( (dstAddr < islandRegionAddr) && (islandRegionAddr <= srcAddr) ) {
-							if (_s_log) fprintf(stderr, "need backward branching island srcAdr=0x%08llX, dstAdr=0x%08llX, target=%s\n", srcAddr, dstAddr, target->name());
-							AtomToIsland::iterator pos = region->find(finalTargetAndOffset);
-							if ( pos == region->end() ) {
-								ld::Atom* island = makeBranchIsland(opts, fit->kind, i, prevTarget, finalTargetAndOffset, atom->section(), false);
-								(*region)[finalTargetAndOffset] = island;
-								if (_s_log) fprintf(stderr, "added back branching island %p %s to region %d for %s\n", island, island->name(), i, atom->name());
-								regionsIslands[i]->push_back(island);
-								state.atomToSection[island] = textSection;
-								++islandCount;
-								prevTarget = island;
-							}
-							else {
-								prevTarget = pos->second;
-							}
+				else {
+					// create back branching chain through the regions with dstAddr < address <= srcAddr
+					if (_s_log) fprintf(stderr, "need backward branching island srcAdr=0x%08llX, dstAdr=0x%08llX, target=%s\n", srcAddr, dstAddr, target->name());
+					const int endRegion = std::upper_bound(regionAddresses.begin(), regionAddresses.end(), srcAddr) - regionAddresses.begin();
+					const int chainLength = endRegion - islands.targetRegion;
+					while ( (int)islands.backward.size() < chainLength ) {
+						const int i = islands.targetRegion + islands.backward.size();
+						const ld::Atom* island = (i == 0) ? regionZeroIsland(islands) : NULL;
+						if ( island == NULL ) {
+							const ld::Atom* prevTarget = islands.backward.empty() ? target : islands.backward.back();
+							island = makeBranchIsland(opts, fit->kind, i, prevTarget, finalTargetAndOffset, atom->section(), false);
+							if (_s_log) fprintf(stderr, "added back branching island %p %s to region %d for %s\n", island, island->name(), i, atom->name());
+							regionsIslands[i].push_back(island);
+							state.atomToSection[island] = textSection;
+							++islandCount;
 						}
+						islands.backward.push_back(island);
 					}
+					const ld::Atom* prevTarget = (chainLength > 0) ? islands.backward[chainLength-1] : target;
 					if (_s_log) fprintf(stderr, "using back island %p %s for %s\n", prevTarget, prevTarget->name(), atom->name());
 					fixupWithTarget->u.target = prevTarget;
 					fixupWithTarget->binding = ld::Fixup::bindingDirectlyBound;
@@ -645,8 +676,8 @@ static void makeIslandsForSection(const Options& opts, ld::Internal& state, ld::
 			const ld::Atom* atom = *ait;
 			newAtomList.push_back(atom);
 			if ( (regionIndex < kIslandRegionsCount) && (atom == branchIslandInsertionPoints[regionIndex]) ) {
-				std::vector<const ld::Atom*>* islands = regionsIslands[regionIndex];
-				newAtomList.insert(newAtomList.end(), islands->begin(), islands->end());
+				const std::vector<const ld::Atom*>& islands = regionsIslands[regionIndex];
+				newAtomList.insert(newAtomList.end(), islands.begin(), islands.end());
 				++regionIndex;
 			}
 		}
@@ -666,6 +697,10 @@ static void buildAddressMap(const Options& opts, ld::Internal& state) {
 	// Assign addresses to atoms in a side table
 	const bool log = false;
 	if ( log ) fprintf(stderr, "buildAddressMap()\n");
+	size_t atomCount = 0;
+	for (std::vector<ld::Internal::FinalSection*>::iterator sit = state.sections.begin(); sit != state.sections.end(); ++sit)
+		atomCount += (*sit)->atoms.size();
+	sAtomToAddress.reserve(atomCount);
 	for (std::vector<ld::Internal::FinalSection*>::iterator sit = state.sections.begin(); sit != state.sections.end(); ++sit) {
 		ld::Internal::FinalSection* sect = *sit;
 		uint16_t maxAlignment = 0;
@@ -48,7 +48,7 @@ class DeDupAliasAtom : public ld::Atom
 public:
 										DeDupAliasAtom(const ld::Atom* dupOf, const ld::Atom* replacement) :
 											ld::Atom(dupOf->section(), ld::Atom::definitionRegular, ld::Atom::combineNever,
-													dupOf->scope(), dupOf->contentType(), ld::Atom::symbolTableIn,
+													dupOf->scope(), dupOf->contentType(), dupOf->symbolTableInclusion(),
 													false, false, true, 0),
 											_dedupOf(dupOf),
 											_fixup(0, ld::Fixup::k1of1, ld::Fixup::kindNoneFollowOn, ld::Fixup::bindingDirectlyBound, replacement) {
@@ -79,6 +79,15 @@ namespace {
     CachedHashes    sSavedHashes;
     unsigned long   sHashCount = 0;
     unsigned long   sFixupCompareCount = 0;
+    std::unordered_map<const ld::Atom*, const ld::Atom*> sFoldedInto;
+
+    // references to an atom already folded away are compared as references to what replaced it
+    const ld::Atom* canonicalTarget(const ld::Atom* target) {
+        auto pos = sFoldedInto.find(target);
+        if ( pos != sFoldedInto.end() )
+            return pos->second;
+        return target;
+    }
 };
 
 
@@ -108,6 +117,8 @@ struct atom_hashing {
                 default:
                     break;
             }
+            if ( target != NULL )
+                target = canonicalTarget(target);
             // don't include calls to auto-hide functions in hash because they might be de-dup'ed
             switch ( fit->kind ) {
 #if SUPPORT_ARCH_arm64
@@ -186,6 +197,10 @@ struct atom_equal {
                default:
                     return false;
             }
+            if ( target1 != NULL )
+                target1 = canonicalTarget(target1);
+            if ( target2 != NULL )
+                target2 = canonicalTarget(target2);
             if ( target1 != target2 ) {
                 // targets must match unless they are both calls to functions that will de-dup together
     #if SUPPORT_ARCH_arm64
@@ -213,6 +228,10 @@ struct atom_equal {
     static bool equal(const ld::Atom* atom1, const ld::Atom* atom2, VisitedSet& visited) {
         if ( atom_hashing::hash(atom1) != atom_hashing::hash(atom2) )
             return false;
+        if ( atom1->size() != atom2->size() )
+            return false;
+        if ( memcmp(atom1->rawContentPointer(), atom2->rawContentPointer(), atom1->size()) != 0 )
+            return false;
         visited.atoms1.insert(atom1);
         visited.atoms2.insert(atom2);
         return sameFixups(atom1, atom2, visited);
@@ -226,53 +245,60 @@ struct atom_equal {
 
 
 
-void doPass(const Options& opts, ld::Internal& state)
+// Data can only be folded if nothing can observe that two copies became one.
+// Auto-hide atoms (weak_def_can_be_hidden, e.g. template vtables) carry the
+// compiler's promise that their address is not significant.  Nothing in
+// __objc_const is folded: the runtime writes to method lists (selector
+// uniquing, sorting, the fixed-up flag) and to other class data it realizes.
+static bool isFoldableData(const ld::Atom* atom)
 {
-	const bool log = false;
-	
-	// only de-duplicate in final linked images
-	if ( opts.outputKind() == Options::kObjectFile )
-		return;
-
-	// only de-duplicate for architectures that use relocations that don't store bits in instructions
-	if ( (opts.architecture() != CPU_TYPE_ARM64) && (opts.architecture() != CPU_TYPE_X86_64) )
-		return;
-
-    // support -no_deduplicate to suppress this pass
-    if ( ! opts.deduplicateFunctions() )
-        return;
+    if ( atom->dontDeadStrip() )
+        return false;
+    if ( atom->definition() != ld::Atom::definitionRegular )
+        return false;
+    if ( atom->rawContentPointer() == NULL )
+        return false;
+    return atom->autoHide();
+}
 
-    const bool verbose = opts.verboseDeduplicate();
+static bool isDataSectionToFold(const ld::Internal::FinalSection* sect)
+{
+    if ( sect->type() != ld::Section::typeUnclassified )
+        return false;
+    return ( strcmp(sect->sectionName(), "__const") == 0 );
+}
 
-    // find __text section
-    ld::Internal::FinalSection* textSection = NULL;
-    for (ld::Internal::FinalSection* sect : state.sections) {
-        if ( (sect->type() == ld::Section::typeCode) && (strcmp(sect->sectionName(), "__text") == 0) ) {
-            textSection = sect;
-            break;
-        }
-    }
-    if ( textSection == NULL )
-        return;
+// Replaces all but the first of each set of equal candidate atoms in sect with alias atoms.
+// Returns the number of bytes saved.
+static uint64_t deduplicateSection(ld::Internal& state, ld::Internal::FinalSection* sect, bool dataAtoms, bool verbose,
+                                   std::unordered_map<const ld::Atom*, const ld::Atom*>& replacementMap)
+{
+    const bool log = false;
 
-    // build map of auto-hide functions and their duplicates
+    // build map of candidate atoms and their duplicates
     // the key for the map is always the first element in the value vector
     // the key is always earlier in the atoms list then matching other atoms
-    sState = &state;
     std::unordered_map<const ld::Atom*, std::vector<const ld::Atom*>, atom_hashing, atom_equal> map;
-    std::unordered_set<const ld::Atom*> masterAtoms;
-    for (const ld::Atom* atom : textSection->atoms) {
+    for (const ld::Atom* atom : sect->atoms) {
         // ignore empty (alias) atoms
         if ( atom->size() == 0 )
             continue;
-        if ( atom->autoHide() )
+        if ( dataAtoms ? isFoldableData(atom) : atom->autoHide() ) {
+            // a data atom may only be folded into one with the same alignment
+            auto pos = map.find(atom);
+            if ( dataAtoms && (pos != map.end()) ) {
+                ld::Atom::Alignment masterAlign = pos->first->alignment();
+                if ( (masterAlign.powerOf2 != atom->alignment().powerOf2) || (masterAlign.modulus != atom->alignment().modulus) )
+                    continue;
+            }
             map[atom].push_back(atom);
-	}
+        }
+    }
 
     if ( log ) {
         for (auto& entry : map) {
             if ( entry.second.size() > 1 ) {
-                printf("Found following matching functions:\n");
+                printf("Found following matching atoms:\n");
                 for (const ld::Atom* atom : entry.second) {
                     printf("  %p %s\n", atom, atom->name());
                 }
@@ -284,38 +310,95 @@ void doPass(const Options& opts, ld::Internal& state)
     }
 
     // construct alias atoms to replace atoms found to be duplicates
-    unsigned atomsBeingComparedCount = 0;
     uint64_t dedupSavings = 0;
-    std::vector<const ld::Atom*>& textAtoms = textSection->atoms;
-    std::unordered_map<const ld::Atom*, const ld::Atom*> replacementMap;
+    std::vector<const ld::Atom*>& atoms = sect->atoms;
     for (auto& entry : map) {
         const ld::Atom* masterAtom = entry.first;
         std::vector<const ld::Atom*>& dups = entry.second;
-        atomsBeingComparedCount += dups.size();
         if ( dups.size() == 1 )
             continue;
-        if ( verbose )  {
-            dedupSavings += ((dups.size() - 1) * masterAtom->size());
-            fprintf(stderr, "deduplicate the following %lu functions (%llu bytes apiece):\n", dups.size(), masterAtom->size());
-        }
+        dedupSavings += ((dups.size() - 1) * masterAtom->size());
+        if ( verbose )
+            fprintf(stderr, "deduplicate the following %lu %s (%llu bytes apiece):\n", dups.size(), dataAtoms ? "data atoms" : "functions", masterAtom->size());
         for (const ld::Atom* dupAtom : dups) {
             if ( verbose )
                 fprintf(stderr, "    %s\n", dupAtom->name());
             if ( dupAtom == masterAtom )
                 continue;
             const ld::Atom* aliasAtom = new DeDupAliasAtom(dupAtom, masterAtom);
-            auto pos = std::find(textAtoms.begin(), textAtoms.end(), masterAtom);
-            if ( pos != textAtoms.end() ) {
-                textAtoms.insert(pos, aliasAtom);
-                state.atomToSection[aliasAtom] = textSection;
+            auto pos = std::find(atoms.begin(), atoms.end(), masterAtom);
+            if ( pos != atoms.end() ) {
+                atoms.insert(pos, aliasAtom);
+                state.atomToSection[aliasAtom] = sect;
                 replacementMap[dupAtom] = aliasAtom;
+                sFoldedInto[dupAtom] = masterAtom;
+                sFoldedInto[aliasAtom] = masterAtom;
             }
         }
     }
-    if ( verbose )  {
-        fprintf(stderr, "deduplication saved %llu bytes of __text\n", dedupSavings);
+    return dedupSavings;
+}
+
+
+void doPass(const Options& opts, ld::Internal& state)
+{
+	const bool log = false;
+	
+	// only de-duplicate in final linked images
+	if ( opts.outputKind() == Options::kObjectFile )
+		return;
+
+	// only de-duplicate for architectures that use relocations that don't store bits in instructions
+	if ( (opts.architecture() != CPU_TYPE_ARM64) && (opts.architecture() != CPU_TYPE_X86_64) )
+		return;
+
+    // support -no_deduplicate to suppress this pass
+    if ( ! opts.deduplicateFunctions() )
+        return;
+
+    const bool verbose = opts.verboseDeduplicate();
+
+    // find __text section
+    ld::Internal::FinalSection* textSection = NULL;
+    for (ld::Internal::FinalSection* sect : state.sections) {
+        if ( (sect->type() == ld::Section::typeCode) && (strcmp(sect->sectionName(), "__text") == 0) ) {
+            textSection = sect;
+            break;
+        }
+    }
+
+    sState = &state;
+    std::unordered_map<const ld::Atom*, const ld::Atom*> replacementMap;
+    std::vector<ld::Internal::FinalSection*> foldedSections;
+    if ( textSection != NULL ) {
+        uint64_t dedupSavings = deduplicateSection(state, textSection, false, verbose, replacementMap);
+        foldedSections.push_back(textSection);
+        if ( verbose )
+            fprintf(stderr, "deduplication saved %llu bytes of __text\n", dedupSavings);
     }
 
+    // data is folded after code so that tables of pointers to functions
+    // which were just folded together compare equal
+    if ( opts.deduplicateData() ) {
+        uint64_t dataSavings = 0;
+        for (ld::Internal::FinalSection* sect : state.sections) {
+            if ( !isDataSectionToFold(sect) )
+                continue;
+            uint64_t sectSavings = deduplicateSection(state, sect, true, verbose, replacementMap);
+            if ( sectSavings != 0 ) {
+                foldedSections.push_back(sect);
+                dataSavings += sectSavings;
+                if ( verbose )
+                    fprintf(stderr, "deduplication saved %llu bytes of %s/%s\n", sectSavings, sect->segmentName(), sect->sectionName());
+            }
+        }
+        if ( verbose || opts.printStatistics() )
+            fprintf(stderr, "data deduplication saved %llu bytes\n", dataSavings);
+    }
+
+    if ( replacementMap.empty() )
+        return;
+
     if ( log ) {
         fprintf(stderr, "replacement map:\n");
         for (auto& entry : replacementMap)
@@ -345,28 +428,29 @@ void doPass(const Options& opts, ld::Internal& state)
         }
     }
 
-    if ( log ) {
-        fprintf(stderr, "atoms before pruning:\n");
-        for (const ld::Atom* atom : textSection->atoms)
-            fprintf(stderr, "  %p (size=%llu) %sp\n", atom, atom->size(), atom->name());
+    // remove replaced atoms from sections
+    for (ld::Internal::FinalSection* sect : foldedSections) {
+        if ( log ) {
+            fprintf(stderr, "atoms before pruning:\n");
+            for (const ld::Atom* atom : sect->atoms)
+                fprintf(stderr, "  %p (size=%llu) %sp\n", atom, atom->size(), atom->name());
+        }
+        sect->atoms.erase(std::remove_if(sect->atoms.begin(), sect->atoms.end(),
+                    [&](const ld::Atom* atom) {
+                        return (replacementMap.count(atom) != 0);
+                    }),
+                    sect->atoms.end());
+        if ( log ) {
+            fprintf(stderr, "atoms after pruning:\n");
+            for (const ld::Atom* atom : sect->atoms)
+                fprintf(stderr, "  %p (size=%llu) %sp\n", atom, atom->size(), atom->name());
+        }
     }
-    // remove replaced atoms from section
-	textSection->atoms.erase(std::remove_if(textSection->atoms.begin(), textSection->atoms.end(),
-                [&](const ld::Atom* atom) {
-                    return (replacementMap.count(atom) != 0);
-                }),
-                textSection->atoms.end());
 
    for (auto& entry : replacementMap)
         state.atomToSection.erase(entry.first);
 
-    if ( log ) {
-        fprintf(stderr, "atoms after pruning:\n");
-        for (const ld::Atom* atom : textSection->atoms)
-            fprintf(stderr, "  %p (size=%llu) %sp\n", atom, atom->size(), atom->name());
-    }
-
-   //fprintf(stderr, "hash-count=%lu, fixup-compares=%lu, atom-count=%u\n", sHashCount, sFixupCompareCount, atomsBeingComparedCount);
+   //fprintf(stderr, "hash-count=%lu, fixup-compares=%lu\n", sHashCount, sFixupCompareCount);
 }
 
 
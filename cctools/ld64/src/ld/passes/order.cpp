@@ -68,6 +68,13 @@ namespace order {
 // order_file, if any entry is in a cluster (in "starts" map), then the entire cluster is
 // given ordinal overrides.
 //
+// If a -call_graph_profile is specified, the __text atoms named in it that the order_file
+// did not place are given override ordinals after those from the order_file.  They are laid
+// out with call-chain clustering: starting with the most called atom, each atom's cluster
+// is appended to the cluster of its most frequent caller as long as the merged cluster
+// fits in a page.  The clusters are then laid out from the densest (calls per byte) down.
+// Atoms not in the profile are cold and keep their default order after the profiled ones.
+//
 
 class Layout
 {
@@ -91,10 +98,27 @@ private:
 	
 	typedef std::map<const ld::Atom*, uint32_t> AtomToOrdinal;
 	
+	struct ProfileNode {
+		const ld::Atom*		start;		// first atom of the follow-on cluster
+		uint64_t			size;		// size of all atoms in the follow-on cluster
+		uint64_t			calls;		// calls to this node in the profile
+		uint32_t			cluster;	// index of the call chain cluster it is in
+		uint32_t			next;		// next node in the same call chain cluster
+	};
+
+	struct ProfileCluster {
+		uint32_t			head;
+		uint32_t			tail;
+		uint64_t			size;
+		uint64_t			calls;
+	};
+
 	const ld::Atom*		findAtom(const Options::OrderedSymbol& orderedSymbol);
 	void				buildNameTable();
 	void				buildFollowOnTables();
 	void				buildOrdinalOverrideMap();
+	void				buildCallGraphOrdinals(uint32_t& index);
+	uint32_t			profileNode(const char* name, std::vector<ProfileNode>& nodes, std::map<const ld::Atom*, uint32_t>& nodeIndex);
 	const ld::Atom*		follower(const ld::Atom* atom);
 	static bool			matchesObjectFile(const ld::Atom* atom, const char* objectFileLeafName);
 			bool		possibleToOrder(const ld::Internal::FinalSection*);
@@ -108,6 +132,7 @@ private:
 	AtomToOrdinal						_ordinalOverrideMap;
 	Comparer							_comparer;
 	bool								_haveOrderFile;
+	bool								_haveCallGraphProfile;
 
 	static bool							_s_log;
 };
@@ -115,7 +140,8 @@ private:
 bool Layout::_s_log = false;
 
 Layout::Layout(const Options& opts, ld::Internal& state)
-	: _options(opts), _state(state), _comparer(*this, state), _haveOrderFile(opts.orderedSymbolsCount() != 0)
+	: _options(opts), _state(state), _comparer(*this, state), _haveOrderFile(opts.orderedSymbolsCount() != 0),
+	  _haveCallGraphProfile(!opts.callGraphProfile().empty())
 {
 }
 
@@ -131,8 +157,8 @@ bool Layout::Comparer::operator()(const ld::Atom* left, const ld::Atom* right)
 	if ( right->contentType() == ld::Atom::typeSectionStart )
 		return false;
 
-	// if an -order_file is specified, then sorting is altered to sort those symbols first
-	if ( _layout._haveOrderFile ) {
+	// if an -order_file or -call_graph_profile is specified, then sorting is altered to sort those symbols first
+	if ( _layout._haveOrderFile || _layout._haveCallGraphProfile ) {
 		AtomToOrdinal::const_iterator leftPos  = _layout._ordinalOverrideMap.find(left);
 		AtomToOrdinal::const_iterator rightPos = _layout._ordinalOverrideMap.find(right);
 		AtomToOrdinal::const_iterator end = _layout._ordinalOverrideMap.end();
@@ -385,8 +411,8 @@ const ld::Atom* Layout::follower(const ld::Atom* atom)
 
 void Layout::buildFollowOnTables()
 {
-	// if no -order_file, then skip building follow on table
-	if ( ! _haveOrderFile )
+	// if no -order_file or -call_graph_profile, then skip building follow on table
+	if ( !_haveOrderFile && !_haveCallGraphProfile )
 		return;
 
 	// first make a pass to find all follow-on references and build start/next maps
@@ -491,8 +517,8 @@ private:
 
 void Layout::buildOrdinalOverrideMap()
 {
-	// if no -order_file, then skip building override map
-	if ( ! _haveOrderFile )
+	// if no -order_file or -call_graph_profile, then skip building override map
+	if ( !_haveOrderFile && !_haveCallGraphProfile )
 		return;
 
 	// build fast name->atom table
@@ -558,6 +584,10 @@ void Layout::buildOrdinalOverrideMap()
 		warning("only %u out of %lu order_file symbols were applicable", matchCount, _options.orderedSymbolsCount() );
 	}
 
+	// lay out the __text atoms in the call graph profile after those in the order file
+	if ( _haveCallGraphProfile )
+		this->buildCallGraphOrdinals(index);
+
 	// <rdar://problem/8612550> When order file used on data, turn ordered zero fill symbols into zeroed data
 	if ( ! moveToData.empty() ) {
 		// <rdar://problem/14919139> only move zero fill symbols to __data if there is a __data section
@@ -594,6 +624,144 @@ void Layout::buildOrdinalOverrideMap()
 
 }
 
+uint32_t Layout::profileNode(const char* name, std::vector<ProfileNode>& nodes, std::map<const ld::Atom*, uint32_t>& nodeIndex)
+{
+	Options::OrderedSymbol orderedSymbol;
+	orderedSymbol.symbolName = name;
+	orderedSymbol.objectFileName = NULL;
+	const ld::Atom* atom = this->findAtom(orderedSymbol);
+	if ( atom == NULL ) {
+		if ( _options.printOrderFileStatistics() )
+			warning("can't find match for call_graph_profile entry: %s", name);
+		return UINT32_MAX;
+	}
+	// only code is laid out by the profile, and the order_file takes precedence
+	if ( (atom->section().type() != ld::Section::typeCode) || (_ordinalOverrideMap.count(atom) != 0) )
+		return UINT32_MAX;
+
+	// atoms that must lay out together are one node
+	const ld::Atom* start = atom;
+	AtomToAtom::iterator pos = _followOnStarts.find(atom);
+	if ( pos != _followOnStarts.end() )
+		start = pos->second;
+	std::map<const ld::Atom*, uint32_t>::iterator npos = nodeIndex.find(start);
+	if ( npos != nodeIndex.end() )
+		return npos->second;
+
+	ProfileNode node;
+	node.start = start;
+	node.size = 0;
+	if ( pos != _followOnStarts.end() ) {
+		for (const ld::Atom* a = start; a != NULL; a = _followOnNexts[a]) {
+			if ( _ordinalOverrideMap.count(a) != 0 )
+				return UINT32_MAX;
+			node.size += a->size();
+		}
+	}
+	else {
+		node.size = atom->size();
+	}
+	node.calls = 0;
+	node.cluster = nodes.size();
+	node.next = UINT32_MAX;
+	nodeIndex[start] = nodes.size();
+	nodes.push_back(node);
+	return nodeIndex[start];
+}
+
+void Layout::buildCallGraphOrdinals(uint32_t& index)
+{
+	// map the profile's edges onto nodes, combining duplicate edges
+	std::vector<ProfileNode> nodes;
+	std::map<const ld::Atom*, uint32_t> nodeIndex;
+	std::map<std::pair<uint32_t, uint32_t>, uint64_t> edgeCounts;
+	const std::vector<Options::CallGraphEdge>& profile = _options.callGraphProfile();
+	for (std::vector<Options::CallGraphEdge>::const_iterator it=profile.begin(); it != profile.end(); ++it) {
+		uint32_t caller = this->profileNode(it->caller, nodes, nodeIndex);
+		uint32_t callee = this->profileNode(it->callee, nodes, nodeIndex);
+		if ( callee == UINT32_MAX )
+			continue;
+		nodes[callee].calls += it->count;
+		if ( (caller != UINT32_MAX) && (caller != callee) )
+			edgeCounts[std::make_pair(callee, caller)] += it->count;
+	}
+
+	// find the most frequent caller of each node
+	std::vector<uint32_t> hottestCaller(nodes.size(), UINT32_MAX);
+	std::vector<uint64_t> hottestCount(nodes.size(), 0);
+	for (std::map<std::pair<uint32_t, uint32_t>, uint64_t>::iterator it=edgeCounts.begin(); it != edgeCounts.end(); ++it) {
+		uint32_t callee = it->first.first;
+		if ( (hottestCaller[callee] == UINT32_MAX) || (it->second > hottestCount[callee]) ) {
+			hottestCaller[callee] = it->first.second;
+			hottestCount[callee] = it->second;
+		}
+	}
+
+	// start with each node in its own cluster, and visit the nodes from the most called down
+	// appending each one's cluster to the cluster of its most frequent caller
+	const uint64_t maxClusterSize = _options.segmentAlignment();
+	std::vector<ProfileCluster> clusters(nodes.size());
+	std::vector<uint32_t> byCalls(nodes.size());
+	for (uint32_t i=0; i < nodes.size(); ++i) {
+		clusters[i].head = i;
+		clusters[i].tail = i;
+		clusters[i].size = nodes[i].size;
+		clusters[i].calls = nodes[i].calls;
+		byCalls[i] = i;
+	}
+	std::stable_sort(byCalls.begin(), byCalls.end(), [&](uint32_t l, uint32_t r) { return nodes[l].calls > nodes[r].calls; });
+	for (std::vector<uint32_t>::iterator it=byCalls.begin(); it != byCalls.end(); ++it) {
+		uint32_t callerNode = hottestCaller[*it];
+		if ( callerNode == UINT32_MAX )
+			continue;
+		uint32_t from = nodes[*it].cluster;
+		uint32_t to = nodes[callerNode].cluster;
+		if ( (from == to) || (clusters[from].size + clusters[to].size > maxClusterSize) )
+			continue;
+		nodes[clusters[to].tail].next = clusters[from].head;
+		clusters[to].tail = clusters[from].tail;
+		clusters[to].size += clusters[from].size;
+		clusters[to].calls += clusters[from].calls;
+		for (uint32_t n = clusters[from].head; n != UINT32_MAX; n = nodes[n].next)
+			nodes[n].cluster = to;
+	}
+
+	// lay out the clusters from the densest down
+	std::vector<uint32_t> layout;
+	for (uint32_t i=0; i < clusters.size(); ++i) {
+		if ( nodes[clusters[i].head].cluster == i )
+			layout.push_back(i);
+	}
+	std::stable_sort(layout.begin(), layout.end(), [&](uint32_t l, uint32_t r) {
+		// compare calls/size without dividing, a zero size counts as one byte
+		uint64_t lsize = (clusters[l].size != 0) ? clusters[l].size : 1;
+		uint64_t rsize = (clusters[r].size != 0) ? clusters[r].size : 1;
+		return (double)clusters[l].calls * rsize > (double)clusters[r].calls * lsize;
+	});
+	uint32_t placedCount = 0;
+	for (std::vector<uint32_t>::iterator it=layout.begin(); it != layout.end(); ++it) {
+		for (uint32_t n = clusters[*it].head; n != UINT32_MAX; n = nodes[n].next) {
+			const ld::Atom* start = nodes[n].start;
+			if ( _followOnStarts.count(start) != 0 ) {
+				for (const ld::Atom* a = start; a != NULL; a = _followOnNexts[a]) {
+					_ordinalOverrideMap[a] = index++;
+					++placedCount;
+				}
+			}
+			else {
+				_ordinalOverrideMap[start] = index++;
+				++placedCount;
+			}
+			if (_s_log ) fprintf(stderr, "call graph profile placed %s in cluster %u\n", start->name(), *it);
+		}
+	}
+
+	if ( _options.printStatistics() ) {
+		fprintf(stderr, "call graph profile: placed %u atoms in %lu clusters, %lu profile entries\n",
+				placedCount, layout.size(), profile.size());
+	}
+}
+
 void Layout::doPass()
 {
 	const bool log = false;
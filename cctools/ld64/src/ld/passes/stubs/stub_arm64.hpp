@@ -338,12 +338,13 @@ ld::Section StubAtom::_s_section("__TEXT", "__stubs", ld::Section::typeStub);
 
 class NonLazyPointerAtom : public ld::Atom {
 public:
-				NonLazyPointerAtom(ld::passes::stubs::Pass& pass, const ld::Atom& stubTo)
+				NonLazyPointerAtom(ld::passes::stubs::Pass& pass, const ld::Atom& stubTo, bool weakImport=false)
 				: ld::Atom(_s_section, ld::Atom::definitionRegular, 
 							ld::Atom::combineNever, ld::Atom::scopeLinkageUnit, ld::Atom::typeNonLazyPointer, 
 							symbolTableNotIn, false, false, false, ld::Atom::Alignment(3)), 
 				_stubTo(stubTo),
 				_fixup1(0, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, &stubTo) {
+					_fixup1.weakImport = weakImport;
 					pass.addAtom(*this);
 				}
 
@@ -406,5 +407,48 @@ private:
 ld::Section KextStubAtom::_s_section("__TEXT", "__stubs", ld::Section::typeCode);
 
 
+//
+//  With chained fixups there is no lazy binding, so stubs jump through a non-lazy pointer
+//  which dyld binds at launch.
+//
+class NonLazyStubAtom : public ld::Atom {
+public:
+											NonLazyStubAtom(ld::passes::stubs::Pass& pass, const ld::Atom& stubTo, bool weakImport)
+				: ld::Atom(_s_section, ld::Atom::definitionRegular, ld::Atom::combineNever,
+							ld::Atom::scopeLinkageUnit, ld::Atom::typeStub, 
+							symbolTableNotIn, false, false, false, ld::Atom::Alignment(1)), 
+				_stubTo(stubTo), 
+				_nonLazyPointer(pass, stubTo, weakImport),
+				_fixup1(0, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressARM64Page21, &_nonLazyPointer),
+				_fixup2(4, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressARM64PageOff12, &_nonLazyPointer),
+				_fixup3(ld::Fixup::kindLinkerOptimizationHint, LOH_ARM64_ADRP_LDR, 0, 4) 
+					{ pass.addAtom(*this); }
+
+	virtual const ld::File*					file() const					{ return _stubTo.file(); }
+	virtual const char*						name() const					{ return _stubTo.name(); }
+	virtual uint64_t						size() const					{ return 12; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const {
+		OSWriteLittleInt32(&buffer[0], 0, 0x90000010); // ADRP  X16, non_lazy_pointer@page
+		OSWriteLittleInt32(&buffer[4], 0, 0xF9400210); // LDR   X16, [X16, non_lazy_pointer@pageoff]
+		OSWriteLittleInt32(&buffer[8], 0, 0xD61F0200); // BR    X16
+	}
+	virtual void							setScope(Scope)					{ }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return &_fixup1; }
+	virtual ld::Fixup::iterator				fixupsEnd()	const 				{ return &((ld::Fixup*)&_fixup3)[1]; }
+
+private:
+	const ld::Atom&							_stubTo;
+	NonLazyPointerAtom						_nonLazyPointer;
+	mutable ld::Fixup						_fixup1;
+	mutable ld::Fixup						_fixup2;
+	mutable ld::Fixup						_fixup3;
+	
+	static ld::Section						_s_section;
+};
+
+ld::Section NonLazyStubAtom::_s_section("__TEXT", "__stubs", ld::Section::typeStub);
+
+
 } // namespace arm64
 
@@ -351,12 +351,13 @@ ld::Section StubAtom::_s_section("__TEXT", "__stubs", ld::Section::typeStub);
 
 class NonLazyPointerAtom : public ld::Atom {
 public:
-											NonLazyPointerAtom(ld::passes::stubs::Pass& pass, const ld::Atom& stubTo)
+											NonLazyPointerAtom(ld::passes::stubs::Pass& pass, const ld::Atom& stubTo, bool weakImport=false)
 				: ld::Atom(_s_section, ld::Atom::definitionRegular, 
 							ld::Atom::combineNever, ld::Atom::scopeLinkageUnit, ld::Atom::typeNonLazyPointer, 
 							symbolTableNotIn, false, false, false, ld::Atom::Alignment(3)), 
 				_stubTo(stubTo),
 				_fixup1(0, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, &stubTo) {
+					_fixup1.weakImport = weakImport;
 					pass.addAtom(*this);
 				}
 
@@ -417,5 +418,46 @@ private:
 ld::Section KextStubAtom::_s_section("__TEXT", "__stubs", ld::Section::typeStub);
 
 
+//
+//  With chained fixups there is no lazy binding, so stubs jump through a non-lazy pointer
+//  which dyld binds at launch.
+//
+class NonLazyStubAtom : public ld::Atom {
+public:
+											NonLazyStubAtom(ld::passes::stubs::Pass& pass, const ld::Atom& stubTo, bool weakImport)
+				: ld::Atom(_s_section, ld::Atom::definitionRegular, ld::Atom::combineNever,
+							ld::Atom::scopeLinkageUnit, ld::Atom::typeStub, 
+							symbolTableNotIn, false, false, false, ld::Atom::Alignment(1)), 
+				_stubTo(stubTo), 
+				_nonLazyPointer(pass, stubTo, weakImport),
+				_fixup(2, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressX86PCRel32, &_nonLazyPointer) { pass.addAtom(*this); }
+
+	virtual const ld::File*					file() const					{ return _stubTo.file(); }
+	virtual const char*						name() const					{ return _stubTo.name(); }
+	virtual uint64_t						size() const					{ return 6; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const {
+			buffer[0] = 0xFF;		// jmp *foo$non_lazy_pointer(%rip)
+			buffer[1] = 0x25;
+			buffer[2] = 0x00;
+			buffer[3] = 0x00;
+			buffer[4] = 0x00;
+			buffer[5] = 0x00;
+	}
+	virtual void							setScope(Scope)					{ }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return &_fixup; }
+	virtual ld::Fixup::iterator				fixupsEnd()	const 				{ return &((ld::Fixup*)&_fixup)[1]; }
+
+private:
+	const ld::Atom&							_stubTo;
+	NonLazyPointerAtom						_nonLazyPointer;
+	mutable ld::Fixup						_fixup;
+	
+	static ld::Section						_s_section;
+};
+
+ld::Section NonLazyStubAtom::_s_section("__TEXT", "__stubs", ld::Section::typeStub);
+
+
 } // namespace x86_64 
 
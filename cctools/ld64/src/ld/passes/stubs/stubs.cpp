@@ -182,7 +182,7 @@ ld::Atom* Pass::makeStub(const ld::Atom& target, bool weakImport)
 	bool usingDataConst =  _options.useDataConstSegment();
 #endif
 
-	if ( usingCompressedLINKEDIT() && !forLazyDylib ) {
+	if ( usingCompressedLINKEDIT() && !forLazyDylib && !_options.makeChainedFixups() ) {
 		if ( _internal->compressedFastBinderProxy == NULL )
 			throwf("symbol dyld_stub_binder not found (normally in libSystem.dylib).  Needed to perform lazy binding to function %s", target.name());
 	}
@@ -200,6 +200,8 @@ ld::Atom* Pass::makeStub(const ld::Atom& target, bool weakImport)
 		case CPU_TYPE_X86_64:
 			if ( (_options.outputKind() == Options::kKextBundle) && _options.kextsUseStubs() ) 
 				return new ld::passes::stubs::x86_64::KextStubAtom(*this, target);
+			else if ( _options.makeChainedFixups() )
+				return new ld::passes::stubs::x86_64::NonLazyStubAtom(*this, target, weakImport);
 			else if ( usingCompressedLINKEDIT() && !forLazyDylib )
 				return new ld::passes::stubs::x86_64::StubAtom(*this, target, stubToGlobalWeakDef, stubToResolver, weakImport);
 			else
@@ -232,6 +234,8 @@ ld::Atom* Pass::makeStub(const ld::Atom& target, bool weakImport)
 		case CPU_TYPE_ARM64:
 			if ( (_options.outputKind() == Options::kKextBundle) && _options.kextsUseStubs() ) 
 				return new ld::passes::stubs::arm64::KextStubAtom(*this, target);
+			else if ( _options.makeChainedFixups() )
+				return new ld::passes::stubs::arm64::NonLazyStubAtom(*this, target, weakImport);
 			else
 				return new ld::passes::stubs::arm64::StubAtom(*this, target, stubToGlobalWeakDef, stubToResolver, weakImport, usingDataConst);
 			break;
@@ -336,6 +340,8 @@ void Pass::process(ld::Internal& state)
 					else
 						throwf("resolver functions (%s) can only be used when targeting Mac OS X 10.6 or later", atom->name());
 				}
+				if ( _options.makeChainedFixups() )
+					throwf("resolver functions (%s) can't be used with chained fixups, link without -fixup_chains", atom->name());
 				stubFor[atom] = NULL;	
 			}
 		}
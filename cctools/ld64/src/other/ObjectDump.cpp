@@ -31,9 +31,13 @@
 #include <mach-o/fat.h>
 #include <mach-o/loader.h>
 
+#include <unordered_map>
+#include <string>
+
 #include "MachOFileAbstraction.hpp"
 #include "parsers/macho_relocatable_file.h"
 #include "parsers/lto_file.h"
+#include "json_lines.h"
 
 #ifdef __GLIBCXX__
 #include <algorithm>
@@ -47,6 +51,7 @@ static bool			sShowSection			= true;
 static bool			sShowDefinitionKind		= true;
 static bool			sShowCombineKind		= true;
 static bool			sShowLineInfo			= true;
+static bool			sJSON					= false;
 
 static cpu_type_t		sPreferredArch = 0xFFFFFFFF;
 static cpu_subtype_t	sPreferredSubArch = 0xFFFFFFFF;
@@ -463,6 +468,7 @@ public:
 	virtual void doFile(const ld::File&) {} 
 private:
 	void			dumpAtom(const ld::Atom& atom);
+	void			dumpAtomJSON(const ld::Atom& atom);
 	const char*		scopeString(const ld::Atom&);
 	const char*		definitionString(const ld::Atom&);
 	const char*		combineString(const ld::Atom&);
@@ -475,6 +481,7 @@ private:
 	uint64_t		addressOfFirstAtomInSection(const ld::Section&);
 	
 	std::vector<const ld::Atom*> _atoms;
+	std::unordered_map<const ld::Section*, uint64_t> _sectionStarts;
 };
 
 const char*	dumper::scopeString(const ld::Atom& atom)
@@ -673,239 +680,351 @@ const char* dumper::referenceTargetAtomName(const ld::Fixup* ref)
 }
 
 
-void dumper::dumpFixup(const ld::Fixup* ref)
+// the phrase dumpFixup() prints for a fixup kind, without the target or addend
+static const char* fixupKindName(ld::Fixup::Kind kind)
 {
-	if ( ref->weakImport ) {
-		printf("weak_import ");
-	}
-	switch ( (ld::Fixup::Kind)(ref->kind) ) {
+	switch ( kind ) {
 		case ld::Fixup::kindNone:
-			printf("none");
-			break;
+			return "none";
 		case ld::Fixup::kindNoneFollowOn:
-			printf("followed by %s", referenceTargetAtomName(ref));
-			break;
+			return "followed by";
 		case ld::Fixup::kindNoneGroupSubordinate:
-			printf("group subordinate %s", referenceTargetAtomName(ref));
-			break;
+			return "group subordinate";
 		case ld::Fixup::kindNoneGroupSubordinateFDE:
-			printf("group subordinate FDE %s", referenceTargetAtomName(ref));
-			break;
+			return "group subordinate FDE";
 		case ld::Fixup::kindNoneGroupSubordinateLSDA:
-			printf("group subordinate LSDA %s", referenceTargetAtomName(ref));
-			break;
+			return "group subordinate LSDA";
 		case ld::Fixup::kindNoneGroupSubordinatePersonality:
-			printf("group subordinate personality %s", referenceTargetAtomName(ref));
-			break;
+			return "group subordinate personality";
 		case ld::Fixup::kindSetTargetAddress:
-			printf("%s", referenceTargetAtomName(ref));
-			break;
+			return "set target address";
 		case ld::Fixup::kindSubtractTargetAddress:
-			printf(" - %s", referenceTargetAtomName(ref));
-			break;
+			return "subtract target address";
 		case ld::Fixup::kindAddAddend:
-			printf(" + 0x%llX", ref->u.addend);
-			break;
+			return "add addend";
 		case ld::Fixup::kindSubtractAddend:
-			printf(" - 0x%llX", ref->u.addend);
-			break;
+			return "subtract addend";
 		case ld::Fixup::kindSetTargetImageOffset:
-			printf("imageOffset(%s)", referenceTargetAtomName(ref));
-			break;
+			return "imageOffset";
 		case ld::Fixup::kindSetTargetSectionOffset:
-			printf("sectionOffset(%s)", referenceTargetAtomName(ref));
-			break;
+			return "sectionOffset";
 		case ld::Fixup::kindStore8:
-			printf(", then store byte");
-			break;
+			return "store byte";
 		case ld::Fixup::kindStoreLittleEndian16:
-			printf(", then store 16-bit little endian");
-			break;
+			return "store 16-bit little endian";
 		case ld::Fixup::kindStoreLittleEndianLow24of32:
-			printf(", then store low 24-bit little endian");
-			break;
+			return "store low 24-bit little endian";
 		case ld::Fixup::kindStoreLittleEndian32:
-			printf(", then store 32-bit little endian");
-			break;
+			return "store 32-bit little endian";
 		case ld::Fixup::kindStoreLittleEndian64:
-			printf(", then store 64-bit little endian");
-			break;
+			return "store 64-bit little endian";
 		case ld::Fixup::kindStoreBigEndian16:
-			printf(", then store 16-bit big endian");
-			break;
+			return "store 16-bit big endian";
 		case ld::Fixup::kindStoreBigEndianLow24of32:
-			printf(", then store low 24-bit big endian");
-			break;
+			return "store low 24-bit big endian";
 		case ld::Fixup::kindStoreBigEndian32:
-			printf(", then store 32-bit big endian");
-			break;
+			return "store 32-bit big endian";
 		case ld::Fixup::kindStoreBigEndian64:
-			printf(", then store 64-bit big endian");
-			break;
+			return "store 64-bit big endian";
 		case ld::Fixup::kindStoreX86BranchPCRel8:
-			printf(", then store as x86 8-bit pcrel branch");
-			break;
+			return "store as x86 8-bit pcrel branch";
 		case ld::Fixup::kindStoreX86BranchPCRel32:
-			printf(", then store as x86 32-bit pcrel branch");
-			break;
+			return "store as x86 32-bit pcrel branch";
 		case ld::Fixup::kindStoreX86PCRel8:
-			printf(", then store as x86 8-bit pcrel");
-			break;
+			return "store as x86 8-bit pcrel";
 		case ld::Fixup::kindStoreX86PCRel16:
-			printf(", then store as x86 16-bit pcrel");
-			break;
+			return "store as x86 16-bit pcrel";
 		case ld::Fixup::kindStoreX86PCRel32:
-			printf(", then store as x86 32-bit pcrel");
-			break;
+			return "store as x86 32-bit pcrel";
 		case ld::Fixup::kindStoreX86PCRel32_1:
-			printf(", then store as x86 32-bit pcrel from +1");
-			break;
+			return "store as x86 32-bit pcrel from +1";
 		case ld::Fixup::kindStoreX86PCRel32_2:
-			printf(", then store as x86 32-bit pcrel from +2");
-			break;
+			return "store as x86 32-bit pcrel from +2";
 		case ld::Fixup::kindStoreX86PCRel32_4:
-			printf(", then store as x86 32-bit pcrel from +4");
-			break;
+			return "store as x86 32-bit pcrel from +4";
 		case ld::Fixup::kindStoreX86PCRel32GOTLoad:
-			printf(", then store as x86 32-bit pcrel GOT load");
-			break;
+			return "store as x86 32-bit pcrel GOT load";
 		case ld::Fixup::kindStoreX86PCRel32GOTLoadNowLEA:
-			printf(", then store as x86 32-bit pcrel GOT load -> LEA");
-			break;
+			return "store as x86 32-bit pcrel GOT load -> LEA";
 		case ld::Fixup::kindStoreX86PCRel32GOT:
-			printf(", then store as x86 32-bit pcrel GOT access");
-			break;
+			return "store as x86 32-bit pcrel GOT access";
 		case ld::Fixup::kindStoreX86PCRel32TLVLoad:
-			printf(", then store as x86 32-bit pcrel TLV load");
-			break;
+			return "store as x86 32-bit pcrel TLV load";
 		case ld::Fixup::kindStoreX86PCRel32TLVLoadNowLEA:
-			printf(", then store as x86 32-bit pcrel TLV load");
-			break;
+			return "store as x86 32-bit pcrel TLV load";
 		case ld::Fixup::kindStoreX86Abs32TLVLoad:
-			printf(", then store as x86 32-bit absolute TLV load");
-			break;
+			return "store as x86 32-bit absolute TLV load";
 		case ld::Fixup::kindStoreX86Abs32TLVLoadNowLEA:
-			printf(", then store as x86 32-bit absolute TLV load -> LEA");
-			break;
+			return "store as x86 32-bit absolute TLV load -> LEA";
 		case ld::Fixup::kindStoreARMBranch24:
-			printf(", then store as ARM 24-bit pcrel branch");
-			break;
+			return "store as ARM 24-bit pcrel branch";
 		case ld::Fixup::kindStoreThumbBranch22:
-			printf(", then store as Thumb 22-bit pcrel branch");
-			break;
+			return "store as Thumb 22-bit pcrel branch";
 		case ld::Fixup::kindStoreARMLoad12:
-			printf(", then store as ARM 12-bit pcrel load");
-			break;
+			return "store as ARM 12-bit pcrel load";
 		case ld::Fixup::kindStoreARMLow16:
-			printf(", then store low-16 in ARM movw");
-			break;
+			return "store low-16 in ARM movw";
 		case ld::Fixup::kindStoreARMHigh16:
-			printf(", then store high-16 in ARM movt");
-			break;
+			return "store high-16 in ARM movt";
 		case ld::Fixup::kindStoreThumbLow16:
-			printf(", then store low-16 in Thumb movw");
-			break;
+			return "store low-16 in Thumb movw";
 		case ld::Fixup::kindStoreThumbHigh16:
-			printf(", then store high-16 in Thumb movt");
-			break;
+			return "store high-16 in Thumb movt";
 		case ld::Fixup::kindStoreARM64Branch26:
-			printf(", then store as ARM64 26-bit pcrel branch");
-			break;
+			return "store as ARM64 26-bit pcrel branch";
 		case ld::Fixup::kindStoreARM64Page21:
-			printf(", then store as ARM64 21-bit pcrel ADRP");
-			break;
+			return "store as ARM64 21-bit pcrel ADRP";
 		case ld::Fixup::kindStoreARM64PageOff12:
-			printf(", then store as ARM64 12-bit offset");
-			break;
+			return "store as ARM64 12-bit offset";
 		case ld::Fixup::kindStoreARM64GOTLoadPage21:
-			printf(", then store as ARM64 21-bit pcrel ADRP of GOT");
-			break;
+			return "store as ARM64 21-bit pcrel ADRP of GOT";
 		case ld::Fixup::kindStoreARM64GOTLoadPageOff12:
-			printf(", then store as ARM64 12-bit page offset of GOT");
-			break;
+			return "store as ARM64 12-bit page offset of GOT";
 		case ld::Fixup::kindStoreARM64GOTLeaPage21:
-			printf(", then store as ARM64 21-bit pcrel ADRP of GOT lea");
-			break;
+			return "store as ARM64 21-bit pcrel ADRP of GOT lea";
 		case ld::Fixup::kindStoreARM64GOTLeaPageOff12:
-			printf(", then store as ARM64 12-bit page offset of GOT lea");
-			break;
+			return "store as ARM64 12-bit page offset of GOT lea";
 		case ld::Fixup::kindStoreARM64TLVPLoadPage21:
-			printf(", then store as ARM64 21-bit pcrel ADRP of TLVP");
-			break;
+			return "store as ARM64 21-bit pcrel ADRP of TLVP";
 		case ld::Fixup::kindStoreARM64TLVPLoadPageOff12:
-			printf(", then store as ARM64 12-bit page offset of TLVP");
-			break;
+			return "store as ARM64 12-bit page offset of TLVP";
 		case ld::Fixup::kindStoreARM64TLVPLoadNowLeaPage21:
-			printf(", then store as ARM64 21-bit pcrel ADRP of lea of TLVP");
-			break;
+			return "store as ARM64 21-bit pcrel ADRP of lea of TLVP";
 		case ld::Fixup::kindStoreARM64TLVPLoadNowLeaPageOff12:
-			printf(", then store as ARM64 12-bit page offset of lea of TLVP");
-			break;
+			return "store as ARM64 12-bit page offset of lea of TLVP";
 		case ld::Fixup::kindStoreARM64PointerToGOT:
-			printf(", then store as 64-bit pointer to GOT entry");
-			break;
+			return "store as 64-bit pointer to GOT entry";
 		case ld::Fixup::kindStoreARM64PCRelToGOT:
-			printf(", then store as 32-bit delta to GOT entry");
-			break;
+			return "store as 32-bit delta to GOT entry";
 		case ld::Fixup::kindDtraceExtra:
-			printf("dtrace static probe extra info");
-			break;
+			return "dtrace static probe extra info";
 		case ld::Fixup::kindStoreX86DtraceCallSiteNop:
-			printf("x86 dtrace static probe site");
-			break;
+			return "x86 dtrace static probe site";
 		case ld::Fixup::kindStoreX86DtraceIsEnableSiteClear:
-			printf("x86 dtrace static is-enabled site");
-			break;
+			return "x86 dtrace static is-enabled site";
 		case ld::Fixup::kindStoreARMDtraceCallSiteNop:
-			printf("ARM dtrace static probe site");
-			break;
+			return "ARM dtrace static probe site";
 		case ld::Fixup::kindStoreARMDtraceIsEnableSiteClear:
-			printf("ARM dtrace static is-enabled site");
-			break;
+			return "ARM dtrace static is-enabled site";
 		case ld::Fixup::kindStoreThumbDtraceCallSiteNop:
-			printf("Thumb dtrace static probe site");
-			break;
+			return "Thumb dtrace static probe site";
 		case ld::Fixup::kindStoreThumbDtraceIsEnableSiteClear:
-			printf("Thumb dtrace static is-enabled site");
-			break;
+			return "Thumb dtrace static is-enabled site";
 		case ld::Fixup::kindStoreARM64DtraceCallSiteNop:
-			printf("ARM64 dtrace static probe site");
-			break;
+			return "ARM64 dtrace static probe site";
 		case ld::Fixup::kindStoreARM64DtraceIsEnableSiteClear:
-			printf("ARM64 dtrace static is-enabled site");
-			break;
+			return "ARM64 dtrace static is-enabled site";
 		case ld::Fixup::kindLazyTarget:
-			printf("lazy reference to external symbol %s", referenceTargetAtomName(ref));
-			break;
+			return "lazy reference to external symbol";
 		case ld::Fixup::kindSetLazyOffset:
-			printf("offset of lazy binding info for %s", referenceTargetAtomName(ref));
+			return "offset of lazy binding info for";
+		case ld::Fixup::kindIslandTarget:
+			return "ultimate target of island";
+		case ld::Fixup::kindDataInCodeStartData:
+			return "start of data in code";
+		case ld::Fixup::kindDataInCodeStartJT8:
+			return "start of jump table 8 data in code";
+		case ld::Fixup::kindDataInCodeStartJT16:
+			return "start of jump table 16 data in code";
+		case ld::Fixup::kindDataInCodeStartJT32:
+			return "start of jump table 32 data in code";
+		case ld::Fixup::kindDataInCodeStartJTA32:
+			return "start of jump table absolute 32 data in code";
+		case ld::Fixup::kindDataInCodeEnd:
+			return "end of data in code";
+		case ld::Fixup::kindLinkerOptimizationHint:
+			return "ARM64 hint";
+		case ld::Fixup::kindStoreTargetAddressLittleEndian32:
+			return "store 32-bit little endian address of";
+		case ld::Fixup::kindStoreTargetAddressLittleEndian64:
+			return "store 64-bit little endian address of";
+		case ld::Fixup::kindStoreTargetAddressBigEndian32:
+			return "store 32-bit big endian address of";
+		case ld::Fixup::kindStoreTargetAddressBigEndian64:
+			return "store 64-bit big endian address of";
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32:
+			return "x86 store 32-bit pc-rel address of";
+		case ld::Fixup::kindStoreTargetAddressX86BranchPCRel32:
+			return "x86 store 32-bit pc-rel branch to";
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoad:
+			return "x86 store 32-bit pc-rel GOT load of";
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoadNowLEA:
+			return "x86 store 32-bit pc-rel lea of";
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoad:
+			return "x86 store 32-bit pc-rel TLV load of";
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoadNowLEA:
+			return "x86 store 32-bit pc-rel TLV lea of";
+		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoad:
+			return "x86 store 32-bit absolute TLV load of";
+		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoadNowLEA:
+			return "x86 store 32-bit absolute TLV lea of";
+		case ld::Fixup::kindStoreTargetAddressARMBranch24:
+			return "ARM store 24-bit pc-rel branch to";
+		case ld::Fixup::kindStoreTargetAddressThumbBranch22:
+			return "Thumb store 22-bit pc-rel branch to";
+		case ld::Fixup::kindStoreTargetAddressARMLoad12:
+			return "ARM store 12-bit pc-rel branch to";
+		case ld::Fixup::kindSetTargetTLVTemplateOffset:
+		case ld::Fixup::kindSetTargetTLVTemplateOffsetLittleEndian32:
+		case ld::Fixup::kindSetTargetTLVTemplateOffsetLittleEndian64:
+			return "tlv template offset of";
+		case ld::Fixup::kindStoreTargetAddressARM64Branch26:
+			return "ARM64 store 26-bit pcrel branch to";
+		case ld::Fixup::kindStoreTargetAddressARM64Page21:
+			return "ARM64 store 21-bit pcrel ADRP to";
+		case ld::Fixup::kindStoreTargetAddressARM64PageOff12:
+			return "ARM64 store 12-bit page offset of";
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPage21:
+			return "ARM64 store 21-bit pcrel ADRP to GOT for";
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPageOff12:
+			return "ARM64 store 12-bit page offset of GOT of";
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPage21:
+			return "ARM64 store 21-bit pcrel ADRP to GOT lea for";
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPageOff12:
+			return "ARM64 store 12-bit page offset of GOT lea of";
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPage21:
+			return "ARM64 store 21-bit pcrel ADRP to TLV for";
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPageOff12:
+			return "ARM64 store 12-bit page offset of TLV of";
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPage21:
+			return "ARM64 store 21-bit pcrel ADRP to lea for TLV for";
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPageOff12:
+			return "ARM64 store 12-bit page offset of lea for TLV of";
+	}
+	return "unknown";
+}
+
+void dumper::dumpFixup(const ld::Fixup* ref)
+{
+	if ( ref->weakImport ) {
+		printf("weak_import ");
+	}
+	const char* kindName = fixupKindName((ld::Fixup::Kind)(ref->kind));
+	switch ( (ld::Fixup::Kind)(ref->kind) ) {
+		case ld::Fixup::kindNone:
+		case ld::Fixup::kindDtraceExtra:
+		case ld::Fixup::kindStoreX86DtraceCallSiteNop:
+		case ld::Fixup::kindStoreX86DtraceIsEnableSiteClear:
+		case ld::Fixup::kindStoreARMDtraceCallSiteNop:
+		case ld::Fixup::kindStoreARMDtraceIsEnableSiteClear:
+		case ld::Fixup::kindStoreThumbDtraceCallSiteNop:
+		case ld::Fixup::kindStoreThumbDtraceIsEnableSiteClear:
+		case ld::Fixup::kindStoreARM64DtraceCallSiteNop:
+		case ld::Fixup::kindStoreARM64DtraceIsEnableSiteClear:
+		case ld::Fixup::kindDataInCodeStartData:
+		case ld::Fixup::kindDataInCodeStartJT8:
+		case ld::Fixup::kindDataInCodeStartJT16:
+		case ld::Fixup::kindDataInCodeStartJT32:
+		case ld::Fixup::kindDataInCodeStartJTA32:
+		case ld::Fixup::kindDataInCodeEnd:
+			printf("%s", kindName);
 			break;
+		case ld::Fixup::kindNoneFollowOn:
+		case ld::Fixup::kindNoneGroupSubordinate:
+		case ld::Fixup::kindNoneGroupSubordinateFDE:
+		case ld::Fixup::kindNoneGroupSubordinateLSDA:
+		case ld::Fixup::kindNoneGroupSubordinatePersonality:
+		case ld::Fixup::kindLazyTarget:
+		case ld::Fixup::kindSetLazyOffset:
 		case ld::Fixup::kindIslandTarget:
-			printf("ultimate target of island %s", referenceTargetAtomName(ref));
+		case ld::Fixup::kindStoreTargetAddressLittleEndian32:
+		case ld::Fixup::kindStoreTargetAddressLittleEndian64:
+		case ld::Fixup::kindStoreTargetAddressBigEndian32:
+		case ld::Fixup::kindStoreTargetAddressBigEndian64:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32:
+		case ld::Fixup::kindStoreTargetAddressX86BranchPCRel32:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoad:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoadNowLEA:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoad:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoadNowLEA:
+		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoad:
+		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoadNowLEA:
+		case ld::Fixup::kindStoreTargetAddressARMBranch24:
+		case ld::Fixup::kindStoreTargetAddressThumbBranch22:
+		case ld::Fixup::kindStoreTargetAddressARMLoad12:
+		case ld::Fixup::kindSetTargetTLVTemplateOffset:
+		case ld::Fixup::kindSetTargetTLVTemplateOffsetLittleEndian32:
+		case ld::Fixup::kindSetTargetTLVTemplateOffsetLittleEndian64:
+		case ld::Fixup::kindStoreTargetAddressARM64Branch26:
+		case ld::Fixup::kindStoreTargetAddressARM64Page21:
+		case ld::Fixup::kindStoreTargetAddressARM64PageOff12:
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPageOff12:
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPageOff12:
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPageOff12:
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPageOff12:
+			printf("%s %s", kindName, referenceTargetAtomName(ref));
 			break;
-		case ld::Fixup::kindDataInCodeStartData:
-			printf("start of data in code");
+		case ld::Fixup::kindSetTargetAddress:
+			printf("%s", referenceTargetAtomName(ref));
 			break;
-		case ld::Fixup::kindDataInCodeStartJT8:
-			printf("start of jump table 8 data in code");
+		case ld::Fixup::kindSubtractTargetAddress:
+			printf(" - %s", referenceTargetAtomName(ref));
 			break;
-		case ld::Fixup::kindDataInCodeStartJT16:
-			printf("start of jump table 16 data in code");
+		case ld::Fixup::kindAddAddend:
+			printf(" + 0x%llX", ref->u.addend);
 			break;
-		case ld::Fixup::kindDataInCodeStartJT32:
-			printf("start of jump table 32 data in code");
+		case ld::Fixup::kindSubtractAddend:
+			printf(" - 0x%llX", ref->u.addend);
 			break;
-		case ld::Fixup::kindDataInCodeStartJTA32:
-			printf("start of jump table absolute 32 data in code");
+		case ld::Fixup::kindSetTargetImageOffset:
+		case ld::Fixup::kindSetTargetSectionOffset:
+			printf("%s(%s)", kindName, referenceTargetAtomName(ref));
 			break;
-		case ld::Fixup::kindDataInCodeEnd:
-			printf("end of data in code");
+		case ld::Fixup::kindStore8:
+		case ld::Fixup::kindStoreLittleEndian16:
+		case ld::Fixup::kindStoreLittleEndianLow24of32:
+		case ld::Fixup::kindStoreLittleEndian32:
+		case ld::Fixup::kindStoreLittleEndian64:
+		case ld::Fixup::kindStoreBigEndian16:
+		case ld::Fixup::kindStoreBigEndianLow24of32:
+		case ld::Fixup::kindStoreBigEndian32:
+		case ld::Fixup::kindStoreBigEndian64:
+		case ld::Fixup::kindStoreX86BranchPCRel8:
+		case ld::Fixup::kindStoreX86BranchPCRel32:
+		case ld::Fixup::kindStoreX86PCRel8:
+		case ld::Fixup::kindStoreX86PCRel16:
+		case ld::Fixup::kindStoreX86PCRel32:
+		case ld::Fixup::kindStoreX86PCRel32_1:
+		case ld::Fixup::kindStoreX86PCRel32_2:
+		case ld::Fixup::kindStoreX86PCRel32_4:
+		case ld::Fixup::kindStoreX86PCRel32GOTLoad:
+		case ld::Fixup::kindStoreX86PCRel32GOTLoadNowLEA:
+		case ld::Fixup::kindStoreX86PCRel32GOT:
+		case ld::Fixup::kindStoreX86PCRel32TLVLoad:
+		case ld::Fixup::kindStoreX86PCRel32TLVLoadNowLEA:
+		case ld::Fixup::kindStoreX86Abs32TLVLoad:
+		case ld::Fixup::kindStoreX86Abs32TLVLoadNowLEA:
+		case ld::Fixup::kindStoreARMBranch24:
+		case ld::Fixup::kindStoreThumbBranch22:
+		case ld::Fixup::kindStoreARMLoad12:
+		case ld::Fixup::kindStoreARMLow16:
+		case ld::Fixup::kindStoreARMHigh16:
+		case ld::Fixup::kindStoreThumbLow16:
+		case ld::Fixup::kindStoreThumbHigh16:
+		case ld::Fixup::kindStoreARM64Branch26:
+		case ld::Fixup::kindStoreARM64Page21:
+		case ld::Fixup::kindStoreARM64PageOff12:
+		case ld::Fixup::kindStoreARM64GOTLoadPage21:
+		case ld::Fixup::kindStoreARM64GOTLoadPageOff12:
+		case ld::Fixup::kindStoreARM64GOTLeaPage21:
+		case ld::Fixup::kindStoreARM64GOTLeaPageOff12:
+		case ld::Fixup::kindStoreARM64TLVPLoadPage21:
+		case ld::Fixup::kindStoreARM64TLVPLoadPageOff12:
+		case ld::Fixup::kindStoreARM64TLVPLoadNowLeaPage21:
+		case ld::Fixup::kindStoreARM64TLVPLoadNowLeaPageOff12:
+		case ld::Fixup::kindStoreARM64PointerToGOT:
+		case ld::Fixup::kindStoreARM64PCRelToGOT:
+			printf(", then %s", kindName);
 			break;
 		case ld::Fixup::kindLinkerOptimizationHint:
 #if SUPPORT_ARCH_arm64
 			ld::Fixup::LOH_arm64 extra;
 			extra.addend = ref->u.addend;
-			printf("ARM64 hint: ");
+			printf("%s: ", kindName);
 			switch(extra.info.kind) {
 				case LOH_ARM64_ADRP_ADRP:
 					printf("ADRP-ADRP");
@@ -941,89 +1060,6 @@ void dumper::dumpFixup(const ld::Fixup* ref)
 				printf(", offset4=0x%X", (extra.info.delta4 << 2)  + ref->offsetInAtom);
 #endif			
 			break;
-		case ld::Fixup::kindStoreTargetAddressLittleEndian32:
-			printf("store 32-bit little endian address of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressLittleEndian64:
-			printf("store 64-bit little endian address of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressBigEndian32:
-			printf("store 32-bit big endian address of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressBigEndian64:
-			printf("store 64-bit big endian address of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86PCRel32:
-			printf("x86 store 32-bit pc-rel address of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86BranchPCRel32:
-			printf("x86 store 32-bit pc-rel branch to %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoad:
-			printf("x86 store 32-bit pc-rel GOT load of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoadNowLEA:
-			printf("x86 store 32-bit pc-rel lea of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoad:
-			printf("x86 store 32-bit pc-rel TLV load of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoadNowLEA:
-			printf("x86 store 32-bit pc-rel TLV lea of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoad:
-			printf("x86 store 32-bit absolute TLV load of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoadNowLEA:
-			printf("x86 store 32-bit absolute TLV lea of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARMBranch24:
-			printf("ARM store 24-bit pc-rel branch to %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressThumbBranch22:
-			printf("Thumb store 22-bit pc-rel branch to %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARMLoad12:
-			printf("ARM store 12-bit pc-rel branch to %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindSetTargetTLVTemplateOffset:
-		case ld::Fixup::kindSetTargetTLVTemplateOffsetLittleEndian32:
-		case ld::Fixup::kindSetTargetTLVTemplateOffsetLittleEndian64:
-			printf("tlv template offset of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64Branch26:
-			printf("ARM64 store 26-bit pcrel branch to %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64Page21:
-			printf("ARM64 store 21-bit pcrel ADRP to %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64PageOff12:
-			printf("ARM64 store 12-bit page offset of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPage21:
-			printf("ARM64 store 21-bit pcrel ADRP to GOT for %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPageOff12:
-			printf("ARM64 store 12-bit page offset of GOT of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPage21:
-			printf("ARM64 store 21-bit pcrel ADRP to GOT lea for %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPageOff12:
-			printf("ARM64 store 12-bit page offset of GOT lea of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPage21:
-			printf("ARM64 store 21-bit pcrel ADRP to TLV for %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPageOff12:
-			printf("ARM64 store 12-bit page offset of TLV of %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPage21:
-			printf("ARM64 store 21-bit pcrel ADRP to lea for TLV for %s", referenceTargetAtomName(ref));
-			break;
-		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPageOff12:
-			printf("ARM64 store 12-bit page offset of lea for TLV of %s", referenceTargetAtomName(ref));
-			break;
 		//default:
 		//	printf("unknown fixup");
 		//	break;
@@ -1032,15 +1068,10 @@ void dumper::dumpFixup(const ld::Fixup* ref)
 
 uint64_t dumper::addressOfFirstAtomInSection(const ld::Section& sect)
 {
-	uint64_t lowestAddr = (uint64_t)(-1);
-	for (std::vector<const ld::Atom*>::iterator it=_atoms.begin(); it != _atoms.end(); ++it) {
-		const ld::Atom* atom = *it;
-		if ( &atom->section() == &sect ) {
-			if ( atom->objectAddress() < lowestAddr )
-				lowestAddr = atom->objectAddress();
-		}
-	}
-	return lowestAddr;
+	std::unordered_map<const ld::Section*, uint64_t>::iterator pos = _sectionStarts.find(&sect);
+	if ( pos == _sectionStarts.end() )
+		return (uint64_t)(-1);
+	return pos->second;
 }
 
 void dumper::doAtom(const ld::Atom& atom)
@@ -1055,8 +1086,20 @@ void dumper::dump()
 	if ( sSort ) 
 		std::sort(_atoms.begin(), _atoms.end(), AtomSorter());
 
+	// lowest atom address in each section, used to name anonymous atoms
+	_sectionStarts.reserve(_atoms.size());
 	for (std::vector<const ld::Atom*>::iterator it=_atoms.begin(); it != _atoms.end(); ++it) {
-		this->dumpAtom(**it);
+		const ld::Atom* atom = *it;
+		std::pair<std::unordered_map<const ld::Section*, uint64_t>::iterator, bool> ins = _sectionStarts.insert(std::make_pair(&atom->section(), atom->objectAddress()));
+		if ( !ins.second && (atom->objectAddress() < ins.first->second) )
+			ins.first->second = atom->objectAddress();
+	}
+
+	for (std::vector<const ld::Atom*>::iterator it=_atoms.begin(); it != _atoms.end(); ++it) {
+		if ( sJSON )
+			this->dumpAtomJSON(**it);
+		else
+			this->dumpAtom(**it);
 	}
 }	
 
@@ -1098,56 +1141,69 @@ void dumper::dumpAtom(const ld::Atom& atom)
 	}
 	if ( atom.fixupsBegin() != atom.fixupsEnd() ) {
 		printf("fixups:\n");
-		for (unsigned int off=0; off < atom.size()+1; ++off) {
-			for (ld::Fixup::iterator it = atom.fixupsBegin(); it != atom.fixupsEnd(); ++it) {
-				if ( it->offsetInAtom == off ) {
-					switch ( it->clusterSize ) {
-						case ld::Fixup::k1of1:
-							printf("    0x%04X ", it->offsetInAtom);
-							dumpFixup(it);
-							break;
-						case ld::Fixup::k1of2:
-							printf("    0x%04X ", it->offsetInAtom);
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							break;
-						case ld::Fixup::k1of3:
-							printf("    0x%04X ", it->offsetInAtom);
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							break;
-						case ld::Fixup::k1of4:
-							printf("    0x%04X ", it->offsetInAtom);
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							break;
-						case ld::Fixup::k1of5:
-							printf("    0x%04X ", it->offsetInAtom);
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							++it;
-							dumpFixup(it);
-							break;
-						default:
-							printf("   BAD CLUSTER SIZE: cluster=%d\n", it->clusterSize);
-					}
-					printf("\n");
-				}
+		// visit fixups by offset, keeping their order within an offset, and
+		// skip the rest of a cluster already printed with its first fixup
+		std::vector<ld::Fixup::iterator> byOffset;
+		for (ld::Fixup::iterator fit = atom.fixupsBegin(); fit != atom.fixupsEnd(); ++fit) {
+			if ( fit->offsetInAtom <= atom.size() )
+				byOffset.push_back(fit);
+		}
+		std::stable_sort(byOffset.begin(), byOffset.end(), [](ld::Fixup::iterator left, ld::Fixup::iterator right) {
+			return (left->offsetInAtom < right->offsetInAtom);
+		});
+		ld::Fixup::iterator clusterEnd = NULL;
+		for (size_t i=0; i < byOffset.size(); ++i) {
+			ld::Fixup::iterator it = byOffset[i];
+			if ( (i == 0) || (it->offsetInAtom != byOffset[i-1]->offsetInAtom) )
+				clusterEnd = NULL;
+			if ( it < clusterEnd )
+				continue;
+			switch ( it->clusterSize ) {
+				case ld::Fixup::k1of1:
+					printf("    0x%04X ", it->offsetInAtom);
+					dumpFixup(it);
+					break;
+				case ld::Fixup::k1of2:
+					printf("    0x%04X ", it->offsetInAtom);
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					break;
+				case ld::Fixup::k1of3:
+					printf("    0x%04X ", it->offsetInAtom);
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					break;
+				case ld::Fixup::k1of4:
+					printf("    0x%04X ", it->offsetInAtom);
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					break;
+				case ld::Fixup::k1of5:
+					printf("    0x%04X ", it->offsetInAtom);
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					++it;
+					dumpFixup(it);
+					break;
+				default:
+					printf("   BAD CLUSTER SIZE: cluster=%d\n", it->clusterSize);
 			}
+			printf("\n");
+			clusterEnd = it + 1;
 		}
 	}
 	if ( sShowLineInfo ) {
@@ -1162,10 +1218,49 @@ void dumper::dumpAtom(const ld::Atom& atom)
 	printf("\n");
 }
 
+void dumper::dumpAtomJSON(const ld::Atom& atom)
+{
+	// makeName() and referenceTargetAtomName() share a static buffer
+	std::string name = makeName(atom);
+	std::string attrs = attributeString(atom);
+	if ( !attrs.empty() && (attrs[attrs.size()-1] == ' ') )
+		attrs.resize(attrs.size()-1);
+	json_begin("atom");
+	json_string_member("name", name.c_str());
+	json_uint_member("size", atom.size());
+	json_uint_member("align_modulus", atom.alignment().modulus);
+	json_uint_member("align", 1 << atom.alignment().powerOf2);
+	json_string_member("scope", scopeString(atom));
+	json_string_member("definition", definitionString(atom));
+	json_string_member("combine", combineString(atom));
+	json_string_member("symbol", inclusionString(atom));
+	json_string_member("attributes", attrs.c_str());
+	json_string_member("segment", atom.section().segmentName());
+	json_string_member("section", atom.section().sectionName());
+	if ( atom.contentType() == ld::Atom::typeCString ) {
+		uint8_t buffer[atom.size()+2];
+		atom.copyRawContent(buffer);
+		buffer[atom.size()] = '\0';
+		json_string_member("content", (char*)buffer);
+	}
+	json_end();
+	for (ld::Fixup::iterator it = atom.fixupsBegin(); it != atom.fixupsEnd(); ++it) {
+		json_begin("fixup");
+		json_string_member("atom", name.c_str());
+		json_uint_member("offset", it->offsetInAtom);
+		json_uint_member("cluster", it->clusterSize);
+		json_string_member("fixup_kind", fixupKindName((ld::Fixup::Kind)it->kind));
+		json_string_member("target", referenceTargetAtomName(it));
+		if ( it->weakImport )
+			json_bool_member("weak_import", true);
+		json_end();
+	}
+}
+
 static void dumpFile(ld::relocatable::File* file)
 {
 	// stabs debug info
-	if ( sDumpStabs && (file->debugInfo() == ld::relocatable::File::kDebugInfoStabs) ) {
+	if ( sDumpStabs && !sJSON && (file->debugInfo() == ld::relocatable::File::kDebugInfoStabs) ) {
 		const std::vector<ld::relocatable::File::Stab>* stabs = file->stabs();
 		if ( stabs != NULL )
 			dumpStabs(stabs);
@@ -1297,6 +1392,7 @@ usage()
 			"\t-only sym\tonly dump info about sym\n"
 			"\t-align\t\tonly print alignment info\n"
 			"\t-name\t\tonly print symbol names\n"
+			"\t-json\t\tprint one JSON object per atom and per fixup\n"
 		);
 }
 
@@ -1362,6 +1458,9 @@ int main(int argc, const char* argv[])
 					sPrintRestrict = true;
 					sPrintName = true;
 				}
+				else if ( strcmp(arg, "-json") == 0 ) {
+					sJSON = true;
+				}
 				else {
 					usage();
 					throwf("unknown option: %s\n", arg);
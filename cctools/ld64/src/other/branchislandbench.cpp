@@ -0,0 +1,212 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Benchmark for the branch island pass (passes/branch_island.cpp).  It builds a
+// synthetic Thumb2 __text section, by default 2M atoms of 64 to 574 bytes
+// (~400MB) with four bl's each.  Three quarters of the branches go to an atom
+// up to 20000 atoms further on, the rest to one of 512 far targets, so most
+// of the islands are shared.  With -preload every 7th atom goes into a code
+// section 1GB away, and the cross-section branches get absolute islands.  The
+// Options are parsed from an armv7 command line with an empty object file.
+//
+// The time for doPass() is printed to stderr.  With -print the final atom
+// list is written to stdout, one atom per line with its size and the targets
+// of its fixups, so that the plans of two versions of the pass can be diffed.
+// The input is always generated from the same seed.
+//
+// Not built by default:  make branchislandbench
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "Options.h"
+#include "ld.hpp"
+#include "InternalState.h"
+#include "branch_island.h"
+
+static ld::Section sHeaderSection("__TEXT", "__mach_header", ld::Section::typeMachHeader, true);
+static ld::Section sText("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sFarText("__FAR", "__text", ld::Section::typeCode);
+
+class BenchAtom : public ld::Atom
+{
+public:
+											BenchAtom(const ld::Section& sect, const char* name, uint64_t size)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													ld::Atom::scopeGlobal, ld::Atom::typeUnclassified, ld::Atom::symbolTableIn,
+													false, true, false, ld::Atom::Alignment(2)), _name(name), _size(size) { }
+
+	virtual const ld::File*					file() const					{ return NULL; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _size; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void									addBranch(uint32_t offset, const ld::Atom* target)
+	{
+		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressThumbBranch22, target));
+	}
+
+private:
+	const char*								_name;
+	uint64_t								_size;
+	std::vector<ld::Fixup>					_fixups;
+};
+
+static void usage()
+{
+	fprintf(stderr, "usage: branchislandbench [-preload] [-print] [atoms [branches-per-atom]]\n");
+	exit(1);
+}
+
+int main(int argc, const char* argv[])
+{
+	unsigned atomCount = 2000000;
+	unsigned branches = 4;
+	bool preload = false;
+	bool print = false;
+	std::vector<unsigned> counts;
+	for (int i=1; i < argc; ++i) {
+		if ( strcmp(argv[i], "-preload") == 0 )
+			preload = true;
+		else if ( strcmp(argv[i], "-print") == 0 )
+			print = true;
+		else if ( argv[i][0] != '-' )
+			counts.push_back(strtoul(argv[i], NULL, 0));
+		else
+			usage();
+	}
+	if ( counts.size() > 2 )
+		usage();
+	if ( counts.size() > 0 )
+		atomCount = counts[0];
+	if ( counts.size() > 1 )
+		branches = counts[1];
+	if ( atomCount < 512 )
+		usage();
+
+	char dir[] = "/tmp/branchislandbench.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string objectPath = std::string(dir) + "/empty.o";
+	FILE* f = fopen(objectPath.c_str(), "w");
+	if ( f == NULL ) {
+		perror(objectPath.c_str());
+		return 1;
+	}
+	fclose(f);
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("armv7");
+	args.push_back("-ios_version_min");
+	args.push_back("7.0");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back("/dev/null");
+	if ( preload ) {
+		args.push_back("-preload");
+		args.push_back("-segaddr");
+		args.push_back("__FAR");
+		args.push_back("0x40000000");
+	}
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+	Options* opts = NULL;
+	try {
+		opts = new Options(args.size()-1, &args[0]);
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "branchislandbench: can't parse the command line: %s\n", msg);
+		return 1;
+	}
+	unlink(objectPath.c_str());
+	rmdir(dir);
+
+	InternalState state(*opts);
+	BenchAtom header(sHeaderSection, "___mh_execute_header", 0);
+	state.addAtom(header);
+
+	srandom(1);
+	std::vector<BenchAtom*> atoms;
+	atoms.reserve(atomCount);
+	for (unsigned i=0; i < atomCount; ++i) {
+		char* name;
+		asprintf(&name, "_f%u", i);
+		bool second = preload && (i % 7 == 0);
+		atoms.push_back(new BenchAtom(second ? sFarText : sText, name, 64 + (random() % 256) * 2));
+	}
+	for (unsigned i=0; i < atomCount; ++i) {
+		for (unsigned b=0; b < branches; ++b) {
+			unsigned target;
+			if ( random() % 4 == 0 )
+				target = (random() % 512) * (atomCount/512);
+			else
+				target = (i + (random() % 20000)) % atomCount;
+			atoms[i]->addBranch(b*4, atoms[target]);
+		}
+		state.addAtom(*atoms[i]);
+	}
+	state.sortSections();
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	try {
+		ld::passes::branch_island::doPass(*opts, state);
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "branchislandbench: %s\n", msg);
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	size_t finalCount = 0;
+	for (std::vector<ld::Internal::FinalSection*>::iterator sit=state.sections.begin(); sit != state.sections.end(); ++sit) {
+		if ( (*sit)->type() == ld::Section::typeCode )
+			finalCount += (*sit)->atoms.size();
+	}
+	fprintf(stderr, "%u atoms, %lu after islands, %.3fs\n", atomCount, finalCount,
+			(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	if ( print ) {
+		for (std::vector<ld::Internal::FinalSection*>::iterator sit=state.sections.begin(); sit != state.sections.end(); ++sit) {
+			if ( (*sit)->type() != ld::Section::typeCode )
+				continue;
+			for (std::vector<const ld::Atom*>::iterator ait=(*sit)->atoms.begin(); ait != (*sit)->atoms.end(); ++ait) {
+				const ld::Atom* atom = *ait;
+				printf("%s %llu", atom->name(), (unsigned long long)atom->size());
+				for (ld::Fixup::iterator fit=atom->fixupsBegin(); fit != atom->fixupsEnd(); ++fit) {
+					if ( fit->binding == ld::Fixup::bindingDirectlyBound )
+						printf(" %s", fit->u.target->name());
+				}
+				printf("\n");
+			}
+		}
+	}
+	delete opts;
+	return 0;
+}
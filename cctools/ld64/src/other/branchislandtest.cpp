@@ -0,0 +1,292 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for the branch island pass (passes/branch_island.cpp).  A synthetic
+// Thumb2 __text section of ~40MB with near and far bl's is run through the
+// pass for an armv7 executable, and a smaller one split over __text and a
+// code section 1GB away for -preload.  The sections are then laid out, and
+// every bl must be in range, every branch must still reach its target
+// through the islands it goes to, and no region may have two islands for the
+// same target.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Options.h"
+#include "ld.hpp"
+#include "InternalState.h"
+#include "branch_island.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "branchislandtest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static ld::Section sHeaderSection("__TEXT", "__mach_header", ld::Section::typeMachHeader, true);
+static ld::Section sText("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sFarText("__FAR", "__text", ld::Section::typeCode);
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const char* name, uint64_t size)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													ld::Atom::scopeGlobal, ld::Atom::typeUnclassified, ld::Atom::symbolTableIn,
+													false, true, false, ld::Atom::Alignment(2)), _name(name), _size(size) { }
+
+	virtual const ld::File*					file() const					{ return NULL; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _size; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void									addBranch(uint32_t offset, const ld::Atom* target)
+	{
+		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressThumbBranch22, target));
+		_targets.push_back(target);
+	}
+	// the target each branch had before the pass
+	const std::vector<const ld::Atom*>&		targets() const					{ return _targets; }
+
+private:
+	const char*								_name;
+	uint64_t								_size;
+	std::vector<ld::Fixup>					_fixups;
+	std::vector<const ld::Atom*>			_targets;
+};
+
+// a bl reaches -16MB to +16MB-2 from the instruction after it
+static const int64_t kMinDisplacement = -16777216;
+static const int64_t kMaxDisplacement = 16777214;
+
+static std::string sObjectPath;
+
+static Options* makeOptions(bool preload)
+{
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("armv7");
+	args.push_back("-ios_version_min");
+	args.push_back("7.0");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back("/dev/null");
+	if ( preload ) {
+		args.push_back("-preload");
+		args.push_back("-segaddr");
+		args.push_back("__FAR");
+		args.push_back("0x40000000");
+	}
+	args.push_back(sObjectPath.c_str());
+	args.push_back(NULL);
+	try {
+		return new Options(args.size()-1, &args[0]);
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "branchislandtest: can't parse the command line: %s\n", msg);
+		exit(1);
+	}
+}
+
+// the branch fixup of an island or the absolute island's target
+static const ld::Atom* islandNext(const ld::Atom* island, bool& absolute, const ld::Atom*& finalTarget)
+{
+	const ld::Atom* next = NULL;
+	absolute = false;
+	finalTarget = NULL;
+	for (ld::Fixup::iterator fit=island->fixupsBegin(); fit != island->fixupsEnd(); ++fit) {
+		if ( fit->binding != ld::Fixup::bindingDirectlyBound )
+			continue;
+		switch ( fit->kind ) {
+			case ld::Fixup::kindIslandTarget:
+				finalTarget = fit->u.target;
+				break;
+			case ld::Fixup::kindSetTargetAddress:
+				absolute = true;
+				next = fit->u.target;
+				break;
+			case ld::Fixup::kindStoreTargetAddressThumbBranch22:
+				next = fit->u.target;
+				break;
+			default:
+				break;
+		}
+	}
+	return next;
+}
+
+// runs the pass over atoms, lays the sections out and checks every branch
+static void checkPass(const char* what, bool preload, unsigned atomCount, unsigned farTargets, unsigned nearRange)
+{
+	Options* opts = makeOptions(preload);
+	InternalState state(*opts);
+
+	TestAtom header(sHeaderSection, "___mh_execute_header", 0);
+	state.addAtom(header);
+
+	srandom(1);
+	std::vector<TestAtom*> atoms;
+	atoms.reserve(atomCount);
+	for (unsigned i=0; i < atomCount; ++i) {
+		char* name;
+		asprintf(&name, "_f%u", i);
+		bool second = preload && (i % 7 == 0);
+		atoms.push_back(new TestAtom(second ? sFarText : sText, name, 64 + (random() % 256) * 2));
+	}
+	for (unsigned i=0; i < atomCount; ++i) {
+		for (unsigned b=0; b < 4; ++b) {
+			unsigned target;
+			if ( random() % 4 == 0 )
+				target = (random() % farTargets) * (atomCount/farTargets);
+			else
+				target = (i + atomCount - nearRange + (random() % (2*nearRange))) % atomCount;
+			atoms[i]->addBranch(b*4, atoms[target]);
+		}
+		state.addAtom(*atoms[i]);
+	}
+	state.sortSections();
+
+	try {
+		ld::passes::branch_island::doPass(*opts, state);
+	}
+	catch (const char* msg) {
+		check(false, "%s: pass failed: %s", what, msg);
+		return;
+	}
+	state.setSectionSizesAndAlignments();
+	state.assignFileOffsets();
+
+	std::map<const ld::Atom*, uint64_t> addresses;
+	std::set<std::string> islandNames;
+	unsigned islandCount = 0;
+	unsigned absoluteCount = 0;
+	for (ld::Internal::FinalSection* sect : state.sections) {
+		for (const ld::Atom* atom : sect->atoms) {
+			addresses[atom] = sect->address + atom->sectionOffset();
+			if ( atom->contentType() == ld::Atom::typeBranchIsland ) {
+				++islandCount;
+				// the region is in the name, so a target has one island per region
+				check(islandNames.insert(atom->name()).second, "%s: two islands %s", what, atom->name());
+			}
+		}
+	}
+
+	// every bl is in range, including those of the islands
+	unsigned outOfRange = 0;
+	for (ld::Internal::FinalSection* sect : state.sections) {
+		for (const ld::Atom* atom : sect->atoms) {
+			for (ld::Fixup::iterator fit=atom->fixupsBegin(); fit != atom->fixupsEnd(); ++fit) {
+				if ( fit->kind != ld::Fixup::kindStoreTargetAddressThumbBranch22 )
+					continue;
+				check(fit->binding == ld::Fixup::bindingDirectlyBound, "%s: branch in %s is not bound", what, atom->name());
+				check(addresses.count(fit->u.target) != 0, "%s: %s branches to %s which is not in a section", what, atom->name(), fit->u.target->name());
+				int64_t displacement = addresses[fit->u.target] - (addresses[atom] + fit->offsetInAtom + 4);
+				if ( (displacement < kMinDisplacement) || (displacement > kMaxDisplacement) ) {
+					if ( ++outOfRange <= 10 )
+						check(false, "%s: branch at %s+%u to %s is 0x%llX bytes", what, atom->name(), fit->offsetInAtom,
+							  fit->u.target->name(), (long long)displacement);
+				}
+			}
+		}
+	}
+	check(outOfRange == 0, "%s: %u branches out of range", what, outOfRange);
+
+	// every branch reaches its old target through its islands
+	unsigned routedCount = 0;
+	for (TestAtom* atom : atoms) {
+		ld::Fixup::iterator fit = atom->fixupsBegin();
+		for (const ld::Atom* target : atom->targets()) {
+			const ld::Atom* next = fit->u.target;
+			if ( next != target )
+				++routedCount;
+			for (unsigned hops=0; (next != target) && (hops <= islandCount); ++hops) {
+				if ( next->contentType() != ld::Atom::typeBranchIsland )
+					break;
+				bool absolute;
+				const ld::Atom* finalTarget;
+				const ld::Atom* island = next;
+				next = islandNext(island, absolute, finalTarget);
+				check(finalTarget == target, "%s: island %s for %s is for %s", what, island->name(), target->name(),
+					  (finalTarget != NULL) ? finalTarget->name() : "nothing");
+				if ( absolute )
+					++absoluteCount;
+				if ( next == NULL )
+					break;
+			}
+			check(next == target, "%s: branch at %s+%u doesn't reach %s", what, atom->name(), fit->offsetInAtom, target->name());
+			++fit;
+		}
+	}
+
+	// the islands are shared
+	check(islandCount != 0, "%s: no islands", what);
+	check(islandCount < routedCount/2, "%s: %u islands for %u branches through islands", what, islandCount, routedCount);
+	check(preload == (absoluteCount != 0), "%s: %u branches through absolute islands", what, absoluteCount);
+
+	for (TestAtom* atom : atoms)
+		delete atom;
+	delete opts;
+}
+
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/branchislandtest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	sObjectPath = std::string(dir) + "/empty.o";
+	FILE* f = fopen(sObjectPath.c_str(), "w");
+	if ( f == NULL ) {
+		perror(sObjectPath.c_str());
+		return 1;
+	}
+	fclose(f);
+
+	// ~40MB, three regions of islands, with forward and backward chains
+	checkPass("executable", false, 125000, 512, 20000);
+	// a small __text and __FAR,__text, the branches between them go through absolute islands
+	checkPass("preload", true, 20000, 256, 2000);
+
+	unlink(sObjectPath.c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "branchislandtest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,201 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Round-trip test for the DYLD_CHAINED_PTR_64 pointer encoding that ld64
+// writes with -fixup_chains and dyldinfo -fixups decodes.  Encoded pointers
+// are checked field by field against bitfield structs laid out the way dyld
+// declares them, so an encoder and decoder that agree with each other but not
+// with dyld still fail.  Chains through a page are then built and walked the
+// way OutputFile::writeChainedFixups() and dyldinfo do.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "MachOFileAbstraction.hpp"
+
+// as declared in dyld's <mach-o/fixup-chains.h>
+struct dyld_chained_ptr_64_rebase
+{
+	uint64_t	target   : 36,
+				high8    :  8,
+				reserved :  7,
+				next     : 12,
+				bind     :  1;
+};
+
+struct dyld_chained_ptr_64_bind
+{
+	uint64_t	ordinal  : 24,
+				addend   :  8,
+				reserved : 19,
+				next     : 12,
+				bind     :  1;
+};
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "chainedfixupstest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static void testBind(uint32_t ordinal, uint8_t addend, uint32_t next)
+{
+	uint64_t value = dyld_chained_ptr_64::bind(ordinal, addend, next);
+	dyld_chained_ptr_64_bind fields;
+	memcpy(&fields, &value, sizeof(fields));
+	check(fields.bind == 1, "bind 0x%016llX", value);
+	check(fields.ordinal == ordinal, "bind 0x%016llX ordinal %u", value, ordinal);
+	check(fields.addend == addend, "bind 0x%016llX addend %u", value, addend);
+	check(fields.reserved == 0, "bind 0x%016llX", value);
+	check(fields.next == next, "bind 0x%016llX next %u", value, next);
+
+	check(dyld_chained_ptr_64::isBind(value), "bind 0x%016llX", value);
+	check(dyld_chained_ptr_64::bindOrdinal(value) == ordinal, "bind 0x%016llX ordinal %u", value, ordinal);
+	check(dyld_chained_ptr_64::bindAddend(value) == addend, "bind 0x%016llX addend %u", value, addend);
+	check(dyld_chained_ptr_64::next(value) == next, "bind 0x%016llX next %u", value, next);
+}
+
+static void testRebase(uint64_t target, uint8_t high8, uint32_t next)
+{
+	uint64_t value = dyld_chained_ptr_64::rebase(target, high8, next);
+	dyld_chained_ptr_64_rebase fields;
+	memcpy(&fields, &value, sizeof(fields));
+	check(fields.bind == 0, "rebase 0x%016llX", value);
+	check(fields.target == target, "rebase 0x%016llX target 0x%llX", value, target);
+	check(fields.high8 == high8, "rebase 0x%016llX high8 0x%X", value, high8);
+	check(fields.reserved == 0, "rebase 0x%016llX", value);
+	check(fields.next == next, "rebase 0x%016llX next %u", value, next);
+
+	check(!dyld_chained_ptr_64::isBind(value), "rebase 0x%016llX", value);
+	check(dyld_chained_ptr_64::rebaseTarget(value) == target, "rebase 0x%016llX target 0x%llX", value, target);
+	check(dyld_chained_ptr_64::rebaseHigh8(value) == high8, "rebase 0x%016llX high8 0x%X", value, high8);
+	check(dyld_chained_ptr_64::next(value) == next, "rebase 0x%016llX next %u", value, next);
+}
+
+struct Fixup
+{
+	uint32_t	offset;
+	bool		bind;
+	uint32_t	ordinal;
+	uint8_t		addend;
+	uint64_t	target;
+	uint8_t		high8;
+
+	bool operator<(const Fixup& rhs) const { return offset < rhs.offset; }
+};
+
+// builds one chain through a 16KB page from random pointers and walks it back
+static void testPage(unsigned seed)
+{
+	const uint32_t pageSize = 0x4000;
+	srand(seed);
+	std::vector<Fixup> fixups;
+	std::vector<bool> used(pageSize/8, false);
+	unsigned count = 1 + rand() % 300;
+	for (unsigned i=0; i < count; ++i) {
+		Fixup fixup;
+		// 4-byte aligned, as chains allow, but not overlapping
+		fixup.offset = (rand() % (pageSize/8)) * 8 + ((rand() % 4 == 0) ? 4 : 0);
+		if ( (fixup.offset + 8 > pageSize) || used[fixup.offset/8] || ((fixup.offset % 8 != 0) && used[fixup.offset/8+1]) )
+			continue;
+		used[fixup.offset/8] = true;
+		if ( fixup.offset % 8 != 0 )
+			used[fixup.offset/8+1] = true;
+		fixup.bind = (rand() % 2) == 0;
+		fixup.ordinal = rand() & 0xFFFFFF;
+		fixup.addend = rand() & 0xFF;
+		fixup.target = (((uint64_t)rand() << 32) | (uint32_t)rand()) & 0xFFFFFFFFFULL;
+		fixup.high8 = rand() & 0xFF;
+		fixups.push_back(fixup);
+	}
+	std::sort(fixups.begin(), fixups.end());
+
+	std::vector<uint8_t> page(pageSize, 0);
+	for (size_t i=0; i < fixups.size(); ++i) {
+		const Fixup& fixup = fixups[i];
+		uint32_t next = (i+1 < fixups.size()) ? (fixups[i+1].offset - fixup.offset) / 4 : 0;
+		uint64_t value = fixup.bind ? dyld_chained_ptr_64::bind(fixup.ordinal, fixup.addend, next)
+									: dyld_chained_ptr_64::rebase(fixup.target, fixup.high8, next);
+		memcpy(&page[fixup.offset], &value, sizeof(value));
+	}
+
+	size_t index = 0;
+	for (uint32_t offset = fixups[0].offset; ; ++index) {
+		if ( index >= fixups.size() ) {
+			check(index < fixups.size(), "seed %u: chain is longer than %lu pointers", seed, fixups.size());
+			return;
+		}
+		const Fixup& fixup = fixups[index];
+		uint64_t value;
+		memcpy(&value, &page[offset], sizeof(value));
+		check(offset == fixup.offset, "seed %u: pointer %lu at 0x%X, expected 0x%X", seed, index, offset, fixup.offset);
+		check(dyld_chained_ptr_64::isBind(value) == fixup.bind, "seed %u: pointer at 0x%X", seed, offset);
+		if ( fixup.bind ) {
+			check(dyld_chained_ptr_64::bindOrdinal(value) == fixup.ordinal, "seed %u: bind at 0x%X", seed, offset);
+			check(dyld_chained_ptr_64::bindAddend(value) == fixup.addend, "seed %u: bind at 0x%X", seed, offset);
+		}
+		else {
+			check(dyld_chained_ptr_64::rebaseTarget(value) == fixup.target, "seed %u: rebase at 0x%X", seed, offset);
+			check(dyld_chained_ptr_64::rebaseHigh8(value) == fixup.high8, "seed %u: rebase at 0x%X", seed, offset);
+		}
+		uint32_t next = dyld_chained_ptr_64::next(value);
+		if ( next == 0 )
+			break;
+		offset += next * 4;
+	}
+	check(index+1 == fixups.size(), "seed %u: chain has %lu pointers, expected %lu", seed, index+1, fixups.size());
+}
+
+int main(int argc, const char* argv[])
+{
+	static const uint32_t ordinals[] = { 0, 1, 2, 0xFD, 0xFE, 0xFF, 0x100, 0x123456, 0xFFFFFF };
+	static const uint32_t nexts[] = { 0, 1, 2, 0x7FF, 0x800, 0xFFF };
+	for (size_t o=0; o < sizeof(ordinals)/sizeof(ordinals[0]); ++o) {
+		for (size_t n=0; n < sizeof(nexts)/sizeof(nexts[0]); ++n) {
+			for (unsigned addend=0; addend < 256; ++addend)
+				testBind(ordinals[o], addend, nexts[n]);
+		}
+	}
+
+	static const uint64_t targets[] = { 0, 1, 0x4000, 0x100000000ULL, 0x7FFFFFFFFULL, 0x800000000ULL, 0xFFFFFFFFFULL };
+	for (size_t t=0; t < sizeof(targets)/sizeof(targets[0]); ++t) {
+		for (size_t n=0; n < sizeof(nexts)/sizeof(nexts[0]); ++n) {
+			for (unsigned high8=0; high8 < 256; ++high8)
+				testRebase(targets[t], high8, nexts[n]);
+		}
+	}
+
+	for (unsigned seed=1; seed <= 200; ++seed)
+		testPage(seed);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "chainedfixupstest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
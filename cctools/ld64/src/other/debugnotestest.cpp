@@ -0,0 +1,533 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for the debug notes OutputFile synthesizes (synthesizeDebugNotes(),
+// makeDebugNotesForFile(), copyStabsForFile() and appendDebugNotes()).  The
+// notes are made per file on worker threads and then joined up, the result
+// must be the stabs the single pass over all atoms made before.  Synthetic
+// x86_64 dylibs are written from object files with DWARF, with stabs and
+// without debug info, and state.stabs is compared with the notes made by a
+// copy of that single pass.  The object files include one that continues the
+// translation unit of the file before it, one that changes translation unit
+// and back, one that has the leaf name of another's translation unit in a
+// different directory, and functions whose line info repeats paths seen in
+// the same and in earlier files.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+#include "Options.h"
+#include "ld.hpp"
+#include "InternalState.h"
+#include "OutputFile.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "debugnotestest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+typedef ld::relocatable::File::Stab Stab;
+
+static ld::Section sHeaderSection("__TEXT", "__mach_header", ld::Section::typeMachHeader, true);
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sDataSection("__DATA", "__data", ld::Section::typeUnclassified);
+
+class TestObject : public ld::relocatable::File
+{
+public:
+											TestObject(const char* path, uint32_t ordinal, DebugInfoKind debugInfo)
+												: ld::relocatable::File(path, 1000+ordinal, ld::File::Ordinal::makeArgOrdinal(ordinal)),
+												  _debugInfo(debugInfo) { }
+
+	virtual bool							forEachAtom(AtomHandler&) const					{ return false; }
+	virtual bool							justInTimeforEachAtom(const char*, AtomHandler&) const { return false; }
+	virtual DebugInfoKind					debugInfo() const								{ return _debugInfo; }
+	virtual const std::vector<Stab>*		stabs() const									{ return &_stabs; }
+	virtual bool							canScatterAtoms() const							{ return true; }
+	virtual LinkerOptionsList*				linkerOptions() const							{ return NULL; }
+
+	void									addStab(const ld::Atom* atom, uint8_t type, uint8_t other, const char* string)
+	{
+		Stab stab;
+		stab.atom	= atom;
+		stab.type	= type;
+		stab.other	= other;
+		stab.desc	= 0;
+		stab.value	= 0;
+		stab.string	= string;
+		_stabs.push_back(stab);
+	}
+
+private:
+	DebugInfoKind							_debugInfo;
+	std::vector<Stab>						_stabs;
+};
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const ld::File* file, const char* source, const char* name,
+													 ld::Atom::Scope scope=ld::Atom::scopeGlobal,
+													 ld::Atom::SymbolTableInclusion inclusion=ld::Atom::symbolTableIn)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													scope, ld::Atom::typeUnclassified, inclusion,
+													false, false, false, ld::Atom::Alignment(2)),
+												  _file(file), _source(source), _name(name) { }
+
+	virtual const ld::File*					file() const					{ return _file; }
+	virtual const char*						translationUnitSource() const	{ return _source; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return 8; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { memset(buffer, 0, 8); }
+	virtual LineInfo::iterator				beginLineInfo() const			{ return (LineInfo*)_lineInfo.data(); }
+	virtual LineInfo::iterator				endLineInfo() const				{ return (LineInfo*)_lineInfo.data() + _lineInfo.size(); }
+
+	// the source files of the lines of this function, in order
+	void									addLines(const std::vector<const char*>& fileNames)
+	{
+		for (const char* fileName : fileNames)
+			_lineInfo.push_back({ fileName, (uint32_t)(_lineInfo.size()), (uint32_t)(10*_lineInfo.size()+1) });
+	}
+
+private:
+	const ld::File*							_file;
+	const char*								_source;
+	const char*								_name;
+	std::vector<LineInfo>					_lineInfo;
+};
+
+
+// used to sort atoms with debug notes
+class DebugNoteSorter
+{
+public:
+	bool operator()(const ld::Atom* left, const ld::Atom* right) const
+	{
+		// first sort by reader
+		ld::File::Ordinal leftFileOrdinal  = left->file()->ordinal();
+		ld::File::Ordinal rightFileOrdinal = right->file()->ordinal();
+		if ( leftFileOrdinal!= rightFileOrdinal)
+			return (leftFileOrdinal < rightFileOrdinal);
+
+		// then sort by atom objectAddress
+		uint64_t leftAddr  = left->finalAddress();
+		uint64_t rightAddr = right->finalAddress();
+		return leftAddr < rightAddr;
+	}
+};
+
+// The debug notes of the single pass OutputFile::synthesizeDebugNotes() made
+// before they were built per file.  The object files of the test have full
+// paths, so assureFullPath() is not needed, and the dylibs have no dtrace
+// probes.  Stabs copied from .o files are in file order and their N_SO atom
+// is the lowest addressed atom of the file, as they are now; the single pass
+// used the order of the atom pointers for both.
+static void singlePassDebugNotes(const ld::Internal& state, std::vector<Stab>& stabs)
+{
+	// make a vector of atoms that come from files compiled with dwarf debug info
+	std::vector<const ld::Atom*> atomsNeedingDebugNotes;
+	std::set<const ld::Atom*> atomsWithStabs;
+	const ld::relocatable::File* objFile = NULL;
+	bool objFileHasDwarf = false;
+	bool objFileHasStabs = false;
+	for (std::vector<ld::Internal::FinalSection*>::const_iterator sit = state.sections.begin(); sit != state.sections.end(); ++sit) {
+		ld::Internal::FinalSection* sect = *sit;
+		for (std::vector<const ld::Atom*>::iterator ait = sect->atoms.begin(); ait != sect->atoms.end(); ++ait) {
+			const ld::Atom* atom = *ait;
+			// no stabs for atoms that would not be in the symbol table
+			if ( atom->symbolTableInclusion() == ld::Atom::symbolTableNotIn )
+				continue;
+			if ( atom->symbolTableInclusion() == ld::Atom::symbolTableNotInFinalLinkedImages )
+				continue;
+			if ( atom->symbolTableInclusion() == ld::Atom::symbolTableInWithRandomAutoStripLabel )
+				continue;
+			// no stabs for absolute symbols
+			if ( atom->definition() == ld::Atom::definitionAbsolute )
+				continue;
+			// no stabs for .eh atoms
+			if ( atom->contentType() == ld::Atom::typeCFI )
+				continue;
+			// no stabs for string literal atoms
+			if ( atom->contentType() == ld::Atom::typeCString )
+				continue;
+			const ld::File* file = atom->file();
+			if ( file != NULL ) {
+				if ( file != objFile ) {
+					objFileHasDwarf = false;
+					objFileHasStabs = false;
+					objFile = dynamic_cast<const ld::relocatable::File*>(file);
+					if ( objFile != NULL ) {
+						switch ( objFile->debugInfo() ) {
+							case ld::relocatable::File::kDebugInfoNone:
+								break;
+							case ld::relocatable::File::kDebugInfoDwarf:
+								objFileHasDwarf = true;
+								break;
+							case ld::relocatable::File::kDebugInfoStabs:
+							case ld::relocatable::File::kDebugInfoStabsUUID:
+								objFileHasStabs = true;
+								break;
+						}
+					}
+				}
+				if ( objFileHasDwarf )
+					atomsNeedingDebugNotes.push_back(atom);
+				if ( objFileHasStabs )
+					atomsWithStabs.insert(atom);
+			}
+		}
+	}
+
+	// sort by file ordinal then atom ordinal
+	std::sort(atomsNeedingDebugNotes.begin(), atomsNeedingDebugNotes.end(), DebugNoteSorter());
+
+	// synthesize "debug notes" and add them to master stabs vector
+	const char* dirPath = NULL;
+	const char* filename = NULL;
+	bool wroteStartSO = false;
+	std::unordered_set<std::string>  seenFiles;
+	for (std::vector<const ld::Atom*>::iterator it=atomsNeedingDebugNotes.begin(); it != atomsNeedingDebugNotes.end(); it++) {
+		const ld::Atom* atom = *it;
+		const ld::relocatable::File* atomObjFile = dynamic_cast<const ld::relocatable::File*>(atom->file());
+		const char* newPath = atom->translationUnitSource();
+		if ( newPath != NULL ) {
+			const char* lastSlash = strrchr(newPath, '/');
+			if ( lastSlash == NULL )
+				continue;
+			const char* newFilename = lastSlash+1;
+			char* temp = strdup(newPath);
+			const char* newDirPath = temp;
+			// gdb like directory SO's to end in '/', but dwarf DW_AT_comp_dir usually does not have trailing '/'
+			temp[lastSlash-newPath+1] = '\0';
+			// need SO's whenever the translation unit source file changes
+			if ( (filename == NULL) || (strcmp(newFilename,filename) != 0) || (strcmp(newDirPath,dirPath) != 0)) {
+				if ( filename != NULL ) {
+					// translation unit change, emit ending SO
+					stabs.push_back({ NULL, N_SO, 1, 0, 0, "" });
+				}
+				// new translation unit, emit start SO's
+				stabs.push_back({ NULL, N_SO, 0, 0, 0, newDirPath });
+				stabs.push_back({ NULL, N_SO, 0, 0, 0, newFilename });
+				// Synthesize OSO for start of file
+				stabs.push_back({ NULL, N_OSO, (uint8_t)atomObjFile->cpuSubType(), 1,
+								  (uint32_t)atomObjFile->debugInfoModificationTime(), atomObjFile->debugInfoPath() });
+				wroteStartSO = true;
+				// add the source file path to seenFiles so it does not show up in SOLs
+				seenFiles.insert(newFilename);
+				seenFiles.insert(std::string(newDirPath) + newFilename);
+			}
+			filename = newFilename;
+			dirPath = newDirPath;
+			if ( atom->section().type() == ld::Section::typeCode ) {
+				// Synthesize BNSYM and start FUN stabs
+				stabs.push_back({ atom, N_BNSYM, 1, 0, 0, "" });
+				stabs.push_back({ atom, N_FUN, 1, 0, 0, atom->name() });
+				// Synthesize any SOL stabs needed
+				const char* curFile = NULL;
+				for (ld::Atom::LineInfo::iterator lit = atom->beginLineInfo(); lit != atom->endLineInfo(); ++lit) {
+					if ( lit->fileName != curFile ) {
+						if ( seenFiles.count(lit->fileName) == 0 ) {
+							seenFiles.insert(lit->fileName);
+							stabs.push_back({ NULL, N_SOL, 0, 0, 0, lit->fileName });
+						}
+						curFile = lit->fileName;
+					}
+				}
+				// Synthesize end FUN and ENSYM stabs
+				stabs.push_back({ atom, N_FUN, 0, 0, 0, "" });
+				stabs.push_back({ atom, N_ENSYM, 1, 0, 0, "" });
+			}
+			else if ( atom->scope() == ld::Atom::scopeTranslationUnit ) {
+				// Synthesize STSYM stab for statics
+				stabs.push_back({ atom, N_STSYM, 1, 0, 0, atom->name() });
+			}
+			else {
+				// Synthesize GSYM stab for other globals
+				stabs.push_back({ atom, N_GSYM, 1, 0, 0, atom->name() });
+			}
+		}
+	}
+
+	if ( wroteStartSO ) {
+		//  emit ending SO
+		stabs.push_back({ NULL, N_SO, 1, 0, 0, "" });
+	}
+
+	// copy any stabs from .o file
+	std::map<ld::File::Ordinal, const ld::relocatable::File*> filesWithStabs;
+	std::map<const ld::File*, const ld::Atom*> firstAtoms;
+	for (const ld::Atom* atom : atomsWithStabs) {
+		filesWithStabs[atom->file()->ordinal()] = dynamic_cast<const ld::relocatable::File*>(atom->file());
+		const ld::Atom*& firstAtom = firstAtoms[atom->file()];
+		if ( (firstAtom == NULL) || (atom->finalAddress() < firstAtom->finalAddress()) )
+			firstAtom = atom;
+	}
+	for (std::map<ld::File::Ordinal, const ld::relocatable::File*>::iterator fit = filesWithStabs.begin(); fit != filesWithStabs.end(); ++fit) {
+		const std::vector<Stab>* fileStabs = fit->second->stabs();
+		for (std::vector<Stab>::const_iterator sit = fileStabs->begin(); sit != fileStabs->end(); ++sit) {
+			Stab stab = *sit;
+			// ignore stabs associated with atoms that were dead stripped or coalesced away
+			if ( (sit->atom != NULL) && (atomsWithStabs.count(sit->atom) == 0) )
+				continue;
+			// <rdar://problem/8284718> Value of N_SO stabs should be address of first atom from translation unit
+			if ( (stab.type == N_SO) && (stab.string != NULL) && (stab.string[0] != '\0') )
+				stab.atom = firstAtoms[fit->second];
+			stabs.push_back(stab);
+		}
+	}
+}
+
+
+static std::string stabDescription(const Stab& stab)
+{
+	char buffer[1024];
+	snprintf(buffer, sizeof(buffer), "type=0x%02X other=%u desc=%u value=%llu atom=%s string='%s'",
+			 stab.type, stab.other, stab.desc, (unsigned long long)stab.value,
+			 (stab.atom != NULL) ? stab.atom->name() : "NULL", (stab.string != NULL) ? stab.string : "NULL");
+	return buffer;
+}
+
+static bool sameStab(const Stab& left, const Stab& right)
+{
+	if ( (left.atom != right.atom) || (left.type != right.type) || (left.other != right.other)
+		|| (left.desc != right.desc) || (left.value != right.value) )
+		return false;
+	if ( (left.string == NULL) || (right.string == NULL) )
+		return (left.string == right.string);
+	return (strcmp(left.string, right.string) == 0);
+}
+
+static size_t countStabs(const std::vector<Stab>& stabs, uint8_t type, const char* string)
+{
+	size_t count = 0;
+	for (const Stab& stab : stabs) {
+		if ( (stab.type == type) && ((string == NULL) || ((stab.string != NULL) && (strcmp(stab.string, string) == 0))) )
+			++count;
+	}
+	return count;
+}
+
+
+// which of the object files below are linked
+enum LinkKind { kLinkMixed, kLinkStabsOnly };
+
+struct LinkResult
+{
+	std::string				error;
+	std::vector<Stab>		notes;			// state.stabs after OutputFile::write()
+	std::vector<Stab>		expected;		// the single pass notes for the same atoms
+};
+
+static void link(const std::string& objectPath, const std::string& outputPath, LinkKind kind, bool stripDebugNotes, LinkResult& result)
+{
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-dylib");
+	args.push_back("-install_name");
+	args.push_back("/usr/lib/libdebugnotestest.dylib");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back(outputPath.c_str());
+	if ( stripDebugNotes )
+		args.push_back("-S");
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+
+	const ld::relocatable::File::DebugInfoKind dwarf = ld::relocatable::File::kDebugInfoDwarf;
+	TestObject a("/obj/a.o", 2, dwarf);
+	TestObject b("/obj/b.o", 3, dwarf);
+	TestObject s("/obj/s.o", 4, ld::relocatable::File::kDebugInfoStabs);
+	TestObject n("/obj/n.o", 5, ld::relocatable::File::kDebugInfoNone);
+	TestObject c("/obj/c.o", 6, dwarf);
+	TestObject e("/obj/e.o", 7, dwarf);
+	TestObject t("/obj/t.o", 8, ld::relocatable::File::kDebugInfoStabsUUID);
+	TestObject f("/obj/f.o", 9, dwarf);
+	TestObject h("/obj/h.o", 10, dwarf);
+
+	TestAtom header(sHeaderSection, NULL, NULL, "___dso_handle", ld::Atom::scopeLinkageUnit, ld::Atom::symbolTableNotIn);
+	// a.o, its second function is lower in memory
+	TestAtom a1(sTextSection, &a, "/src/a.c", "_a1");
+	a1.addLines({ "/src/a.c", "/src/a.h", "/src/a.h", "/src/common.h", "/src/a.h" });
+	TestAtom a2(sTextSection, &a, "/src/a.c", "_a2");
+	a2.addLines({ "a.c", "/src/common.h" });
+	TestAtom aData(sDataSection, &a, "/src/a.c", "_a_data");
+	TestAtom aStatic(sDataSection, &a, "/src/a.c", "_a_static", ld::Atom::scopeTranslationUnit);
+	TestAtom aHidden(sDataSection, &a, "/src/a.c", "_a_hidden", ld::Atom::scopeLinkageUnit);
+	TestAtom aLabel(sTextSection, &a, "/src/a.c", "ltmp0", ld::Atom::scopeTranslationUnit, ld::Atom::symbolTableNotInFinalLinkedImages);
+	// b.o continues the translation unit of a.o, changes to b.c and back
+	TestAtom b1(sTextSection, &b, "/src/a.c", "_b1");
+	b1.addLines({ "/src/common.h", "/src/b.h", "/src/a.c" });
+	TestAtom b2(sTextSection, &b, "/src/b.c", "_b2");
+	b2.addLines({ "/src/b.h", "/src/b2.h", "/src/b.h" });
+	TestAtom bStatic(sDataSection, &b, "/src/a.c", "_b_static", ld::Atom::scopeTranslationUnit);
+	// s.o has stabs, one of its atoms was dead stripped
+	TestAtom s1(sTextSection, &s, "/stabs/s.c", "_s1");
+	TestAtom s2(sDataSection, &s, "/stabs/s.c", "_s2", ld::Atom::scopeTranslationUnit);
+	TestAtom sDead(sTextSection, &s, "/stabs/s.c", "_s_dead");
+	s.addStab(NULL, N_SO, 0, "/stabs/");
+	s.addStab(NULL, N_SO, 0, "s.c");
+	s.addStab(NULL, N_OPT, 0, "gcc2_compiled.");
+	s.addStab(&s1, N_FUN, 1, "_s1:F(0,1)");
+	s.addStab(&sDead, N_FUN, 1, "_s_dead:F(0,1)");
+	s.addStab(&s2, N_STSYM, 2, "_s2:S(0,1)");
+	s.addStab(NULL, N_SO, 1, "");
+	// n.o has no debug info
+	TestAtom n1(sTextSection, &n, "/src/n.c", "_n1");
+	// c.o starts with an atom without a directory
+	TestAtom c0(sTextSection, &c, "nodir.c", "_c0");
+	TestAtom c1(sTextSection, &c, "/src/c.c", "_c1");
+	c1.addLines({ "/src/b.h", "/src/c.h", "c.c", "/src/c.h", "a.c" });
+	TestAtom cData(sDataSection, &c, "/src/c.c", "_c_data");
+	// e.o has the leaf name of c.o's translation unit in another directory
+	TestAtom e1(sTextSection, &e, "/other/c.c", "_e1");
+	e1.addLines({ "/src/c.h", "/other/e.h", "/src/c.c" });
+	// t.o has stabs
+	TestAtom t1(sTextSection, &t, "/stabs/t.c", "_t1");
+	t.addStab(NULL, N_SO, 0, "/stabs/");
+	t.addStab(NULL, N_SO, 0, "t.c");
+	t.addStab(&t1, N_FUN, 1, "_t1:F(0,1)");
+	t.addStab(NULL, N_SO, 1, "");
+	// f.o has debug info but no translation unit
+	TestAtom f1(sTextSection, &f, NULL, "_f1");
+	// h.o continues the translation unit of e.o
+	TestAtom h1(sTextSection, &h, "/other/c.c", "_h1");
+	h1.addLines({ "/other/e.h", "/other/h.h" });
+	TestAtom hData(sDataSection, &h, "/other/c.c", "_h_data");
+
+	// the atoms of each section are in a different order than their files
+	std::vector<TestAtom*> atoms;
+	if ( kind == kLinkMixed )
+		atoms = { &header, &c1, &a2, &aLabel, &e1, &b1, &t1, &f1, &s1, &a1, &b2, &n1, &h1, &c0,
+				  &s2, &bStatic, &hData, &aStatic, &cData, &aHidden, &aData };
+	else
+		atoms = { &header, &t1, &n1, &s1, &s2 };
+
+	try {
+		Options opts(args.size()-1, &args[0]);
+		InternalState state(opts);
+		for (TestAtom* atom : atoms)
+			state.addAtom(*atom);
+		state.sortSections();
+		ld::tool::OutputFile output(opts);
+		output.write(state);
+		result.notes = state.stabs;
+		if ( !stripDebugNotes )
+			singlePassDebugNotes(state, result.expected);
+	}
+	catch (const char* msg) {
+		result.error = msg;
+	}
+}
+
+// the notes must be the single pass notes, stab for stab
+static void checkSameNotes(const char* what, const LinkResult& result)
+{
+	check(result.error.empty(), "%s: link failed: %s", what, result.error.c_str());
+	if ( !result.error.empty() )
+		return;
+	check(result.notes.size() == result.expected.size(), "%s: %lu stabs, expected %lu", what,
+		  result.notes.size(), result.expected.size());
+	for (size_t i=0; i < std::min(result.notes.size(), result.expected.size()); ++i) {
+		if ( !sameStab(result.notes[i], result.expected[i]) ) {
+			check(false, "%s: stab %lu is %s, expected %s", what, i,
+				  stabDescription(result.notes[i]).c_str(), stabDescription(result.expected[i]).c_str());
+			break;
+		}
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/debugnotestest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string tempDir = dir;
+	std::string objectPath = tempDir + "/empty.o";
+	FILE* file = fopen(objectPath.c_str(), "w");
+	if ( file == NULL ) {
+		perror(objectPath.c_str());
+		return 1;
+	}
+	fclose(file);
+	std::string outputPath = tempDir + "/libdebugnotestest.dylib";
+
+	// object files with DWARF, with stabs and without debug info
+	LinkResult mixed;
+	link(objectPath, outputPath, kLinkMixed, false, mixed);
+	checkSameNotes("mixed", mixed);
+	const std::vector<Stab>& expected = mixed.expected;
+	// a.o and b.o are one translation unit until b.o changes to b.c, c.o,
+	// e.o and h.o's are /src/c.c and /other/c.c, f.o has none
+	check(countStabs(expected, N_OSO, NULL) == 5, "%lu OSOs", countStabs(expected, N_OSO, NULL));
+	check(countStabs(expected, N_OSO, "/obj/b.o") == 2, "b.o has %lu OSOs", countStabs(expected, N_OSO, "/obj/b.o"));
+	check(countStabs(expected, N_OSO, "/obj/h.o") == 0, "h.o has an OSO");
+	check(countStabs(expected, N_SO, "c.c") == 2, "%lu SOs for c.c", countStabs(expected, N_SO, "c.c"));
+	// each path has one SOL, the translation units have none
+	const char* sols[] = { "/src/a.h", "/src/common.h", "/src/b.h", "/src/b2.h", "/src/c.h", "/other/e.h", "/other/h.h" };
+	for (size_t i=0; i < sizeof(sols)/sizeof(sols[0]); ++i)
+		check(countStabs(expected, N_SOL, sols[i]) == 1, "%lu SOLs for %s", countStabs(expected, N_SOL, sols[i]), sols[i]);
+	check(countStabs(expected, N_SOL, NULL) == sizeof(sols)/sizeof(sols[0]), "%lu SOLs", countStabs(expected, N_SOL, NULL));
+	check(countStabs(expected, N_FUN, "_s_dead:F(0,1)") == 0, "the stab of a dead atom was copied");
+	check(countStabs(expected, N_OPT, NULL) == 1, "the stabs of s.o were not copied");
+
+	// only object files with stabs, no translation unit is started
+	LinkResult stabsOnly;
+	link(objectPath, outputPath, kLinkStabsOnly, false, stabsOnly);
+	checkSameNotes("stabs only", stabsOnly);
+	check(stabsOnly.expected.size() == 10, "stabs only: %lu stabs", stabsOnly.expected.size());
+
+	// -S, no notes
+	LinkResult stripped;
+	link(objectPath, outputPath, kLinkMixed, true, stripped);
+	check(stripped.error.empty(), "-S: link failed: %s", stripped.error.c_str());
+	check(stripped.notes.empty(), "-S: %lu stabs", stripped.notes.size());
+
+	unlink(outputPath.c_str());
+	unlink(objectPath.c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "debugnotestest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
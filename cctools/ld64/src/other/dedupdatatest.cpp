@@ -0,0 +1,310 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for -deduplicate_data (passes/code_dedup.cpp).  Synthetic __text,
+// __const and __objc_const sections are run through the dedup pass with a
+// command line parsed by Options.  Only identical auto-hide data may be
+// folded, including tables that become identical once the functions they
+// point to are folded; references to a folded atom must go to the copy that
+// is kept.  The bytes saved that -verbose_deduplicate reports are checked too.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Options.h"
+#include "ld.hpp"
+#include "code_dedup.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "dedupdatatest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sConstSection("__DATA", "__const", ld::Section::typeUnclassified);
+static ld::Section sObjCConstSection("__DATA", "__objc_const", ld::Section::typeUnclassified);
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const char* name, const char* content, size_t size,
+													 bool autoHide, bool dontDeadStrip=false, uint8_t align=3,
+													 ld::Atom::Scope scope=ld::Atom::scopeLinkageUnit)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													scope, ld::Atom::typeUnclassified, ld::Atom::symbolTableIn,
+													dontDeadStrip, false, false, ld::Atom::Alignment(align)),
+												  _name(name), _content(content, content+size) {
+													if ( autoHide )
+														setAutoHide();
+												}
+
+	virtual const ld::File*					file() const					{ return NULL; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _content.size(); }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { memcpy(buffer, _content.data(), _content.size()); }
+	virtual const uint8_t*					rawContentPointer() const		{ return _content.data(); }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void									addPointer(uint32_t offset, const ld::Atom* target)
+	{
+		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, target));
+	}
+
+	const ld::Atom*							pointerTarget(unsigned index) const { return _fixups[index].u.target; }
+
+private:
+	const char*								_name;
+	std::vector<uint8_t>					_content;
+	std::vector<ld::Fixup>					_fixups;
+};
+
+class TestState : public ld::Internal
+{
+public:
+	virtual uint64_t						assignFileOffsets()				{ return 0; }
+	virtual void							setSectionSizesAndAlignments()	{ }
+	virtual ld::Internal::FinalSection*		addAtom(const ld::Atom&)		{ return NULL; }
+	virtual ld::Internal::FinalSection*		getFinalSection(const ld::Section&) { return NULL; }
+};
+
+static std::string sTempDir;
+
+static Options* parseOptions(bool deduplicateData)
+{
+	std::string objectPath = sTempDir + "/empty.o";
+	FILE* f = fopen(objectPath.c_str(), "w");
+	if ( f == NULL ) {
+		perror(objectPath.c_str());
+		exit(1);
+	}
+	fclose(f);
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back("/dev/null");
+	args.push_back("-verbose_deduplicate");
+	if ( deduplicateData )
+		args.push_back("-deduplicate_data");
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+	try {
+		return new Options(args.size()-1, &args[0]);
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "dedupdatatest: can't parse the command line: %s\n", msg);
+		exit(1);
+	}
+}
+
+// runs the pass with its report on stderr going to a file, returns the report
+static std::string runPass(const Options& opts, ld::Internal& state)
+{
+	std::string reportPath = sTempDir + "/report.txt";
+	fflush(stderr);
+	int savedStderr = dup(fileno(stderr));
+	if ( freopen(reportPath.c_str(), "w", stderr) == NULL ) {
+		perror(reportPath.c_str());
+		exit(1);
+	}
+	ld::passes::dedup::doPass(opts, state);
+	fflush(stderr);
+	dup2(savedStderr, fileno(stderr));
+	close(savedStderr);
+
+	std::string report;
+	FILE* f = fopen(reportPath.c_str(), "r");
+	char line[1024];
+	while ( (f != NULL) && (fgets(line, sizeof(line), f) != NULL) )
+		report += line;
+	if ( f != NULL )
+		fclose(f);
+	unlink(reportPath.c_str());
+	return report;
+}
+
+static bool contains(const ld::Internal::FinalSection& sect, const ld::Atom* atom)
+{
+	return ( std::find(sect.atoms.begin(), sect.atoms.end(), atom) != sect.atoms.end() );
+}
+
+// the atom in sect that replaced the one named name, or NULL if it is still there
+static const ld::Atom* aliasFor(const ld::Internal::FinalSection& sect, const char* name)
+{
+	for (std::vector<const ld::Atom*>::const_iterator it=sect.atoms.begin(); it != sect.atoms.end(); ++it) {
+		if ( ((*it)->size() == 0) && (strcmp((*it)->name(), name) == 0) )
+			return *it;
+	}
+	return NULL;
+}
+
+static bool folded(const ld::Internal::FinalSection& sect, const TestAtom& atom, const TestAtom& into)
+{
+	const ld::Atom* alias = aliasFor(sect, atom.name());
+	if ( contains(sect, &atom) || !contains(sect, &into) || (alias == NULL) )
+		return false;
+	ld::Fixup::iterator fit = alias->fixupsBegin();
+	return (alias->fixupsEnd() - fit == 1) && (fit->kind == ld::Fixup::kindNoneFollowOn) && (fit->u.target == &into);
+}
+
+static bool kept(const ld::Internal::FinalSection& sect, const TestAtom& atom)
+{
+	return contains(sect, &atom) && (aliasFor(sect, atom.name()) == NULL);
+}
+
+static void checkFolding(bool deduplicateData)
+{
+	static const char funcBytes[] = "\x55\x48\x89\xe5\x31\xc0\x5d\xc3";
+	static const char table[24] = { 0 };
+	static const char other[24] = { 1 };
+	static const char methods[24] = { 24, 0, 0, 0, 1, 0, 0, 0 };
+
+	// two identical auto-hide functions are folded by the code pass
+	TestAtom f1(sTextSection, "_f1", funcBytes, 8, true, false, 4);
+	TestAtom f2(sTextSection, "_f2", funcBytes, 8, true, false, 4);
+
+	// tables that point to f1 and f2 are identical once f2 is folded into f1
+	TestAtom vtable1(sConstSection, "__ZTV1A", table, sizeof(table), true);
+	TestAtom vtable2(sConstSection, "__ZTV1B", table, sizeof(table), true);
+	TestAtom vtable3(sConstSection, "__ZTV1C", table, sizeof(table), true);
+	vtable1.addPointer(16, &f1);
+	vtable2.addPointer(16, &f2);
+	vtable3.addPointer(16, &f1);
+	// different bytes
+	TestAtom differs(sConstSection, "__ZTV1D", other, sizeof(other), true);
+	differs.addPointer(16, &f1);
+	// same bytes, but not auto-hide, no_dead_strip or differently aligned
+	TestAtom named1(sConstSection, "_named1", table, sizeof(table), false);
+	TestAtom named2(sConstSection, "_named2", table, sizeof(table), false);
+	TestAtom pinned(sConstSection, "__ZTV1E", other, sizeof(other), true, true);
+	TestAtom pinned2(sConstSection, "__ZTV1F", other, sizeof(other), true, true);
+	TestAtom aligned(sConstSection, "__ZTV1G", other, sizeof(other), true, false, 4);
+	pinned.addPointer(16, &f1);
+	pinned2.addPointer(16, &f1);
+	aligned.addPointer(16, &f1);
+	// identical ObjC method lists are written by the runtime and must stay apart
+	TestAtom methods1(sObjCConstSection, "__OBJC_$_INSTANCE_METHODS_A", methods, sizeof(methods), false, false, 3, ld::Atom::scopeTranslationUnit);
+	TestAtom methods2(sObjCConstSection, "__OBJC_$_INSTANCE_METHODS_B", methods, sizeof(methods), false, false, 3, ld::Atom::scopeTranslationUnit);
+	methods1.addPointer(16, &f1);
+	methods2.addPointer(16, &f1);
+	// something that refers to the folded table
+	TestAtom user(sConstSection, "_user", table, 16, false);
+	user.addPointer(0, &vtable2);
+	user.addPointer(8, &vtable1);
+
+	TestState state;
+	ld::Internal::FinalSection text(sTextSection);
+	ld::Internal::FinalSection constSect(sConstSection);
+	ld::Internal::FinalSection objcConst(sObjCConstSection);
+	text.atoms.push_back(&f1);
+	text.atoms.push_back(&f2);
+	const TestAtom* constAtoms[] = { &vtable1, &vtable2, &vtable3, &differs, &named1, &named2, &pinned, &pinned2, &aligned, &user };
+	for (const TestAtom* atom : constAtoms)
+		constSect.atoms.push_back(atom);
+	objcConst.atoms.push_back(&methods1);
+	objcConst.atoms.push_back(&methods2);
+	state.sections.push_back(&text);
+	state.sections.push_back(&constSect);
+	state.sections.push_back(&objcConst);
+	for (ld::Internal::FinalSection* sect : state.sections) {
+		for (const ld::Atom* atom : sect->atoms)
+			state.atomToSection[atom] = sect;
+	}
+
+	Options* opts = parseOptions(deduplicateData);
+	std::string report = runPass(*opts, state);
+	delete opts;
+
+	check(folded(text, f2, f1), "_f2 was not folded into _f1");
+	check(strstr(report.c_str(), "deduplication saved 8 bytes of __text\n") != NULL, "report: %s", report.c_str());
+	if ( deduplicateData ) {
+		check(folded(constSect, vtable2, vtable1), "__ZTV1B was not folded into __ZTV1A");
+		check(folded(constSect, vtable3, vtable1), "__ZTV1C was not folded into __ZTV1A");
+		check(strstr(report.c_str(), "deduplication saved 48 bytes of __DATA/__const\n") != NULL, "report: %s", report.c_str());
+		check(strstr(report.c_str(), "data deduplication saved 48 bytes\n") != NULL, "report: %s", report.c_str());
+		check(strstr(report.c_str(), "__objc_const") == NULL, "report: %s", report.c_str());
+		// references to the folded table go to its alias, which is a follow-on of the kept copy
+		check(user.pointerTarget(0) == aliasFor(constSect, "__ZTV1B"), "_user still points to __ZTV1B");
+		check(user.pointerTarget(1) == &vtable1, "_user no longer points to __ZTV1A");
+		check(state.atomToSection.count(&vtable2) == 0, "__ZTV1B is still mapped to a section");
+	}
+	else {
+		check(kept(constSect, vtable2) && kept(constSect, vtable3), "__const folded without -deduplicate_data");
+		check(strstr(report.c_str(), "data deduplication") == NULL, "report: %s", report.c_str());
+		check(user.pointerTarget(0) == &vtable2, "_user no longer points to __ZTV1B");
+	}
+	check(kept(constSect, vtable1), "__ZTV1A was folded");
+	check(kept(constSect, differs), "__ZTV1D was folded");
+	check(kept(constSect, named1) && kept(constSect, named2), "data that isn't auto-hide was folded");
+	check(kept(constSect, pinned) && kept(constSect, pinned2), "no_dead_strip data was folded");
+	check(kept(constSect, aligned), "data with a different alignment was folded");
+	check(kept(objcConst, methods1) && kept(objcConst, methods2), "ObjC method lists were folded");
+	check(objcConst.atoms.size() == 2, "%lu atoms in __objc_const", objcConst.atoms.size());
+}
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/dedupdatatest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	sTempDir = dir;
+
+	// the pass keeps its hashes and folded atoms in globals, so each run gets a fresh process
+	for (int deduplicateData=0; deduplicateData < 2; ++deduplicateData) {
+		fflush(stderr);
+		pid_t pid = fork();
+		if ( pid == 0 ) {
+			checkFolding(deduplicateData);
+			_exit(sFailures != 0);
+		}
+		int status;
+		check((pid > 0) && (waitpid(pid, &status, 0) == pid) && WIFEXITED(status) && (WEXITSTATUS(status) == 0),
+			  "run with%s -deduplicate_data failed", deduplicateData ? "" : "out");
+	}
+
+	unlink((sTempDir + "/empty.o").c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "dedupdatatest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -34,12 +34,14 @@
 #include <vector>
 #include <set>
 #include <unordered_set>
+#include <algorithm>
 
 #include "configure.h"
 #include "MachOFileAbstraction.hpp"
 #include "Architectures.hpp"
 #include "MachOTrie.hpp"
 #include "../ld/code-sign-blobs/superblob.h"
+#include "json_lines.h"
 
 static bool printRebase = false;
 static bool printBind = false;
@@ -54,6 +56,8 @@ static bool printFunctionStarts = false;
 static bool printDylibs = false;
 static bool printDRs = false;
 static bool printDataCode = false;
+static bool printFixups = false;
+static bool printJSON = false;
 static cpu_type_t	sPreferredArch = 0;
 static cpu_type_t	sPreferredSubArch = 0;
 
@@ -97,6 +101,10 @@ private:
 	void										printWeakBindingInfoOpcodes();
 	void										printLazyBindingOpcodes();
 	void										printExportInfo();
+	bool										exportTrie(const uint8_t*& start, const uint8_t*& end);
+	void										printChainedFixups();
+	void										printChainedRebaseInfo();
+	void										printChainedBindingInfo();
 	void										printExportInfoGraph();
 	void										printExportInfoNodes();
 	void										printRelocRebaseInfo();
@@ -118,6 +126,14 @@ private:
 	const uint8_t*								printSharedRegionV2Kind(const uint8_t* p, const uint8_t* end);
 
 	pint_t										relocBase();
+	void										buildAddressIndexes();
+	void										buildSymbolIndex();
+	void										printJSONImage();
+	void										printJSONRebase(uint8_t segIndex, uint64_t address, const char* typeName);
+	void										printJSONBind(const char* kind, uint8_t segIndex, uint64_t address, const char* typeName,
+															int64_t addend, const char* fromDylib, const char* symbolName, bool weakImport,
+															int64_t lazyIndex=-1);
+	void										printJSONFunctionStart(uint64_t addr, bool thumb);
 	const char*									relocTypeName(uint8_t r_type);
 	uint8_t										segmentIndexForAddress(pint_t addr);
 	void										processExportGraphNode(const uint8_t* const start, const uint8_t* const end,  
@@ -132,12 +148,17 @@ private:
 	const char*									segmentName(uint8_t segIndex);
 	const char*									sectionName(uint8_t segIndex, pint_t address);
 	const char*									getSegAndSectName(uint8_t segIndex, pint_t address);
+	struct SectionRange { pint_t start; pint_t end; uint32_t segIndex; const macho_section<P>* section; char name[17]; };
+	const SectionRange*							sectionRangeForAddress(uint8_t segIndex, pint_t address);
 	const char*									ordinalName(int libraryOrdinal);
 	const char*									classicOrdinalName(int libraryOrdinal);
 	pint_t*										mappedAddressForVMAddress(pint_t vmaddress);
 	const char*									symbolNameForAddress(uint64_t);
 	const char*									closestSymbolNameForAddress(uint64_t addr, uint64_t* offset, uint8_t sectIndex=0);
 
+	struct ChainedImport { int libraryOrdinal; const char* symbolName; bool weakImport; int64_t addend; };
+	struct ChainedFixup { uint32_t segIndex; uint64_t address; bool bind; uint64_t target; uint32_t importIndex; int64_t addend; };
+	void										chainedFixups(std::vector<ChainedFixup>& fixups, std::vector<ChainedImport>& imports);
 		
 	const char*									fPath;
 	const macho_header<P>*						fHeader;
@@ -151,6 +172,8 @@ private:
 	const macho_linkedit_data_command<P>*		fFunctionStartsInfo;
 	const macho_linkedit_data_command<P>*		fDataInCode;
 	const macho_linkedit_data_command<P>*		fDRInfo;
+	const macho_linkedit_data_command<P>*		fChainedFixups;
+	const macho_linkedit_data_command<P>*		fExportsTrie;
 	uint64_t									fBaseAddress;
 	const macho_dysymtab_command<P>*			fDynamicSymbolTable;
 	const macho_segment_command<P>*				fFirstSegment;
@@ -161,6 +184,11 @@ private:
 	std::vector<const char*>					fDylibs;
 	std::vector<const macho_dylib_command<P>*>	fDylibLoadCommands;
 	macho_section<P>							fMachHeaderPseudoSection;
+	std::vector<SectionRange>					fSectionsByAddress;		// sorted by segment index then address
+	std::vector<uint32_t>						fSegmentsByAddress;		// indexes into fSegments
+	std::vector<const macho_nlist<P>*>			fSymbolsByAddress;		// see buildSymbolIndex()
+	std::vector<const macho_nlist<P>*>			fSymbolsBySection;
+	bool										fSymbolIndexBuilt;
 };
 
 
@@ -291,8 +319,9 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
  : fHeader(NULL), fLength(fileLength), 
    fStrings(NULL), fStringsEnd(NULL), fSymbols(NULL), fSymbolCount(0), fInfo(NULL), 
    fSharedRegionInfo(NULL), fFunctionStartsInfo(NULL), fDataInCode(NULL), fDRInfo(NULL), 
+   fChainedFixups(NULL), fExportsTrie(NULL),
    fBaseAddress(0), fDynamicSymbolTable(NULL), fFirstSegment(NULL), fFirstWritableSegment(NULL),
-   fWriteableSegmentWithAddrOver4G(false)
+   fWriteableSegmentWithAddrOver4G(false), fSymbolIndexBuilt(false)
 {
 	// sanity check
 	if ( ! validFile(fileContent) )
@@ -388,11 +417,21 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 			case LC_DYLIB_CODE_SIGN_DRS:
 				fDRInfo = (macho_linkedit_data_command<P>*)cmd;
 				break;
+			case LC_DYLD_CHAINED_FIXUPS:
+				fChainedFixups = (macho_linkedit_data_command<P>*)cmd;
+				break;
+			case LC_DYLD_EXPORTS_TRIE:
+				fExportsTrie = (macho_linkedit_data_command<P>*)cmd;
+				break;
 		}
 		cmd = (const macho_load_command<P>*)endOfCmd;
 	}
+	buildAddressIndexes();
 	
-	if ( printArch ) {
+	if ( printJSON ) {
+		printJSONImage();
+	}
+	else if ( printArch ) {
 		for (const ArchInfo* t=archInfoArray; t->archName != NULL; ++t) {
 			if ( (cpu_type_t)fHeader->cputype() == t->cpuType ) {
 				if ( t->isSubType && ((cpu_subtype_t)fHeader->cpusubtype() != t->cpuSubType) )
@@ -405,12 +444,16 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 	if ( printRebase ) {
 		if ( fInfo != NULL )
 			printRebaseInfo();
+		else if ( fChainedFixups != NULL )
+			printChainedRebaseInfo();
 		else
 			printRelocRebaseInfo();
 	}
 	if ( printBind ) {
 		if ( fInfo != NULL )
 			printBindingInfo();
+		else if ( fChainedFixups != NULL )
+			printChainedBindingInfo();
 		else
 			printClassicBindingInfo();
 	}
@@ -423,7 +466,7 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 			printClassicLazyBindingInfo();
 	}
 	if ( printExport ) {
-		if ( fInfo != NULL )
+		if ( (fInfo != NULL) || (fExportsTrie != NULL) )
 			printExportInfo();
 		else
 			printSymbolTableExportInfo();
@@ -448,6 +491,8 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 		printDRInfo();
 	if ( printDataCode )
 		printDataInCode();
+	if ( printFixups )
+		printChainedFixups();
 }
 
 static uint64_t read_uleb128(const uint8_t*& p, const uint8_t* end)
@@ -536,26 +581,67 @@ const char* DyldInfoPrinter<A>::segmentName(uint8_t segIndex)
 	return fSegments[segIndex]->segname();
 }
 
+template <typename A>
+void DyldInfoPrinter<A>::buildAddressIndexes()
+{
+	// every fixup printed needs the segment and section of its address, so sort
+	// them once instead of walking the load commands for each address
+	for (uint32_t i=0; i < fSegments.size(); ++i) {
+		const macho_segment_command<P>* segCmd = fSegments[i];
+		if ( segCmd->vmsize() != 0 )
+			fSegmentsByAddress.push_back(i);
+		const macho_section<P>* const sectionsStart = (macho_section<P>*)((char*)segCmd + sizeof(macho_segment_command<P>));
+		const macho_section<P>* const sectionsEnd = &sectionsStart[segCmd->nsects()];
+		for(const macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect) {
+			if ( sect->size() == 0 )
+				continue;
+			SectionRange range;
+			range.start = sect->addr();
+			range.end = sect->addr() + sect->size();
+			range.segIndex = i;
+			range.section = sect;
+			// section name may not be zero terminated
+			memcpy(range.name, sect->sectname(), 16);
+			range.name[16] = '\0';
+			fSectionsByAddress.push_back(range);
+		}
+	}
+	std::sort(fSegmentsByAddress.begin(), fSegmentsByAddress.end(), [&](uint32_t left, uint32_t right) {
+		return (fSegments[left]->vmaddr() < fSegments[right]->vmaddr());
+	});
+	std::stable_sort(fSectionsByAddress.begin(), fSectionsByAddress.end(), [](const SectionRange& left, const SectionRange& right) {
+		if ( left.segIndex != right.segIndex )
+			return (left.segIndex < right.segIndex);
+		return (left.start < right.start);
+	});
+}
+
+template <typename A>
+const typename DyldInfoPrinter<A>::SectionRange* DyldInfoPrinter<A>::sectionRangeForAddress(uint8_t segIndex, pint_t address)
+{
+	// last section of the segment that starts at or before address
+	typename std::vector<SectionRange>::const_iterator pos = std::upper_bound(fSectionsByAddress.begin(), fSectionsByAddress.end(), address, 
+		[=](pint_t addr, const SectionRange& range) {
+			if ( segIndex != range.segIndex )
+				return (segIndex < range.segIndex);
+			return (addr < range.start);
+		});
+	if ( pos == fSectionsByAddress.begin() )
+		return NULL;
+	--pos;
+	if ( (pos->segIndex != segIndex) || (address >= pos->end) )
+		return NULL;
+	return &*pos;
+}
+
 template <typename A>
 const char* DyldInfoPrinter<A>::sectionName(uint8_t segIndex, pint_t address)
 {
 	if ( segIndex > fSegments.size() )
 		throw "segment index out of range";
-	const macho_segment_command<P>* segCmd = fSegments[segIndex];
-	macho_section<P>* const sectionsStart = (macho_section<P>*)((char*)segCmd + sizeof(macho_segment_command<P>));
-	macho_section<P>* const sectionsEnd = &sectionsStart[segCmd->nsects()];
-	for(macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect) {
-		if ( (sect->addr() <= address) && (address < (sect->addr()+sect->size())) ) {
-			if ( strlen(sect->sectname()) > 15 ) {
-				static char temp[18];
-				strlcpy(temp, sect->sectname(), 17);
-				return temp;
-			}
-			else {
-				return sect->sectname();
-			}
-		}
-	}
+	const SectionRange* range = sectionRangeForAddress(segIndex, address);
+	if ( range != NULL )
+		return range->name;
 	return "??";
 }
 
@@ -565,16 +651,12 @@ const char* DyldInfoPrinter<A>::getSegAndSectName(uint8_t segIndex, pint_t addre
 	static char buffer[64];
 	strcpy(buffer, segmentName(segIndex));
 	strcat(buffer, "/");
-	const macho_segment_command<P>* segCmd = fSegments[segIndex];
-	macho_section<P>* const sectionsStart = (macho_section<P>*)((char*)segCmd + sizeof(macho_segment_command<P>));
-	macho_section<P>* const sectionsEnd = &sectionsStart[segCmd->nsects()];
-	for(macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect) {
-		if ( (sect->addr() <= address) && (address < (sect->addr()+sect->size())) ) {
-			// section name may not be zero terminated
-			char* end = &buffer[strlen(buffer)];
-			strlcpy(end, sect->sectname(), 16);
-			return buffer;				
-		}
+	const SectionRange* range = sectionRangeForAddress(segIndex, address);
+	if ( range != NULL ) {
+		// section name may not be zero terminated
+		char* end = &buffer[strlen(buffer)];
+		strlcpy(end, range->name, 16);
+		return buffer;				
 	}
 	return "??";
 }
@@ -582,10 +664,15 @@ const char* DyldInfoPrinter<A>::getSegAndSectName(uint8_t segIndex, pint_t addre
 template <typename A>
 uint8_t DyldInfoPrinter<A>::segmentIndexForAddress(pint_t address)
 {
-	for(unsigned int i=0; i < fSegments.size(); ++i) {
-		if ( (fSegments[i]->vmaddr() <= address) && (address < (fSegments[i]->vmaddr()+fSegments[i]->vmsize())) ) {
-			return i;
-		}
+	// last segment that starts at or before address
+	std::vector<uint32_t>::const_iterator pos = std::upper_bound(fSegmentsByAddress.begin(), fSegmentsByAddress.end(), address, 
+		[&](pint_t addr, uint32_t segIndex) {
+			return (addr < fSegments[segIndex]->vmaddr());
+		});
+	if ( pos != fSegmentsByAddress.begin() ) {
+		const macho_segment_command<P>* segCmd = fSegments[*(pos-1)];
+		if ( address < (segCmd->vmaddr()+segCmd->vmsize()) )
+			return *(pos-1);
 	}
 	throwf("address 0x%llX is not in any segment", (uint64_t)address);
 }
@@ -593,13 +680,62 @@ uint8_t DyldInfoPrinter<A>::segmentIndexForAddress(pint_t address)
 template <typename A>
 typename A::P::uint_t*	DyldInfoPrinter<A>::mappedAddressForVMAddress(pint_t vmaddress)
 {
-	for(unsigned int i=0; i < fSegments.size(); ++i) {
-		if ( (fSegments[i]->vmaddr() <= vmaddress) && (vmaddress < (fSegments[i]->vmaddr()+fSegments[i]->vmsize())) ) {
-			unsigned long offsetInMappedFile = fSegments[i]->fileoff()+vmaddress-fSegments[i]->vmaddr();
-			return (pint_t*)((uint8_t*)fHeader + offsetInMappedFile);
+	const macho_segment_command<P>* segCmd = fSegments[segmentIndexForAddress(vmaddress)];
+	unsigned long offsetInMappedFile = segCmd->fileoff()+vmaddress-segCmd->vmaddr();
+	return (pint_t*)((uint8_t*)fHeader + offsetInMappedFile);
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printJSONImage()
+{
+	json_begin("image");
+	json_string_member("path", fPath);
+	for (const ArchInfo* t=archInfoArray; t->archName != NULL; ++t) {
+		if ( (cpu_type_t)fHeader->cputype() == t->cpuType ) {
+			if ( t->isSubType && ((cpu_subtype_t)fHeader->cpusubtype() != t->cpuSubType) )
+				continue;
+			json_string_member("arch", t->archName);
+			break;
 		}
 	}
-	throwf("address 0x%llX is not in any segment", (uint64_t)vmaddress);
+	json_uint_member("cputype", fHeader->cputype());
+	json_uint_member("cpusubtype", fHeader->cpusubtype());
+	json_uint_member("filetype", fHeader->filetype());
+	json_end();
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printJSONRebase(uint8_t segIndex, uint64_t address, const char* typeName)
+{
+	json_begin("rebase");
+	json_string_member("segment", segmentName(segIndex));
+	json_string_member("section", sectionName(segIndex, address));
+	json_uint_member("address", address);
+	json_string_member("type", typeName);
+	json_end();
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printJSONBind(const char* kind, uint8_t segIndex, uint64_t address, const char* typeName,
+										int64_t addend, const char* fromDylib, const char* symbolName, bool weakImport,
+										int64_t lazyIndex)
+{
+	json_begin(kind);
+	json_string_member("segment", segmentName(segIndex));
+	json_string_member("section", sectionName(segIndex, address));
+	json_uint_member("address", address);
+	json_string_member("type", typeName);
+	json_int_member("addend", addend);
+	if ( fromDylib != NULL )
+		json_string_member("dylib", fromDylib);
+	json_string_member("symbol", symbolName);
+	if ( weakImport )
+		json_bool_member("weak_import", true);
+	// lazy binds also give the "index" column: the offset of the entry in the
+	// lazy_bind info, or the indirect symbol table index for classic binaries
+	if ( lazyIndex >= 0 )
+		json_uint_member("index", lazyIndex);
+	json_end();
 }
 
 template <typename A>
@@ -612,8 +748,10 @@ const char* DyldInfoPrinter<A>::ordinalName(int libraryOrdinal)
 			return "main-executable";
 		case BIND_SPECIAL_DYLIB_FLAT_LOOKUP:
 			return "flat-namespace";
+		case BIND_SPECIAL_DYLIB_WEAK_LOOKUP:
+			return "weak";
 	}
-	if ( libraryOrdinal < BIND_SPECIAL_DYLIB_FLAT_LOOKUP )
+	if ( libraryOrdinal < BIND_SPECIAL_DYLIB_WEAK_LOOKUP )
 		throw "unknown special ordinal";
 	if ( libraryOrdinal > (int)fDylibs.size() )
 		throw "libraryOrdinal out of range";
@@ -642,11 +780,14 @@ template <typename A>
 void DyldInfoPrinter<A>::printRebaseInfo()
 {
 	if ( (fInfo == NULL) || (fInfo->rebase_off() == 0) ) {
-		printf("no compressed rebase info\n");
+		if ( !printJSON )
+			printf("no compressed rebase info\n");
 	}
 	else {
-		printf("rebase information (from compressed dyld info):\n");
-		printf("segment section          address     type\n");
+		if ( !printJSON ) {
+			printf("rebase information (from compressed dyld info):\n");
+			printf("segment section          address     type\n");
+		}
 
 		const uint8_t* p = (uint8_t*)fHeader + fInfo->rebase_off();
 		const uint8_t* end = &p[fInfo->rebase_size()];
@@ -686,26 +827,38 @@ void DyldInfoPrinter<A>::printRebaseInfo()
 					break;
 				case REBASE_OPCODE_DO_REBASE_IMM_TIMES:
 					for (int i=0; i < immediate; ++i) {
-						printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
+						if ( printJSON )
+							printJSONRebase(segIndex, segStartAddr+segOffset, typeName);
+						else
+							printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
 						segOffset += sizeof(pint_t);
 					}
 					break;
 				case REBASE_OPCODE_DO_REBASE_ULEB_TIMES:
 					count = read_uleb128(p, end);
 					for (uint32_t i=0; i < count; ++i) {
-						printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
+						if ( printJSON )
+							printJSONRebase(segIndex, segStartAddr+segOffset, typeName);
+						else
+							printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
 						segOffset += sizeof(pint_t);
 					}
 					break;
 				case REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB:
-					printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
+					if ( printJSON )
+						printJSONRebase(segIndex, segStartAddr+segOffset, typeName);
+					else
+						printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
 					segOffset += read_uleb128(p, end) + sizeof(pint_t);
 					break;
 				case REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB:
 					count = read_uleb128(p, end);
 					skip = read_uleb128(p, end);
 					for (uint32_t i=0; i < count; ++i) {
-						printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
+						if ( printJSON )
+							printJSONRebase(segIndex, segStartAddr+segOffset, typeName);
+						else
+							printf("%-7s %-16s 0x%08llX  %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName);
 						segOffset += skip + sizeof(pint_t);
 					}
 					break;
@@ -912,11 +1065,14 @@ template <typename A>
 void DyldInfoPrinter<A>::printBindingInfo()
 {
 	if ( (fInfo == NULL) || (fInfo->bind_off() == 0) ) {
-		printf("no compressed binding info\n");
+		if ( !printJSON )
+			printf("no compressed binding info\n");
 	}
 	else {
-		printf("bind information:\n");
-		printf("segment section          address        type    addend dylib            symbol\n");
+		if ( !printJSON ) {
+			printf("bind information:\n");
+			printf("segment section          address        type    addend dylib            symbol\n");
+		}
 		const uint8_t* p = (uint8_t*)fHeader + fInfo->bind_off();
 		const uint8_t* end = &p[fInfo->bind_size()];
 		
@@ -987,22 +1143,34 @@ void DyldInfoPrinter<A>::printBindingInfo()
 					segOffset += read_uleb128(p, end);
 					break;
 				case BIND_OPCODE_DO_BIND:
-					printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
+					if ( printJSON )
+						printJSONBind("bind", segIndex, segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, (weak_import[0] != '\0'));
+					else
+						printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
 					segOffset += sizeof(pint_t);
 					break;
 				case BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB:
-					printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
+					if ( printJSON )
+						printJSONBind("bind", segIndex, segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, (weak_import[0] != '\0'));
+					else
+						printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
 					segOffset += read_uleb128(p, end) + sizeof(pint_t);
 					break;
 				case BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED:
-					printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
+					if ( printJSON )
+						printJSONBind("bind", segIndex, segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, (weak_import[0] != '\0'));
+					else
+						printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
 					segOffset += immediate*sizeof(pint_t) + sizeof(pint_t);
 					break;
 				case BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB:
 					count = read_uleb128(p, end);
 					skip = read_uleb128(p, end);
 					for (uint32_t i=0; i < count; ++i) {
-						printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
+						if ( printJSON )
+							printJSONBind("bind", segIndex, segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, (weak_import[0] != '\0'));
+						else
+							printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, fromDylib, symbolName, weak_import );
 						segOffset += skip + sizeof(pint_t);
 					}
 					break;
@@ -1014,15 +1182,215 @@ void DyldInfoPrinter<A>::printBindingInfo()
 
 }
 
+template <typename A>
+void DyldInfoPrinter<A>::chainedFixups(std::vector<ChainedFixup>& fixups, std::vector<ChainedImport>& imports)
+{
+	const uint8_t* start = (uint8_t*)fHeader + fChainedFixups->dataoff();
+	const uint8_t* end = &start[fChainedFixups->datasize()];
+	const uint32_t* header = (uint32_t*)start;
+	if ( (start + 28) > end )
+		throw "chained fixups header extends beyond LC_DYLD_CHAINED_FIXUPS data";
+	const uint32_t startsOffset = E::get32(header[1]);
+	const uint32_t importsOffset = E::get32(header[2]);
+	const uint32_t symbolsOffset = E::get32(header[3]);
+	const uint32_t importsCount = E::get32(header[4]);
+	const uint32_t importsFormat = E::get32(header[5]);
+	if ( E::get32(header[6]) != DYLD_CHAINED_SYMBOL_UNCOMPRESSED )
+		throw "compressed chained fixups symbols not supported";
+	
+	const char* symbols = (char*)start + symbolsOffset;
+	const uint8_t* p = start + importsOffset;
+	for (uint32_t i=0; i < importsCount; ++i) {
+		ChainedImport import;
+		uint64_t nameOffset;
+		switch ( importsFormat ) {
+			case DYLD_CHAINED_IMPORT:
+			case DYLD_CHAINED_IMPORT_ADDEND:
+				{
+				uint32_t value = E::get32(*(uint32_t*)p);
+				import.libraryOrdinal = ((value & 0xFF) > 0xF0) ? (int8_t)(value & 0xFF) : (int)(value & 0xFF);
+				import.weakImport = ((value >> 8) & 1);
+				nameOffset = value >> 9;
+				if ( importsFormat == DYLD_CHAINED_IMPORT_ADDEND ) {
+					import.addend = (int32_t)E::get32(*(uint32_t*)(p+4));
+					p += 8;
+				}
+				else {
+					import.addend = 0;
+					p += 4;
+				}
+				}
+				break;
+			case DYLD_CHAINED_IMPORT_ADDEND64:
+				{
+				uint64_t value = E::get64(*(uint64_t*)p);
+				import.libraryOrdinal = ((value & 0xFFFF) > 0xFFF0) ? (int16_t)(value & 0xFFFF) : (int)(value & 0xFFFF);
+				import.weakImport = ((value >> 16) & 1);
+				nameOffset = value >> 32;
+				import.addend = E::get64(*(uint64_t*)(p+8));
+				p += 16;
+				}
+				break;
+			default:
+				throwf("unknown chained imports format %d", importsFormat);
+		}
+		if ( (uint8_t*)&symbols[nameOffset] >= end )
+			throw "chained import name extends beyond LC_DYLD_CHAINED_FIXUPS data";
+		import.symbolName = &symbols[nameOffset];
+		imports.push_back(import);
+	}
+	
+	const uint8_t* startsInImage = start + startsOffset;
+	const uint32_t segCount = E::get32(*(uint32_t*)startsInImage);
+	for (uint32_t segIndex=0; segIndex < segCount; ++segIndex) {
+		const uint32_t segInfoOffset = E::get32(((uint32_t*)startsInImage)[1+segIndex]);
+		if ( segInfoOffset == 0 )
+			continue;
+		const uint8_t* segInfo = startsInImage + segInfoOffset;
+		const uint16_t pageSize = E::get16(*(uint16_t*)(segInfo+4));
+		const uint16_t pointerFormat = E::get16(*(uint16_t*)(segInfo+6));
+		const uint64_t segOffset = E::get64(*(uint64_t*)(segInfo+8));
+		const uint16_t pageCount = E::get16(*(uint16_t*)(segInfo+20));
+		const uint16_t* pageStarts = (uint16_t*)(segInfo+22);
+		if ( (pointerFormat != DYLD_CHAINED_PTR_64) && (pointerFormat != DYLD_CHAINED_PTR_64_OFFSET) )
+			throwf("unsupported chained pointer format %d", pointerFormat);
+		for (uint32_t pageIndex=0; pageIndex < pageCount; ++pageIndex) {
+			uint16_t pageStart = E::get16(pageStarts[pageIndex]);
+			if ( pageStart == DYLD_CHAINED_PTR_START_NONE )
+				continue;
+			if ( (pageStart & DYLD_CHAINED_PTR_START_MULTI) != 0 )
+				throw "multiple chain starts per page not supported";
+			uint64_t offset = segOffset + pageIndex*pageSize + pageStart;
+			for (;;) {
+				ChainedFixup fixup;
+				fixup.segIndex = segIndex;
+				fixup.address = fBaseAddress + offset;
+				const uint64_t value = E::get64(*(uint64_t*)mappedAddressForVMAddress(fixup.address));
+				fixup.bind = dyld_chained_ptr_64::isBind(value);
+				if ( fixup.bind ) {
+					fixup.importIndex = dyld_chained_ptr_64::bindOrdinal(value);
+					fixup.addend = dyld_chained_ptr_64::bindAddend(value);
+					fixup.target = 0;
+					if ( fixup.importIndex >= imports.size() )
+						throwf("bind at 0x%08llX has import index %u out of range", fixup.address, fixup.importIndex);
+				}
+				else {
+					fixup.importIndex = 0;
+					fixup.addend = 0;
+					fixup.target = dyld_chained_ptr_64::rebaseTarget(value) | ((uint64_t)dyld_chained_ptr_64::rebaseHigh8(value) << 56);
+					if ( pointerFormat == DYLD_CHAINED_PTR_64_OFFSET )
+						fixup.target += fBaseAddress;
+				}
+				fixups.push_back(fixup);
+				const uint64_t next = dyld_chained_ptr_64::next(value);
+				if ( next == 0 )
+					break;
+				offset += next * 4;
+			}
+		}
+	}
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printChainedFixups()
+{
+	if ( fChainedFixups == NULL ) {
+		if ( !printJSON )
+			printf("no chained fixups\n");
+	}
+	else {
+		std::vector<ChainedFixup> fixups;
+		std::vector<ChainedImport> imports;
+		chainedFixups(fixups, imports);
+		if ( !printJSON ) {
+			printf("chained fixups:\n");
+			printf("segment section          address         kind    target/addend dylib            symbol\n");
+		}
+		for (typename std::vector<ChainedFixup>::iterator it=fixups.begin(); it != fixups.end(); ++it) {
+			const char* segName = segmentName(it->segIndex);
+			const char* sectName = sectionName(it->segIndex, it->address);
+			if ( it->bind ) {
+				const ChainedImport& import = imports[it->importIndex];
+				if ( printJSON )
+					printJSONBind("bind", it->segIndex, it->address, "pointer", import.addend + it->addend, 
+								ordinalName(import.libraryOrdinal), import.symbolName, import.weakImport);
+				else
+					printf("%-7s %-16s 0x%08llX  bind    %5lld         %-16s %s%s\n", segName, sectName, it->address, 
+							import.addend + it->addend, ordinalName(import.libraryOrdinal), import.symbolName, 
+							import.weakImport ? " (weak import)" : "");
+			}
+			else if ( printJSON ) {
+				json_begin("rebase");
+				json_string_member("segment", segName);
+				json_string_member("section", sectName);
+				json_uint_member("address", it->address);
+				json_string_member("type", "pointer");
+				json_uint_member("target", it->target);
+				json_end();
+			}
+			else {
+				printf("%-7s %-16s 0x%08llX  rebase  0x%08llX\n", segName, sectName, it->address, it->target);
+			}
+		}
+	}
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printChainedRebaseInfo()
+{
+	std::vector<ChainedFixup> fixups;
+	std::vector<ChainedImport> imports;
+	chainedFixups(fixups, imports);
+	if ( !printJSON ) {
+		printf("rebase information (from chained fixups):\n");
+		printf("segment section          address     type\n");
+	}
+	for (typename std::vector<ChainedFixup>::iterator it=fixups.begin(); it != fixups.end(); ++it) {
+		if ( it->bind )
+			continue;
+		if ( printJSON )
+			printJSONRebase(it->segIndex, it->address, "pointer");
+		else
+			printf("%-7s %-16s 0x%08llX  %s\n", segmentName(it->segIndex), sectionName(it->segIndex, it->address), it->address, "pointer");
+	}
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printChainedBindingInfo()
+{
+	std::vector<ChainedFixup> fixups;
+	std::vector<ChainedImport> imports;
+	chainedFixups(fixups, imports);
+	if ( !printJSON ) {
+		printf("bind information:\n");
+		printf("segment section          address        type    addend dylib            symbol\n");
+	}
+	for (typename std::vector<ChainedFixup>::iterator it=fixups.begin(); it != fixups.end(); ++it) {
+		if ( it->bind ) {
+			const ChainedImport& import = imports[it->importIndex];
+			if ( printJSON )
+				printJSONBind("bind", it->segIndex, it->address, "pointer", import.addend + it->addend, 
+							ordinalName(import.libraryOrdinal), import.symbolName, import.weakImport);
+			else
+				printf("%-7s %-16s 0x%08llX %10s  %5lld %-16s %s%s\n", segmentName(it->segIndex), sectionName(it->segIndex, it->address), 
+						it->address, "pointer", import.addend + it->addend, ordinalName(import.libraryOrdinal), import.symbolName, 
+						import.weakImport ? " (weak import)" : "");
+		}
+	}
+}
+
 template <typename A>
 void DyldInfoPrinter<A>::printWeakBindingInfo()
 {
 	if ( (fInfo == NULL) || (fInfo->weak_bind_off() == 0) ) {
-		printf("no weak binding\n");
+		if ( !printJSON )
+			printf("no weak binding\n");
 	}
 	else {
-		printf("weak binding information:\n");
-		printf("segment section          address       type     addend symbol\n");
+		if ( !printJSON ) {
+			printf("weak binding information:\n");
+			printf("segment section          address       type     addend symbol\n");
+		}
 		const uint8_t* p = (uint8_t*)fHeader + fInfo->weak_bind_off();
 		const uint8_t* end = &p[fInfo->weak_bind_size()];
 		
@@ -1050,8 +1418,17 @@ void DyldInfoPrinter<A>::printWeakBindingInfo()
 					while (*p != '\0')
 						++p;
 					++p;
-					if ( (immediate & BIND_SYMBOL_FLAGS_NON_WEAK_DEFINITION) != 0 )
-						printf("                                       strong          %s\n", symbolName );
+					if ( (immediate & BIND_SYMBOL_FLAGS_NON_WEAK_DEFINITION) != 0 ) {
+						if ( printJSON ) {
+							json_begin("weak_bind");
+							json_string_member("symbol", symbolName);
+							json_bool_member("strong", true);
+							json_end();
+						}
+						else {
+							printf("                                       strong          %s\n", symbolName );
+						}
+					}
 					break;
 				case BIND_OPCODE_SET_TYPE_IMM:
 					type = immediate;
@@ -1070,22 +1447,34 @@ void DyldInfoPrinter<A>::printWeakBindingInfo()
 					segOffset += read_uleb128(p, end);
 					break;
 				case BIND_OPCODE_DO_BIND:
-					printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
+					if ( printJSON )
+						printJSONBind("weak_bind", segIndex, segStartAddr+segOffset, typeName, addend, NULL, symbolName, false);
+					else
+						printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
 					segOffset += sizeof(pint_t);
 					break;
 				case BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB:
-					printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
+					if ( printJSON )
+						printJSONBind("weak_bind", segIndex, segStartAddr+segOffset, typeName, addend, NULL, symbolName, false);
+					else
+						printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
 					segOffset += read_uleb128(p, end) + sizeof(pint_t);
 					break;
 				case BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED:
-					printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
+					if ( printJSON )
+						printJSONBind("weak_bind", segIndex, segStartAddr+segOffset, typeName, addend, NULL, symbolName, false);
+					else
+						printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
 					segOffset += immediate*sizeof(pint_t) + sizeof(pint_t);
 					break;
 				case BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB:
 					count = read_uleb128(p, end);
 					skip = read_uleb128(p, end);
 					for (uint32_t i=0; i < count; ++i) {
-					printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
+					if ( printJSON )
+						printJSONBind("weak_bind", segIndex, segStartAddr+segOffset, typeName, addend, NULL, symbolName, false);
+					else
+						printf("%-7s %-16s 0x%08llX %10s   %5lld %s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, typeName, addend, symbolName );
 							segOffset += skip + sizeof(pint_t);
 					}
 					break;
@@ -1102,14 +1491,18 @@ template <typename A>
 void DyldInfoPrinter<A>::printLazyBindingInfo()
 {
 	if ( fInfo == NULL ) {
-		printf("no compressed dyld info\n");
+		if ( !printJSON )
+			printf("no compressed dyld info\n");
 	}
 	else if ( fInfo->lazy_bind_off() == 0 ) {
-		printf("no compressed lazy binding info\n");
+		if ( !printJSON )
+			printf("no compressed lazy binding info\n");
 	}
 	else {
-		printf("lazy binding information (from lazy_bind part of dyld info):\n");
-		printf("segment section          address    index  dylib            symbol\n");
+		if ( !printJSON ) {
+			printf("lazy binding information (from lazy_bind part of dyld info):\n");
+			printf("segment section          address    index  dylib            symbol\n");
+		}
 		const uint8_t* const start = (uint8_t*)fHeader + fInfo->lazy_bind_off();
 		const uint8_t* const end = &start[fInfo->lazy_bind_size()];
 
@@ -1178,7 +1571,10 @@ void DyldInfoPrinter<A>::printLazyBindingInfo()
 					segOffset += read_uleb128(p, end);
 					break;
 				case BIND_OPCODE_DO_BIND:
-					printf("%-7s %-16s 0x%08llX 0x%04X %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, lazy_offset, fromDylib, symbolName, weak_import);
+					if ( printJSON )
+						printJSONBind("lazy_bind", segIndex, segStartAddr+segOffset, bindTypeName(type), addend, fromDylib, symbolName, (weak_import[0] != '\0'), lazy_offset);
+					else
+						printf("%-7s %-16s 0x%08llX 0x%04X %-16s %s%s\n", segName, sectionName(segIndex, segStartAddr+segOffset), segStartAddr+segOffset, lazy_offset, fromDylib, symbolName, weak_import);
 					segOffset += sizeof(pint_t);
 					break;
 				default:
@@ -1295,16 +1691,34 @@ struct SortExportsByAddress
      }
 };
 
+template <typename A>
+bool DyldInfoPrinter<A>::exportTrie(const uint8_t*& start, const uint8_t*& end)
+{
+	if ( (fInfo != NULL) && (fInfo->export_off() != 0) ) {
+		start = (uint8_t*)fHeader + fInfo->export_off();
+		end = &start[fInfo->export_size()];
+		return true;
+	}
+	if ( (fExportsTrie != NULL) && (fExportsTrie->datasize() != 0) ) {
+		start = (uint8_t*)fHeader + fExportsTrie->dataoff();
+		end = &start[fExportsTrie->datasize()];
+		return true;
+	}
+	return false;
+}
+
 template <typename A>
 void DyldInfoPrinter<A>::printExportInfo()
 {
-	if ( (fInfo == NULL) || (fInfo->export_off() == 0) ) {
-		printf("no compressed export info\n");
+	const uint8_t* start;
+	const uint8_t* end;
+	if ( !exportTrie(start, end) ) {
+		if ( !printJSON )
+			printf("no compressed export info\n");
 	}
 	else {
-		printf("export information (from trie):\n");
-		const uint8_t* start = (uint8_t*)fHeader + fInfo->export_off();
-		const uint8_t* end = &start[fInfo->export_size()];
+		if ( !printJSON )
+			printf("export information (from trie):\n");
 		std::vector<mach_o::trie::Entry> list;
 		parseTrie(start, end, list);
 		//std::sort(list.begin(), list.end(), SortExportsByAddress());
@@ -1314,6 +1728,27 @@ void DyldInfoPrinter<A>::printExportInfo()
 			const bool threadLocal = ((it->flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL);
 			const bool abs = ((it->flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE);
 			const bool resolver = (it->flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER);
+			if ( printJSON ) {
+				json_begin("export");
+				json_string_member("name", it->name);
+				if ( !reExport )
+					json_uint_member("address", fBaseAddress+it->address);
+				if ( weakDef )
+					json_bool_member("weak_def", true);
+				if ( threadLocal )
+					json_bool_member("thread_local", true);
+				if ( abs )
+					json_bool_member("absolute", true);
+				if ( resolver )
+					json_uint_member("resolver", it->other);
+				if ( reExport ) {
+					json_string_member("reexport_from", fDylibs[it->other - 1]);
+					if ( it->importName[0] != '\0' )
+						json_string_member("reexport_name", it->importName);
+				}
+				json_end();
+				continue;
+			}
 			if ( reExport )
 				printf("[re-export] ");
 			else
@@ -1408,12 +1843,12 @@ void DyldInfoPrinter<A>::processExportGraphNode(const uint8_t* const start, cons
 template <typename A>
 void DyldInfoPrinter<A>::printExportInfoGraph()
 {
-	if ( (fInfo == NULL) || (fInfo->export_off() == 0) ) {
+	const uint8_t* p;
+	const uint8_t* end;
+	if ( !exportTrie(p, end) ) {
 		printf("no compressed export info\n");
 	}
 	else {
-		const uint8_t* p = (uint8_t*)fHeader + fInfo->export_off();
-		const uint8_t* end = &p[fInfo->export_size()];
 		char cummulativeString[2000];
 		printf("digraph {\n");
 		processExportGraphNode(p, end, p, p, cummulativeString, 0);
@@ -1446,12 +1881,12 @@ void DyldInfoPrinter<A>::gatherNodeStarts(const uint8_t* const start, const uint
 template <typename A>
 void DyldInfoPrinter<A>::printExportInfoNodes()
 {
-	if ( (fInfo == NULL) || (fInfo->export_off() == 0) ) {
+	const uint8_t* start;
+	const uint8_t* end;
+	if ( !exportTrie(start, end) ) {
 		printf("no compressed export info\n");
 	}
 	else {
-		const uint8_t* start = (uint8_t*)fHeader + fInfo->export_off();
-		const uint8_t* end = &start[fInfo->export_size()];
 		std::vector<uint32_t> nodeStarts;
 		gatherNodeStarts(start, end, start, start, nodeStarts);
 		std::sort(nodeStarts.begin(), nodeStarts.end());
@@ -1739,7 +2174,9 @@ const char* DyldInfoPrinter<A>::sharedRegionKindName(uint8_t kind)
 template <>
 void DyldInfoPrinter<arm>::printFunctionStartLine(uint64_t addr)
 {
-	if ( addr & 1 )
+	if ( printJSON )
+		printJSONFunctionStart(addr & -2, (addr & 1));
+	else if ( addr & 1 )
 		printf("0x%0llX [thumb] %s\n", (addr & -2), symbolNameForAddress(addr & -2)); 
 	else
 		printf("0x%0llX         %s\n", addr, symbolNameForAddress(addr)); 
@@ -1749,7 +2186,24 @@ void DyldInfoPrinter<arm>::printFunctionStartLine(uint64_t addr)
 template <typename A>
 void DyldInfoPrinter<A>::printFunctionStartLine(uint64_t addr)
 {
-	printf("0x%0llX   %s\n", addr, symbolNameForAddress(addr)); 
+	if ( printJSON )
+		printJSONFunctionStart(addr, false);
+	else
+		printf("0x%0llX   %s\n", addr, symbolNameForAddress(addr)); 
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printJSONFunctionStart(uint64_t addr, bool thumb)
+{
+	uint64_t offset;
+	const char* name = closestSymbolNameForAddress(addr, &offset);
+	json_begin("function_start");
+	json_uint_member("address", addr);
+	if ( thumb )
+		json_bool_member("thumb", true);
+	if ( (name != NULL) && (offset == 0) )
+		json_string_member("symbol", name);
+	json_end();
 }
 
 
@@ -1757,7 +2211,8 @@ template <typename A>
 void DyldInfoPrinter<A>::printFunctionStartsInfo()
 {
 	if ( (fFunctionStartsInfo == NULL) || (fFunctionStartsInfo->datasize() == 0) ) {
-		printf("no function starts info\n");
+		if ( !printJSON )
+			printf("no function starts info\n");
 	}
 	else {
 		const uint8_t* infoStart = (uint8_t*)fHeader + fFunctionStartsInfo->dataoff();
@@ -1784,7 +2239,8 @@ void DyldInfoPrinter<A>::printFunctionStartsInfo()
 template <typename A>
 void DyldInfoPrinter<A>::printDylibsInfo()
 {
-	printf("attributes     dependent dylibs\n");
+	if ( !printJSON )
+		printf("attributes     dependent dylibs\n");
 	for(typename std::vector<const macho_dylib_command<P>*>::iterator it = fDylibLoadCommands.begin(); it != fDylibLoadCommands.end(); ++it) {
 		const macho_dylib_command<P>* dylib  = *it;
 		const char* attribute = "";
@@ -1805,7 +2261,17 @@ void DyldInfoPrinter<A>::printDylibsInfo()
 			default:
 				break;
 		}
-		printf(" %-12s   %s\n", attribute, dylib->name());
+		if ( printJSON ) {
+			json_begin("dylib");
+			json_uint_member("ordinal", (it - fDylibLoadCommands.begin()) + 1);
+			json_string_member("path", dylib->name());
+			if ( attribute[0] != '\0' )
+				json_string_member("attribute", attribute);
+			json_end();
+		}
+		else {
+			printf(" %-12s   %s\n", attribute, dylib->name());
+		}
 	}
 }
 
@@ -1856,10 +2322,12 @@ template <typename A>
 void DyldInfoPrinter<A>::printDataInCode()
 {
 	if ( fDataInCode == NULL ) {
-		printf("no data-in-code info\n");
+		if ( !printJSON )
+			printf("no data-in-code info\n");
 	}
 	else {
-		printf("offset      length  data-kind\n");
+		if ( !printJSON )
+			printf("offset      length  data-kind\n");
 		const macho_data_in_code_entry<P>* start = (macho_data_in_code_entry<P>*)((uint8_t*)fHeader + fDataInCode->dataoff());
 		const macho_data_in_code_entry<P>* end = (macho_data_in_code_entry<P>*)((uint8_t*)fHeader + fDataInCode->dataoff() + fDataInCode->datasize());
 		for (const macho_data_in_code_entry<P>* p=start; p < end; ++p) {
@@ -1881,7 +2349,16 @@ void DyldInfoPrinter<A>::printDataInCode()
 					kindStr = "jumptable32absolute";
 					break;
 			}
-			printf("0x%08X  0x%04X  %s\n", p->offset(), p->length(), kindStr);
+			if ( printJSON ) {
+				json_begin("data_in_code");
+				json_uint_member("offset", p->offset());
+				json_uint_member("length", p->length());
+				json_string_member("data_kind", kindStr);
+				json_end();
+			}
+			else {
+				printf("0x%08X  0x%04X  %s\n", p->offset(), p->length(), kindStr);
+			}
 		}
 	}
 }
@@ -2007,11 +2484,14 @@ template <typename A>
 void DyldInfoPrinter<A>::printRelocRebaseInfo()
 {
 	if ( fDynamicSymbolTable == NULL ) {
-		printf("no classic dynamic symbol table");
+		if ( !printJSON )
+			printf("no classic dynamic symbol table");
 	}
 	else {
-		printf("rebase information (from local relocation records and indirect symbol table):\n");
-		printf("segment  section          address     type\n");
+		if ( !printJSON ) {
+			printf("rebase information (from local relocation records and indirect symbol table):\n");
+			printf("segment  section          address     type\n");
+		}
 		// walk all local relocations
 		pint_t rbase = relocBase();
 		const macho_relocation_info<P>* const relocsStart = (macho_relocation_info<P>*)(((uint8_t*)fHeader) + fDynamicSymbolTable->locreloff());
@@ -2023,7 +2503,10 @@ void DyldInfoPrinter<A>::printRelocRebaseInfo()
 				const char* typeName = relocTypeName(reloc->r_type());
 				const char* segName  = segmentName(segIndex);
 				const char* sectName = sectionName(segIndex, addr);
-				printf("%-8s %-16s 0x%08llX  %s\n", segName, sectName, (uint64_t)addr, typeName);
+				if ( printJSON )
+					printJSONRebase(segIndex, addr, typeName);
+				else
+					printf("%-8s %-16s 0x%08llX  %s\n", segName, sectName, (uint64_t)addr, typeName);
 			} 
 			else {
 				const macho_scattered_relocation_info<P>* sreloc = (macho_scattered_relocation_info<P>*)reloc;
@@ -2032,7 +2515,10 @@ void DyldInfoPrinter<A>::printRelocRebaseInfo()
 				const char* typeName = relocTypeName(sreloc->r_type());
 				const char* segName  = segmentName(segIndex);
 				const char* sectName = sectionName(segIndex, addr);
-				printf("%-8s %-16s 0x%08llX  %s\n", segName, sectName, (uint64_t)addr, typeName);
+				if ( printJSON )
+					printJSONRebase(segIndex, addr, typeName);
+				else
+					printf("%-8s %-16s 0x%08llX  %s\n", segName, sectName, (uint64_t)addr, typeName);
 			}
 		}
 		// look for local non-lazy-pointers
@@ -2054,7 +2540,10 @@ void DyldInfoPrinter<A>::printRelocRebaseInfo()
 							const char* typeName = "pointer";
 							const char* segName  = segmentName(segIndex);
 							const char* sectName = sectionName(segIndex, addr);
-							printf("%-8s %-16s 0x%08llX  %s\n", segName, sectName, (uint64_t)addr, typeName);
+							if ( printJSON )
+								printJSONRebase(segIndex, addr, typeName);
+							else
+								printf("%-8s %-16s 0x%08llX  %s\n", segName, sectName, (uint64_t)addr, typeName);
 						}
 					}
 				}
@@ -2068,10 +2557,12 @@ template <typename A>
 void DyldInfoPrinter<A>::printSymbolTableExportInfo()
 {
 	if ( fDynamicSymbolTable == NULL ) {
-		printf("no classic dynamic symbol table");
+		if ( !printJSON )
+			printf("no classic dynamic symbol table");
 	}
 	else {
-		printf("export information (from symbol table):\n");
+		if ( !printJSON )
+			printf("export information (from symbol table):\n");
 		const macho_nlist<P>* lastExport = &fSymbols[fDynamicSymbolTable->iextdefsym()+fDynamicSymbolTable->nextdefsym()];
 		for (const macho_nlist<P>* sym = &fSymbols[fDynamicSymbolTable->iextdefsym()]; sym < lastExport; ++sym) {
 			const char* flags = "";
@@ -2080,56 +2571,84 @@ void DyldInfoPrinter<A>::printSymbolTableExportInfo()
 			pint_t thumb = 0;
 			if ( sym->n_desc() & N_ARM_THUMB_DEF )
 				thumb = 1;
-			printf("0x%08llX %s%s\n", sym->n_value()+thumb, flags, &fStrings[sym->n_strx()]);
+			if ( printJSON ) {
+				json_begin("export");
+				json_string_member("name", &fStrings[sym->n_strx()]);
+				json_uint_member("address", sym->n_value()+thumb);
+				if ( sym->n_desc() & N_WEAK_DEF )
+					json_bool_member("weak_def", true);
+				json_end();
+			}
+			else {
+				printf("0x%08llX %s%s\n", sym->n_value()+thumb, flags, &fStrings[sym->n_strx()]);
+			}
 		}
 	}
 }
 
 template <typename A>
-const char* DyldInfoPrinter<A>::closestSymbolNameForAddress(uint64_t addr, uint64_t* offset, uint8_t sectIndex)
+void DyldInfoPrinter<A>::buildSymbolIndex()
 {
-	const macho_nlist<P>* bestSymbol = NULL;
+	// the symbols closestSymbolNameForAddress() picks from, in the order it prefers them
 	if ( fDynamicSymbolTable != NULL ) {
-		// find closest match in globals
 		const macho_nlist<P>* const globalsStart = &fSymbols[fDynamicSymbolTable->iextdefsym()];
 		const macho_nlist<P>* const globalsEnd   = &globalsStart[fDynamicSymbolTable->nextdefsym()];
 		for (const macho_nlist<P>* s = globalsStart; s < globalsEnd; ++s) {
-			if ( (s->n_type() & N_TYPE) == N_SECT ) {
-				if ( (s->n_value() <= addr) && ((s->n_sect() == sectIndex) || (sectIndex ==0)) ) {
-					if ( (bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value()) )
-						bestSymbol = s;
-				}
-			}
+			if ( (s->n_type() & N_TYPE) == N_SECT )
+				fSymbolsByAddress.push_back(s);
 		}
-
-		// find closest match in locals
 		const macho_nlist<P>* const localsStart = &fSymbols[fDynamicSymbolTable->ilocalsym()];
 		const macho_nlist<P>* const localsEnd   = &localsStart[fDynamicSymbolTable->nlocalsym()];
 		for (const macho_nlist<P>* s = localsStart; s < localsEnd; ++s) {
-			if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) ) {
-				if ( (s->n_value() <= addr) && ((s->n_sect() == sectIndex) || (sectIndex ==0)) ) {
-					if ( (bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value()) )
-						bestSymbol = s;
-				}
-			}
+			if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) )
+				fSymbolsByAddress.push_back(s);
 		}
 	}
 	else {
-		// find closest match in locals
 		const macho_nlist<P>* const allStart = &fSymbols[0];
 		const macho_nlist<P>* const allEnd   = &fSymbols[fSymbolCount];
 		for (const macho_nlist<P>* s = allStart; s < allEnd; ++s) {
-			if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) ) {
-				if ( (s->n_value() <= addr) && ((s->n_sect() == sectIndex) || (sectIndex ==0)) ) {
-					if ( (bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value()) )
-						bestSymbol = s;
-				}
-			}
+			if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) )
+				fSymbolsByAddress.push_back(s);
 		}
 	}
-	if ( bestSymbol != NULL ) {
-		*offset = addr - bestSymbol->n_value();
-		return &fStrings[bestSymbol->n_strx()];
+	// stable sorts keep the preferred symbol first among those with the same address
+	std::stable_sort(fSymbolsByAddress.begin(), fSymbolsByAddress.end(), [](const macho_nlist<P>* left, const macho_nlist<P>* right) {
+		return (left->n_value() < right->n_value());
+	});
+	fSymbolsBySection = fSymbolsByAddress;
+	std::stable_sort(fSymbolsBySection.begin(), fSymbolsBySection.end(), [](const macho_nlist<P>* left, const macho_nlist<P>* right) {
+		return (left->n_sect() < right->n_sect());
+	});
+	fSymbolIndexBuilt = true;
+}
+
+template <typename A>
+const char* DyldInfoPrinter<A>::closestSymbolNameForAddress(uint64_t addr, uint64_t* offset, uint8_t sectIndex)
+{
+	if ( !fSymbolIndexBuilt )
+		buildSymbolIndex();
+	typename std::vector<const macho_nlist<P>*>::const_iterator first = fSymbolsByAddress.begin();
+	typename std::vector<const macho_nlist<P>*>::const_iterator last = fSymbolsByAddress.end();
+	if ( sectIndex != 0 ) {
+		first = std::lower_bound(fSymbolsBySection.begin(), fSymbolsBySection.end(), sectIndex, [](const macho_nlist<P>* sym, uint8_t sect) {
+			return (sym->n_sect() < sect);
+		});
+		last = std::upper_bound(first, fSymbolsBySection.cend(), sectIndex, [](uint8_t sect, const macho_nlist<P>* sym) {
+			return (sect < sym->n_sect());
+		});
+	}
+	// the closest symbol is the first one at the highest address not above addr
+	typename std::vector<const macho_nlist<P>*>::const_iterator pos = std::upper_bound(first, last, addr, [](uint64_t address, const macho_nlist<P>* sym) {
+		return (address < sym->n_value());
+	});
+	if ( pos != first ) {
+		const uint64_t bestAddress = (*(pos-1))->n_value();
+		pos = std::lower_bound(first, pos, bestAddress, [](const macho_nlist<P>* sym, uint64_t address) {
+			return (sym->n_value() < address);
+		});
+		*offset = addr - bestAddress;
+		return &fStrings[(*pos)->n_strx()];
 	}
 	*offset = 0;
 	return NULL;
@@ -2149,11 +2668,14 @@ template <typename A>
 void DyldInfoPrinter<A>::printClassicBindingInfo()
 {
 	if ( fDynamicSymbolTable == NULL ) {
-		printf("no classic dynamic symbol table");
+		if ( !printJSON )
+			printf("no classic dynamic symbol table");
 	}
 	else {
-		printf("binding information (from relocations and indirect symbol table):\n");
-		printf("segment  section          address        type   weak  addend dylib            symbol\n");
+		if ( !printJSON ) {
+			printf("binding information (from relocations and indirect symbol table):\n");
+			printf("segment  section          address        type   weak  addend dylib            symbol\n");
+		}
 		// walk all external relocations
 		pint_t rbase = relocBase();
 		const macho_relocation_info<P>* const relocsStart = (macho_relocation_info<P>*)(((uint8_t*)fHeader) + fDynamicSymbolTable->extreloff());
@@ -2176,8 +2698,11 @@ void DyldInfoPrinter<A>::printClassicBindingInfo()
 				// To get the addend requires subtracting out the base address it was prebound to.
 				addend -= sym->n_value();
 			}
-			printf("%-8s %-16s 0x%08llX %10s %4s  %5lld %-16s %s\n", segName, sectName, (uint64_t)addr, 
-									typeName, weak_import, addend, fromDylib, symbolName);
+			if ( printJSON )
+				printJSONBind("bind", segIndex, addr, typeName, addend, fromDylib, symbolName, (weak_import[0] != '\0'));
+			else
+				printf("%-8s %-16s 0x%08llX %10s %4s  %5lld %-16s %s\n", segName, sectName, (uint64_t)addr, 
+										typeName, weak_import, addend, fromDylib, symbolName);
 		}
 		// look for non-lazy pointers
 		const uint32_t* indirectSymbolTable =  (uint32_t*)(((uint8_t*)fHeader) + fDynamicSymbolTable->indirectsymoff());
@@ -2203,8 +2728,11 @@ void DyldInfoPrinter<A>::printClassicBindingInfo()
 							const char* segName  = segmentName(segIndex);
 							const char* sectName = sectionName(segIndex, addr);
 							int64_t addend = 0;
-							printf("%-8s %-16s 0x%08llX %10s %4s  %5lld %-16s %s\n", segName, sectName, (uint64_t)addr, 
-																	typeName, weak_import, addend, fromDylib, symbolName);
+							if ( printJSON )
+								printJSONBind("bind", segIndex, addr, typeName, addend, fromDylib, symbolName, (weak_import[0] != '\0'));
+							else
+								printf("%-8s %-16s 0x%08llX %10s %4s  %5lld %-16s %s\n", segName, sectName, (uint64_t)addr, 
+																		typeName, weak_import, addend, fromDylib, symbolName);
 						}
 					}
 				}
@@ -2218,11 +2746,14 @@ template <typename A>
 void DyldInfoPrinter<A>::printClassicLazyBindingInfo()
 {
 	if ( fDynamicSymbolTable == NULL ) {
-		printf("no classic dynamic symbol table");
+		if ( !printJSON )
+			printf("no classic dynamic symbol table");
 	}
 	else {
-		printf("lazy binding information (from section records and indirect symbol table):\n");
-		printf("segment section          address    index  dylib            symbol\n");
+		if ( !printJSON ) {
+			printf("lazy binding information (from section records and indirect symbol table):\n");
+			printf("segment section          address    index  dylib            symbol\n");
+		}
 		const uint32_t* indirectSymbolTable =  (uint32_t*)(((uint8_t*)fHeader) + fDynamicSymbolTable->indirectsymoff());
 		for(typename std::vector<const macho_segment_command<P>*>::iterator segit=fSegments.begin(); segit != fSegments.end(); ++segit) {
 			const macho_segment_command<P>* segCmd = *segit;
@@ -2242,7 +2773,10 @@ void DyldInfoPrinter<A>::printClassicLazyBindingInfo()
 						uint8_t segIndex = segmentIndexForAddress(addr);
 						const char* segName  = segmentName(segIndex);
 						const char* sectName = sectionName(segIndex, addr);
-						printf("%-7s %-16s 0x%08llX 0x%04X %-16s %s\n", segName, sectName, (uint64_t)addr, symbolIndex, fromDylib, symbolName);
+						if ( printJSON )
+							printJSONBind("lazy_bind", segIndex, addr, "pointer", 0, fromDylib, symbolName, false, symbolIndex);
+						else
+							printf("%-7s %-16s 0x%08llX 0x%04X %-16s %s\n", segName, sectName, (uint64_t)addr, symbolIndex, fromDylib, symbolName);
 					}
 				}
 				else if ( (type == S_SYMBOL_STUBS) && (((sect->flags() & S_ATTR_SELF_MODIFYING_CODE) != 0)) && (sect->reserved2() == 5) ) {
@@ -2259,7 +2793,10 @@ void DyldInfoPrinter<A>::printClassicLazyBindingInfo()
 							uint8_t segIndex = segmentIndexForAddress(addr);
 							const char* segName  = segmentName(segIndex);
 							const char* sectName = sectionName(segIndex, addr);
-							printf("%-7s %-16s 0x%08llX 0x%04X %-16s %s\n", segName, sectName, (uint64_t)addr, symbolIndex, fromDylib, symbolName);
+							if ( printJSON )
+								printJSONBind("lazy_bind", segIndex, addr, "pointer", 0, fromDylib, symbolName, false, symbolIndex);
+							else
+								printf("%-7s %-16s 0x%08llX 0x%04X %-16s %s\n", segName, sectName, (uint64_t)addr, symbolIndex, fromDylib, symbolName);
 						}
 					}
 				}
@@ -2367,6 +2904,7 @@ static void dump(const char* path)
 		else {
 			throw "not a known file type";
 		}
+		::munmap(p, stat_buf.st_size);
 	}
 	catch (const char* msg) {
 		throwf("%s in %s", msg, path);
@@ -2387,6 +2925,9 @@ static void usage()
 			"\t-function_starts  print table of function start addresses\n"
 			"\t-export_dot       print a GraphViz .dot file of the exported symbols trie\n"
 			"\t-data_in_code     print any data-in-code information\n"
+			"\t-fixups           print the chained fixups of each pointer\n"
+			"\t-all              print the dylibs, rebase, bind, weak_bind, lazy_bind, export, function_starts and data_in_code info\n"
+			"\t-json             print one JSON object per line instead of text\n"
 		);
 }
 
@@ -2473,6 +3014,22 @@ int main(int argc, const char* argv[])
 				else if ( strcmp(arg, "-data_in_code") == 0 ) {
 					printDataCode = true;
 				}
+				else if ( strcmp(arg, "-fixups") == 0 ) {
+					printFixups = true;
+				}
+				else if ( strcmp(arg, "-all") == 0 ) {
+					printDylibs = true;
+					printRebase = true;
+					printBind = true;
+					printWeakBind = true;
+					printLazyBind = true;
+					printExport = true;
+					printFunctionStarts = true;
+					printDataCode = true;
+				}
+				else if ( strcmp(arg, "-json") == 0 ) {
+					printJSON = true;
+				}
 				else {
 					throwf("unknown option: %s\n", arg);
 				}
@@ -2481,10 +3038,14 @@ int main(int argc, const char* argv[])
 				files.push_back(arg);
 			}
 		}
+		if ( printJSON && (printOpcodes || printExportGraph || printExportNodes || printSharedRegion || printDRs) )
+			throw "-json cannot be used with -opcodes, -export_dot, -export_trie_nodes, -shared_region or -dr";
 		if ( files.size() == 0 )
 			usage();
-		if ( files.size() == 1 ) {
-			dump(files[0]);
+		if ( (files.size() == 1) || printJSON ) {
+			// with -json each image record names its file
+			for(std::vector<const char*>::iterator it=files.begin(); it != files.end(); ++it)
+				dump(*it);
 		}
 		else {
 			for(std::vector<const char*>::iterator it=files.begin(); it != files.end(); ++it) {
@@ -0,0 +1,487 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for dyldinfo -json.  A small x86_64 dylib with a rebase, a bind and
+// exports, two of them with names that are not plain ASCII, is written by
+// OutputFile and dyldinfo -json -all is run on it.  Every line of the output
+// must be a JSON object whose first member is "kind", and the records must
+// describe the image: its dylib, the rebase and bind of its pointers, its
+// exports and its function starts, at addresses that agree with each other.
+//
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Options.h"
+#include "ld.hpp"
+#include "InternalState.h"
+#include "OutputFile.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "dyldinfotest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static const char* sDyldInfo = NULL;
+static std::string sTempDir;
+
+static ld::Section sHeaderSection("__TEXT", "__mach_header", ld::Section::typeMachHeader, true);
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sDataSection("__DATA", "__data", ld::Section::typeUnclassified);
+static ld::Section sImportSection("__TEXT", "__import", ld::Section::typeImportProxies, true);
+
+class TestDylib : public ld::dylib::File
+{
+public:
+											TestDylib(const char* path, uint32_t ordinal)
+												: ld::dylib::File(path, 0, ld::File::Ordinal::makeArgOrdinal(ordinal)) {
+													_dylibInstallPath = path;
+													_dylibCurrentVersion = 0x10000;
+													_dylibCompatibilityVersion = 0x10000;
+													setExplicitlyLinked();
+												}
+
+	virtual bool							forEachAtom(AtomHandler&) const					{ return false; }
+	virtual bool							justInTimeforEachAtom(const char*, AtomHandler&) const { return false; }
+	virtual void							processIndirectLibraries(DylibHandler*, bool)	{ }
+	virtual bool							providedExportAtom() const						{ return false; }
+	virtual const char*						parentUmbrella() const							{ return NULL; }
+	virtual const std::vector<const char*>*	allowableClients() const						{ return NULL; }
+	virtual const std::vector<const char*>&	rpaths() const									{ return _rpaths; }
+	virtual bool							hasWeakExternals() const						{ return false; }
+	virtual bool							deadStrippable() const							{ return false; }
+	virtual bool							hasWeakDefinition(const char*) const			{ return false; }
+	virtual bool							hasPublicInstallName() const					{ return true; }
+	virtual bool							allSymbolsAreWeakImported() const				{ return false; }
+	virtual bool							appExtensionSafe() const						{ return true; }
+
+private:
+	std::vector<const char*>				_rpaths;
+};
+
+class ProxyAtom : public ld::Atom
+{
+public:
+											ProxyAtom(const TestDylib& dylib, const char* name)
+												: ld::Atom(sImportSection, ld::Atom::definitionProxy, ld::Atom::combineNever,
+													ld::Atom::scopeLinkageUnit, ld::Atom::typeUnclassified, ld::Atom::symbolTableNotIn,
+													false, false, false, ld::Atom::Alignment(0)), _dylib(dylib), _name(name) { }
+
+	virtual const ld::File*					file() const					{ return &_dylib; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return 0; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { }
+
+private:
+	const TestDylib&						_dylib;
+	const char*								_name;
+};
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const char* name, ld::Atom::Scope scope, uint64_t size, uint8_t align,
+													 ld::Atom::SymbolTableInclusion inclusion=ld::Atom::symbolTableIn)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													scope, ld::Atom::typeUnclassified, inclusion,
+													false, false, false, ld::Atom::Alignment(align)),
+												  _name(name), _content(size, 0) { }
+
+	virtual const ld::File*					file() const					{ return NULL; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _content.size(); }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { memcpy(buffer, _content.data(), _content.size()); }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void									addPointer(uint32_t offset, const ld::Atom* target)
+	{
+		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, target));
+	}
+
+private:
+	const char*								_name;
+	std::vector<uint8_t>					_content;
+	std::vector<ld::Fixup>					_fixups;
+};
+
+
+static const char* sFunction = "_foo";
+static const char* sUTF8Function = "_caf\xC3\xA9";		// copied as is
+static const char* sBadFunction = "_bad\xFF";			// escaped as \u00FF
+static const char* sPointer = "_foo_ptr";				// rebased, points to _foo
+static const char* sImportPointer = "_data_ptr";		// bound, points to _data
+static const char* sImport = "_data";
+
+// links the dylib to path, returns an empty string or the error thrown
+static std::string link(const std::string& path, const std::string& objectPath)
+{
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-dylib");
+	args.push_back("-install_name");
+	args.push_back("/usr/lib/libdyldinfotest.dylib");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back(path.c_str());
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+	try {
+		Options opts(args.size()-1, &args[0]);
+		InternalState state(opts);
+		// the Resolver sets this from -arch
+		state.cpuSubType = opts.subArchitecture();
+		TestDylib libA("/usr/lib/libA.dylib", 1);
+		state.dylibs.push_back(&libA);
+		ProxyAtom import(libA, sImport);
+		TestAtom header(sHeaderSection, "___dso_handle", ld::Atom::scopeLinkageUnit, 0, 0, ld::Atom::symbolTableNotIn);
+		TestAtom function(sTextSection, sFunction, ld::Atom::scopeGlobal, 16, 4);
+		TestAtom utf8Function(sTextSection, sUTF8Function, ld::Atom::scopeGlobal, 16, 4);
+		TestAtom badFunction(sTextSection, sBadFunction, ld::Atom::scopeGlobal, 16, 4);
+		TestAtom pointer(sDataSection, sPointer, ld::Atom::scopeGlobal, 8, 3);
+		TestAtom importPointer(sDataSection, sImportPointer, ld::Atom::scopeGlobal, 8, 3);
+		pointer.addPointer(0, &function);
+		importPointer.addPointer(0, &import);
+		state.addAtom(header);
+		state.addAtom(import);
+		state.addAtom(function);
+		state.addAtom(utf8Function);
+		state.addAtom(badFunction);
+		state.addAtom(pointer);
+		state.addAtom(importPointer);
+		state.sortSections();
+		ld::tool::OutputFile output(opts);
+		output.write(state);
+	}
+	catch (const char* msg) {
+		return msg;
+	}
+	return "";
+}
+
+// runs dyldinfo with args on path, returns whether it succeeded and what it printed
+static bool runDyldInfo(const std::vector<const char*>& options, const std::string& path, std::string& output)
+{
+	std::string outputPath = sTempDir + "/output.txt";
+	std::vector<const char*> args;
+	args.push_back(sDyldInfo);
+	args.insert(args.end(), options.begin(), options.end());
+	args.push_back(path.c_str());
+	args.push_back(NULL);
+	pid_t pid = fork();
+	if ( pid == 0 ) {
+		int fd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		dup2(fd, STDOUT_FILENO);
+		execv(sDyldInfo, (char* const*)&args[0]);
+		perror(sDyldInfo);
+		_exit(127);
+	}
+	int status;
+	bool succeeded = (pid > 0) && (waitpid(pid, &status, 0) == pid) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+
+	output.clear();
+	FILE* f = fopen(outputPath.c_str(), "r");
+	if ( f != NULL ) {
+		char buffer[1024];
+		while ( size_t amount = fread(buffer, 1, sizeof(buffer), f) )
+			output.append(buffer, amount);
+		fclose(f);
+	}
+	unlink(outputPath.c_str());
+	return succeeded;
+}
+
+
+// a line of output: the members in order, strings decoded, other values as written
+typedef std::vector<std::pair<std::string, std::string> > Record;
+
+static const char* member(const Record& record, const char* name)
+{
+	for (Record::const_iterator it=record.begin(); it != record.end(); ++it) {
+		if ( it->first == name )
+			return it->second.c_str();
+	}
+	return NULL;
+}
+
+static void appendUTF8(std::string& s, uint32_t c)
+{
+	if ( c < 0x80 ) {
+		s += (char)c;
+	}
+	else if ( c < 0x800 ) {
+		s += (char)(0xC0 | (c >> 6));
+		s += (char)(0x80 | (c & 0x3F));
+	}
+	else {
+		s += (char)(0xE0 | (c >> 12));
+		s += (char)(0x80 | ((c >> 6) & 0x3F));
+		s += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+// parses a JSON string at p, returns false if it is not one
+static bool parseString(const char*& p, std::string& value)
+{
+	if ( *p != '"' )
+		return false;
+	value.clear();
+	for (++p; *p != '"'; ++p) {
+		unsigned char c = *p;
+		if ( c < 0x20 )
+			return false;
+		if ( c != '\\' ) {
+			value += (char)c;
+			continue;
+		}
+		++p;
+		switch ( *p ) {
+			case '"':
+			case '\\':
+			case '/':
+				value += *p;
+				break;
+			case 'n':
+				value += '\n';
+				break;
+			case 't':
+				value += '\t';
+				break;
+			case 'u': {
+				char hex[5] = { 0 };
+				for (int i=0; i < 4; ++i) {
+					if ( !isxdigit(p[1+i]) )
+						return false;
+					hex[i] = p[1+i];
+				}
+				appendUTF8(value, strtoul(hex, NULL, 16));
+				p += 4;
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	++p;
+	return true;
+}
+
+// parses a line holding one flat JSON object, returns false if it is not one
+static bool parseRecord(const std::string& line, Record& record)
+{
+	record.clear();
+	const char* p = line.c_str();
+	if ( *p++ != '{' )
+		return false;
+	while ( true ) {
+		std::string name;
+		std::string value;
+		if ( !parseString(p, name) || (*p++ != ':') )
+			return false;
+		if ( *p == '"' ) {
+			if ( !parseString(p, value) )
+				return false;
+		}
+		else {
+			const char* start = p;
+			while ( (*p != ',') && (*p != '}') && (*p != '\0') )
+				++p;
+			value.assign(start, p);
+			char* end;
+			bool number = !value.empty() && (strtoll(value.c_str(), &end, 10), *end == '\0');
+			if ( !number && (value != "true") && (value != "false") )
+				return false;
+		}
+		record.push_back(std::make_pair(name, value));
+		if ( *p == '}' )
+			break;
+		if ( *p++ != ',' )
+			return false;
+	}
+	return (p[1] == '\0');
+}
+
+// the records of a kind
+static std::vector<const Record*> recordsOfKind(const std::vector<Record>& records, const char* kind)
+{
+	std::vector<const Record*> result;
+	for (std::vector<Record>::const_iterator it=records.begin(); it != records.end(); ++it) {
+		if ( it->front().second == kind )
+			result.push_back(&*it);
+	}
+	return result;
+}
+
+static const Record* find(const std::vector<Record>& records, const char* kind, const char* name, const char* value)
+{
+	std::vector<const Record*> ofKind = recordsOfKind(records, kind);
+	for (std::vector<const Record*>::const_iterator it=ofKind.begin(); it != ofKind.end(); ++it) {
+		const char* v = member(**it, name);
+		if ( (v != NULL) && (strcmp(v, value) == 0) )
+			return *it;
+	}
+	return NULL;
+}
+
+static std::string str(const char* s)
+{
+	return (s != NULL) ? s : "(none)";
+}
+
+
+static void checkJSON(const std::string& path)
+{
+	std::vector<const char*> options;
+	options.push_back("-json");
+	options.push_back("-all");
+	std::string output;
+	check(runDyldInfo(options, path, output), "dyldinfo -json -all failed: %s", output.c_str());
+	check(!output.empty() && (output[output.size()-1] == '\n'), "output doesn't end with a newline");
+
+	// every line is a record, "kind" first
+	std::vector<Record> records;
+	size_t start = 0;
+	while ( start < output.size() ) {
+		size_t end = output.find('\n', start);
+		if ( end == std::string::npos )
+			end = output.size();
+		std::string line = output.substr(start, end - start);
+		start = end + 1;
+		Record record;
+		bool parsed = parseRecord(line, record);
+		check(parsed, "not a JSON object: %s", line.c_str());
+		if ( !parsed )
+			continue;
+		check(record.front().first == "kind", "first member is %s: %s", record.front().first.c_str(), line.c_str());
+		if ( record.front().first == "kind" )
+			records.push_back(record);
+	}
+	if ( records.empty() )
+		return;
+
+	// the image comes first
+	const Record& image = records.front();
+	check(image.front().second == "image", "first record is %s", image.front().second.c_str());
+	check(str(member(image, "path")) == path, "image path is %s", str(member(image, "path")).c_str());
+	check(str(member(image, "arch")) == "x86_64", "image arch is %s", str(member(image, "arch")).c_str());
+	check(str(member(image, "filetype")) == "6", "image filetype is %s", str(member(image, "filetype")).c_str());
+	check(recordsOfKind(records, "image").size() == 1, "%lu image records", recordsOfKind(records, "image").size());
+
+	const Record* dylib = find(records, "dylib", "path", "/usr/lib/libA.dylib");
+	check(dylib != NULL, "no dylib record for libA");
+	if ( dylib != NULL )
+		check(str(member(*dylib, "ordinal")) == "1", "libA has ordinal %s", str(member(*dylib, "ordinal")).c_str());
+
+	// each export is a function start or a pointer, names with non-ASCII bytes included
+	const char* functions[] = { sFunction, sUTF8Function, "_bad\xC3\xBF" };
+	std::map<std::string, std::string> exports;
+	std::vector<const Record*> exportRecords = recordsOfKind(records, "export");
+	for (std::vector<const Record*>::const_iterator it=exportRecords.begin(); it != exportRecords.end(); ++it)
+		exports[str(member(**it, "name"))] = str(member(**it, "address"));
+	check(exports.size() == 5, "%lu exports", exports.size());
+	for (size_t i=0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		check(exports.count(functions[i]) != 0, "no export %s", functions[i]);
+		const Record* start = find(records, "function_start", "address", exports[functions[i]].c_str());
+		check(start != NULL, "no function start for %s at %s", functions[i], exports[functions[i]].c_str());
+		if ( start != NULL )
+			check(str(member(*start, "symbol")) == functions[i], "function start at %s is %s", exports[functions[i]].c_str(),
+				  str(member(*start, "symbol")).c_str());
+	}
+	check(recordsOfKind(records, "function_start").size() == 3, "%lu function starts", recordsOfKind(records, "function_start").size());
+
+	// _foo_ptr is rebased, _data_ptr is bound to _data in libA
+	check(exports.count(sPointer) != 0, "no export %s", sPointer);
+	check(recordsOfKind(records, "rebase").size() == 1, "%lu rebases", recordsOfKind(records, "rebase").size());
+	const Record* rebase = find(records, "rebase", "address", exports[sPointer].c_str());
+	check(rebase != NULL, "no rebase at %s", exports[sPointer].c_str());
+	if ( rebase != NULL ) {
+		check(str(member(*rebase, "segment")) == "__DATA", "rebase in %s", str(member(*rebase, "segment")).c_str());
+		check(str(member(*rebase, "section")) == "__data", "rebase in %s", str(member(*rebase, "section")).c_str());
+		check(str(member(*rebase, "type")) == "pointer", "rebase type is %s", str(member(*rebase, "type")).c_str());
+	}
+	check(exports.count(sImportPointer) != 0, "no export %s", sImportPointer);
+	const Record* bind = find(records, "bind", "symbol", sImport);
+	check(bind != NULL, "no bind of %s", sImport);
+	if ( bind != NULL ) {
+		check(str(member(*bind, "address")) == exports[sImportPointer], "%s bound at %s", sImport, str(member(*bind, "address")).c_str());
+		check(str(member(*bind, "segment")) == "__DATA", "bind in %s", str(member(*bind, "segment")).c_str());
+		check(str(member(*bind, "type")) == "pointer", "bind type is %s", str(member(*bind, "type")).c_str());
+		check(str(member(*bind, "addend")) == "0", "bind addend is %s", str(member(*bind, "addend")).c_str());
+		check(str(member(*bind, "dylib")) == "libA", "%s bound from %s", sImport, str(member(*bind, "dylib")).c_str());
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	if ( argc != 2 ) {
+		fprintf(stderr, "usage: dyldinfotest <path to dyldinfo>\n");
+		return 1;
+	}
+	sDyldInfo = argv[1];
+	char dir[] = "/tmp/dyldinfotest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	sTempDir = dir;
+	std::string objectPath = sTempDir + "/test.o";
+	FILE* f = fopen(objectPath.c_str(), "w");
+	if ( f == NULL ) {
+		perror(objectPath.c_str());
+		return 1;
+	}
+	fclose(f);
+
+	std::string path = sTempDir + "/libdyldinfotest.dylib";
+	std::string error = link(path, objectPath);
+	check(error.empty(), "link failed: %s", error.c_str());
+	if ( error.empty() )
+		checkJSON(path);
+
+	unlink(path.c_str());
+	unlink(objectPath.c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "dyldinfotest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
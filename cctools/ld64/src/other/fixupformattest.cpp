@@ -0,0 +1,754 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for -fixup_chains (OutputFile::buildChainedFixups() and the
+// ChainedFixupsAtom in LinkEdit.hpp).  The same synthetic x86_64 dylib is
+// written twice by OutputFile, once with rebase/bind opcodes and once with
+// chained fixups.  Both images are read back, every pointer is resolved from
+// its encoding, and the results must be the same and match the targets the
+// atoms were linked with.  The bytes around the pointers must not differ.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+#include "Options.h"
+#include "ld.hpp"
+#include "InternalState.h"
+#include "OutputFile.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "fixupformattest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static ld::Section sHeaderSection("__TEXT", "__mach_header", ld::Section::typeMachHeader, true);
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sDataSection("__DATA", "__data", ld::Section::typeUnclassified);
+static ld::Section sImportSection("__TEXT", "__import", ld::Section::typeImportProxies, true);
+
+class TestDylib : public ld::dylib::File
+{
+public:
+											TestDylib(const char* path, uint32_t ordinal)
+												: ld::dylib::File(path, 0, ld::File::Ordinal::makeArgOrdinal(ordinal)) {
+													_dylibInstallPath = path;
+													_dylibCurrentVersion = 0x10000;
+													_dylibCompatibilityVersion = 0x10000;
+													setExplicitlyLinked();
+												}
+
+	virtual bool							forEachAtom(AtomHandler&) const					{ return false; }
+	virtual bool							justInTimeforEachAtom(const char*, AtomHandler&) const { return false; }
+	virtual void							processIndirectLibraries(DylibHandler*, bool)	{ }
+	virtual bool							providedExportAtom() const						{ return false; }
+	virtual const char*						parentUmbrella() const							{ return NULL; }
+	virtual const std::vector<const char*>*	allowableClients() const						{ return NULL; }
+	virtual const std::vector<const char*>&	rpaths() const									{ return _rpaths; }
+	virtual bool							hasWeakExternals() const						{ return false; }
+	virtual bool							deadStrippable() const							{ return false; }
+	virtual bool							hasWeakDefinition(const char*) const			{ return false; }
+	virtual bool							hasPublicInstallName() const					{ return true; }
+	virtual bool							allSymbolsAreWeakImported() const				{ return false; }
+	virtual bool							appExtensionSafe() const						{ return true; }
+
+private:
+	std::vector<const char*>				_rpaths;
+};
+
+class ProxyAtom : public ld::Atom
+{
+public:
+											ProxyAtom(const TestDylib& dylib, const char* name)
+												: ld::Atom(sImportSection, ld::Atom::definitionProxy, ld::Atom::combineNever,
+													ld::Atom::scopeLinkageUnit, ld::Atom::typeUnclassified, ld::Atom::symbolTableNotIn,
+													false, false, false, ld::Atom::Alignment(0)), _dylib(dylib), _name(name) { }
+
+	virtual const ld::File*					file() const					{ return &_dylib; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return 0; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { }
+
+private:
+	const TestDylib&						_dylib;
+	const char*								_name;
+};
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const char* name, uint64_t size, uint8_t align,
+													 ld::Atom::SymbolTableInclusion inclusion=ld::Atom::symbolTableIn)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													ld::Atom::scopeGlobal, ld::Atom::typeUnclassified, inclusion,
+													false, false, false, ld::Atom::Alignment(align)), _name(name), _content(size, 0) { }
+
+	virtual const ld::File*					file() const					{ return NULL; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _content.size(); }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { memcpy(buffer, _content.data(), _content.size()); }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void									fill(uint8_t seed)				{ for (size_t i=0; i < _content.size(); ++i) _content[i] = seed + i*7; }
+
+	void									addPointer(uint32_t offset, const ld::Atom* target, int64_t addend, bool weakImport)
+	{
+		if ( addend == 0 ) {
+			_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, target));
+			_fixups.back().weakImport = weakImport;
+		}
+		else {
+			_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, target));
+			_fixups.back().weakImport = weakImport;
+			_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindAddAddend, (uint64_t)addend));
+			_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndian64));
+		}
+	}
+
+private:
+	const char*								_name;
+	std::vector<uint8_t>					_content;
+	std::vector<ld::Fixup>					_fixups;
+};
+
+// a pointer resolved from either encoding
+struct Resolved
+{
+	bool				bind;
+	uint64_t			target;			// rebase: unslid target address, with the top byte
+	int					ordinal;		// bind: library ordinal, symbol, weak import and addend
+	std::string			symbol;
+	bool				weakImport;
+	int64_t				addend;
+
+	Resolved() : bind(false), target(0), ordinal(0), weakImport(false), addend(0) { }
+
+	bool operator==(const Resolved& other) const {
+		if ( bind != other.bind )
+			return false;
+		if ( !bind )
+			return (target == other.target);
+		return (ordinal == other.ordinal) && (symbol == other.symbol) && (weakImport == other.weakImport) && (addend == other.addend);
+	}
+
+	std::string description() const {
+		char buffer[1024];
+		if ( bind )
+			snprintf(buffer, sizeof(buffer), "bind %d %s%s%+lld", ordinal, symbol.c_str(), weakImport ? " (weak)" : "", (long long)addend);
+		else
+			snprintf(buffer, sizeof(buffer), "rebase 0x%llX", (unsigned long long)target);
+		return buffer;
+	}
+};
+
+typedef std::map<uint64_t, Resolved> ResolvedMap;
+
+struct Segment
+{
+	std::string			name;
+	uint64_t			vmaddr;
+	uint64_t			fileoff;
+	uint64_t			filesize;
+};
+
+// a linked image, read back from the file OutputFile wrote
+class Image
+{
+public:
+	bool							load(const std::string& path);
+	const uint8_t*					contentAt(uint64_t address) const;
+	void							resolveOpcodes(ResolvedMap& fixups) const;
+	void							resolveChains(ResolvedMap& fixups) const;
+
+	std::vector<uint8_t>			bytes;
+	std::vector<Segment>			segments;
+	const dyld_info_command*		dyldInfo;
+	const linkedit_data_command*	chainedFixups;
+	std::vector<std::string>		dylibs;
+
+private:
+	static uint64_t					uleb(const uint8_t*& p, const uint8_t* end);
+	static int64_t					sleb(const uint8_t*& p, const uint8_t* end);
+	uint64_t						segmentAddress(unsigned index, uint64_t offset) const;
+};
+
+bool Image::load(const std::string& path)
+{
+	dyldInfo = NULL;
+	chainedFixups = NULL;
+	FILE* f = fopen(path.c_str(), "r");
+	if ( f == NULL )
+		return false;
+	uint8_t buffer[4096];
+	size_t count;
+	while ( (count = fread(buffer, 1, sizeof(buffer), f)) > 0 )
+		bytes.insert(bytes.end(), buffer, buffer+count);
+	fclose(f);
+	if ( bytes.size() < sizeof(mach_header_64) )
+		return false;
+	const mach_header_64* mh = (mach_header_64*)bytes.data();
+	if ( mh->magic != MH_MAGIC_64 )
+		return false;
+	const uint8_t* p = bytes.data() + sizeof(mach_header_64);
+	for (uint32_t i=0; i < mh->ncmds; ++i) {
+		const load_command* cmd = (load_command*)p;
+		switch ( cmd->cmd ) {
+			case LC_SEGMENT_64:
+				{
+				const segment_command_64* seg = (segment_command_64*)cmd;
+				Segment segment;
+				segment.name = std::string(seg->segname, strnlen(seg->segname, 16));
+				segment.vmaddr = seg->vmaddr;
+				segment.fileoff = seg->fileoff;
+				segment.filesize = seg->filesize;
+				segments.push_back(segment);
+				}
+				break;
+			case LC_DYLD_INFO_ONLY:
+				dyldInfo = (dyld_info_command*)cmd;
+				break;
+			case LC_DYLD_CHAINED_FIXUPS:
+				chainedFixups = (linkedit_data_command*)cmd;
+				break;
+			case LC_LOAD_DYLIB:
+			case LC_LOAD_WEAK_DYLIB:
+				dylibs.push_back((char*)cmd + ((dylib_command*)cmd)->dylib.name.offset);
+				break;
+		}
+		p += cmd->cmdsize;
+	}
+	return true;
+}
+
+const uint8_t* Image::contentAt(uint64_t address) const
+{
+	for (std::vector<Segment>::const_iterator it=segments.begin(); it != segments.end(); ++it) {
+		if ( (it->vmaddr <= address) && (address+8 <= it->vmaddr+it->filesize) )
+			return &bytes[it->fileoff + address - it->vmaddr];
+	}
+	return NULL;
+}
+
+uint64_t Image::segmentAddress(unsigned index, uint64_t offset) const
+{
+	if ( index >= segments.size() ) {
+		check(false, "segment index %u out of range", index);
+		return 0;
+	}
+	return segments[index].vmaddr + offset;
+}
+
+uint64_t Image::uleb(const uint8_t*& p, const uint8_t* end)
+{
+	uint64_t result = 0;
+	int bit = 0;
+	do {
+		if ( p == end ) {
+			check(false, "uleb128 runs past the end of the opcodes");
+			return result;
+		}
+		result |= (uint64_t)(*p & 0x7F) << bit;
+		bit += 7;
+	} while ( *p++ & 0x80 );
+	return result;
+}
+
+int64_t Image::sleb(const uint8_t*& p, const uint8_t* end)
+{
+	int64_t result = 0;
+	int bit = 0;
+	uint8_t byte;
+	do {
+		if ( p == end ) {
+			check(false, "sleb128 runs past the end of the opcodes");
+			return result;
+		}
+		byte = *p++;
+		result |= (int64_t)(byte & 0x7F) << bit;
+		bit += 7;
+	} while ( byte & 0x80 );
+	if ( (bit < 64) && (byte & 0x40) )
+		result |= -1LL << bit;
+	return result;
+}
+
+// runs the rebase and bind opcodes, rebased pointers hold their unslid target
+void Image::resolveOpcodes(ResolvedMap& fixups) const
+{
+	const uint8_t* p = &bytes[dyldInfo->rebase_off];
+	const uint8_t* end = p + dyldInfo->rebase_size;
+	unsigned segIndex = 0;
+	uint64_t offset = 0;
+	bool done = false;
+	while ( !done && (p < end) ) {
+		uint8_t immediate = *p & REBASE_IMMEDIATE_MASK;
+		uint8_t opcode = *p & REBASE_OPCODE_MASK;
+		++p;
+		uint64_t count;
+		uint64_t skip;
+		switch ( opcode ) {
+			case REBASE_OPCODE_DONE:
+				done = true;
+				break;
+			case REBASE_OPCODE_SET_TYPE_IMM:
+				check(immediate == REBASE_TYPE_POINTER, "rebase type %d", immediate);
+				break;
+			case REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+				segIndex = immediate;
+				offset = uleb(p, end);
+				break;
+			case REBASE_OPCODE_ADD_ADDR_ULEB:
+				offset += uleb(p, end);
+				break;
+			case REBASE_OPCODE_ADD_ADDR_IMM_SCALED:
+				offset += immediate * sizeof(uint64_t);
+				break;
+			case REBASE_OPCODE_DO_REBASE_IMM_TIMES:
+			case REBASE_OPCODE_DO_REBASE_ULEB_TIMES:
+			case REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB:
+			case REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB:
+				count = (opcode == REBASE_OPCODE_DO_REBASE_IMM_TIMES) ? immediate : 1;
+				skip = 0;
+				if ( (opcode == REBASE_OPCODE_DO_REBASE_ULEB_TIMES) || (opcode == REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB) )
+					count = uleb(p, end);
+				if ( (opcode == REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB) || (opcode == REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB) )
+					skip = uleb(p, end);
+				for (uint64_t i=0; i < count; ++i) {
+					uint64_t address = segmentAddress(segIndex, offset);
+					const uint8_t* content = contentAt(address);
+					check(content != NULL, "rebase at 0x%llX not in a segment", (unsigned long long)address);
+					check(fixups.count(address) == 0, "two rebases at 0x%llX", (unsigned long long)address);
+					Resolved& fixup = fixups[address];
+					if ( content != NULL )
+						fixup.target = LittleEndian::get64(*(uint64_t*)content);
+					offset += sizeof(uint64_t) + skip;
+				}
+				break;
+			default:
+				check(false, "unknown rebase opcode 0x%02X", opcode);
+				done = true;
+		}
+	}
+
+	p = &bytes[dyldInfo->bind_off];
+	end = p + dyldInfo->bind_size;
+	segIndex = 0;
+	offset = 0;
+	done = false;
+	Resolved bind;
+	bind.bind = true;
+	while ( !done && (p < end) ) {
+		uint8_t immediate = *p & BIND_IMMEDIATE_MASK;
+		uint8_t opcode = *p & BIND_OPCODE_MASK;
+		++p;
+		uint64_t count;
+		uint64_t skip;
+		switch ( opcode ) {
+			case BIND_OPCODE_DONE:
+				done = true;
+				break;
+			case BIND_OPCODE_SET_DYLIB_ORDINAL_IMM:
+				bind.ordinal = immediate;
+				break;
+			case BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB:
+				bind.ordinal = uleb(p, end);
+				break;
+			case BIND_OPCODE_SET_DYLIB_SPECIAL_IMM:
+				bind.ordinal = (immediate == 0) ? 0 : (int8_t)(BIND_OPCODE_MASK | immediate);
+				break;
+			case BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM:
+				bind.weakImport = ((immediate & BIND_SYMBOL_FLAGS_WEAK_IMPORT) != 0);
+				bind.symbol = (const char*)p;
+				p += bind.symbol.size() + 1;
+				break;
+			case BIND_OPCODE_SET_TYPE_IMM:
+				check(immediate == BIND_TYPE_POINTER, "bind type %d", immediate);
+				break;
+			case BIND_OPCODE_SET_ADDEND_SLEB:
+				bind.addend = sleb(p, end);
+				break;
+			case BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+				segIndex = immediate;
+				offset = uleb(p, end);
+				break;
+			case BIND_OPCODE_ADD_ADDR_ULEB:
+				offset += uleb(p, end);
+				break;
+			case BIND_OPCODE_DO_BIND:
+			case BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB:
+			case BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED:
+			case BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB:
+				count = 1;
+				skip = 0;
+				if ( opcode == BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB ) {
+					count = uleb(p, end);
+					skip = uleb(p, end);
+				}
+				for (uint64_t i=0; i < count; ++i) {
+					uint64_t address = segmentAddress(segIndex, offset);
+					check(contentAt(address) != NULL, "bind at 0x%llX not in a segment", (unsigned long long)address);
+					check(fixups.count(address) == 0, "two fixups at 0x%llX", (unsigned long long)address);
+					fixups[address] = bind;
+					offset += sizeof(uint64_t) + skip;
+				}
+				if ( opcode == BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB )
+					offset += uleb(p, end);
+				else if ( opcode == BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED )
+					offset += immediate * sizeof(uint64_t);
+				break;
+			default:
+				check(false, "unknown bind opcode 0x%02X", opcode);
+				done = true;
+		}
+	}
+	check((dyldInfo->lazy_bind_size == 0) && (dyldInfo->weak_bind_size == 0), "unexpected lazy or weak binds");
+}
+
+// walks the chain of each page, decoding the pointer formats and imports independently of dyldinfo
+void Image::resolveChains(ResolvedMap& fixups) const
+{
+	const uint8_t* start = &bytes[chainedFixups->dataoff];
+	const uint32_t* header = (uint32_t*)start;
+	check(header[0] == 0, "fixups version %u", header[0]);
+	check(header[6] == DYLD_CHAINED_SYMBOL_UNCOMPRESSED, "symbols format %u", header[6]);
+	const uint32_t importsFormat = header[5];
+	const char* symbols = (const char*)start + header[3];
+
+	std::vector<Resolved> imports;
+	const uint8_t* p = start + header[2];
+	for (uint32_t i=0; i < header[4]; ++i) {
+		Resolved import;
+		import.bind = true;
+		if ( importsFormat == DYLD_CHAINED_IMPORT_ADDEND64 ) {
+			uint64_t value = LittleEndian::get64(*(uint64_t*)p);
+			import.ordinal = (int16_t)(value & 0xFFFF);
+			import.weakImport = ((value >> 16) & 1);
+			import.symbol = &symbols[value >> 32];
+			import.addend = (int64_t)LittleEndian::get64(*(uint64_t*)(p+8));
+			p += 16;
+		}
+		else {
+			check(importsFormat == DYLD_CHAINED_IMPORT, "imports format %u", importsFormat);
+			uint32_t value = LittleEndian::get32(*(uint32_t*)p);
+			import.ordinal = (int8_t)(value & 0xFF);
+			import.weakImport = ((value >> 8) & 1);
+			import.symbol = &symbols[value >> 9];
+			p += 4;
+		}
+		imports.push_back(import);
+	}
+
+	const uint64_t mhAddress = segments[0].vmaddr;
+	const uint8_t* startsInImage = start + header[1];
+	const uint32_t segCount = *(uint32_t*)startsInImage;
+	check(segCount == segments.size(), "%u chained segments for %lu load commands", segCount, segments.size());
+	for (uint32_t segIndex=0; segIndex < segCount; ++segIndex) {
+		const uint32_t segInfoOffset = ((uint32_t*)startsInImage)[1+segIndex];
+		if ( segInfoOffset == 0 )
+			continue;
+		const uint8_t* segInfo = startsInImage + segInfoOffset;
+		const uint16_t pageSize = *(uint16_t*)(segInfo+4);
+		const uint16_t pointerFormat = *(uint16_t*)(segInfo+6);
+		const uint64_t segOffset = *(uint64_t*)(segInfo+8);
+		const uint16_t pageCount = *(uint16_t*)(segInfo+20);
+		const uint16_t* pageStarts = (uint16_t*)(segInfo+22);
+		check(pageSize == 0x1000, "page size 0x%X", pageSize);
+		check(pointerFormat == DYLD_CHAINED_PTR_64_OFFSET, "pointer format %u", pointerFormat);
+		check(mhAddress + segOffset == segments[segIndex].vmaddr, "segment %u starts at 0x%llX", segIndex, (unsigned long long)segOffset);
+		for (uint32_t pageIndex=0; pageIndex < pageCount; ++pageIndex) {
+			if ( pageStarts[pageIndex] == DYLD_CHAINED_PTR_START_NONE )
+				continue;
+			uint64_t address = mhAddress + segOffset + pageIndex*pageSize + pageStarts[pageIndex];
+			for (;;) {
+				const uint8_t* content = contentAt(address);
+				check(content != NULL, "chain at 0x%llX not in a segment", (unsigned long long)address);
+				if ( content == NULL )
+					break;
+				check(fixups.count(address) == 0, "two fixups at 0x%llX", (unsigned long long)address);
+				check((address - mhAddress - segOffset) / pageSize == pageIndex, "chain at 0x%llX left its page", (unsigned long long)address);
+				uint64_t value = LittleEndian::get64(*(uint64_t*)content);
+				Resolved& fixup = fixups[address];
+				if ( value >> 63 ) {
+					uint32_t importIndex = value & 0xFFFFFF;
+					check(importIndex < imports.size(), "import %u of %lu", importIndex, imports.size());
+					if ( importIndex < imports.size() )
+						fixup = imports[importIndex];
+					fixup.addend += (value >> 24) & 0xFF;
+					check(((value >> 32) & 0x7FFFF) == 0, "reserved bits set in bind at 0x%llX", (unsigned long long)address);
+				}
+				else {
+					fixup.target = mhAddress + (value & 0xFFFFFFFFFULL) + (((value >> 36) & 0xFF) << 56);
+					check(((value >> 44) & 0x7F) == 0, "reserved bits set in rebase at 0x%llX", (unsigned long long)address);
+				}
+				uint64_t next = (value >> 51) & 0xFFF;
+				if ( next == 0 )
+					break;
+				address += next * 4;
+			}
+		}
+	}
+}
+
+static const char* sDylibPaths[] = { "/usr/lib/libA.dylib", "/usr/lib/libB.dylib" };
+
+// the symbols _data can point to in the dylibs, by index
+struct ImportSpec
+{
+	const char*			name;
+	unsigned			dylib;
+};
+
+static const ImportSpec sImports[] = { { "_a", 0 }, { "_b", 1 }, { "_weak", 1 } };
+
+enum { kImportA, kImportB, kImportWeak, kImportCount, kFunc = -2, kData = -1 };
+
+// a pointer in _data and the target it should resolve to: _func, _data or an import
+struct PointerSpec
+{
+	uint32_t			offset;
+	int					target;
+	int64_t				addend;
+	bool				weakImport;
+};
+
+// the addresses the atoms were given
+struct Layout
+{
+	uint64_t			text;
+	uint64_t			data;
+};
+
+// links a dylib with _func, _data and the pointers in _data to path, returns an empty string or the error thrown
+static std::string link(const std::string& path, const std::string& objectPath, bool chained, uint64_t dataSize,
+						const std::vector<PointerSpec>& pointers, Layout& layout)
+{
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-dylib");
+	args.push_back("-install_name");
+	args.push_back("/usr/lib/libfixupformattest.dylib");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back(path.c_str());
+	args.push_back(chained ? "-fixup_chains" : "-no_fixup_chains");
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+	try {
+		Options opts(args.size()-1, &args[0]);
+		InternalState state(opts);
+		TestDylib libA(sDylibPaths[0], 1);
+		TestDylib libB(sDylibPaths[1], 2);
+		const TestDylib* dylibs[] = { &libA, &libB };
+		state.dylibs.push_back(&libA);
+		state.dylibs.push_back(&libB);
+		TestAtom header(sHeaderSection, "___dso_handle", 0, 0, ld::Atom::symbolTableNotIn);
+		TestAtom text(sTextSection, "_func", 64, 4);
+		TestAtom data(sDataSection, "_data", dataSize, 3);
+		text.fill(0x11);
+		data.fill(0x22);
+		std::vector<ProxyAtom*> proxies;
+		for (unsigned i=0; i < kImportCount; ++i)
+			proxies.push_back(new ProxyAtom(*dylibs[sImports[i].dylib], sImports[i].name));
+		for (std::vector<PointerSpec>::const_iterator it=pointers.begin(); it != pointers.end(); ++it) {
+			const ld::Atom* target;
+			if ( it->target == kFunc )
+				target = &text;
+			else if ( it->target == kData )
+				target = &data;
+			else
+				target = proxies[it->target];
+			data.addPointer(it->offset, target, it->addend, it->weakImport);
+		}
+		state.addAtom(header);
+		for (std::vector<ProxyAtom*>::iterator it=proxies.begin(); it != proxies.end(); ++it)
+			state.addAtom(**it);
+		state.addAtom(text);
+		state.addAtom(data);
+		state.sortSections();
+		ld::tool::OutputFile output(opts);
+		output.write(state);
+		layout.text = text.finalAddress();
+		layout.data = data.finalAddress();
+		for (std::vector<ProxyAtom*>::iterator it=proxies.begin(); it != proxies.end(); ++it)
+			delete *it;
+	}
+	catch (const char* msg) {
+		return msg;
+	}
+	return "";
+}
+
+// writes the pointers both ways and compares the resolved fixups and the bytes around them
+static void checkFormats(const char* name, const std::string& dir, uint64_t dataSize, const std::vector<PointerSpec>& pointers)
+{
+	std::string objectPath = dir + "/empty.o";
+	std::string classicPath = dir + "/" + name + ".classic";
+	std::string chainedPath = dir + "/" + name + ".chained";
+
+	Layout layout;
+	Layout chainedLayout;
+	std::string error = link(classicPath, objectPath, false, dataSize, pointers, layout);
+	check(error.empty(), "%s: classic link failed: %s", name, error.c_str());
+	error = link(chainedPath, objectPath, true, dataSize, pointers, chainedLayout);
+	check(error.empty(), "%s: chained link failed: %s", name, error.c_str());
+	check(layout.text == chainedLayout.text, "%s: _func moved", name);
+	check(layout.data == chainedLayout.data, "%s: _data moved", name);
+
+	Image classic;
+	Image chained;
+	check(classic.load(classicPath), "%s: can't read %s", name, classicPath.c_str());
+	check(chained.load(chainedPath), "%s: can't read %s", name, chainedPath.c_str());
+	check(classic.dyldInfo != NULL && classic.chainedFixups == NULL, "%s: classic image has the wrong load commands", name);
+	check(chained.dyldInfo == NULL && chained.chainedFixups != NULL, "%s: chained image has the wrong load commands", name);
+	if ( (classic.dyldInfo == NULL) || (chained.chainedFixups == NULL) )
+		return;
+	check(classic.dylibs == chained.dylibs, "%s: dylibs differ", name);
+
+	ResolvedMap classicFixups;
+	ResolvedMap chainedFixups;
+	classic.resolveOpcodes(classicFixups);
+	chained.resolveChains(chainedFixups);
+
+	// both match what the atoms were linked with
+	ResolvedMap expected;
+	for (std::vector<PointerSpec>::const_iterator it=pointers.begin(); it != pointers.end(); ++it) {
+		Resolved& fixup = expected[layout.data + it->offset];
+		if ( it->target >= 0 ) {
+			fixup.bind = true;
+			fixup.symbol = sImports[it->target].name;
+			fixup.weakImport = it->weakImport;
+			fixup.addend = it->addend;
+			for (size_t i=0; i < classic.dylibs.size(); ++i) {
+				if ( classic.dylibs[i] == sDylibPaths[sImports[it->target].dylib] )
+					fixup.ordinal = i + 1;
+			}
+		}
+		else {
+			fixup.target = ((it->target == kFunc) ? layout.text : layout.data) + it->addend;
+		}
+	}
+	for (ResolvedMap::iterator it=expected.begin(); it != expected.end(); ++it) {
+		check(classicFixups.count(it->first) && (classicFixups[it->first] == it->second), "%s: 0x%llX: opcodes give %s, expected %s",
+			  name, (unsigned long long)it->first, classicFixups[it->first].description().c_str(), it->second.description().c_str());
+		check(chainedFixups.count(it->first) && (chainedFixups[it->first] == it->second), "%s: 0x%llX: chains give %s, expected %s",
+			  name, (unsigned long long)it->first, chainedFixups[it->first].description().c_str(), it->second.description().c_str());
+	}
+	check(classicFixups.size() == expected.size(), "%s: %lu fixups from opcodes, expected %lu", name, classicFixups.size(), expected.size());
+	check(chainedFixups.size() == expected.size(), "%s: %lu fixups from chains, expected %lu", name, chainedFixups.size(), expected.size());
+
+	// every other byte of _data and _func is the same
+	const uint8_t* classicBytes = classic.contentAt(layout.data);
+	const uint8_t* chainedBytes = chained.contentAt(layout.data);
+	check(classicBytes != NULL && chainedBytes != NULL, "%s: _data not in the images", name);
+	if ( (classicBytes != NULL) && (chainedBytes != NULL) ) {
+		std::vector<bool> isPointer(dataSize, false);
+		for (std::vector<PointerSpec>::const_iterator it=pointers.begin(); it != pointers.end(); ++it)
+			std::fill(isPointer.begin() + it->offset, isPointer.begin() + it->offset + 8, true);
+		for (uint64_t i=0; i < dataSize; ++i) {
+			if ( !isPointer[i] && (classicBytes[i] != chainedBytes[i]) ) {
+				check(false, "%s: _data+0x%llX differs", name, (unsigned long long)i);
+				break;
+			}
+		}
+	}
+	classicBytes = classic.contentAt(layout.text);
+	chainedBytes = chained.contentAt(layout.text);
+	check(classicBytes != NULL && chainedBytes != NULL && memcmp(classicBytes, chainedBytes, 64) == 0, "%s: _func differs", name);
+
+	unlink(classicPath.c_str());
+	unlink(chainedPath.c_str());
+}
+
+static void addPointer(std::vector<PointerSpec>& pointers, uint32_t offset, int target, int64_t addend, bool weakImport=false)
+{
+	PointerSpec spec = { offset, target, addend, weakImport };
+	pointers.push_back(spec);
+}
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/fixupformattest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string objectPath = std::string(dir) + "/empty.o";
+	FILE* f = fopen(objectPath.c_str(), "w");
+	if ( f == NULL ) {
+		perror(objectPath.c_str());
+		return 1;
+	}
+	fclose(f);
+
+	// rebases and binds over several pages, some only 4-byte aligned, binds with
+	// addends that fit in the pointer and a weak import
+	std::vector<PointerSpec> small;
+	for (uint32_t offset=0; offset < 0x3000; offset += 0x100) {
+		addPointer(small, offset, kFunc, 0);
+		addPointer(small, offset+8, kImportA, 0);
+		addPointer(small, offset+20, kImportB, 7);
+		addPointer(small, offset+32, kData, offset);
+		addPointer(small, offset+44, kImportA, 255);
+	}
+	addPointer(small, 0x3000, kImportWeak, 0, true);
+	// the last pointer of one page and the first of the next
+	addPointer(small, 0x3ff8, kImportB, 1);
+	addPointer(small, 0x4000, kFunc, 16);
+	checkFormats("small", dir, 0x4100, small);
+
+	// addends that don't fit in the pointer need DYLD_CHAINED_IMPORT_ADDEND64
+	std::vector<PointerSpec> large;
+	addPointer(large, 0, kImportA, 0);
+	addPointer(large, 8, kImportA, 256);
+	addPointer(large, 16, kImportA, -8);
+	addPointer(large, 28, kImportB, 0x123456789LL);
+	addPointer(large, 40, kImportB, 3);
+	addPointer(large, 48, kImportWeak, -1, true);
+	addPointer(large, 64, kData, 0xF8);
+	addPointer(large, 72, kFunc, 0);
+	checkFormats("large", dir, 0x100, large);
+
+	unlink(objectPath.c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "fixupformattest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,133 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+#ifndef __JSON_LINES_H__
+#define __JSON_LINES_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Helpers for the -json output of dyldinfo(1) and ObjectDump.  Each record is
+ * a JSON object on a line of its own whose first member is "kind", so a
+ * consumer can split the output on newlines and dispatch on the kind without
+ * parsing the whole stream as one document.  Numbers are printed in decimal.
+ * Strings are escaped as JSON requires.  Symbol names are arbitrary bytes, so
+ * only well-formed UTF-8 is copied unchanged, and any other byte is written
+ * as the code point of the same value (\u00XX), which keeps every line valid.
+ */
+
+/* length of the UTF-8 sequence starting at p, 0 if it is not well-formed */
+static inline int
+json_utf8_length(const unsigned char* p)
+{
+	int length;
+	unsigned char low = 0x80, high = 0xBF;
+	if ( (p[0] >= 0xC2) && (p[0] <= 0xDF) )
+		length = 2;
+	else if ( (p[0] >= 0xE0) && (p[0] <= 0xEF) ) {
+		length = 3;
+		if ( p[0] == 0xE0 )
+			low = 0xA0;		/* overlong */
+		else if ( p[0] == 0xED )
+			high = 0x9F;	/* surrogates */
+	}
+	else if ( (p[0] >= 0xF0) && (p[0] <= 0xF4) ) {
+		length = 4;
+		if ( p[0] == 0xF0 )
+			low = 0x90;		/* overlong */
+		else if ( p[0] == 0xF4 )
+			high = 0x8F;	/* above U+10FFFF */
+	}
+	else
+		return 0;
+	if ( (p[1] < low) || (p[1] > high) )
+		return 0;
+	for (int i = 2; i < length; ++i) {
+		if ( (p[i] < 0x80) || (p[i] > 0xBF) )
+			return 0;
+	}
+	return length;
+}
+
+static inline void
+json_string(const char* s)
+{
+	const char* run = s;
+	putchar('"');
+	for (const char* p = s; *p != '\0'; ++p) {
+		unsigned char c = *p;
+		if ( (c >= 0x20) && (c < 0x80) && (c != '"') && (c != '\\') )
+			continue;
+		if ( c >= 0x80 ) {
+			int length = json_utf8_length((const unsigned char*)p);
+			if ( length != 0 ) {
+				p += length - 1;
+				continue;
+			}
+		}
+		fwrite(run, 1, p - run, stdout);
+		run = p + 1;
+		if ( c == '"' )
+			fputs("\\\"", stdout);
+		else if ( c == '\\' )
+			fputs("\\\\", stdout);
+		else
+			printf("\\u%04X", c);
+	}
+	fwrite(run, 1, strlen(run), stdout);
+	putchar('"');
+}
+
+static inline void
+json_begin(const char* kind)
+{
+	fputs("{\"kind\":", stdout);
+	json_string(kind);
+}
+
+static inline void
+json_string_member(const char* name, const char* value)
+{
+	printf(",\"%s\":", name);
+	json_string(value);
+}
+
+static inline void
+json_int_member(const char* name, int64_t value)
+{
+	printf(",\"%s\":%lld", name, (long long)value);
+}
+
+static inline void
+json_uint_member(const char* name, uint64_t value)
+{
+	printf(",\"%s\":%llu", name, (unsigned long long)value);
+}
+
+static inline void
+json_bool_member(const char* name, bool value)
+{
+	printf(",\"%s\":%s", name, value ? "true" : "false");
+}
+
+static inline void
+json_end()
+{
+	fputs("}\n", stdout);
+}
+
+#endif // __JSON_LINES_H__
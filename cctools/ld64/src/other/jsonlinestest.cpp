@@ -0,0 +1,139 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for the JSON lines helpers (json_lines.h) used by dyldinfo -json and
+// ObjectDump -json.  stdout is redirected to a temporary file while a helper
+// runs, and what it wrote must match exactly: well-formed UTF-8 is copied,
+// quotes, backslashes and control characters are escaped, and every byte of
+// an ill-formed sequence is written as \u00XX.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "json_lines.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "jsonlinestest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+// runs emit() with stdout going to a temporary file and returns what it wrote
+template <typename T>
+static std::string capture(T emit)
+{
+	FILE* tmp = tmpfile();
+	if ( tmp == NULL ) {
+		perror("tmpfile");
+		exit(1);
+	}
+	fflush(stdout);
+	int savedStdout = dup(STDOUT_FILENO);
+	dup2(fileno(tmp), STDOUT_FILENO);
+	emit();
+	fflush(stdout);
+	dup2(savedStdout, STDOUT_FILENO);
+	close(savedStdout);
+
+	std::string result;
+	char buffer[256];
+	size_t count;
+	rewind(tmp);
+	while ( (count = fread(buffer, 1, sizeof(buffer), tmp)) != 0 )
+		result.append(buffer, count);
+	fclose(tmp);
+	return result;
+}
+
+static void checkString(const char* input, const char* expected)
+{
+	std::string result = capture([=]() { json_string(input); });
+	std::string quoted = std::string("\"") + expected + "\"";
+	check(result == quoted, "json_string(\"%s\") is %s, expected %s", input, result.c_str(), quoted.c_str());
+}
+
+
+int main(int argc, const char* argv[])
+{
+	// ASCII
+	checkString("", "");
+	checkString("_main", "_main");
+	checkString("a b~\x7f", "a b~\x7f");
+	checkString("a\"b\\c", "a\\\"b\\\\c");
+	checkString("\x01\t\n\r\x1f", "\\u0001\\u0009\\u000A\\u000D\\u001F");
+
+	// well-formed UTF-8 is copied
+	checkString("caf\xC3\xA9", "caf\xC3\xA9");
+	checkString("\xC2\x80\xDF\xBF", "\xC2\x80\xDF\xBF");
+	checkString("\xE0\xA0\x80\xE2\x82\xAC\xED\x9F\xBF\xEE\x80\x80\xEF\xBF\xBF", "\xE0\xA0\x80\xE2\x82\xAC\xED\x9F\xBF\xEE\x80\x80\xEF\xBF\xBF");
+	checkString("\xF0\x90\x80\x80\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF", "\xF0\x90\x80\x80\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF");
+	checkString("\xE2\x82\xAC\"\xE2\x82\xAC", "\xE2\x82\xAC\\\"\xE2\x82\xAC");
+
+	// ill-formed UTF-8 is escaped byte by byte
+	checkString("\x80", "\\u0080");
+	checkString("a\xBF" "b", "a\\u00BFb");
+	checkString("\xC0\x80", "\\u00C0\\u0080");
+	checkString("\xC1\xBF", "\\u00C1\\u00BF");
+	checkString("\xC3(", "\\u00C3(");
+	checkString("\xE0\x80\x80", "\\u00E0\\u0080\\u0080");
+	checkString("\xE0\x9F\xBF", "\\u00E0\\u009F\\u00BF");
+	checkString("\xED\xA0\x80", "\\u00ED\\u00A0\\u0080");
+	checkString("\xED\xBF\xBF", "\\u00ED\\u00BF\\u00BF");
+	checkString("\xE2\x28\xAC", "\\u00E2(\\u00AC");
+	checkString("\xF0\x8F\xBF\xBF", "\\u00F0\\u008F\\u00BF\\u00BF");
+	checkString("\xF4\x90\x80\x80", "\\u00F4\\u0090\\u0080\\u0080");
+	checkString("\xF5\x80\x80\x80", "\\u00F5\\u0080\\u0080\\u0080");
+	checkString("\xFF\xFE", "\\u00FF\\u00FE");
+	checkString("x\xFF\xC3\xA9", "x\\u00FF\xC3\xA9");
+
+	// a sequence cut short by the end of the string
+	checkString("\xC3", "\\u00C3");
+	checkString("a\xE2\x82", "a\\u00E2\\u0082");
+	checkString("\xF0\x9F\x98", "\\u00F0\\u009F\\u0098");
+
+	// a record is one line, "kind" first
+	std::string record = capture([]() {
+		json_begin("export");
+		json_string_member("name", "_f\n");
+		json_int_member("delta", -5);
+		json_int_member("min", INT64_MIN);
+		json_uint_member("max", UINT64_MAX);
+		json_bool_member("thumb", true);
+		json_bool_member("weak_def", false);
+		json_end();
+	});
+	const char* expected = "{\"kind\":\"export\",\"name\":\"_f\\u000A\",\"delta\":-5,\"min\":-9223372036854775808,"
+							"\"max\":18446744073709551615,\"thumb\":true,\"weak_def\":false}\n";
+	check(record == expected, "record is %s, expected %s", record.c_str(), expected);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "jsonlinestest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
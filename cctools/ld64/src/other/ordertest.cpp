@@ -0,0 +1,245 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for -call_graph_profile (Options::parseCallGraphProfile() and the
+// order pass's call-chain clustering in passes/order.cpp).  A profile is
+// written to a temporary file and parsed from a command line, then the order
+// pass sorts a synthetic __text section and the resulting order is compared
+// with the expected one.  Malformed profile lines must be rejected with their
+// line number.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "Options.h"
+#include "ld.hpp"
+#include "order.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "ordertest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sDataSection("__DATA", "__data", ld::Section::typeUnclassified);
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const char* name, uint64_t size, uint64_t address)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													ld::Atom::scopeGlobal, ld::Atom::typeUnclassified, ld::Atom::symbolTableIn,
+													false, false, false, ld::Atom::Alignment(2)), _name(name), _size(size), _address(address) { }
+
+	virtual const ld::File*					file() const					{ return NULL; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _size; }
+	virtual uint64_t						objectAddress() const			{ return _address; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { }
+
+private:
+	const char*								_name;
+	uint64_t								_size;
+	uint64_t								_address;
+};
+
+class TestState : public ld::Internal
+{
+public:
+	virtual uint64_t						assignFileOffsets()				{ return 0; }
+	virtual void							setSectionSizesAndAlignments()	{ }
+	virtual ld::Internal::FinalSection*		addAtom(const ld::Atom&)		{ return NULL; }
+	virtual ld::Internal::FinalSection*		getFinalSection(const ld::Section&) { return NULL; }
+};
+
+static std::string sTempDir;
+
+static std::string writeFile(const char* leafName, const char* content)
+{
+	std::string path = sTempDir + "/" + leafName;
+	FILE* f = fopen(path.c_str(), "w");
+	if ( f == NULL ) {
+		perror(path.c_str());
+		exit(1);
+	}
+	fputs(content, f);
+	fclose(f);
+	return path;
+}
+
+// parses a command line with the given profile and order file, returns NULL and sets error if it throws
+static Options* parseOptions(const char* profile, const char* orderFile, std::string& error)
+{
+	std::string profilePath = writeFile("profile.txt", profile);
+	std::string orderPath = writeFile("order.txt", (orderFile != NULL) ? orderFile : "");
+	std::string objectPath = writeFile("empty.o", "");
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back("/dev/null");
+	args.push_back("-call_graph_profile");
+	args.push_back(profilePath.c_str());
+	if ( orderFile != NULL ) {
+		args.push_back("-order_file");
+		args.push_back(orderPath.c_str());
+	}
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+	try {
+		return new Options(args.size()-1, &args[0]);
+	}
+	catch (const char* msg) {
+		error = msg;
+		return NULL;
+	}
+}
+
+struct TestAtomSpec
+{
+	const char*		name;
+	uint64_t		size;
+};
+
+// lays out the atoms in __text, plus a __data atom named _data, and returns the __text order
+static std::string layout(const char* profile, const char* orderFile, const TestAtomSpec atoms[], unsigned count)
+{
+	std::string error;
+	Options* opts = parseOptions(profile, orderFile, error);
+	check(opts != NULL, "profile rejected: %s", error.c_str());
+	if ( opts == NULL )
+		return "";
+
+	TestState state;
+	ld::Internal::FinalSection text(sTextSection);
+	ld::Internal::FinalSection data(sDataSection);
+	std::vector<TestAtom*> owned;
+	uint64_t address = 0;
+	for (unsigned i=0; i < count; ++i) {
+		owned.push_back(new TestAtom(sTextSection, atoms[i].name, atoms[i].size, address));
+		text.atoms.push_back(owned.back());
+		address += atoms[i].size;
+	}
+	owned.push_back(new TestAtom(sDataSection, "_data", 8, 0));
+	data.atoms.push_back(owned.back());
+	state.sections.push_back(&text);
+	state.sections.push_back(&data);
+
+	ld::passes::order::doPass(*opts, state);
+
+	std::string result;
+	for (std::vector<const ld::Atom*>::iterator it=text.atoms.begin(); it != text.atoms.end(); ++it) {
+		if ( !result.empty() )
+			result += " ";
+		result += (*it)->name();
+	}
+	for (std::vector<TestAtom*>::iterator it=owned.begin(); it != owned.end(); ++it)
+		delete *it;
+	delete opts;
+	return result;
+}
+
+static void checkOrder(const char* profile, const char* orderFile, const TestAtomSpec atoms[], unsigned count, const char* expected)
+{
+	std::string order = layout(profile, orderFile, atoms, count);
+	check(order == expected, "got '%s', expected '%s'", order.c_str(), expected);
+}
+
+static void checkMalformed(const char* profile, unsigned lineNumber)
+{
+	std::string error;
+	Options* opts = parseOptions(profile, NULL, error);
+	check(opts == NULL, "malformed profile accepted: %s", profile);
+	delete opts;
+	char expected[64];
+	snprintf(expected, sizeof(expected), "line %u:", lineNumber);
+	check(strstr(error.c_str(), "malformed call graph profile") != NULL, "unexpected error: %s", error.c_str());
+	check(strstr(error.c_str(), expected) != NULL, "error doesn't name %s %s", expected, error.c_str());
+}
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/ordertest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	sTempDir = dir;
+
+	// a call chain: every node joins the cluster of its hottest caller, comments and
+	// blank lines are skipped, names that match no atom or a data atom are ignored, and
+	// atoms not in the profile keep their order after the placed ones
+	static const TestAtomSpec chain[] = {
+		{ "_cold1", 16 }, { "_c", 16 }, { "_b", 16 }, { "_main", 16 }, { "_cold2", 16 }, { "_a", 16 }
+	};
+	checkOrder("# caller callee count\n"
+			   "_main _a 100\n"
+			   "\n"
+			   "  _a\t_b   90  # trailing comment\n"
+			   "_main _c 10\n"
+			   "_missing _a 5\n"
+			   "_data _b 1\n"
+			   "_b _missing 7",
+			   NULL, chain, 6, "_main _a _b _c _cold1 _cold2");
+
+	// duplicate edges are combined before the hottest caller is picked
+	static const TestAtomSpec dups[] = { { "_x", 16 }, { "_y", 16 }, { "_z", 16 } };
+	checkOrder("_x _z 30\n_y _z 20\n_y _z 20\n", NULL, dups, 3, "_y _z _x");
+
+	// a cluster doesn't grow past a page (4096 bytes on x86_64): _big stays on its own and,
+	// with fewer calls per byte, goes after the cluster of _main
+	static const TestAtomSpec pages[] = { { "_big", 3000 }, { "_tiny", 16 }, { "_hot", 3000 }, { "_main", 16 } };
+	checkOrder("_main _hot 50\n_main _big 40\n_main _tiny 30\n", NULL, pages, 4, "_main _hot _tiny _big");
+
+	// the order file goes first and takes precedence over the profile
+	checkOrder("_main _hot 50\n_main _big 40\n_main _tiny 30\n", "_tiny\n", pages, 4, "_tiny _main _hot _big");
+
+	// malformed lines are errors that name the line
+	checkMalformed("_a _b 1\n_a _b\n", 2);
+	checkMalformed("_a _b 12x\n", 1);
+	checkMalformed("# ok\n_a _b 1 2\n", 2);
+	checkMalformed("\n\n_a\n", 3);
+	checkMalformed("_a _b -\n", 1);
+
+	unlink((sTempDir + "/profile.txt").c_str());
+	unlink((sTempDir + "/order.txt").c_str());
+	unlink((sTempDir + "/empty.o").c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "ordertest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+#ifndef __PRELINK_CACHE_H__
+#define __PRELINK_CACHE_H__
+
+#include <stdint.h>
+
+/*
+ * Layout of the file written by prelinkcache(1).  All fields are little
+ * endian.  File offsets equal (address - baseAddress), so mapping the whole
+ * file at baseAddress makes every image usable in place:
+ *
+ *	header, mappings, images, image lookup table
+ *	__TEXT of every image				(r-x)
+ *	remaining segments of every image	(rw-)
+ *	shared __LINKEDIT, string pool, unresolved binds	(r--)
+ *
+ * Every image's __LINKEDIT segment load command covers the whole shared
+ * __LINKEDIT region, and its symbol tables point into the shared string pool.
+ */
+
+#define PRELINK_CACHE_MAGIC		"prelinkcache1"
+
+struct prelink_cache_header {
+	char		magic[16];				/* PRELINK_CACHE_MAGIC, NUL padded */
+	uint32_t	cputype;
+	uint32_t	cpusubtype;
+	uint64_t	baseAddress;			/* address the cache is prelinked to */
+	uint64_t	mappingOffset;			/* file offset of prelink_cache_mapping[] */
+	uint32_t	mappingCount;
+	uint32_t	imagesCount;
+	uint64_t	imagesOffset;			/* file offset of prelink_cache_image[] */
+	uint64_t	imageLookupOffset;		/* prelink_cache_image_lookup[imagesCount] sorted by path */
+	uint64_t	unresolvedBindsOffset;	/* file offset of prelink_cache_unresolved_bind[] */
+	uint64_t	unresolvedBindsCount;
+	uint64_t	stringsOffset;			/* shared string pool */
+	uint64_t	stringsSize;
+	uint64_t	linkeditOffset;			/* shared __LINKEDIT region */
+	uint64_t	linkeditSize;
+};
+
+struct prelink_cache_mapping {
+	uint64_t	address;
+	uint64_t	size;
+	uint64_t	fileOffset;
+	uint32_t	maxProt;
+	uint32_t	initProt;
+};
+
+struct prelink_cache_image {
+	uint64_t	address;				/* address of the image's mach header */
+	uint64_t	modTime;				/* of the input dylib when the cache was built */
+	uint64_t	inode;
+	uint32_t	pathOffset;				/* install name, offset into string pool */
+	uint32_t	pad;
+};
+
+struct prelink_cache_image_lookup {
+	uint32_t	pathOffset;				/* install name, offset into string pool */
+	uint32_t	imageIndex;
+};
+
+/*
+ * Binds that could not be resolved inside the cache, e.g. to dylibs that are
+ * not in it.  A loader has to bind these when the cache is mapped.
+ */
+#define PRELINK_CACHE_BIND_WEAK_IMPORT	0x1
+#define PRELINK_CACHE_BIND_LAZY			0x2
+
+struct prelink_cache_unresolved_bind {
+	uint64_t	address;				/* pointer to set */
+	int64_t		addend;
+	uint32_t	imageIndex;				/* image doing the bind */
+	uint32_t	symbolOffset;			/* symbol name, offset into string pool */
+	int32_t		libraryOrdinal;			/* as in the image's bind info */
+	uint32_t	flags;
+};
+
+#endif // __PRELINK_CACHE_H__
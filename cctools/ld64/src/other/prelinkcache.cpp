@@ -0,0 +1,1528 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// prelinkcache lays a set of dylibs out contiguously in one file, the way
+// update_dyld_shared_cache builds the shared region: every __TEXT segment is
+// packed into one read-only mapping, the other segments into one writable
+// mapping, and the __LINKEDIT of all images is coalesced into a third.  The
+// split seg info ld64 writes for -shared_region eligible dylibs is used to fix
+// up code that refers across segments that moved by different amounts, binds
+// between images in the cache are resolved ahead of time, and a table of the
+// images is written at the start of the file.  See prelink_cache.h.
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+
+#include "configure.h"
+#include "MachOFileAbstraction.hpp"
+#include "Architectures.hpp"
+#include "MachOTrie.hpp"
+#include "prelink_cache.h"
+
+// split seg info V1 kinds ld64 writes for movw, the movt kinds carry the
+// upper bits of the matching movw in their low nibble
+#define DYLD_CACHE_ADJ_V1_THUMB_MOVW	0x05
+#define DYLD_CACHE_ADJ_V1_ARM_MOVW		0x06
+
+static bool verbose = false;
+static cpu_type_t	sPreferredArch = 0;
+static cpu_type_t	sPreferredSubArch = 0;
+
+
+__attribute__((noreturn))
+static void throwf(const char* format, ...)
+{
+	va_list	list;
+	char*	p;
+	va_start(list, format);
+	vasprintf(&p, format, list);
+	va_end(list);
+
+	const char*	t = p;
+	throw t;
+}
+
+
+static uint64_t read_uleb128(const uint8_t*& p, const uint8_t* end)
+{
+	uint64_t result = 0;
+	int		 bit = 0;
+	do {
+		if (p == end)
+			throwf("malformed uleb128");
+
+		uint64_t slice = *p & 0x7f;
+
+		if (bit >= 64 || slice << bit >> bit != slice)
+			throwf("uleb128 too big");
+		else {
+			result |= (slice << bit);
+			bit += 7;
+		}
+	}
+	while (*p++ & 0x80);
+	return result;
+}
+
+static int64_t read_sleb128(const uint8_t*& p, const uint8_t* end)
+{
+	int64_t result = 0;
+	int bit = 0;
+	uint8_t byte;
+	do {
+		if (p == end)
+			throwf("malformed sleb128");
+		byte = *p++;
+		result |= (((int64_t)(byte & 0x7f)) << bit);
+		bit += 7;
+	} while (byte & 0x80);
+	// sign extend negative numbers
+	if ( (byte & 0x40) != 0 )
+		result |= (-1LL) << bit;
+	return result;
+}
+
+
+//
+// instruction immediates that split seg info can point at
+//
+static uint16_t getArmImm16(uint32_t instruction)
+{
+	return ((instruction >> 4) & 0xF000) | (instruction & 0x0FFF);
+}
+
+static uint32_t setArmImm16(uint32_t instruction, uint16_t imm)
+{
+	return (instruction & 0xFFF0F000) | ((imm & 0xF000) << 4) | (imm & 0x0FFF);
+}
+
+static uint16_t getThumbImm16(uint32_t instruction)
+{
+	// first halfword is in the low 16 bits
+	uint32_t imm4 = instruction & 0xF;
+	uint32_t i    = (instruction >> 10) & 0x1;
+	uint32_t imm3 = (instruction >> 28) & 0x7;
+	uint32_t imm8 = (instruction >> 16) & 0xFF;
+	return (imm4 << 12) | (i << 11) | (imm3 << 8) | imm8;
+}
+
+static uint32_t setThumbImm16(uint32_t instruction, uint16_t imm)
+{
+	uint32_t imm4 = (imm >> 12) & 0xF;
+	uint32_t i    = (imm >> 11) & 0x1;
+	uint32_t imm3 = (imm >> 8) & 0x7;
+	uint32_t imm8 = imm & 0xFF;
+	return (instruction & 0x8F00FBF0) | imm4 | (i << 10) | (imm3 << 28) | (imm8 << 16);
+}
+
+static bool isArmMovw(uint32_t instruction)		{ return ((instruction & 0x0FF00000) == 0x03000000); }
+static bool isArmMovt(uint32_t instruction)		{ return ((instruction & 0x0FF00000) == 0x03400000); }
+static bool isThumbMovw(uint32_t instruction)	{ return ((instruction & 0x8000FBF0) == 0x0000F240); }
+static bool isThumbMovt(uint32_t instruction)	{ return ((instruction & 0x8000FBF0) == 0x0000F2C0); }
+
+static uint32_t adjustADRP(uint32_t instruction, int64_t delta)
+{
+	if ( (instruction & 0x9F000000) != 0x90000000 )
+		throwf("split seg info does not point to an ADRP instruction");
+	if ( (delta & 0xFFF) != 0 )
+		throwf("ADRP target moved by 0x%llX which is not a multiple of the page size", delta);
+	int64_t pages = ((instruction >> 29) & 0x3) | (((instruction >> 5) & 0x7FFFF) << 2);
+	pages = (pages << 43) >> 43; // sign extend 21 bits
+	pages += (delta >> 12);
+	if ( (pages > 0xFFFFF) || (pages < -0x100000) )
+		throwf("ADRP target out of range after moving segments");
+	return (instruction & 0x9F00001F) | ((pages & 0x3) << 29) | (((pages >> 2) & 0x7FFFF) << 5);
+}
+
+static uint32_t adjustBranch26(uint32_t instruction, int64_t delta)
+{
+	int64_t displacement = instruction & 0x03FFFFFF;
+	displacement = (displacement << 38) >> 38; // sign extend 26 bits
+	displacement += (delta >> 2);
+	if ( (displacement > 0x1FFFFFF) || (displacement < -0x2000000) )
+		throwf("branch target out of range after moving segments");
+	return (instruction & 0xFC000000) | (displacement & 0x03FFFFFF);
+}
+
+
+struct InputDylib
+{
+	const char*		path;
+	const uint8_t*	content;	// start of the mach-o, inside a universal file if need be
+	uint64_t		length;
+	struct stat		stat_buf;
+};
+
+
+template <typename A>
+class CacheBuilder
+{
+public:
+											CacheBuilder(const std::vector<InputDylib>& dylibs, uint64_t baseAddress);
+
+	void									write(const char* path);
+
+	static bool								validFile(const uint8_t* fileContent);
+	static uint64_t							defaultBaseAddress();
+	static uint64_t							pageSize();
+
+private:
+	typedef typename A::P					P;
+	typedef typename A::P::E				E;
+	typedef typename A::P::uint_t			pint_t;
+
+	struct Segment {
+		const char*							name;
+		uint64_t							oldAddress;
+		uint64_t							vmSize;
+		uint64_t							fileOffset;
+		uint64_t							fileSize;
+		uint32_t							initProt;
+		uint64_t							newAddress;
+		int64_t								delta() const { return newAddress - oldAddress; }
+		bool								contains(uint64_t addr) const { return (addr >= oldAddress) && (addr < oldAddress+vmSize); }
+	};
+
+	struct Image {
+		const InputDylib*					input;
+		const macho_header<P>*				header;
+		const char*							installName;
+		std::vector<Segment>				segments;			// in load command order, as indexed by dyld info
+		std::vector<uint32_t>				sectionSegments;	// segment of each section, [0] is the mach header
+		std::vector<uint64_t>				sectionAddresses;
+		std::vector<const char*>			dependents;			// install names by ordinal-1
+		std::vector<bool>					reexported;
+		std::vector<int>					dependentImages;	// index of each dependent in the cache, or -1
+		const macho_dyld_info_command<P>*	dyldInfo;
+		const macho_symtab_command<P>*		symtab;
+		const macho_dysymtab_command<P>*	dynamicSymbolTable;
+		const macho_linkedit_data_command<P>* splitSegInfo;
+		int									linkEditSegment;
+		std::vector<mach_o::trie::Entry>	exports;			// offsets already moved to the new layout
+		std::unordered_map<std::string, uint32_t> exportIndex;
+		uint32_t							pathOffset;
+	};
+
+	struct PendingMove {
+		uint8_t*							location;
+		uint8_t								kind;
+		uint64_t							target;
+	};
+
+	void									parseImage(const InputDylib& input, Image& image);
+	void									layout();
+	void									copySegments();
+	void									adjustForSplitSegV1(Image& image);
+	void									adjustForSplitSegV2(Image& image);
+	void									adjustV2Reference(Image& image, uint8_t kind, uint64_t fromAddress, uint64_t toAddress,
+															  int64_t fromDelta, int64_t toDelta, PendingMove& pending);
+	void									rebase(Image& image);
+	void									moveExports(Image& image);
+	void									bind(uint32_t imageIndex, bool lazy);
+	bool									findExport(uint32_t imageIndex, const char* name, uint64_t& address, unsigned depth=0);
+	bool									resolve(uint32_t imageIndex, int libraryOrdinal, const char* name, uint64_t& address);
+	void									buildLinkEdit();
+	void									updateLoadCommands(Image& image);
+	void									writeHeader();
+
+	int										segmentIndexForAddress(const Image& image, uint64_t address) const;
+	uint8_t*								contentForAddress(const Image& image, uint64_t address, uint32_t size);
+	uint32_t								addString(const char* str);
+	uint32_t								appendLinkEdit(const void* data, uint64_t size);
+	uint64_t								pageAlign(uint64_t value) const { return (value + pageSize() - 1) & (-pageSize()); }
+
+	std::vector<Image>						fImages;
+	std::unordered_map<std::string, uint32_t> fImageIndexByName;
+	uint64_t								fBaseAddress;
+	uint64_t								fTextSize;			// includes the cache header
+	uint64_t								fDataOffset;
+	uint64_t								fDataSize;
+	uint64_t								fLinkEditOffset;
+	std::vector<uint8_t>					fBuffer;			// everything up to fLinkEditOffset
+	std::vector<uint8_t>					fLinkEdit;
+	std::vector<char>						fStrings;
+	std::unordered_map<std::string, uint32_t> fStringOffsets;
+	std::vector<prelink_cache_unresolved_bind> fUnresolvedBinds;
+	uint64_t								fStringsOffset;
+	uint64_t								fUnresolvedBindsOffset;
+	uint64_t								fLinkEditSize;
+	uint64_t								fInputStringsSize;
+	uint32_t								fBindsResolved;
+};
+
+
+template <>
+bool CacheBuilder<x86>::validFile(const uint8_t* fileContent)
+{
+	const macho_header<P>* header = (const macho_header<P>*)fileContent;
+	if ( header->magic() != MH_MAGIC )
+		return false;
+	if ( header->cputype() != CPU_TYPE_I386 )
+		return false;
+	return ( header->filetype() == MH_DYLIB );
+}
+
+template <>
+bool CacheBuilder<x86_64>::validFile(const uint8_t* fileContent)
+{
+	const macho_header<P>* header = (const macho_header<P>*)fileContent;
+	if ( header->magic() != MH_MAGIC_64 )
+		return false;
+	if ( header->cputype() != CPU_TYPE_X86_64 )
+		return false;
+	return ( header->filetype() == MH_DYLIB );
+}
+
+#if SUPPORT_ARCH_arm_any
+template <>
+bool CacheBuilder<arm>::validFile(const uint8_t* fileContent)
+{
+	const macho_header<P>* header = (const macho_header<P>*)fileContent;
+	if ( header->magic() != MH_MAGIC )
+		return false;
+	if ( header->cputype() != CPU_TYPE_ARM )
+		return false;
+	return ( header->filetype() == MH_DYLIB );
+}
+#endif
+
+#if SUPPORT_ARCH_arm64
+template <>
+bool CacheBuilder<arm64>::validFile(const uint8_t* fileContent)
+{
+	const macho_header<P>* header = (const macho_header<P>*)fileContent;
+	if ( header->magic() != MH_MAGIC_64 )
+		return false;
+	if ( header->cputype() != CPU_TYPE_ARM64 )
+		return false;
+	return ( header->filetype() == MH_DYLIB );
+}
+#endif
+
+// same bases dyld uses for the shared region
+template <> uint64_t CacheBuilder<x86>::defaultBaseAddress()	{ return 0x90000000ULL; }
+template <> uint64_t CacheBuilder<x86_64>::defaultBaseAddress()	{ return 0x7FFF80000000ULL; }
+template <> uint64_t CacheBuilder<arm>::defaultBaseAddress()	{ return 0x1A000000ULL; }
+template <> uint64_t CacheBuilder<arm64>::defaultBaseAddress()	{ return 0x180000000ULL; }
+
+template <typename A> uint64_t CacheBuilder<A>::pageSize()		{ return 0x1000; }
+template <> uint64_t CacheBuilder<arm64>::pageSize()			{ return 0x4000; }
+
+
+template <typename A>
+CacheBuilder<A>::CacheBuilder(const std::vector<InputDylib>& dylibs, uint64_t baseAddress)
+ : fBaseAddress(baseAddress), fTextSize(0), fDataOffset(0), fDataSize(0), fLinkEditOffset(0),
+   fStringsOffset(0), fUnresolvedBindsOffset(0), fLinkEditSize(0), fInputStringsSize(0), fBindsResolved(0)
+{
+	if ( (fBaseAddress & (pageSize()-1)) != 0 )
+		throwf("base address 0x%llX is not page aligned", fBaseAddress);
+
+	// string pool offset 0 is the empty string
+	fStrings.push_back('\0');
+	fStringOffsets[""] = 0;
+
+	fImages.resize(dylibs.size());
+	for (size_t i=0; i < dylibs.size(); ++i) {
+		parseImage(dylibs[i], fImages[i]);
+		if ( fImageIndexByName.count(fImages[i].installName) != 0 )
+			throwf("%s and %s have the same install name %s", fImages[fImageIndexByName[fImages[i].installName]].input->path,
+					dylibs[i].path, fImages[i].installName);
+		fImageIndexByName[fImages[i].installName] = i;
+	}
+	for (Image& image : fImages) {
+		for (const char* dependent : image.dependents) {
+			auto pos = fImageIndexByName.find(dependent);
+			image.dependentImages.push_back((pos != fImageIndexByName.end()) ? (int)pos->second : -1);
+		}
+	}
+
+	layout();
+	copySegments();
+	for (Image& image : fImages) {
+		const uint8_t* info = (uint8_t*)image.header + image.splitSegInfo->dataoff();
+		if ( *info == DYLD_CACHE_ADJ_V2_FORMAT ) {
+			// V2 info covers every pointer, so rebase info is not needed
+			adjustForSplitSegV2(image);
+		}
+		else {
+			adjustForSplitSegV1(image);
+			rebase(image);
+		}
+		moveExports(image);
+	}
+	for (uint32_t i=0; i < fImages.size(); ++i) {
+		bind(i, false);
+		bind(i, true);
+	}
+	buildLinkEdit();
+	for (Image& image : fImages)
+		updateLoadCommands(image);
+	writeHeader();
+}
+
+
+template <typename A>
+void CacheBuilder<A>::parseImage(const InputDylib& input, Image& image)
+{
+	image.input = &input;
+	image.header = (const macho_header<P>*)input.content;
+	image.installName = NULL;
+	image.dyldInfo = NULL;
+	image.symtab = NULL;
+	image.dynamicSymbolTable = NULL;
+	image.splitSegInfo = NULL;
+	image.linkEditSegment = -1;
+	image.pathOffset = 0;
+	// section 0 is the mach header
+	image.sectionSegments.push_back(0);
+	image.sectionAddresses.push_back(0);
+
+	const uint8_t* const endOfFile = input.content + input.length;
+	const uint8_t* const endOfLoadCommands = input.content + sizeof(macho_header<P>) + image.header->sizeofcmds();
+	const uint32_t cmd_count = image.header->ncmds();
+	const macho_load_command<P>* const cmds = (macho_load_command<P>*)(input.content + sizeof(macho_header<P>));
+	const macho_load_command<P>* cmd = cmds;
+	for (uint32_t i = 0; i < cmd_count; ++i) {
+		const uint8_t* endOfCmd = ((uint8_t*)cmd)+cmd->cmdsize();
+		if ( endOfCmd > endOfLoadCommands )
+			throwf("load command #%d extends beyond the end of the load commands in %s", i, input.path);
+		if ( endOfCmd > endOfFile )
+			throwf("load command #%d extends beyond the end of the file %s", i, input.path);
+		switch ( cmd->cmd() ) {
+			case LC_DYLD_INFO:
+			case LC_DYLD_INFO_ONLY:
+				image.dyldInfo = (macho_dyld_info_command<P>*)cmd;
+				break;
+			case macho_segment_command<P>::CMD:
+				{
+				const macho_segment_command<P>* segCmd = (const macho_segment_command<P>*)cmd;
+				Segment seg;
+				seg.name = segCmd->segname();
+				seg.oldAddress = segCmd->vmaddr();
+				seg.vmSize = segCmd->vmsize();
+				seg.fileOffset = segCmd->fileoff();
+				seg.fileSize = segCmd->filesize();
+				seg.initProt = segCmd->initprot();
+				seg.newAddress = 0;
+				if ( seg.fileOffset + seg.fileSize > input.length )
+					throwf("segment %.16s extends beyond the end of the file %s", seg.name, input.path);
+				if ( strncmp(seg.name, "__LINKEDIT", 16) == 0 )
+					image.linkEditSegment = image.segments.size();
+				const macho_section<P>* const sectionsStart = (macho_section<P>*)((char*)segCmd + sizeof(macho_segment_command<P>));
+				const macho_section<P>* const sectionsEnd = &sectionsStart[segCmd->nsects()];
+				for (const macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect) {
+					image.sectionSegments.push_back(image.segments.size());
+					image.sectionAddresses.push_back(sect->addr());
+				}
+				image.segments.push_back(seg);
+				}
+				break;
+			case LC_ID_DYLIB:
+				image.installName = ((macho_dylib_command<P>*)cmd)->name();
+				break;
+			case LC_LOAD_DYLIB:
+			case LC_LOAD_WEAK_DYLIB:
+			case LC_REEXPORT_DYLIB:
+			case LC_LOAD_UPWARD_DYLIB:
+			case LC_LAZY_LOAD_DYLIB:
+				image.dependents.push_back(((macho_dylib_command<P>*)cmd)->name());
+				image.reexported.push_back(cmd->cmd() == LC_REEXPORT_DYLIB);
+				break;
+			case LC_SYMTAB:
+				image.symtab = (macho_symtab_command<P>*)cmd;
+				break;
+			case LC_DYSYMTAB:
+				image.dynamicSymbolTable = (macho_dysymtab_command<P>*)cmd;
+				break;
+			case LC_SEGMENT_SPLIT_INFO:
+				image.splitSegInfo = (macho_linkedit_data_command<P>*)cmd;
+				break;
+			case LC_DYLD_CHAINED_FIXUPS:
+				throwf("%s uses chained fixups which cannot be prelinked", input.path);
+			case LC_ENCRYPTION_INFO:
+				if ( ((macho_encryption_info_command<P>*)cmd)->cryptid() != 0 )
+					throwf("%s is encrypted", input.path);
+				break;
+		}
+		cmd = (const macho_load_command<P>*)endOfCmd;
+	}
+
+	if ( image.installName == NULL )
+		throwf("%s has no install name", input.path);
+	if ( image.dyldInfo == NULL )
+		throwf("%s has no compressed dyld info", input.path);
+	if ( (image.splitSegInfo == NULL) || (image.splitSegInfo->datasize() == 0) )
+		throwf("%s has no split seg info, link it with -add_split_seg_info", input.path);
+	if ( (image.segments.size() == 0) || (strncmp(image.segments[0].name, "__TEXT", 16) != 0) || (image.segments[0].fileOffset != 0) )
+		throwf("%s does not start with a __TEXT segment", input.path);
+	if ( image.linkEditSegment == -1 )
+		throwf("%s has no __LINKEDIT segment", input.path);
+	if ( (image.dynamicSymbolTable != NULL) && ((image.dynamicSymbolTable->nlocrel() != 0) || (image.dynamicSymbolTable->nextrel() != 0)) )
+		throwf("%s has relocations, only images using compressed dyld info can be prelinked", input.path);
+	image.sectionAddresses[0] = image.segments[0].oldAddress;
+	for (size_t i=0; i < image.segments.size(); ++i) {
+		const Segment& seg = image.segments[i];
+		if ( (seg.oldAddress & 0xFFF) != 0 )
+			throwf("segment %.16s in %s is not page aligned", seg.name, input.path);
+		// everything but __TEXT lands in the writable mapping
+		if ( (i != 0) && ((seg.initProt & VM_PROT_EXECUTE) != 0) )
+			throwf("%s has executable segment %.16s which is not __TEXT", input.path, seg.name);
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::layout()
+{
+	uint64_t headerSize = sizeof(prelink_cache_header) + 3*sizeof(prelink_cache_mapping)
+						+ fImages.size()*(sizeof(prelink_cache_image) + sizeof(prelink_cache_image_lookup));
+	uint64_t offset = pageAlign(headerSize);
+
+	// __TEXT of all images
+	for (Image& image : fImages) {
+		Segment& text = image.segments[0];
+		text.newAddress = fBaseAddress + offset;
+		offset += pageAlign(text.vmSize);
+	}
+	fTextSize = offset;
+
+	// the other segments of an image keep their distance from each other so
+	// that split seg V1 info, which only knows __TEXT and everything else, applies
+	fDataOffset = offset;
+	for (Image& image : fImages) {
+		uint64_t start = 0;
+		uint64_t end = 0;
+		for (size_t i=1; i < image.segments.size(); ++i) {
+			const Segment& seg = image.segments[i];
+			if ( ((int)i == image.linkEditSegment) || (seg.vmSize == 0) )
+				continue;
+			if ( start == 0 )
+				start = seg.oldAddress;
+			end = std::max(end, seg.oldAddress + seg.vmSize);
+		}
+		if ( start == 0 )
+			continue;
+		for (size_t i=1; i < image.segments.size(); ++i) {
+			Segment& seg = image.segments[i];
+			if ( ((int)i == image.linkEditSegment) || (seg.vmSize == 0) )
+				continue;
+			if ( seg.oldAddress < start )
+				throwf("segment %.16s in %s is out of address order", seg.name, image.input->path);
+			seg.newAddress = fBaseAddress + offset + (seg.oldAddress - start);
+		}
+		offset += pageAlign(end - start);
+	}
+	fDataSize = offset - fDataOffset;
+	fLinkEditOffset = offset;
+	if ( fLinkEditOffset > 0xFFFFFFFFULL )
+		throwf("cache segments are larger than 4GB");
+	fBuffer.resize(fLinkEditOffset, 0);
+}
+
+
+template <typename A>
+void CacheBuilder<A>::copySegments()
+{
+	for (Image& image : fImages) {
+		for (size_t i=0; i < image.segments.size(); ++i) {
+			const Segment& seg = image.segments[i];
+			if ( ((int)i == image.linkEditSegment) || (seg.vmSize == 0) )
+				continue;
+			memcpy(&fBuffer[seg.newAddress - fBaseAddress], image.input->content + seg.fileOffset, std::min(seg.fileSize, seg.vmSize));
+		}
+	}
+}
+
+
+template <typename A>
+int CacheBuilder<A>::segmentIndexForAddress(const Image& image, uint64_t address) const
+{
+	for (size_t i=0; i < image.segments.size(); ++i) {
+		if ( ((int)i != image.linkEditSegment) && image.segments[i].contains(address) )
+			return i;
+	}
+	// pointers to the end of a segment
+	for (size_t i=0; i < image.segments.size(); ++i) {
+		if ( ((int)i != image.linkEditSegment) && (address == image.segments[i].oldAddress + image.segments[i].vmSize) )
+			return i;
+	}
+	return -1;
+}
+
+
+template <typename A>
+uint8_t* CacheBuilder<A>::contentForAddress(const Image& image, uint64_t address, uint32_t size)
+{
+	int segIndex = segmentIndexForAddress(image, address);
+	if ( segIndex == -1 )
+		throwf("address 0x%llX is not in any segment of %s", address, image.input->path);
+	const Segment& seg = image.segments[segIndex];
+	if ( address + size > seg.oldAddress + seg.vmSize )
+		throwf("%u bytes at address 0x%llX run past the end of segment %.16s of %s", size, address, seg.name, image.input->path);
+	return &fBuffer[seg.newAddress - fBaseAddress + (address - seg.oldAddress)];
+}
+
+
+template <typename A>
+void CacheBuilder<A>::adjustForSplitSegV1(Image& image)
+{
+	// V1 only records references from __TEXT to the other segments, which
+	// layout() moved together
+	const Segment& text = image.segments[0];
+	int64_t dataDelta = text.delta();
+	for (size_t i=1; i < image.segments.size(); ++i) {
+		if ( ((int)i != image.linkEditSegment) && (image.segments[i].vmSize != 0) ) {
+			dataDelta = image.segments[i].delta();
+			break;
+		}
+	}
+	const int64_t codeToDataDelta = dataDelta - text.delta();
+
+	const uint8_t* p = (uint8_t*)image.header + image.splitSegInfo->dataoff();
+	const uint8_t* end = &p[image.splitSegInfo->datasize()];
+	while ( (p < end) && (*p != 0) ) {
+		uint8_t kind = *p++;
+		uint64_t address = text.oldAddress;
+		while ( uint64_t delta = read_uleb128(p, end) ) {
+			address += delta;
+			uint32_t size = (kind == DYLD_CACHE_ADJ_V1_POINTER_64) ? sizeof(uint64_t) : sizeof(uint32_t);
+			uint32_t* p32 = (uint32_t*)contentForAddress(image, address, size);
+			uint32_t instruction = E::get32(*p32);
+			uint32_t value;
+			switch ( kind ) {
+				case DYLD_CACHE_ADJ_V1_POINTER_32:
+					E::set32(*p32, instruction + (uint32_t)codeToDataDelta);
+					break;
+				case DYLD_CACHE_ADJ_V1_POINTER_64:
+					{
+					uint64_t* p64 = (uint64_t*)p32;
+					E::set64(*p64, E::get64(*p64) + codeToDataDelta);
+					}
+					break;
+				case DYLD_CACHE_ADJ_V1_ADRP:
+					E::set32(*p32, adjustADRP(instruction, codeToDataDelta));
+					break;
+				case DYLD_CACHE_ADJ_V1_THUMB_MOVW:
+					E::set32(*p32, setThumbImm16(instruction, getThumbImm16(instruction) + codeToDataDelta));
+					break;
+				case DYLD_CACHE_ADJ_V1_ARM_MOVW:
+					E::set32(*p32, setArmImm16(instruction, getArmImm16(instruction) + codeToDataDelta));
+					break;
+				default:
+					// movt, the carry out of the movw depends on bits 12-15 of its immediate
+					if ( (kind & 0xF0) == DYLD_CACHE_ADJ_V1_ARM_THUMB_MOVT ) {
+						value = (getThumbImm16(instruction) << 16) | ((kind & 0xF) << 12);
+						value += codeToDataDelta;
+						E::set32(*p32, setThumbImm16(instruction, value >> 16));
+					}
+					else if ( (kind & 0xF0) == DYLD_CACHE_ADJ_V1_ARM_MOVT ) {
+						value = (getArmImm16(instruction) << 16) | ((kind & 0xF) << 12);
+						value += codeToDataDelta;
+						E::set32(*p32, setArmImm16(instruction, value >> 16));
+					}
+					else {
+						throwf("unknown split seg info kind %d in %s", kind, image.input->path);
+					}
+					break;
+			}
+		}
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::adjustForSplitSegV2(Image& image)
+{
+	// Whole		 :== <count> FromToSection+
+	// FromToSection :== <from-sect-index> <to-sect-index> <count> ToOffset+
+	// ToOffset		 :== <to-sect-offset-delta> <count> FromOffset+
+	// FromOffset	 :== <kind> <count> <from-sect-offset-delta>
+	const uint8_t* p = (uint8_t*)image.header + image.splitSegInfo->dataoff() + 1;
+	const uint8_t* end = (uint8_t*)image.header + image.splitSegInfo->dataoff() + image.splitSegInfo->datasize();
+	const uint64_t sectionCount = read_uleb128(p, end);
+	for (uint64_t i=0; i < sectionCount; ++i) {
+		uint64_t fromSectionIndex = read_uleb128(p, end);
+		uint64_t toSectionIndex = read_uleb128(p, end);
+		uint64_t toOffsetCount = read_uleb128(p, end);
+		if ( (fromSectionIndex >= image.sectionSegments.size()) || (toSectionIndex >= image.sectionSegments.size()) )
+			throwf("bad section index in split seg info of %s", image.input->path);
+		const int64_t fromDelta = image.segments[image.sectionSegments[fromSectionIndex]].delta();
+		const int64_t toDelta = image.segments[image.sectionSegments[toSectionIndex]].delta();
+		const uint64_t fromSectionAddress = image.sectionAddresses[fromSectionIndex];
+		const uint64_t toSectionAddress = image.sectionAddresses[toSectionIndex];
+		uint64_t toSectionOffset = 0;
+		for (uint64_t j=0; j < toOffsetCount; ++j) {
+			toSectionOffset += read_uleb128(p, end);
+			uint64_t fromOffsetCount = read_uleb128(p, end);
+			PendingMove pending = { NULL, 0, 0 };
+			for (uint64_t k=0; k < fromOffsetCount; ++k) {
+				uint8_t kind = read_uleb128(p, end);
+				uint64_t fromSectDeltaCount = read_uleb128(p, end);
+				uint64_t fromSectionOffset = 0;
+				for (uint64_t l=0; l < fromSectDeltaCount; ++l) {
+					fromSectionOffset += read_uleb128(p, end);
+					adjustV2Reference(image, kind, fromSectionAddress + fromSectionOffset, toSectionAddress + toSectionOffset,
+									  fromDelta, toDelta, pending);
+				}
+			}
+			if ( pending.location != NULL )
+				throwf("movw without movt in split seg info of %s", image.input->path);
+		}
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::adjustV2Reference(Image& image, uint8_t kind, uint64_t fromAddress, uint64_t toAddress,
+										int64_t fromDelta, int64_t toDelta, PendingMove& pending)
+{
+	const bool is64 = (kind == DYLD_CACHE_ADJ_V2_POINTER_64) || (kind == DYLD_CACHE_ADJ_V2_DELTA_64);
+	uint32_t* p32 = (uint32_t*)contentForAddress(image, fromAddress, is64 ? sizeof(uint64_t) : sizeof(uint32_t));
+	uint64_t* p64 = (uint64_t*)p32;
+	const int64_t adjust = toDelta - fromDelta;
+	switch ( kind ) {
+		case DYLD_CACHE_ADJ_V2_POINTER_32:
+			E::set32(*p32, E::get32(*p32) + (uint32_t)toDelta);
+			break;
+		case DYLD_CACHE_ADJ_V2_POINTER_64:
+			E::set64(*p64, E::get64(*p64) + toDelta);
+			break;
+		case DYLD_CACHE_ADJ_V2_DELTA_32:
+			E::set32(*p32, E::get32(*p32) + (uint32_t)adjust);
+			break;
+		case DYLD_CACHE_ADJ_V2_DELTA_64:
+			E::set64(*p64, E::get64(*p64) + adjust);
+			break;
+		case DYLD_CACHE_ADJ_V2_IMAGE_OFF_32:
+			E::set32(*p32, E::get32(*p32) + (uint32_t)(toDelta - image.segments[0].delta()));
+			break;
+		case DYLD_CACHE_ADJ_V2_ARM64_ADRP:
+			if ( adjust != 0 )
+				E::set32(*p32, adjustADRP(E::get32(*p32), adjust));
+			break;
+		case DYLD_CACHE_ADJ_V2_ARM64_OFF12:
+			// segments move by whole pages so the page offset is unchanged
+			if ( (adjust & 0xFFF) != 0 )
+				throwf("page offset changed for reference at 0x%llX in %s", fromAddress, image.input->path);
+			break;
+		case DYLD_CACHE_ADJ_V2_ARM64_BR26:
+			if ( adjust != 0 )
+				E::set32(*p32, adjustBranch26(E::get32(*p32), adjust));
+			break;
+		case DYLD_CACHE_ADJ_V2_ARM_BR24:
+		case DYLD_CACHE_ADJ_V2_THUMB_BR22:
+			// branches stay inside __TEXT
+			if ( adjust != 0 )
+				throwf("branch at 0x%llX in %s crosses segments", fromAddress, image.input->path);
+			break;
+		case DYLD_CACHE_ADJ_V2_ARM_MOVW_MOVT:
+		case DYLD_CACHE_ADJ_V2_THUMB_MOVW_MOVT:
+			{
+			// the movw and movt of a pair are recorded separately, next to each other
+			if ( pending.location == NULL ) {
+				pending.location = (uint8_t*)p32;
+				pending.kind = kind;
+				pending.target = toAddress;
+				break;
+			}
+			if ( (pending.kind != kind) || (pending.target != toAddress) )
+				throwf("unpaired movw/movt at 0x%llX in %s", fromAddress, image.input->path);
+			uint32_t* first = (uint32_t*)pending.location;
+			pending.location = NULL;
+			uint32_t instruction1 = E::get32(*first);
+			uint32_t instruction2 = E::get32(*p32);
+			const bool thumb = (kind == DYLD_CACHE_ADJ_V2_THUMB_MOVW_MOVT);
+			uint32_t* movw = first;
+			uint32_t* movt = p32;
+			if ( thumb ? (isThumbMovt(instruction1) && isThumbMovw(instruction2)) : (isArmMovt(instruction1) && isArmMovw(instruction2)) ) {
+				std::swap(movw, movt);
+				std::swap(instruction1, instruction2);
+			}
+			else if ( !(thumb ? (isThumbMovw(instruction1) && isThumbMovt(instruction2)) : (isArmMovw(instruction1) && isArmMovt(instruction2))) ) {
+				throwf("split seg info does not point to a movw/movt pair at 0x%llX in %s", fromAddress, image.input->path);
+			}
+			uint32_t value;
+			if ( thumb ) {
+				value = (getThumbImm16(instruction2) << 16) | getThumbImm16(instruction1);
+				value += adjust;
+				E::set32(*movw, setThumbImm16(instruction1, value & 0xFFFF));
+				E::set32(*movt, setThumbImm16(instruction2, value >> 16));
+			}
+			else {
+				value = (getArmImm16(instruction2) << 16) | getArmImm16(instruction1);
+				value += adjust;
+				E::set32(*movw, setArmImm16(instruction1, value & 0xFFFF));
+				E::set32(*movt, setArmImm16(instruction2, value >> 16));
+			}
+			}
+			break;
+		default:
+			throwf("unknown split seg info kind %d in %s", kind, image.input->path);
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::rebase(Image& image)
+{
+	const macho_dyld_info_command<P>* info = image.dyldInfo;
+	const uint8_t* p = (uint8_t*)image.header + info->rebase_off();
+	const uint8_t* end = &p[info->rebase_size()];
+
+	uint8_t type = 0;
+	uint64_t segOffset = 0;
+	uint32_t count;
+	uint32_t skip;
+	uint64_t segStartAddr = 0;
+	bool done = false;
+	auto rebaseAt = [&](uint64_t address) {
+		if ( type != REBASE_TYPE_POINTER )
+			throwf("text relocations in %s cannot be prelinked", image.input->path);
+		pint_t* location = (pint_t*)contentForAddress(image, address, sizeof(pint_t));
+		pint_t value = P::getP(*location);
+		int segIndex = segmentIndexForAddress(image, value);
+		if ( segIndex == -1 )
+			throwf("pointer at 0x%llX in %s points outside the image", address, image.input->path);
+		P::setP(*location, value + image.segments[segIndex].delta());
+	};
+	while ( !done && (p < end) ) {
+		uint8_t immediate = *p & REBASE_IMMEDIATE_MASK;
+		uint8_t opcode = *p & REBASE_OPCODE_MASK;
+		++p;
+		switch (opcode) {
+			case REBASE_OPCODE_DONE:
+				done = true;
+				break;
+			case REBASE_OPCODE_SET_TYPE_IMM:
+				type = immediate;
+				break;
+			case REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+				if ( immediate >= image.segments.size() )
+					throwf("bad segment index %d in rebase info of %s", immediate, image.input->path);
+				segStartAddr = image.segments[immediate].oldAddress;
+				segOffset = read_uleb128(p, end);
+				break;
+			case REBASE_OPCODE_ADD_ADDR_ULEB:
+				segOffset += read_uleb128(p, end);
+				break;
+			case REBASE_OPCODE_ADD_ADDR_IMM_SCALED:
+				segOffset += immediate*sizeof(pint_t);
+				break;
+			case REBASE_OPCODE_DO_REBASE_IMM_TIMES:
+				for (int i=0; i < immediate; ++i) {
+					rebaseAt(segStartAddr+segOffset);
+					segOffset += sizeof(pint_t);
+				}
+				break;
+			case REBASE_OPCODE_DO_REBASE_ULEB_TIMES:
+				count = read_uleb128(p, end);
+				for (uint32_t i=0; i < count; ++i) {
+					rebaseAt(segStartAddr+segOffset);
+					segOffset += sizeof(pint_t);
+				}
+				break;
+			case REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB:
+				rebaseAt(segStartAddr+segOffset);
+				segOffset += read_uleb128(p, end) + sizeof(pint_t);
+				break;
+			case REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB:
+				count = read_uleb128(p, end);
+				skip = read_uleb128(p, end);
+				for (uint32_t i=0; i < count; ++i) {
+					rebaseAt(segStartAddr+segOffset);
+					segOffset += skip + sizeof(pint_t);
+				}
+				break;
+			default:
+				throwf("bad rebase opcode 0x%02X in %s", opcode, image.input->path);
+		}
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::moveExports(Image& image)
+{
+	const macho_dyld_info_command<P>* info = image.dyldInfo;
+	if ( info->export_size() == 0 )
+		return;
+	const uint8_t* start = (uint8_t*)image.header + info->export_off();
+	const uint8_t* end = &start[info->export_size()];
+	mach_o::trie::parseTrie(start, end, image.exports);
+
+	// trie addresses are offsets from the mach header, which only moved with __TEXT
+	const Segment& text = image.segments[0];
+	auto newOffset = [&](uint64_t offset) -> uint64_t {
+		int segIndex = segmentIndexForAddress(image, text.oldAddress + offset);
+		if ( segIndex == -1 )
+			throwf("exported symbol at offset 0x%llX is outside %s", offset, image.input->path);
+		return offset + image.segments[segIndex].delta() - text.delta();
+	};
+	for (uint32_t i=0; i < image.exports.size(); ++i) {
+		mach_o::trie::Entry& entry = image.exports[i];
+		image.exportIndex[entry.name] = i;
+		if ( entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT )
+			continue;
+		if ( (entry.flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE )
+			continue;
+		entry.address = newOffset(entry.address);
+		if ( entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER )
+			entry.other = newOffset(entry.other);
+	}
+}
+
+
+template <typename A>
+bool CacheBuilder<A>::findExport(uint32_t imageIndex, const char* name, uint64_t& address, unsigned depth)
+{
+	// re-export cycles
+	if ( depth > 32 )
+		return false;
+	Image& image = fImages[imageIndex];
+	auto pos = image.exportIndex.find(name);
+	if ( pos != image.exportIndex.end() ) {
+		const mach_o::trie::Entry& entry = image.exports[pos->second];
+		if ( entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT ) {
+			if ( (entry.other == 0) || (entry.other > image.dependentImages.size()) )
+				return false;
+			int dependent = image.dependentImages[entry.other-1];
+			const char* importName = ((entry.importName != NULL) && (entry.importName[0] != '\0')) ? entry.importName : name;
+			return (dependent != -1) && findExport(dependent, importName, address, depth+1);
+		}
+		if ( (entry.flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE )
+			address = entry.address;
+		else
+			address = image.segments[0].newAddress + entry.address;
+		return true;
+	}
+	// symbols of re-exported dylibs are exported too
+	for (size_t i=0; i < image.dependents.size(); ++i) {
+		if ( image.reexported[i] && (image.dependentImages[i] != -1) && findExport(image.dependentImages[i], name, address, depth+1) )
+			return true;
+	}
+	return false;
+}
+
+
+template <typename A>
+bool CacheBuilder<A>::resolve(uint32_t imageIndex, int libraryOrdinal, const char* name, uint64_t& address)
+{
+	const Image& image = fImages[imageIndex];
+	switch ( libraryOrdinal ) {
+		case BIND_SPECIAL_DYLIB_SELF:
+			return findExport(imageIndex, name, address);
+		case BIND_SPECIAL_DYLIB_MAIN_EXECUTABLE:
+			return false;
+		case BIND_SPECIAL_DYLIB_FLAT_LOOKUP:
+		case BIND_SPECIAL_DYLIB_WEAK_LOOKUP:
+			for (uint32_t i=0; i < fImages.size(); ++i) {
+				if ( findExport(i, name, address) )
+					return true;
+			}
+			return false;
+		default:
+			if ( (libraryOrdinal < 0) || ((size_t)libraryOrdinal > image.dependentImages.size()) )
+				throwf("bad library ordinal %d in bind info of %s", libraryOrdinal, image.input->path);
+			int dependent = image.dependentImages[libraryOrdinal-1];
+			return (dependent != -1) && findExport(dependent, name, address);
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::bind(uint32_t imageIndex, bool lazy)
+{
+	Image& image = fImages[imageIndex];
+	const macho_dyld_info_command<P>* info = image.dyldInfo;
+	const uint8_t* p = (uint8_t*)image.header + (lazy ? info->lazy_bind_off() : info->bind_off());
+	const uint8_t* end = &p[lazy ? info->lazy_bind_size() : info->bind_size()];
+
+	uint8_t type = lazy ? BIND_TYPE_POINTER : 0;
+	uint64_t segOffset = 0;
+	const char* symbolName = NULL;
+	int libraryOrdinal = 0;
+	int64_t addend = 0;
+	uint32_t count;
+	uint32_t skip;
+	uint64_t segStartAddr = 0;
+	bool weakImport = false;
+	bool done = false;
+	auto bindAt = [&](uint64_t address) {
+		if ( type != BIND_TYPE_POINTER )
+			throwf("text relocations in %s cannot be prelinked", image.input->path);
+		if ( symbolName == NULL )
+			throwf("bind without a symbol in %s", image.input->path);
+		pint_t* location = (pint_t*)contentForAddress(image, address, sizeof(pint_t));
+		int segIndex = segmentIndexForAddress(image, address);
+		uint64_t newAddress = address + image.segments[segIndex].delta();
+		uint64_t targetAddress;
+		if ( resolve(imageIndex, libraryOrdinal, symbolName, targetAddress) ) {
+			P::setP(*location, targetAddress + addend);
+			++fBindsResolved;
+			return;
+		}
+		// a missing weak import is NULL until a loader finds it
+		if ( weakImport )
+			P::setP(*location, 0);
+		prelink_cache_unresolved_bind unresolved;
+		LittleEndian::set64(unresolved.address, newAddress);
+		LittleEndian::set64((uint64_t&)unresolved.addend, addend);
+		LittleEndian::set32(unresolved.imageIndex, imageIndex);
+		LittleEndian::set32(unresolved.symbolOffset, addString(symbolName));
+		LittleEndian::set32((uint32_t&)unresolved.libraryOrdinal, libraryOrdinal);
+		LittleEndian::set32(unresolved.flags, (weakImport ? PRELINK_CACHE_BIND_WEAK_IMPORT : 0) | (lazy ? PRELINK_CACHE_BIND_LAZY : 0));
+		fUnresolvedBinds.push_back(unresolved);
+		if ( verbose )
+			fprintf(stderr, "unresolved %sbind to %s from %s\n", (lazy ? "lazy " : ""), symbolName, image.installName);
+	};
+	while ( p < end ) {
+		uint8_t immediate = *p & BIND_IMMEDIATE_MASK;
+		uint8_t opcode = *p & BIND_OPCODE_MASK;
+		++p;
+		switch (opcode) {
+			case BIND_OPCODE_DONE:
+				// lazy bind info has a DONE after each entry
+				if ( !lazy )
+					done = true;
+				break;
+			case BIND_OPCODE_SET_DYLIB_ORDINAL_IMM:
+				libraryOrdinal = immediate;
+				break;
+			case BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB:
+				libraryOrdinal = read_uleb128(p, end);
+				break;
+			case BIND_OPCODE_SET_DYLIB_SPECIAL_IMM:
+				// the special ordinals are negative numbers
+				if ( immediate == 0 )
+					libraryOrdinal = 0;
+				else {
+					int8_t signExtended = BIND_OPCODE_MASK | immediate;
+					libraryOrdinal = signExtended;
+				}
+				break;
+			case BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM:
+				symbolName = (char*)p;
+				while ( (p < end) && (*p != '\0') )
+					++p;
+				++p;
+				weakImport = ( (immediate & BIND_SYMBOL_FLAGS_WEAK_IMPORT) != 0 );
+				break;
+			case BIND_OPCODE_SET_TYPE_IMM:
+				type = immediate;
+				break;
+			case BIND_OPCODE_SET_ADDEND_SLEB:
+				addend = read_sleb128(p, end);
+				break;
+			case BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+				if ( immediate >= image.segments.size() )
+					throwf("bad segment index %d in bind info of %s", immediate, image.input->path);
+				segStartAddr = image.segments[immediate].oldAddress;
+				segOffset = read_uleb128(p, end);
+				break;
+			case BIND_OPCODE_ADD_ADDR_ULEB:
+				segOffset += read_uleb128(p, end);
+				break;
+			case BIND_OPCODE_DO_BIND:
+				bindAt(segStartAddr+segOffset);
+				segOffset += sizeof(pint_t);
+				break;
+			case BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB:
+				bindAt(segStartAddr+segOffset);
+				segOffset += read_uleb128(p, end) + sizeof(pint_t);
+				break;
+			case BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED:
+				bindAt(segStartAddr+segOffset);
+				segOffset += immediate*sizeof(pint_t) + sizeof(pint_t);
+				break;
+			case BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB:
+				count = read_uleb128(p, end);
+				skip = read_uleb128(p, end);
+				for (uint32_t i=0; i < count; ++i) {
+					bindAt(segStartAddr+segOffset);
+					segOffset += skip + sizeof(pint_t);
+				}
+				break;
+			default:
+				throwf("bad bind opcode 0x%02X in %s", opcode, image.input->path);
+		}
+		if ( done )
+			break;
+	}
+}
+
+
+template <typename A>
+uint32_t CacheBuilder<A>::addString(const char* str)
+{
+	auto pos = fStringOffsets.find(str);
+	if ( pos != fStringOffsets.end() )
+		return pos->second;
+	uint32_t offset = fStrings.size();
+	fStrings.insert(fStrings.end(), str, str+strlen(str)+1);
+	fStringOffsets[str] = offset;
+	return offset;
+}
+
+
+// returns the cache file offset of the copy
+template <typename A>
+uint32_t CacheBuilder<A>::appendLinkEdit(const void* data, uint64_t size)
+{
+	while ( (fLinkEdit.size() % sizeof(pint_t)) != 0 )
+		fLinkEdit.push_back(0);
+	uint64_t offset = fLinkEditOffset + fLinkEdit.size();
+	if ( offset + size > 0xFFFFFFFFULL )
+		throwf("cache __LINKEDIT extends beyond 4GB");
+	fLinkEdit.insert(fLinkEdit.end(), (uint8_t*)data, (uint8_t*)data + size);
+	return offset;
+}
+
+
+template <typename A>
+void CacheBuilder<A>::buildLinkEdit()
+{
+	for (Image& image : fImages)
+		image.pathOffset = addString(image.installName);
+
+	// symbol tables are rewritten first, the string pool they share follows them
+	std::vector<uint32_t> symbolTableOffsets;
+	for (Image& image : fImages) {
+		if ( image.symtab == NULL ) {
+			symbolTableOffsets.push_back(0);
+			continue;
+		}
+		const macho_nlist<P>* symbols = (macho_nlist<P>*)((uint8_t*)image.header + image.symtab->symoff());
+		const char* strings = (char*)image.header + image.symtab->stroff();
+		const uint32_t stringsSize = image.symtab->strsize();
+		if ( (image.symtab->symoff() + image.symtab->nsyms()*sizeof(macho_nlist<P>) > image.input->length)
+			|| (image.symtab->stroff() + stringsSize > image.input->length) )
+			throwf("symbol table extends beyond the end of %s", image.input->path);
+		fInputStringsSize += stringsSize;
+		std::vector<macho_nlist<P> > newSymbols(symbols, symbols + image.symtab->nsyms());
+		for (macho_nlist<P>& sym : newSymbols) {
+			if ( sym.n_strx() >= stringsSize )
+				throwf("bad string index in symbol table of %s", image.input->path);
+			sym.set_n_strx(addString(&strings[sym.n_strx()]));
+			if ( (sym.n_sect() != NO_SECT) && (sym.n_sect() < image.sectionSegments.size())
+				&& (((sym.n_type() & N_STAB) != 0) || ((sym.n_type() & N_TYPE) == N_SECT)) )
+				sym.set_n_value(sym.n_value() + image.segments[image.sectionSegments[sym.n_sect()]].delta());
+		}
+		symbolTableOffsets.push_back(appendLinkEdit(&newSymbols[0], newSymbols.size()*sizeof(macho_nlist<P>)));
+	}
+
+	// everything else each image keeps is copied, the export trie is rebuilt
+	// with the moved offsets
+	for (size_t i=0; i < fImages.size(); ++i) {
+		Image& image = fImages[i];
+		const uint8_t* content = (uint8_t*)image.header;
+		macho_header<P>* newHeader = (macho_header<P>*)&fBuffer[image.segments[0].newAddress - fBaseAddress];
+		const uint32_t cmd_count = newHeader->ncmds();
+		macho_load_command<P>* cmd = (macho_load_command<P>*)((uint8_t*)newHeader + sizeof(macho_header<P>));
+		for (uint32_t j = 0; j < cmd_count; ++j) {
+			switch ( cmd->cmd() ) {
+				case LC_DYLD_INFO:
+				case LC_DYLD_INFO_ONLY:
+					{
+					macho_dyld_info_command<P>* info = (macho_dyld_info_command<P>*)cmd;
+					// rebase and bind info stay valid, they are relative to segments
+					if ( info->rebase_size() != 0 )
+						info->set_rebase_off(appendLinkEdit(&content[info->rebase_off()], info->rebase_size()));
+					if ( info->bind_size() != 0 )
+						info->set_bind_off(appendLinkEdit(&content[info->bind_off()], info->bind_size()));
+					if ( info->weak_bind_size() != 0 )
+						info->set_weak_bind_off(appendLinkEdit(&content[info->weak_bind_off()], info->weak_bind_size()));
+					if ( info->lazy_bind_size() != 0 )
+						info->set_lazy_bind_off(appendLinkEdit(&content[info->lazy_bind_off()], info->lazy_bind_size()));
+					if ( info->export_size() != 0 ) {
+						std::vector<uint8_t> trie;
+						mach_o::trie::makeTrie(image.exports, trie);
+						while ( (trie.size() % sizeof(pint_t)) != 0 )
+							trie.push_back(0);
+						info->set_export_off(appendLinkEdit(&trie[0], trie.size()));
+						info->set_export_size(trie.size());
+					}
+					}
+					break;
+				case LC_SYMTAB:
+					{
+					macho_symtab_command<P>* symtab = (macho_symtab_command<P>*)cmd;
+					symtab->set_symoff(symbolTableOffsets[i]);
+					}
+					break;
+				case LC_DYSYMTAB:
+					{
+					macho_dysymtab_command<P>* dysymtab = (macho_dysymtab_command<P>*)cmd;
+					if ( dysymtab->ntoc() != 0 )
+						dysymtab->set_tocoff(appendLinkEdit(&content[dysymtab->tocoff()], dysymtab->ntoc()*sizeof(dylib_table_of_contents)));
+					if ( dysymtab->nmodtab() != 0 )
+						dysymtab->set_modtaboff(appendLinkEdit(&content[dysymtab->modtaboff()], dysymtab->nmodtab()*sizeof(macho_dylib_module<P>)));
+					if ( dysymtab->nextrefsyms() != 0 )
+						dysymtab->set_extrefsymoff(appendLinkEdit(&content[dysymtab->extrefsymoff()], dysymtab->nextrefsyms()*sizeof(dylib_reference)));
+					if ( dysymtab->nindirectsyms() != 0 )
+						dysymtab->set_indirectsymoff(appendLinkEdit(&content[dysymtab->indirectsymoff()], dysymtab->nindirectsyms()*sizeof(uint32_t)));
+					}
+					break;
+				case LC_FUNCTION_STARTS:
+				case LC_DATA_IN_CODE:
+					{
+					// both are relative to the mach header and only cover __TEXT
+					macho_linkedit_data_command<P>* data = (macho_linkedit_data_command<P>*)cmd;
+					if ( data->datasize() != 0 )
+						data->set_dataoff(appendLinkEdit(&content[data->dataoff()], data->datasize()));
+					}
+					break;
+				case LC_SEGMENT_SPLIT_INFO:
+				case LC_CODE_SIGNATURE:
+				case LC_DYLIB_CODE_SIGN_DRS:
+					{
+					// no longer describe the image
+					macho_linkedit_data_command<P>* data = (macho_linkedit_data_command<P>*)cmd;
+					data->set_dataoff(0);
+					data->set_datasize(0);
+					}
+					break;
+			}
+			cmd = (macho_load_command<P>*)(((uint8_t*)cmd)+cmd->cmdsize());
+		}
+	}
+
+	fStringsOffset = appendLinkEdit(&fStrings[0], fStrings.size());
+	if ( fUnresolvedBinds.size() != 0 )
+		fUnresolvedBindsOffset = appendLinkEdit(&fUnresolvedBinds[0], fUnresolvedBinds.size()*sizeof(prelink_cache_unresolved_bind));
+	fLinkEditSize = fLinkEdit.size();
+	fLinkEdit.resize(pageAlign(fLinkEditSize), 0);
+}
+
+
+template <typename A>
+void CacheBuilder<A>::updateLoadCommands(Image& image)
+{
+	macho_header<P>* newHeader = (macho_header<P>*)&fBuffer[image.segments[0].newAddress - fBaseAddress];
+	const uint32_t cmd_count = newHeader->ncmds();
+	macho_load_command<P>* cmd = (macho_load_command<P>*)((uint8_t*)newHeader + sizeof(macho_header<P>));
+	uint32_t segIndex = 0;
+	for (uint32_t i = 0; i < cmd_count; ++i) {
+		switch ( cmd->cmd() ) {
+			case macho_segment_command<P>::CMD:
+				{
+				macho_segment_command<P>* segCmd = (macho_segment_command<P>*)cmd;
+				const Segment& seg = image.segments[segIndex];
+				if ( (int)segIndex == image.linkEditSegment ) {
+					// every image shares the whole coalesced __LINKEDIT
+					segCmd->set_vmaddr(fBaseAddress + fLinkEditOffset);
+					segCmd->set_vmsize(fLinkEdit.size());
+					segCmd->set_fileoff(fLinkEditOffset);
+					segCmd->set_filesize(fLinkEditSize);
+				}
+				else if ( seg.vmSize != 0 ) {
+					segCmd->set_vmaddr(seg.newAddress);
+					segCmd->set_fileoff(seg.newAddress - fBaseAddress);
+					segCmd->set_filesize(seg.vmSize);
+					macho_section<P>* const sectionsStart = (macho_section<P>*)((char*)segCmd + sizeof(macho_segment_command<P>));
+					macho_section<P>* const sectionsEnd = &sectionsStart[segCmd->nsects()];
+					for (macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect) {
+						uint64_t newAddress = sect->addr() + seg.delta();
+						sect->set_addr(newAddress);
+						switch ( sect->flags() & SECTION_TYPE ) {
+							case S_ZEROFILL:
+							case S_GB_ZEROFILL:
+							case S_THREAD_LOCAL_ZEROFILL:
+								break;
+							default:
+								sect->set_offset(newAddress - fBaseAddress);
+								break;
+						}
+					}
+				}
+				++segIndex;
+				}
+				break;
+			case LC_SYMTAB:
+				{
+				macho_symtab_command<P>* symtab = (macho_symtab_command<P>*)cmd;
+				symtab->set_stroff(fStringsOffset);
+				symtab->set_strsize(fStrings.size());
+				}
+				break;
+		}
+		cmd = (macho_load_command<P>*)(((uint8_t*)cmd)+cmd->cmdsize());
+	}
+}
+
+
+template <typename A>
+void CacheBuilder<A>::writeHeader()
+{
+	const macho_header<P>* firstHeader = fImages[0].header;
+	uint8_t* p = &fBuffer[0];
+	prelink_cache_header* header = (prelink_cache_header*)p;
+	strncpy(header->magic, PRELINK_CACHE_MAGIC, sizeof(header->magic));
+	LittleEndian::set32(header->cputype, firstHeader->cputype());
+	LittleEndian::set32(header->cpusubtype, firstHeader->cpusubtype());
+	LittleEndian::set64(header->baseAddress, fBaseAddress);
+	uint64_t offset = sizeof(prelink_cache_header);
+
+	prelink_cache_mapping* mappings = (prelink_cache_mapping*)&p[offset];
+	LittleEndian::set64(header->mappingOffset, offset);
+	LittleEndian::set32(header->mappingCount, 3);
+	offset += 3*sizeof(prelink_cache_mapping);
+	const uint64_t mappingStarts[3] = { 0, fDataOffset, fLinkEditOffset };
+	const uint64_t mappingSizes[3] = { fTextSize, fDataSize, fLinkEdit.size() };
+	const uint32_t mappingProts[3] = { VM_PROT_READ|VM_PROT_EXECUTE, VM_PROT_READ|VM_PROT_WRITE, VM_PROT_READ };
+	for (int i=0; i < 3; ++i) {
+		LittleEndian::set64(mappings[i].address, fBaseAddress + mappingStarts[i]);
+		LittleEndian::set64(mappings[i].size, mappingSizes[i]);
+		LittleEndian::set64(mappings[i].fileOffset, mappingStarts[i]);
+		LittleEndian::set32(mappings[i].maxProt, mappingProts[i]);
+		LittleEndian::set32(mappings[i].initProt, mappingProts[i]);
+	}
+
+	prelink_cache_image* images = (prelink_cache_image*)&p[offset];
+	LittleEndian::set64(header->imagesOffset, offset);
+	LittleEndian::set32(header->imagesCount, fImages.size());
+	offset += fImages.size()*sizeof(prelink_cache_image);
+	for (size_t i=0; i < fImages.size(); ++i) {
+		const Image& image = fImages[i];
+		LittleEndian::set64(images[i].address, image.segments[0].newAddress);
+		LittleEndian::set64(images[i].modTime, image.input->stat_buf.st_mtime);
+		LittleEndian::set64(images[i].inode, image.input->stat_buf.st_ino);
+		LittleEndian::set32(images[i].pathOffset, image.pathOffset);
+		LittleEndian::set32(images[i].pad, 0);
+	}
+
+	// install names sorted, for binary search
+	std::vector<uint32_t> sorted;
+	for (uint32_t i=0; i < fImages.size(); ++i)
+		sorted.push_back(i);
+	std::sort(sorted.begin(), sorted.end(), [&](uint32_t left, uint32_t right) {
+		return (strcmp(fImages[left].installName, fImages[right].installName) < 0);
+	});
+	prelink_cache_image_lookup* lookup = (prelink_cache_image_lookup*)&p[offset];
+	LittleEndian::set64(header->imageLookupOffset, offset);
+	for (size_t i=0; i < sorted.size(); ++i) {
+		LittleEndian::set32(lookup[i].pathOffset, fImages[sorted[i]].pathOffset);
+		LittleEndian::set32(lookup[i].imageIndex, sorted[i]);
+	}
+
+	LittleEndian::set64(header->unresolvedBindsOffset, fUnresolvedBindsOffset);
+	LittleEndian::set64(header->unresolvedBindsCount, fUnresolvedBinds.size());
+	LittleEndian::set64(header->stringsOffset, fStringsOffset);
+	LittleEndian::set64(header->stringsSize, fStrings.size());
+	LittleEndian::set64(header->linkeditOffset, fLinkEditOffset);
+	LittleEndian::set64(header->linkeditSize, fLinkEditSize);
+}
+
+
+template <typename A>
+void CacheBuilder<A>::write(const char* path)
+{
+	int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ( fd == -1 )
+		throwf("can't open output file for writing '%s', errno=%d", path, errno);
+	const uint8_t* parts[2] = { &fBuffer[0], &fLinkEdit[0] };
+	const uint64_t sizes[2] = { fBuffer.size(), fLinkEdit.size() };
+	for (int i=0; i < 2; ++i) {
+		const uint8_t* p = parts[i];
+		uint64_t remaining = sizes[i];
+		while ( remaining != 0 ) {
+			ssize_t amount = ::write(fd, p, remaining);
+			if ( amount <= 0 ) {
+				::close(fd);
+				::unlink(path);
+				throwf("can't write output file '%s', errno=%d", path, errno);
+			}
+			p += amount;
+			remaining -= amount;
+		}
+	}
+	::close(fd);
+
+	if ( verbose ) {
+		fprintf(stderr, "%lu images at 0x%llX: __TEXT 0x%llX bytes, data 0x%llX bytes, __LINKEDIT 0x%llX bytes\n",
+				fImages.size(), fBaseAddress, fTextSize, fDataSize, (uint64_t)fLinkEdit.size());
+		fprintf(stderr, "%u binds resolved, %lu left for the loader\n", fBindsResolved, fUnresolvedBinds.size());
+		fprintf(stderr, "string pool %lu bytes, was %llu bytes in the separate images\n", fStrings.size(), fInputStringsSize);
+	}
+}
+
+
+template <typename A>
+static void buildCache(const std::vector<InputDylib>& dylibs, uint64_t baseAddress, const char* outputPath)
+{
+	for (const InputDylib& dylib : dylibs) {
+		if ( ! CacheBuilder<A>::validFile(dylib.content) )
+			throwf("%s is not a dylib for the same architecture as %s", dylib.path, dylibs[0].path);
+	}
+	if ( baseAddress == 0 )
+		baseAddress = CacheBuilder<A>::defaultBaseAddress();
+	CacheBuilder<A> builder(dylibs, baseAddress);
+	builder.write(outputPath);
+}
+
+
+// maps path and finds the slice to use, the first file picks the architecture
+// if -arch was not used
+static void mapDylib(const char* path, InputDylib& dylib)
+{
+	dylib.path = path;
+	int fd = ::open(path, O_RDONLY, 0);
+	if ( fd == -1 )
+		throwf("cannot open file %s", path);
+	if ( ::fstat(fd, &dylib.stat_buf) != 0 )
+		throwf("fstat(%s) failed, errno=%d\n", path, errno);
+	uint8_t* p = (uint8_t*)::mmap(NULL, dylib.stat_buf.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+	if ( p == ((uint8_t*)(-1)) )
+		throwf("cannot map file %s", path);
+	::close(fd);
+	dylib.content = p;
+	dylib.length = dylib.stat_buf.st_size;
+	const mach_header* mh = (mach_header*)p;
+	if ( mh->magic == OSSwapBigToHostInt32(FAT_MAGIC) ) {
+		const struct fat_header* fh = (struct fat_header*)p;
+		const struct fat_arch* archs = (struct fat_arch*)(p + sizeof(struct fat_header));
+		for (unsigned long i=0; i < OSSwapBigToHostInt32(fh->nfat_arch); ++i) {
+			cpu_type_t cputype = OSSwapBigToHostInt32(archs[i].cputype);
+			cpu_type_t cpusubtype = OSSwapBigToHostInt32(archs[i].cpusubtype);
+			if ( (sPreferredArch == 0) || ((cputype == sPreferredArch) && ((sPreferredSubArch==0) || (sPreferredSubArch==cpusubtype))) ) {
+				sPreferredArch = cputype;
+				dylib.content = p + OSSwapBigToHostInt32(archs[i].offset);
+				dylib.length = OSSwapBigToHostInt32(archs[i].size);
+				return;
+			}
+		}
+		throwf("%s does not contain the requested architecture", path);
+	}
+	if ( sPreferredArch == 0 )
+		sPreferredArch = OSSwapLittleToHostInt32(mh->cputype);
+}
+
+
+static void usage()
+{
+	fprintf(stderr, "Usage: prelinkcache [-arch <arch>] [-base_address <hex>] [-v] -o <cache file> <dylib>...\n"
+			"\t-arch <arch>         architecture to take from universal dylibs\n"
+			"\t-base_address <hex>  address the cache is prelinked to\n"
+			"\t-o <path>            cache file to write\n"
+			"\t-v                   print what was laid out and bound\n"
+		);
+}
+
+
+int main(int argc, const char* argv[])
+{
+	if ( argc == 1 ) {
+		usage();
+		return 0;
+	}
+
+	try {
+		std::vector<const char*> files;
+		const char* outputPath = NULL;
+		uint64_t baseAddress = 0;
+		for(int i=1; i < argc; ++i) {
+			const char* arg = argv[i];
+			if ( arg[0] == '-' ) {
+				if ( strcmp(arg, "-arch") == 0 ) {
+					const char* arch = ++i<argc? argv[i]: "";
+					bool found = false;
+					for (const ArchInfo* t=archInfoArray; t->archName != NULL; ++t) {
+						if ( strcmp(t->archName,arch) == 0 ) {
+							sPreferredArch = t->cpuType;
+							if ( t->isSubType )
+								sPreferredSubArch = t->cpuSubType;
+							found = true;
+							break;
+						}
+					}
+					if ( !found )
+						throwf("unknown architecture %s", arch);
+				}
+				else if ( strcmp(arg, "-base_address") == 0 ) {
+					const char* address = ++i<argc? argv[i]: NULL;
+					if ( address == NULL )
+						throw "-base_address missing <hex>";
+					char* end;
+					baseAddress = strtoull(address, &end, 16);
+					if ( (*end != '\0') || (baseAddress == 0) )
+						throwf("-base_address value not a hex number: %s", address);
+				}
+				else if ( strcmp(arg, "-o") == 0 ) {
+					outputPath = ++i<argc? argv[i]: NULL;
+					if ( outputPath == NULL )
+						throw "-o missing <path>";
+				}
+				else if ( strcmp(arg, "-v") == 0 ) {
+					verbose = true;
+				}
+				else {
+					throwf("unknown option: %s\n", arg);
+				}
+			}
+			else {
+				files.push_back(arg);
+			}
+		}
+		if ( (files.size() == 0) || (outputPath == NULL) ) {
+			usage();
+			return 1;
+		}
+
+		std::vector<InputDylib> dylibs(files.size());
+		for (size_t i=0; i < files.size(); ++i)
+			mapDylib(files[i], dylibs[i]);
+
+		switch ( sPreferredArch ) {
+			case CPU_TYPE_I386:
+				buildCache<x86>(dylibs, baseAddress, outputPath);
+				break;
+			case CPU_TYPE_X86_64:
+				buildCache<x86_64>(dylibs, baseAddress, outputPath);
+				break;
+#if SUPPORT_ARCH_arm_any
+			case CPU_TYPE_ARM:
+				buildCache<arm>(dylibs, baseAddress, outputPath);
+				break;
+#endif
+#if SUPPORT_ARCH_arm64
+			case CPU_TYPE_ARM64:
+				buildCache<arm64>(dylibs, baseAddress, outputPath);
+				break;
+#endif
+			default:
+				throw "unsupported architecture";
+		}
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "prelinkcache failed: %s\n", msg);
+		return 1;
+	}
+
+	return 0;
+}
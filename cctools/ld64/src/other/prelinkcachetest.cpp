@@ -0,0 +1,586 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for prelinkcache(1).  Two small x86_64 dylibs are written to a
+// temporary directory: libA has a rebased pointer and a cross-segment lea
+// described by split seg info, libB binds to two of libA's exports and
+// weak-imports a symbol nobody exports.  The prelinkcache given on the command
+// line lays them out, and the rebased, adjusted and bound values in the cache
+// are compared with the new segment addresses.  Malformed rebase and bind info
+// must fail with an error that names the bad access or opcode.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+
+#include <string>
+#include <vector>
+
+#include "prelink_cache.h"
+
+// the split seg info V1 kind ld64 writes for a 32-bit reference from __TEXT to __DATA
+#define DYLD_CACHE_ADJ_V1_POINTER_32	0x01
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "prelinkcachetest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static std::string sTempDir;
+static const char* sPrelinkCache;
+
+typedef std::vector<uint8_t> Bytes;
+
+static void append(Bytes& bytes, const void* data, size_t size)
+{
+	bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+static void appendString(Bytes& bytes, const char* str)
+{
+	append(bytes, str, strlen(str)+1);
+}
+
+static void appendUleb(Bytes& bytes, uint64_t value)
+{
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if ( value != 0 )
+			byte |= 0x80;
+		bytes.push_back(byte);
+	} while ( value != 0 );
+}
+
+static void pad(Bytes& bytes, size_t alignment)
+{
+	while ( bytes.size() % alignment != 0 )
+		bytes.push_back(0);
+}
+
+template <typename T>
+static T get(const Bytes& bytes, uint64_t offset)
+{
+	T value;
+	memset(&value, 0, sizeof(T));
+	if ( offset + sizeof(T) <= bytes.size() )
+		memcpy(&value, &bytes[offset], sizeof(T));
+	return value;
+}
+
+
+struct Export
+{
+	const char*		name;
+	uint64_t		offset;
+};
+
+// a dylib with a page of __TEXT (__text at 0x800), a page of __DATA and __LINKEDIT
+struct DylibSpec
+{
+	const char*				installName;
+	const char*				dependent;
+	Bytes					text;
+	Bytes					data;
+	Bytes					rebaseInfo;
+	Bytes					bindInfo;
+	std::vector<Export>		exports;
+	Bytes					splitSegInfo;
+};
+
+// a root node whose children are all terminal, the offsets stay below 128
+static Bytes exportTrie(const std::vector<Export>& exports)
+{
+	Bytes root;
+	root.push_back(0);
+	root.push_back(exports.size());
+	size_t rootSize = root.size();
+	for (std::vector<Export>::const_iterator it=exports.begin(); it != exports.end(); ++it)
+		rootSize += strlen(it->name) + 2;
+	Bytes children;
+	for (std::vector<Export>::const_iterator it=exports.begin(); it != exports.end(); ++it) {
+		appendString(root, it->name);
+		appendUleb(root, rootSize + children.size());
+		Bytes terminal;
+		appendUleb(terminal, 0);
+		appendUleb(terminal, it->offset);
+		appendUleb(children, terminal.size());
+		append(children, &terminal[0], terminal.size());
+		children.push_back(0);
+	}
+	append(root, &children[0], children.size());
+	return root;
+}
+
+static void appendSegment(Bytes& cmds, const char* name, uint64_t address, uint64_t fileSize, uint32_t prot, const char* sectionName)
+{
+	segment_command_64 seg;
+	memset(&seg, 0, sizeof(seg));
+	seg.cmd = LC_SEGMENT_64;
+	seg.cmdsize = sizeof(seg) + ((sectionName != NULL) ? sizeof(section_64) : 0);
+	memcpy(seg.segname, name, strlen(name));
+	seg.vmaddr = address;
+	seg.vmsize = 0x1000;
+	seg.fileoff = address;
+	seg.filesize = fileSize;
+	seg.maxprot = prot;
+	seg.initprot = prot;
+	seg.nsects = (sectionName != NULL) ? 1 : 0;
+	append(cmds, &seg, sizeof(seg));
+	if ( sectionName != NULL ) {
+		section_64 sect;
+		memset(&sect, 0, sizeof(sect));
+		memcpy(sect.sectname, sectionName, strlen(sectionName));
+		memcpy(sect.segname, name, strlen(name));
+		sect.addr = address + ((address == 0) ? 0x800 : 0);
+		sect.size = 0x20;
+		sect.offset = sect.addr;
+		append(cmds, &sect, sizeof(sect));
+	}
+}
+
+static void appendDylibCommand(Bytes& cmds, uint32_t cmd, const char* path)
+{
+	Bytes name;
+	appendString(name, path);
+	pad(name, 8);
+	dylib_command dylib;
+	memset(&dylib, 0, sizeof(dylib));
+	dylib.cmd = cmd;
+	dylib.cmdsize = sizeof(dylib) + name.size();
+	dylib.dylib.name.offset = sizeof(dylib);
+	dylib.dylib.timestamp = 2;
+	dylib.dylib.current_version = 0x10000;
+	dylib.dylib.compatibility_version = 0x10000;
+	append(cmds, &dylib, sizeof(dylib));
+	append(cmds, &name[0], name.size());
+}
+
+static std::string writeDylib(const char* leafName, const DylibSpec& spec)
+{
+	// __LINKEDIT starts at 0x2000, each blob 8 byte aligned
+	Bytes linkEdit;
+	auto addLinkEdit = [&](const Bytes& blob) -> uint32_t {
+		if ( blob.empty() )
+			return 0;
+		uint32_t offset = 0x2000 + linkEdit.size();
+		append(linkEdit, &blob[0], blob.size());
+		pad(linkEdit, 8);
+		return offset;
+	};
+	uint32_t rebaseOffset = addLinkEdit(spec.rebaseInfo);
+	uint32_t bindOffset = addLinkEdit(spec.bindInfo);
+	Bytes trie = exportTrie(spec.exports);
+	pad(trie, 8);
+	uint32_t exportOffset = addLinkEdit(trie);
+	Bytes splitSegInfo = spec.splitSegInfo;
+	pad(splitSegInfo, 8);
+	uint32_t splitSegOffset = addLinkEdit(splitSegInfo);
+	Bytes strings;
+	strings.push_back(0);
+	strings.push_back(' ');
+	Bytes symbols;
+	for (std::vector<Export>::const_iterator it=spec.exports.begin(); it != spec.exports.end(); ++it) {
+		nlist_64 sym;
+		memset(&sym, 0, sizeof(sym));
+		sym.n_un.n_strx = strings.size();
+		sym.n_type = N_SECT | N_EXT;
+		sym.n_sect = (it->offset < 0x1000) ? 1 : 2;
+		sym.n_value = it->offset;
+		append(symbols, &sym, sizeof(sym));
+		appendString(strings, it->name);
+	}
+	uint32_t symbolsOffset = addLinkEdit(symbols);
+	uint32_t stringsOffset = addLinkEdit(strings);
+
+	Bytes cmds;
+	uint32_t ncmds = 0;
+	appendSegment(cmds, "__TEXT", 0, 0x1000, VM_PROT_READ | VM_PROT_EXECUTE, "__text");
+	appendSegment(cmds, "__DATA", 0x1000, 0x1000, VM_PROT_READ | VM_PROT_WRITE, "__data");
+	appendSegment(cmds, "__LINKEDIT", 0x2000, linkEdit.size(), VM_PROT_READ, NULL);
+	ncmds += 3;
+	appendDylibCommand(cmds, LC_ID_DYLIB, spec.installName);
+	++ncmds;
+	if ( spec.dependent != NULL ) {
+		appendDylibCommand(cmds, LC_LOAD_DYLIB, spec.dependent);
+		++ncmds;
+	}
+	dyld_info_command info;
+	memset(&info, 0, sizeof(info));
+	info.cmd = LC_DYLD_INFO_ONLY;
+	info.cmdsize = sizeof(info);
+	info.rebase_off = rebaseOffset;
+	info.rebase_size = spec.rebaseInfo.size();
+	info.bind_off = bindOffset;
+	info.bind_size = spec.bindInfo.size();
+	info.export_off = exportOffset;
+	info.export_size = trie.size();
+	append(cmds, &info, sizeof(info));
+	symtab_command symtab;
+	memset(&symtab, 0, sizeof(symtab));
+	symtab.cmd = LC_SYMTAB;
+	symtab.cmdsize = sizeof(symtab);
+	symtab.symoff = symbolsOffset;
+	symtab.nsyms = spec.exports.size();
+	symtab.stroff = stringsOffset;
+	symtab.strsize = strings.size();
+	append(cmds, &symtab, sizeof(symtab));
+	linkedit_data_command split;
+	memset(&split, 0, sizeof(split));
+	split.cmd = LC_SEGMENT_SPLIT_INFO;
+	split.cmdsize = sizeof(split);
+	split.dataoff = splitSegOffset;
+	split.datasize = splitSegInfo.size();
+	append(cmds, &split, sizeof(split));
+	ncmds += 3;
+
+	mach_header_64 mh;
+	memset(&mh, 0, sizeof(mh));
+	mh.magic = MH_MAGIC_64;
+	mh.cputype = CPU_TYPE_X86_64;
+	mh.cpusubtype = CPU_SUBTYPE_X86_64_ALL;
+	mh.filetype = MH_DYLIB;
+	mh.ncmds = ncmds;
+	mh.sizeofcmds = cmds.size();
+	mh.flags = MH_NOUNDEFS | MH_DYLDLINK | MH_TWOLEVEL;
+
+	Bytes file(0x2000, 0);
+	memcpy(&file[0], &mh, sizeof(mh));
+	memcpy(&file[sizeof(mh)], &cmds[0], cmds.size());
+	if ( !spec.text.empty() )
+		memcpy(&file[0x800], &spec.text[0], spec.text.size());
+	if ( !spec.data.empty() )
+		memcpy(&file[0x1000], &spec.data[0], spec.data.size());
+	append(file, &linkEdit[0], linkEdit.size());
+
+	std::string path = sTempDir + "/" + leafName;
+	FILE* f = fopen(path.c_str(), "w");
+	if ( (f == NULL) || (fwrite(&file[0], file.size(), 1, f) != 1) ) {
+		perror(path.c_str());
+		exit(1);
+	}
+	fclose(f);
+	return path;
+}
+
+
+// runs prelinkcache on the dylibs, returns whether it succeeded and what it printed
+static bool runPrelinkCache(const std::vector<std::string>& dylibs, const std::string& cachePath, std::string& output)
+{
+	std::string outputPath = sTempDir + "/output.txt";
+	std::vector<const char*> args;
+	args.push_back(sPrelinkCache);
+	args.push_back("-o");
+	args.push_back(cachePath.c_str());
+	for (std::vector<std::string>::const_iterator it=dylibs.begin(); it != dylibs.end(); ++it)
+		args.push_back(it->c_str());
+	args.push_back(NULL);
+	pid_t pid = fork();
+	if ( pid == 0 ) {
+		int fd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		dup2(fd, STDERR_FILENO);
+		execv(sPrelinkCache, (char* const*)&args[0]);
+		perror(sPrelinkCache);
+		_exit(127);
+	}
+	int status;
+	bool succeeded = (pid > 0) && (waitpid(pid, &status, 0) == pid) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+
+	output.clear();
+	FILE* f = fopen(outputPath.c_str(), "r");
+	if ( f != NULL ) {
+		char buffer[1024];
+		while ( size_t amount = fread(buffer, 1, sizeof(buffer), f) )
+			output.append(buffer, amount);
+		fclose(f);
+	}
+	unlink(outputPath.c_str());
+	return succeeded;
+}
+
+static Bytes readFile(const std::string& path)
+{
+	Bytes content;
+	FILE* f = fopen(path.c_str(), "r");
+	if ( f == NULL )
+		return content;
+	uint8_t buffer[4096];
+	while ( size_t amount = fread(buffer, 1, sizeof(buffer), f) )
+		append(content, buffer, amount);
+	fclose(f);
+	return content;
+}
+
+
+// where an image's segments ended up in the cache
+struct CachedImage
+{
+	uint32_t		index;
+	uint64_t		textAddress;
+	uint64_t		dataAddress;
+};
+
+static bool findImage(const Bytes& cache, const char* installName, CachedImage& image)
+{
+	const prelink_cache_header header = get<prelink_cache_header>(cache, 0);
+	for (uint32_t i=0; i < header.imagesCount; ++i) {
+		prelink_cache_image entry = get<prelink_cache_image>(cache, header.imagesOffset + i*sizeof(prelink_cache_image));
+		uint64_t pathOffset = header.stringsOffset + entry.pathOffset;
+		if ( (pathOffset >= cache.size()) || (strcmp((const char*)&cache[pathOffset], installName) != 0) )
+			continue;
+		image.index = i;
+		image.textAddress = 0;
+		image.dataAddress = 0;
+		uint64_t mhOffset = entry.address - header.baseAddress;
+		mach_header_64 mh = get<mach_header_64>(cache, mhOffset);
+		uint64_t cmdOffset = mhOffset + sizeof(mh);
+		for (uint32_t c=0; c < mh.ncmds; ++c) {
+			load_command cmd = get<load_command>(cache, cmdOffset);
+			if ( cmd.cmd == LC_SEGMENT_64 ) {
+				segment_command_64 seg = get<segment_command_64>(cache, cmdOffset);
+				if ( strncmp(seg.segname, "__TEXT", sizeof(seg.segname)) == 0 )
+					image.textAddress = seg.vmaddr;
+				else if ( strncmp(seg.segname, "__DATA", sizeof(seg.segname)) == 0 )
+					image.dataAddress = seg.vmaddr;
+			}
+			if ( cmd.cmdsize == 0 )
+				break;
+			cmdOffset += cmd.cmdsize;
+		}
+		return (image.textAddress == entry.address) && (image.dataAddress != 0);
+	}
+	return false;
+}
+
+
+static DylibSpec libA()
+{
+	DylibSpec spec;
+	spec.installName = "/usr/lib/libA.dylib";
+	spec.dependent = NULL;
+	// lea _adata(%rip),%rax; ret
+	const uint8_t lea[] = { 0x48, 0x8D, 0x05 };
+	append(spec.text, lea, sizeof(lea));
+	int32_t displacement = 0x1000 - 0x807;
+	append(spec.text, &displacement, sizeof(displacement));
+	spec.text.push_back(0xC3);
+	uint64_t data[2] = { 0x1234, 0x800 };
+	append(spec.data, data, sizeof(data));
+	// rebase the pointer at __DATA+8
+	spec.rebaseInfo.push_back(REBASE_OPCODE_SET_TYPE_IMM | REBASE_TYPE_POINTER);
+	spec.rebaseInfo.push_back(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB | 1);
+	appendUleb(spec.rebaseInfo, 8);
+	spec.rebaseInfo.push_back(REBASE_OPCODE_DO_REBASE_IMM_TIMES | 1);
+	spec.rebaseInfo.push_back(REBASE_OPCODE_DONE);
+	spec.exports.push_back((Export){ "_a", 0x800 });
+	spec.exports.push_back((Export){ "_adata", 0x1000 });
+	// V1 split seg info: the lea displacement at 0x803
+	spec.splitSegInfo.push_back(DYLD_CACHE_ADJ_V1_POINTER_32);
+	appendUleb(spec.splitSegInfo, 0x803);
+	spec.splitSegInfo.push_back(0);
+	spec.splitSegInfo.push_back(0);
+	return spec;
+}
+
+static DylibSpec libB()
+{
+	DylibSpec spec;
+	spec.installName = "/usr/lib/libB.dylib";
+	spec.dependent = "/usr/lib/libA.dylib";
+	spec.text.push_back(0xC3);
+	// __DATA+0 = _a, __DATA+8 = _adata+4, __DATA+16 = _missing (weak)
+	Bytes& bind = spec.bindInfo;
+	bind.push_back(BIND_OPCODE_SET_DYLIB_ORDINAL_IMM | 1);
+	bind.push_back(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
+	appendString(bind, "_a");
+	bind.push_back(BIND_OPCODE_SET_TYPE_IMM | BIND_TYPE_POINTER);
+	bind.push_back(BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB | 1);
+	appendUleb(bind, 0);
+	bind.push_back(BIND_OPCODE_DO_BIND);
+	bind.push_back(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
+	appendString(bind, "_adata");
+	bind.push_back(BIND_OPCODE_SET_ADDEND_SLEB);
+	appendUleb(bind, 4);
+	bind.push_back(BIND_OPCODE_DO_BIND);
+	bind.push_back(BIND_OPCODE_SET_ADDEND_SLEB);
+	appendUleb(bind, 0);
+	bind.push_back(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM | BIND_SYMBOL_FLAGS_WEAK_IMPORT);
+	appendString(bind, "_missing");
+	bind.push_back(BIND_OPCODE_DO_BIND);
+	bind.push_back(BIND_OPCODE_DONE);
+	spec.exports.push_back((Export){ "_b", 0x800 });
+	spec.splitSegInfo.push_back(0);
+	return spec;
+}
+
+static void checkCache()
+{
+	std::vector<std::string> dylibs;
+	dylibs.push_back(writeDylib("libA.dylib", libA()));
+	dylibs.push_back(writeDylib("libB.dylib", libB()));
+	std::string cachePath = sTempDir + "/cache";
+	std::string output;
+	check(runPrelinkCache(dylibs, cachePath, output), "prelinkcache failed: %s", output.c_str());
+	Bytes cache = readFile(cachePath);
+	unlink(cachePath.c_str());
+	for (std::vector<std::string>::const_iterator it=dylibs.begin(); it != dylibs.end(); ++it)
+		unlink(it->c_str());
+
+	const prelink_cache_header header = get<prelink_cache_header>(cache, 0);
+	check(strcmp(header.magic, PRELINK_CACHE_MAGIC) == 0, "bad magic");
+	check(header.imagesCount == 2, "%u images", header.imagesCount);
+	CachedImage a, b;
+	if ( !findImage(cache, "/usr/lib/libA.dylib", a) || !findImage(cache, "/usr/lib/libB.dylib", b) ) {
+		check(false, "images not found in the cache");
+		return;
+	}
+	check(a.dataAddress - a.textAddress != 0x1000, "the test needs __DATA to move away from __TEXT");
+	auto read32 = [&](uint64_t address) { return get<uint32_t>(cache, address - header.baseAddress); };
+	auto read64 = [&](uint64_t address) { return get<uint64_t>(cache, address - header.baseAddress); };
+
+	// libA: the lea reaches the moved __DATA, the rebased pointer __text, other data is unchanged
+	check((int32_t)read32(a.textAddress + 0x803) == (int64_t)(a.dataAddress - (a.textAddress + 0x807)),
+		  "lea displacement 0x%X", read32(a.textAddress + 0x803));
+	check(read64(a.dataAddress) == 0x1234, "libA data 0x%llX", (unsigned long long)read64(a.dataAddress));
+	check(read64(a.dataAddress + 8) == a.textAddress + 0x800, "rebased pointer 0x%llX, expected 0x%llX",
+		  (unsigned long long)read64(a.dataAddress + 8), (unsigned long long)(a.textAddress + 0x800));
+
+	// libB: binds to libA are resolved with their addends, the missing weak import is NULL
+	check(read64(b.dataAddress) == a.textAddress + 0x800, "_a bound to 0x%llX, expected 0x%llX",
+		  (unsigned long long)read64(b.dataAddress), (unsigned long long)(a.textAddress + 0x800));
+	check(read64(b.dataAddress + 8) == a.dataAddress + 4, "_adata+4 bound to 0x%llX, expected 0x%llX",
+		  (unsigned long long)read64(b.dataAddress + 8), (unsigned long long)(a.dataAddress + 4));
+	check(read64(b.dataAddress + 16) == 0, "_missing bound to 0x%llX", (unsigned long long)read64(b.dataAddress + 16));
+
+	// and is left for the loader
+	check(header.unresolvedBindsCount == 1, "%llu unresolved binds", (unsigned long long)header.unresolvedBindsCount);
+	if ( header.unresolvedBindsCount == 1 ) {
+		prelink_cache_unresolved_bind unresolved = get<prelink_cache_unresolved_bind>(cache, header.unresolvedBindsOffset);
+		check(unresolved.address == b.dataAddress + 16, "unresolved bind at 0x%llX", (unsigned long long)unresolved.address);
+		check(unresolved.imageIndex == b.index, "unresolved bind from image %u", unresolved.imageIndex);
+		check(unresolved.libraryOrdinal == 1, "unresolved bind to ordinal %d", unresolved.libraryOrdinal);
+		check(unresolved.flags == PRELINK_CACHE_BIND_WEAK_IMPORT, "unresolved bind flags 0x%X", unresolved.flags);
+		check(strcmp((const char*)&cache[header.stringsOffset + unresolved.symbolOffset], "_missing") == 0, "unresolved bind to %s",
+			  (const char*)&cache[header.stringsOffset + unresolved.symbolOffset]);
+	}
+}
+
+// libA with its rebase info replaced, prelinkcache must fail with message
+static void checkBadRebase(const Bytes& rebaseInfo, const char* message)
+{
+	DylibSpec spec = libA();
+	spec.rebaseInfo = rebaseInfo;
+	std::vector<std::string> dylibs;
+	dylibs.push_back(writeDylib("libA.dylib", spec));
+	std::string cachePath = sTempDir + "/cache";
+	std::string output;
+	check(!runPrelinkCache(dylibs, cachePath, output), "prelinkcache did not fail, expected '%s'", message);
+	check(output.find(message) != std::string::npos, "prelinkcache printed '%s', expected '%s'", output.c_str(), message);
+	unlink(cachePath.c_str());
+	unlink(dylibs[0].c_str());
+}
+
+static void checkBadBind(const Bytes& bindInfo, const char* message)
+{
+	std::vector<std::string> dylibs;
+	dylibs.push_back(writeDylib("libA.dylib", libA()));
+	DylibSpec spec = libB();
+	spec.bindInfo = bindInfo;
+	dylibs.push_back(writeDylib("libB.dylib", spec));
+	std::string cachePath = sTempDir + "/cache";
+	std::string output;
+	check(!runPrelinkCache(dylibs, cachePath, output), "prelinkcache did not fail, expected '%s'", message);
+	check(output.find(message) != std::string::npos, "prelinkcache printed '%s', expected '%s'", output.c_str(), message);
+	unlink(cachePath.c_str());
+	for (std::vector<std::string>::const_iterator it=dylibs.begin(); it != dylibs.end(); ++it)
+		unlink(it->c_str());
+}
+
+static void checkErrors()
+{
+	// a pointer in the last four bytes of __DATA runs past its end
+	Bytes rebaseInfo;
+	rebaseInfo.push_back(REBASE_OPCODE_SET_TYPE_IMM | REBASE_TYPE_POINTER);
+	rebaseInfo.push_back(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB | 1);
+	appendUleb(rebaseInfo, 0xFFC);
+	rebaseInfo.push_back(REBASE_OPCODE_DO_REBASE_IMM_TIMES | 1);
+	rebaseInfo.push_back(REBASE_OPCODE_DONE);
+	checkBadRebase(rebaseInfo, "8 bytes at address 0x1FFC run past the end of segment __DATA");
+
+	// the opcode reported is the bad one, not the byte after it
+	rebaseInfo.clear();
+	rebaseInfo.push_back(REBASE_OPCODE_SET_TYPE_IMM | REBASE_TYPE_POINTER);
+	rebaseInfo.push_back(0xC5);
+	rebaseInfo.push_back(REBASE_OPCODE_DONE);
+	checkBadRebase(rebaseInfo, "bad rebase opcode 0xC0");
+
+	Bytes bindInfo;
+	bindInfo.push_back(BIND_OPCODE_SET_DYLIB_ORDINAL_IMM | 1);
+	bindInfo.push_back(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
+	appendString(bindInfo, "_a");
+	bindInfo.push_back(BIND_OPCODE_SET_TYPE_IMM | BIND_TYPE_POINTER);
+	bindInfo.push_back(BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB | 1);
+	appendUleb(bindInfo, 0xFFC);
+	bindInfo.push_back(BIND_OPCODE_DO_BIND);
+	bindInfo.push_back(BIND_OPCODE_DONE);
+	checkBadBind(bindInfo, "8 bytes at address 0x1FFC run past the end of segment __DATA");
+
+	bindInfo.clear();
+	bindInfo.push_back(0xF3);
+	bindInfo.push_back(BIND_OPCODE_DONE);
+	checkBadBind(bindInfo, "bad bind opcode 0xF0");
+}
+
+
+int main(int argc, const char* argv[])
+{
+	if ( argc != 2 ) {
+		fprintf(stderr, "usage: prelinkcachetest <path to prelinkcache>\n");
+		return 1;
+	}
+	sPrelinkCache = argv[1];
+	char dir[] = "/tmp/prelinkcachetest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	sTempDir = dir;
+
+	checkCache();
+	checkErrors();
+
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "prelinkcachetest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
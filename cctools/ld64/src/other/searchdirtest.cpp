@@ -0,0 +1,230 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for the -L/-F search directory index (Options::fileMayExist()).  A
+// temporary tree of library and framework directories is searched through
+// Options, and the results of each lookup and the number of directories
+// indexed and file system probes after it are compared with the expected
+// ones: a directory is read once, a miss in it costs nothing, a hit one stat().
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "Options.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "searchdirtest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static std::string sTempDir;
+static std::vector<std::string> sCreated;
+
+static std::string makeDir(const char* leafName)
+{
+	std::string path = sTempDir + "/" + leafName;
+	if ( mkdir(path.c_str(), 0755) != 0 ) {
+		perror(path.c_str());
+		exit(1);
+	}
+	sCreated.push_back(path);
+	return path;
+}
+
+static std::string makeFile(const char* leafName)
+{
+	std::string path = sTempDir + "/" + leafName;
+	FILE* f = fopen(path.c_str(), "w");
+	if ( f == NULL ) {
+		perror(path.c_str());
+		exit(1);
+	}
+	fclose(f);
+	sCreated.push_back(path);
+	return path;
+}
+
+// the probes and directories indexed since the last call
+struct Counts
+{
+	uint64_t		probes;
+	uint32_t		indexed;
+};
+
+static Counts sLast;
+
+static void checkCounts(const Options& opts, uint64_t probes, uint32_t indexed, const char* what)
+{
+	check(opts.fileSystemProbes() - sLast.probes == probes, "%s: %llu probes, expected %llu", what,
+		  (unsigned long long)(opts.fileSystemProbes() - sLast.probes), (unsigned long long)probes);
+	check(opts.directoriesIndexed() - sLast.indexed == indexed, "%s: %u directories indexed, expected %u", what,
+		  opts.directoriesIndexed() - sLast.indexed, indexed);
+	sLast.probes = opts.fileSystemProbes();
+	sLast.indexed = opts.directoriesIndexed();
+}
+
+static void checkLibrary(const Options& opts, const char* rootName, const char* expected, uint64_t probes, uint32_t indexed)
+{
+	std::string found;
+	try {
+		found = opts.findLibrary(rootName).path;
+	}
+	catch (const char* msg) {
+		found = "";
+	}
+	std::string expectedPath = (expected != NULL) ? sTempDir + "/" + expected : "";
+	check(found == expectedPath, "-l%s: found '%s', expected '%s'", rootName, found.c_str(), expectedPath.c_str());
+	checkCounts(opts, probes, indexed, rootName);
+}
+
+static void checkFramework(const Options& opts, const char* name, const char* expected, uint64_t probes, uint32_t indexed)
+{
+	std::string found;
+	try {
+		found = opts.findFramework(name).path;
+	}
+	catch (const char* msg) {
+		found = "";
+	}
+	std::string expectedPath = (expected != NULL) ? sTempDir + "/" + expected : "";
+	check(found == expectedPath, "-framework %s: found '%s', expected '%s'", name, found.c_str(), expectedPath.c_str());
+	checkCounts(opts, probes, indexed, name);
+}
+
+static void checkMayExist(const Options& opts, const char* path, bool expected, uint64_t probes, uint32_t indexed)
+{
+	std::string fullPath = sTempDir + "/" + path;
+	check(opts.fileMayExist(fullPath.c_str()) == expected, "fileMayExist(%s) is %s", path, expected ? "false" : "true");
+	checkCounts(opts, probes, indexed, path);
+}
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/searchdirtest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	sTempDir = dir;
+
+	makeDir("lib1");
+	makeFile("lib1/libfoo.a");
+	makeFile("lib1/libBar.dylib");
+	makeDir("lib1/sub");
+	makeFile("lib1/sub/libsub.a");
+	makeDir("lib2");
+	makeFile("lib2/libfoo.dylib");
+	makeFile("lib2/libbaz.a");
+	makeDir("lib10");
+	makeFile("lib10/libten.a");
+	makeDir("fw");
+	makeDir("fw/Foo.framework");
+	makeFile("fw/Foo.framework/Foo");
+	std::string objectPath = makeFile("empty.o");
+	std::string lib1 = sTempDir + "/lib1";
+	std::string lib2 = sTempDir + "/lib2/";
+	std::string fw = sTempDir + "/fw";
+
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back("/dev/null");
+	args.push_back("-search_paths_first");
+	args.push_back("-L");
+	args.push_back(lib1.c_str());
+	args.push_back("-L");
+	args.push_back(lib2.c_str());
+	args.push_back("-F");
+	args.push_back(fw.c_str());
+	args.push_back(objectPath.c_str());
+	args.push_back(NULL);
+	Options* opts = NULL;
+	try {
+		opts = new Options(args.size()-1, &args[0]);
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "searchdirtest: can't parse the command line: %s\n", msg);
+		return 1;
+	}
+
+	// nothing is read until the first lookup
+	check(opts->directoriesIndexed() == 0, "%u directories indexed before any lookup", opts->directoriesIndexed());
+	sLast.probes = opts->fileSystemProbes();
+	sLast.indexed = opts->directoriesIndexed();
+
+	// lib1 is read once, libfoo.dylib and libfoo.so are misses without a stat(), libfoo.a is one stat()
+	checkLibrary(*opts, "foo", "lib1/libfoo.a", 2, 1);
+	// lib1 is indexed already, the hit is the only probe
+	checkLibrary(*opts, "Bar", "lib1/libBar.dylib", 1, 0);
+	// misses in lib1, lib2 is read and libbaz.a stat()ed, the -L path keeps its trailing slash
+	checkLibrary(*opts, "baz", "lib2//libbaz.a", 2, 1);
+	// every directory is known, a library that is nowhere costs nothing
+	checkLibrary(*opts, "none", NULL, 0, 0);
+	// lib10 is not a search directory even though lib1 is a prefix of it
+	checkLibrary(*opts, "ten", NULL, 0, 0);
+
+	// the framework directory below -F is read on the first lookup
+	checkFramework(*opts, "Foo", "fw/Foo.framework/Foo", 2, 1);
+	checkFramework(*opts, "Foo", "fw/Foo.framework/Foo", 1, 0);
+	checkFramework(*opts, "Other", NULL, 1, 0);
+
+	// names are compared case insensitively, so a case-insensitive file system never misses
+	checkMayExist(*opts, "lib1/LIBFOO.A", true, 0, 0);
+	checkMayExist(*opts, "lib1/libnothing.a", false, 0, 0);
+	// a subdirectory of a search directory is indexed too
+	checkMayExist(*opts, "lib1/sub/libsub.a", true, 1, 1);
+	checkMayExist(*opts, "lib1/sub/libnothing.a", false, 0, 0);
+	// a directory that doesn't exist is tried once and has nothing in it
+	checkMayExist(*opts, "lib1/missing/libfoo.a", false, 1, 0);
+	checkMayExist(*opts, "lib1/missing/libbar.a", false, 0, 0);
+	// paths outside the search directories are left to stat()
+	checkMayExist(*opts, "lib10/libnothing.a", true, 0, 0);
+	checkMayExist(*opts, "empty.o", true, 0, 0);
+	checkMayExist(*opts, "lib1/", true, 0, 0);
+
+	delete opts;
+	for (std::vector<std::string>::reverse_iterator it=sCreated.rbegin(); it != sCreated.rend(); ++it) {
+		if ( unlink(it->c_str()) != 0 )
+			rmdir(it->c_str());
+	}
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "searchdirtest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,458 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Test for the tail merged string pool (StringPoolAtom::tailMerge() and
+// mergedOffset() in LinkEditClassic.hpp).  A synthetic x86_64 dylib whose
+// symbol names share tails is written by OutputFile, with debug notes for an
+// object file compiled with DWARF and with -S.  The symbol table is read back:
+// every symbol must resolve to its own name, the shared tails must be stored
+// once, and the stabs strings must be left unmerged at the end of the pool.
+// SymbolTableAtom::hasStabs() hands that relocated range to the UUID
+// computation, so images that only differ in their stabs must get the same
+// UUID.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+#include "Options.h"
+#include "ld.hpp"
+#include "InternalState.h"
+#include "OutputFile.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "stringpooltest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static ld::Section sHeaderSection("__TEXT", "__mach_header", ld::Section::typeMachHeader, true);
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sDataSection("__DATA", "__data", ld::Section::typeUnclassified);
+static ld::Section sImportSection("__TEXT", "__import", ld::Section::typeImportProxies, true);
+
+class TestDylib : public ld::dylib::File
+{
+public:
+											TestDylib(const char* path, uint32_t ordinal)
+												: ld::dylib::File(path, 0, ld::File::Ordinal::makeArgOrdinal(ordinal)) {
+													_dylibInstallPath = path;
+													_dylibCurrentVersion = 0x10000;
+													_dylibCompatibilityVersion = 0x10000;
+													setExplicitlyLinked();
+												}
+
+	virtual bool							forEachAtom(AtomHandler&) const					{ return false; }
+	virtual bool							justInTimeforEachAtom(const char*, AtomHandler&) const { return false; }
+	virtual void							processIndirectLibraries(DylibHandler*, bool)	{ }
+	virtual bool							providedExportAtom() const						{ return false; }
+	virtual const char*						parentUmbrella() const							{ return NULL; }
+	virtual const std::vector<const char*>*	allowableClients() const						{ return NULL; }
+	virtual const std::vector<const char*>&	rpaths() const									{ return _rpaths; }
+	virtual bool							hasWeakExternals() const						{ return false; }
+	virtual bool							deadStrippable() const							{ return false; }
+	virtual bool							hasWeakDefinition(const char*) const			{ return false; }
+	virtual bool							hasPublicInstallName() const					{ return true; }
+	virtual bool							allSymbolsAreWeakImported() const				{ return false; }
+	virtual bool							appExtensionSafe() const						{ return true; }
+
+private:
+	std::vector<const char*>				_rpaths;
+};
+
+// an object file compiled with DWARF, OutputFile makes its debug notes
+class TestObject : public ld::relocatable::File
+{
+public:
+											TestObject(const char* path, uint32_t ordinal)
+												: ld::relocatable::File(path, 1000, ld::File::Ordinal::makeArgOrdinal(ordinal)) { }
+
+	virtual bool							forEachAtom(AtomHandler&) const					{ return false; }
+	virtual bool							justInTimeforEachAtom(const char*, AtomHandler&) const { return false; }
+	virtual DebugInfoKind					debugInfo() const								{ return kDebugInfoDwarf; }
+	virtual const std::vector<Stab>*		stabs() const									{ return NULL; }
+	virtual bool							canScatterAtoms() const							{ return true; }
+	virtual LinkerOptionsList*				linkerOptions() const							{ return NULL; }
+};
+
+class ProxyAtom : public ld::Atom
+{
+public:
+											ProxyAtom(const TestDylib& dylib, const char* name)
+												: ld::Atom(sImportSection, ld::Atom::definitionProxy, ld::Atom::combineNever,
+													ld::Atom::scopeLinkageUnit, ld::Atom::typeUnclassified, ld::Atom::symbolTableNotIn,
+													false, false, false, ld::Atom::Alignment(0)), _dylib(dylib), _name(name) { }
+
+	virtual const ld::File*					file() const					{ return &_dylib; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return 0; }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { }
+
+private:
+	const TestDylib&						_dylib;
+	const char*								_name;
+};
+
+class TestAtom : public ld::Atom
+{
+public:
+											TestAtom(const ld::Section& sect, const ld::File* file, const char* source, const char* name,
+													 ld::Atom::Scope scope, uint64_t size, uint8_t align,
+													 ld::Atom::SymbolTableInclusion inclusion=ld::Atom::symbolTableIn)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+													scope, ld::Atom::typeUnclassified, inclusion,
+													false, false, false, ld::Atom::Alignment(align)),
+												  _file(file), _source(source), _name(name), _content(size, 0) { }
+
+	virtual const ld::File*					file() const					{ return _file; }
+	virtual const char*						translationUnitSource() const	{ return _source; }
+	virtual const char*						name() const					{ return _name; }
+	virtual uint64_t						size() const					{ return _content.size(); }
+	virtual uint64_t						objectAddress() const			{ return 0; }
+	virtual void							copyRawContent(uint8_t buffer[]) const { memcpy(buffer, _content.data(), _content.size()); }
+	virtual ld::Fixup::iterator				fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void									addPointer(uint32_t offset, const ld::Atom* target)
+	{
+		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, target));
+	}
+
+private:
+	const ld::File*							_file;
+	const char*								_source;
+	const char*								_name;
+	std::vector<uint8_t>					_content;
+	std::vector<ld::Fixup>					_fixups;
+};
+
+
+// what an image is linked from, names chosen so that some are tails of others
+struct LinkSpec
+{
+	std::string			objectPath;
+	const char*			source;				// translation unit of all the atoms
+	const char*			longFunction;		// "_foo" is a tail of it
+	bool				stripDebugNotes;	// -S
+};
+
+static const char* sFunction = "_foo";
+static const char* sData = "_my_data";
+static const char* sLocal = "_local_count";
+static const char* sGlobal = "_count";		// a global that is the tail of a local
+static const char* sImport = "_data";		// an import that is the tail of a global
+
+// links the dylib to path, returns an empty string or the error thrown
+static std::string link(const std::string& path, const LinkSpec& spec)
+{
+	std::vector<const char*> args;
+	args.push_back("ld");
+	args.push_back("-arch");
+	args.push_back("x86_64");
+	args.push_back("-dylib");
+	args.push_back("-install_name");
+	args.push_back("/usr/lib/libstringpooltest.dylib");
+	args.push_back("-macosx_version_min");
+	args.push_back("10.9");
+	args.push_back("-Z");
+	args.push_back("-o");
+	args.push_back(path.c_str());
+	if ( spec.stripDebugNotes )
+		args.push_back("-S");
+	args.push_back(spec.objectPath.c_str());
+	args.push_back(NULL);
+	try {
+		Options opts(args.size()-1, &args[0]);
+		InternalState state(opts);
+		TestDylib libA("/usr/lib/libA.dylib", 1);
+		TestObject object(spec.objectPath.c_str(), 2);
+		state.dylibs.push_back(&libA);
+		ProxyAtom import(libA, sImport);
+		TestAtom header(sHeaderSection, NULL, NULL, "___dso_handle", ld::Atom::scopeLinkageUnit, 0, 0, ld::Atom::symbolTableNotIn);
+		TestAtom function(sTextSection, &object, spec.source, sFunction, ld::Atom::scopeGlobal, 16, 4);
+		TestAtom longFunction(sTextSection, &object, spec.source, spec.longFunction, ld::Atom::scopeGlobal, 16, 4);
+		TestAtom data(sDataSection, &object, spec.source, sData, ld::Atom::scopeGlobal, 8, 3);
+		TestAtom local(sDataSection, &object, spec.source, sLocal, ld::Atom::scopeTranslationUnit, 8, 3);
+		TestAtom global(sDataSection, &object, spec.source, sGlobal, ld::Atom::scopeGlobal, 8, 3);
+		data.addPointer(0, &import);
+		state.addAtom(header);
+		state.addAtom(import);
+		state.addAtom(function);
+		state.addAtom(longFunction);
+		state.addAtom(data);
+		state.addAtom(local);
+		state.addAtom(global);
+		state.sortSections();
+		ld::tool::OutputFile output(opts);
+		output.write(state);
+	}
+	catch (const char* msg) {
+		return msg;
+	}
+	return "";
+}
+
+
+struct Symbol
+{
+	std::string			name;
+	uint8_t				type;
+	uint32_t			strx;
+};
+
+// the symbol table and string pool of a linked image
+struct Image
+{
+	std::vector<uint8_t>	bytes;
+	std::vector<Symbol>		symbols;
+	uint32_t				stringsSize;
+	std::string				uuid;
+
+	bool					load(const std::string& path);
+	const Symbol*			find(const char* name, bool stab) const;
+};
+
+bool Image::load(const std::string& path)
+{
+	FILE* f = fopen(path.c_str(), "r");
+	if ( f == NULL )
+		return false;
+	uint8_t buffer[4096];
+	size_t count;
+	while ( (count = fread(buffer, 1, sizeof(buffer), f)) > 0 )
+		bytes.insert(bytes.end(), buffer, buffer+count);
+	fclose(f);
+	if ( bytes.size() < sizeof(mach_header_64) )
+		return false;
+	const mach_header_64* mh = (mach_header_64*)bytes.data();
+	if ( mh->magic != MH_MAGIC_64 )
+		return false;
+	const symtab_command* symtab = NULL;
+	const uint8_t* p = bytes.data() + sizeof(mach_header_64);
+	for (uint32_t i=0; i < mh->ncmds; ++i) {
+		const load_command* cmd = (load_command*)p;
+		if ( cmd->cmd == LC_SYMTAB )
+			symtab = (symtab_command*)cmd;
+		else if ( cmd->cmd == LC_UUID )
+			uuid.assign((char*)((uuid_command*)cmd)->uuid, 16);
+		p += cmd->cmdsize;
+	}
+	if ( (symtab == NULL) || (symtab->stroff + symtab->strsize > bytes.size()) || (symtab->symoff + symtab->nsyms*sizeof(nlist_64) > bytes.size()) )
+		return false;
+	stringsSize = symtab->strsize;
+	const char* strings = (char*)&bytes[symtab->stroff];
+	const nlist_64* nlists = (nlist_64*)&bytes[symtab->symoff];
+	for (uint32_t i=0; i < symtab->nsyms; ++i) {
+		Symbol symbol;
+		symbol.type = nlists[i].n_type;
+		symbol.strx = nlists[i].n_un.n_strx;
+		// the string must end inside the pool
+		if ( (symbol.strx >= stringsSize) || (memchr(&strings[symbol.strx], '\0', stringsSize - symbol.strx) == NULL) ) {
+			check(false, "symbol %u has string offset 0x%X, pool is 0x%X bytes", i, symbol.strx, stringsSize);
+			continue;
+		}
+		symbol.name = &strings[symbol.strx];
+		symbols.push_back(symbol);
+	}
+	return true;
+}
+
+const Symbol* Image::find(const char* name, bool stab) const
+{
+	for (std::vector<Symbol>::const_iterator it=symbols.begin(); it != symbols.end(); ++it) {
+		if ( (it->name == name) && (((it->type & N_STAB) != 0) == stab) )
+			return &*it;
+	}
+	return NULL;
+}
+
+
+// links spec and reads the image back, checks that each symbol got its own name
+static bool linkAndLoad(const char* what, const std::string& path, const LinkSpec& spec, Image& image)
+{
+	std::string error = link(path, spec);
+	check(error.empty(), "%s: link failed: %s", what, error.c_str());
+	bool loaded = error.empty() && image.load(path);
+	check(loaded, "%s: can't read %s", what, path.c_str());
+	unlink(path.c_str());
+	if ( !loaded )
+		return false;
+
+	struct { const char* name; uint8_t type; } expected[] = {
+		{ sFunction,			N_SECT | N_EXT },
+		{ spec.longFunction,	N_SECT | N_EXT },
+		{ sData,				N_SECT | N_EXT },
+		{ sLocal,				N_SECT },
+		{ sGlobal,				N_SECT | N_EXT },
+		{ sImport,				N_UNDF | N_EXT },
+	};
+	for (size_t i=0; i < sizeof(expected)/sizeof(expected[0]); ++i) {
+		const Symbol* symbol = image.find(expected[i].name, false);
+		check(symbol != NULL, "%s: no symbol %s", what, expected[i].name);
+		if ( symbol != NULL )
+			check((symbol->type & (N_TYPE | N_EXT)) == expected[i].type, "%s: %s has type 0x%02X", what, expected[i].name, symbol->type);
+	}
+	// SO, SO and OSO, BNSYM, FUN, FUN and ENSYM for each function, a GSYM or STSYM for each data symbol, and the ending SO
+	const size_t stabCount = spec.stripDebugNotes ? 0 : (3 + 2*4 + 3 + 1);
+	check(image.symbols.size() == stabCount + 6, "%s: %lu symbols", what, image.symbols.size());
+	return true;
+}
+
+// the names that are tails of other names are stored once
+static void checkTailMerged(const char* what, const Image& image, const LinkSpec& spec)
+{
+	struct { const char* tail; const char* name; } shared[] = {
+		{ sFunction,	spec.longFunction },
+		{ sGlobal,		sLocal },
+		{ sImport,		sData },
+	};
+	for (size_t i=0; i < sizeof(shared)/sizeof(shared[0]); ++i) {
+		const Symbol* tail = image.find(shared[i].tail, false);
+		const Symbol* name = image.find(shared[i].name, false);
+		if ( (tail == NULL) || (name == NULL) )
+			continue;
+		check(tail->strx == name->strx + strlen(shared[i].name) - strlen(shared[i].tail), "%s: %s at 0x%X is not the tail of %s at 0x%X",
+			  what, shared[i].tail, tail->strx, shared[i].name, name->strx);
+	}
+}
+
+// the stabs strings are unmerged and after all other strings
+static void checkStabsLast(const char* what, const Image& image, const LinkSpec& spec)
+{
+	uint32_t stabsStart = image.stringsSize;
+	uint32_t othersEnd = 2;
+	for (std::vector<Symbol>::const_iterator it=image.symbols.begin(); it != image.symbols.end(); ++it) {
+		if ( it->name.empty() )
+			continue;
+		if ( it->type & N_STAB )
+			stabsStart = std::min(stabsStart, it->strx);
+		else
+			othersEnd = std::max(othersEnd, (uint32_t)(it->strx + it->name.size() + 1));
+	}
+	check(othersEnd <= stabsStart, "%s: stabs strings start at 0x%X, other strings end at 0x%X", what, stabsStart, othersEnd);
+
+	std::string dir = spec.source;
+	dir.erase(dir.rfind('/')+1);
+	const char* stabs[] = { dir.c_str(), "test.c", spec.objectPath.c_str(), sFunction, spec.longFunction, sData, sLocal, sGlobal };
+	std::map<uint32_t, std::string> stabStrings;
+	for (size_t i=0; i < sizeof(stabs)/sizeof(stabs[0]); ++i) {
+		const Symbol* stab = image.find(stabs[i], true);
+		check(stab != NULL, "%s: no stab for %s", what, stabs[i]);
+		if ( stab != NULL )
+			stabStrings[stab->strx] = stabs[i];
+	}
+	// each stab string is copied as it was added, so none shares another's tail
+	uint32_t next = stabsStart;
+	for (std::map<uint32_t, std::string>::const_iterator it=stabStrings.begin(); it != stabStrings.end(); ++it) {
+		check(it->first == next, "%s: stab string %s at 0x%X, expected 0x%X", what, it->second.c_str(), it->first, next);
+		next = it->first + it->second.size() + 1;
+	}
+	check((next <= image.stringsSize) && (image.stringsSize - next < 8), "%s: stabs strings end at 0x%X, pool is 0x%X bytes",
+		  what, next, image.stringsSize);
+}
+
+
+int main(int argc, const char* argv[])
+{
+	char dir[] = "/tmp/stringpooltest.XXXXXX";
+	if ( mkdtemp(dir) == NULL ) {
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string tempDir = dir;
+	std::string objectPath = tempDir + "/test.o";
+	std::string otherObjectPath = tempDir + "/copy.o";
+	const std::string* objectPaths[] = { &objectPath, &otherObjectPath };
+	for (size_t i=0; i < 2; ++i) {
+		FILE* f = fopen(objectPaths[i]->c_str(), "w");
+		if ( f == NULL ) {
+			perror(objectPaths[i]->c_str());
+			return 1;
+		}
+		fclose(f);
+	}
+	std::string outputPath = tempDir + "/libstringpooltest.dylib";
+
+	LinkSpec spec;
+	spec.objectPath = objectPath;
+	spec.source = "/src/test.c";
+	spec.longFunction = "_my_foo";
+	spec.stripDebugNotes = false;
+
+	// without stabs, every string is merged
+	LinkSpec noStabs = spec;
+	noStabs.stripDebugNotes = true;
+	Image stripped;
+	if ( linkAndLoad("-S", outputPath, noStabs, stripped) ) {
+		checkTailMerged("-S", stripped, noStabs);
+		for (std::vector<Symbol>::const_iterator it=stripped.symbols.begin(); it != stripped.symbols.end(); ++it)
+			check((it->type & N_STAB) == 0, "-S: stab for %s", it->name.c_str());
+	}
+
+	// with stabs, the stabs strings are not merged and go last
+	Image image;
+	if ( linkAndLoad("stabs", outputPath, spec, image) ) {
+		checkTailMerged("stabs", image, spec);
+		checkStabsLast("stabs", image, spec);
+	}
+
+	// only the stabs differ, and they are left out of the UUID.  The paths have
+	// the same length because the padding after the stabs strings is hashed.
+	LinkSpec otherStabs = spec;
+	otherStabs.objectPath = otherObjectPath;
+	otherStabs.source = "/abc/test.c";
+	Image otherImage;
+	if ( linkAndLoad("other stabs", outputPath, otherStabs, otherImage) ) {
+		checkStabsLast("other stabs", otherImage, otherStabs);
+		check(otherImage.find(spec.objectPath.c_str(), true) == NULL, "the stabs did not change");
+		check(!image.uuid.empty() && (image.uuid == otherImage.uuid), "images that only differ in their stabs have different UUIDs");
+	}
+
+	// a symbol name is not a stab, it changes the UUID
+	LinkSpec otherName = spec;
+	otherName.longFunction = "_your_foo";
+	Image renamed;
+	if ( linkAndLoad("other name", outputPath, otherName, renamed) ) {
+		checkTailMerged("other name", renamed, otherName);
+		check(image.uuid != renamed.uuid, "images with different symbol names have the same UUID");
+	}
+
+	unlink(objectPath.c_str());
+	unlink(otherObjectPath.c_str());
+	rmdir(dir);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "stringpooltest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,215 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+
+//
+// Equivalence test for the wildcard symbol lists (-exported_symbol and
+// friends).  Random patterns are matched against random symbols with
+// Options::SetWithWildcards, before and after compile(), and with fnmatch(3).
+// Patterns stay inside the syntax where ld and fnmatch agree: no "**", no
+// '!' or leading '-' in a bracket, nothing directly after a range inside a
+// bracket (inCharRange() skips it), no escapes.  Automata too large for
+// compile() to build in full are also matched from several threads at once,
+// to exercise the locked lazy path.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+#include "Options.h"
+
+static int sFailures = 0;
+
+#define check(cond, ...) \
+	do { \
+		if ( !(cond) ) { \
+			fprintf(stderr, "wildcardtest: %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++sFailures; \
+		} \
+	} while (0)
+
+static const char sAlphabet[] = "abc_.";
+
+static char randomChar()
+{
+	return sAlphabet[rand() % (sizeof(sAlphabet)-1)];
+}
+
+static std::string randomSymbol()
+{
+	std::string symbol;
+	unsigned length = rand() % 12;
+	for (unsigned i=0; i < length; ++i)
+		symbol += randomChar();
+	return symbol;
+}
+
+static std::string randomPattern()
+{
+	static const char* const classes[] = { "[ab]", "[a-c]", "[_.]", "[_b-c]", "[c]" };
+	std::string pattern;
+	if ( rand() % 4 == 0 ) {
+		// "prefix*" patterns go into the trie
+		unsigned length = rand() % 4;
+		for (unsigned i=0; i < length; ++i)
+			pattern += randomChar();
+		return pattern + "*";
+	}
+	unsigned length = 1 + rand() % 6;
+	for (unsigned i=0; i < length; ++i) {
+		switch ( rand() % 6 ) {
+			case 0:
+				if ( pattern.empty() || (pattern[pattern.size()-1] != '*') )
+					pattern += '*';
+				break;
+			case 1:
+				pattern += '?';
+				break;
+			case 2:
+				pattern += classes[rand() % (sizeof(classes)/sizeof(classes[0]))];
+				break;
+			default:
+				pattern += randomChar();
+				break;
+		}
+	}
+	// make sure the set takes the wildcard path
+	if ( strpbrk(pattern.c_str(), "*?[") == NULL )
+		pattern += '?';
+	return pattern;
+}
+
+static bool fnmatchAny(const std::vector<std::string>& patterns, const char* symbol)
+{
+	for (std::vector<std::string>::const_iterator it=patterns.begin(); it != patterns.end(); ++it) {
+		if ( fnmatch(it->c_str(), symbol, FNM_NOESCAPE) == 0 )
+			return true;
+	}
+	return false;
+}
+
+static std::string describe(const std::vector<std::string>& patterns)
+{
+	std::string result;
+	for (std::vector<std::string>::const_iterator it=patterns.begin(); it != patterns.end(); ++it) {
+		if ( !result.empty() )
+			result += " ";
+		result += *it;
+	}
+	return result;
+}
+
+static void testRandomSets(unsigned seed)
+{
+	srand(seed);
+	std::vector<std::string> patterns;
+	unsigned count = 1 + rand() % 8;
+	for (unsigned i=0; i < count; ++i)
+		patterns.push_back(randomPattern());
+
+	Options::SetWithWildcards linear;
+	Options::SetWithWildcards compiled;
+	for (std::vector<std::string>::const_iterator it=patterns.begin(); it != patterns.end(); ++it) {
+		linear.insert(it->c_str());
+		compiled.insert(it->c_str());
+	}
+	compiled.compile();
+
+	for (unsigned i=0; i < 200; ++i) {
+		std::string symbol = randomSymbol();
+		bool expected = fnmatchAny(patterns, symbol.c_str());
+		bool wildCardMatch;
+		check(linear.contains(symbol.c_str(), &wildCardMatch) == expected, "seed %u: '%s' against %s", seed, symbol.c_str(), describe(patterns).c_str());
+		check(wildCardMatch == expected, "seed %u: '%s' against %s", seed, symbol.c_str(), describe(patterns).c_str());
+		check(compiled.contains(symbol.c_str(), &wildCardMatch) == expected, "seed %u: '%s' against %s (compiled)", seed, symbol.c_str(), describe(patterns).c_str());
+		check(wildCardMatch == expected, "seed %u: '%s' against %s (compiled)", seed, symbol.c_str(), describe(patterns).c_str());
+	}
+}
+
+struct LookupThread
+{
+	const Options::SetWithWildcards*	set;
+	const std::vector<std::string>*		patterns;
+	unsigned							seed;
+	int									mismatches;
+};
+
+static void* lookups(void* arg)
+{
+	LookupThread* thread = (LookupThread*)arg;
+	unsigned state = thread->seed;
+	for (unsigned i=0; i < 20000; ++i) {
+		char symbol[20];
+		unsigned length = 8 + rand_r(&state) % 10;
+		for (unsigned j=0; j < length; ++j)
+			symbol[j] = "ab"[rand_r(&state) % 2];
+		symbol[length] = '\0';
+		if ( thread->set->contains(symbol) != fnmatchAny(*thread->patterns, symbol) )
+			++thread->mismatches;
+	}
+	return NULL;
+}
+
+// "*a" followed by n '?' needs about 2^(n+1) DFA states
+static void testConcurrentLookups(unsigned questionMarks)
+{
+	std::vector<std::string> patterns;
+	patterns.push_back("*a" + std::string(questionMarks, '?'));
+	patterns.push_back("b*ab?b");
+	Options::SetWithWildcards set;
+	for (std::vector<std::string>::const_iterator it=patterns.begin(); it != patterns.end(); ++it)
+		set.insert(it->c_str());
+	set.compile();
+
+	const unsigned threadCount = 8;
+	pthread_t threads[threadCount];
+	LookupThread args[threadCount];
+	for (unsigned i=0; i < threadCount; ++i) {
+		args[i].set = &set;
+		args[i].patterns = &patterns;
+		args[i].seed = i+1;
+		args[i].mismatches = 0;
+		check(pthread_create(&threads[i], NULL, lookups, &args[i]) == 0, "pthread_create");
+	}
+	for (unsigned i=0; i < threadCount; ++i) {
+		pthread_join(threads[i], NULL);
+		check(args[i].mismatches == 0, "%s: thread %u had %d mismatches", describe(patterns).c_str(), i, args[i].mismatches);
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	for (unsigned seed=1; seed <= 2000; ++seed)
+		testRandomSets(seed);
+
+	// small enough to be built in full by compile()
+	testConcurrentLookups(3);
+	// built lazily, and flushed repeatedly
+	testConcurrentLookups(13);
+
+	if ( sFailures != 0 ) {
+		fprintf(stderr, "wildcardtest: %d failures\n", sFailures);
+		return 1;
+	}
+	return 0;
+}
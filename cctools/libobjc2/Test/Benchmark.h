@@ -0,0 +1,126 @@
+/**
+ * Helpers shared by the benchmarks in this directory: a clock, a way of
+ * running the same function on several threads at once, and the handling of
+ * the -quick flag.
+ *
+ * Each benchmark checks the results of the operations that it times and exits
+ * with a non-zero status if any are wrong.  The tests run them with -quick,
+ * which cuts down the iteration counts so that they finish in well under a
+ * second.  Run them by hand without arguments to get the full measurements.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "objc/runtime.h"
+#include "objc/message.h"
+
+/**
+ * Set from the -quick flag by benchmark_init().
+ */
+static int benchmark_quick;
+
+static void benchmark_init(int argc, char **argv)
+{
+	benchmark_quick = (argc > 1) && (strcmp(argv[1], "-quick") == 0);
+}
+
+/**
+ * Returns iterations, or a hundredth of it with -quick.
+ */
+static inline long benchmark_iterations(long iterations)
+{
+	if (benchmark_quick && (iterations >= 100))
+	{
+		return iterations / 100;
+	}
+	return iterations;
+}
+
+/**
+ * Returns a monotonic time in seconds.
+ */
+static inline double benchmark_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Reports a failed check and exits.
+ */
+#define benchmark_check(cond) \
+	do { if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		exit(1); \
+	} } while (0)
+
+struct benchmark_thread
+{
+	pthread_t thread;
+	int index;
+	void (*fn)(int, void*);
+	void *arg;
+};
+
+static volatile int benchmark_started;
+
+static void *benchmark_thread_start(void *t)
+{
+	struct benchmark_thread *thread = t;
+	while (!benchmark_started)
+	{
+		sched_yield();
+	}
+	thread->fn(thread->index, thread->arg);
+	return NULL;
+}
+
+/**
+ * Calls fn(i, arg) for i from 0 to threads-1, each on its own thread, all
+ * started at the same time.  Returns the time in seconds from the start until
+ * the last call returns.
+ */
+static double benchmark_run_threads(int threads, void (*fn)(int, void*), void *arg)
+{
+	struct benchmark_thread *t = calloc(threads, sizeof(struct benchmark_thread));
+	benchmark_started = 0;
+	for (int i=0 ; i<threads ; i++)
+	{
+		t[i].index = i;
+		t[i].fn = fn;
+		t[i].arg = arg;
+		benchmark_check(0 == pthread_create(&t[i].thread, NULL,
+		                                    benchmark_thread_start, &t[i]));
+	}
+	double start = benchmark_now();
+	__sync_synchronize();
+	benchmark_started = 1;
+	for (int i=0 ; i<threads ; i++)
+	{
+		pthread_join(t[i].thread, NULL);
+	}
+	double time = benchmark_now() - start;
+	free(t);
+	return time;
+}
+
+/**
+ * Returns a new instance of the Test root class from Test.m, created with a
+ * message send so that the class's dtable is installed.
+ */
+static id benchmark_new_test(void)
+{
+	static id cls;
+	static SEL new;
+	if (nil == cls)
+	{
+		new = sel_registerName("new");
+		cls = objc_getClass("Test");
+		benchmark_check(nil != cls);
+	}
+	return objc_msgSend(cls, new);
+}
@@ -0,0 +1,140 @@
+/**
+ * Measures installing the dtables of a large class hierarchy and reports the
+ * memory they use, from class_getDtableSize_np().  SELECTORS selectors are
+ * registered first, as in an application that loads many frameworks.  The
+ * classes form a tree below Test, each overriding OVERRIDES of its
+ * superclass's methods, spread over the selector range.  The first message to
+ * each class installs its dtable.
+ *
+ * The checks cover the accounting: a class has no dtable until it is sent a
+ * message, a subclass that overrides nothing shares all but its top node with
+ * its superclass, and a subclass that overrides methods in many different
+ * leaves has a private copy of each of them.
+ */
+#include "objc/runtime.h"
+#include "Benchmark.h"
+
+#define SELECTORS 65536
+#define OVERRIDES 16
+#define FANOUT 8
+
+static SEL selectors[SELECTORS];
+
+static long method(id self, SEL _cmd)
+{
+	return 1;
+}
+
+static long override(id self, SEL _cmd)
+{
+	return 2;
+}
+
+static size_t private_size(Class cls)
+{
+	size_t shared;
+	size_t size = class_getDtableSize_np(cls, &shared);
+	benchmark_check(shared <= size);
+	return size - shared;
+}
+
+static id send_first_message(Class cls, SEL sel)
+{
+	id obj = class_createInstance(cls, 0);
+	IMP imp = objc_msg_lookup(obj, sel);
+	benchmark_check(NULL != imp);
+	return obj;
+}
+
+static void check_accounting(Class test)
+{
+	Class base = objc_allocateClassPair(test, "DtableBenchmarkBase", 0);
+	for (int i=0 ; i<SELECTORS ; i+=SELECTORS/256)
+	{
+		class_addMethod(base, selectors[i], (IMP)method, "l@:");
+	}
+	objc_registerClassPair(base);
+	Class empty = objc_allocateClassPair(base, "DtableBenchmarkEmpty", 0);
+	objc_registerClassPair(empty);
+	Class overriding = objc_allocateClassPair(base, "DtableBenchmarkOverriding", 0);
+	for (int i=0 ; i<SELECTORS ; i+=SELECTORS/64)
+	{
+		class_addMethod(overriding, selectors[i], (IMP)override, "l@:");
+	}
+	objc_registerClassPair(overriding);
+
+	benchmark_check(0 == class_getDtableSize_np(base, NULL));
+	benchmark_check(0 == class_getDtableSize_np(empty, NULL));
+	benchmark_check(0 == class_getDtableSize_np(Nil, NULL));
+
+	send_first_message(base, selectors[0]);
+	send_first_message(empty, selectors[0]);
+	send_first_message(overriding, selectors[0]);
+
+	size_t shared;
+	size_t size = class_getDtableSize_np(empty, &shared);
+	benchmark_check(size > 0);
+	benchmark_check(shared > 0);
+	// only the top node of the empty subclass's dtable is its own
+	benchmark_check(private_size(empty) < size / 4);
+	// and each of the 64 overrides is in a different leaf
+	benchmark_check(private_size(overriding) - private_size(empty) >=
+	                64 * 256 * sizeof(void*));
+	benchmark_check(class_getDtableSize_np(base, NULL) > 0);
+}
+
+int main(int argc, char **argv)
+{
+	benchmark_init(argc, argv);
+	int classes = benchmark_iterations(20000);
+	if (classes < FANOUT * 8) { classes = FANOUT * 8; }
+
+	char name[64];
+	for (int i=0 ; i<SELECTORS ; i++)
+	{
+		snprintf(name, sizeof(name), "dtableBenchmark%d", i);
+		selectors[i] = sel_registerTypedName_np(name, "l@:");
+	}
+	Class test = (Class)objc_getClass("Test");
+	benchmark_check(Nil != test);
+	check_accounting(test);
+
+	Class *tree = calloc(classes, sizeof(Class));
+	for (int c=0 ; c<classes ; c++)
+	{
+		Class super = (c < FANOUT) ? test : tree[(c - FANOUT) / FANOUT];
+		snprintf(name, sizeof(name), "DtableBenchmark%d", c);
+		tree[c] = objc_allocateClassPair(super, name, 0);
+		for (int i=0 ; i<OVERRIDES ; i++)
+		{
+			int s = (c * 7919 + i * (SELECTORS / OVERRIDES)) % SELECTORS;
+			class_addMethod(tree[c], selectors[s], (IMP)method, "l@:");
+		}
+		objc_registerClassPair(tree[c]);
+	}
+
+	double start = benchmark_now();
+	for (int c=0 ; c<classes ; c++)
+	{
+		object_dispose(send_first_message(tree[c], selectors[0]));
+	}
+	double time = benchmark_now() - start;
+
+	size_t total = 0;
+	size_t totalShared = 0;
+	for (int c=0 ; c<classes ; c++)
+	{
+		size_t shared;
+		size_t size = class_getDtableSize_np(tree[c], &shared);
+		benchmark_check(size > 0);
+		total += size;
+		totalShared += shared;
+	}
+	printf("%d classes, %d selectors: %.3f s to install dtables\n", classes,
+	       SELECTORS, time);
+	// shared nodes are counted once for every class that uses them
+	printf("%zu bytes in dtables, %zu per class, %zu of them in shared nodes\n",
+	       total, total / classes, totalShared / classes);
+	printf("%zu bytes in nodes private to one class\n", total - totalShared);
+	return 0;
+}
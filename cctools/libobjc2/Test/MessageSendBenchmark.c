@@ -0,0 +1,152 @@
+/**
+ * Measures message sends from one call site to receivers of 1, 2, 8 and 64
+ * classes, both with objc_msgSend() and with objc_msg_lookup().  The classes
+ * are subclasses of Test, each with SELECTORS methods.  Every method returns a
+ * value made from the receiver's tag and the method's number, negated in
+ * every other class, which is checked after each send.  At the end each
+ * class has a method replaced, and sends must then call the new method, which
+ * checks that replacing a method invalidates any cached lookups.
+ */
+#include "Benchmark.h"
+
+#define MAX_CLASSES 64
+#define SELECTORS 16
+#define RECEIVERS 256
+
+static SEL selectors[SELECTORS];
+static Class classes[MAX_CLASSES];
+static id receivers[RECEIVERS];
+static long results[RECEIVERS][SELECTORS];
+static long operations;
+static int classCount;
+
+static long tag(id self)
+{
+	return *(long*)object_getIndexedIvars(self);
+}
+
+#define METHODS(n) \
+	static long method ## n(id self, SEL _cmd) { return tag(self) * SELECTORS + n; } \
+	static long negated ## n(id self, SEL _cmd) { return -(tag(self) * SELECTORS + n); }
+METHODS(0) METHODS(1) METHODS(2) METHODS(3) METHODS(4) METHODS(5) METHODS(6)
+METHODS(7) METHODS(8) METHODS(9) METHODS(10) METHODS(11) METHODS(12)
+METHODS(13) METHODS(14) METHODS(15)
+#define IMPS(prefix) \
+	{ (IMP)prefix ## 0, (IMP)prefix ## 1, (IMP)prefix ## 2, (IMP)prefix ## 3, \
+	  (IMP)prefix ## 4, (IMP)prefix ## 5, (IMP)prefix ## 6, (IMP)prefix ## 7, \
+	  (IMP)prefix ## 8, (IMP)prefix ## 9, (IMP)prefix ## 10, (IMP)prefix ## 11, \
+	  (IMP)prefix ## 12, (IMP)prefix ## 13, (IMP)prefix ## 14, (IMP)prefix ## 15 }
+static IMP methods[SELECTORS] = IMPS(method);
+static IMP negated[SELECTORS] = IMPS(negated);
+
+static long replaced(id self, SEL _cmd)
+{
+	return -1;
+}
+
+static void create_classes(void)
+{
+	char name[32];
+	Class test = (Class)objc_getClass("Test");
+	benchmark_check(Nil != test);
+	for (int i=0 ; i<SELECTORS ; i++)
+	{
+		snprintf(name, sizeof(name), "method%d", i);
+		selectors[i] = sel_registerTypedName_np(name, "l@:");
+	}
+	for (int c=0 ; c<MAX_CLASSES ; c++)
+	{
+		snprintf(name, sizeof(name), "MessageSendBenchmark%d", c);
+		classes[c] = objc_allocateClassPair(test, name, 0);
+		for (int i=0 ; i<SELECTORS ; i++)
+		{
+			class_addMethod(classes[c], selectors[i],
+			                (c & 1) ? negated[i] : methods[i], "l@:");
+		}
+		objc_registerClassPair(classes[c]);
+	}
+}
+
+/**
+ * Creates the receivers, spread over the first count classes.
+ */
+static void create_receivers(int count)
+{
+	classCount = count;
+	for (int r=0 ; r<RECEIVERS ; r++)
+	{
+		int c = r % count;
+		if (nil != receivers[r])
+		{
+			object_dispose(receivers[r]);
+		}
+		receivers[r] = class_createInstance(classes[c], sizeof(long));
+		*(long*)object_getIndexedIvars(receivers[r]) = r;
+		for (int i=0 ; i<SELECTORS ; i++)
+		{
+			results[r][i] = (c & 1) ? -(r * SELECTORS + i) : r * SELECTORS + i;
+		}
+	}
+}
+
+static void send(int thread, void *unused)
+{
+	for (long i=0 ; i<operations ; i++)
+	{
+		int r = (i * 7 + thread) % RECEIVERS;
+		int s = (i / RECEIVERS + r) % SELECTORS;
+		long result = ((long(*)(id, SEL))objc_msgSend)(receivers[r], selectors[s]);
+		benchmark_check(result == results[r][s]);
+	}
+}
+
+static void lookup(int thread, void *unused)
+{
+	for (long i=0 ; i<operations ; i++)
+	{
+		int r = (i * 7 + thread) % RECEIVERS;
+		int s = (i / RECEIVERS + r) % SELECTORS;
+		IMP imp = objc_msg_lookup(receivers[r], selectors[s]);
+		long result = ((long(*)(id, SEL))imp)(receivers[r], selectors[s]);
+		benchmark_check(result == results[r][s]);
+	}
+}
+
+static void run(const char *title, void (*fn)(int, void*))
+{
+	double time = benchmark_run_threads(1, fn, NULL);
+	printf("%s, %2d classes: %6.2f ns/send\n", title, classCount,
+	       time * 1e9 / operations);
+	time = benchmark_run_threads(4, fn, NULL);
+	printf("%s, %2d classes, 4 threads: %6.2f ns/send\n", title, classCount,
+	       time * 1e9 / operations);
+}
+
+int main(int argc, char **argv)
+{
+	benchmark_init(argc, argv);
+	operations = benchmark_iterations(10000000);
+	create_classes();
+
+	int counts[] = { 1, 2, 8, MAX_CLASSES };
+	for (int i=0 ; i<sizeof(counts)/sizeof(counts[0]) ; i++)
+	{
+		create_receivers(counts[i]);
+		run("objc_msgSend", send);
+		run("objc_msg_lookup", lookup);
+	}
+
+	for (int c=0 ; c<MAX_CLASSES ; c++)
+	{
+		class_replaceMethod(classes[c], selectors[c % SELECTORS], (IMP)replaced,
+		                    "l@:");
+	}
+	for (int r=0 ; r<RECEIVERS ; r++)
+	{
+		results[r][(r % MAX_CLASSES) % SELECTORS] = -1;
+	}
+	operations = RECEIVERS * SELECTORS * 4;
+	send(0, NULL);
+	lookup(0, NULL);
+	return 0;
+}
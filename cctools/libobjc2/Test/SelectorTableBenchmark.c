@@ -0,0 +1,81 @@
+/**
+ * Measures selector lookups from several threads.  Most calls to
+ * sel_registerName() are for selectors that already exist, which do not take
+ * the selector table lock.  The second part registers new selectors on some
+ * threads while the others keep looking up existing ones, so the lookups race
+ * with inserts and with the table growing.
+ */
+#include "objc/runtime.h"
+#include "Benchmark.h"
+
+#define SELECTORS 4096
+#define MAX_THREADS 16
+
+static char *names[SELECTORS];
+static SEL sels[SELECTORS];
+static long lookups;
+static long inserts;
+
+static void lookup_existing(int thread, void *unused)
+{
+	unsigned r = thread * 7919 + 1;
+	for (long i=0 ; i<lookups ; i++)
+	{
+		r = r * 1103515245 + 12345;
+		unsigned n = (r >> 8) % SELECTORS;
+		SEL sel = (i & 1) ? sel_registerName(names[n]) : sel_getUid(names[n]);
+		benchmark_check(sel_isEqual(sel, sels[n]));
+	}
+}
+
+/**
+ * Even threads register new selectors, odd ones look up existing ones.
+ */
+static void insert_and_lookup(int thread, void *unused)
+{
+	if (thread & 1)
+	{
+		lookup_existing(thread, unused);
+		return;
+	}
+	char name[64];
+	for (long i=0 ; i<inserts ; i++)
+	{
+		snprintf(name, sizeof(name), "benchNew%d_%ld:with:", thread, i);
+		SEL sel = sel_registerName(name);
+		benchmark_check(0 == strcmp(sel_getName(sel), name));
+		benchmark_check(sel_isEqual(sel, sel_registerName(name)));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	benchmark_init(argc, argv);
+	lookups = benchmark_iterations(2000000);
+	inserts = benchmark_iterations(50000);
+
+	for (int i=0 ; i<SELECTORS ; i++)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "benchSelector%d:arg:", i);
+		names[i] = strdup(name);
+		sels[i] = sel_registerName(names[i]);
+		benchmark_check(0 == strcmp(sel_getName(sels[i]), names[i]));
+	}
+
+	printf("lookups of existing selectors:\n");
+	for (int threads=1 ; threads<=MAX_THREADS ; threads*=2)
+	{
+		double time = benchmark_run_threads(threads, lookup_existing, NULL);
+		printf("%3d threads: %8.1f ns/lookup, %8.2f M lookups/s\n", threads,
+		       time * 1e9 / lookups, threads * lookups / time / 1e6);
+	}
+
+	printf("lookups while registering new selectors:\n");
+	for (int threads=2 ; threads<=MAX_THREADS ; threads*=2)
+	{
+		double time = benchmark_run_threads(threads, insert_and_lookup, NULL);
+		printf("%3d threads: %8.3f s\n", threads, time);
+	}
+	return 0;
+}
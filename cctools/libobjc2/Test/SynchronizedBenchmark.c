@@ -0,0 +1,89 @@
+/**
+ * Measures the locks that @synchronized uses, on 1 to 16 threads.  The first
+ * part locks many short-lived objects, each of them once and recursively,
+ * then releases them.  The second part does the same with
+ * objc_setAssociatedObject(), which creates the hidden class that
+ * objc_sync_enter() used to give every object it locked, so the two show the
+ * cost of the side table against that of the old implementation.  The last
+ * part has every thread lock one shared object and checks that a counter
+ * updated while holding the lock is not corrupted.
+ */
+#include "Benchmark.h"
+#include "objc/objc-arc.h"
+
+int objc_sync_enter(id object);
+int objc_sync_exit(id object);
+
+#define MAX_THREADS 16
+
+static long operations;
+static char key;
+static id shared;
+static volatile long counter;
+
+static void sync_short_lived(int thread, void *unused)
+{
+	for (long i=0 ; i<operations ; i++)
+	{
+		id obj = benchmark_new_test();
+		benchmark_check(0 == objc_sync_enter(obj));
+		benchmark_check(0 == objc_sync_enter(obj));
+		benchmark_check(0 == objc_sync_exit(obj));
+		benchmark_check(0 == objc_sync_exit(obj));
+		benchmark_check(0 != objc_sync_exit(obj));
+		objc_release(obj);
+	}
+}
+
+static void associate_short_lived(int thread, void *unused)
+{
+	for (long i=0 ; i<operations ; i++)
+	{
+		id obj = benchmark_new_test();
+		objc_setAssociatedObject(obj, &key, obj, OBJC_ASSOCIATION_ASSIGN);
+		benchmark_check(obj == objc_getAssociatedObject(obj, &key));
+		objc_release(obj);
+	}
+}
+
+static void sync_shared(int thread, void *unused)
+{
+	for (long i=0 ; i<operations ; i++)
+	{
+		benchmark_check(0 == objc_sync_enter(shared));
+		counter++;
+		benchmark_check(0 == objc_sync_exit(shared));
+	}
+}
+
+static void run(const char *title, void (*fn)(int, void*))
+{
+	printf("%s:\n", title);
+	for (int threads=1 ; threads<=MAX_THREADS ; threads*=2)
+	{
+		double time = benchmark_run_threads(threads, fn, NULL);
+		printf("%3d threads: %8.1f ns/operation\n", threads,
+		       time * 1e9 / operations);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	benchmark_init(argc, argv);
+	operations = benchmark_iterations(200000);
+
+	run("@synchronized on short-lived objects", sync_short_lived);
+	run("hidden class on short-lived objects (old @synchronized)",
+	    associate_short_lived);
+
+	shared = benchmark_new_test();
+	long expected = 0;
+	for (int threads=1 ; threads<=MAX_THREADS ; threads*=2)
+	{
+		expected += threads * operations;
+	}
+	run("@synchronized on one shared object", sync_shared);
+	benchmark_check(expected == counter);
+	objc_release(shared);
+	return 0;
+}
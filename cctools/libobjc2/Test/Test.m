@@ -0,0 +1,24 @@
+/**
+ * A root class for the benchmarks, which look it up with objc_getClass().
+ * Linking this file into each benchmark also makes the runtime initialise
+ * itself before main() is called, as it does for any Objective-C program, so
+ * the benchmarks themselves can be plain C.
+ */
+#include "objc/runtime.h"
+
+@interface Test
+{
+	Class isa;
+}
+@end
+
+@implementation Test
++ (id)new
+{
+	return class_createInstance(self, 0);
+}
+- (void)dealloc
+{
+	object_dispose(self);
+}
+@end
@@ -0,0 +1,112 @@
+/**
+ * Measures weak reference loads and stores on 1 to 64 threads.  Each thread
+ * has its own weak references, to objects that are shared by all threads, and
+ * mostly loads them with objc_loadWeakRetained(), storing a different object
+ * in one of them every STORE_INTERVAL operations.  The second part has every
+ * thread load weak references to the same object, which all use one stripe of
+ * the weak reference table.  At the end the objects are released and each
+ * weak reference must then load as nil.
+ */
+#include "Benchmark.h"
+#include "objc/objc-arc.h"
+
+#define OBJECTS 1024
+#define MAX_THREADS 64
+#define WEAKS_PER_THREAD 64
+#define STORE_INTERVAL 16
+
+static id objects[OBJECTS];
+static id weaks[MAX_THREADS][WEAKS_PER_THREAD];
+static int targets[MAX_THREADS][WEAKS_PER_THREAD];
+static long operations;
+
+static void load_and_store(int thread, void *unused)
+{
+	id *weak = weaks[thread];
+	int *target = targets[thread];
+	unsigned r = thread * 7919 + 1;
+	for (long i=0 ; i<operations ; i++)
+	{
+		int w = i % WEAKS_PER_THREAD;
+		if ((i % STORE_INTERVAL) == 0)
+		{
+			r = r * 1103515245 + 12345;
+			target[w] = (r >> 8) % OBJECTS;
+			benchmark_check(objc_storeWeak(&weak[w], objects[target[w]]) ==
+			                objects[target[w]]);
+			continue;
+		}
+		id obj = objc_loadWeakRetained(&weak[w]);
+		benchmark_check(obj == objects[target[w]]);
+		objc_release(obj);
+	}
+}
+
+static void load_same_object(int thread, void *unused)
+{
+	id *weak = &weaks[thread][0];
+	for (long i=0 ; i<operations ; i++)
+	{
+		id obj = objc_loadWeakRetained(weak);
+		benchmark_check(obj == objects[0]);
+		objc_release(obj);
+	}
+}
+
+static void run(const char *title, void (*fn)(int, void*))
+{
+	printf("%s:\n", title);
+	for (int threads=1 ; threads<=MAX_THREADS ; threads*=2)
+	{
+		double time = benchmark_run_threads(threads, fn, NULL);
+		printf("%3d threads: %8.2f M operations/s\n", threads,
+		       threads * operations / time / 1e6);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	benchmark_init(argc, argv);
+	operations = benchmark_iterations(1000000);
+
+	for (int i=0 ; i<OBJECTS ; i++)
+	{
+		objects[i] = benchmark_new_test();
+	}
+	for (int t=0 ; t<MAX_THREADS ; t++)
+	{
+		for (int w=0 ; w<WEAKS_PER_THREAD ; w++)
+		{
+			targets[t][w] = (t * WEAKS_PER_THREAD + w) % OBJECTS;
+			objc_initWeak(&weaks[t][w], objects[targets[t][w]]);
+		}
+	}
+	run("weak loads with a store every 16 operations", load_and_store);
+
+	for (int t=0 ; t<MAX_THREADS ; t++)
+	{
+		objc_storeWeak(&weaks[t][0], objects[0]);
+		targets[t][0] = 0;
+	}
+	run("weak loads of one object", load_same_object);
+
+	// Moving a weak reference must keep it registered, so that it is still
+	// zeroed when the object is deallocated.
+	id moved;
+	objc_moveWeak(&moved, &weaks[0][1]);
+	benchmark_check(nil == weaks[0][1]);
+	for (int i=0 ; i<OBJECTS ; i++)
+	{
+		objc_release(objects[i]);
+	}
+	benchmark_check(nil == objc_loadWeakRetained(&moved));
+	for (int t=0 ; t<MAX_THREADS ; t++)
+	{
+		for (int w=0 ; w<WEAKS_PER_THREAD ; w++)
+		{
+			benchmark_check(nil == objc_loadWeakRetained(&weaks[t][w]));
+			objc_destroyWeak(&weaks[t][w]);
+		}
+	}
+	return 0;
+}
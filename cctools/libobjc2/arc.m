@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #import "stdio.h"
 #import "objc/runtime.h"
@@ -52,10 +53,34 @@ struct arc_autorelease_pool
 	id pool[POOL_SIZE];
 };
 
+/**
+ * The number of empty pool pages that each thread keeps for reuse, rather than
+ * returning them to malloc when a pool is popped.
+ */
+#define POOL_PAGE_CACHE_SIZE 4
+
+/**
+ * The number of objects taken from the pool and released together when a
+ * pool is popped.
+ */
+#define POOL_RELEASE_BATCH 64
+
 struct arc_tls
 {
 	struct arc_autorelease_pool *pool;
 	id returnRetained;
+	/**
+	 * Empty pages ready for reuse, linked through their previous pointers.
+	 */
+	struct arc_autorelease_pool *freePages;
+	/**
+	 * The number of pages in freePages.
+	 */
+	unsigned freePageCount;
+	/**
+	 * Statistics for this thread, returned by objc_arc_autorelease_stats_np().
+	 */
+	struct objc_arc_autorelease_stats_np stats;
 };
 
 static inline struct arc_tls* getARCThreadData(void)
@@ -76,6 +101,149 @@ int count = 0;
 int poolCount = 0;
 static inline void release(id obj);
 
+/**
+ * Returns an empty pool page, taken from the thread's cache if there is one,
+ * and pushes it on top of the thread's pool stack.
+ */
+static struct arc_autorelease_pool *pushPoolPage(struct arc_tls *tls)
+{
+	struct arc_autorelease_pool *pool = tls->freePages;
+	if (NULL != pool)
+	{
+		tls->freePages = pool->previous;
+		tls->freePageCount--;
+		tls->stats.pagesReused++;
+	}
+	else
+	{
+		pool = calloc(sizeof(struct arc_autorelease_pool), 1);
+		tls->stats.pagesAllocated++;
+	}
+	pool->previous = tls->pool;
+	pool->insert = pool->pool;
+	tls->pool = pool;
+	return pool;
+}
+
+/**
+ * Pops the top page from the thread's pool stack, which must be empty, and
+ * returns it to the cache, or frees it if the cache is full.
+ */
+static void popPoolPage(struct arc_tls *tls)
+{
+	struct arc_autorelease_pool *pool = tls->pool;
+	tls->pool = pool->previous;
+	if (tls->freePageCount < POOL_PAGE_CACHE_SIZE)
+	{
+		pool->previous = tls->freePages;
+		tls->freePages = pool;
+		tls->freePageCount++;
+		return;
+	}
+	free(pool);
+	tls->stats.pagesFreed++;
+}
+
+/**
+ * Releases objects that have been removed from the autorelease pool, in
+ * order.  Autoreleased objects tend to come in runs of the same class, so the
+ * release path for each class is looked up once per run, and the next object
+ * is prefetched while the current one is released.
+ */
+static void releaseBatch(id *objs, unsigned n)
+{
+	Class runClass = Nil;
+	BOOL fastARC = NO;
+	IMP releaseIMP = 0;
+	for (unsigned i=0 ; i<n ; i++)
+	{
+		id obj = objs[i];
+		if ((i + 1 < n) && !isSmallObject(objs[i+1]))
+		{
+			__builtin_prefetch(objs[i+1]);
+		}
+		if (isSmallObject(obj)) { continue; }
+		Class cls = obj->isa;
+		if (cls != runClass)
+		{
+			runClass = cls;
+			releaseIMP = 0;
+			fastARC = NO;
+			if ((cls != (Class)&_NSConcreteMallocBlock) &&
+			    (cls != (Class)&_NSConcreteStackBlock) &&
+			    (cls != (Class)&_NSConcreteGlobalBlock))
+			{
+				fastARC = objc_test_class_flag(cls, objc_class_flag_fast_arc);
+				if (!fastARC)
+				{
+					releaseIMP = class_getMethodImplementation(cls, SELECTOR(release));
+				}
+			}
+		}
+		if (fastARC)
+		{
+			intptr_t *refCount = ((intptr_t*)obj) - 1;
+			if (__sync_sub_and_fetch(refCount, 1) == -1)
+			{
+				objc_delete_weak_refs(obj);
+				[obj dealloc];
+			}
+		}
+		else if (0 != releaseIMP)
+		{
+			releaseIMP(obj, SELECTOR(release));
+		}
+		else
+		{
+			release(obj);
+		}
+	}
+}
+
+/**
+ * Removes objects from the top of the current pool page, down to stop, in
+ * batches and releases them.  Releasing an object may autorelease others, so
+ * each batch is taken out of the page before any of it is released and the
+ * insert point is rechecked afterwards.
+ */
+static void drainPoolPage(struct arc_tls *tls, id *stop)
+{
+	id batch[POOL_RELEASE_BATCH];
+	struct arc_autorelease_pool *pool = tls->pool;
+	if ((NULL == stop) || (stop < pool->pool))
+	{
+		stop = pool->pool;
+	}
+	while (1)
+	{
+		// The releases may have autoreleased enough to fill this page and
+		// push new ones above it.
+		while (tls->pool != pool)
+		{
+			drainPoolPage(tls, NULL);
+			popPoolPage(tls);
+		}
+		if (pool->insert <= stop)
+		{
+			break;
+		}
+		unsigned n = pool->insert - stop;
+		if (n > POOL_RELEASE_BATCH)
+		{
+			n = POOL_RELEASE_BATCH;
+		}
+		for (unsigned i=0 ; i<n ; i++)
+		{
+			pool->insert--;
+			batch[i] = *pool->insert;
+		}
+		count -= n;
+		tls->stats.objectsReleased += n;
+		tls->stats.releaseBatches++;
+		releaseBatch(batch, n);
+	}
+}
+
 /**
  * Empties objects from the autorelease pool, stating at the head of the list
  * specified by pool and continuing until it reaches the stop point.  If the stop point is NULL then 
@@ -108,27 +276,14 @@ static void emptyPool(struct arc_tls *tls, id *stop)
 	}
 	while (tls->pool != stopPool)
 	{
-		while (tls->pool->insert > tls->pool->pool)
-		{
-			tls->pool->insert--;
-			// This may autorelease some other objects, so we have to work in
-			// the case where the autorelease pool is extended during a -release.
-			release(*tls->pool->insert);
-			count--;
-		}
-		void *old = tls->pool;
-		tls->pool = tls->pool->previous;
-		free(old);
+		// This may autorelease some other objects, so we have to work in the
+		// case where the autorelease pool is extended during a -release.
+		drainPoolPage(tls, NULL);
+		popPoolPage(tls);
 	}
 	if (NULL != tls->pool)
 	{
-		while ((stop == NULL || (tls->pool->insert > stop)) &&
-		       (tls->pool->insert > tls->pool->pool))
-		{
-			tls->pool->insert--;
-			count--;
-			release(*tls->pool->insert);
-		}
+		drainPoolPage(tls, stop);
 	}
 	//fprintf(stderr, "New insert: %p.  Stop: %p\n", tls->pool->insert, stop);
 }
@@ -148,6 +303,13 @@ static void cleanupPools(struct arc_tls* tls)
 	if (tls->returnRetained)
 	{
 		cleanupPools(tls);
+		return;
+	}
+	while (NULL != tls->freePages)
+	{
+		struct arc_autorelease_pool *pool = tls->freePages;
+		tls->freePages = pool->previous;
+		free(pool);
 	}
 	free(tls);
 }
@@ -255,10 +417,7 @@ static inline id autorelease(id obj)
 			struct arc_autorelease_pool *pool = tls->pool;
 			if (NULL == pool || (pool->insert >= &pool->pool[POOL_SIZE]))
 			{
-				pool = calloc(sizeof(struct arc_autorelease_pool), 1);
-				pool->previous = tls->pool;
-				pool->insert = pool->pool;
-				tls->pool = pool;
+				pool = pushPoolPage(tls);
 			}
 			count++;
 			*pool->insert = obj;
@@ -292,6 +451,26 @@ unsigned long objc_arc_autorelease_count_np(void)
 	}
 	return count;
 }
+void objc_arc_autorelease_stats_np(struct objc_arc_autorelease_stats_np *stats)
+{
+	struct arc_tls* tls = getARCThreadData();
+	if (!tls)
+	{
+		memset(stats, 0, sizeof(struct objc_arc_autorelease_stats_np));
+		return;
+	}
+	*stats = tls->stats;
+	stats->objects = 0;
+	stats->pages = 0;
+	for (struct arc_autorelease_pool *pool=tls->pool ;
+	     NULL != pool ;
+	     pool = pool->previous)
+	{
+		stats->objects += (((intptr_t)pool->insert) - ((intptr_t)pool->pool)) / sizeof(id);
+		stats->pages++;
+	}
+	stats->cachedPages = tls->freePageCount;
+}
 unsigned long objc_arc_autorelease_count_for_object_np(id obj)
 {
 	struct arc_tls* tls = getARCThreadData();
@@ -333,10 +512,7 @@ void *objc_autoreleasePoolPush(void)
 			struct arc_autorelease_pool *pool = tls->pool;
 			if (NULL == pool || (pool->insert >= &pool->pool[POOL_SIZE]))
 			{
-				pool = calloc(sizeof(struct arc_autorelease_pool), 1);
-				pool->previous = tls->pool;
-				pool->insert = pool->pool;
-				tls->pool = pool;
+				pool = pushPoolPage(tls);
 			}
 			// If there is no autorelease pool allocated for this thread, then
 			// we lazily allocate one the first time something is autoreleased.
@@ -509,13 +685,85 @@ const static WeakRef NullWeakRef;
 
 #include "hash_table.h"
 
-static weak_ref_table *weakRefs;
-mutex_t weakRefLock;
+/**
+ * The weak reference table is split into stripes, each with its own lock and
+ * hash table, so that threads using weak references to different objects do
+ * not contend on one lock.  The entry for an object, and every weak reference
+ * to it, is protected by the lock of the stripe selected by the object's
+ * address.
+ */
+#define WEAK_REF_STRIPES 64
+static struct weak_ref_stripe
+{
+	mutex_t lock;
+	weak_ref_table *table;
+} __attribute__((aligned(64))) weakRefStripes[WEAK_REF_STRIPES];
+
+static inline struct weak_ref_stripe *stripeForObject(id obj)
+{
+	// The tables index with the low bits of ptr_hash(), so pick the stripe
+	// with the high bits of a multiplicative hash, or all of the objects in a
+	// stripe would land in the same few cells of its table.
+	uint64_t hash = ((uint64_t)(uintptr_t)obj >> 4) * 0x9E3779B97F4A7C15ULL;
+	return &weakRefStripes[hash >> 58];
+}
+
+/**
+ * Locks the stripes for two objects, in address order so that two threads
+ * locking the same pair can not deadlock.
+ */
+static void lockStripes(struct weak_ref_stripe *a, struct weak_ref_stripe *b)
+{
+	if (a == b)
+	{
+		LOCK(&a->lock);
+		return;
+	}
+	if (a > b)
+	{
+		struct weak_ref_stripe *tmp = a;
+		a = b;
+		b = tmp;
+	}
+	LOCK(&a->lock);
+	LOCK(&b->lock);
+}
+
+static void unlockStripes(struct weak_ref_stripe *a, struct weak_ref_stripe *b)
+{
+	UNLOCK(&a->lock);
+	if (a != b)
+	{
+		UNLOCK(&b->lock);
+	}
+}
+
+/**
+ * Locks the stripe for the object stored in a weak reference, which may be
+ * changed by another thread until the lock is held.  Returns the object.
+ */
+static id lockStripeForWeakRef(id *addr, struct weak_ref_stripe **stripe)
+{
+	while (1)
+	{
+		id obj = *addr;
+		*stripe = stripeForObject(obj);
+		LOCK(&(*stripe)->lock);
+		if (obj == *addr)
+		{
+			return obj;
+		}
+		UNLOCK(&(*stripe)->lock);
+	}
+}
 
 PRIVATE void init_arc(void)
 {
-	weak_ref_initialize(&weakRefs, 128);
-	INIT_LOCK(weakRefLock);
+	for (int i=0 ; i<WEAK_REF_STRIPES ; i++)
+	{
+		weak_ref_initialize(&weakRefStripes[i].table, 16);
+		INIT_LOCK(weakRefStripes[i].lock);
+	}
 #ifndef NO_PTHREADS
 	pthread_key_create(&ARCThreadKey, (void(*)(void*))cleanupPools);
 #endif
@@ -523,18 +771,17 @@ PRIVATE void init_arc(void)
 
 void* block_load_weak(void *block);
 
-id objc_storeWeak(id *addr, id obj)
+/**
+ * Stores obj in the weak reference at addr.  Must be called with the stripes
+ * for obj and for the old value at addr locked.
+ */
+static id storeWeakLocked(id *addr, id old, id obj,
+                          struct weak_ref_stripe *oldStripe,
+                          struct weak_ref_stripe *stripe)
 {
-	id old = *addr;
-	intptr_t *refCount = ((intptr_t*)obj) - 1;
-	if (obj && *refCount < 0)
-	{
-		obj = nil;
-	}
-	LOCK_FOR_SCOPE(&weakRefLock);
 	if (nil != old)
 	{
-		WeakRef *oldRef = weak_ref_table_get(weakRefs, old);
+		WeakRef *oldRef = weak_ref_table_get(oldStripe->table, old);
 		while (NULL != oldRef)
 		{
 			for (int i=0 ; i<4 ; i++)
@@ -581,7 +828,7 @@ id objc_storeWeak(id *addr, id obj)
 	}
 	if (nil != obj)
 	{
-		WeakRef *ref = weak_ref_table_get(weakRefs, obj);
+		WeakRef *ref = weak_ref_table_get(stripe->table, obj);
 		while (NULL != ref)
 		{
 			for (int i=0 ; i<4 ; i++)
@@ -609,13 +856,38 @@ id objc_storeWeak(id *addr, id obj)
 			WeakRef newRef = {0};
 			newRef.obj = obj;
 			newRef.ref[0] = addr;
-			weak_ref_insert(weakRefs, newRef);
+			weak_ref_insert(stripe->table, newRef);
 		}
 	}
 	*addr = obj;
 	return obj;
 }
 
+id objc_storeWeak(id *addr, id obj)
+{
+	intptr_t *refCount = ((intptr_t*)obj) - 1;
+	if (obj && *refCount < 0)
+	{
+		obj = nil;
+	}
+	struct weak_ref_stripe *stripe = stripeForObject(obj);
+	while (1)
+	{
+		id old = *addr;
+		struct weak_ref_stripe *oldStripe = stripeForObject(old);
+		lockStripes(oldStripe, stripe);
+		// Another thread may have stored to this weak reference before we
+		// got the lock for the old value.
+		if (old == *addr)
+		{
+			obj = storeWeakLocked(addr, old, obj, oldStripe, stripe);
+			unlockStripes(oldStripe, stripe);
+			return obj;
+		}
+		unlockStripes(oldStripe, stripe);
+	}
+}
+
 static void zeroRefs(WeakRef *ref, BOOL shouldFree)
 {
 	if (NULL != ref->next)
@@ -637,20 +909,25 @@ static void zeroRefs(WeakRef *ref, BOOL shouldFree)
 
 void objc_delete_weak_refs(id obj)
 {
-	LOCK_FOR_SCOPE(&weakRefLock);
-	WeakRef *oldRef = weak_ref_table_get(weakRefs, obj);
+	struct weak_ref_stripe *stripe = stripeForObject(obj);
+	LOCK_FOR_SCOPE(&stripe->lock);
+	WeakRef *oldRef = weak_ref_table_get(stripe->table, obj);
 	if (0 != oldRef)
 	{
 		zeroRefs(oldRef, NO);
-		weak_ref_remove(weakRefs, obj);
+		weak_ref_remove(stripe->table, obj);
 	}
 }
 
 id objc_loadWeakRetained(id* addr)
 {
-	LOCK_FOR_SCOPE(&weakRefLock);
-	id obj = *addr;
-	if (nil == obj) { return nil; }
+	struct weak_ref_stripe *stripe;
+	id obj = lockStripeForWeakRef(addr, &stripe);
+	if (nil == obj)
+	{
+		UNLOCK(&stripe->lock);
+		return nil;
+	}
 	Class cls = classForObject(obj);
 	if ((Class)&_NSConcreteMallocBlock == cls) // cctools-port: added (Class)
 	{
@@ -660,14 +937,18 @@ id objc_loadWeakRetained(id* addr)
 	{
 		if ((*(((intptr_t*)obj) - 1)) < 0)
 		{
-			return nil;
+			obj = nil;
 		}
 	}
 	else
 	{
 		obj = _objc_weak_load(obj);
 	}
-	return objc_retain(obj);
+	// Retain before dropping the lock, or the object could be deallocated by
+	// another thread in between.
+	obj = objc_retain(obj);
+	UNLOCK(&stripe->lock);
+	return obj;
 }
 
 id objc_loadWeak(id* object)
@@ -685,10 +966,11 @@ void objc_moveWeak(id *dest, id *src)
 	// Don't retain or release.  While the weak ref lock is held, we know that
 	// the object can't be deallocated, so we just move the value and update
 	// the weak reference table entry to indicate the new address.
-	LOCK_FOR_SCOPE(&weakRefLock);
-	*dest = *src;
+	struct weak_ref_stripe *stripe;
+	id obj = lockStripeForWeakRef(src, &stripe);
+	*dest = obj;
 	*src = nil;
-	WeakRef *oldRef = weak_ref_table_get(weakRefs, *dest);
+	WeakRef *oldRef = weak_ref_table_get(stripe->table, obj);
 	while (NULL != oldRef)
 	{
 		for (int i=0 ; i<4 ; i++)
@@ -696,10 +978,13 @@ void objc_moveWeak(id *dest, id *src)
 			if (oldRef->ref[i] == src)
 			{
 				oldRef->ref[i] = dest;
+				UNLOCK(&stripe->lock);
 				return;
 			}
 		}
+		oldRef = oldRef->next;
 	}
+	UNLOCK(&stripe->lock);
 }
 
 void objc_destroyWeak(id* obj)
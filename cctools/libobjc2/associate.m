@@ -49,8 +49,8 @@ struct reference_list
 	 */
 	struct reference_list *next;
 	/**
-	 * Mutex.  Only set for the first reference list in a chain.  Used for
-	 * @syncronize().
+	 * Mutex.  Only set for the first reference list in a chain.  No longer
+	 * used for @syncronize(), which uses the side table below.
 	 */
 	mutex_t lock;
 	/**
@@ -359,24 +359,219 @@ PRIVATE void gc_setTypeForClass(Class cls, void *type)
 	list->gc_type = type;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// @synchronized
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A recursive lock used for @synchronized on one object.  These live in a side
+ * table keyed by the object's address, so that synchronizing on an object
+ * never needs to give it a hidden class.  An entry whose users count has
+ * dropped to zero is not associated with any object any more and is reused
+ * for the next object that hashes to the same stripe, so the table only grows
+ * to the number of objects that are synchronized on at the same time.
+ */
+struct sync_data
+{
+	/**
+	 * The next entry in this stripe.
+	 */
+	struct sync_data *next;
+	/**
+	 * The object that this lock is for.
+	 */
+	id object;
+	/**
+	 * The number of threads holding or waiting for this lock.  Protected by
+	 * the stripe's spinlock.
+	 */
+	int users;
+	/**
+	 * The lock.
+	 */
+	mutex_t lock;
+};
+
+#define SYNC_STRIPES 64
+
+/**
+ * The side table.  Each stripe is a list of entries protected by a spinlock,
+ * which is only held while finding an entry, never while waiting for the
+ * entry's lock.
+ */
+static struct sync_stripe
+{
+	volatile int lock;
+	struct sync_data *list;
+} __attribute__((aligned(64))) sync_stripes[SYNC_STRIPES];
+
+static inline struct sync_stripe *sync_stripe_for_object(id object)
+{
+	uintptr_t hash = (uintptr_t)object;
+	hash = (hash >> 4) ^ (hash >> 10);
+	return &sync_stripes[hash % SYNC_STRIPES];
+}
+
+/**
+ * An entry in a thread's list of the @synchronized locks that it holds.
+ */
+struct sync_held
+{
+	struct sync_data *data;
+	/**
+	 * The number of times the thread has entered this lock.  The entry's mutex
+	 * is only locked for the first one.
+	 */
+	unsigned count;
+};
+
+/**
+ * The locks held by a thread.  Recursive @synchronized on the same object,
+ * and exiting it, only need to look here.
+ */
+struct sync_cache
+{
+	unsigned used;
+	unsigned size;
+	struct sync_held *held;
+};
+
+#ifdef NO_PTHREADS
+static __thread struct sync_cache sync_thread_cache;
+#else
+static pthread_key_t sync_cache_key;
+static void free_sync_cache(void *c)
+{
+	struct sync_cache *cache = c;
+	free(cache->held);
+	free(cache);
+}
+static void init_sync_cache_key(void)
+{
+	pthread_key_create(&sync_cache_key, free_sync_cache);
+}
+#endif
+
+static struct sync_cache *get_sync_cache(void)
+{
+#ifndef NO_PTHREADS
+	static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+	pthread_once(&once_control, init_sync_cache_key);
+	struct sync_cache *cache = pthread_getspecific(sync_cache_key);
+	if (NULL == cache)
+	{
+		cache = calloc(sizeof(struct sync_cache), 1);
+		pthread_setspecific(sync_cache_key, cache);
+	}
+	return cache;
+#else
+	return &sync_thread_cache;
+#endif
+}
+
+/**
+ * Returns the lock that this thread holds for object, or NULL if it does not
+ * hold one.  Searches from the most recently acquired lock, because
+ * @synchronized blocks nest.
+ */
+static struct sync_held *find_held_sync(struct sync_cache *cache, id object)
+{
+	for (unsigned i=cache->used ; i>0 ; i--)
+	{
+		if (cache->held[i-1].data->object == object)
+		{
+			return &cache->held[i-1];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns the side table entry for object, creating it or reusing an unused
+ * one if needed, and registers the caller as one of its users.
+ */
+static struct sync_data *acquire_sync_data(id object)
+{
+	struct sync_stripe *stripe = sync_stripe_for_object(object);
+	struct sync_data *unused = NULL;
+	lock_spinlock(&stripe->lock);
+	for (struct sync_data *data=stripe->list ; NULL != data ; data=data->next)
+	{
+		if (data->object == object)
+		{
+			data->users++;
+			unlock_spinlock(&stripe->lock);
+			return data;
+		}
+		if ((0 == data->users) && (NULL == unused))
+		{
+			unused = data;
+		}
+	}
+	if (NULL == unused)
+	{
+		unused = calloc(sizeof(struct sync_data), 1);
+		INIT_LOCK(unused->lock);
+		unused->next = stripe->list;
+		stripe->list = unused;
+	}
+	unused->object = object;
+	unused->users = 1;
+	unlock_spinlock(&stripe->lock);
+	return unused;
+}
+
+static void relinquish_sync_data(struct sync_data *data)
+{
+	struct sync_stripe *stripe = sync_stripe_for_object(data->object);
+	lock_spinlock(&stripe->lock);
+	data->users--;
+	unlock_spinlock(&stripe->lock);
+}
+
 int objc_sync_enter(id object)
 {
 	if ((object == 0) || isSmallObject(object)) { return 0; }
-	struct reference_list *list = referenceListForObject(object, YES);
-	LOCK(&list->lock);
+	struct sync_cache *cache = get_sync_cache();
+	struct sync_held *held = find_held_sync(cache, object);
+	if (NULL != held)
+	{
+		held->count++;
+		return 0;
+	}
+	struct sync_data *data = acquire_sync_data(object);
+	LOCK(&data->lock);
+	if (cache->used == cache->size)
+	{
+		cache->size = (0 == cache->size) ? 8 : cache->size * 2;
+		cache->held = realloc(cache->held, cache->size * sizeof(struct sync_held));
+	}
+	cache->held[cache->used].data = data;
+	cache->held[cache->used].count = 1;
+	cache->used++;
 	return 0;
 }
 
 int objc_sync_exit(id object)
 {
 	if ((object == 0) || isSmallObject(object)) { return 0; }
-	struct reference_list *list = referenceListForObject(object, NO);
-	if (NULL != list)
+	struct sync_cache *cache = get_sync_cache();
+	struct sync_held *held = find_held_sync(cache, object);
+	if (NULL == held)
+	{
+		return 1;
+	}
+	if (0 != --held->count)
 	{
-		UNLOCK(&list->lock);
 		return 0;
 	}
-	return 1;
+	struct sync_data *data = held->data;
+	// Usually this is the innermost lock, but @synchronized blocks don't have
+	// to be exited in order if the caller uses these functions directly.
+	*held = cache->held[--cache->used];
+	UNLOCK(&data->lock);
+	relinquish_sync_data(data);
+	return 0;
 }
 
 static Class hiddenClassForObject(id object)
@@ -359,9 +359,98 @@ PRIVATE void free_dtable(dtable_t dtable)
 	free(dtable);
 }
 
+static size_t dtable_memory_usage(dtable_t dtable, size_t *shared)
+{
+	*shared = 0;
+	return sizeof(struct objc_dtable) +
+	       dtable->slot_size * sizeof(struct objc_slot*);
+}
+
 #else
 
 
+#ifdef OBJC_METHOD_CACHE
+/**
+ * Attaches an empty method cache to a newly created dtable.
+ */
+static void add_method_cache(dtable_t dtable)
+{
+	struct objc_method_cache *cache = calloc(1, sizeof(struct objc_method_cache));
+	for (int i=0 ; i<METHOD_CACHE_SIZE ; i++)
+	{
+		cache->lines[i].idx = METHOD_CACHE_INVALID;
+	}
+	dtable->cache = cache;
+}
+
+/**
+ * Tries to take a method cache line for writing.  Returns the line's sequence
+ * number before it was taken, or an odd value if another thread holds it.
+ */
+static inline uint32_t lock_method_cache_line(struct method_cache_line *line)
+{
+	uint32_t seq = line->seq;
+	if ((seq & 1) || !__sync_bool_compare_and_swap(&line->seq, seq, seq+1))
+	{
+		return 1;
+	}
+	return seq;
+}
+
+/**
+ * Releases a method cache line taken by lock_method_cache_line().
+ */
+static inline void unlock_method_cache_line(struct method_cache_line *line,
+                                            uint32_t seq)
+{
+	__atomic_store_n(&line->seq, seq+2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Empties the method cache of a dtable.  Must be called whenever a slot in the
+ * dtable is replaced.
+ */
+static void flush_method_cache(dtable_t dtable)
+{
+	struct objc_method_cache *cache = dtable->cache;
+	if (NULL == cache) { return; }
+	__sync_fetch_and_add(&cache->generation, 1);
+	for (int i=0 ; i<METHOD_CACHE_SIZE ; i++)
+	{
+		struct method_cache_line *line = &cache->lines[i];
+		uint32_t seq;
+		// Lines are only held for a few instructions, so spin.
+		while ((seq = lock_method_cache_line(line)) & 1) {}
+		line->idx = METHOD_CACHE_INVALID;
+		unlock_method_cache_line(line, seq);
+	}
+}
+
+PRIVATE void objc_method_cache_fill(dtable_t dtable, uint32_t uid,
+                                    struct objc_slot *slot, uint32_t generation)
+{
+	struct objc_method_cache *cache = dtable->cache;
+	if ((NULL == cache) || (dtable == uninstalled_dtable)) { return; }
+	struct method_cache_line *line = &cache->lines[uid & (METHOD_CACHE_SIZE-1)];
+	uint32_t seq = lock_method_cache_line(line);
+	// Another thread is filling or flushing this line.  The cache is only a
+	// hint, so don't wait for it.
+	if (seq & 1) { return; }
+	// A flush that started after the slot was looked up may already have
+	// passed this line, in which case the slot may be stale.  A flush that
+	// has not reached the line yet will wait for it and then clear it.
+	if (cache->generation == generation)
+	{
+		line->idx = uid;
+		line->slot = slot;
+	}
+	unlock_method_cache_line(line, seq);
+}
+#else
+#	define add_method_cache(dtable)
+#	define flush_method_cache(dtable)
+#endif
+
 PRIVATE void init_dispatch_tables ()
 {
 	INIT_LOCK(initialize_lock);
@@ -517,6 +606,9 @@ static void installMethodsInClass(Class cls,
 			SparseArrayInsert(methods, idx, 0);
 		}
 	}
+	// This is reached for the class and each of its subclasses from
+	// objc_update_dtable_for_class() and add_method_list_to_class().
+	flush_method_cache(dtable);
 }
 
 static void mergeMethodsFromSuperclass(Class super, Class cls, SparseArray *methods)
@@ -626,6 +718,7 @@ static dtable_t create_dtable_for_class(Class class, dtable_t root_dtable)
 		}
 		list = list->next;
 	}
+	add_method_cache(dtable);
 
 	return dtable;
 }
@@ -667,16 +760,85 @@ PRIVATE void objc_resize_dtables(uint32_t newSize)
 
 PRIVATE dtable_t objc_copy_dtable_for_class(dtable_t old, Class cls)
 {
-	return SparseArrayCopy(old);
+	dtable_t dtable = SparseArrayCopy(old);
+	add_method_cache(dtable);
+	return dtable;
 }
 
 PRIVATE void free_dtable(dtable_t dtable)
 {
+#ifdef OBJC_METHOD_CACHE
+	free(dtable->cache);
+#endif
 	SparseArrayDestroy(dtable);
 }
 
+static size_t dtable_memory_usage(dtable_t dtable, size_t *shared)
+{
+	size_t size = SparseArrayMemoryUsage(dtable, shared);
+#ifdef OBJC_METHOD_CACHE
+	if (NULL != dtable->cache)
+	{
+		size += sizeof(struct objc_method_cache);
+	}
+#endif
+	return size;
+}
+
 #endif // __OBJC_LOW_MEMORY__
 
+Class class_table_next(void **e);
+
+size_t class_getDtableSize_np(Class cls, size_t *shared)
+{
+	size_t ignored;
+	if (NULL == shared)
+	{
+		shared = &ignored;
+	}
+	*shared = 0;
+	if (Nil == cls) { return 0; }
+
+	LOCK_RUNTIME_FOR_SCOPE();
+	dtable_t dtable = dtable_for_class(cls);
+	if ((NULL == dtable) || (uninstalled_dtable == dtable)) { return 0; }
+	return dtable_memory_usage(dtable, shared);
+}
+
+PRIVATE void log_dtable_memory_usage(void)
+{
+	size_t total = 0;
+	size_t totalShared = 0;
+	size_t largest = 0;
+	Class largestClass = Nil;
+	int classes = 0;
+	void *e = NULL;
+	struct objc_class *next;
+	while ((next = class_table_next(&e)))
+	{
+		size_t shared, metaShared;
+		size_t size = class_getDtableSize_np(next, &shared);
+		size_t metaSize = class_getDtableSize_np(next->isa, &metaShared);
+		if (0 == size + metaSize) { continue; }
+		classes++;
+		total += size + metaSize;
+		totalShared += shared + metaShared;
+		if (size + metaSize > largest)
+		{
+			largest = size + metaSize;
+			largestClass = next;
+		}
+	}
+	fprintf(stderr, "%zu bytes in dtables for %d classes (%zu bytes in nodes "
+	        "shared between classes, counted once per class).\n",
+	        total, classes, totalShared);
+	if (Nil != largestClass)
+	{
+		fprintf(stderr, "Largest dtable: %s, %zu bytes.\n",
+		        largestClass->name, largest);
+	}
+}
+
 LEGACY void update_dispatch_table_for_class(Class cls)
 {
 	static BOOL warned = NO;
@@ -14,6 +14,84 @@ typedef SparseArray* dtable_t;
 #	define objc_dtable_lookup SparseArrayLookup
 #endif
 
+// The low-memory dtables have their own cache.
+#ifdef __OBJC_LOW_MEMORY__
+#	undef OBJC_METHOD_CACHE
+#endif
+
+#ifdef OBJC_METHOD_CACHE
+/**
+ * Number of lines in a method cache.  Must be a power of two.
+ */
+#define METHOD_CACHE_SIZE 32
+/**
+ * Selector index used to mark an empty cache line.
+ */
+#define METHOD_CACHE_INVALID ((uint32_t)-1)
+/**
+ * Small direct-mapped cache from selector index to slot, attached to each
+ * installed dtable.  Looking up a slot here is a fixed number of loads, rather
+ * than one per level of the sparse array.  The x86-64 objc_msgSend() reads and
+ * fills the cache directly, so the layout of this structure must match the
+ * offsets in objc_msgSend.x86-64.S.
+ */
+struct objc_method_cache
+{
+	/**
+	 * Incremented whenever the cache is flushed.  A slot found in the dtable
+	 * is only added to the cache if no flush happened after the generation was
+	 * read, so a stale slot can never be cached.
+	 */
+	volatile uint32_t generation;
+	struct method_cache_line
+	{
+		/**
+		 * Sequence number for the line.  A writer makes it odd before
+		 * changing the index and slot and even again afterwards, so a reader
+		 * that sees the same even value before and after reading them has
+		 * read a pair that was written together.
+		 */
+		volatile uint32_t seq;
+		volatile uint32_t idx;
+		struct objc_slot *volatile slot;
+	} lines[METHOD_CACHE_SIZE];
+};
+
+/**
+ * Returns the slot for the selector index uid if it is in the dtable's method
+ * cache, or NULL otherwise.
+ */
+static inline struct objc_slot *objc_method_cache_lookup(dtable_t dtable,
+                                                         uint32_t uid)
+{
+	struct objc_method_cache *cache = dtable->cache;
+	if (NULL == cache) { return NULL; }
+	struct method_cache_line *line = &cache->lines[uid & (METHOD_CACHE_SIZE-1)];
+	uint32_t seq = __atomic_load_n(&line->seq, __ATOMIC_ACQUIRE);
+	uint32_t idx = line->idx;
+	struct objc_slot *slot = line->slot;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if ((seq & 1) || (idx != uid) || (line->seq != seq)) { return NULL; }
+	return slot;
+}
+/**
+ * Returns the generation of the dtable's method cache.  Must be read before
+ * looking up the slot that is passed to objc_method_cache_fill().
+ */
+static inline uint32_t objc_method_cache_generation(dtable_t dtable)
+{
+	struct objc_method_cache *cache = dtable->cache;
+	return (NULL == cache) ? 0 :
+		__atomic_load_n(&cache->generation, __ATOMIC_ACQUIRE);
+}
+/**
+ * Adds a slot found in the dtable to its method cache.  Does nothing if
+ * another thread is writing the same cache line.
+ */
+void objc_method_cache_fill(dtable_t dtable, uint32_t uid,
+                            struct objc_slot *slot, uint32_t generation);
+#endif
+
 /**
  * Pointer to the sparse array representing the pretend (uninstalled) dtable.
  */
@@ -177,8 +177,13 @@ static int PREFIX(_table_resize)(PREFIX(_table) *table)
 	memcpy(copy, table, sizeof(PREFIX(_table)));
 	table->old = copy;
 
+	// Lookups that do not hold the lock must see the copy before the new
+	// array, and the new array before its size, which would index past the
+	// end of the old one.
+	__sync_synchronize();
 	// Now we make the original table structure point to the new (empty) array.
 	table->table = newArray;
+	__sync_synchronize();
 	table->table_size *= 2;
 	// The table currently has no entries; the copy has them all.
 	table->table_used = 0;
@@ -216,7 +221,13 @@ struct PREFIX(_table_enumerator)
 static inline PREFIX(_table_cell) PREFIX(_table_lookup)(PREFIX(_table) *table, 
                                                         uint32_t hash)
 {
+#ifdef MAP_TABLE_STATIC_SIZE
 	hash = hash % TABLE_SIZE(table);
+#else
+	// Read the size before the array, the resize stores them in the opposite
+	// order.
+	hash = hash % __atomic_load_n(&table->table_size, __ATOMIC_ACQUIRE);
+#endif
 	return &table->table[hash];
 }
 
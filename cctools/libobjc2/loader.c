@@ -28,10 +28,12 @@ void init_trampolines(void);
 void objc_send_load_message(Class class);
 
 void log_selector_memory_usage(void);
+void log_dtable_memory_usage(void);
 
 static void log_memory_stats(void)
 {
 	log_selector_memory_usage();
+	log_dtable_memory_usage();
 }
 
 /* Number of threads that are alive.  */
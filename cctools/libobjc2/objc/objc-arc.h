@@ -106,5 +106,31 @@ unsigned long objc_arc_autorelease_count_np(void);
  * this thread.
  */
 unsigned long objc_arc_autorelease_count_for_object_np(id);
+/**
+ * Statistics for the ARC-managed autorelease pool of the calling thread.
+ */
+struct objc_arc_autorelease_stats_np
+{
+	/** The number of objects currently in the pool. */
+	unsigned long objects;
+	/** The number of pages currently holding the pool. */
+	unsigned long pages;
+	/** The number of empty pages kept for reuse. */
+	unsigned long cachedPages;
+	/** The number of pages allocated with malloc. */
+	unsigned long pagesAllocated;
+	/** The number of pages taken from the cache instead of malloc. */
+	unsigned long pagesReused;
+	/** The number of pages returned to malloc. */
+	unsigned long pagesFreed;
+	/** The number of objects released by popping pools. */
+	unsigned long objectsReleased;
+	/** The number of batches those objects were released in. */
+	unsigned long releaseBatches;
+};
+/**
+ * Fills in stats for the ARC-managed autorelease pool in this thread.
+ */
+void objc_arc_autorelease_stats_np(struct objc_arc_autorelease_stats_np *stats);
 #endif // __OBJC_ARC_INCLUDED__
 
@@ -961,6 +961,14 @@ BOOL object_addMethod_np(id object, SEL name, IMP imp, const char *types);
  */
 IMP object_replaceMethod_np(id object, SEL name, IMP imp, const char *types);
 
+/**
+ * Returns the number of bytes used by the dispatch table of a class, or 0 if
+ * the class has not yet been sent a message.  Dispatch tables share unmodified
+ * parts with their superclass.  If shared is not NULL, it is set to the number
+ * of the returned bytes that may also be shared by other classes.
+ */
+size_t class_getDtableSize_np(Class cls, size_t *shared) OBJC_NONPORTABLE;
+
 /**
  * Creates a clone, in the JavaScript sense - an object which inherits both
  * associated references and methods from the original object.
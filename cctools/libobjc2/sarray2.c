@@ -158,6 +158,13 @@ PRIVATE void *SparseArrayNext(SparseArray * sarray, uint32_t * idx)
 
 PRIVATE void SparseArrayInsert(SparseArray * sarray, uint32_t index, void *value)
 {
+	// Don't copy or create nodes to store a value that is already there.
+	// Subclass dtables share their superclass's leaves until they are written
+	// to, and a leaf is 256 pointers.
+	if (SparseArrayLookup(sarray, index) == value)
+	{
+		return;
+	}
 	if (sarray->shift > 0)
 	{
 		uint32_t i = MASK_INDEX(index);
@@ -243,6 +250,48 @@ PRIVATE void SparseArrayDestroy(SparseArray * sarray)
 	free(sarray);
 }
 
+static int isEmptyArray(SparseArray *sarray)
+{
+	return (sarray == &EmptyArray) ||
+	       (sarray == &EmptyArray8) ||
+	       (sarray == &EmptyArray16) ||
+	       (sarray == &EmptyArray24);
+}
+
+static size_t SparseArrayNodeUsage(SparseArray *sarray, int isShared,
+                                   size_t *shared)
+{
+	if (isEmptyArray(sarray))
+	{
+		return 0;
+	}
+	isShared |= (sarray->refCount > 1);
+	size_t size = sizeof(SparseArray) + DATA_SIZE(sarray) * sizeof(void*);
+	if (isShared)
+	{
+		*shared += size;
+	}
+	if (sarray->shift > 0)
+	{
+		for (unsigned i=0 ; i<=MAX_INDEX(sarray) ; i++)
+		{
+			size += SparseArrayNodeUsage(sarray->data[i], isShared, shared);
+		}
+	}
+	return size;
+}
+
+PRIVATE size_t SparseArrayMemoryUsage(SparseArray *sarray, size_t *shared)
+{
+	size_t ignored = 0;
+	if (NULL == shared)
+	{
+		shared = &ignored;
+	}
+	*shared = 0;
+	return SparseArrayNodeUsage(sarray, 0, shared);
+}
+
 PRIVATE int SparseArraySize(SparseArray *sarray)
 {
 	int size = 0;
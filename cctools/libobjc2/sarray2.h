@@ -47,6 +47,16 @@ typedef struct
 	 * The data stored in this sparse array node.
 	 */
 	void ** data;
+#ifdef OBJC_METHOD_CACHE
+	/**
+	 * Extra data attached to a root node by its owner.  This is not copied by
+	 * SparseArrayCopy() and not freed by SparseArrayDestroy().  Dispatch
+	 * tables use it for the method cache.  This is after the data pointer so
+	 * that the offsets used by the assembly message send functions are
+	 * unchanged.
+	 */
+	void *cache;
+#endif
 } SparseArray;
 
 /**
@@ -141,4 +151,11 @@ SparseArray *SparseArrayCopy(SparseArray * sarray);
  */
 int SparseArraySize(SparseArray *sarray);
 
+/**
+ * Returns the number of bytes used by a sparse array, not counting the shared
+ * empty nodes.  If shared is not NULL, it is set to the number of those bytes
+ * that are in nodes shared with other (copy-on-write) sparse arrays.
+ */
+size_t SparseArrayMemoryUsage(SparseArray *sarray, size_t *shared);
+
 #endif //_SARRAY_H_INCLUDED_
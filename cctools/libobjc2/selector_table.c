@@ -215,8 +215,10 @@ static inline uint32_t hash_selector(const void *s)
 	return hash;
 }
 
+// The table is not MAP_TABLE_SINGLE_THREAD, so the cell arrays replaced when
+// it grows are never freed.  Lookups do not take any lock and may still be
+// walking an old array after the resize is finished.
 #define MAP_TABLE_NAME selector
-#define MAP_TABLE_SINGLE_THREAD
 #define MAP_TABLE_COMPARE_FUNCTION selector_identical
 #define MAP_TABLE_HASH_KEY hash_selector
 #define MAP_TABLE_HASH_VALUE hash_selector
@@ -227,7 +229,8 @@ static inline uint32_t hash_selector(const void *s)
 static selector_table *sel_table;
 
 /**
- * Lock protecting the selector table.
+ * Lock protecting the selector table.  This is only taken to insert
+ * selectors, lookups of existing selectors are lock free.
  */
 mutex_t selector_table_lock;
 
@@ -262,12 +265,32 @@ PRIVATE void init_selector_tables()
 	selector_initialize(&sel_table, 4096);
 }
 
-static SEL selector_lookup(const char *name, const char *types)
+/**
+ * Looks up a selector.  Must be called with the selector table locked.
+ */
+static SEL selector_lookup_locked(const char *name, const char *types)
 {
 	struct objc_selector sel = {{name}, types};
-	LOCK_FOR_SCOPE(&selector_table_lock);
 	return selector_table_get(sel_table, &sel);
 }
+/**
+ * Looks up a selector without taking the lock.  A concurrent insert may move
+ * the entry that we are looking for between cells (or into a new cell array
+ * when the table grows), so a lookup that races with it can miss.  Misses are
+ * therefore retried with the lock held, which is cheap because they are rare:
+ * almost all lookups are for selectors that are already registered.
+ */
+static SEL selector_lookup(const char *name, const char *types)
+{
+	struct objc_selector sel = {{name}, types};
+	SEL result = selector_table_get(sel_table, &sel);
+	if (NULL == result)
+	{
+		LOCK_FOR_SCOPE(&selector_table_lock);
+		result = selector_table_get(sel_table, &sel);
+	}
+	return result;
+}
 static inline void add_selector_to_table(SEL aSel, int32_t uid, uint32_t idx)
 {
 	DEBUG_LOG("Sel %s uid: %d, idx: %d, hash: %d\n", sel_getNameNonUnique(aSel), uid, idx, hash_selector(aSel));
@@ -277,6 +300,9 @@ static inline void add_selector_to_table(SEL aSel, int32_t uid, uint32_t idx)
 	typeList->next = 0;
 	// Store the name.
 	SparseArrayInsert(selector_list, idx, typeList);
+	// Lookups don't take the lock, so make sure that they can't find the
+	// selector before they can see its fields and its name in the list.
+	__sync_synchronize();
 	// Store the selector.
 	selector_insert(sel_table, aSel);
 	// Set the selector's name to the uid.
@@ -295,7 +321,7 @@ static inline void register_selector_locked(SEL aSel)
 		objc_resize_dtables(selector_count);
 		return;
 	}
-	SEL untyped = selector_lookup(aSel->name, 0);
+	SEL untyped = selector_lookup_locked(aSel->name, 0);
 	// If this has a type encoding, store the untyped version too.
 	if (untyped == NULL)
 	{
@@ -366,7 +392,7 @@ static SEL objc_register_selector_copy(SEL aSel, BOOL copyArgs)
 		return copy;
 	}
 	LOCK_FOR_SCOPE(&selector_table_lock);
-	copy = selector_lookup(aSel->name, aSel->types);
+	copy = selector_lookup_locked(aSel->name, aSel->types);
 	if (NULL != copy && selector_identical(aSel, copy))
 	{
 		return copy;
@@ -377,7 +403,7 @@ static SEL objc_register_selector_copy(SEL aSel, BOOL copyArgs)
 	copy->types = (NULL == aSel->types) ? NULL : aSel->types;
 	if (copyArgs)
 	{
-		SEL untyped = selector_lookup(aSel->name, 0);
+		SEL untyped = selector_lookup_locked(aSel->name, 0);
 		if (untyped != NULL)
 		{
 			copy->name = sel_getName(untyped);
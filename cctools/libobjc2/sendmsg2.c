@@ -65,7 +65,21 @@ Slot_t objc_msg_lookup_internal(id *receiver,
 {
 retry:;
 	Class class = classForObject((*receiver));
+#ifdef OBJC_METHOD_CACHE
+	Slot_t result = objc_method_cache_lookup(class->dtable, selector->index);
+	if (LIKELY(0 != result))
+	{
+		return result;
+	}
+	uint32_t generation = objc_method_cache_generation(class->dtable);
+	result = objc_dtable_lookup(class->dtable, selector->index);
+	if (0 != result)
+	{
+		objc_method_cache_fill(class->dtable, selector->index, result, generation);
+	}
+#else
 	Slot_t result = objc_dtable_lookup(class->dtable, selector->index);
+#endif
 	if (UNLIKELY(0 == result))
 	{
 		dtable_t dtable = dtable_for_class(class);
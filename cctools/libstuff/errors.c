@@ -33,6 +33,36 @@
 
 __private_extern__ uint32_t errors = 0;	/* number of calls to error() */
 
+/* where this thread's messages go, see errors.h */
+__private_extern__ __thread struct diagnostics *diagnostics = NULL;
+
+/*
+ * Return the stream this thread's messages are to be printed on.
+ */
+__private_extern__
+FILE *
+diagnostics_stream(
+void)
+{
+	if(diagnostics != NULL)
+	    return(diagnostics->stream);
+	return(stderr);
+}
+
+/*
+ * Count an error for this thread.
+ */
+__private_extern__
+void
+count_error(
+void)
+{
+	if(diagnostics != NULL)
+	    diagnostics->errors++;
+	else
+	    errors++;
+}
+
 /*
  * Just print the message in the standard format without setting an error.
  */
@@ -43,11 +73,13 @@ const char *format,
 ...)
 {
     va_list ap;
+    FILE *stream;
 
+	stream = diagnostics_stream();
 	va_start(ap, format);
-        fprintf(stderr, "warning: %s: ", progname);
-	vfprintf(stderr, format, ap);
-        fprintf(stderr, "\n");
+        fprintf(stream, "warning: %s: ", progname);
+	vfprintf(stream, format, ap);
+        fprintf(stream, "\n");
 	va_end(ap);
 }
 
@@ -62,13 +94,15 @@ const char *format,
 ...)
 {
     va_list ap;
+    FILE *stream;
 
+	stream = diagnostics_stream();
 	va_start(ap, format);
-        fprintf(stderr, "error: %s: ", progname);
-	vfprintf(stderr, format, ap);
-        fprintf(stderr, "\n");
+        fprintf(stream, "error: %s: ", progname);
+	vfprintf(stream, format, ap);
+        fprintf(stream, "\n");
 	va_end(ap);
-	errors++;
+	count_error();
 }
 
 /*
@@ -83,15 +117,17 @@ const char *format,
 ...)
 {
     va_list ap;
+    FILE *stream;
 
+	stream = diagnostics_stream();
 	va_start(ap, format);
-        fprintf(stderr, "error: %s: ", progname);
+        fprintf(stream, "error: %s: ", progname);
 	if(arch_name != NULL)
-	    fprintf(stderr, "for architecture: %s ", arch_name);
-	vfprintf(stderr, format, ap);
-        fprintf(stderr, "\n");
+	    fprintf(stream, "for architecture: %s ", arch_name);
+	vfprintf(stream, format, ap);
+        fprintf(stream, "\n");
 	va_end(ap);
-	errors++;
+	count_error();
 }
 
 /*
@@ -105,13 +141,15 @@ const char *format,
 ...)
 {
     va_list ap;
+    FILE *stream;
 
+	stream = diagnostics_stream();
 	va_start(ap, format);
-        fprintf(stderr, "error: %s: ", progname);
-	vfprintf(stderr, format, ap);
-	fprintf(stderr, " (%s)\n", strerror(errno));
+        fprintf(stream, "error: %s: ", progname);
+	vfprintf(stream, format, ap);
+	fprintf(stream, " (%s)\n", strerror(errno));
 	va_end(ap);
-	errors++;
+	count_error();
 }
 
 /*
@@ -125,12 +163,14 @@ char *format,
 ...)
 {
     va_list ap;
+    FILE *stream;
 
+	stream = diagnostics_stream();
 	va_start(ap, format);
-        fprintf(stderr, "error: %s: ", progname);
-	vfprintf(stderr, format, ap);
-	fprintf(stderr, " (%s)\n", mach_error_string(r));
+        fprintf(stream, "error: %s: ", progname);
+	vfprintf(stream, format, ap);
+	fprintf(stream, " (%s)\n", mach_error_string(r));
 	va_end(ap);
-	errors++;
+	count_error();
 }
 #endif /* !defined(RLD) */
@@ -5,6 +5,7 @@
 #include <libc.h>
 #include <sys/file.h>
 #include <dlfcn.h>
+#include <pthread.h>
 #include <llvm-c/lto.h>
 #include "stuff/ofile.h"
 #include "stuff/lto.h"
@@ -21,6 +22,27 @@ typedef unsigned char lto_bool_t;
 static int get_lto_cputype(
     struct arch_flag *arch_flag,
     const char *target_triple);
+static int get_bitcode_target_triple(
+    char *addr,
+    uint32_t size,
+    char *triple,
+    uint32_t triple_size);
+
+/*
+ * If lto_defer_modules is non-zero is_llvm_bitcode_from_memory() only reads
+ * the target triple of a bitcode file and returns LTO_DEFERRED_MODULE in
+ * place of the lto module, see lto.h.
+ */
+__private_extern__ int lto_defer_modules = 0;
+
+/*
+ * The first lto module is always created with this lock held as libLTO sets
+ * up its targets on that first call without any locking of its own.  Modules
+ * are created in parallel after that only when they each get their own
+ * context.
+ */
+static pthread_mutex_t lto_create_lock = PTHREAD_MUTEX_INITIALIZER;
+static int lto_created_a_module = 0;
 
 static int tried_to_load_lto = 0;
 static void *lto_handle = NULL;
@@ -90,6 +112,7 @@ void **pmod) /* maybe NULL */
    char *p, *prefix, *lto_path, buf[MAXPATHLEN], resolved_name[PATH_MAX];
    int i;
    void *mod;
+   char triple[128];
 
 	/*
 	 * The libLTO API's can't handle empty files.  So return 0 to indicate
@@ -175,11 +198,23 @@ void **pmod) /* maybe NULL */
 	    
 	if(!lto_is_object(addr, size))
 	    return(0);
-	
-	if(lto_create_local)
-	    mod = lto_create_local(addr, size, "is_llvm_bitcode_from_memory");
-	else
-	    mod = lto_create(addr, size);
+
+	/*
+	 * If the caller will create the module later only the target triple
+	 * is read here, which is much cheaper than creating the module.  If
+	 * the triple can't be read this way the module is created as usual.
+	 */
+	if(lto_defer_modules != 0 && pmod != NULL &&
+	   get_bitcode_target_triple(addr, size, triple, sizeof(triple)) != 0){
+	    arch_flag->cputype = 0;
+	    arch_flag->cpusubtype = 0;
+	    arch_flag->name = NULL;
+	    (void)get_lto_cputype(arch_flag, triple);
+	    *pmod = LTO_DEFERRED_MODULE;
+	    return(1);
+	}
+
+	mod = lto_create_module(addr, size);
 	if(mod == NULL)
 	    return(0);
 
@@ -203,6 +238,353 @@ void **pmod) /* maybe NULL */
 	return(1);
 }
 
+/*
+ * lto_create_module() is passed a pointer and size of a memory buffer that
+ * is_llvm_bitcode_from_memory() has found to be llvm bit code and returns
+ * the lto module for it, or NULL if it can't be created.  It may be called
+ * from several threads at once.
+ */
+__private_extern__
+void *
+lto_create_module(
+char *addr,
+uint32_t size)
+{
+    void *mod;
+
+	pthread_mutex_lock(&lto_create_lock);
+	if(lto_create_local == NULL || lto_created_a_module == 0){
+	    if(lto_create_local != NULL)
+		mod = lto_create_local(addr, size,
+				       "is_llvm_bitcode_from_memory");
+	    else
+		mod = lto_create(addr, size);
+	    lto_created_a_module = 1;
+	    pthread_mutex_unlock(&lto_create_lock);
+	    return(mod);
+	}
+	pthread_mutex_unlock(&lto_create_lock);
+	return(lto_create_local(addr, size, "is_llvm_bitcode_from_memory"));
+}
+
+/*
+ * The routines below are a minimal reader of the llvm bitstream format, just
+ * enough to find the target triple record at the start of the module block.
+ * See http://llvm.org/docs/BitCodeFormat.html for the format.
+ */
+#define BITCODE_WRAPPER_MAGIC	0x0b17c0de
+#define BITCODE_MODULE_BLOCK_ID	8
+#define BITCODE_MODULE_TRIPLE	2
+
+#define BITCODE_END_BLOCK	0
+#define BITCODE_ENTER_SUBBLOCK	1
+#define BITCODE_DEFINE_ABBREV	2
+#define BITCODE_UNABBREV_RECORD	3
+
+#define BITCODE_FIXED	1
+#define BITCODE_VBR	2
+#define BITCODE_ARRAY	3
+#define BITCODE_CHAR6	4
+#define BITCODE_BLOB	5
+
+/* limits on the abbreviations in the module block this reader will handle */
+#define BITCODE_MAX_ABBREVS	64
+#define BITCODE_MAX_ABBREV_OPS	16
+
+struct bitstream {
+    unsigned char *data;
+    uint64_t nbits;	/* the size of the data in bits */
+    uint64_t bit;	/* the current position in bits */
+    int error;		/* set if a read went past the end of the data */
+};
+
+struct abbrev_op {
+    int literal;	/* value is a literal value, else it is the width */
+    uint32_t encoding;	/* one of the BITCODE_* encodings if not literal */
+    uint64_t value;
+};
+
+struct abbrev {
+    uint32_t nops;
+    struct abbrev_op ops[BITCODE_MAX_ABBREV_OPS];
+};
+
+static
+uint64_t
+read_fixed(
+struct bitstream *b,
+uint32_t width)
+{
+    uint64_t value;
+    uint32_t i;
+
+	if(width > 64 || b->nbits - b->bit < width){
+	    b->error = 1;
+	    return(0);
+	}
+	value = 0;
+	for(i = 0; i < width; i++){
+	    if(b->data[(b->bit + i) / 8] & (1 << ((b->bit + i) % 8)))
+		value |= (uint64_t)1 << i;
+	}
+	b->bit += width;
+	return(value);
+}
+
+static
+uint64_t
+read_vbr(
+struct bitstream *b,
+uint32_t width)
+{
+    uint64_t piece, value;
+    uint32_t shift;
+
+	if(width < 2 || width > 32){
+	    b->error = 1;
+	    return(0);
+	}
+	value = 0;
+	shift = 0;
+	do{
+	    piece = read_fixed(b, width);
+	    if(b->error != 0 || shift >= 64){
+		b->error = 1;
+		return(0);
+	    }
+	    value |= (piece & (((uint64_t)1 << (width - 1)) - 1)) << shift;
+	    shift += width - 1;
+	}while(piece & ((uint64_t)1 << (width - 1)));
+	return(value);
+}
+
+static
+void
+align_32(
+struct bitstream *b)
+{
+	b->bit = (b->bit + 31) & ~(uint64_t)31;
+	if(b->bit > b->nbits)
+	    b->error = 1;
+}
+
+static
+void
+skip_bits(
+struct bitstream *b,
+uint64_t nbits)
+{
+	if(b->nbits - b->bit < nbits)
+	    b->error = 1;
+	else
+	    b->bit += nbits;
+}
+
+/*
+ * read_abbrev_op() reads one operand of an abbreviated record that is not an
+ * array or a blob.
+ */
+static
+uint64_t
+read_abbrev_op(
+struct bitstream *b,
+struct abbrev_op *op)
+{
+    uint64_t c;
+
+	if(op->literal)
+	    return(op->value);
+	switch(op->encoding){
+	case BITCODE_FIXED:
+	    return(read_fixed(b, (uint32_t)op->value));
+	case BITCODE_VBR:
+	    return(read_vbr(b, (uint32_t)op->value));
+	case BITCODE_CHAR6:
+	    c = read_fixed(b, 6);
+	    if(c < 26)
+		return('a' + c);
+	    if(c < 52)
+		return('A' + c - 26);
+	    if(c < 62)
+		return('0' + c - 52);
+	    return(c == 62 ? '.' : '_');
+	}
+	b->error = 1;
+	return(0);
+}
+
+/*
+ * add_triple_char() adds the operand of a triple record to the triple being
+ * collected.  Operands that are not triple records are just dropped.
+ */
+static
+void
+add_triple_char(
+uint64_t code,
+uint64_t c,
+char *triple,
+uint32_t triple_size,
+uint32_t *len)
+{
+	if(code == BITCODE_MODULE_TRIPLE && *len + 1 < triple_size)
+	    triple[(*len)++] = (char)c;
+}
+
+/*
+ * get_bitcode_target_triple() is passed a pointer and size of a memory buffer
+ * with llvm bit code and a buffer for the target triple.  If the target triple
+ * record is found it is copied into the buffer and 1 is returned.  If not, or
+ * the bit code uses something this reader does not handle, 0 is returned.
+ */
+static
+int
+get_bitcode_target_triple(
+char *addr,
+uint32_t size,
+char *triple,
+uint32_t triple_size)
+{
+    struct bitstream b;
+    unsigned char *p;
+    uint32_t width, offset, bc_size, nabbrevs, len, i, j;
+    uint64_t id, block_id, numwords, code, numops, n;
+    struct abbrev abbrevs[BITCODE_MAX_ABBREVS], *abbrev;
+    enum { TOP_LEVEL, MODULE_BLOCK } level;
+
+	p = (unsigned char *)addr;
+	if(size >= 20 &&
+	   (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) ==
+	   BITCODE_WRAPPER_MAGIC){
+	    offset = p[8] | (p[9] << 8) | (p[10] << 16) | ((uint32_t)p[11] << 24);
+	    bc_size = p[12] | (p[13] << 8) | (p[14] << 16) |
+		      ((uint32_t)p[15] << 24);
+	    if(offset > size || bc_size > size - offset)
+		return(0);
+	    p += offset;
+	    size = bc_size;
+	}
+	if(size < 4 || p[0] != 'B' || p[1] != 'C' || p[2] != 0xc0 ||
+	   p[3] != 0xde)
+	    return(0);
+
+	b.data = p;
+	b.nbits = (uint64_t)size * 8;
+	b.bit = 32;
+	b.error = 0;
+	width = 2;
+	level = TOP_LEVEL;
+	nabbrevs = 0;
+	while(b.error == 0 && b.bit < b.nbits){
+	    id = read_fixed(&b, width);
+	    if(b.error != 0)
+		return(0);
+	    switch(id){
+	    case BITCODE_END_BLOCK:
+		/* the end of the module block without finding the triple */
+		return(0);
+	    case BITCODE_ENTER_SUBBLOCK:
+		block_id = read_vbr(&b, 8);
+		n = read_vbr(&b, 4);
+		align_32(&b);
+		numwords = read_fixed(&b, 32);
+		if(b.error != 0)
+		    return(0);
+		if(level == TOP_LEVEL && block_id == BITCODE_MODULE_BLOCK_ID){
+		    if(n < 2 || n > 32)
+			return(0);
+		    width = (uint32_t)n;
+		    level = MODULE_BLOCK;
+		}
+		else
+		    skip_bits(&b, numwords * 32);
+		break;
+	    default:
+		/* only blocks are expected at the top level */
+		if(level == TOP_LEVEL)
+		    return(0);
+		if(id == BITCODE_DEFINE_ABBREV){
+		    if(nabbrevs == BITCODE_MAX_ABBREVS)
+			return(0);
+		    abbrev = abbrevs + nabbrevs++;
+		    n = read_vbr(&b, 5);
+		    if(n > BITCODE_MAX_ABBREV_OPS)
+			return(0);
+		    abbrev->nops = (uint32_t)n;
+		    for(i = 0; i < abbrev->nops && b.error == 0; i++){
+			abbrev->ops[i].literal = (int)read_fixed(&b, 1);
+			if(abbrev->ops[i].literal){
+			    abbrev->ops[i].value = read_vbr(&b, 8);
+			    continue;
+			}
+			abbrev->ops[i].encoding = (uint32_t)read_fixed(&b, 3);
+			if(abbrev->ops[i].encoding == BITCODE_FIXED ||
+			   abbrev->ops[i].encoding == BITCODE_VBR)
+			    abbrev->ops[i].value = read_vbr(&b, 5);
+		    }
+		    break;
+		}
+		len = 0;
+		if(id == BITCODE_UNABBREV_RECORD){
+		    code = read_vbr(&b, 6);
+		    numops = read_vbr(&b, 6);
+		    for(n = 0; n < numops && b.error == 0; n++)
+			add_triple_char(code, read_vbr(&b, 6), triple,
+					triple_size, &len);
+		}
+		else{
+		    /* an abbreviated record */
+		    if(id - 4 >= nabbrevs)
+			return(0);
+		    abbrev = abbrevs + (id - 4);
+		    if(abbrev->nops == 0 ||
+		       abbrev->ops[0].encoding == BITCODE_ARRAY ||
+		       abbrev->ops[0].encoding == BITCODE_BLOB)
+			return(0);
+		    code = read_abbrev_op(&b, abbrev->ops);
+		    for(i = 1; i < abbrev->nops && b.error == 0; i++){
+			if(abbrev->ops[i].literal){
+			    add_triple_char(code, abbrev->ops[i].value, triple,
+					    triple_size, &len);
+			}
+			else if(abbrev->ops[i].encoding == BITCODE_ARRAY){
+			    /* the next op is the type of the elements */
+			    if(i + 1 >= abbrev->nops)
+				return(0);
+			    n = read_vbr(&b, 6);
+			    for(j = 0; j < n && b.error == 0; j++)
+				add_triple_char(code,
+				    read_abbrev_op(&b, abbrev->ops + i + 1),
+				    triple, triple_size, &len);
+			    i++;
+			}
+			else if(abbrev->ops[i].encoding == BITCODE_BLOB){
+			    n = read_vbr(&b, 6);
+			    align_32(&b);
+			    if(b.error != 0 || (b.nbits - b.bit) / 8 < n)
+				return(0);
+			    for(j = 0; j < n; j++)
+				add_triple_char(code, p[b.bit / 8 + j], triple,
+						triple_size, &len);
+			    skip_bits(&b, n * 8);
+			    align_32(&b);
+			}
+			else{
+			    add_triple_char(code,
+				read_abbrev_op(&b, abbrev->ops + i),
+				triple, triple_size, &len);
+			}
+		    }
+		}
+		if(b.error == 0 && code == BITCODE_MODULE_TRIPLE){
+		    triple[len] = '\0';
+		    return(1);
+		}
+		break;
+	    }
+	}
+	return(0);
+}
+
 /*
  * get_lto_cputype() takes an arch_flag pointer and the target_triple string
  * returned from lto_module_get_target_triple() and sets the fields in the
@@ -427,7 +809,8 @@ void
 lto_free(
 void *mod)
 {
-	lto_dispose(mod);
+	if(mod != LTO_DEFERRED_MODULE)
+	    lto_dispose(mod);
 }
 
 #endif /* LTO_SUPPORT */
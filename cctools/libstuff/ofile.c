@@ -181,6 +181,26 @@ const char *format, ...)
 #endif /* !defined(OTOOL) */
 
 #ifndef OFI
+/*
+ * If ofile_process_unmap_hook is not NULL it is called by ofile_process() in
+ * place of ofile_unmap() when it is done with a mapped file, and it then owns
+ * the mapping.  This is used by ofile_process_parallel() whose processor only
+ * collects the ofiles and needs the file to stay mapped after ofile_process()
+ * returns.
+ */
+__private_extern__ void (*ofile_process_unmap_hook)(struct ofile *ofile) = NULL;
+
+static
+void
+ofile_process_unmap(
+struct ofile *ofile)
+{
+	if(ofile_process_unmap_hook != NULL)
+	    ofile_process_unmap_hook(ofile);
+	else
+	    ofile_unmap(ofile);
+}
+
 /*
  * ofile_process() processes the specified file name can calls the routine
  * processor on the ofiles in it.  arch_flags is an array of architectures
@@ -250,7 +270,7 @@ void *cookie)
 	    if(all_archs == FALSE && narch_flags != 0){
 		for(i = 0; i < narch_flags; i++){
 		    if(ofile_first_arch(&ofile) == FALSE){
-			ofile_unmap(&ofile);
+			ofile_process_unmap(&ofile);
 			return;
 		    }
 		    arch_found = FALSE;
@@ -391,7 +411,7 @@ void *cookie)
 			error("file: %s does not contain architecture: %s",
 			      ofile.file_name, arch_flags[i].name);
 		}
-		ofile_unmap(&ofile);
+		ofile_process_unmap(&ofile);
 		return;
 	    }
 
@@ -424,11 +444,11 @@ void *cookie)
 			 (host_arch_flag.cpusubtype & ~CPU_SUBTYPE_MASK));
 #endif /* __arm__ */
 
-		ofile_unmap(&ofile);
+		ofile_process_unmap(&ofile);
 		if(ofile_map(name, NULL, NULL, &ofile, FALSE) == FALSE)
 		    return;
 		if(ofile_first_arch(&ofile) == FALSE){
-		    ofile_unmap(&ofile);
+		    ofile_process_unmap(&ofile);
 		    return;
 		}
 		do{
@@ -534,7 +554,7 @@ void *cookie)
 		    }
 		}while(hostflag == FALSE && ofile_next_arch(&ofile) == TRUE);
 		if(hostflag == TRUE){
-		    ofile_unmap(&ofile);
+		    ofile_process_unmap(&ofile);
 		    return;
 		}
 	    }
@@ -544,11 +564,11 @@ void *cookie)
 	     * been specified and it does not contain the host architecture
 	     * so do all the architectures in the fat file
 	     */
-	    ofile_unmap(&ofile);
+	    ofile_process_unmap(&ofile);
 	    if(ofile_map(name, NULL, NULL, &ofile, FALSE) == FALSE)
 		return;
 	    if(ofile_first_arch(&ofile) == FALSE){
-		ofile_unmap(&ofile);
+		ofile_process_unmap(&ofile);
 		return;
 	    }
 	    do{
@@ -661,7 +681,7 @@ void *cookie)
 		    }
 		}
 		if(arch_found == FALSE){
-		    ofile_unmap(&ofile);
+		    ofile_process_unmap(&ofile);
 		    return;
 		}
 	    }
@@ -761,7 +781,7 @@ void *cookie)
 		    }
 		}
 		if(arch_found == FALSE){
-		    ofile_unmap(&ofile);
+		    ofile_process_unmap(&ofile);
 		    return;
 		}
 	    }
@@ -805,7 +825,7 @@ void *cookie)
 	    else
 		error("file: %s is not an object file", name);
 	}
-	ofile_unmap(&ofile);
+	ofile_process_unmap(&ofile);
 }
 #endif /* !defined(OFI) */
 
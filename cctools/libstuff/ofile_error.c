@@ -48,7 +48,7 @@ const char *format, ...)
 	vprint(format, ap);
         print("\n");
 	va_end(ap);
-	errors++;
+	count_error();
 }
 
 __private_extern__
@@ -72,7 +72,7 @@ const char *format, ...)
 	vprint(format, ap);
         print("\n");
 	va_end(ap);
-	errors++;
+	count_error();
 }
 
 #ifndef OTOOL
@@ -113,6 +113,6 @@ const char *format, ...)
 	vprint(format, ap);
         print("\n");
 	va_end(ap);
-	errors++;
+	count_error();
 }
 #endif /* !defined(OTOOL) */
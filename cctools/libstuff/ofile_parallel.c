@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2026 The darwin-sdk contributors.
+ *
+ * This file is part of cctools and is distributed under the same terms, the
+ * Apple Public Source License Version 2.0.  You may not use this file except
+ * in compliance with the License.  Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The software distributed under the License is distributed on an 'AS IS'
+ * basis, WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED.  See the
+ * License for the specific language governing rights and limitations under
+ * the License.
+ */
+#ifndef RLD
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "stuff/ofile.h"
+#include "stuff/errors.h"
+#include "stuff/allocate.h"
+
+/*
+ * ofile_process_parallel() first walks all the files serially with
+ * ofile_process() only collecting a copy of each ofile struct as a job, the
+ * files are kept mapped until all jobs are done.  The jobs are then run by a
+ * pool of threads each into its own memory stream and the main thread copies
+ * those to stdout in the order the jobs were collected.  Objects that have
+ * their headers swapped by ofile_process() or that are llvm bitcode can't
+ * outlive the processor call so those jobs are run when they are collected.
+ *
+ * Warnings and errors are buffered the same way, see diagnostics in errors.h.
+ * Those from ofile_process() itself while collecting are kept with the next
+ * job and those from the processor with its job.  The main thread prints them
+ * to stderr before the job's output, and adds their errors to errors.
+ */
+struct ofile_job {
+    struct ofile ofile;		/* copy of the ofile to process */
+    char *arch_name;		/* copy of the arch_name or NULL */
+    enum bool done;		/* TRUE when output is filled in */
+    char *output;		/* output of the processor */
+    size_t output_size;
+    char *collect_messages;	/* messages from collecting before this job */
+    size_t collect_messages_size;
+    char *messages;		/* messages from the processor */
+    size_t messages_size;
+    uint32_t errors;		/* errors counted in both of the above */
+};
+
+struct ofile_pool {
+    void (*processor)(struct ofile *ofile, char *arch_name, void *cookie,
+		      FILE *output);
+    void *cookie;
+
+    struct ofile_job **jobs;	/* the jobs in collected order */
+    uint32_t njobs;
+    uint32_t jobs_size;
+    uint32_t next_job;		/* next job to be run by a thread */
+    uint32_t deferred;		/* jobs collected since the last unmap, only
+				   used by the collecting thread */
+    enum bool collecting;	/* TRUE while jobs may still be added */
+
+    struct ofile *mappings;	/* files kept mapped for deferred jobs */
+    uint32_t nmappings;
+
+    struct diagnostics collect_diagnostics; /* messages while collecting */
+    char *collect_messages;
+    size_t collect_messages_size;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+/*
+ * There is only one pool collecting at a time so the unmap hook, which has no
+ * cookie, finds it here.
+ */
+static struct ofile_pool *collecting_pool = NULL;
+
+/*
+ * run_processor() runs the processor on the ofile into a memory stream and
+ * returns its contents and the messages it printed in the job.
+ */
+static
+void
+run_processor(
+struct ofile_pool *pool,
+struct ofile *ofile,
+char *arch_name,
+struct ofile_job *job)
+{
+    FILE *output;
+    struct diagnostics job_diagnostics, *saved_diagnostics;
+
+	job->output = NULL;
+	job->output_size = 0;
+	output = open_memstream(&job->output, &job->output_size);
+	if(output == NULL)
+	    system_fatal("can't create output stream");
+	job->messages = NULL;
+	job->messages_size = 0;
+	job_diagnostics.stream = open_memstream(&job->messages,
+						&job->messages_size);
+	if(job_diagnostics.stream == NULL)
+	    system_fatal("can't create output stream");
+	job_diagnostics.errors = 0;
+	saved_diagnostics = diagnostics;
+	diagnostics = &job_diagnostics;
+
+	pool->processor(ofile, arch_name, pool->cookie, output);
+
+	diagnostics = saved_diagnostics;
+	fclose(job_diagnostics.stream);
+	job->errors += job_diagnostics.errors;
+	fclose(output);
+}
+
+/*
+ * start_collect_messages() starts a new memory stream for the messages printed
+ * by the collecting thread.
+ */
+static
+void
+start_collect_messages(
+struct ofile_pool *pool)
+{
+	pool->collect_messages = NULL;
+	pool->collect_messages_size = 0;
+	pool->collect_diagnostics.stream =
+	    open_memstream(&pool->collect_messages,
+			   &pool->collect_messages_size);
+	if(pool->collect_diagnostics.stream == NULL)
+	    system_fatal("can't create output stream");
+	pool->collect_diagnostics.errors = 0;
+}
+
+/*
+ * print_messages() prints buffered messages to stderr after what has been
+ * printed so far to stdout.
+ */
+static
+void
+print_messages(
+char *messages,
+size_t messages_size)
+{
+	if(messages_size == 0)
+	    return;
+	fflush(stdout);
+	fwrite(messages, 1, messages_size, stderr);
+}
+
+/*
+ * worker() is the start routine of the pool threads.  It runs deferred jobs
+ * until all jobs are collected and none are left to run.
+ */
+static
+void *
+worker(
+void *arg)
+{
+    struct ofile_pool *pool;
+    struct ofile_job *job;
+
+	pool = (struct ofile_pool *)arg;
+	for(;;){
+	    pthread_mutex_lock(&pool->lock);
+	    while(pool->next_job < pool->njobs &&
+		  pool->jobs[pool->next_job]->done == TRUE)
+		pool->next_job++;
+	    while(pool->next_job == pool->njobs && pool->collecting == TRUE){
+		pthread_cond_wait(&pool->cond, &pool->lock);
+		while(pool->next_job < pool->njobs &&
+		      pool->jobs[pool->next_job]->done == TRUE)
+		    pool->next_job++;
+	    }
+	    if(pool->next_job == pool->njobs){
+		pthread_mutex_unlock(&pool->lock);
+		return(NULL);
+	    }
+	    job = pool->jobs[pool->next_job++];
+	    pthread_mutex_unlock(&pool->lock);
+
+	    run_processor(pool, &job->ofile, job->arch_name, job);
+
+	    pthread_mutex_lock(&pool->lock);
+	    job->done = TRUE;
+	    pthread_cond_broadcast(&pool->cond);
+	    pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/*
+ * collect() is the processor passed to ofile_process().  It adds a job for the
+ * ofile, which is run right away if the ofile can't outlive this call.
+ */
+static
+void
+collect(
+struct ofile *ofile,
+char *arch_name,
+void *cookie)
+{
+    struct ofile_pool *pool;
+    struct ofile_job *job;
+
+	pool = (struct ofile_pool *)cookie;
+	job = allocate(sizeof(struct ofile_job));
+	memset(job, '\0', sizeof(struct ofile_job));
+
+	/* the messages printed since the last job go before this one */
+	fclose(pool->collect_diagnostics.stream);
+	job->collect_messages = pool->collect_messages;
+	job->collect_messages_size = pool->collect_messages_size;
+	job->errors = pool->collect_diagnostics.errors;
+	start_collect_messages(pool);
+
+	if(ofile->headers_swapped == TRUE || ofile->lto != NULL){
+	    run_processor(pool, ofile, arch_name, job);
+	    job->done = TRUE;
+	}
+	else{
+	    job->ofile = *ofile;
+	    if(ofile->arch_flag.name != NULL)
+		job->ofile.arch_flag.name = savestr(ofile->arch_flag.name);
+	    if(arch_name == NULL)
+		job->arch_name = NULL;
+	    else if(arch_name == ofile->arch_flag.name)
+		job->arch_name = job->ofile.arch_flag.name;
+	    else
+		job->arch_name = savestr(arch_name);
+	    pool->deferred++;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	if(pool->njobs == pool->jobs_size){
+	    pool->jobs_size = pool->jobs_size == 0 ? 64 : pool->jobs_size * 2;
+	    pool->jobs = reallocate(pool->jobs,
+				    pool->jobs_size * sizeof(struct ofile_job *));
+	}
+	pool->jobs[pool->njobs++] = job;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * keep_mapping() is set as the ofile_process_unmap_hook while collecting.  The
+ * file is kept mapped if any deferred jobs reference it.
+ */
+static
+void
+keep_mapping(
+struct ofile *ofile)
+{
+    struct ofile_pool *pool;
+
+	pool = collecting_pool;
+	if(pool->deferred == 0){
+	    ofile_unmap(ofile);
+	    return;
+	}
+	pool->mappings = reallocate(pool->mappings,
+			    (pool->nmappings + 1) * sizeof(struct ofile));
+	pool->mappings[pool->nmappings++] = *ofile;
+	memset(ofile, '\0', sizeof(struct ofile));
+	pool->deferred = 0;
+}
+
+/*
+ * process_serially() is the processor used when only one thread is to be used
+ * in which case the output goes directly to stdout.
+ */
+static
+void
+process_serially(
+struct ofile *ofile,
+char *arch_name,
+void *cookie)
+{
+    struct ofile_pool *pool;
+
+	pool = (struct ofile_pool *)cookie;
+	pool->processor(ofile, arch_name, pool->cookie, stdout);
+}
+
+/*
+ * ofile_thread_count() returns the number of threads to use for work that is
+ * done in parallel: the value of the CCTOOLS_THREADS environment variable if it
+ * is set to a number greater than 0, else the number of online cpus.
+ */
+__private_extern__
+uint32_t
+ofile_thread_count(
+void)
+{
+    static enum bool warned = FALSE;
+    char *env, *endp;
+    unsigned long value;
+    long ncpus;
+
+	env = getenv("CCTOOLS_THREADS");
+	if(env != NULL){
+	    value = strtoul(env, &endp, 10);
+	    if(*env != '\0' && *endp == '\0' && value > 0 &&
+	       value <= UINT32_MAX)
+		return((uint32_t)value);
+	    if(warned == FALSE)
+		warning("ignoring CCTOOLS_THREADS=%s, not a number of "
+			"threads", env);
+	    warned = TRUE;
+	}
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return(ncpus > 0 ? (uint32_t)ncpus : 1);
+}
+
+/*
+ * ofile_process_parallel() calls ofile_process() for each of the nnames names
+ * and runs the processor on the ofiles in them using nthreads threads.  If
+ * nthreads is 0 the CCTOOLS_THREADS environment variable is used if it is set
+ * to a number greater than 0, else the number of online cpus.  With one thread
+ * the processor is called directly and prints straight to stdout.  See
+ * ofile_process() for the other parameters.  The output each processor call
+ * writes to its output stream is printed to stdout in the same order as
+ * ofile_process() would have called the processor.
+ */
+__private_extern__
+void
+ofile_process_parallel(
+char **names,
+uint32_t nnames,
+struct arch_flag *arch_flags,
+uint32_t narch_flags,
+enum bool all_archs,
+enum bool process_non_objects,
+enum bool dylib_flat,
+enum bool use_member_syntax,
+void (*processor)(struct ofile *ofile, char *arch_name, void *cookie,
+		  FILE *output),
+void *cookie,
+uint32_t nthreads)
+{
+    struct ofile_pool pool;
+    pthread_t *threads;
+    uint32_t i, nstarted;
+    struct ofile_job *job;
+    struct diagnostics *saved_diagnostics;
+
+	memset(&pool, '\0', sizeof(struct ofile_pool));
+	pool.processor = processor;
+	pool.cookie = cookie;
+
+	if(nthreads == 0)
+	    nthreads = ofile_thread_count();
+	if(nthreads == 1){
+	    for(i = 0; i < nnames; i++)
+		ofile_process(names[i], arch_flags, narch_flags, all_archs,
+			      process_non_objects, dylib_flat,
+			      use_member_syntax, process_serially, &pool);
+	    return;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+	pool.collecting = TRUE;
+	threads = allocate(nthreads * sizeof(pthread_t));
+	nstarted = 0;
+	for(i = 0; i < nthreads; i++){
+	    if(pthread_create(threads + nstarted, NULL, worker, &pool) != 0)
+		break;
+	    nstarted++;
+	}
+
+	collecting_pool = &pool;
+	ofile_process_unmap_hook = keep_mapping;
+	start_collect_messages(&pool);
+	saved_diagnostics = diagnostics;
+	diagnostics = &pool.collect_diagnostics;
+	for(i = 0; i < nnames; i++)
+	    ofile_process(names[i], arch_flags, narch_flags, all_archs,
+			  process_non_objects, dylib_flat, use_member_syntax,
+			  collect, &pool);
+	diagnostics = saved_diagnostics;
+	fclose(pool.collect_diagnostics.stream);
+	ofile_process_unmap_hook = NULL;
+	collecting_pool = NULL;
+
+	pthread_mutex_lock(&pool.lock);
+	pool.collecting = FALSE;
+	pthread_cond_broadcast(&pool.cond);
+	pthread_mutex_unlock(&pool.lock);
+
+	/* if no threads could be created run the jobs on this thread */
+	if(nstarted == 0)
+	    worker(&pool);
+
+	for(i = 0; i < pool.njobs; i++){
+	    job = pool.jobs[i];
+	    pthread_mutex_lock(&pool.lock);
+	    while(job->done == FALSE)
+		pthread_cond_wait(&pool.cond, &pool.lock);
+	    pthread_mutex_unlock(&pool.lock);
+	    print_messages(job->collect_messages, job->collect_messages_size);
+	    print_messages(job->messages, job->messages_size);
+	    errors += job->errors;
+	    if(job->output_size != 0)
+		fwrite(job->output, 1, job->output_size, stdout);
+	    free(job->collect_messages);
+	    free(job->messages);
+	    free(job->output);
+	    if(job->arch_name != NULL &&
+	       job->arch_name != job->ofile.arch_flag.name)
+		free(job->arch_name);
+	    if(job->ofile.arch_flag.name != NULL)
+		free(job->ofile.arch_flag.name);
+	    free(job);
+	}
+	/* messages from collecting after the last job */
+	print_messages(pool.collect_messages, pool.collect_messages_size);
+	errors += pool.collect_diagnostics.errors;
+	free(pool.collect_messages);
+
+	for(i = 0; i < nstarted; i++)
+	    pthread_join(threads[i], NULL);
+	free(threads);
+	for(i = 0; i < pool.nmappings; i++)
+	    ofile_unmap(pool.mappings + i);
+	free(pool.mappings);
+	free(pool.jobs);
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+}
+#endif /* !defined(RLD) */
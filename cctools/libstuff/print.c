@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include "stuff/print.h"
+#include "stuff/errors.h"
 
 /*
  * All printing of all messages for ofile functions goes through this function.
@@ -35,7 +36,7 @@ vprint(
 const char *format,
 va_list ap)
 {
-	vfprintf(stderr, format, ap);
+	vfprintf(diagnostics_stream(), format, ap);
 }
 
 /*
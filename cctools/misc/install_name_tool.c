@@ -26,6 +26,8 @@
 #include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <mach-o/fat.h>
 #include "stuff/errors.h"
 #include "stuff/breakout.h"
 #include "stuff/rnd.h"
@@ -46,6 +48,19 @@ static void write_on_input(
     uint32_t narchs,
     char *input);
 
+static enum bool write_headers_in_place(
+    char *input);
+
+static uint64_t get_low_fileoff(
+    struct object *object);
+
+static enum bool load_command_is_sound(
+    struct load_command *lc);
+
+static enum bool lc_str_is_sound(
+    struct load_command *lc,
+    union lc_str lc_str);
+
 static void setup_object_symbolic_info(
     struct object *object);
 
@@ -95,6 +110,18 @@ static uint32_t ndelete_rpaths = 0;
  */
 static uint32_t *arch_header_sizes = NULL;
 
+/*
+ * This is used by write_headers_in_place() to record where each architecture
+ * is in the input file and the buffer holding its mach header and load
+ * commands.
+ */
+struct slice {
+    uint64_t offset;		/* offset of this architecture in the file */
+    uint64_t size;		/* size of this architecture in the file */
+    char *headers;		/* buffer for the mach header and load commands */
+    uint32_t headers_size;	/* size of the above buffer */
+};
+
 /*
  * The -o output option is not enabled as it is not needed and has the
  * unintended side effect of changing the time stamps in LC_ID_DYLIB commands
@@ -323,6 +350,18 @@ char **envp)
 	   nadd_rpaths == 0 && ndelete_rpaths == 0))
 	    usage();
 
+	/*
+	 * When writing on the input file first try to just read and rewrite
+	 * the headers of each architecture in place.  Only if the file can't
+	 * be handled that way is the whole file broken out below.
+	 */
+	if(output == NULL && write_headers_in_place(input) == TRUE){
+	    if(errors)
+		return(EXIT_FAILURE);
+	    else
+		return(EXIT_SUCCESS);
+	}
+
 	breakout(input, &archs, &narchs, FALSE);
 	if(errors)
 	    exit(EXIT_FAILURE);
@@ -478,6 +517,261 @@ char *input)
 	    system_error("can't close written on input file: %s", input);
 }
 
+/*
+ * write_headers_in_place() is the fast path used when writing on the input
+ * file.  Rather than mapping, breaking out and checking the whole file it
+ * reads only the fat headers and the mach header and load commands of each
+ * architecture, updates the load commands with update_load_commands() and
+ * then writes just the headers back with pwrite(2).  If the file is something
+ * this can't handle (an archive, an object not in the host byte sex or headers
+ * that don't parse) nothing is written and FALSE is returned so the caller
+ * falls back to breakout().  Otherwise TRUE is returned and any errors have
+ * been reported.  Nothing is written if any architecture has an error.
+ */
+static
+enum bool
+write_headers_in_place(
+char *input)
+{
+    int fd;
+    struct stat stat_buf;
+    uint32_t i, j, nslices, magic, ncmds, sizeofcmds, sizeof_mach_header,
+	     header_size, size;
+    uint64_t low_fileoff;
+    struct fat_header fat_header;
+    struct fat_arch *fat_archs;
+    struct fat_arch_64 *fat_archs64;
+    struct slice *slices;
+    struct arch *archs;
+    struct object *object;
+    struct load_command *lc;
+    enum byte_sex host_byte_sex;
+    enum bool handled;
+
+	host_byte_sex = get_host_byte_sex();
+	handled = FALSE;
+	slices = NULL;
+	archs = NULL;
+	nslices = 0;
+
+	fd = open(input, O_RDWR, 0);
+	if(fd == -1)
+	    return(FALSE);
+	if(fstat(fd, &stat_buf) == -1)
+	    goto done;
+
+	/*
+	 * Find the offset and size of each architecture, fat headers are
+	 * always in big endian byte sex.
+	 */
+	if((uint64_t)stat_buf.st_size >= sizeof(struct fat_header) &&
+	   pread(fd, &fat_header, sizeof(struct fat_header), 0) ==
+	   sizeof(struct fat_header)){
+	    if(host_byte_sex != BIG_ENDIAN_BYTE_SEX)
+		swap_fat_header(&fat_header, host_byte_sex);
+	}
+	else
+	    memset(&fat_header, '\0', sizeof(struct fat_header));
+	if(fat_header.magic == FAT_MAGIC || fat_header.magic == FAT_MAGIC_64){
+	    nslices = fat_header.nfat_arch;
+	    if(fat_header.magic == FAT_MAGIC_64)
+		size = nslices * sizeof(struct fat_arch_64);
+	    else
+		size = nslices * sizeof(struct fat_arch);
+	    if(nslices == 0 ||
+	       size / nslices != (fat_header.magic == FAT_MAGIC_64 ?
+		   sizeof(struct fat_arch_64) : sizeof(struct fat_arch)) ||
+	       sizeof(struct fat_header) + (uint64_t)size >
+	       (uint64_t)stat_buf.st_size){
+		nslices = 0;
+		goto done;
+	    }
+	    slices = allocate(nslices * sizeof(struct slice));
+	    memset(slices, '\0', nslices * sizeof(struct slice));
+	    if(fat_header.magic == FAT_MAGIC_64){
+		fat_archs64 = allocate(size);
+		if(pread(fd, fat_archs64, size, sizeof(struct fat_header)) !=
+		   (ssize_t)size){
+		    free(fat_archs64);
+		    goto done;
+		}
+		if(host_byte_sex != BIG_ENDIAN_BYTE_SEX)
+		    swap_fat_arch_64(fat_archs64, nslices, host_byte_sex);
+		for(i = 0; i < nslices; i++){
+		    slices[i].offset = fat_archs64[i].offset;
+		    slices[i].size = fat_archs64[i].size;
+		}
+		free(fat_archs64);
+	    }
+	    else{
+		fat_archs = allocate(size);
+		if(pread(fd, fat_archs, size, sizeof(struct fat_header)) !=
+		   (ssize_t)size){
+		    free(fat_archs);
+		    goto done;
+		}
+		if(host_byte_sex != BIG_ENDIAN_BYTE_SEX)
+		    swap_fat_arch(fat_archs, nslices, host_byte_sex);
+		for(i = 0; i < nslices; i++){
+		    slices[i].offset = fat_archs[i].offset;
+		    slices[i].size = fat_archs[i].size;
+		}
+		free(fat_archs);
+	    }
+	}
+	else{
+	    nslices = 1;
+	    slices = allocate(sizeof(struct slice));
+	    memset(slices, '\0', sizeof(struct slice));
+	    slices[0].offset = 0;
+	    slices[0].size = stat_buf.st_size;
+	}
+
+	/*
+	 * Read in the mach header and load commands of each architecture into
+	 * a zeroed buffer large enough for them to grow up to the first
+	 * section contents.  Anything unexpected falls back to breakout().
+	 */
+	archs = allocate(nslices * sizeof(struct arch));
+	memset(archs, '\0', nslices * sizeof(struct arch));
+	for(i = 0; i < nslices; i++){
+	    if(slices[i].offset + slices[i].size > (uint64_t)stat_buf.st_size ||
+	       slices[i].size < sizeof(struct mach_header) ||
+	       pread(fd, &magic, sizeof(uint32_t), slices[i].offset) !=
+	       sizeof(uint32_t))
+		goto done;
+	    if(magic == MH_MAGIC)
+		sizeof_mach_header = sizeof(struct mach_header);
+	    else if(magic == MH_MAGIC_64)
+		sizeof_mach_header = sizeof(struct mach_header_64);
+	    else
+		goto done;
+	    if(slices[i].size < sizeof_mach_header)
+		goto done;
+
+	    object = allocate(sizeof(struct object));
+	    memset(object, '\0', sizeof(struct object));
+	    archs[i].file_name = input;
+	    archs[i].type = OFILE_Mach_O;
+	    archs[i].object = object;
+	    object->object_byte_sex = host_byte_sex;
+	    object->object_size = slices[i].size;
+
+	    slices[i].headers_size = sizeof_mach_header;
+	    slices[i].headers = allocate(sizeof_mach_header);
+	    if(pread(fd, slices[i].headers, sizeof_mach_header,
+		     slices[i].offset) != (ssize_t)sizeof_mach_header)
+		goto done;
+	    if(magic == MH_MAGIC){
+		ncmds = ((struct mach_header *)slices[i].headers)->ncmds;
+		sizeofcmds =
+		    ((struct mach_header *)slices[i].headers)->sizeofcmds;
+	    }
+	    else{
+		ncmds = ((struct mach_header_64 *)slices[i].headers)->ncmds;
+		sizeofcmds =
+		    ((struct mach_header_64 *)slices[i].headers)->sizeofcmds;
+	    }
+	    header_size = sizeof_mach_header + sizeofcmds;
+	    if(sizeofcmds > slices[i].size - sizeof_mach_header)
+		goto done;
+	    slices[i].headers = reallocate(slices[i].headers, header_size);
+	    if(pread(fd, slices[i].headers + sizeof_mach_header, sizeofcmds,
+		     slices[i].offset + sizeof_mach_header) !=
+	       (ssize_t)sizeofcmds)
+		goto done;
+
+	    /* make sure the load commands can be walked */
+	    lc = (struct load_command *)(slices[i].headers +
+					 sizeof_mach_header);
+	    for(j = 0; j < ncmds; j++){
+		if((char *)lc + sizeof(struct load_command) >
+		   slices[i].headers + header_size ||
+		   lc->cmdsize < sizeof(struct load_command) ||
+		   lc->cmdsize % 4 != 0 ||
+		   lc->cmdsize > (uint32_t)((slices[i].headers + header_size) -
+					    (char *)lc) ||
+		   load_command_is_sound(lc) == FALSE)
+		    goto done;
+		lc = (struct load_command *)((char *)lc + lc->cmdsize);
+	    }
+
+	    if(magic == MH_MAGIC)
+		object->mh = (struct mach_header *)slices[i].headers;
+	    else
+		object->mh64 = (struct mach_header_64 *)slices[i].headers;
+	    object->load_commands = (struct load_command *)
+				    (slices[i].headers + sizeof_mach_header);
+
+	    low_fileoff = get_low_fileoff(object);
+	    if(low_fileoff > slices[i].size)
+		low_fileoff = slices[i].size;
+	    if(low_fileoff > header_size){
+		slices[i].headers = reallocate(slices[i].headers, low_fileoff);
+		memset(slices[i].headers + header_size, '\0',
+		       low_fileoff - header_size);
+		slices[i].headers_size = low_fileoff;
+	    }
+	    else
+		slices[i].headers_size = header_size;
+	    if(magic == MH_MAGIC){
+		object->mh = (struct mach_header *)slices[i].headers;
+		object->mh_filetype = object->mh->filetype;
+	    }
+	    else{
+		object->mh64 = (struct mach_header_64 *)slices[i].headers;
+		object->mh_filetype = object->mh64->filetype;
+	    }
+	    object->load_commands = (struct load_command *)
+				    (slices[i].headers + sizeof_mach_header);
+	}
+
+	/*
+	 * From here on the file is being handled here.  Update the load
+	 * commands of all the architectures before writing any of them so
+	 * nothing is written if there are errors.
+	 */
+	handled = TRUE;
+	arch_header_sizes = allocate(nslices * sizeof(uint32_t));
+	process(archs, nslices);
+	if(errors)
+	    goto done;
+
+	for(i = 0; i < nslices; i++){
+	    object = archs[i].object;
+	    if(object->mh != NULL)
+		header_size = sizeof(struct mach_header) +
+			      object->mh->sizeofcmds;
+	    else
+		header_size = sizeof(struct mach_header_64) +
+			      object->mh64->sizeofcmds;
+	    if(arch_header_sizes[i] > header_size)
+		size = arch_header_sizes[i];
+	    else
+		size = header_size;
+	    if(pwrite(fd, slices[i].headers, size, slices[i].offset) !=
+	       (ssize_t)size)
+		system_error("can't write new headers in file: %s", input);
+	}
+
+done:
+	if(close(fd) == -1 && handled == TRUE)
+	    system_error("can't close written on input file: %s", input);
+	if(archs != NULL){
+	    for(i = 0; i < nslices; i++)
+		if(archs[i].object != NULL)
+		    free(archs[i].object);
+	    free(archs);
+	}
+	if(slices != NULL){
+	    for(i = 0; i < nslices; i++)
+		if(slices[i].headers != NULL)
+		    free(slices[i].headers);
+	    free(slices);
+	}
+	return(handled);
+}
+
 static
 void
 setup_object_symbolic_info(
@@ -637,6 +931,176 @@ struct object *object)
 #endif /* OUTPUT_OPTION */
 }
 
+/*
+ * get_low_fileoff() returns the lowest file offset of any section (or segment
+ * without sections) that has contents in the file for the specified object.
+ * This is the end of the space available for the mach header and load
+ * commands.  If there is no such section or segment ULLONG_MAX is returned.
+ */
+static
+uint64_t
+get_low_fileoff(
+struct object *object)
+{
+    uint32_t i, j, ncmds;
+    uint64_t low_fileoff;
+    struct load_command *lc;
+    struct segment_command *sg;
+    struct segment_command_64 *sg64;
+    struct section *s;
+    struct section_64 *s64;
+
+	if(object->mh != NULL)
+	    ncmds = object->mh->ncmds;
+	else
+	    ncmds = object->mh64->ncmds;
+
+	low_fileoff = ULLONG_MAX;
+	lc = object->load_commands;
+	for(i = 0; i < ncmds; i++){
+	    switch(lc->cmd){
+	    case LC_SEGMENT:
+		sg = (struct segment_command *)lc;
+		s = (struct section *)
+		    ((char *)sg + sizeof(struct segment_command));
+		if(sg->nsects != 0){
+		    for(j = 0; j < sg->nsects; j++){
+			if(s->size != 0 &&
+			   (s->flags & S_ZEROFILL) != S_ZEROFILL &&
+			   (s->flags & S_THREAD_LOCAL_ZEROFILL) !=
+				       S_THREAD_LOCAL_ZEROFILL &&
+			   s->offset < low_fileoff)
+			    low_fileoff = s->offset;
+			s++;
+		    }
+		}
+		else{
+		    if(sg->filesize != 0 && sg->fileoff < low_fileoff)
+			low_fileoff = sg->fileoff;
+		}
+		break;
+
+	    case LC_SEGMENT_64:
+		sg64 = (struct segment_command_64 *)lc;
+		s64 = (struct section_64 *)
+		    ((char *)sg64 + sizeof(struct segment_command_64));
+		if(sg64->nsects != 0){
+		    for(j = 0; j < sg64->nsects; j++){
+			if(s64->size != 0 &&
+			   (s64->flags & S_ZEROFILL) != S_ZEROFILL &&
+			   (s64->flags & S_THREAD_LOCAL_ZEROFILL) !=
+					 S_THREAD_LOCAL_ZEROFILL &&
+			   s64->offset < low_fileoff)
+			    low_fileoff = s64->offset;
+			s64++;
+		    }
+		}
+		else{
+		    if(sg64->filesize != 0 && sg64->fileoff < low_fileoff)
+			low_fileoff = sg64->fileoff;
+		}
+		break;
+	    }
+	    lc = (struct load_command *)((char *)lc + lc->cmdsize);
+	}
+	return(low_fileoff);
+}
+
+/*
+ * load_command_is_sound() is used by write_headers_in_place() before handing
+ * load commands that have not been through checkout() to get_low_fileoff() and
+ * update_load_commands().  It returns FALSE if the command is too small for
+ * its type or, for the commands with names that may be looked at or changed,
+ * a name is not a NUL terminated string inside the command.  The caller then
+ * falls back to breakout() which reports the malformed command.
+ */
+static
+enum bool
+load_command_is_sound(
+struct load_command *lc)
+{
+    struct segment_command *sg;
+    struct segment_command_64 *sg64;
+    struct dylib_command *dl;
+    struct prebound_dylib_command *pbdylib;
+    struct rpath_command *rpath;
+    uint32_t name_size;
+
+	switch(lc->cmd){
+	case LC_SEGMENT:
+	    if(lc->cmdsize < sizeof(struct segment_command))
+		return(FALSE);
+	    sg = (struct segment_command *)lc;
+	    if(sg->nsects > (lc->cmdsize - sizeof(struct segment_command)) /
+			    sizeof(struct section))
+		return(FALSE);
+	    break;
+
+	case LC_SEGMENT_64:
+	    if(lc->cmdsize < sizeof(struct segment_command_64))
+		return(FALSE);
+	    sg64 = (struct segment_command_64 *)lc;
+	    if(sg64->nsects > (lc->cmdsize - sizeof(struct segment_command_64)) /
+			      sizeof(struct section_64))
+		return(FALSE);
+	    break;
+
+	case LC_ID_DYLIB:
+	case LC_LOAD_DYLIB:
+	case LC_LOAD_WEAK_DYLIB:
+	case LC_REEXPORT_DYLIB:
+	case LC_LOAD_UPWARD_DYLIB:
+	case LC_LAZY_LOAD_DYLIB:
+	    if(lc->cmdsize < sizeof(struct dylib_command))
+		return(FALSE);
+	    dl = (struct dylib_command *)lc;
+	    return(lc_str_is_sound(lc, dl->dylib.name));
+
+	case LC_PREBOUND_DYLIB:
+	    if(lc->cmdsize < sizeof(struct prebound_dylib_command))
+		return(FALSE);
+	    pbdylib = (struct prebound_dylib_command *)lc;
+	    if(lc_str_is_sound(lc, pbdylib->name) == FALSE)
+		return(FALSE);
+	    /*
+	     * update_load_commands() copies the linked modules bit vector as
+	     * the bytes after the rounded name, so they must be in the command.
+	     */
+	    name_size = strlen((char *)lc + pbdylib->name.offset) + 1;
+	    if(sizeof(struct prebound_dylib_command) + rnd(name_size, 8) >
+	       lc->cmdsize ||
+	       pbdylib->linked_modules.offset >
+	       sizeof(struct prebound_dylib_command) + rnd(name_size, 4))
+		return(FALSE);
+	    break;
+
+	case LC_RPATH:
+	    if(lc->cmdsize < sizeof(struct rpath_command))
+		return(FALSE);
+	    rpath = (struct rpath_command *)lc;
+	    return(lc_str_is_sound(lc, rpath->path));
+	}
+	return(TRUE);
+}
+
+/*
+ * lc_str_is_sound() returns TRUE if the string lc_str in the load command lc
+ * starts inside the command and is NUL terminated before the end of it.
+ */
+static
+enum bool
+lc_str_is_sound(
+struct load_command *lc,
+union lc_str lc_str)
+{
+	if(lc_str.offset >= lc->cmdsize)
+	    return(FALSE);
+	if(memchr((char *)lc + lc_str.offset, '\0',
+		  lc->cmdsize - lc_str.offset) == NULL)
+	    return(FALSE);
+	return(TRUE);
+}
+
 /*
  * update_load_commands() changes the install names the LC_LOAD_DYLIB,
  * LC_LOAD_WEAK_DYLIB, LC_REEXPORT_DYLIB, LC_LOAD_UPWARD_DYLIB and
@@ -658,8 +1122,6 @@ uint32_t *header_size)
 	 *linked_modules2, *path1, *path2;
     struct segment_command *sg;
     struct segment_command_64 *sg64;
-    struct section *s;
-    struct section_64 *s64;
     struct arch_flag arch_flag;
     struct rpath_command *rpath1, *rpath2;
     enum bool delete;
@@ -693,7 +1155,7 @@ uint32_t *header_size)
 	set_arch_flag_name(&arch_flag);
 	arch_name = arch_flag.name;
 
-	low_fileoff = ULLONG_MAX;
+	low_fileoff = get_low_fileoff(arch->object);
 	lc1 = arch->object->load_commands;
 	for(i = 0; i < ncmds; i++){
 	    switch(lc1->cmd){
@@ -743,48 +1205,6 @@ uint32_t *header_size)
 		}
 		break;
 
-	    case LC_SEGMENT:
-		sg = (struct segment_command *)lc1;
-		s = (struct section *)
-		    ((char *)sg + sizeof(struct segment_command));
-		if(sg->nsects != 0){
-		    for(j = 0; j < sg->nsects; j++){
-			if(s->size != 0 &&
-			   (s->flags & S_ZEROFILL) != S_ZEROFILL &&
-			   (s->flags & S_THREAD_LOCAL_ZEROFILL) !=
-				       S_THREAD_LOCAL_ZEROFILL &&
-			   s->offset < low_fileoff)
-			    low_fileoff = s->offset;
-			s++;
-		    }
-		}
-		else{
-		    if(sg->filesize != 0 && sg->fileoff < low_fileoff)
-			low_fileoff = sg->fileoff;
-		}
-		break;
-
-	    case LC_SEGMENT_64:
-		sg64 = (struct segment_command_64 *)lc1;
-		s64 = (struct section_64 *)
-		    ((char *)sg64 + sizeof(struct segment_command_64));
-		if(sg64->nsects != 0){
-		    for(j = 0; j < sg64->nsects; j++){
-			if(s64->size != 0 &&
-			   (s64->flags & S_ZEROFILL) != S_ZEROFILL &&
-			   (s64->flags & S_THREAD_LOCAL_ZEROFILL) !=
-					 S_THREAD_LOCAL_ZEROFILL &&
-			   s64->offset < low_fileoff)
-			    low_fileoff = s64->offset;
-			s64++;
-		    }
-		}
-		else{
-		    if(sg64->filesize != 0 && sg64->fileoff < low_fileoff)
-			low_fileoff = sg64->fileoff;
-		}
-		break;
-
 	    case LC_RPATH:
 		rpath1 = (struct rpath_command *)lc1;
 		path1 = (char *)rpath1 + rpath1->path.offset;
@@ -40,6 +40,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <pthread.h>
 #include "stuff/bool.h"
 #include "stuff/ofile.h"
 #include "stuff/rnd.h"
@@ -94,6 +95,14 @@ static enum bool zero_ar_date = FALSE;
  */
 static u_short toc_mode = 0;
 
+#ifdef LTO_SUPPORT
+/*
+ * The directory from the environment variable CCTOOLS_TOC_CACHE, where the
+ * table of contents symbols of bit code members are cached, or NULL.
+ */
+static char *toc_cache_dir = NULL;
+#endif /* LTO_SUPPORT */
+
 /* flags set from the command line arguments */
 struct cmd_flags {
     char **files;	/* array of file name arguments */
@@ -215,11 +224,21 @@ struct member {
     struct symtab_command *st;	    /* the symbol table command */
     struct section **sections;	    /* array of section structs for 32-bit */
     struct section_64 **sections64; /* array of section structs for 64-bit */
+    uint32_t nsects;		    /* number of sections in the above */
+
+    /* the table of contents info of this member, see make_table_of_contents*/
+    uint32_t toc_nsyms;		    /* number of symbols for the toc */
+    uint64_t toc_strsize;	    /* the size of the strings for the toc */
+    enum bool toc_malformed;	    /* TRUE if a symbol is malformed */
+    uint64_t toc_index;		    /* index of the first toc struct */
+    uint64_t toc_stroff;	    /* offset of the first toc string */
 #ifdef LTO_SUPPORT
     enum bool lto_contents;	    /* TRUE if this member has lto contents */
     uint32_t lto_toc_nsyms;	    /* number of symbols for the toc */
     uint32_t lto_toc_strsize;	    /* the size of the strings for the toc */
     char *lto_toc_strings;	    /* the strings of the symbols for the toc */
+    enum bool lto_toc_pending;	    /* TRUE if the above are yet to be set */
+    enum bool lto_toc_failed;	    /* TRUE if the lto module can't be made */
 #endif /* LTO_SUPPORT */
 
     /* the name of the member in the output */
@@ -271,10 +290,38 @@ static void create_dynamic_shared_library_cleanup(
 static void make_table_of_contents(
     struct arch *arch,
     char *output);
+static void for_each_member_parallel(
+    struct arch *arch,
+    void (*func)(struct arch *arch, struct member *member));
+static void *member_thread(
+    void *arg);
+static void scan_member_toc(
+    struct arch *arch,
+    struct member *member);
+static enum bool malformed_toc_symbol(
+    struct arch *arch,
+    struct member *member,
+    uint32_t index,
+    enum bool print_warning);
+static void fill_member_toc(
+    struct arch *arch,
+    struct member *member);
 #ifdef LTO_SUPPORT
+static void scan_lto_member_toc(
+    struct member *member);
 static void save_lto_member_toc_info(
     struct member *member,
     void *mod);
+static void toc_cache_path(
+    struct member *member,
+    char *path,
+    size_t path_size);
+static enum bool read_toc_cache(
+    struct member *member,
+    char *path);
+static void write_toc_cache(
+    struct member *member,
+    char *path);
 #endif /* LTO_SUPPORT */
 static int toc_name_qsort(
     const struct toc *toc1,
@@ -381,6 +428,19 @@ char **envp)
 	else
 	    toc_time = 0;
 
+#ifdef LTO_SUPPORT
+	/*
+	 * The lto modules of bit code members are only created when their
+	 * symbols are needed for the table of contents, see
+	 * scan_lto_member_toc().  If CCTOOLS_TOC_CACHE is set to a directory
+	 * the symbols of bit code members are cached there.
+	 */
+	lto_defer_modules = 1;
+	toc_cache_dir = getenv("CCTOOLS_TOC_CACHE");
+	if(toc_cache_dir != NULL && *toc_cache_dir == '\0')
+	    toc_cache_dir = NULL;
+#endif /* LTO_SUPPORT */
+
 	numask = 0;
 	oumask = umask(numask);
 	toc_mode = S_IFREG | (0666 & ~oumask);
@@ -3609,141 +3669,33 @@ make_table_of_contents(
 struct arch *arch,
 char *output)
 {
-    uint32_t i, j, k, r, s, nsects, ncmds, n_strx;
+    uint32_t i, j;
     struct member *member;
-    struct load_command *lc;
-    struct segment_command *sg;
-    struct segment_command_64 *sg64;
-    struct nlist *symbols;
-    struct nlist_64 *symbols64;
-    char *strings;
-    enum bool sorted, is_toc_symbol;
+    enum bool sorted;
     char *ar_name;
-    struct section *section;
-    struct section_64 *section64;
-    uint8_t n_type, n_sect;
-#ifdef LTO_SUPPORT
-    char *lto_toc_string;
-#endif /* LTO_SUPPORT */
 
-	symbols = NULL;
-	symbols64 = NULL;
 	/*
 	 * First pass over the members to count how many ranlib structs are
-	 * needed and the size of the strings in the toc that are needed.
+	 * needed and the size of the strings in the toc that are needed.  The
+	 * symbol tables of the object members, and the lto modules of the bit
+	 * code members, are scanned on several threads by scan_member_toc()
+	 * and then the counts are added up and any warnings are printed here
+	 * in member order.  A bit code member whose lto module can't be
+	 * created is treated as not being an object file.
 	 */
+	for_each_member_parallel(arch, scan_member_toc);
 	for(i = 0; i < arch->nmembers; i++){
 	    member = arch->members + i;
 	    if(member->mh != NULL || member->mh64 != NULL){
-		nsects = 0;
-		lc = member->load_commands;
-		if(member->mh != NULL)
-		    ncmds = member->mh->ncmds;
-		else
-		    ncmds = member->mh64->ncmds;
-		for(j = 0; j < ncmds; j++){
-		    if(lc->cmd == LC_SYMTAB){
-			if(member->st == NULL)
-			    member->st = (struct symtab_command *)lc;
-		    }
-		    else if(lc->cmd == LC_SEGMENT){
-			sg = (struct segment_command *)lc;
-			nsects += sg->nsects;
-		    }
-		    else if(lc->cmd == LC_SEGMENT_64){
-			sg64 = (struct segment_command_64 *)lc;
-			nsects += sg64->nsects;
-		    }
-		    lc = (struct load_command *)((char *)lc + lc->cmdsize);
-		}
-		if(member->mh != NULL)
-		    member->sections = allocate(nsects *
-						sizeof(struct section *));
-		else
-		    member->sections64 = allocate(nsects *
-						  sizeof(struct section_64 *));
-		nsects = 0;
-		lc = member->load_commands;
-		for(j = 0; j < ncmds; j++){
-		    if(lc->cmd == LC_SEGMENT){
-			sg = (struct segment_command *)lc;
-			section = (struct section *)
-				  ((char *)sg + sizeof(struct segment_command));
-			for(k = 0; k < sg->nsects; k++){
-			    member->sections[nsects++] = section++;
-			}
-		    }
-		    else if(lc->cmd == LC_SEGMENT_64){
-			sg64 = (struct segment_command_64 *)lc;
-			section64 = (struct section_64 *)
-			    ((char *)sg64 + sizeof(struct segment_command_64));
-			for(k = 0; k < sg64->nsects; k++){
-			    member->sections64[nsects++] = section64++;
-			}
-		    }
-		    lc = (struct load_command *)((char *)lc + lc->cmdsize);
-		}
 		if(member->st != NULL && member->st->nsyms != 0){
-		    if(member->mh != NULL){
-			symbols = (struct nlist *)(member->object_addr +
-					           member->st->symoff);
-			if(member->object_byte_sex != get_host_byte_sex())
-			    swap_nlist(symbols, member->st->nsyms,
-				       get_host_byte_sex());
-		    }
-		    else{
-			symbols64 = (struct nlist_64 *)(member->object_addr +
-					                member->st->symoff);
-			if(member->object_byte_sex != get_host_byte_sex())
-			    swap_nlist_64(symbols64, member->st->nsyms,
-				          get_host_byte_sex());
-		    }
-		    strings = member->object_addr + member->st->stroff;
-		    for(j = 0; j < member->st->nsyms; j++){
-			if(member->mh != NULL){
-			    n_strx = symbols[j].n_un.n_strx;
-			    n_type = symbols[j].n_type;
-			    n_sect = symbols[j].n_sect;
-			}
-			else{
-			    n_strx = symbols64[j].n_un.n_strx;
-			    n_type = symbols64[j].n_type;
-			    n_sect = symbols64[j].n_sect;
-			}
-			if(n_strx > member->st->strsize){
-			    warn_member(arch, member, "malformed object "
-				"(symbol %u n_strx field extends past the "
-				"end of the string table)", j);
-			    errors++;
-			    continue;
-			}
-			if((n_type & N_TYPE) == N_SECT){
-			    if(n_sect == NO_SECT){
-				warn_member(arch, member, "malformed object "
-				    "(symbol %u must not have NO_SECT for its "
-				    "n_sect field given its type (N_SECT))", j);
-				errors++;
-				continue;
-			    }
-			    if(n_sect > nsects){
-				warn_member(arch, member, "malformed object "
-				    "(symbol %u n_sect field greater than the "
-				    "number of sections in the file)", j);
-				errors++;
-				continue;
-			    }
-			}
-			if(member->mh != NULL)
-			    is_toc_symbol = toc_symbol(symbols + j,
-						       member->sections);
-			else
-			    is_toc_symbol = toc_symbol_64(symbols64 + j,
-						          member->sections64);
-			if(is_toc_symbol == TRUE){
-			    arch->toc_nranlibs++;
-			    arch->toc_strsize += strlen(strings + n_strx) + 1;
-			}
+		    if(member->toc_malformed == TRUE){
+			for(j = 0; j < member->st->nsyms; j++)
+			    (void)malformed_toc_symbol(arch, member, j, TRUE);
 		    }
+		    member->toc_index = arch->toc_nranlibs;
+		    member->toc_stroff = arch->toc_strsize;
+		    arch->toc_nranlibs += member->toc_nsyms;
+		    arch->toc_strsize += member->toc_strsize;
 		}
 		else{
 		    if(cmd_flags.no_warning_for_no_symbols == FALSE)
@@ -3751,7 +3703,10 @@ char *output)
 		}
 	    }
 #ifdef LTO_SUPPORT
-	    else if(member->lto_contents == TRUE){
+	    else if(member->lto_contents == TRUE &&
+		    member->lto_toc_failed == FALSE){
+		member->toc_index = arch->toc_nranlibs;
+		member->toc_stroff = arch->toc_strsize;
 		arch->toc_nranlibs += member->lto_toc_nsyms;
 		arch->toc_strsize += member->lto_toc_strsize;
 	    }
@@ -3779,72 +3734,11 @@ char *output)
 
 	/*
 	 * Second pass over the members to fill in the toc structs and
-	 * the strings for the table of contents.  The toc name field is
-	 * filled in with a pointer to a string contained in arch->toc_strings
-	 * for easy sorting and conversion to an index.  The toc index1 field is
-	 * filled in with the member index plus one to allow marking with it's
-	 * negative value by check_sort_tocs() and easy conversion to the
-	 * real offset.
+	 * the strings for the table of contents.  Each member fills in its
+	 * own part starting at the toc_index and toc_stroff set above, so
+	 * this is also done on several threads by fill_member_toc().
 	 */
-	r = 0;
-	s = 0;
-	for(i = 0; i < arch->nmembers; i++){
-	    member = arch->members + i;
-	    if(member->mh != NULL || member->mh64 != NULL){
-		if(member->st != NULL && member->st->nsyms != 0){
-		    if(member->mh != NULL)
-			symbols = (struct nlist *)(member->object_addr +
-					           member->st->symoff);
-		    else
-			symbols64 = (struct nlist_64 *)(member->object_addr +
-					                member->st->symoff);
-		    strings = member->object_addr + member->st->stroff;
-		    for(j = 0; j < member->st->nsyms; j++){
-			if(member->mh != NULL)
-			    n_strx = symbols[j].n_un.n_strx;
-			else
-			    n_strx = symbols64[j].n_un.n_strx;
-			if(n_strx > member->st->strsize)
-			    continue;
-			if(member->mh != NULL)
-			    is_toc_symbol = toc_symbol(symbols + j,
-						       member->sections);
-			else
-			    is_toc_symbol = toc_symbol_64(symbols64 + j,
-						          member->sections64);
-			if(is_toc_symbol == TRUE){
-			    strcpy(arch->toc_strings + s,
-				   strings + n_strx);
-			    arch->tocs[r].name = arch->toc_strings + s;
-			    arch->tocs[r].index1 = i + 1;
-			    r++;
-			    s += strlen(strings + n_strx) + 1;
-			}
-		    }
-		    if(member->object_byte_sex != get_host_byte_sex()){
-			if(member->mh != NULL)
-			    swap_nlist(symbols, member->st->nsyms,
-				       member->object_byte_sex);
-			else
-			    swap_nlist_64(symbols64, member->st->nsyms,
-				          member->object_byte_sex);
-		    }
-		}
-	    }
-#ifdef LTO_SUPPORT
-	    else if(member->lto_contents == TRUE){
-		lto_toc_string = member->lto_toc_strings;
-		for(j = 0; j < member->lto_toc_nsyms; j++){
-		    strcpy(arch->toc_strings + s, lto_toc_string);
-		    arch->tocs[r].name = arch->toc_strings + s;
-		    arch->tocs[r].index1 = i + 1;
-		    r++;
-		    s += strlen(lto_toc_string) + 1;
-		    lto_toc_string += strlen(lto_toc_string) + 1;
-		}
-	    }
-#endif /* LTO_SUPPORT */
-	}
+	for_each_member_parallel(arch, fill_member_toc);
 
 	/*
 	 * If the table of contents is to be sorted by symbol name then try to
@@ -4058,12 +3952,376 @@ char *output)
 	       (int)sizeof(arch->toc_ar_hdr.ar_fmag));
 }
 
+/*
+ * The number of members a thread takes at a time from the members of an arch
+ * in for_each_member_parallel() and the least number of members an arch must
+ * have for more than one thread to be used.
+ */
+#define MEMBERS_PER_THREAD_BLOCK 16
+#define MIN_MEMBERS_FOR_THREADS 64
+
+struct member_work {
+    struct arch *arch;
+    void (*func)(struct arch *arch, struct member *member);
+    uint32_t next_member;	/* next member to be taken by a thread */
+    pthread_mutex_t lock;
+};
+
+/*
+ * for_each_member_parallel() calls func on each of the members of the arch
+ * using ofile_thread_count() threads.  The func must only change the member it is
+ * passed and must not print anything or change errors.
+ */
+static
+void
+for_each_member_parallel(
+struct arch *arch,
+void (*func)(struct arch *arch, struct member *member))
+{
+    struct member_work work;
+    pthread_t *threads;
+    uint32_t i, nthreads, nstarted;
+
+	nthreads = ofile_thread_count();
+	if(nthreads > arch->nmembers / MEMBERS_PER_THREAD_BLOCK)
+	    nthreads = arch->nmembers / MEMBERS_PER_THREAD_BLOCK;
+	if(nthreads <= 1 || arch->nmembers < MIN_MEMBERS_FOR_THREADS){
+	    for(i = 0; i < arch->nmembers; i++)
+		func(arch, arch->members + i);
+	    return;
+	}
+
+	work.arch = arch;
+	work.func = func;
+	work.next_member = 0;
+	pthread_mutex_init(&work.lock, NULL);
+	threads = allocate(sizeof(pthread_t) * (nthreads - 1));
+	nstarted = 0;
+	for(i = 0; i < nthreads - 1; i++){
+	    if(pthread_create(threads + nstarted, NULL, member_thread,
+			      &work) != 0)
+		break;
+	    nstarted++;
+	}
+	/* this thread does its share too */
+	(void)member_thread(&work);
+	for(i = 0; i < nstarted; i++)
+	    pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&work.lock);
+}
+
+/*
+ * member_thread() is the start routine of the threads created by
+ * for_each_member_parallel().  It takes blocks of members until there are
+ * none left.
+ */
+static
+void *
+member_thread(
+void *arg)
+{
+    struct member_work *work;
+    uint32_t i, first, last;
+
+	work = (struct member_work *)arg;
+	for(;;){
+	    pthread_mutex_lock(&work->lock);
+	    first = work->next_member;
+	    last = first + MEMBERS_PER_THREAD_BLOCK;
+	    if(last > work->arch->nmembers)
+		last = work->arch->nmembers;
+	    work->next_member = last;
+	    pthread_mutex_unlock(&work->lock);
+	    if(first == last)
+		return(NULL);
+	    for(i = first; i < last; i++)
+		work->func(work->arch, work->arch->members + i);
+	}
+}
+
+/*
+ * scan_member_toc() is called by make_table_of_contents() for each member to
+ * set up the member's section pointers and count the symbols and the size of
+ * their strings that are to be in the table of contents.  The symbols of the
+ * member are swapped to the host byte sex and are swapped back by
+ * fill_member_toc().  If a symbol is malformed it is left out and
+ * toc_malformed is set so the caller can print the warnings for it.
+ */
+static
+void
+scan_member_toc(
+struct arch *arch,
+struct member *member)
+{
+    uint32_t j, k, nsects, ncmds, n_strx;
+    struct load_command *lc;
+    struct segment_command *sg;
+    struct segment_command_64 *sg64;
+    struct nlist *symbols;
+    struct nlist_64 *symbols64;
+    char *strings;
+    enum bool is_toc_symbol;
+    struct section *section;
+    struct section_64 *section64;
+
+	member->toc_nsyms = 0;
+	member->toc_strsize = 0;
+	member->toc_malformed = FALSE;
+#ifdef LTO_SUPPORT
+	if(member->lto_toc_pending == TRUE){
+	    scan_lto_member_toc(member);
+	    return;
+	}
+#endif /* LTO_SUPPORT */
+	if(member->mh == NULL && member->mh64 == NULL)
+	    return;
+
+	nsects = 0;
+	lc = member->load_commands;
+	if(member->mh != NULL)
+	    ncmds = member->mh->ncmds;
+	else
+	    ncmds = member->mh64->ncmds;
+	for(j = 0; j < ncmds; j++){
+	    if(lc->cmd == LC_SYMTAB){
+		if(member->st == NULL)
+		    member->st = (struct symtab_command *)lc;
+	    }
+	    else if(lc->cmd == LC_SEGMENT){
+		sg = (struct segment_command *)lc;
+		nsects += sg->nsects;
+	    }
+	    else if(lc->cmd == LC_SEGMENT_64){
+		sg64 = (struct segment_command_64 *)lc;
+		nsects += sg64->nsects;
+	    }
+	    lc = (struct load_command *)((char *)lc + lc->cmdsize);
+	}
+	if(member->mh != NULL)
+	    member->sections = allocate(nsects * sizeof(struct section *));
+	else
+	    member->sections64 = allocate(nsects * sizeof(struct section_64 *));
+	member->nsects = nsects;
+	nsects = 0;
+	lc = member->load_commands;
+	for(j = 0; j < ncmds; j++){
+	    if(lc->cmd == LC_SEGMENT){
+		sg = (struct segment_command *)lc;
+		section = (struct section *)
+			  ((char *)sg + sizeof(struct segment_command));
+		for(k = 0; k < sg->nsects; k++){
+		    member->sections[nsects++] = section++;
+		}
+	    }
+	    else if(lc->cmd == LC_SEGMENT_64){
+		sg64 = (struct segment_command_64 *)lc;
+		section64 = (struct section_64 *)
+		    ((char *)sg64 + sizeof(struct segment_command_64));
+		for(k = 0; k < sg64->nsects; k++){
+		    member->sections64[nsects++] = section64++;
+		}
+	    }
+	    lc = (struct load_command *)((char *)lc + lc->cmdsize);
+	}
+	if(member->st == NULL || member->st->nsyms == 0)
+	    return;
+
+	symbols = NULL;
+	symbols64 = NULL;
+	if(member->mh != NULL){
+	    symbols = (struct nlist *)(member->object_addr +
+				       member->st->symoff);
+	    if(member->object_byte_sex != get_host_byte_sex())
+		swap_nlist(symbols, member->st->nsyms, get_host_byte_sex());
+	}
+	else{
+	    symbols64 = (struct nlist_64 *)(member->object_addr +
+					    member->st->symoff);
+	    if(member->object_byte_sex != get_host_byte_sex())
+		swap_nlist_64(symbols64, member->st->nsyms,
+			      get_host_byte_sex());
+	}
+	strings = member->object_addr + member->st->stroff;
+	for(j = 0; j < member->st->nsyms; j++){
+	    if(malformed_toc_symbol(arch, member, j, FALSE) == TRUE){
+		member->toc_malformed = TRUE;
+		continue;
+	    }
+	    if(member->mh != NULL){
+		n_strx = symbols[j].n_un.n_strx;
+		is_toc_symbol = toc_symbol(symbols + j, member->sections);
+	    }
+	    else{
+		n_strx = symbols64[j].n_un.n_strx;
+		is_toc_symbol = toc_symbol_64(symbols64 + j,
+					      member->sections64);
+	    }
+	    if(is_toc_symbol == TRUE){
+		member->toc_nsyms++;
+		member->toc_strsize += strlen(strings + n_strx) + 1;
+	    }
+	}
+}
+
+/*
+ * malformed_toc_symbol() returns TRUE if the symbol at index in the member's
+ * symbol table, which must be in the host byte sex, is malformed.  If
+ * print_warning is TRUE it also prints a warning about it and counts it as an
+ * error.
+ */
+static
+enum bool
+malformed_toc_symbol(
+struct arch *arch,
+struct member *member,
+uint32_t index,
+enum bool print_warning)
+{
+    uint32_t n_strx;
+    uint8_t n_type, n_sect;
+    struct nlist *symbols;
+    struct nlist_64 *symbols64;
+
+	if(member->mh != NULL){
+	    symbols = (struct nlist *)(member->object_addr +
+				       member->st->symoff);
+	    n_strx = symbols[index].n_un.n_strx;
+	    n_type = symbols[index].n_type;
+	    n_sect = symbols[index].n_sect;
+	}
+	else{
+	    symbols64 = (struct nlist_64 *)(member->object_addr +
+					    member->st->symoff);
+	    n_strx = symbols64[index].n_un.n_strx;
+	    n_type = symbols64[index].n_type;
+	    n_sect = symbols64[index].n_sect;
+	}
+	if(n_strx > member->st->strsize){
+	    if(print_warning == TRUE){
+		warn_member(arch, member, "malformed object (symbol %u n_strx "
+		    "field extends past the end of the string table)", index);
+		errors++;
+	    }
+	    return(TRUE);
+	}
+	if((n_type & N_TYPE) == N_SECT){
+	    if(n_sect == NO_SECT){
+		if(print_warning == TRUE){
+		    warn_member(arch, member, "malformed object (symbol %u "
+			"must not have NO_SECT for its n_sect field given its "
+			"type (N_SECT))", index);
+		    errors++;
+		}
+		return(TRUE);
+	    }
+	    if(n_sect > member->nsects){
+		if(print_warning == TRUE){
+		    warn_member(arch, member, "malformed object (symbol %u "
+			"n_sect field greater than the number of sections in "
+			"the file)", index);
+		    errors++;
+		}
+		return(TRUE);
+	    }
+	}
+	return(FALSE);
+}
+
+/*
+ * fill_member_toc() is called by make_table_of_contents() for each member to
+ * fill in the member's toc structs and strings starting at the toc_index and
+ * toc_stroff of the member.  The toc name field is filled in with a pointer to
+ * a string contained in arch->toc_strings for easy sorting and conversion to
+ * an index.  The toc index1 field is filled in with the member index plus one
+ * to allow marking with it's negative value by check_sort_tocs() and easy
+ * conversion to the real offset.
+ */
+static
+void
+fill_member_toc(
+struct arch *arch,
+struct member *member)
+{
+    uint32_t j, n_strx;
+    uint64_t r, s;
+    int64_t index1;
+    struct nlist *symbols;
+    struct nlist_64 *symbols64;
+    char *strings;
+    enum bool is_toc_symbol;
+#ifdef LTO_SUPPORT
+    char *lto_toc_string;
+#endif /* LTO_SUPPORT */
+
+	r = member->toc_index;
+	s = member->toc_stroff;
+	index1 = (member - arch->members) + 1;
+	if(member->mh != NULL || member->mh64 != NULL){
+	    if(member->st != NULL && member->st->nsyms != 0){
+		symbols = NULL;
+		symbols64 = NULL;
+		if(member->mh != NULL)
+		    symbols = (struct nlist *)(member->object_addr +
+					       member->st->symoff);
+		else
+		    symbols64 = (struct nlist_64 *)(member->object_addr +
+						    member->st->symoff);
+		strings = member->object_addr + member->st->stroff;
+		for(j = 0; j < member->st->nsyms; j++){
+		    if(member->mh != NULL)
+			n_strx = symbols[j].n_un.n_strx;
+		    else
+			n_strx = symbols64[j].n_un.n_strx;
+		    if(n_strx > member->st->strsize)
+			continue;
+		    if(member->mh != NULL)
+			is_toc_symbol = toc_symbol(symbols + j,
+						   member->sections);
+		    else
+			is_toc_symbol = toc_symbol_64(symbols64 + j,
+						      member->sections64);
+		    if(is_toc_symbol == TRUE){
+			strcpy(arch->toc_strings + s, strings + n_strx);
+			arch->tocs[r].name = arch->toc_strings + s;
+			arch->tocs[r].index1 = index1;
+			r++;
+			s += strlen(strings + n_strx) + 1;
+		    }
+		}
+		if(member->object_byte_sex != get_host_byte_sex()){
+		    if(member->mh != NULL)
+			swap_nlist(symbols, member->st->nsyms,
+				   member->object_byte_sex);
+		    else
+			swap_nlist_64(symbols64, member->st->nsyms,
+				      member->object_byte_sex);
+		}
+	    }
+	}
+#ifdef LTO_SUPPORT
+	else if(member->lto_contents == TRUE){
+	    lto_toc_string = member->lto_toc_strings;
+	    for(j = 0; j < member->lto_toc_nsyms; j++){
+		strcpy(arch->toc_strings + s, lto_toc_string);
+		arch->tocs[r].name = arch->toc_strings + s;
+		arch->tocs[r].index1 = index1;
+		r++;
+		s += strlen(lto_toc_string) + 1;
+		lto_toc_string += strlen(lto_toc_string) + 1;
+	    }
+	}
+#endif /* LTO_SUPPORT */
+}
+
 #ifdef LTO_SUPPORT
 /*
  * save_lto_member_toc_info() saves away the table of contents info for a
  * member that has lto_content.  This allows the lto module to be disposed of
  * after reading to keep only on in memory at a time.  As these turn out to
- * use a lot of memory.
+ * use a lot of memory.  If the module is LTO_DEFERRED_MODULE the member is
+ * only marked so scan_lto_member_toc() does this when the table of contents
+ * is made.
  */
 static
 void
@@ -4074,6 +4332,11 @@ void *mod)
     uint32_t i, nsyms;
     char *s;
 
+	if(mod == LTO_DEFERRED_MODULE){
+	    member->lto_toc_pending = TRUE;
+	    return;
+	}
+	member->lto_toc_pending = FALSE;
         member->lto_toc_nsyms = 0;
 	nsyms = lto_get_nsyms(mod);
 	for(i = 0; i < nsyms; i++){
@@ -4091,6 +4354,192 @@ void *mod)
 	    }
 	}
 }
+
+/*
+ * scan_lto_member_toc() is called by scan_member_toc(), maybe on several
+ * threads, for a bit code member whose lto module was not created when it was
+ * added.  It gets the table of contents symbols from the toc cache if they
+ * are there, else it creates the lto module to get them and then saves them
+ * in the toc cache.  If the module can't be created lto_toc_failed is set for
+ * make_table_of_contents() to report.
+ */
+static
+void
+scan_lto_member_toc(
+struct member *member)
+{
+    char path[MAXPATHLEN];
+    void *mod;
+
+	path[0] = '\0';
+	if(toc_cache_dir != NULL){
+	    toc_cache_path(member, path, sizeof(path));
+	    if(path[0] != '\0' && read_toc_cache(member, path) == TRUE){
+		member->lto_toc_pending = FALSE;
+		return;
+	    }
+	}
+	mod = lto_create_module(member->object_addr, member->object_size);
+	if(mod == NULL){
+	    member->lto_toc_failed = TRUE;
+	    return;
+	}
+	save_lto_member_toc_info(member, mod);
+	lto_free(mod);
+	if(path[0] != '\0')
+	    write_toc_cache(member, path);
+}
+
+/*
+ * The files in the toc cache start with this header which is followed by the
+ * strsize bytes of the nsyms null terminated symbol names.
+ */
+#define TOC_CACHE_MAGIC "cctoc001"
+struct toc_cache_header {
+    char magic[8];
+    uint32_t nsyms;
+    uint32_t strsize;
+};
+
+static
+uint64_t
+toc_cache_mix(
+uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return(h);
+}
+
+/*
+ * toc_cache_path() sets path to the name of the toc cache file for the
+ * member.  The name is made from a 128-bit hash of the member's contents,
+ * the size of the member and if common symbols are in the table of contents
+ * (the -c flag).  The hash is not a cryptographic one, the cache is only
+ * meant to tell apart the members a build makes.  If the name does not fit
+ * path is set to the empty string.
+ */
+static
+void
+toc_cache_path(
+struct member *member,
+char *path,
+size_t path_size)
+{
+    uint64_t h1, h2, w;
+    uint32_t i;
+    int n;
+
+	h1 = 0x9e3779b97f4a7c15ULL ^ member->object_size;
+	h2 = 0xc2b2ae3d27d4eb4fULL + member->object_size;
+	for(i = 0; i + 8 <= member->object_size; i += 8){
+	    memcpy(&w, member->object_addr + i, 8);
+	    h1 ^= toc_cache_mix(w);
+	    h1 = ((h1 << 27) | (h1 >> 37)) * 0x87c37b91114253d5ULL + h2;
+	    h2 += w;
+	    h2 = ((h2 << 31) | (h2 >> 33)) * 0x4cf5ad432745937fULL ^ h1;
+	}
+	w = 0;
+	memcpy(&w, member->object_addr + i, member->object_size - i);
+	h1 = toc_cache_mix(h1 ^ toc_cache_mix(w));
+	h2 = toc_cache_mix(h2 + w + h1);
+
+	n = snprintf(path, path_size, "%s/%016llx%016llx-%x%s", toc_cache_dir,
+		     (unsigned long long)h1, (unsigned long long)h2,
+		     (unsigned int)member->object_size,
+		     cmd_flags.c == TRUE ? "-c" : "");
+	if(n < 0 || (size_t)n >= path_size)
+	    path[0] = '\0';
+}
+
+/*
+ * read_toc_cache() reads the toc cache file path and sets the member's lto
+ * table of contents info from it.  It returns TRUE if it did and FALSE if the
+ * file is not there or not a valid toc cache file.
+ */
+static
+enum bool
+read_toc_cache(
+struct member *member,
+char *path)
+{
+    int fd;
+    struct stat stat_buf;
+    struct toc_cache_header header;
+    char *strings;
+    uint32_t i, nsyms;
+
+	if((fd = open(path, O_RDONLY)) == -1)
+	    return(FALSE);
+	if(fstat(fd, &stat_buf) == -1 ||
+	   stat_buf.st_size < (off_t)sizeof(struct toc_cache_header) ||
+	   read(fd, &header, sizeof(struct toc_cache_header)) !=
+		sizeof(struct toc_cache_header) ||
+	   memcmp(header.magic, TOC_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+	   stat_buf.st_size != (off_t)(sizeof(struct toc_cache_header) +
+				       header.strsize)){
+	    close(fd);
+	    return(FALSE);
+	}
+	strings = allocate(header.strsize);
+	if(read(fd, strings, header.strsize) != (ssize_t)header.strsize){
+	    free(strings);
+	    close(fd);
+	    return(FALSE);
+	}
+	close(fd);
+	nsyms = 0;
+	for(i = 0; i < header.strsize; i++)
+	    if(strings[i] == '\0')
+		nsyms++;
+	if(nsyms != header.nsyms ||
+	   (header.strsize != 0 && strings[header.strsize - 1] != '\0')){
+	    free(strings);
+	    return(FALSE);
+	}
+	member->lto_toc_nsyms = header.nsyms;
+	member->lto_toc_strsize = header.strsize;
+	member->lto_toc_strings = strings;
+	return(TRUE);
+}
+
+/*
+ * write_toc_cache() writes the member's lto table of contents info to the
+ * toc cache file path.  It is written to a temporary file that is then
+ * renamed so other processes never see a partly written file.  Any failure is
+ * ignored, the cache is only there to save time.
+ */
+static
+void
+write_toc_cache(
+struct member *member,
+char *path)
+{
+    int fd;
+    char tmp_path[MAXPATHLEN];
+    struct toc_cache_header header;
+    enum bool written;
+
+	if(snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path) >=
+	   (int)sizeof(tmp_path))
+	    return;
+	if((fd = mkstemp(tmp_path)) == -1)
+	    return;
+	memcpy(header.magic, TOC_CACHE_MAGIC, sizeof(header.magic));
+	header.nsyms = member->lto_toc_nsyms;
+	header.strsize = member->lto_toc_strsize;
+	written = write(fd, &header, sizeof(struct toc_cache_header)) ==
+			sizeof(struct toc_cache_header) &&
+		  write(fd, member->lto_toc_strings, header.strsize) ==
+			(ssize_t)header.strsize;
+	if(close(fd) == -1)
+	    written = FALSE;
+	if(written == FALSE || rename(tmp_path, path) == -1)
+	    unlink(tmp_path);
+}
 #endif /* LTO_SUPPORT */
 
 /*
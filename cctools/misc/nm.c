@@ -88,6 +88,7 @@
 #include <ctype.h>
 #include <libc.h>
 #include <dlfcn.h>
+#include <pthread.h>
 #include <mach-o/loader.h>
 #include <mach-o/nlist.h>
 #include <mach-o/stab.h>
@@ -138,9 +139,13 @@ struct cmd_flags {
 };
 /* These need to be static because of the qsort compare function */
 static struct cmd_flags cmd_flags = { 0 };
-static char *strings = NULL;
-static uint32_t strsize = 0;
-static enum bool compare_lto = FALSE;
+#ifdef LTO_SUPPORT
+/*
+ * nm_llvm_bundle() uses libxar and the lto library which are not known to be
+ * thread safe, so calls to it from the parallel nm() workers are serialized.
+ */
+static pthread_mutex_t llvm_bundle_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif /* LTO_SUPPORT */
 
 /* flags set by processing a specific object file */
 struct process_flags {
@@ -177,23 +182,27 @@ static void usage(
 static void nm(
     struct ofile *ofile,
     char *arch_name,
-    void *cookie);
+    void *cookie,
+    FILE *output);
 #ifdef LTO_SUPPORT
 static void nm_lto(
     struct ofile *ofile,
     char *arch_name,
-    struct cmd_flags *cmd_flags);
+    struct cmd_flags *cmd_flags,
+    FILE *output);
 static void nm_llvm_bundle(
     char *llvm_bundle_pointer,
     uint64_t llvm_bundle_size,
     struct ofile *ofile,
     char *arch_name,
-    struct cmd_flags *cmd_flags);
+    struct cmd_flags *cmd_flags,
+    FILE *output);
 #endif /* LTO_SUPPORT */
 static void print_header(
     struct ofile *ofile,
     char *arch_name,
-    struct cmd_flags *cmd_flags);
+    struct cmd_flags *cmd_flags,
+    FILE *output);
 static struct symbol *select_symbols(
     struct ofile *ofile,
     struct symtab_command *st,
@@ -219,7 +228,8 @@ static void print_mach_symbols(
     uint32_t strsize,
     struct cmd_flags *cmd_flags,
     struct process_flags *process_flags,
-    char *arch_name);
+    char *arch_name,
+    FILE *output);
 static void print_symbols(
     struct ofile *ofile,
     struct symbol *symbols,
@@ -229,9 +239,11 @@ static void print_symbols(
     struct cmd_flags *cmd_flags,
     struct process_flags *process_flags,
     char *arch_name,
-    struct value_diff *value_diffs);
+    struct value_diff *value_diffs,
+    FILE *output);
 static char * stab(
-    unsigned char n_type);
+    unsigned char n_type,
+    char *prbuf);
 static int compare(
     struct symbol *p1,
     struct symbol *p2);
@@ -460,12 +472,15 @@ char **envp)
 	    files[cmd_flags.nfiles++] = argv[i];
 	}
 
-	for(j = 0; j < cmd_flags.nfiles; j++)
-	    ofile_process(files[j], arch_flags, narch_flags, all_archs, TRUE,
-			  cmd_flags.f, TRUE, nm, &cmd_flags);
+	/*
+	 * The files and their members are processed in parallel and the output
+	 * for each is printed in the same order as if done one at a time.
+	 */
 	if(cmd_flags.nfiles == 0)
-	    ofile_process("a.out",  arch_flags, narch_flags, all_archs, TRUE,
-			  cmd_flags.f, TRUE, nm, &cmd_flags);
+	    files[cmd_flags.nfiles++] = "a.out";
+	ofile_process_parallel(files, cmd_flags.nfiles, arch_flags, narch_flags,
+			       all_archs, TRUE, cmd_flags.f, TRUE, nm,
+			       &cmd_flags, 0);
 
 	if(errors == 0)
 	    return(EXIT_SUCCESS);
@@ -499,7 +514,8 @@ void
 nm(
 struct ofile *ofile,
 char *arch_name,
-void *cookie)
+void *cookie,
+FILE *output)
 {
     uint32_t ncmds, mh_flags;
     struct cmd_flags *cmd_flags;
@@ -517,6 +533,7 @@ void *cookie)
     struct symbol *symbols;
     uint32_t nsymbols;
     struct value_diff *value_diffs;
+    char *strings;
 
     char *short_name, *has_suffix;
     enum bool is_framework;
@@ -552,7 +569,7 @@ void *cookie)
 	if(ofile->mh == NULL && ofile->mh64 == NULL){
 #ifdef LTO_SUPPORT
 	    if(ofile->lto != NULL)
-		nm_lto(ofile, arch_name, cmd_flags);
+		nm_lto(ofile, arch_name, cmd_flags, output);
 #endif /* LTO_SUPPORT */
 	    return;
 	}
@@ -722,9 +739,12 @@ void *cookie)
 	}
 	if(st == NULL || st->nsyms == 0){
 #ifdef LTO_SUPPORT
-	    if(llvm_bundle_found == TRUE)
+	    if(llvm_bundle_found == TRUE){
+		pthread_mutex_lock(&llvm_bundle_mutex);
 		nm_llvm_bundle(llvm_bundle_pointer, llvm_bundle_size,
-			       ofile, arch_name, cmd_flags);
+			       ofile, arch_name, cmd_flags, output);
+		pthread_mutex_unlock(&llvm_bundle_mutex);
+	    }
 	    else
 #endif /* LTO_SUPPORT */
 		warning("no name list");
@@ -732,8 +752,10 @@ void *cookie)
 	}
 #ifdef LTO_SUPPORT
 	else if(cmd_flags->L && llvm_bundle_found == TRUE){
+	    pthread_mutex_lock(&llvm_bundle_mutex);
 	    nm_llvm_bundle(llvm_bundle_pointer, llvm_bundle_size,
-			   ofile, arch_name, cmd_flags);
+			   ofile, arch_name, cmd_flags, output);
+	    pthread_mutex_unlock(&llvm_bundle_mutex);
 	    return;
 	}
 #endif /* LTO_SUPPORT */
@@ -769,9 +791,19 @@ void *cookie)
 
 	/* set names in the symbols to be printed */
 	strings = ofile->object_addr + st->stroff;
-	strsize = st->strsize;
-	compare_lto = FALSE;
-	if(cmd_flags->x == FALSE){
+	if(cmd_flags->x == TRUE){
+	    /*
+	     * With -x the names are only used by compare() so a bad string
+	     * index is left as NULL which sorts before everything else.
+	     */
+	    for(i = 0; i < nsymbols; i++){
+		if((uint32_t)symbols[i].nl.n_un.n_strx > st->strsize)
+		    symbols[i].name = NULL;
+		else
+		    symbols[i].name = symbols[i].nl.n_un.n_strx + strings;
+	    }
+	}
+	else{
 	    for(i = 0; i < nsymbols; i++){
 		if(symbols[i].nl.n_un.n_strx == 0)
 		    symbols[i].name = "";
@@ -806,7 +838,7 @@ void *cookie)
 	}
 
 	/* print header if needed */
-	print_header(ofile, arch_name, cmd_flags);
+	print_header(ofile, arch_name, cmd_flags, output);
 
 	/* sort the symbols if needed */
 	if(cmd_flags->p == FALSE && cmd_flags->b == FALSE)
@@ -836,10 +868,11 @@ void *cookie)
 	/* now print the symbols as specified by the flags */
 	if(cmd_flags->m == TRUE)
 	    print_mach_symbols(ofile, symbols, nsymbols, strings, st->strsize,
-			       cmd_flags, &process_flags, arch_name);
+			       cmd_flags, &process_flags, arch_name, output);
 	else
 	    print_symbols(ofile, symbols, nsymbols, strings, st->strsize,
-			  cmd_flags, &process_flags, arch_name, value_diffs);
+			  cmd_flags, &process_flags, arch_name, value_diffs,
+			  output);
 
 	free(symbols);
 	if(process_flags.sections != NULL){
@@ -885,7 +918,8 @@ void
 nm_lto(
 struct ofile *ofile,
 char *arch_name,
-struct cmd_flags *cmd_flags)
+struct cmd_flags *cmd_flags,
+FILE *output)
 {
     uint32_t nsyms, nsymbols, i;
     struct symbol symbol, *symbols;
@@ -931,12 +965,7 @@ struct cmd_flags *cmd_flags)
 		symbols[nsymbols++] = symbol;
 	}
 
-	print_header(ofile, arch_name, cmd_flags);
-
-	/* reset these as the can be used by compare() with -x */
-	strings = NULL;
-	strsize = 0;
-	compare_lto = TRUE;
+	print_header(ofile, arch_name, cmd_flags, output);
 
 	/* sort the symbols if needed */
 	if(cmd_flags->p == FALSE)
@@ -946,10 +975,10 @@ struct cmd_flags *cmd_flags)
 	/* now print the symbols as specified by the flags */
 	if(cmd_flags->m == TRUE)
 	    print_mach_symbols(ofile, symbols, nsymbols, NULL, 0,
-			       cmd_flags, &process_flags, arch_name);
+			       cmd_flags, &process_flags, arch_name, output);
 	else
 	    print_symbols(ofile, symbols, nsymbols, NULL, 0,
-			  cmd_flags, &process_flags, arch_name, NULL);
+			  cmd_flags, &process_flags, arch_name, NULL, output);
 
 	free(symbols);
 }
@@ -990,7 +1019,8 @@ char *llvm_bundle_pointer,
 uint64_t llvm_bundle_size,
 struct ofile *ofile,
 char *arch_name,
-struct cmd_flags *cmd_flags)
+struct cmd_flags *cmd_flags,
+FILE *output)
 {
     uint32_t r, bufsize;
     char *p, *prefix, *xar_path, buf[MAXPATHLEN], resolved_name[PATH_MAX];
@@ -1216,7 +1246,7 @@ uint32_t nprops, maxprops;
 			 * nm_lto() to get its symbols printed.
 			 */
 			if(is_llvm_bitcode(ofile, buffer, xar_member_size)){
-			    nm_lto(ofile, arch_name, cmd_flags);
+			    nm_lto(ofile, arch_name, cmd_flags, output);
 			    lto_free(ofile->lto);
 			    ofile->lto = NULL;
 			    ofile->lto_cputype = 0;
@@ -1230,7 +1260,8 @@ uint32_t nprops, maxprops;
 				       ofile->xar_member_name);
 #endif
 				nm_llvm_bundle(buffer, xar_member_size,
-					       ofile, arch_name, cmd_flags);
+					       ofile, arch_name, cmd_flags,
+					       output);
 			    }
 			}
 			if(old_xar_member_name != NULL)
@@ -1253,7 +1284,8 @@ void
 print_header(
 struct ofile *ofile,
 char *arch_name,
-struct cmd_flags *cmd_flags)
+struct cmd_flags *cmd_flags,
+FILE *output)
 {
 	if((ofile->member_ar_hdr != NULL ||
 	    ofile->dylib_module_name != NULL ||
@@ -1262,21 +1294,23 @@ struct cmd_flags *cmd_flags)
 	    arch_name != NULL) &&
 	    (cmd_flags->o == FALSE && cmd_flags->A == FALSE)){
 	    if(ofile->dylib_module_name != NULL){
-		printf("\n%s(%s)", ofile->file_name, ofile->dylib_module_name);
+		fprintf(output, "\n%s(%s)", ofile->file_name,
+			ofile->dylib_module_name);
 	    }
 	    else if(ofile->member_ar_hdr != NULL){
-		printf("\n%s(%.*s)", ofile->file_name,
+		fprintf(output, "\n%s(%.*s)", ofile->file_name,
 		       (int)ofile->member_name_size, ofile->member_name);
 	    }
 	    else if(ofile->xar_member_name != NULL){
-		printf("\n%s[%s]", ofile->file_name, ofile->xar_member_name);
+		fprintf(output, "\n%s[%s]", ofile->file_name,
+			ofile->xar_member_name);
 	    }
 	    else
-		printf("\n%s", ofile->file_name);
+		fprintf(output, "\n%s", ofile->file_name);
 	    if(arch_name != NULL)
-		printf(" (for architecture %s):\n", arch_name);
+		fprintf(output, " (for architecture %s):\n", arch_name);
 	    else
-		printf(":\n");
+		fprintf(output, ":\n");
 	}
 }
 
@@ -1304,6 +1338,7 @@ uint32_t *nsymbols)
     struct dylib_reference *refs;
     enum bool found;
     uint32_t irefsym, nrefsym, nextdefsym, iextdefsym, nlocalsym, ilocalsym;
+    char *strings;
 
 	if(ofile->mh != NULL){
 	    all_symbols = (struct nlist *)(ofile->object_addr + st->symoff);
@@ -1540,11 +1575,13 @@ char *strings,
 uint32_t strsize,
 struct cmd_flags *cmd_flags,
 struct process_flags *process_flags,
-char *arch_name)
+char *arch_name,
+FILE *output)
 {
     uint32_t i, library_ordinal;
     char *ta_xfmt, *i_xfmt, *dashes, *spaces;
     uint32_t mh_flags;
+    char prbuf[32];
 
 	mh_flags = 0;
 	if(ofile->mh != NULL ||
@@ -1567,98 +1604,98 @@ char *arch_name)
 	}
 	for(i = 0; i < nsymbols; i++){
 	    if(cmd_flags->x == TRUE){
-		printf(ta_xfmt, symbols[i].nl.n_value);
-		printf(" %02x %02x %04x ",
+		fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+		fprintf(output, " %02x %02x %04x ",
 		       (unsigned int)(symbols[i].nl.n_type & 0xff),
 		       (unsigned int)(symbols[i].nl.n_sect & 0xff),
 		       (unsigned int)(symbols[i].nl.n_desc & 0xffff));
 		if(symbols[i].nl.n_un.n_strx == 0){
-		    printf(i_xfmt, symbols[i].nl.n_un.n_strx);
+		    fprintf(output, i_xfmt, symbols[i].nl.n_un.n_strx);
 		    if(ofile->lto != NULL)
-			printf(" %s", symbols[i].name);
+			fprintf(output, " %s", symbols[i].name);
 		    else
-			printf(" (null)");
+			fprintf(output, " (null)");
 		}
 		else if((uint32_t)symbols[i].nl.n_un.n_strx > strsize){
-		    printf("%08x", symbols[i].nl.n_un.n_strx);
-		    printf(" (bad string index)");
+		    fprintf(output, "%08x", symbols[i].nl.n_un.n_strx);
+		    fprintf(output, " (bad string index)");
 		}
 		else{
-		    printf("%08x", symbols[i].nl.n_un.n_strx);
-		    printf(" %s", symbols[i].nl.n_un.n_strx + strings);
+		    fprintf(output, "%08x", symbols[i].nl.n_un.n_strx);
+		    fprintf(output, " %s", symbols[i].nl.n_un.n_strx + strings);
 		}
 		if((symbols[i].nl.n_type & N_STAB) == 0 &&
 		   (symbols[i].nl.n_type & N_TYPE) == N_INDR){
 		    if(symbols[i].nl.n_value == 0){
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" (null))\n");
+			fprintf(output, " (indirect for ");
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, " (null))\n");
 		    }
 		    else if(symbols[i].nl.n_value > strsize){
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" (bad string index))\n");
+			fprintf(output, " (indirect for ");
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, " (bad string index))\n");
 		    }
 		    else{
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" %s)\n", symbols[i].indr_name);
+			fprintf(output, " (indirect for ");
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, " %s)\n", symbols[i].indr_name);
 		    }
 		}
 		else
-		    printf("\n");
+		    fprintf(output, "\n");
 		continue;
 	    }
 
 	    if(symbols[i].nl.n_type & N_STAB){
 		if(cmd_flags->o == TRUE || cmd_flags->A == TRUE){
 		    if(arch_name != NULL)
-			printf("(for architecture %s):", arch_name);
+			fprintf(output, "(for architecture %s):", arch_name);
 		    if(ofile->dylib_module_name != NULL){
-			printf("%s:%s: ", ofile->file_name,
+			fprintf(output, "%s:%s: ", ofile->file_name,
 			       ofile->dylib_module_name);
 		    }
 		    else if(ofile->member_ar_hdr != NULL){
-			printf("%s:%.*s: ", ofile->file_name,
+			fprintf(output, "%s:%.*s: ", ofile->file_name,
 			       (int)ofile->member_name_size,
 			       ofile->member_name);
 		    }
 		    else
-			printf("%s: ", ofile->file_name);
+			fprintf(output, "%s: ", ofile->file_name);
 		}
-		printf(ta_xfmt, symbols[i].nl.n_value);
-		printf(" - %02x %04x %5.5s %s\n",
+		fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+		fprintf(output, " - %02x %04x %5.5s %s\n",
 		       (unsigned int)symbols[i].nl.n_sect & 0xff,
 		       (unsigned int)symbols[i].nl.n_desc & 0xffff,
-		       stab(symbols[i].nl.n_type), symbols[i].name);
+		       stab(symbols[i].nl.n_type, prbuf), symbols[i].name);
 		continue;
 	    }
 
 	    if(cmd_flags->o == TRUE || cmd_flags->A == TRUE){
 		if(arch_name != NULL)
-		    printf("(for architecture %s):", arch_name);
+		    fprintf(output, "(for architecture %s):", arch_name);
 		if(ofile->dylib_module_name != NULL){
-		    printf("%s:%s: ", ofile->file_name,
+		    fprintf(output, "%s:%s: ", ofile->file_name,
 			   ofile->dylib_module_name);
 		}
 		else if(ofile->member_ar_hdr != NULL){
-		    printf("%s:%.*s: ", ofile->file_name,
+		    fprintf(output, "%s:%.*s: ", ofile->file_name,
 			   (int)ofile->member_name_size,
 			   ofile->member_name);
 		}
 		else
-		    printf("%s: ", ofile->file_name);
+		    fprintf(output, "%s: ", ofile->file_name);
 	    }
 
 	    if(((symbols[i].nl.n_type & N_TYPE) == N_UNDF &&
 		 symbols[i].nl.n_value == 0) ||
 		 (symbols[i].nl.n_type & N_TYPE) == N_INDR)
-		printf("%s", spaces);
+		fprintf(output, "%s", spaces);
 	    else{
 		if(ofile->lto)
-		    printf("%s", dashes);
+		    fprintf(output, "%s", dashes);
 		else
-		    printf(ta_xfmt, symbols[i].nl.n_value);
+		    fprintf(output, ta_xfmt, symbols[i].nl.n_value);
 	    }
 
 	    switch(symbols[i].nl.n_type & N_TYPE){
@@ -1666,35 +1703,35 @@ char *arch_name)
 	    case N_PBUD:
 		if((symbols[i].nl.n_type & N_TYPE) == N_UNDF &&
 		   symbols[i].nl.n_value != 0){
-		    printf(" (common) ");
+		    fprintf(output, " (common) ");
 		    if(GET_COMM_ALIGN(symbols[i].nl.n_desc) != 0)
-			printf("(alignment 2^%d) ",
+			fprintf(output, "(alignment 2^%d) ",
 			       GET_COMM_ALIGN(symbols[i].nl.n_desc));
 		}
 		else{
 		    if((symbols[i].nl.n_type & N_TYPE) == N_PBUD)
-			printf(" (prebound ");
+			fprintf(output, " (prebound ");
 		    else
-			printf(" (");
+			fprintf(output, " (");
 		    if((symbols[i].nl.n_desc & REFERENCE_TYPE) ==
 		       REFERENCE_FLAG_UNDEFINED_LAZY)
-			printf("undefined [lazy bound]) ");
+			fprintf(output, "undefined [lazy bound]) ");
 		    else if((symbols[i].nl.n_desc & REFERENCE_TYPE) ==
 			    REFERENCE_FLAG_PRIVATE_UNDEFINED_LAZY)
-			printf("undefined [private lazy bound]) ");
+			fprintf(output, "undefined [private lazy bound]) ");
 		    else if((symbols[i].nl.n_desc & REFERENCE_TYPE) ==
 			    REFERENCE_FLAG_PRIVATE_UNDEFINED_NON_LAZY)
-			printf("undefined [private]) ");
+			fprintf(output, "undefined [private]) ");
 		    else
-			printf("undefined) ");
+			fprintf(output, "undefined) ");
 		}
 		break;
 	    case N_ABS:
-		printf(" (absolute) ");
+		fprintf(output, " (absolute) ");
 		
 		break;
 	    case N_INDR:
-		printf(" (indirect) ");
+		fprintf(output, " (indirect) ");
 		break;
 	    case N_SECT:
 		if(symbols[i].nl.n_sect >= 1 &&
@@ -1703,14 +1740,14 @@ char *arch_name)
 	   	       (ofile->lto != NULL &&
 	    		(ofile->lto_cputype & CPU_ARCH_ABI64) !=
 			 CPU_ARCH_ABI64)){
-			printf(" (%.16s,%.16s) ",
+			fprintf(output, " (%.16s,%.16s) ",
 			       process_flags->sections[
 				    symbols[i].nl.n_sect-1]->segname,
 			       process_flags->sections[
 				    symbols[i].nl.n_sect-1]->sectname);
 		    }
 		    else{
-			printf(" (%.16s,%.16s) ",
+			fprintf(output, " (%.16s,%.16s) ",
 			       process_flags->sections64[
 				    symbols[i].nl.n_sect-1]->segname,
 			       process_flags->sections64[
@@ -1718,63 +1755,65 @@ char *arch_name)
 		    }
 		}
 		else
-		    printf(" (?,?) ");
+		    fprintf(output, " (?,?) ");
 		break;
 	    default:
-		    printf(" (?) ");
+		    fprintf(output, " (?) ");
 		    break;
 	    }
 
 	    if(symbols[i].nl.n_type & N_EXT){
 		if(symbols[i].nl.n_desc & REFERENCED_DYNAMICALLY)
-		    printf("[referenced dynamically] ");
+		    fprintf(output, "[referenced dynamically] ");
 		if(symbols[i].nl.n_type & N_PEXT){
 		    if((symbols[i].nl.n_desc & N_WEAK_DEF) == N_WEAK_DEF)
-			printf("weak private external ");
+			fprintf(output, "weak private external ");
 		    else
-			printf("private external ");
+			fprintf(output, "private external ");
 		}
 		else{
 		    if((symbols[i].nl.n_desc & N_WEAK_REF) == N_WEAK_REF ||
 		       (symbols[i].nl.n_desc & N_WEAK_DEF) == N_WEAK_DEF){
 			if((symbols[i].nl.n_desc & (N_WEAK_REF | N_WEAK_DEF)) ==
 			   (N_WEAK_REF | N_WEAK_DEF))
-			    printf("weak external automatically hidden ");
+			    fprintf(output,
+				    "weak external automatically hidden ");
 			else
-			    printf("weak external ");
+			    fprintf(output, "weak external ");
 		    }
 		    else
-			printf("external ");
+			fprintf(output, "external ");
 		}
 	    }
 	    else{
 		if(symbols[i].nl.n_type & N_PEXT)
-		    printf("non-external (was a private external) ");
+		    fprintf(output, "non-external (was a private external) ");
 		else
-		    printf("non-external ");
+		    fprintf(output, "non-external ");
 	    }
 	    
 	    if(ofile->mh_filetype == MH_OBJECT &&
 	       (symbols[i].nl.n_desc & N_NO_DEAD_STRIP) == N_NO_DEAD_STRIP)
-		    printf("[no dead strip] ");
+		    fprintf(output, "[no dead strip] ");
 
 	    if(ofile->mh_filetype == MH_OBJECT &&
 	       ((symbols[i].nl.n_type & N_TYPE) != N_UNDF) &&
 	       (symbols[i].nl.n_desc & N_SYMBOL_RESOLVER) == N_SYMBOL_RESOLVER)
-		    printf("[symbol resolver] ");
+		    fprintf(output, "[symbol resolver] ");
 
 	    if(ofile->mh_filetype == MH_OBJECT &&
 	       ((symbols[i].nl.n_type & N_TYPE) != N_UNDF) &&
 	       (symbols[i].nl.n_desc & N_ALT_ENTRY) == N_ALT_ENTRY)
-		    printf("[alt entry] ");
+		    fprintf(output, "[alt entry] ");
 
 	    if((symbols[i].nl.n_desc & N_ARM_THUMB_DEF) == N_ARM_THUMB_DEF)
-		    printf("[Thumb] ");
+		    fprintf(output, "[Thumb] ");
 
 	    if((symbols[i].nl.n_type & N_TYPE) == N_INDR)
-		printf("%s (for %s)", symbols[i].name, symbols[i].indr_name);
+		fprintf(output, "%s (for %s)", symbols[i].name,
+			symbols[i].indr_name);
 	    else
-		printf("%s", symbols[i].name);
+		fprintf(output, "%s", symbols[i].name);
 
 	    if((mh_flags & MH_TWOLEVEL) == MH_TWOLEVEL &&
 	       (((symbols[i].nl.n_type & N_TYPE) == N_UNDF &&
@@ -1783,19 +1822,19 @@ char *arch_name)
 		library_ordinal = GET_LIBRARY_ORDINAL(symbols[i].nl.n_desc);
 		if(library_ordinal != 0){
 		    if(library_ordinal == EXECUTABLE_ORDINAL)
-			printf(" (from executable)");
+			fprintf(output, " (from executable)");
 		    else if(process_flags->nlibs != DYNAMIC_LOOKUP_ORDINAL &&
 			    library_ordinal == DYNAMIC_LOOKUP_ORDINAL)
-			printf(" (dynamically looked up)");
+			fprintf(output, " (dynamically looked up)");
 		    else if(library_ordinal-1 >= process_flags->nlibs)
-			printf(" (from bad library ordinal %u)",
+			fprintf(output, " (from bad library ordinal %u)",
 			       library_ordinal);
 		    else
-			printf(" (from %s)", process_flags->lib_names[
+			fprintf(output, " (from %s)", process_flags->lib_names[
 						library_ordinal-1]);
 		}
 	    }
-	    printf("\n");
+	    fprintf(output, "\n");
 	}
 }
 
@@ -1814,12 +1853,14 @@ uint32_t strsize,
 struct cmd_flags *cmd_flags,
 struct process_flags *process_flags,
 char *arch_name,
-struct value_diff *value_diffs)
+struct value_diff *value_diffs,
+FILE *output)
 {
     uint32_t i;
     unsigned char c;
     char *ta_xfmt, *i_xfmt, *spaces, *dashes;
     const char *p;
+    char prbuf[32];
 
 	if(ofile->mh != NULL ||
 	   (ofile->lto != NULL &&
@@ -1838,65 +1879,65 @@ struct value_diff *value_diffs)
 
 	for(i = 0; i < nsymbols; i++){
 	    if(cmd_flags->x == TRUE){
-		printf(ta_xfmt, symbols[i].nl.n_value);
-		printf(" %02x %02x %04x ",
+		fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+		fprintf(output, " %02x %02x %04x ",
 		       (unsigned int)(symbols[i].nl.n_type & 0xff),
 		       (unsigned int)(symbols[i].nl.n_sect & 0xff),
 		       (unsigned int)(symbols[i].nl.n_desc & 0xffff));
 		if(symbols[i].nl.n_un.n_strx == 0){
-		    printf(i_xfmt, symbols[i].nl.n_un.n_strx);
+		    fprintf(output, i_xfmt, symbols[i].nl.n_un.n_strx);
 		    if(ofile->lto != NULL)
-			printf(" %s", symbols[i].name);
+			fprintf(output, " %s", symbols[i].name);
 		    else
-			printf(" (null)");
+			fprintf(output, " (null)");
 		}
 		else if((uint32_t)symbols[i].nl.n_un.n_strx > strsize){
-		    printf("%08x", symbols[i].nl.n_un.n_strx);
-		    printf(" (bad string index)");
+		    fprintf(output, "%08x", symbols[i].nl.n_un.n_strx);
+		    fprintf(output, " (bad string index)");
 		}
 		else{
-		    printf("%08x", symbols[i].nl.n_un.n_strx);
-		    printf(" %s", symbols[i].nl.n_un.n_strx + strings);
+		    fprintf(output, "%08x", symbols[i].nl.n_un.n_strx);
+		    fprintf(output, " %s", symbols[i].nl.n_un.n_strx + strings);
 		}
 		if((symbols[i].nl.n_type & N_STAB) == 0 &&
 		   (symbols[i].nl.n_type & N_TYPE) == N_INDR){
 		    if(symbols[i].nl.n_value == 0){
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" (null))\n");
+			fprintf(output, " (indirect for ");
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, " (null))\n");
 		    }
 		    else if(symbols[i].nl.n_value > strsize){
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" (bad string index))\n");
+			fprintf(output, " (indirect for ");
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, " (bad string index))\n");
 		    }
 		    else{
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" %s)\n", symbols[i].indr_name);
+			fprintf(output, " (indirect for ");
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, " %s)\n", symbols[i].indr_name);
 		    }
 		}
 		else
-		    printf("\n");
+		    fprintf(output, "\n");
 		continue;
 	    }
 	    if(cmd_flags->P == TRUE){
 		if(cmd_flags->A == TRUE){
 		    if(arch_name != NULL)
-			printf("(for architecture %s): ", arch_name);
+			fprintf(output, "(for architecture %s): ", arch_name);
 		    if(ofile->dylib_module_name != NULL){
-			printf("%s[%s]: ", ofile->file_name,
+			fprintf(output, "%s[%s]: ", ofile->file_name,
 			       ofile->dylib_module_name);
 		    }
 		    else if(ofile->member_ar_hdr != NULL){
-			printf("%s[%.*s]: ", ofile->file_name,
+			fprintf(output, "%s[%.*s]: ", ofile->file_name,
 			       (int)ofile->member_name_size,
 			       ofile->member_name);
 		    }
 		    else
-			printf("%s: ", ofile->file_name);
+			fprintf(output, "%s: ", ofile->file_name);
 		}
-		printf("%s ", symbols[i].name);
+		fprintf(output, "%s ", symbols[i].name);
 
 		/* type */
 		c = symbols[i].nl.n_type;
@@ -1938,36 +1979,36 @@ struct value_diff *value_diffs)
 		}
 		if((symbols[i].nl.n_type & N_EXT) && c != '?')
 		    c = toupper(c);
-		printf("%c ", c);
-		printf(cmd_flags->format, symbols[i].nl.n_value);
-		printf(" 0\n"); /* the 0 is the size for conformance */
+		fprintf(output, "%c ", c);
+		fprintf(output, cmd_flags->format, symbols[i].nl.n_value);
+		fprintf(output, " 0\n"); /* the 0 is the size for conformance */
 		continue;
 	    }
 	    c = symbols[i].nl.n_type;
 	    if(c & N_STAB){
 		if(cmd_flags->o == TRUE || cmd_flags->A == TRUE){
 		    if(arch_name != NULL)
-			printf("(for architecture %s):", arch_name);
+			fprintf(output, "(for architecture %s):", arch_name);
 		    if(ofile->dylib_module_name != NULL){
-			printf("%s:%s: ", ofile->file_name,
+			fprintf(output, "%s:%s: ", ofile->file_name,
 			       ofile->dylib_module_name);
 		    }
 		    else if(ofile->member_ar_hdr != NULL){
-			printf("%s:%.*s: ", ofile->file_name,
+			fprintf(output, "%s:%.*s: ", ofile->file_name,
 			       (int)ofile->member_name_size,
 			       ofile->member_name);
 		    }
 		    else
-			printf("%s: ", ofile->file_name);
+			fprintf(output, "%s: ", ofile->file_name);
 		}
-		printf(ta_xfmt, symbols[i].nl.n_value);
-		printf(" - %02x %04x %5.5s ",
+		fprintf(output, ta_xfmt, symbols[i].nl.n_value);
+		fprintf(output, " - %02x %04x %5.5s ",
 		       (unsigned int)symbols[i].nl.n_sect & 0xff,
 		       (unsigned int)symbols[i].nl.n_desc & 0xffff,
-		       stab(symbols[i].nl.n_type));
+		       stab(symbols[i].nl.n_type, prbuf));
 		if(cmd_flags->b == TRUE){
 		    for(p = symbols[i].name; *p != '\0'; p++){
-			printf("%c", *p);
+			fprintf(output, "%c", *p);
 			if(*p == '('){
 			    p++;
 			    while(isdigit((unsigned char)*p))
@@ -1982,10 +2023,10 @@ struct value_diff *value_diffs)
 			    p--;
 			}
 		    }
-		    printf("\n");
+		    fprintf(output, "\n");
 		}
 		else{
-		    printf("%s\n", symbols[i].name);
+		    fprintf(output, "%s\n", symbols[i].name);
 		}
 		continue;
 	    }
@@ -2022,42 +2063,42 @@ struct value_diff *value_diffs)
 		continue;
 	    if(cmd_flags->o == TRUE || cmd_flags->A == TRUE){
 		if(arch_name != NULL)
-		    printf("(for architecture %s):", arch_name);
+		    fprintf(output, "(for architecture %s):", arch_name);
 		if(ofile->dylib_module_name != NULL){
-		    printf("%s:%s: ", ofile->file_name,
+		    fprintf(output, "%s:%s: ", ofile->file_name,
 			   ofile->dylib_module_name);
 		}
 		else if(ofile->member_ar_hdr != NULL){
-		    printf("%s:%.*s: ", ofile->file_name,
+		    fprintf(output, "%s:%.*s: ", ofile->file_name,
 			   (int)ofile->member_name_size,
 			   ofile->member_name);
 		}
 		else
-		    printf("%s: ", ofile->file_name);
+		    fprintf(output, "%s: ", ofile->file_name);
 	    }
 	    if((symbols[i].nl.n_type & N_EXT) && c != '?')
 		c = toupper(c);
 	    if(cmd_flags->u == FALSE && cmd_flags->j == FALSE){
 		if(c == 'u' || c == 'U' || c == 'i' || c == 'I')
-		    printf("%s", spaces);
+		    fprintf(output, "%s", spaces);
 		else{
 		    if(cmd_flags->v && value_diffs != NULL){
-			printf(ta_xfmt, value_diffs[i].size);
-			printf(" ");
+			fprintf(output, ta_xfmt, value_diffs[i].size);
+			fprintf(output, " ");
 		    }
 		    if(ofile->lto)
-			printf("%s", dashes);
+			fprintf(output, "%s", dashes);
 		    else
-			printf(ta_xfmt, symbols[i].nl.n_value);
+			fprintf(output, ta_xfmt, symbols[i].nl.n_value);
 		}
-		printf(" %c ", c);
+		fprintf(output, " %c ", c);
 	    }
 	    if(cmd_flags->j == FALSE &&
 	       (symbols[i].nl.n_type & N_TYPE) == N_INDR)
-		printf("%s (indirect for %s)\n", symbols[i].name,
+		fprintf(output, "%s (indirect for %s)\n", symbols[i].name,
 		       symbols[i].indr_name);
 	    else 
-		printf("%s\n", symbols[i].name);
+		fprintf(output, "%s\n", symbols[i].name);
 	}
 }
 
@@ -2101,15 +2142,16 @@ static const struct stabnames stabnames[] = {
 };
 
 /*
- * stab() returns the name of the specified stab n_type.
+ * stab() returns the name of the specified stab n_type.  Unknown types are
+ * formatted into prbuf which must be at least 32 bytes.
  */
 static
 char *
 stab(
-unsigned char n_type)
+unsigned char n_type,
+char *prbuf)
 {
     const struct stabnames *p;
-    static char prbuf[32];
 
 	for(p = stabnames; p->name; p++)
 	    if(p->n_type == n_type)
@@ -2142,18 +2184,10 @@ struct symbol *p2)
 	     */
 	}
 
-	if(cmd_flags.x == TRUE && compare_lto == FALSE){
-	    if((uint32_t)p1->nl.n_un.n_strx > strsize ||
-	       (uint32_t)p2->nl.n_un.n_strx > strsize){
-		if((uint32_t)p1->nl.n_un.n_strx > strsize)
-		    r = -1;
-		else if((uint32_t)p2->nl.n_un.n_strx > strsize)
-		    r = 1;
-	    }
-	    else
-		r = strcmp(p1->nl.n_un.n_strx + strings,
-			   p2->nl.n_un.n_strx + strings);
-	}
+	if(p1->name == NULL)
+	    r = -1;
+	else if(p2->name == NULL)
+	    r = 1;
 	else
 	    r = strcmp(p1->name, p2->name);
 
@@ -82,7 +82,8 @@ static void usage(
 static void size(
     struct ofile *ofile,
     char *arch_name,
-    void *cookie);
+    void *cookie,
+    FILE *output);
 
 /* apple_version is created by the libstuff/Makefile */
 extern char apple_version[];
@@ -97,6 +98,8 @@ char **envp)
     int i;
     enum bool args_left;
     struct flags flag;
+    char **files;
+    uint32_t nfiles;
     struct arch_flag *arch_flags;
     uint32_t narch_flags;
     enum bool all_archs;
@@ -161,6 +164,12 @@ char **envp)
 	if(flag.m == FALSE)
 	    printf("__TEXT\t__DATA\t__OBJC\tothers\tdec\thex\n");
 
+	/*
+	 * Collect the files to process so they and their members can be
+	 * processed in parallel, the output is still printed in order.
+	 */
+	files = allocate(sizeof(char *) * argc);
+	nfiles = 0;
 	args_left = TRUE;
 	for (i = 1; i < argc; i++) {
 	    if(args_left == TRUE && argv[i][0] == '-'){
@@ -179,12 +188,13 @@ char **envp)
 		    continue;
 		}
 	    }
-	    ofile_process(argv[i], arch_flags, narch_flags, all_archs, FALSE,
-			  TRUE, TRUE, size, &flag);
+	    files[nfiles++] = argv[i];
 	}
 	if(flag.nfiles == 0)
-	    ofile_process("a.out", arch_flags, narch_flags, all_archs, FALSE,
-			  TRUE, TRUE, size, &flag);
+	    files[nfiles++] = "a.out";
+	ofile_process_parallel(files, nfiles, arch_flags, narch_flags,
+			       all_archs, FALSE, TRUE, TRUE, size, &flag, 0);
+	free(files);
 	if(errors == 0)
 	    return(EXIT_SUCCESS);
 	else
@@ -213,7 +223,8 @@ void
 size(
 struct ofile *ofile,
 char *arch_name,
-void *cookie)
+void *cookie,
+FILE *output)
 {
     struct flags *flag;
     uint64_t seg_sum, sect_sum;
@@ -235,36 +246,36 @@ void *cookie)
 	    if(flag->nfiles > 1 || ofile->member_ar_hdr != NULL ||
 	       arch_name != NULL){
 		if(ofile->member_ar_hdr != NULL){
-		    printf("%s(%.*s)", ofile->file_name,
+		    fprintf(output, "%s(%.*s)", ofile->file_name,
 			   (int)ofile->member_name_size,
 			   ofile->member_name);
 		}
 		else{
-		    printf("%s", ofile->file_name);
+		    fprintf(output, "%s", ofile->file_name);
 		}
 		if(arch_name != NULL)
-		    printf(" (for architecture %s):\n", arch_name);
+		    fprintf(output, " (for architecture %s):\n", arch_name);
 		else
-		    printf(":\n");
+		    fprintf(output, ":\n");
 	    }
 	    lc = ofile->load_commands;
 	    seg_sum = 0;
 	    for(i = 0; i < ncmds; i++){
 		if(lc->cmd == LC_SEGMENT){
 		    sg = (struct segment_command *)lc;
-		    printf("Segment %.16s: ", sg->segname);
+		    fprintf(output, "Segment %.16s: ", sg->segname);
 		    if(flag->x == TRUE)
-			printf("0x%x", (unsigned int)sg->vmsize);
+			fprintf(output, "0x%x", (unsigned int)sg->vmsize);
 		    else
-			printf("%u", sg->vmsize);
+			fprintf(output, "%u", sg->vmsize);
 		    if(sg->flags & SG_FVMLIB)
-			printf(" (fixed vm library segment)\n");
+			fprintf(output, " (fixed vm library segment)\n");
 		    else{
 			if(flag->l == TRUE)
-			    printf(" (vmaddr 0x%x fileoff %u)\n",
+			    fprintf(output, " (vmaddr 0x%x fileoff %u)\n",
 				    (unsigned int)sg->vmaddr, sg->fileoff);
 			else
-			    printf("\n");
+			    fprintf(output, "\n");
 		    }
 		    seg_sum += sg->vmsize;
 		    s = (struct section *)((char *)sg +
@@ -272,44 +283,44 @@ void *cookie)
 		    sect_sum = 0;
 		    for(j = 0; j < sg->nsects; j++){
 			if(ofile->mh_filetype == MH_OBJECT)
-			    printf("\tSection (%.16s, %.16s): ",
+			    fprintf(output, "\tSection (%.16s, %.16s): ",
 				   s->segname, s->sectname);
 			else
-			    printf("\tSection %.16s: ", s->sectname);
+			    fprintf(output, "\tSection %.16s: ", s->sectname);
 			if(flag->x == TRUE)
-			    printf("0x%x", (unsigned int)s->size);
+			    fprintf(output, "0x%x", (unsigned int)s->size);
 			else
-			    printf("%u", s->size);
+			    fprintf(output, "%u", s->size);
 			if(flag->l == TRUE)
-			    printf(" (addr 0x%x offset %u)\n",
+			    fprintf(output, " (addr 0x%x offset %u)\n",
 				    (unsigned int)s->addr, s->offset);
 			else
-			    printf("\n");
+			    fprintf(output, "\n");
 			sect_sum += s->size;
 			s++;
 		    }
 		    if(sg->nsects > 0){
 			if(flag->x == TRUE)
-			    printf("\ttotal 0x%llx\n", sect_sum);
+			    fprintf(output, "\ttotal 0x%llx\n", sect_sum);
 			else
-			    printf("\ttotal %llu\n", sect_sum);
+			    fprintf(output, "\ttotal %llu\n", sect_sum);
 		    }
 		}
 		else if(lc->cmd == LC_SEGMENT_64){
 		    sg64 = (struct segment_command_64 *)lc;
-		    printf("Segment %.16s: ", sg64->segname);
+		    fprintf(output, "Segment %.16s: ", sg64->segname);
 		    if(flag->x == TRUE)
-			printf("0x%llx", sg64->vmsize);
+			fprintf(output, "0x%llx", sg64->vmsize);
 		    else
-			printf("%llu", sg64->vmsize);
+			fprintf(output, "%llu", sg64->vmsize);
 		    if(sg64->flags & SG_FVMLIB)
-			printf(" (fixed vm library segment)\n");
+			fprintf(output, " (fixed vm library segment)\n");
 		    else{
 			if(flag->l == TRUE)
-			    printf(" (vmaddr 0x%llx fileoff %llu)\n",
+			    fprintf(output, " (vmaddr 0x%llx fileoff %llu)\n",
 				    sg64->vmaddr, sg64->fileoff);
 			else
-			    printf("\n");
+			    fprintf(output, "\n");
 		    }
 		    seg_sum += sg64->vmsize;
 		    s64 = (struct section_64 *)((char *)sg64 +
@@ -317,36 +328,36 @@ void *cookie)
 		    sect_sum = 0;
 		    for(j = 0; j < sg64->nsects; j++){
 			if(ofile->mh_filetype == MH_OBJECT)
-			    printf("\tSection (%.16s, %.16s): ",
+			    fprintf(output, "\tSection (%.16s, %.16s): ",
 				   s64->segname, s64->sectname);
 			else
-			    printf("\tSection %.16s: ", s64->sectname);
+			    fprintf(output, "\tSection %.16s: ", s64->sectname);
 			if(flag->x == TRUE)
-			    printf("0x%llx", s64->size);
+			    fprintf(output, "0x%llx", s64->size);
 			else
-			    printf("%llu", s64->size);
+			    fprintf(output, "%llu", s64->size);
 			if(flag->l == TRUE)
-			    printf(" (addr 0x%llx offset %u)\n",
+			    fprintf(output, " (addr 0x%llx offset %u)\n",
 				    s64->addr,
 				    s64->offset);
 			else
-			    printf("\n");
+			    fprintf(output, "\n");
 			sect_sum += s64->size;
 			s64++;
 		    }
 		    if(sg64->nsects > 0){
 			if(flag->x == TRUE)
-			    printf("\ttotal 0x%llx\n", sect_sum);
+			    fprintf(output, "\ttotal 0x%llx\n", sect_sum);
 			else
-			    printf("\ttotal %llu\n", sect_sum);
+			    fprintf(output, "\ttotal %llu\n", sect_sum);
 		    }
 		}
 		lc = (struct load_command *)((char *)lc + lc->cmdsize);
 	    }
 	    if(flag->x == TRUE)
-		printf("total 0x%llx\n", seg_sum);
+		fprintf(output, "total 0x%llx\n", seg_sum);
 	    else
-		printf("total %llu\n", seg_sum);
+		fprintf(output, "total %llu\n", seg_sum);
 	}
 	else{
 	    text = 0;
@@ -413,22 +424,23 @@ void *cookie)
 		}
 		lc = (struct load_command *)((char *)lc + lc->cmdsize);
 	    }
-	    printf("%llu\t%llu\t%llu\t%llu\t", text, data, objc, others);
+	    fprintf(output, "%llu\t%llu\t%llu\t%llu\t", text, data, objc,
+		    others);
 	    sum = text + data + objc + others;
-	    printf("%llu\t%llx", sum, sum);
+	    fprintf(output, "%llu\t%llx", sum, sum);
 	    if(flag->nfiles > 1 || ofile->member_ar_hdr != NULL ||
 	       arch_name != NULL){
 		if(ofile->member_ar_hdr != NULL){
-		    printf("\t%s(%.*s)", ofile->file_name,
+		    fprintf(output, "\t%s(%.*s)", ofile->file_name,
 			   (int)ofile->member_name_size,
 			   ofile->member_name);
 		}
 		else{
-		    printf("\t%s", ofile->file_name);
+		    fprintf(output, "\t%s", ofile->file_name);
 		}
 		if(arch_name != NULL)
-		    printf(" (for architecture %s)", arch_name);
+		    fprintf(output, " (for architecture %s)", arch_name);
 	    }
-	    printf("\n");
+	    fprintf(output, "\n");
 	}
 }
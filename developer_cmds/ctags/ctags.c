@@ -48,8 +48,12 @@ __RCSID("$NetBSD: ctags.c,v 1.6 1998/08/25 20:59:36 ross Exp $");
 #endif /* not lint */
 #endif /* !__linux__ */
 
+#include <sys/stat.h>
+
 #include <err.h>
+#include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -61,30 +65,54 @@ __RCSID("$NetBSD: ctags.c,v 1.6 1998/08/25 20:59:36 ross Exp $");
  * ctags: create a tags file
  */
 
-NODE	*head;			/* head of the sorted binary tree */
-
 				/* boolean "func" (see init()) */
 bool	_wht[256], _etk[256], _itk[256], _btk[256], _gd[256];
 
-FILE	*inf;			/* ioptr for current input file */
+__thread FILE	*inf;		/* ioptr for current input file */
 FILE	*outf;			/* ioptr for tags file */
 
-long	lineftell;		/* ftell after getc( inf ) == '\n' */
+__thread long	lineftell;	/* ftell after getc( inf ) == '\n' */
 
-int	lineno;			/* line number of current line */
+__thread int	lineno;		/* line number of current line */
 int	dflag;			/* -d: non-macro defines */
 int	tflag=1;		/* -t: create tags for typedefs */
 int	vflag;			/* -v: vgrind style index output */
 int	wflag;			/* -w: suppress warnings */
 int	xflag;			/* -x: cxref style output */
 
-char	*curfile;		/* current input file name */
+__thread char	*curfile;	/* current input file name */
+__thread TAGLIST *curtags;	/* tags found in current file */
 char	searchar = '/';		/* use /.../ searches by default */
-char	lbuf[LINE_MAX];
+__thread char	lbuf[LINE_MAX];
+
+typedef struct {		/* a file to be scanned */
+	char	*name;
+	TAGLIST	tags;		/* tags found in it */
+	int	error;		/* errno if it couldn't be opened */
+	bool	unchanged;	/* -u: tags in the tags file are current */
+} SCAN;
+
+static SCAN	*scans;		/* the files, in command line order */
+static int	nscans;
+static int	nextscan;	/* next file for a thread to scan */
+static pthread_mutex_t scanlock = PTHREAD_MUTEX_INITIALIZER;
+
+static char	**oldlines;	/* -u: lines of the existing tags file */
+static int	noldlines;
+static char	**oldfiles;	/* -u: files they are for, sorted */
+static int	noldfiles;
 
 void	init __P((void));
 int	main __P((int, char **));
 void	find_entries __P((char *));
+static void	scan_file __P((SCAN *));
+static void	*scan_files __P((void *));
+static void	scan_all __P((int));
+static int	name_cmp __P((const void *, const void *));
+static int	line_cmp __P((const void *, const void *));
+static char	*line_file __P((char *, char **));
+static void	read_tags __P((char *));
+static void	update_tags __P((char *, NODE **, int));
 
 int
 main(argc, argv)
@@ -97,10 +125,15 @@ main(argc, argv)
 	int	exit_val;			/* exit value */
 	int	step;				/* step through args */
 	int	ch;				/* getopts char */
-	char	cmd[100];			/* too ugly to explain */
+	int	jobs;				/* -j: scanning threads */
+	int	ntags;				/* tags found */
+	NODE	**tags;				/* tags found, sorted */
+	char	*ep;
+	struct stat	sb;
 
 	aflag = uflag = NO;
-	while ((ch = getopt(argc, argv, "BFadf:tuwvx")) != -1)
+	jobs = 0;
+	while ((ch = getopt(argc, argv, "BFadf:j:tuwvx")) != -1)
 		switch(ch) {
 		case 'B':
 			searchar = '?';
@@ -117,6 +150,11 @@ main(argc, argv)
 		case 'f':
 			outfile = optarg;
 			break;
+		case 'j':
+			jobs = strtol(optarg, &ep, 10);
+			if (*ep || jobs < 1)
+				goto usage;
+			break;
 		case 't':
 			tflag++;
 			break;
@@ -142,51 +180,269 @@ main(argc, argv)
 	argc -= optind;
 	if (!argc) {
 usage:		(void)fprintf(stderr,
-			"usage: ctags [-BFadtuwvx] [-f tagsfile] file ...\n");
+			"usage: ctags [-BFadtuwvx] [-f tagsfile] [-j jobs] file ...\n");
 		exit(1);
 	}
 
 	init();
 
-	for (exit_val = step = 0; step < argc; ++step)
-		if (!(inf = fopen(argv[step], "r"))) {
+	if (!(scans = calloc(argc, sizeof(SCAN))))
+		err(1, "out of space");
+	nscans = argc;
+	for (step = 0; step < argc; ++step)
+		scans[step].name = argv[step];
+	/*
+	 * When updating, files that haven't been modified since the tags file
+	 * was written keep their existing tags, if it has any for them.  A file
+	 * without any may never have been scanned into it.
+	 */
+	if (uflag && !xflag && stat(outfile, &sb) == 0) {
+		time_t	tagstime = sb.st_mtime;
+
+		read_tags(outfile);
+		for (step = 0; step < argc; ++step)
+			if (stat(argv[step], &sb) == 0 &&
+			    sb.st_mtime < tagstime &&
+			    bsearch(&argv[step], oldfiles, noldfiles,
+			    sizeof(char *), name_cmp) != NULL)
+				scans[step].unchanged = YES;
+	}
+	if (!jobs) {
+		long	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		jobs = ncpus > 0 ? ncpus : 1;
+	}
+	scan_all(jobs);
+
+	for (exit_val = step = 0; step < argc; ++step) {
+		if (scans[step].error) {
+			errno = scans[step].error;
 			warn("%s", argv[step]);
 			exit_val = 1;
 		}
-		else {
-			curfile = argv[step];
-			find_entries(argv[step]);
-			(void)fclose(inf);
-		}
+		else
+			add_tags(&scans[step].tags);
+	}
+	tags = sorted_tags(&ntags);
 
-	if (head) {
+	if (uflag && !xflag)
+		update_tags(outfile, tags, ntags);
+	else if (ntags) {
 		if (xflag)
-			put_entries(head);
+			put_entries(tags, ntags);
 		else {
-			if (uflag) {
-				for (step = 0; step < argc; step++) {
-					(void)sprintf(cmd,
-						"mv %s OTAGS; fgrep -v '\t%s\t' OTAGS >%s; rm OTAGS",
-							outfile, argv[step],
-							outfile);
-					(void)system(cmd);
-				}
-				++aflag;
-			}
 			if (!(outf = fopen(outfile, aflag ? "a" : "w")))
 				err(exit_val ? exit_val : 1, "%s", outfile);
-			put_entries(head);
+			put_entries(tags, ntags);
 			(void)fclose(outf);
-			if (uflag) {
-				(void)sprintf(cmd, "sort -o %s %s",
-						outfile, outfile);
-				(void)system(cmd);
-			}
 		}
 	}
 	exit(exit_val);
 }
 
+/*
+ * scan_file --
+ *	find the tags in one file
+ */
+static void
+scan_file(sp)
+	SCAN	*sp;
+{
+	if (sp->unchanged)
+		return;
+	if (!(inf = fopen(sp->name, "r"))) {
+		sp->error = errno;
+		return;
+	}
+	curfile = sp->name;
+	curtags = &sp->tags;
+	find_entries(sp->name);
+	(void)fclose(inf);
+}
+
+/*
+ * scan_files --
+ *	thread start routine, scans files until there are none left
+ */
+static void *
+scan_files(arg)
+	void	*arg;
+{
+	int	i;
+
+	(void)arg;
+	for (;;) {
+		pthread_mutex_lock(&scanlock);
+		i = nextscan++;
+		pthread_mutex_unlock(&scanlock);
+		if (i >= nscans)
+			return (NULL);
+		scan_file(&scans[i]);
+	}
+}
+
+/*
+ * scan_all --
+ *	scan all the files using up to jobs threads.  The tags found are kept
+ *	per file, so the result doesn't depend on the order files finish in.
+ */
+static void
+scan_all(jobs)
+	int	jobs;
+{
+	pthread_t	*threads;
+	int	i, nthreads;
+
+	if (jobs > nscans)
+		jobs = nscans;
+	if (jobs <= 1) {
+		(void)scan_files(NULL);
+		return;
+	}
+	if (!(threads = calloc(jobs, sizeof(pthread_t))))
+		err(1, "out of space");
+	for (nthreads = 0; nthreads < jobs; nthreads++)
+		if (pthread_create(&threads[nthreads], NULL, scan_files, NULL))
+			break;
+	/* if no threads could be started, scan the files on this one */
+	if (!nthreads)
+		(void)scan_files(NULL);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+static int
+name_cmp(a, b)
+	const void	*a, *b;
+{
+	return (strcmp(*(char * const *)a, *(char * const *)b));
+}
+
+static int
+line_cmp(a, b)
+	const void	*a, *b;
+{
+	return (strcmp(*(char * const *)a, *(char * const *)b));
+}
+
+/*
+ * line_file --
+ *	return the file name of a tags file line, the second tab separated
+ *	field, terminated in place; *end is set to the tab after it.  Returns
+ *	NULL for a line without one.
+ */
+static char *
+line_file(line, end)
+	char	*line, **end;
+{
+	char	*file;
+
+	if ((file = strchr(line, '\t')) == NULL ||
+	    (*end = strchr(++file, '\t')) == NULL)
+		return (NULL);
+	**end = EOS;
+	return (file);
+}
+
+/*
+ * read_tags --
+ *	-u: read the existing tags file, and make a list of the files that it
+ *	has tags for.
+ */
+static void
+read_tags(outfile)
+	char	*outfile;
+{
+	char	*buf, *file, *end;
+	size_t	bufsize;
+	ssize_t	len;
+	int	maxlines, i, j;
+	FILE	*oldf;
+
+	if ((oldf = fopen(outfile, "r")) == NULL)
+		return;
+	maxlines = 1024;
+	if (!(oldlines = malloc(maxlines * sizeof(char *))) ||
+	    !(oldfiles = malloc(maxlines * sizeof(char *))))
+		err(1, "out of space");
+	buf = NULL;
+	bufsize = 0;
+	while ((len = getline(&buf, &bufsize, oldf)) != -1) {
+		if (len && buf[len - 1] == '\n')
+			buf[--len] = EOS;
+		if (noldlines == maxlines) {
+			maxlines *= 2;
+			if (!(oldlines = realloc(oldlines,
+			    maxlines * sizeof(char *))) ||
+			    !(oldfiles = realloc(oldfiles,
+			    maxlines * sizeof(char *))))
+				err(1, "out of space");
+		}
+		if (!(oldlines[noldlines++] = strdup(buf)))
+			err(1, "strdup");
+		if ((file = line_file(buf, &end)) != NULL &&
+		    !(oldfiles[noldfiles++] = strdup(file)))
+			err(1, "strdup");
+	}
+	free(buf);
+	(void)fclose(oldf);
+
+	/* the lines are sorted by tag, not file, so remove the duplicates */
+	qsort(oldfiles, noldfiles, sizeof(char *), name_cmp);
+	for (i = j = 0; i < noldfiles; i++) {
+		if (j && !strcmp(oldfiles[j - 1], oldfiles[i]))
+			free(oldfiles[i]);
+		else
+			oldfiles[j++] = oldfiles[i];
+	}
+	noldfiles = j;
+}
+
+/*
+ * update_tags --
+ *	-u: replace the tags for the rescanned files in the tags file with the
+ *	new tags, keeping the lines for all other files, and sort the result.
+ */
+static void
+update_tags(outfile, tags, ntags)
+	char	*outfile;
+	NODE	**tags;
+	int	ntags;
+{
+	char	**rescanned, **lines, *file, *end;
+	int	nrescanned, nlines, i;
+
+	if (!(rescanned = malloc(nscans * sizeof(char *))))
+		err(1, "out of space");
+	for (nrescanned = i = 0; i < nscans; i++)
+		if (!scans[i].unchanged)
+			rescanned[nrescanned++] = scans[i].name;
+	qsort(rescanned, nrescanned, sizeof(char *), name_cmp);
+
+	if (!(lines = malloc((noldlines + ntags + 1) * sizeof(char *))))
+		err(1, "out of space");
+	nlines = 0;
+	for (i = 0; i < noldlines; i++) {
+		if ((file = line_file(oldlines[i], &end)) != NULL) {
+			if (bsearch(&file, rescanned, nrescanned,
+			    sizeof(char *), name_cmp) != NULL)
+				continue;
+			*end = '\t';
+		}
+		lines[nlines++] = oldlines[i];
+	}
+	for (i = 0; i < ntags; i++)
+		lines[nlines++] = tag_line(tags[i]);
+	qsort(lines, nlines, sizeof(char *), line_cmp);
+
+	if (!(outf = fopen(outfile, "w")))
+		err(1, "%s", outfile);
+	for (i = 0; i < nlines; i++)
+		fprintf(outf, "%s\n", lines[i]);
+	(void)fclose(outf);
+}
+
 /*
  * init --
  *	this routine sets up the boolean psuedo-functions which work by
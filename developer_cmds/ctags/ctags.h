@@ -53,37 +53,49 @@
 #define	endtoken(arg)	(_etk[(unsigned)arg])	/* T if char ends tokens */
 #define	isgood(arg)	(_gd[(unsigned)arg])	/* T if char can be after ')' */
 
-typedef struct nd_st {			/* sorting structure */
-	struct nd_st	*left,
-			*right;		/* left and right sons */
+typedef struct nd_st {			/* tag entry */
+	struct nd_st	*next;		/* next entry in hash chain */
 	char	*entry,			/* function or type name */
 		*file,			/* file name */
 		*pat;			/* search pattern */
 	int	lno;			/* for -x option */
+	int	scanlno;		/* line being scanned when found */
 	bool	been_warned;		/* set if noticed dup */
 } NODE;
 
-extern char	*curfile;		/* current input file name */
-extern NODE	*head;			/* head of the sorted binary tree */
-extern FILE    *inf;			/* ioptr for current input file */
+typedef struct {			/* tags found in one file */
+	NODE	**tags;			/* in the order they were found */
+	int	ntags;
+	int	maxtags;
+} TAGLIST;
+
+/*
+ * Files are scanned on several threads, so the scanner state is per thread.
+ */
+extern __thread char	*curfile;	/* current input file name */
+extern __thread TAGLIST	*curtags;	/* tags found in current file */
+extern __thread FILE	*inf;		/* ioptr for current input file */
 extern FILE    *outf;			/* ioptr for current output file */
-extern long	lineftell;		/* ftell after getc( inf ) == '\n' */
-extern int	lineno;			/* line number of current line */
+extern __thread long	lineftell;	/* ftell after getc( inf ) == '\n' */
+extern __thread int	lineno;		/* line number of current line */
 extern int	dflag;			/* -d: non-macro defines */
 extern int	tflag;			/* -t: create tags for typedefs */
 extern int	vflag;			/* -v: vgrind style index output */
 extern int	wflag;			/* -w: suppress warnings */
 extern int	xflag;			/* -x: cxref style output */
 extern bool	_wht[], _etk[], _itk[], _btk[], _gd[];
-extern char	lbuf[LINE_MAX];
-extern char    *lbp;
+extern __thread char	lbuf[LINE_MAX];
+extern __thread char   *lbp;
 extern char	searchar;		/* ex search character */
 
 extern int	cicmp __P((char *));
 extern void	ct_getline __P((void));
 extern void	pfnote __P((char *, int));
+extern void	add_tags __P((TAGLIST *));
+extern NODE   **sorted_tags __P((int *));
 extern int	skip_key __P((int));
-extern void	put_entries __P((NODE *));
+extern char    *tag_line __P((NODE *));
+extern void	put_entries __P((NODE **, int));
 extern void	toss_yysec __P((void));
 extern void	l_entries __P((void));
 extern void	y_entries __P((void));
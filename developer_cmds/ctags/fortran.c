@@ -53,7 +53,7 @@ __RCSID("$NetBSD: fortran.c,v 1.4 1997/10/18 13:18:37 lukem Exp $");
 
 static void takeprec __P((void));
 
-char *lbp;				/* line buffer pointer */
+__thread char *lbp;			/* line buffer pointer */
 
 int
 PF_funcs()
@@ -44,6 +44,7 @@ __RCSID("$NetBSD: print.c,v 1.5 1997/10/18 13:18:52 lukem Exp $");
 #endif /* not lint */
 #endif /* !__linux__ */
 
+#include <err.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -99,26 +100,48 @@ ct_getline()
 	(void)fseek(inf, saveftell, SEEK_SET);
 }
 
+/*
+ * tag_line --
+ *	return the tags file line for a tag, without the newline
+ */
+char *
+tag_line(node)
+	NODE	*node;
+{
+	char	*line;
+	size_t	len;
+
+	len = strlen(node->entry) + strlen(node->file) + strlen(node->pat) + 6;
+	if (!(line = malloc(len)))
+		err(1, "out of space");
+	(void)snprintf(line, len, "%s\t%s\t%c^%s%c",
+	    node->entry, node->file, searchar, node->pat, searchar);
+	return (line);
+}
+
 /*
  * put_entries --
  *	write out the tags
  */
 void
-put_entries(node)
-	NODE	*node;
+put_entries(tags, ntags)
+	NODE	**tags;
+	int	ntags;
 {
+	NODE	*node;
+	int	i;
 
-	if (node->left)
-		put_entries(node->left);
-	if (vflag)
-		printf("%s %s %d\n",
-		    node->entry, node->file, (node->lno + 63) / 64);
-	else if (xflag)
-		printf("%-16s%4d %-16s %s\n",
-		    node->entry, node->lno, node->file, node->pat);
-	else
-		fprintf(outf, "%s\t%s\t%c^%s%c\n",
-		    node->entry, node->file, searchar, node->pat, searchar);
-	if (node->right)
-		put_entries(node->right);
+	for (i = 0; i < ntags; i++) {
+		node = tags[i];
+		if (vflag)
+			printf("%s %s %d\n",
+			    node->entry, node->file, (node->lno + 63) / 64);
+		else if (xflag)
+			printf("%-16s%4d %-16s %s\n",
+			    node->entry, node->lno, node->file, node->pat);
+		else
+			fprintf(outf, "%s\t%s\t%c^%s%c\n",
+			    node->entry, node->file, searchar, node->pat,
+			    searchar);
+	}
 }
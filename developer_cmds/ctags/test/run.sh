@@ -0,0 +1,90 @@
+#!/bin/sh
+#
+# Tests for ctags -j and -u.  Usage: run.sh path-to-ctags
+#
+# The tags for ctags.test and a set of generated files must not depend on the
+# number of scanning threads, and a tags file updated with -u must be the same
+# as one written from scratch.
+
+ctags=${1:-./ctags}
+case $ctags in
+/*)	;;
+*)	ctags=`pwd`/$ctags ;;
+esac
+testdir=`cd \`dirname $0\` && pwd`
+tmp=`mktemp -d ${TMPDIR:-/tmp}/ctags.XXXXXX` || exit 1
+trap 'rm -rf $tmp' 0
+cd $tmp || exit 1
+failures=0
+
+fail()
+{
+	echo "FAIL: $*" >&2
+	failures=`expr $failures + 1`
+}
+
+# compare the tags file $1 with one written from scratch for the rest
+same_as_full()
+{
+	what=$1
+	shift
+	$ctags -f full.tags "$@" || fail "$what: ctags failed"
+	cmp -s tags full.tags || {
+		fail "$what: differs from a full run"
+		diff tags full.tags >&2
+	}
+}
+
+# -j: the output doesn't depend on the number of threads
+cp $testdir/ctags.test ctags.c
+i=0
+while [ $i -lt 40 ]; do
+	printf 'int\nfunc%d(void)\n{\n}\n#define MACRO%d 1\nstruct s%d { int x; };\n' \
+	    $i $i $i > gen$i.c
+	i=`expr $i + 1`
+done
+$ctags -j 1 -f one.tags ctags.c gen*.c || fail "-j 1: ctags failed"
+for jobs in 2 4 16; do
+	$ctags -j $jobs -f tags ctags.c gen*.c || fail "-j $jobs: ctags failed"
+	cmp -s one.tags tags || fail "-j $jobs: differs from -j 1"
+done
+$ctags -x ctags.c gen*.c > one.x
+$ctags -x -j 4 ctags.c gen*.c > four.x
+cmp -s one.x four.x || fail "-x -j 4: differs from one thread"
+
+# -u: a file that is older than the tags file but has no tags in it yet
+printf 'int\nfoo(void)\n{\n}\n' > a.c
+printf 'int\nbar(void)\n{\n}\n' > b.c
+printf 'int\nbaz(void)\n{\n}\n' > c.c
+touch -t 200001010000 a.c b.c c.c
+$ctags -f tags a.c || fail "-u: ctags failed"
+$ctags -u a.c b.c || fail "-u: ctags -u failed"
+grep -q '^bar	' tags || fail "-u: no tags for a file added to the tags file"
+same_as_full "-u add" a.c b.c
+
+# -u: a changed file is rescanned, an unchanged one keeps its tags, and files
+# not named keep theirs
+$ctags -f tags a.c b.c c.c
+printf 'int\nfoo2(void)\n{\n}\n' > a.c
+touch -t 203001010000 a.c
+cp b.c b.c.orig
+printf 'int\nstale(void)\n{\n}\n' > b.c
+touch -t 200001010000 b.c
+$ctags -u a.c b.c || fail "-u: ctags -u failed"
+grep -q '^foo	' tags && fail "-u: tags of a changed file were kept"
+grep -q '^foo2	' tags || fail "-u: a changed file was not rescanned"
+grep -q '^stale	' tags && fail "-u: an unchanged file was rescanned"
+grep -q '^baz	' tags || fail "-u: tags of a file not named were dropped"
+mv b.c.orig b.c
+same_as_full "-u change" a.c b.c c.c
+
+# -u: a file that no longer exists is reported, and its tags are dropped
+rm c.c
+$ctags -u c.c 2>/dev/null && fail "-u: no error for a missing file"
+grep -q '^baz	' tags && fail "-u: tags of a missing file were kept"
+
+if [ $failures -ne 0 ]; then
+	echo "$failures failures" >&2
+	exit 1
+fi
+exit 0
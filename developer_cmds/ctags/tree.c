@@ -52,12 +52,24 @@ __RCSID("$NetBSD: tree.c,v 1.5 1997/10/18 13:18:58 lukem Exp $");
 
 #include "ctags.h"
 
-static void	add_node __P((NODE *, NODE *));
-static void	free_tree __P((NODE *));
+/*
+ * The tags found in each file are kept in a TAGLIST in the order they were
+ * found, so that files can be scanned in parallel.  add_tags() then enters
+ * them, a file at a time in the order the files were named, in a hash table
+ * keyed by name, which drops duplicates exactly as entering them in a sorted
+ * tree would.  sorted_tags() sorts the survivors for output.
+ */
+static NODE	**table;		/* hash table of entered tags */
+static size_t	tablesize;		/* buckets in table, a power of 2 */
+static int	ntags;			/* tags in table */
+
+static size_t	hash_name __P((const char *));
+static void	grow_table __P((void));
+static int	tag_cmp __P((const void *, const void *));
 
 /*
  * pfnote --
- *	enter a new node in the tree
+ *	note a new tag in the current file
  */
 void
 pfnote(name, ln)
@@ -69,14 +81,8 @@ pfnote(name, ln)
 	char	nbuf[MAXTOKEN];
 
 	/*NOSTRICT*/
-	if (!(np = (NODE *)malloc(sizeof(NODE)))) {
-		warnx("too many entries to sort");
-		put_entries(head);
-		free_tree(head);
-		/*NOSTRICT*/
-		if (!(head = np = (NODE *)malloc(sizeof(NODE))))
-			err(1, "out of space");
-	}
+	if (!(np = (NODE *)malloc(sizeof(NODE))))
+		err(1, "out of space");
 	if (!xflag && !strcmp(name, "main")) {
 		if (!(fp = strrchr(curfile, '/')))
 			fp = curfile;
@@ -92,53 +98,124 @@ pfnote(name, ln)
 		err(1, "strdup");
 	np->file = curfile;
 	np->lno = ln;
-	np->left = np->right = 0;
+	np->scanlno = lineno;
+	np->next = 0;
+	np->been_warned = NO;
 	if (!(np->pat = strdup(lbuf)))
 		err(1, "strdup");
-	if (!head)
-		head = np;
-	else
-		add_node(np, head);
+	if (curtags->ntags == curtags->maxtags) {
+		curtags->maxtags = curtags->maxtags ? curtags->maxtags * 2 : 64;
+		if (!(curtags->tags = realloc(curtags->tags,
+		    curtags->maxtags * sizeof(NODE *))))
+			err(1, "out of space");
+	}
+	curtags->tags[curtags->ntags++] = np;
+}
+
+static size_t
+hash_name(name)
+	const char	*name;
+{
+	size_t	h;
+
+	for (h = 5381; *name; name++)
+		h = h * 33 + (unsigned char)*name;
+	return (h);
 }
 
 static void
-add_node(node, cur_node)
-	NODE	*node,
-		*cur_node;
+grow_table()
 {
-	int	dif;
+	NODE	**newtable, *np, *next;
+	size_t	newsize, i, h;
+
+	newsize = tablesize ? tablesize * 2 : 1024;
+	if (!(newtable = calloc(newsize, sizeof(NODE *))))
+		err(1, "out of space");
+	for (i = 0; i < tablesize; i++)
+		for (np = table[i]; np; np = next) {
+			next = np->next;
+			h = hash_name(np->entry) & (newsize - 1);
+			np->next = newtable[h];
+			newtable[h] = np;
+		}
+	free(table);
+	table = newtable;
+	tablesize = newsize;
+}
 
-	dif = strcmp(node->entry, cur_node->entry);
-	if (!dif) {
+/*
+ * add_tags --
+ *	enter the tags found in a file, warning about duplicates
+ */
+void
+add_tags(list)
+	TAGLIST	*list;
+{
+	NODE	*node, *cur_node;
+	size_t	h;
+	int	i;
+
+	for (i = 0; i < list->ntags; i++) {
+		node = list->tags[i];
+		if ((size_t)ntags >= tablesize)
+			grow_table();
+		h = hash_name(node->entry) & (tablesize - 1);
+		for (cur_node = table[h]; cur_node; cur_node = cur_node->next)
+			if (!strcmp(node->entry, cur_node->entry))
+				break;
+		if (!cur_node) {
+			node->next = table[h];
+			table[h] = node;
+			ntags++;
+			continue;
+		}
 		if (node->file == cur_node->file) {
 			if (!wflag)
-				fprintf(stderr, "Duplicate entry in file %s, line %d: %s\nSecond entry ignored\n", node->file, lineno, node->entry);
-			return;
+				fprintf(stderr, "Duplicate entry in file %s, line %d: %s\nSecond entry ignored\n", node->file, node->scanlno, node->entry);
 		}
-		if (!cur_node->been_warned)
-			if (!wflag)
-				fprintf(stderr, "Duplicate entry in files %s and %s: %s (Warning only)\n", node->file, cur_node->file, node->entry);
-		cur_node->been_warned = YES;
+		else {
+			if (!cur_node->been_warned)
+				if (!wflag)
+					fprintf(stderr, "Duplicate entry in files %s and %s: %s (Warning only)\n", node->file, cur_node->file, node->entry);
+			cur_node->been_warned = YES;
+		}
+		free(node->entry);
+		free(node->pat);
+		free(node);
 	}
-	else if (dif < 0)
-		if (cur_node->left)
-			add_node(node, cur_node->left);
-		else
-			cur_node->left = node;
-	else if (cur_node->right)
-		add_node(node, cur_node->right);
-	else
-		cur_node->right = node;
+	free(list->tags);
+	list->tags = 0;
+	list->ntags = list->maxtags = 0;
 }
 
-static void
-free_tree(node)
-	NODE	*node;
+static int
+tag_cmp(a, b)
+	const void	*a, *b;
 {
-	while (node) {
-		if (node->right)
-			free_tree(node->right);
-		free(node);
-		node = node->left;
-	}
+	return (strcmp((*(NODE * const *)a)->entry,
+	    (*(NODE * const *)b)->entry));
+}
+
+/*
+ * sorted_tags --
+ *	return the entered tags sorted by name
+ */
+NODE **
+sorted_tags(np)
+	int	*np;
+{
+	NODE	**tags, *node;
+	size_t	i;
+	int	n;
+
+	if (!(tags = malloc((ntags ? ntags : 1) * sizeof(NODE *))))
+		err(1, "out of space");
+	n = 0;
+	for (i = 0; i < tablesize; i++)
+		for (node = table[i]; node; node = node->next)
+			tags[n++] = node;
+	qsort(tags, n, sizeof(NODE *), tag_cmp);
+	*np = n;
+	return (tags);
 }
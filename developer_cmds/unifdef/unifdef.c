@@ -45,6 +45,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 #include <ctype.h>
 #include <err.h>
@@ -146,7 +147,6 @@ static char const * const linestate_name[] = {
  */
 #define	MAXDEPTH        64			/* maximum #if nesting */
 #define	MAXLINE         4096			/* maximum length of line */
-#define	MAXSYMS         4096			/* maximum number of symbols */
 
 /*
  * Sometimes when editing a keyword the replacement text is longer, so
@@ -174,11 +174,16 @@ static bool             lnnum;			/* -n: add #line directives */
 static bool             symlist;		/* -s: output symbol list */
 static bool             symdepth;		/* -S: output symbol depth */
 static bool             text;			/* -t: this is a text file */
+static bool             modify;			/* -m: modify files in place */
+static int              jobs;			/* -j: files processed at once */
 
-static const char      *symname[MAXSYMS];	/* symbol name */
-static const char      *value[MAXSYMS];		/* -Dsym=value */
-static bool             ignore[MAXSYMS];	/* -iDsym or -iUsym */
+static const char     **symname;		/* symbol name */
+static const char     **value;			/* -Dsym=value */
+static bool            *ignore;			/* -iDsym or -iUsym */
 static int              nsyms;			/* number of symbols */
+static int              maxsyms;		/* size of the symbol arrays */
+static int             *symhash;		/* symbol index + 1 by hash */
+static size_t           symhashsize;		/* size of symhash, power of 2 */
 
 static FILE            *input;			/* input file pointer */
 static const char      *filename;		/* input file name */
@@ -216,6 +221,12 @@ static void             debug(const char *, ...);
 static void             done(void);
 static void             error(const char *);
 static int              findsym(const char *);
+static void             openfiles(const char *);
+static int              processinplace(int, char *[]);
+static void             growsyms(void);
+static void             rehashsyms(size_t);
+static int              symlookup(const char *, const char *);
+static size_t           symhashval(const char *, size_t);
 static void             flushline(bool);
 static Linetype         parseline(void);
 static Linetype         ifeval(const char **);
@@ -242,8 +253,9 @@ int
 main(int argc, char *argv[])
 {
 	int opt;
+	char *ep;
 
-	while ((opt = getopt(argc, argv, "i:D:U:I:o:bBcdeKklnsStV")) != -1)
+	while ((opt = getopt(argc, argv, "i:D:U:I:j:o:bBcdeKklmnsStV")) != -1)
 		switch (opt) {
 		case 'i': /* treat stuff controlled by these symbols as text */
 			/*
@@ -289,6 +301,14 @@ main(int argc, char *argv[])
 		case 'k': /* process constant #ifs */
 			killconsts = true;
 			break;
+		case 'j': /* number of files to process at once with -m */
+			jobs = strtol(optarg, &ep, 10);
+			if (*ep != '\0' || jobs < 1)
+				usage();
+			break;
+		case 'm': /* modify each input file in place */
+			modify = true;
+			break;
 		case 'n': /* add #line directive after deleted lines */
 			lnnum = true;
 			break;
@@ -313,10 +333,38 @@ main(int argc, char *argv[])
 	argv += optind;
 	if (compblank && lnblank)
 		errx(2, "-B and -b are mutually exclusive");
-	if (argc > 1) {
+	if (symlist && nsyms == 0) {
+		/* findsym() returns symbol 0 for every symbol with -s */
+		growsyms();
+		value[0] = NULL;
+		ignore[0] = false;
+	}
+	if (modify) {
+		if (ofilename != NULL)
+			errx(2, "-m and -o are mutually exclusive");
+		if (symlist)
+			errx(2, "-m and -s are mutually exclusive");
+		if (argc == 0)
+			usage();
+		exit(processinplace(argc, argv));
+	}
+	if (argc > 1)
 		errx(2, "can only do one file");
-	} else if (argc == 1 && strcmp(*argv, "-") != 0) {
-		filename = *argv;
+	openfiles(argc == 1 ? *argv : NULL);
+	process();
+	abort(); /* bug */
+}
+
+/*
+ * Open the input file, or the standard input if iname is NULL or "-", and
+ * the output file.  If the output file is the input file the output goes to
+ * a temporary file which done() renames over the input.
+ */
+static void
+openfiles(const char *iname)
+{
+	if (iname != NULL && strcmp(iname, "-") != 0) {
+		filename = iname;
 		input = fopen(filename, "rb");
 		if (input == NULL)
 			err(2, "can't open %s", filename);
@@ -357,8 +405,66 @@ main(int argc, char *argv[])
 				err(2, "can't open %s", ofilename);
 		}
 	}
-	process();
-	abort(); /* bug */
+}
+
+/*
+ * The -m option: process each of the files in place, running up to jobs
+ * (by default the number of online processors) at once.  Each file is
+ * handled by a child process doing an ordinary run with the file as both
+ * input and output, so a file is only replaced, by renaming the temporary
+ * output over it, if it was processed successfully.  Returns the highest
+ * exit status of the children.
+ */
+static int
+processinplace(int nfiles, char *files[])
+{
+	int i, running, status, result;
+	long ncpus;
+	pid_t pid;
+
+	if (jobs == 0) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = ncpus > 0 ? ncpus : 1;
+	}
+	for (i = 0; i < nfiles; i++)
+		if (strcmp(files[i], "-") == 0)
+			errx(2, "can't modify the standard input in place");
+	fflush(stdout);
+	fflush(stderr);
+	result = 0;
+	running = 0;
+	i = 0;
+	while (i < nfiles || running > 0) {
+		if (i < nfiles && running < jobs) {
+			pid = fork();
+			if (pid == 0) {
+				ofilename = files[i];
+				openfiles(files[i]);
+				process();
+				abort(); /* bug */
+			}
+			if (pid != -1) {
+				running++;
+				i++;
+				continue;
+			}
+			if (running == 0)
+				err(2, "can't fork");
+			/* wait for a child to finish and try again */
+		}
+		pid = wait(&status);
+		if (pid == -1) {
+			if (errno == EINTR)
+				continue;
+			err(2, "wait");
+		}
+		running--;
+		if (!WIFEXITED(status))
+			result = 2;
+		else if (WEXITSTATUS(status) > result)
+			result = WEXITSTATUS(status);
+	}
+	return (result);
 }
 
 static void
@@ -379,7 +485,9 @@ static void
 usage(void)
 {
 	fprintf(stderr, "usage: unifdef [-bBcdeKknsStV] [-Ipath]"
-	    " [-Dsym[=val]] [-Usym] [-iDsym[=val]] [-iUsym] ... [file]\n");
+	    " [-Dsym[=val]] [-Usym] [-iDsym[=val]] [-iUsym] ... [file]\n"
+	    "       unifdef -m [-bBcdeKkntV] [-j jobs] [-Ipath]"
+	    " [-Dsym[=val]] [-Usym] [-iDsym[=val]] [-iUsym] ... file ...\n");
 	exit(2);
 }
 
@@ -1147,16 +1255,87 @@ findsym(const char *str)
 		/* we don't care about the value of the symbol */
 		return (0);
 	}
-	for (symind = 0; symind < nsyms; ++symind) {
-		if (strlcmp(symname[symind], str, cp-str) == 0) {
-			debug("findsym %s %s", symname[symind],
-			    value[symind] ? value[symind] : "");
+	symind = symlookup(str, cp);
+	if (symind >= 0)
+		debug("findsym %s %s", symname[symind],
+		    value[symind] ? value[symind] : "");
+	return (symind);
+}
+
+/*
+ * The symbol table is a set of arrays indexed by symbol number, and an
+ * open addressing hash table of symbol numbers (plus one, so that zero is
+ * an empty slot) that is kept at most half full.
+ */
+static size_t
+symhashval(const char *str, size_t len)
+{
+	size_t h = 2166136261u;
+
+	while (len--)
+		h = (h ^ (unsigned char)*str++) * 16777619u;
+	return (h);
+}
+
+/*
+ * Find the symbol that runs from str to cp in the symbol table.
+ */
+static int
+symlookup(const char *str, const char *cp)
+{
+	size_t h, mask;
+	int symind;
+
+	if (symhashsize == 0)
+		return (-1);
+	mask = symhashsize - 1;
+	for (h = symhashval(str, cp-str) & mask; symhash[h] != 0;
+	    h = (h + 1) & mask) {
+		symind = symhash[h] - 1;
+		if (strlcmp(symname[symind], str, cp-str) == 0)
 			return (symind);
-		}
 	}
 	return (-1);
 }
 
+/*
+ * Make room for more symbols in the symbol arrays.
+ */
+static void
+growsyms(void)
+{
+	maxsyms = maxsyms == 0 ? 64 : maxsyms * 2;
+	symname = realloc(symname, maxsyms * sizeof(*symname));
+	value = realloc(value, maxsyms * sizeof(*value));
+	ignore = realloc(ignore, maxsyms * sizeof(*ignore));
+	if (symname == NULL || value == NULL || ignore == NULL)
+		err(2, "can't allocate symbol table");
+}
+
+/*
+ * Rebuild the hash table with size slots.
+ */
+static void
+rehashsyms(size_t size)
+{
+	const char *name;
+	size_t h;
+	int symind;
+
+	free(symhash);
+	symhash = calloc(size, sizeof(*symhash));
+	if (symhash == NULL)
+		err(2, "can't allocate symbol table");
+	symhashsize = size;
+	for (symind = 0; symind < nsyms; symind++) {
+		name = symname[symind];
+		h = symhashval(name, skipsym(name) - name) & (size - 1);
+		while (symhash[h] != 0)
+			h = (h + 1) & (size - 1);
+		symhash[h] = symind + 1;
+	}
+}
+
 /*
  * Add a symbol to the symbol table.
  */
@@ -1165,12 +1344,23 @@ addsym(bool ignorethis, bool definethis, char *sym)
 {
 	int symind;
 	char *val;
+	size_t h;
 
-	symind = findsym(sym);
+	symind = symlookup(sym, skipsym(sym));
 	if (symind < 0) {
-		if (nsyms >= MAXSYMS)
-			errx(2, "too many symbols");
+		if (nsyms == maxsyms)
+			growsyms();
 		symind = nsyms++;
+		symname[symind] = sym;
+		if ((size_t)nsyms * 2 > symhashsize) {
+			rehashsyms(symhashsize == 0 ? 128 : symhashsize * 2);
+		} else {
+			h = symhashval(sym, skipsym(sym) - sym) &
+			    (symhashsize - 1);
+			while (symhash[h] != 0)
+				h = (h + 1) & (symhashsize - 1);
+			symhash[h] = symind + 1;
+		}
 	}
 	symname[symind] = sym;
 	ignore[symind] = ignorethis;
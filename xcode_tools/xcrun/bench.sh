@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# bench.sh -- measure xcrun startup latency with and without the lookup cache.
+#
+# Usage: bench.sh [path to xcrun] [iterations]
+#
+# A throwaway developer dir with one SDK and one toolchain is created, and HOME
+# is pointed at it so the real lookup cache is left alone.  SDKROOT and
+# TOOLCHAINS select the SDK and toolchain, so /etc/xcrun.ini is not needed.
+# Each mode runs the given number of xcrun invocations and prints the average
+# time per invocation.  'run' executes a tool that exits immediately, so it
+# includes the exec of the tool.
+#
+
+XCRUN=${1:-./xcrun}
+ITERATIONS=${2:-200}
+
+case "$XCRUN" in
+	/*) ;;
+	*) XCRUN="$(pwd)/$XCRUN" ;;
+esac
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/xcrun-bench.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+DEV="$WORK/Developer"
+mkdir -p "$DEV/usr/bin" "$DEV/SDKs/Bench.sdk/usr/bin" "$DEV/Toolchains/Bench.toolchain/usr/bin"
+cat > "$DEV/SDKs/Bench.sdk/info.ini" <<INI
+[SDK]
+name = Bench
+version = 0.0.1
+toolchain = Bench
+default_arch = arm
+iphoneos_deployment_target = 4.2
+INI
+cat > "$DEV/Toolchains/Bench.toolchain/info.ini" <<INI
+[TOOLCHAIN]
+name = Bench
+version = 0.0.1
+INI
+printf '#!/bin/sh\nexit 0\n' > "$DEV/Toolchains/Bench.toolchain/usr/bin/bench-tool"
+chmod 755 "$DEV/Toolchains/Bench.toolchain/usr/bin/bench-tool"
+
+export HOME="$WORK" DEVELOPER_DIR="$DEV" SDKROOT="$DEV/SDKs/Bench.sdk" TOOLCHAINS=Bench
+
+now_ns()
+{
+	date +%s%N
+}
+
+# time_mode <label> <xcrun arguments...>
+time_mode()
+{
+	label=$1
+	shift
+	"$XCRUN" "$@" > /dev/null || { echo "bench.sh: xcrun $* failed" >&2; exit 1; }
+	start=$(now_ns)
+	i=0
+	while [ $i -lt $ITERATIONS ]; do
+		"$XCRUN" "$@" > /dev/null
+		i=$((i + 1))
+	done
+	end=$(now_ns)
+	echo "$label: $(( (end - start) / ITERATIONS / 1000 )) us/invocation"
+}
+
+time_mode "find, no cache" -n -f bench-tool
+time_mode "find, cached  " -f bench-tool
+time_mode "run, no cache " -n bench-tool
+time_mode "run, cached   " bench-tool
@@ -48,6 +48,8 @@
 #define TOOL_VERSION "1.0.0"
 #define SDK_CFG ".xcdev.dat"
 #define XCRUN_DEFAULT_CFG "/etc/xcrun.ini"
+#define XCRUN_CACHE ".xcrun.cache"
+#define XCRUN_CACHE_MAX_ENTRIES 256
 
 /* Toolchain configuration struct */
 typedef struct {
@@ -70,10 +72,27 @@ typedef struct {
 	const char *toolchain;
 } default_config;
 
+/* Resolved lookup, everything needed to find or execute a tool */
+typedef struct {
+	char cmd[PATH_MAX];
+	char sdk_path[PATH_MAX];
+	char toolchain_path[PATH_MAX];
+	char target_triple[NAME_MAX];
+	char deployment_target[NAME_MAX];	/* e.g. IPHONEOS_DEPLOYMENT_TARGET=4.3 */
+	int have_environment;			/* 0 if only cmd was resolved (--find) */
+	char search_cfg[PATH_MAX];		/* sdk info.ini that chose the toolchain searched, if any */
+	char searched[PATH_MAX * 4];		/* directories searched before the one cmd was found in */
+	long long default_cfg_mtime;		/* mtimes the lookup was made with */
+	long long sdk_cfg_mtime;
+	long long search_cfg_mtime;
+	long long cmd_mtime;
+} resolved_lookup;
+
 /* Output mode flags */
 static int logging_mode = 0;
 static int verbose_mode = 0;
 static int finding_mode = 0;
+static int cache_mode = 1;
 
 /* Behavior mode flags */
 static int explicit_sdk_mode = 0;
@@ -184,10 +203,8 @@ static int usage(void)
 		"  -l, --log                    show commands to be executed (with --run)\n"
 		"  -f, --find                   only find and print the tool path\n"
 		"  -r, --run                    find and execute the tool (the default behavior)\n"
-#if 0
-		"  -n, --no-cache               do not use the lookup cache (not implemented yet - does nothing)\n"
-		"  -k, --kill-cache             invalidate all existing cache entries (not implemented yet - does nothing)\n"
-#endif
+		"  -n, --no-cache               do not use the lookup cache\n"
+		"  -k, --kill-cache             invalidate all existing cache entries\n"
 		"  --show-sdk-path              show selected SDK install path\n"
 		"  --show-sdk-version           show selected SDK version\n"
 		"  --show-sdk-target-triple     show selected SDK target triple\n"
@@ -315,7 +332,7 @@ static int default_cfg_handler(void *user, const char *section, const char *name
  */
 static toolchain_config get_toolchain_info(const char *path)
 {
-	toolchain_config config;
+	toolchain_config config = { 0 };
 	char info_path[PATH_MAX] = { 0 };
 
 	sprintf(info_path, "%s/info.ini", path);
@@ -335,7 +352,7 @@ static toolchain_config get_toolchain_info(const char *path)
  */
 static sdk_config get_sdk_info(const char *path)
 {
-	sdk_config config;
+	sdk_config config = { 0 };
 	char info_path[PATH_MAX] = { 0 };
 
 	sprintf(info_path, "%s/info.ini", path);
@@ -355,7 +372,7 @@ static sdk_config get_sdk_info(const char *path)
  */
 static default_config get_default_info(const char *path)
 {
-	default_config config;
+	default_config config = { 0 };
 
 	if (ini_parse(path, default_cfg_handler, &config) != (-1))
 		return config;
@@ -605,16 +622,24 @@ static char *get_target_triple(const char *current_sdk)
 
 /**
  * @func call_command -- Execute new process to replace this one.
- * @arg cmd  - absolute path to the program
- * @arg argc - number of arguments to be passed to new process
- * @arg argv - arguments to be passed to new process
+ * @arg lookup - resolved lookup of the program to execute
+ * @arg argc   - number of arguments to be passed to new process
+ * @arg argv   - arguments to be passed to new process
  * @return: -1 on error, otherwise no return
  */
-static int call_command(const char *cmd, int argc, char *argv[])
+static int call_command(const resolved_lookup *lookup, int argc, char *argv[])
 {
-	int i;
+	int i, n;
+	size_t path_size;
 	char *envp[8] = { NULL };
-	char *target_triple, *deployment_target;
+	char *host_path, *home, *target_triple, *deployment_target;
+	char sdkroot_env[PATH_MAX + 8];
+	char ld_library_path_env[PATH_MAX + 32];
+	char home_env[PATH_MAX + 8];
+	char target_triple_env[NAME_MAX + 16];
+	char deployment_target_env[NAME_MAX + 32];
+	char developer_dir_env[PATH_MAX + 16];
+	char *path_env;
 
 	/*
 	 * Pass useful variables to the enviroment of the program to be executed.
@@ -635,60 +660,342 @@ static int call_command(const char *cmd, int argc, char *argv[])
 	 *  * DEVELOPER_DIR is used as a performance optimization when making recursive calls to xcrun.
 	 */
 
-	envp[0] = (char *)calloc(PATH_MAX, sizeof(char));
-	envp[1] = (char *)calloc(PATH_MAX, sizeof(char));
-	envp[2] = (char *)calloc(PATH_MAX, sizeof(char));
-	envp[3] = (char *)calloc(PATH_MAX, sizeof(char));
-	envp[4] = (char *)calloc(NAME_MAX, sizeof(char));
-	envp[5] = (char *)calloc(NAME_MAX, sizeof(char));
-	envp[6] = (char *)calloc(PATH_MAX, sizeof(char));
-
-	sprintf(envp[0], "SDKROOT=%s", get_sdk_path(current_sdk));
-	sprintf(envp[1], "PATH=%s/usr/bin:%s/usr/bin:%s", developer_dir, get_toolchain_path(current_toolchain), getenv("PATH"));
-	sprintf(envp[2], "LD_LIBRARY_PATH=%s/usr/lib", get_toolchain_path(current_toolchain));
-	sprintf(envp[3], "HOME=%s", getenv("HOME"));
-	sprintf(envp[6], "DEVELOPER_DIR=%s", developer_dir);
-
-	if ((target_triple = get_target_triple(current_sdk)) != NULL)
-		sprintf(envp[4], "TARGET_TRIPLE=%s", target_triple);
-	else
-		fprintf(stderr, "xcrun: warning: failed to retrieve target triple information for %s.sdk.\n", current_sdk);
+	if ((host_path = getenv("PATH")) == NULL)
+		host_path = "(null)";
+	if ((home = getenv("HOME")) == NULL)
+		home = "(null)";
+
+	path_size = strlen(developer_dir) + strlen(lookup->toolchain_path) + strlen(host_path) + 32;
+	if ((path_env = (char *)malloc(path_size)) == NULL) {
+		fprintf(stderr, "xcrun: error: failed to allocate environment. (%s)\n", strerror(errno));
+		return -1;
+	}
 
-	if ((deployment_target = getenv("IPHONEOS_DEPLOYMENT_TARGET")) != NULL)
-		sprintf(envp[5], "IPHONEOS_DEPLOYMENT_TARGET=%s", deployment_target);
-	else if ((deployment_target = getenv("MACOSX_DEPLOYMENT_TARGET")) != NULL)
-		sprintf(envp[5], "MACOSX_DEPLOYMENT_TARGET=%s", deployment_target);
-	else {
+	n = 0;
+	snprintf(sdkroot_env, sizeof(sdkroot_env), "SDKROOT=%s", lookup->sdk_path);
+	envp[n++] = sdkroot_env;
+	snprintf(path_env, path_size, "PATH=%s/usr/bin:%s/usr/bin:%s", developer_dir, lookup->toolchain_path, host_path);
+	envp[n++] = path_env;
+	snprintf(ld_library_path_env, sizeof(ld_library_path_env), "LD_LIBRARY_PATH=%s/usr/lib", lookup->toolchain_path);
+	envp[n++] = ld_library_path_env;
+	snprintf(home_env, sizeof(home_env), "HOME=%s", home);
+	envp[n++] = home_env;
+
+	if ((target_triple = getenv("TARGET_TRIPLE")) == NULL && lookup->target_triple[0] != '\0')
+		target_triple = (char *)lookup->target_triple;
+	if (target_triple != NULL) {
+		snprintf(target_triple_env, sizeof(target_triple_env), "TARGET_TRIPLE=%s", target_triple);
+		envp[n++] = target_triple_env;
+	} else
+		fprintf(stderr, "xcrun: warning: failed to retrieve target triple information for %s.\n", lookup->sdk_path);
+
+	if ((deployment_target = getenv("IPHONEOS_DEPLOYMENT_TARGET")) != NULL) {
+		snprintf(deployment_target_env, sizeof(deployment_target_env), "IPHONEOS_DEPLOYMENT_TARGET=%s", deployment_target);
+		envp[n++] = deployment_target_env;
+	} else if ((deployment_target = getenv("MACOSX_DEPLOYMENT_TARGET")) != NULL) {
+		snprintf(deployment_target_env, sizeof(deployment_target_env), "MACOSX_DEPLOYMENT_TARGET=%s", deployment_target);
+		envp[n++] = deployment_target_env;
+	} else if (lookup->deployment_target[0] != '\0') {
 		/* Use the deployment target info that is provided by the SDK. */
-		if ((deployment_target = strdup(get_sdk_info(get_sdk_path(current_sdk)).deployment_target)) != NULL) {
-			if (macosx_deployment_target_set == 1)
-				sprintf(envp[5], "MACOSX_DEPLOYMENT_TARGET=%s", deployment_target);
-			else if (ios_deployment_target_set == 1)
-				sprintf(envp[5], "IPHONEOS_DEPLOYMENT_TARGET=%s", deployment_target);
-		} else {
-			fprintf(stderr, "xcrun: error: failed to retrieve deployment target information for %s.sdk.\n", current_sdk);
-			return -1;
-		}
+		envp[n++] = (char *)lookup->deployment_target;
 	}
 
+	snprintf(developer_dir_env, sizeof(developer_dir_env), "DEVELOPER_DIR=%s", developer_dir);
+	envp[n++] = developer_dir_env;
+
 	if (logging_mode == 1) {
-		logging_printf(stdout, "xcrun: info: invoking command:\n\t\"%s", cmd);
+		logging_printf(stdout, "xcrun: info: invoking command:\n\t\"%s", lookup->cmd);
 		for (i = 1; i < argc; i++)
 			logging_printf(stdout, " %s", argv[i]);
 		logging_printf(stdout, "\"\n");
 	}
 
-	return execve(cmd, argv, envp);
+	fflush(stdout);
+	execve(lookup->cmd, argv, envp);
+
+	free(path_env);
+	return -1;
 }
 
 /**
- * @func search_command -- Search a set of directories for a given command
- * @arg buf  - buffer to hold the absolute path to the command
+ * @func file_mtime -- Return the modification time of a file.
+ * @arg path - path to the file
+ * @return: modification time, or 0 if the file can't be stat'ed
+ */
+static long long file_mtime(const char *path)
+{
+	struct stat fstat;
+
+	if (stat(path, &fstat) != 0)
+		return 0;
+
+	return (long long)fstat.st_mtime;
+}
+
+/**
+ * @func get_cache_path -- Return the path to the lookup cache.
+ * @arg path - buffer to hold the absolute path of the cache
+ * @return: 0 on success, -1 on failure
+ */
+static int get_cache_path(char *path)
+{
+	char *home_path;
+
+	if ((home_path = getenv("HOME")) == NULL)
+		return -1;
+
+	snprintf(path, PATH_MAX, "%s/%s", home_path, XCRUN_CACHE);
+
+	return 0;
+}
+
+/**
+ * @func get_cache_key -- Build the lookup cache key for a command.
+ *
+ * The key is made of everything a lookup depends on before any configuration file is read, so a
+ * cached lookup can be used without reading them.
+ *
+ * @arg key  - buffer to hold the key
+ * @arg size - size of the key buffer
  * @arg name - command name
- * @arg dirs - set of directories to search, seperated by colons
+ */
+static void get_cache_key(char *key, size_t size, const char *name)
+{
+	char *sdk_env, *toolchain_env;
+
+	sdk_env = getenv("SDKROOT");
+	toolchain_env = getenv("TOOLCHAINS");
+
+	snprintf(key, size, "%s|%s|%s|%s|%s|%s|%s|%s",
+		developer_dir,
+		current_sdk, (alternate_sdk_path != NULL) ? alternate_sdk_path : "", (sdk_env != NULL) ? sdk_env : "",
+		current_toolchain, (alternate_toolchain_path != NULL) ? alternate_toolchain_path : "", (toolchain_env != NULL) ? toolchain_env : "",
+		name);
+}
+
+/**
+ * @func parse_cache_entry -- Split a lookup cache line into its fields.
+ * @arg line   - line read from the cache, modified in place
+ * @arg key    - set to the key of the entry
+ * @arg lookup - filled in with the lookup
+ * @return: 0 on success, -1 if the line is malformed
+ */
+static int parse_cache_entry(char *line, char **key, resolved_lookup *lookup)
+{
+	int i;
+	char *fields[13];
+
+	for (i = 0; i < 13; i++) {
+		if ((fields[i] = strsep(&line, "\t\n")) == NULL)
+			return -1;
+	}
+
+	*key = fields[0];
+	snprintf(lookup->cmd, sizeof(lookup->cmd), "%s", fields[1]);
+	snprintf(lookup->sdk_path, sizeof(lookup->sdk_path), "%s", fields[2]);
+	snprintf(lookup->toolchain_path, sizeof(lookup->toolchain_path), "%s", fields[3]);
+	snprintf(lookup->target_triple, sizeof(lookup->target_triple), "%s", fields[4]);
+	snprintf(lookup->deployment_target, sizeof(lookup->deployment_target), "%s", fields[5]);
+	lookup->have_environment = atoi(fields[6]);
+	snprintf(lookup->search_cfg, sizeof(lookup->search_cfg), "%s", fields[7]);
+	snprintf(lookup->searched, sizeof(lookup->searched), "%s", fields[8]);
+	lookup->default_cfg_mtime = strtoll(fields[9], NULL, 10);
+	lookup->sdk_cfg_mtime = strtoll(fields[10], NULL, 10);
+	lookup->search_cfg_mtime = strtoll(fields[11], NULL, 10);
+	lookup->cmd_mtime = strtoll(fields[12], NULL, 10);
+
+	return 0;
+}
+
+/**
+ * @func command_shadowed -- Check whether a command has appeared in any of a set of directories.
+ * @arg name - command name
+ * @arg dirs - set of directories, seperated by colons
+ * @return: 1 if one of the directories has an executable with the command's name, 0 otherwise
+ */
+static int command_shadowed(const char *name, const char *dirs)
+{
+	const char *dir, *end;
+	char cmd_absl_path[PATH_MAX];
+
+	for (dir = dirs; *dir != '\0'; dir = (*end == ':') ? end + 1 : end) {
+		if ((end = strchr(dir, ':')) == NULL)
+			end = dir + strlen(dir);
+		if (end == dir)
+			continue;
+		snprintf(cmd_absl_path, sizeof(cmd_absl_path), "%.*s/%s", (int)(end - dir), dir, name);
+		if (access(cmd_absl_path, (F_OK | X_OK)) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @func cache_lookup -- Find a valid lookup in the lookup cache.
+ *
+ * A cached lookup is only used if xcrun.ini, the sdk info.ini files it depends on and the command
+ * itself have not been modified since it was made, and if the command has not since appeared in a
+ * directory that is searched before the one it was found in.
+ *
+ * @arg key    - key of the lookup
+ * @arg name   - command name
+ * @arg lookup - filled in with the cached lookup
+ * @return: 0 if a valid lookup was found, -1 otherwise
+ */
+static int cache_lookup(const char *key, const char *name, resolved_lookup *lookup)
+{
+	FILE *fp;
+	char *line, *entry_key;
+	size_t line_size;
+	int found;
+	char cache_path[PATH_MAX];
+	char info_path[PATH_MAX];
+	struct stat fstat;
+
+	if (get_cache_path(cache_path) != 0)
+		return -1;
+
+	if ((fp = fopen(cache_path, "r")) == NULL)
+		return -1;
+
+	found = -1;
+	line = NULL;
+	line_size = 0;
+	while (getline(&line, &line_size, fp) != (-1)) {
+		if (strncmp(line, key, strlen(key)) != 0 || line[strlen(key)] != '\t')
+			continue;
+		if (parse_cache_entry(line, &entry_key, lookup) == 0)
+			found = 0;
+	}
+	free(line);
+	fclose(fp);
+
+	if (found != 0)
+		return -1;
+
+	if (file_mtime(XCRUN_DEFAULT_CFG) != lookup->default_cfg_mtime)
+		return -1;
+
+	/* Lookups made with --find record the sdk too, so they are dropped along with the others. */
+	if (lookup->sdk_path[0] != '\0') {
+		snprintf(info_path, sizeof(info_path), "%s/info.ini", lookup->sdk_path);
+		if (file_mtime(info_path) != lookup->sdk_cfg_mtime)
+			return -1;
+	}
+
+	if (lookup->search_cfg[0] != '\0' && file_mtime(lookup->search_cfg) != lookup->search_cfg_mtime)
+		return -1;
+
+	if (stat(lookup->cmd, &fstat) != 0 || !S_ISREG(fstat.st_mode) || (fstat.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) == 0)
+		return -1;
+	if ((long long)fstat.st_mtime != lookup->cmd_mtime)
+		return -1;
+
+	if (command_shadowed(name, lookup->searched))
+		return -1;
+
+	return 0;
+}
+
+/**
+ * @func cache_store -- Add a lookup to the lookup cache, replacing any previous one for the key.
+ *
+ * The cache is rewritten to a temporary file which is renamed over it, so concurrent xcrun
+ * invocations always read a complete cache.  Only the XCRUN_CACHE_MAX_ENTRIES most recent lookups
+ * are kept.
+ *
+ * @arg key    - key of the lookup
+ * @arg lookup - the lookup to store
+ */
+static void cache_store(const char *key, const resolved_lookup *lookup)
+{
+	FILE *fp, *tmp_fp;
+	char **lines, *line;
+	size_t line_size;
+	int i, nlines, status;
+	char cache_path[PATH_MAX];
+	char tmp_path[PATH_MAX + 32];
+
+	/* Tabs and newlines separate the fields and entries, don't cache anything containing them. */
+	if (strpbrk(key, "\t\n") != NULL || strpbrk(lookup->cmd, "\t\n") != NULL ||
+	    strpbrk(lookup->sdk_path, "\t\n") != NULL || strpbrk(lookup->toolchain_path, "\t\n") != NULL ||
+	    strpbrk(lookup->target_triple, "\t\n") != NULL || strpbrk(lookup->deployment_target, "\t\n") != NULL ||
+	    strpbrk(lookup->search_cfg, "\t\n") != NULL || strpbrk(lookup->searched, "\t\n") != NULL)
+		return;
+
+	if (get_cache_path(cache_path) != 0)
+		return;
+
+	lines = (char **)calloc(XCRUN_CACHE_MAX_ENTRIES, sizeof(char *));
+	if (lines == NULL)
+		return;
+
+	/* Keep the other entries, dropping the oldest ones if the cache is full. */
+	nlines = 0;
+	if ((fp = fopen(cache_path, "r")) != NULL) {
+		line = NULL;
+		line_size = 0;
+		while (getline(&line, &line_size, fp) != (-1)) {
+			if (strncmp(line, key, strlen(key)) == 0 && line[strlen(key)] == '\t')
+				continue;
+			if (nlines == XCRUN_CACHE_MAX_ENTRIES - 1) {
+				free(lines[0]);
+				memmove(lines, lines + 1, (nlines - 1) * sizeof(char *));
+				nlines--;
+			}
+			lines[nlines++] = strdup(line);
+		}
+		free(line);
+		fclose(fp);
+	}
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld", cache_path, (long)getpid());
+	if ((tmp_fp = fopen(tmp_path, "w")) != NULL) {
+		for (i = 0; i < nlines; i++) {
+			if (lines[i] != NULL)
+				fputs(lines[i], tmp_fp);
+		}
+		fprintf(tmp_fp, "%s\t%s\t%s\t%s\t%s\t%s\t%d\t%s\t%s\t%lld\t%lld\t%lld\t%lld\n",
+			key, lookup->cmd, lookup->sdk_path, lookup->toolchain_path, lookup->target_triple,
+			lookup->deployment_target, lookup->have_environment, lookup->search_cfg, lookup->searched,
+			lookup->default_cfg_mtime, lookup->sdk_cfg_mtime, lookup->search_cfg_mtime, lookup->cmd_mtime);
+		status = fclose(tmp_fp);
+		if (status != 0 || rename(tmp_path, cache_path) != 0) {
+			verbose_printf(stdout, "xcrun: info: unable to update lookup cache '%s'. (%s)\n", cache_path, strerror(errno));
+			unlink(tmp_path);
+		}
+	}
+
+	for (i = 0; i < nlines; i++)
+		free(lines[i]);
+	free(lines);
+}
+
+/**
+ * @func kill_cache -- Invalidate all lookup cache entries.
+ */
+static void kill_cache(void)
+{
+	char cache_path[PATH_MAX];
+
+	if (get_cache_path(cache_path) != 0)
+		return;
+
+	if (unlink(cache_path) != 0 && errno != ENOENT)
+		fprintf(stderr, "xcrun: warning: unable to remove lookup cache '%s'. (%s)\n", cache_path, strerror(errno));
+}
+
+/**
+ * @func search_command -- Search a set of directories for a given command
+ * @arg buf      - buffer to hold the absolute path to the command
+ * @arg searched - buffer of searched_size bytes to hold the directories searched before the
+ *                 command was found, seperated by colons
+ * @arg name     - command name
+ * @arg dirs     - set of directories to search, seperated by colons
  * @return: 0 on a successful search, -1 on failure
  */
-static int search_command(char *buf, const char *name, char *dirs)
+static int search_command(char *buf, char *searched, size_t searched_size, const char *name, char *dirs)
 {
 	char *cmd_search_path;
 	char cmd_absl_path[PATH_MAX] = { 0 };
@@ -708,7 +1015,8 @@ static int search_command(char *buf, const char *name, char *dirs)
 			return 0;
 		}
 
-		/* If not, move onto the next entry.. */
+		/* If not, remember it was searched and move onto the next entry.. */
+		snprintf(searched + strlen(searched), searched_size - strlen(searched), "%s:", cmd_search_path);
 		memset(cmd_absl_path, 0, PATH_MAX);
 		cmd_search_path = strtok(NULL, ":");
 	}
@@ -717,27 +1025,22 @@ static int search_command(char *buf, const char *name, char *dirs)
 }
 
 /**
- * @func request_command -- Request a program.
- * @arg name - name of program
- * @arg argv - arguments to be passed if program found
- * @return: -1 on failed search, 0 on successful search, no return on execute
+ * @func resolve_defaults -- Fall back to the environment or xcrun.ini for an unspecified SDK and/or Toolchain.
  */
-static int request_command(const char *name, int argc, char *argv[])
+static void resolve_defaults(void)
 {
-	char cmd[PATH_MAX] = { 0 };
-	char search_string[PATH_MAX * 256] = { 0 };
-	char *sdk_env, *toolch_name, *toolchain_env;
+	char *sdk_env, *toolchain_env;
+	default_config config;
+	int have_config = 0;
 
-	/*
-	 * If xcrun was called in a multicall state, we still want to specify current_sdk for SDKROOT and
-	 * current_toolchain for PATH.
-	 */
 	if (strlen(current_sdk) == 0) {
 		if ((sdk_env = getenv("SDKROOT")) != NULL) {
 			stripext(current_sdk, basename(sdk_env));
 		} else {
-			const char *sdk_info = get_default_info(XCRUN_DEFAULT_CFG).sdk;
-			strncpy(current_sdk, sdk_info, strlen(sdk_info));
+			config = get_default_info(XCRUN_DEFAULT_CFG);
+			have_config = 1;
+			if (config.sdk != NULL)
+				strncpy(current_sdk, config.sdk, strlen(config.sdk));
 		}
 	}
 
@@ -745,16 +1048,31 @@ static int request_command(const char *name, int argc, char *argv[])
 		if ((toolchain_env = getenv("TOOLCHAINS")) != NULL) {
 			stripext(current_toolchain, basename(toolchain_env));
 		} else {
-			const char *toolch_info = get_default_info(XCRUN_DEFAULT_CFG).toolchain;
-			strncpy(current_toolchain, toolch_info, strlen(toolch_info));
+			if (have_config == 0)
+				config = get_default_info(XCRUN_DEFAULT_CFG);
+			if (config.toolchain != NULL)
+				strncpy(current_toolchain, config.toolchain, strlen(config.toolchain));
 		}
 	}
+}
+
+/**
+ * @func resolve_command -- Search the developer dir, sdk and toolchain for a program.
+ * @arg lookup - lookup to fill in with the absolute path to the program and what it was found with
+ * @arg name   - name of program
+ * @return: 0 on a successful search, -1 on failure
+ */
+static int resolve_command(resolved_lookup *lookup, const char *name)
+{
+	char search_string[PATH_MAX * 256] = { 0 };
+	char *toolch_name;
 
 	/* No matter the circumstance, search the developer dir. */
 	sprintf(search_string, "%s/usr/bin:", developer_dir);
 
 	/* If we explicitly specified an sdk, search the sdk and it's associated toolchain. */
 	if (explicit_sdk_mode == 1) {
+		snprintf(lookup->search_cfg, sizeof(lookup->search_cfg), "%s/info.ini", get_sdk_path(current_sdk));
 		toolch_name = strdup(get_sdk_info(get_sdk_path(current_sdk)).toolchain);
 		sprintf((search_string + strlen(search_string)), "%s/usr/bin:%s/usr/bin", get_sdk_path(current_sdk), get_toolchain_path(toolch_name));
 		goto do_search;
@@ -771,6 +1089,7 @@ static int request_command(const char *name, int argc, char *argv[])
 		sprintf((search_string + strlen(search_string)), "%s/usr/bin:", alternate_sdk_path);
 		/* We also want to append an associated toolchain if this is really an SDK folder. */
 		if (test_sdk_authenticity(alternate_sdk_path) == 1) {
+			snprintf(lookup->search_cfg, sizeof(lookup->search_cfg), "%s/info.ini", alternate_sdk_path);
 			toolch_name = strdup(get_sdk_info(alternate_sdk_path).toolchain);
 			sprintf((search_string + strlen(search_string)), "%s/usr/bin", get_toolchain_path(toolch_name));
 			/* We now have a toolchain, so skip to search. */
@@ -788,24 +1107,114 @@ static int request_command(const char *name, int argc, char *argv[])
 
 	/* Search each path entry in search_string until we find our program. */
 do_search:
-	if (search_command(cmd, name, search_string) == 0) {
-		if (finding_mode == 1) {
-			if (access(cmd, (F_OK | X_OK)) == 0) {
-				fprintf(stdout, "%s\n", cmd);
-				return 0;
-			} else {
-				return -1;
-			}
+	return search_command(lookup->cmd, lookup->searched, sizeof(lookup->searched), name, search_string);
+}
+
+/**
+ * @func resolve_environment -- Fill in the environment a program is executed with.
+ *
+ * The current sdk's info.ini is only parsed once for both the target triple and the deployment target.
+ *
+ * @arg lookup - lookup to fill in
+ */
+static void resolve_environment(resolved_lookup *lookup)
+{
+	sdk_config config;
+	char info_path[PATH_MAX];
+
+	snprintf(lookup->sdk_path, sizeof(lookup->sdk_path), "%s", get_sdk_path(current_sdk));
+	snprintf(lookup->toolchain_path, sizeof(lookup->toolchain_path), "%s", get_toolchain_path(current_toolchain));
+
+	snprintf(info_path, sizeof(info_path), "%s/info.ini", lookup->sdk_path);
+	lookup->sdk_cfg_mtime = file_mtime(info_path);
+
+	config = get_sdk_info(lookup->sdk_path);
+
+	if (config.default_arch != NULL && config.deployment_target != NULL)
+		parse_target_triple(lookup->target_triple, config.deployment_target, config.default_arch);
+
+	if (config.deployment_target != NULL) {
+		if (macosx_deployment_target_set == 1)
+			snprintf(lookup->deployment_target, sizeof(lookup->deployment_target), "MACOSX_DEPLOYMENT_TARGET=%s", config.deployment_target);
+		else if (ios_deployment_target_set == 1)
+			snprintf(lookup->deployment_target, sizeof(lookup->deployment_target), "IPHONEOS_DEPLOYMENT_TARGET=%s", config.deployment_target);
+	}
+
+	lookup->have_environment = 1;
+}
+
+/**
+ * @func request_command -- Request a program.
+ * @arg name - name of program
+ * @arg argv - arguments to be passed if program found
+ * @return: -1 on failed search, 0 on successful search, no return on execute
+ */
+static int request_command(const char *name, int argc, char *argv[])
+{
+	resolved_lookup lookup;
+	char key[PATH_MAX * 4];
+	char info_path[PATH_MAX];
+	int cached;
+
+	memset(&lookup, 0, sizeof(lookup));
+
+	/*
+	 * A cached lookup saves searching for the program and parsing xcrun.ini and the sdk's info.ini.
+	 * Programs that are executed need the environment as well, not just the path.
+	 */
+	cached = -1;
+	if (cache_mode == 1) {
+		get_cache_key(key, sizeof(key), name);
+		if ((cached = cache_lookup(key, name, &lookup)) == 0 && finding_mode == 0 && lookup.have_environment == 0)
+			cached = -1;
+		if (cached == 0)
+			verbose_printf(stdout, "xcrun: info: using cached lookup for command '%s': '%s'\n", name, lookup.cmd);
+	}
+
+	if (cached != 0) {
+		memset(&lookup, 0, sizeof(lookup));
+
+		/*
+		 * If xcrun was called in a multicall state, we still want to specify current_sdk for SDKROOT and
+		 * current_toolchain for PATH.
+		 */
+		resolve_defaults();
+
+		if (resolve_command(&lookup, name) != 0) {
+			/* We have searched everywhere, but we haven't found our program. State why. */
+			fprintf(stderr, "xcrun: error: can't stat '%s' (%s)\n", name, strerror(errno));
+			return -1;
+		}
+
+		if (finding_mode == 0)
+			resolve_environment(&lookup);
+		else if (strlen(current_sdk) != 0) {
+			/* Record the sdk anyway, so the lookup is dropped when its info.ini changes. */
+			snprintf(lookup.sdk_path, sizeof(lookup.sdk_path), "%s/SDKs/%s.sdk", developer_dir, current_sdk);
+			snprintf(info_path, sizeof(info_path), "%s/info.ini", lookup.sdk_path);
+			lookup.sdk_cfg_mtime = file_mtime(info_path);
+		}
+
+		if (cache_mode == 1) {
+			lookup.default_cfg_mtime = file_mtime(XCRUN_DEFAULT_CFG);
+			if (lookup.search_cfg[0] != '\0')
+				lookup.search_cfg_mtime = file_mtime(lookup.search_cfg);
+			lookup.cmd_mtime = file_mtime(lookup.cmd);
+			cache_store(key, &lookup);
+		}
+	}
+
+	if (finding_mode == 1) {
+		if (access(lookup.cmd, (F_OK | X_OK)) == 0) {
+			fprintf(stdout, "%s\n", lookup.cmd);
+			return 0;
 		} else {
-			if (call_command(cmd, argc, argv) != 0) {
-				fprintf(stderr, "xcrun: error: can't exec \'%s\' (%s)\n", cmd, strerror(errno));
-				return -1;
-			}
+			return -1;
 		}
 	}
 
-	/* We have searched everywhere, but we haven't found our program. State why. */
-	fprintf(stderr, "xcrun: error: can't stat \'%s\' (%s)\n", name, strerror(errno));
+	if (call_command(&lookup, argc, argv) != 0)
+		fprintf(stderr, "xcrun: error: can't exec \'%s\' (%s)\n", lookup.cmd, strerror(errno));
 
 	return -1;
 }
@@ -821,8 +1230,7 @@ static int xcrun_main(int argc, char *argv[])
 	int ch;
 	int optindex = 0;
 	int argc_offset = 0;
-	char *sdk_env, *toolchain_env;
-	char *sdk, *toolchain, *tool_called;
+	char *sdk, *toolchain, *tool_called = NULL;
 
 	static int help_f, verbose_f, log_f, find_f, run_f, nocache_f, killcache_f, version_f, sdk_f, toolchain_f, ssdkp_f, ssdkv_f, ssdkpp_f, ssdktt_f, ssdkpv_f;
 	help_f = verbose_f = log_f = find_f = run_f = nocache_f = killcache_f = version_f = sdk_f = toolchain_f = ssdkp_f = ssdkv_f = ssdkpp_f = ssdktt_f = ssdkpv_f = 0;
@@ -974,23 +1382,8 @@ static int xcrun_main(int argc, char *argv[])
 		return version();
 
 	/* If our SDK and/or Toolchain hasn't been specified, fall back to environment or defaults. */
-	if (strlen(current_sdk) == 0) {
-		if ((sdk_env = getenv("SDKROOT")) != NULL) {
-			stripext(current_sdk, basename(sdk_env));
-		} else {
-			const char *sdk_info = get_default_info(XCRUN_DEFAULT_CFG).sdk;
-			strncpy(current_sdk, sdk_info, strlen(sdk_info));
-		}
-	}
-
-	if (strlen(current_toolchain) == 0) {
-		if ((toolchain_env = getenv("TOOLCHAINS")) != NULL) {
-			stripext(current_toolchain, basename(toolchain_env));
-		} else {
-			const char *toolch_info = get_default_info(XCRUN_DEFAULT_CFG).toolchain;
-			strncpy(current_toolchain, toolch_info, strlen(toolch_info));
-		}
-	}
+	if (ssdkp_f || ssdkv_f || ssdkpp_f || ssdkpv_f || ssdktt_f)
+		resolve_defaults();
 
 	/* Show SDK path? */
 	if (ssdkp_f) {
@@ -1023,12 +1416,15 @@ static int xcrun_main(int argc, char *argv[])
 	}
 
 	/* Clear the lookup cache? */
-	if (killcache_f)
-		fprintf(stderr, "xcrun: warning: --kill-cache not supported.\n");
+	if (killcache_f) {
+		kill_cache();
+		if (tool_called == NULL)
+			return 0;
+	}
 
 	/* Don't use the lookup cache? */
 	if (nocache_f)
-		fprintf(stderr, "xcrun: warning: --no-cache not supported.\n");
+		cache_mode = 0;
 
 	/* Turn on verbose mode? */
 	if (verbose_f)
@@ -1111,6 +1507,7 @@ int main(int argc, char *argv[])
 			return xcrun_main(argc, argv);
 			break;
 		case 4: /* xcrun_nocache */
+			cache_mode = 0;
 			return xcrun_main(argc, argv);
 			break;
 		case -1: